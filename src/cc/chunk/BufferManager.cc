@@ -44,6 +44,7 @@ BufferManager::Client::Client()
       mByteCount(0),
       mWaitingForByteCount(0),
       mWaitStart(0),
+      mQosClass(0),
       mOverQuotaWaitingFlag(false)
 {
     WaitQueue::Init(*this);
@@ -83,9 +84,16 @@ BufferManager::BufferManager(
       mWaitingAvgBytes(0),
       mWaitingAvgCount(0),
       mWaitingAvgUsecs(0),
-      mCounters()
+      mCounters(),
+      mQosWaitingClassCount(0),
+      mQosVirtualTime(0)
 {
-    WaitQueue::Init(mWaitQueuePtr);
+    for (int i = 0; i < kQosClassCount; i++) {
+        WaitQueue::Init(mWaitQueuePtr[i]);
+        mQosCost[i] = kQosCostScale;
+        mQosTag[i]  = 0;
+        mQosCounters[i].Clear();
+    }
     WaitQueue::Init(mOverQuotaWaitQueuePtr);
     mCounters.Clear();
     BufferManager::SetWaitingAvgInterval(20);
@@ -94,7 +102,7 @@ BufferManager::BufferManager(
 BufferManager::~BufferManager()
 {
     QCRTASSERT(
-        WaitQueue::IsEmpty(mWaitQueuePtr) &&
+        mWaitingCount == 0 &&
         WaitQueue::IsEmpty(mOverQuotaWaitQueuePtr)
     );
     globalNetManager().UnRegisterTimeoutHandler(this);
@@ -134,29 +142,126 @@ BufferManager::ChangeOverQuotaWait(
     if (inClient.mOverQuotaWaitingFlag == inFlag) {
         return;
     }
-    WaitQueue::Remove(
-        inClient.mOverQuotaWaitingFlag ? mOverQuotaWaitQueuePtr : mWaitQueuePtr,
-        inClient
-    );
     if (inClient.mOverQuotaWaitingFlag) {
+        WaitQueue::Remove(mOverQuotaWaitQueuePtr, inClient);
         mOverQuotaWaitingCount--;
         mOverQuotaWaitingByteCount -= inClient.mWaitingForByteCount;
     } else {
-        mWaitingCount--;
-        mWaitingByteCount -= inClient.mWaitingForByteCount;
+        QosWaitRemove(inClient);
     }
     inClient.mOverQuotaWaitingFlag = inFlag;
-    WaitQueue::PushBack(
-        inClient.mOverQuotaWaitingFlag ? mOverQuotaWaitQueuePtr : mWaitQueuePtr,
-        inClient
-    );
     if (inClient.mOverQuotaWaitingFlag) {
+        WaitQueue::PushBack(mOverQuotaWaitQueuePtr, inClient);
         mOverQuotaWaitingCount++;
         mOverQuotaWaitingByteCount += inClient.mWaitingForByteCount;
     } else {
-        mWaitingCount++;
-        mWaitingByteCount += inClient.mWaitingForByteCount;
+        QosWaitAdd(inClient);
+    }
+}
+
+    void
+BufferManager::QosWaitAdd(
+    BufferManager::Client& inClient)
+{
+    Client** const theQueuePtr = mWaitQueuePtr[inClient.mQosClass];
+    if (WaitQueue::IsEmpty(theQueuePtr)) {
+        mQosWaitingClassCount++;
+    }
+    WaitQueue::PushBack(theQueuePtr, inClient);
+    mWaitingCount++;
+    mWaitingByteCount += inClient.mWaitingForByteCount;
+    QosCounters& theCounters = mQosCounters[inClient.mQosClass];
+    theCounters.mWaitingCount++;
+    theCounters.mWaitingByteCount += inClient.mWaitingForByteCount;
+}
+
+    void
+BufferManager::QosWaitRemove(
+    BufferManager::Client& inClient)
+{
+    Client** const theQueuePtr = mWaitQueuePtr[inClient.mQosClass];
+    WaitQueue::Remove(theQueuePtr, inClient);
+    if (WaitQueue::IsEmpty(theQueuePtr)) {
+        mQosWaitingClassCount--;
     }
+    mWaitingCount--;
+    mWaitingByteCount -= inClient.mWaitingForByteCount;
+    QosCounters& theCounters = mQosCounters[inClient.mQosClass];
+    theCounters.mWaitingCount--;
+    theCounters.mWaitingByteCount -= inClient.mWaitingForByteCount;
+}
+
+    bool
+BufferManager::QosMayGrant(
+    int inQosClass) const
+{
+    if (mQosWaitingClassCount <= 0 || (mQosWaitingClassCount == 1 &&
+            ! WaitQueue::IsEmpty(mWaitQueuePtr[inQosClass]))) {
+        return true;
+    }
+    // Do not let the request through ahead of the waiting requests of the
+    // classes with smaller start tag.
+    const int64_t theTag = QosStartTag(inQosClass);
+    for (int i = 0; i < kQosClassCount; i++) {
+        if (i != inQosClass && ! WaitQueue::IsEmpty(mWaitQueuePtr[i]) &&
+                QosStartTag(i) < theTag) {
+            return false;
+        }
+    }
+    return true;
+}
+
+    int
+BufferManager::QosSelect() const
+{
+    int     theRet = -1;
+    int64_t theTag = 0;
+    for (int i = 0; i < kQosClassCount; i++) {
+        if (WaitQueue::IsEmpty(mWaitQueuePtr[i])) {
+            continue;
+        }
+        const int64_t theStart = QosStartTag(i);
+        if (theRet < 0 || theStart < theTag) {
+            theRet = i;
+            theTag = theStart;
+        }
+    }
+    return theRet;
+}
+
+    void
+BufferManager::QosCharge(
+    int                      inQosClass,
+    BufferManager::ByteCount inByteCount)
+{
+    const int64_t theStart = QosStartTag(inQosClass);
+    mQosVirtualTime     = theStart;
+    mQosTag[inQosClass] = theStart + mQosCost[inQosClass] *
+        ((inByteCount + (ByteCount(1) << kQosUnitShift) - 1) >> kQosUnitShift);
+}
+
+    void
+BufferManager::SetQosWeights(
+    const int* inWeightsPtr,
+    int        inCount)
+{
+    for (int i = 0; i < kQosClassCount; i++) {
+        const int theWeight = (inWeightsPtr && i < inCount) ?
+            min(int(kQosCostScale), max(1, inWeightsPtr[i])) : 1;
+        mQosCost[i] = kQosCostScale / theWeight;
+    }
+}
+
+    void
+BufferManager::GetQosCounters(
+    int                         inQosClass,
+    BufferManager::QosCounters& outCounters) const
+{
+    if (inQosClass < 0 || kQosClassCount <= inQosClass) {
+        outCounters.Clear();
+        return;
+    }
+    outCounters = mQosCounters[inQosClass];
 }
 
     bool
@@ -195,6 +300,9 @@ BufferManager::Modify(
     }
     mCounters.mRequestCount++;
     mCounters.mRequestByteCount += inByteCount;
+    QosCounters& theQosCounters = mQosCounters[inClient.mQosClass];
+    theQosCounters.mRequestCount++;
+    theQosCounters.mRequestByteCount += inByteCount;
     mGetRequestCount++;
     inClient.mManagerPtr = this;
     const ByteCount theReqByteCount  =
@@ -205,7 +313,8 @@ BufferManager::Modify(
             (! inForDiskIoFlag || ! mDiskOverloadedFlag) &&
             ! IsLowOnBuffers() &&
             theReqByteCount < mRemainingCount &&
-            ! theOverQuotaFlag
+            ! theOverQuotaFlag &&
+            QosMayGrant(inClient.mQosClass)
         )
     );
     if (theGrantedFlag) {
@@ -213,7 +322,11 @@ BufferManager::Modify(
         mRemainingCount -= theReqByteCount;
         mCounters.mRequestGrantedCount++;
         mCounters.mRequestGrantedByteCount += inByteCount;
+        theQosCounters.mRequestGrantedCount++;
+        theQosCounters.mRequestGrantedByteCount += inByteCount;
+        QosCharge(inClient.mQosClass, inByteCount);
     } else {
+        theQosCounters.mRequestDeniedCount++;
         if (theOverQuotaFlag) {
             mCounters.mOverQuotaRequestDeniedCount++;
             mCounters.mOverQuotaRequestDeniedByteCount += inByteCount;
@@ -228,20 +341,18 @@ BufferManager::Modify(
         } else {
             inClient.mWaitStart            = microseconds();
             inClient.mOverQuotaWaitingFlag = theOverQuotaFlag;
-            WaitQueue::PushBack(
-                theOverQuotaFlag ? mOverQuotaWaitQueuePtr : mWaitQueuePtr,
-                inClient
-            );
             if (theOverQuotaFlag) {
+                WaitQueue::PushBack(mOverQuotaWaitQueuePtr, inClient);
                 mOverQuotaWaitingCount++;
             } else {
-                mWaitingCount++;
+                QosWaitAdd(inClient);
             }
         }
         if (inClient.mOverQuotaWaitingFlag) {
             mOverQuotaWaitingByteCount += inByteCount;
         } else {
             mWaitingByteCount += inByteCount;
+            theQosCounters.mWaitingByteCount += inByteCount;
         }
         mRemainingCount -= inClient.mByteCount;
         inClient.mWaitingForByteCount += inByteCount;
@@ -264,17 +375,12 @@ BufferManager::Unregister(
     QCRTASSERT(inClient.mManagerPtr == this);
     if (IsWaiting(inClient)) {
         if (inClient.mOverQuotaWaitingFlag) {
+            WaitQueue::Remove(mOverQuotaWaitQueuePtr, inClient);
             mOverQuotaWaitingCount--;
             mOverQuotaWaitingByteCount -= inClient.mWaitingForByteCount;
         } else {
-            mWaitingCount--;
-            mWaitingByteCount -= inClient.mWaitingForByteCount;
+            QosWaitRemove(inClient);
         }
-        WaitQueue::Remove(
-            inClient.mOverQuotaWaitingFlag ?
-                mOverQuotaWaitQueuePtr : mWaitQueuePtr,
-            inClient
-        );
     }
     inClient.mWaitingForByteCount = 0;
     Put(inClient, inClient.mByteCount);
@@ -296,16 +402,12 @@ BufferManager::CancelRequest(
     }
     mCounters.mReqeustCanceledCount++;
     mCounters.mReqeustCanceledBytes += inClient.mWaitingForByteCount;
-    WaitQueue::Remove(
-        inClient.mOverQuotaWaitingFlag ? mOverQuotaWaitQueuePtr : mWaitQueuePtr,
-        inClient
-    );
     if (inClient.mOverQuotaWaitingFlag) {
+        WaitQueue::Remove(mOverQuotaWaitQueuePtr, inClient);
         mOverQuotaWaitingCount--;
         mOverQuotaWaitingByteCount -= inClient.mWaitingForByteCount;
     } else {
-        mWaitingCount--;
-        mWaitingByteCount -= inClient.mWaitingForByteCount;
+        QosWaitRemove(inClient);
     }
     inClient.mWaitingForByteCount  = 0;
     inClient.mOverQuotaWaitingFlag = false;
@@ -329,18 +431,19 @@ BufferManager::Timeout()
     bool    theSetTimeFlag = true;
     int64_t theNowUsecs    = 0;
     while (! mDiskOverloadedFlag && ! IsLowOnBuffers()) {
-        Client* const theClientPtr = WaitQueue::Front(mWaitQueuePtr);
+        const int     theQosClass  = QosSelect();
+        Client* const theClientPtr = theQosClass < 0 ? 0 :
+            WaitQueue::Front(mWaitQueuePtr[theQosClass]);
         if (! theClientPtr ||
                 theClientPtr->mWaitingForByteCount > mRemainingCount) {
             break;
         }
-        WaitQueue::Remove(mWaitQueuePtr, *theClientPtr);
-        mWaitingCount--;
         const ByteCount theGrantedCount = theClientPtr->mWaitingForByteCount;
         QCASSERT(theGrantedCount > 0);
+        QosWaitRemove(*theClientPtr);
+        QosCharge(theQosClass, theGrantedCount);
         mRemainingCount -= theGrantedCount;
         QCASSERT(mRemainingCount <= mTotalCount);
-        mWaitingByteCount -= theGrantedCount;
         if (theClientPtr->mByteCount <= 0 && theGrantedCount > 0) {
             mClientsWihtBuffersCount++;
         }
@@ -348,10 +451,15 @@ BufferManager::Timeout()
             theSetTimeFlag = false;
             theNowUsecs    = microseconds();
         }
-        mCounters.mRequestWaitUsecs += max(int64_t(0),
+        const int64_t theWaitUsecs = max(int64_t(0),
             theNowUsecs - theClientPtr->mWaitStart);
+        mCounters.mRequestWaitUsecs += theWaitUsecs;
         mCounters.mRequestGrantedCount++;
         mCounters.mRequestGrantedByteCount += theGrantedCount;
+        QosCounters& theQosCounters = mQosCounters[theQosClass];
+        theQosCounters.mRequestWaitUsecs += theWaitUsecs;
+        theQosCounters.mRequestGrantedCount++;
+        theQosCounters.mRequestGrantedByteCount += theGrantedCount;
         theClientPtr->mByteCount += theGrantedCount;
         theClientPtr->mWaitingForByteCount = 0;
         theClientPtr->Granted(theGrantedCount);
@@ -533,9 +641,14 @@ BufferManager::UpdateWaitingAvg()
     }
     const int64_t theNowUsecs  = microseconds();
     const int64_t theEnd       = theNowUsecs - kWaitingAvgIntervalUsec;
-    const int64_t theWaitUsecs = WaitQueue::IsEmpty(mWaitQueuePtr) ?
-        int64_t(0) : max(int64_t(0),
-            theNowUsecs - WaitQueue::Front(mWaitQueuePtr)->mWaitStart);
+    int64_t theWaitStart = theNowUsecs;
+    for (int i = 0; i < kQosClassCount; i++) {
+        const Client* const theClientPtr = WaitQueue::Front(mWaitQueuePtr[i]);
+        if (theClientPtr) {
+            theWaitStart = min(theWaitStart, theClientPtr->mWaitStart);
+        }
+    }
+    const int64_t theWaitUsecs = max(int64_t(0), theNowUsecs - theWaitStart);
     while (mWaitingAvgUsecsLast <= theEnd) {
         mWaitingAvgBytes = CalcWaitingAvg(mWaitingAvgBytes, mWaitingByteCount);
         mWaitingAvgCount = CalcWaitingAvg(mWaitingAvgCount, mWaitingCount);
@@ -29,6 +29,7 @@
 #include <stdint.h>
 #include "qcdio/QCDLList.h"
 #include "qcdio/QCIoBufferPool.h"
+#include "qcdio/QCDiskQueue.h"
 #include "kfsio/ITimeout.h"
 
 namespace KFS
@@ -44,6 +45,11 @@ namespace KFS
 // server as feedback chunk server "load" metric in chunk placement. The load
 // metric presently has the most effect for write append chunk placement with
 // large number of append clients in radix sort.
+//
+// Each client is assigned QoS class. When clients of more than one class are
+// waiting, the buffers are granted in weighted fair order across classes by
+// using start time fair queuing, where each class is charged with the number
+// of bytes granted divided by the class weight.
 class BufferManager : private ITimeout
 {
 public:
@@ -80,6 +86,45 @@ public:
             mOverQuotaRequestDeniedByteCount = 0;
         }
     };
+    enum { kQosClassCount = QCDiskQueue::kQosClassCount };
+    struct QosCounters
+    {
+        typedef int64_t Counter;
+
+        Counter mRequestCount;
+        Counter mRequestByteCount;
+        Counter mRequestDeniedCount;
+        Counter mRequestGrantedCount;
+        Counter mRequestGrantedByteCount;
+        Counter mRequestWaitUsecs;
+        Counter mWaitingCount;
+        Counter mWaitingByteCount;
+
+        void Clear()
+        {
+            mRequestCount            = 0;
+            mRequestByteCount        = 0;
+            mRequestDeniedCount      = 0;
+            mRequestGrantedCount     = 0;
+            mRequestGrantedByteCount = 0;
+            mRequestWaitUsecs        = 0;
+            mWaitingCount            = 0;
+            mWaitingByteCount        = 0;
+        }
+        QosCounters& Add(
+            const QosCounters& inCounters)
+        {
+            mRequestCount            += inCounters.mRequestCount;
+            mRequestByteCount        += inCounters.mRequestByteCount;
+            mRequestDeniedCount      += inCounters.mRequestDeniedCount;
+            mRequestGrantedCount     += inCounters.mRequestGrantedCount;
+            mRequestGrantedByteCount += inCounters.mRequestGrantedByteCount;
+            mRequestWaitUsecs        += inCounters.mRequestWaitUsecs;
+            mWaitingCount            += inCounters.mWaitingCount;
+            mWaitingByteCount        += inCounters.mWaitingByteCount;
+            return *this;
+        }
+    };
 
     class Client
     {
@@ -109,6 +154,18 @@ public:
                 mManagerPtr->Unregister(*this);
             }
         }
+        int GetQosClass() const
+            { return mQosClass; }
+        // The class is used by the next request. The class of the waiting
+        // request can not be changed, the change is ignored.
+        void SetQosClass(
+            int inQosClass)
+        {
+            if (0 <= inQosClass && inQosClass < kQosClassCount &&
+                    ! IsWaiting()) {
+                mQosClass = inQosClass;
+            }
+        }
     protected:
         Client();
         virtual ~Client()
@@ -120,6 +177,7 @@ public:
         ByteCount      mByteCount;
         ByteCount      mWaitingForByteCount;
         int64_t        mWaitStart;
+        int            mQosClass;
         bool           mOverQuotaWaitingFlag;
 
         inline void Reset();
@@ -173,7 +231,7 @@ public:
         const Client& inClient) const
     {
         return (
-            WaitQueue::IsInList(mWaitQueuePtr, inClient) ||
+            WaitQueue::IsInList(mWaitQueuePtr[inClient.mQosClass], inClient) ||
             WaitQueue::IsInList(mOverQuotaWaitQueuePtr, inClient)
         );
     }
@@ -222,6 +280,32 @@ public:
     void GetCounters(
         Counters& outCounters) const
         { outCounters = mCounters; }
+    void GetBufferPoolCounters(
+        QCIoBufferPool::Counters& outCounters) const
+    {
+        if (mBufferPoolPtr) {
+            mBufferPoolPtr->GetCounters(outCounters);
+        } else {
+            outCounters.Clear();
+        }
+    }
+    bool GetBufferPoolThreadCacheCounters(
+        int                       inIdx,
+        QCIoBufferPool::Counters& outCounters) const
+    {
+        if (mBufferPoolPtr) {
+            return mBufferPoolPtr->GetThreadCacheCounters(inIdx, outCounters);
+        }
+        outCounters.Clear();
+        return false;
+    }
+    void GetQosCounters(
+        int          inQosClass,
+        QosCounters& outCounters) const;
+    // Sets relative class weights, weight less than 1 is treated as 1.
+    void SetQosWeights(
+        const int* inWeightsPtr,
+        int        inCount);
     void SetDiskOverloaded(
         bool inFlag)
         { mDiskOverloadedFlag = inFlag; }
@@ -244,8 +328,12 @@ private:
     // for 2 sec resolution.
     enum { kWaitingAvgFracBits = 12 };
     enum { kWaitingAvgSampleIntervalSec = 1 };
+    // Virtual time is charged in kQosUnitShift size units, in order to keep
+    // 64 bit tags from wrapping around.
+    enum { kQosUnitShift = 12 };
+    enum { kQosCostScale = 1 << 16 };
 
-    Client*         mWaitQueuePtr[1];
+    Client*         mWaitQueuePtr[kQosClassCount][1];
     Client*         mOverQuotaWaitQueuePtr[1];
     QCIoBufferPool* mBufferPoolPtr;
     ByteCount       mTotalCount;
@@ -270,7 +358,28 @@ private:
     int64_t         mWaitingAvgCount;
     int64_t         mWaitingAvgUsecs;
     Counters        mCounters;
+    int             mQosWaitingClassCount;
+    int64_t         mQosVirtualTime;
+    int64_t         mQosCost[kQosClassCount];
+    int64_t         mQosTag[kQosClassCount];
+    QosCounters     mQosCounters[kQosClassCount];
 
+    int64_t QosStartTag(
+        int inQosClass) const
+    {
+        return (mQosVirtualTime < mQosTag[inQosClass] ?
+            mQosTag[inQosClass] : mQosVirtualTime);
+    }
+    bool QosMayGrant(
+        int inQosClass) const;
+    int QosSelect() const;
+    void QosCharge(
+        int       inQosClass,
+        ByteCount inByteCount);
+    void QosWaitAdd(
+        Client& inClient);
+    void QosWaitRemove(
+        Client& inClient);
     bool Modify(
         Client&   inClient,
         ByteCount inByteCount,
@@ -99,6 +99,15 @@ typedef ChunkList ChunkLru;
 // directory per physical disk.
 struct ChunkManager::ChunkDirInfo : public ITimeout
 {
+    enum ScrubProgressIoState
+    {
+        kScrubProgressIoNone   = 0,
+        kScrubProgressIoLoad   = 1,
+        kScrubProgressIoDelete = 2,
+        kScrubProgressIoWrite  = 3,
+        kScrubProgressIoRename = 4
+    };
+
     ChunkDirInfo()
         : ITimeout(),
           dirname(),
@@ -161,7 +170,24 @@ struct ChunkManager::ChunkDirInfo : public ITimeout
           availableChunksCb(),
           evacuateChunksOp(&evacuateChunksCb),
           availableChunksOp(&availableChunksCb),
-          chunkDirInfoOp(*this)
+          chunkDirInfoOp(*this),
+          scrubChunkIds(),
+          scrubPos(0),
+          scrubLastChunkId(-1),
+          scrubPassCount(0),
+          scrubBudget(0),
+          scrubCheckpointTime(0),
+          scrubByteCount(0),
+          scrubErrorCount(0),
+          scrubInFlightFlag(false),
+          scrubProgressLoadedFlag(false),
+          scrubProgressDirtyFlag(false),
+          scrubProgressIoState(kScrubProgressIoNone),
+          scrubProgressSize(0),
+          scrubProgressFile(),
+          scrubProgressIo(),
+          scrubCb(),
+          scrubProgressCb()
     {
         fsSpaceAvailCb.SetHandler(this,
             &ChunkDirInfo::FsSpaceAvailDone);
@@ -175,6 +201,10 @@ struct ChunkManager::ChunkDirInfo : public ITimeout
             &ChunkDirInfo::RenameEvacuateFileDone);
         availableChunksCb.SetHandler(this,
             &ChunkDirInfo::AvailableChunksDone);
+        scrubCb.SetHandler(this,
+            &ChunkDirInfo::ScrubDone);
+        scrubProgressCb.SetHandler(this,
+            &ChunkDirInfo::ScrubProgressIoDone);
         for (int i = 0; i < kChunkDirListCount; i++) {
             ChunkList::Init(chunkLists[i]);
             ChunkDirList::Init(chunkLists[i]);
@@ -194,6 +224,40 @@ struct ChunkManager::ChunkDirInfo : public ITimeout
     void DiskError(int sysErr);
     int EvacuateChunksDone(int code, void* data);
     int AvailableChunksDone(int code, void* data);
+    int ScrubDone(int code, void* data)
+    {
+        GetChunkMetadataOp* const op =
+            reinterpret_cast<GetChunkMetadataOp*>(data);
+        if (code != EVENT_CMD_DONE || ! op || ! scrubInFlightFlag) {
+            die("scrub: invalid completion");
+            return -1;
+        }
+        gChunkManager.ScrubDone(*this, *op);
+        return 0;
+    }
+    int ScrubProgressIoDone(int code, void* data)
+    {
+        if (scrubProgressIoState == kScrubProgressIoNone) {
+            die("scrub progress: invalid completion");
+            return -1;
+        }
+        gChunkManager.ScrubProgressIoDone(*this, code, data);
+        return 0;
+    }
+    // Cancel progress file read or write. Delete and rename completions
+    // cannot be canceled, and are ignored once the directory is stopped.
+    void CancelScrubProgressIo()
+    {
+        scrubProgressIo.reset();
+        if (scrubProgressFile) {
+            scrubProgressFile->Close();
+            scrubProgressFile.reset();
+        }
+        if (scrubProgressIoState == kScrubProgressIoLoad ||
+                scrubProgressIoState == kScrubProgressIoWrite) {
+            scrubProgressIoState = kScrubProgressIoNone;
+        }
+    }
     void ScheduleEvacuate(int maxChunkCount = -1);
     void RestartEvacuation();
     void NotifyAvailableChunks(bool tmeoutFlag = false);
@@ -262,6 +326,12 @@ struct ChunkManager::ChunkDirInfo : public ITimeout
         evacuateStartByteCount         = -1;
         notifyAvailableChunksStartFlag = false;
         availableChunks.Clear();
+        scrubChunkIds.clear();
+        scrubPos                       = 0;
+        scrubBudget                    = 0;
+        scrubProgressLoadedFlag        = false;
+        scrubProgressDirtyFlag         = false;
+        CancelScrubProgressIo();
         if (timeoutPendingFlag) {
             timeoutPendingFlag = false;
             globalNetManager().UnRegisterTimeoutHandler(this);
@@ -617,6 +687,9 @@ struct ChunkManager::ChunkDirInfo : public ITimeout
             "Canceled-count: "        << ctrs.mReqeustCanceledCount  << "\r\n"
             "Canceled-bytes: "        << ctrs.mReqeustCanceledBytes  << "\r\n"
             "File-system-id: "        << mChunkDir.fileSystemId << "\r\n"
+            "Scrub-bytes: "           << mChunkDir.scrubByteCount << "\r\n"
+            "Scrub-errors: "          << mChunkDir.scrubErrorCount << "\r\n"
+            "Scrub-passes: "          << mChunkDir.scrubPassCount << "\r\n"
             ;
             mChunkDir.readCounters.Display(
                 "Read-",         "\r\n", inStream);
@@ -716,6 +789,23 @@ struct ChunkManager::ChunkDirInfo : public ITimeout
     EvacuateChunksOp       evacuateChunksOp;
     AvailableChunksOp      availableChunksOp;
     ChunkDirInfoOp         chunkDirInfoOp;
+    vector<kfsChunkId_t>   scrubChunkIds;
+    size_t                 scrubPos;
+    kfsChunkId_t           scrubLastChunkId;
+    int64_t                scrubPassCount;
+    int64_t                scrubBudget;
+    time_t                 scrubCheckpointTime;
+    int64_t                scrubByteCount;
+    int64_t                scrubErrorCount;
+    bool                   scrubInFlightFlag;
+    bool                   scrubProgressLoadedFlag;
+    bool                   scrubProgressDirtyFlag;
+    ScrubProgressIoState   scrubProgressIoState;
+    int                    scrubProgressSize;
+    DiskIo::FilePtr        scrubProgressFile;
+    DiskIoPtr              scrubProgressIo;
+    KfsCallbackObj         scrubCb;
+    KfsCallbackObj         scrubProgressCb;
 
     enum ChunkListType
     {
@@ -860,6 +950,8 @@ public:
           dataFH(),
           lastIOTime(0),
           readChunkMetaOp(0),
+          writeTail(),
+          writeTailOffset(-1),
           mBeingReplicatedFlag(false),
           mDeleteFlag(false),
           mWriteAppenderOwnsFlag(false),
@@ -890,6 +982,7 @@ public:
         assert(mChunkDir.chunkCount > 0);
     }
     void Delete(ChunkLists* chunkInfoLists) {
+        gChunkManager.ClearWriteTail(*this);
         const bool evacuateFlag = IsEvacuate();
         ChunkList::Remove(chunkInfoLists[mChunkList], *this);
         DetachFromChunkDir(evacuateFlag);
@@ -956,6 +1049,10 @@ public:
     time_t           lastIOTime;
     /// keep track of the op that is doing the read
     ReadChunkMetaOp* readChunkMetaOp;
+    /// copy of the last partial checksum block written by append, used by
+    /// the next append instead of reading the block from disk
+    IOBuffer         writeTail;
+    int64_t          writeTailOffset;
 
     void Release(ChunkLists* chunkInfoLists);
     bool IsFileOpen() const {
@@ -1684,6 +1781,7 @@ ChunkManager::DeleteSelf(ChunkInfoHandle& cih)
 {
     if (0 <= cih.chunkInfo.chunkVersion) {
         HelloNotifyRemove(cih);
+        mReadCache.Invalidate(cih.chunkInfo.chunkId);
     }
     cih.Delete(mChunkInfoLists);
 }
@@ -1709,6 +1807,7 @@ ChunkManager::RemoveFromChunkTable(ChunkInfoHandle& cih)
     if (mChunkTable.Erase(cih.chunkInfo.chunkId) <= 0) {
         return false;
     }
+    mReadCache.Invalidate(cih.chunkInfo.chunkId);
     HelloNotifyRemove(cih);
     return true;
 }
@@ -1767,6 +1866,7 @@ ChunkManager::MakeStale(ChunkInfoHandle& cih,
 void
 ChunkInfoHandle::Release(ChunkInfoHandle::ChunkLists* chunkInfoLists)
 {
+    gChunkManager.ClearWriteTail(*this);
     chunkInfo.UnloadChecksums();
     if (! IsFileOpen()) {
         if (dataFH) {
@@ -2131,6 +2231,18 @@ ChunkManager::ChunkManager()
       mCheckDirWritableFlag(true),
       mCheckDirTestWriteSize(16 << 10),
       mCheckDirWritableTmpFileName("checkdir.tmp"),
+      mWriteTailCacheMaxSize(32 << 20),
+      mReadCacheMaxSize(0),
+      mReadCacheBufferPoolRatio(0.25),
+      mReadCacheSizeSetFlag(false),
+      mReadCache((int)CHECKSUM_BLOCKSIZE),
+      mScrubBytesPerSec(0),
+      mScrubIdleQueueOnlyFlag(true),
+      mScrubCheckpointIntervalSecs(300),
+      mScrubProgressFileName("scrub.progress"),
+      mScrubLastTime(0),
+      mScrubRateStartTime(0),
+      mScrubRateStartBytes(0),
       mNullBlockChecksum(0),
       mCounters(),
       mDirChecker(),
@@ -2334,6 +2446,11 @@ ChunkManager::Shutdown()
     RunIoCompletion(mChunkTable);
     gClientManager.Shutdown();
     Replicator::Shutdown();
+    for (ChunkDirs::iterator it = mChunkDirs.begin();
+            it < mChunkDirs.end();
+            ++it) {
+        it->CancelScrubProgressIo();
+    }
     for (int i = 0; i < 256; i++) {
         DiskIo::RunIoCompletion();
         gClientManager.Shutdown();
@@ -2477,6 +2594,28 @@ ChunkManager::SetParameters(const Properties& prop)
     if (mCheckDirWritableTmpFileName.empty()) {
         mCheckDirWritableTmpFileName = "checkdir.tmp";
     }
+    mWriteTailCacheMaxSize = prop.getValue(
+        "chunkServer.writeTailCacheMaxSize",
+        mWriteTailCacheMaxSize);
+    mReadCacheMaxSize = prop.getValue(
+        "chunkServer.readCache.maxSize",
+        mReadCacheMaxSize);
+    mReadCacheBufferPoolRatio = max(double(0.0), min(double(0.9), prop.getValue(
+        "chunkServer.readCache.bufferPoolRatio",
+        mReadCacheBufferPoolRatio)));
+    mReadCacheSizeSetFlag = false;
+    mScrubBytesPerSec = prop.getValue(
+        "chunkServer.scrubber.bytesPerSec",
+        mScrubBytesPerSec);
+    mScrubIdleQueueOnlyFlag = prop.getValue(
+        "chunkServer.scrubber.idleQueueOnly",
+        mScrubIdleQueueOnlyFlag ? 1 : 0) != 0;
+    mScrubCheckpointIntervalSecs = prop.getValue(
+        "chunkServer.scrubber.checkpointIntervalSec",
+        mScrubCheckpointIntervalSecs);
+    mScrubProgressFileName = prop.getValue(
+        "chunkServer.scrubber.progressFileName",
+        mScrubProgressFileName);
     mEvacuateFileName = prop.getValue(
         "chunkServer.evacuateFileName",
         mEvacuateFileName);
@@ -2519,6 +2658,17 @@ ChunkManager::SetParameters(const Properties& prop)
         netManager.GetResolverCacheExpiration());
     netManager.SetResolverParameters(
         useOsResolverFlag, maxCacheSize, resolverCacheExpiration);
+    netManager.SetResolverCacheParameters(
+        prop.getValue(
+            "chunkServer.resolverNegativeCacheExpiration",
+            netManager.GetResolverNegativeCacheExpiration()),
+        prop.getValue(
+            "chunkServer.resolverCacheRefreshAhead",
+            netManager.GetResolverCacheRefreshAhead()),
+        prop.getValue(
+            "chunkServer.resolverThreadCount",
+            netManager.GetResolverThreadCount())
+    );
 
     DiskIo::SetParameters(prop);
     Replicator::SetParameters(prop);
@@ -2551,6 +2701,9 @@ ChunkManager::SetParameters(const Properties& prop)
     if (! mCheckDirWritableTmpFileName.empty()) {
         names.insert(mCheckDirWritableTmpFileName);
     }
+    if (! mScrubProgressFileName.empty()) {
+        names.insert(mScrubProgressFileName);
+    }
     mDirChecker.SetIgnoreFileNames(names);
 
     gAtomicRecordAppendManager.SetParameters(prop);
@@ -3795,6 +3948,8 @@ ChunkManager::TruncateChunk(kfsChunkId_t chunkId, int64_t chunkSize)
     }
     ChunkInfoHandle* const cih = *ci;
     string const chunkPathname = MakeChunkPathname(cih);
+    ClearWriteTail(*cih);
+    mReadCache.Invalidate(chunkId);
 
     // Cnunk close will truncate it to the cih->chunkInfo.chunkSize
 
@@ -3968,6 +4123,9 @@ ChunkManager::ChangeChunkVers(
         " -> "      << stableFlag <<
         " file: "   << MakeChunkPathname(cih) <<
     KFS_LOG_EOM;
+    if (0 <= cih->chunkInfo.chunkVersion) {
+        mReadCache.Invalidate(cih->chunkInfo.chunkId);
+    }
     if (! mPendingWrites.Delete(
             cih->chunkInfo.chunkId, cih->chunkInfo.chunkVersion)) {
         ostringstream os;
@@ -4640,13 +4798,6 @@ ChunkManager::ReadChunk(ReadOp* op)
         KFS_LOG_EOM;
         return -EBADVERS;
     }
-    DiskIo* const d = SetupDiskIo(cih, op);
-    if (! d) {
-        return -ESERVERBUSY;
-    }
-
-    op->diskIo.reset(d);
-
     // schedule a read based on the chunk size
     if (op->offset >= cih->chunkInfo.chunkSize) {
         op->numBytesIO = 0;
@@ -4670,6 +4821,23 @@ ChunkManager::ReadChunk(ReadOp* op)
     if ((int64_t) (offset + numBytesIO) > cih->chunkInfo.chunkSize) {
         numBytesIO = cih->chunkInfo.chunkSize - offset;
     }
+    if (ReadFromCache(cih, op, offset, numBytesIO)) {
+        return 0;
+    }
+    DiskIo* const d = SetupDiskIo(cih, op);
+    if (! d) {
+        return -ESERVERBUSY;
+    }
+    d->SetQosClass(op->qosClass);
+    // Client reads are latency sensitive, read modify write reads are on the
+    // client write path, background scrub reads use idle disk time, and the
+    // remaining reads are background reads.
+    d->SetPriority(op->wop ? QCDiskQueue::kPriorityNormal :
+        (op->clientSMFlag ? QCDiskQueue::kPriorityHigh :
+        ((op->scrubOp && op->scrubOp->backgroundScrubFlag) ?
+            QCDiskQueue::kPriorityIdle : QCDiskQueue::kPriorityLow)));
+
+    op->diskIo.reset(d);
     op->diskIOTime = microseconds();
     const int ret = op->diskIo->Read(
         offset + cih->chunkInfo.GetHeaderSize(), numBytesIO);
@@ -4694,6 +4862,9 @@ ChunkManager::WriteChunk(WriteOp* op, const DiskIo::FilePtr* filePtr /* = 0 */)
     if (filePtr && *filePtr != cih->dataFH) {
         return -EINVAL;
     }
+    if (0 <= cih->chunkInfo.chunkVersion) {
+        mReadCache.Invalidate(cih->chunkInfo.chunkId);
+    }
     // the checksums should be loaded...
     cih->chunkInfo.VerifyChecksumsLoaded();
 
@@ -4736,6 +4907,10 @@ ChunkManager::WriteChunk(WriteOp* op, const DiskIo::FilePtr* filePtr /* = 0 */)
             op->statusMsg = "invalid request size";
             return -EINVAL;
         }
+        if (offset <= cih->writeTailOffset &&
+                cih->writeTailOffset < offset + numBytesIO) {
+            ClearWriteTail(*cih);
+        }
         if (op->wpop && ! op->isFromReReplication &&
                 op->checksums.size() ==
                     (size_t)(numBytesIO / CHECKSUM_BLOCKSIZE)) {
@@ -4773,11 +4948,28 @@ ChunkManager::WriteChunk(WriteOp* op, const DiskIo::FilePtr* filePtr /* = 0 */)
             data.ReplaceKeepBuffersFull(&op->dataBuf, off, numBytesIO);
             data.ZeroFill(blkSize - (off + numBytesIO));
             op->dataBuf.Move(&data);
+        } else if (! op->rop && cih->writeTailOffset == offset - off &&
+                (blkSize <= CHECKSUM_BLOCKSIZE || cih->chunkInfo.chunkSize <=
+                    offset - off + (int64_t)CHECKSUM_BLOCKSIZE)) {
+            // The previous append retained the checksum block, and the
+            // following block, if any, is beyond the end of chunk.
+            mCounters.mWriteTailHitCount++;
+            IOBuffer data;
+            for (IOBuffer::iterator it = cih->writeTail.begin();
+                    it != cih->writeTail.end(); ++it) {
+                data.CopyIn(it->Consumer(), it->BytesConsumable());
+            }
+            data.ReplaceKeepBuffersFull(&op->dataBuf, off, numBytesIO);
+            ZeroPad(&data);
+            op->dataBuf.Clear();
+            op->dataBuf.Move(&data);
         } else {
             // Need to read the data block over which the checksum is
             // computed.
             if (! op->rop) {
                 // issue a read
+                mCounters.mWriteTailMissCount++;
+                ClearWriteTail(*cih);
                 ReadOp* const rop = new ReadOp(op, offset - off, blkSize);
                 KFS_LOG_STREAM_DEBUG <<
                     "write triggered a read for offset=" << offset <<
@@ -4823,6 +5015,14 @@ ChunkManager::WriteChunk(WriteOp* op, const DiskIo::FilePtr* filePtr /* = 0 */)
 
         assert(op->dataBuf.BytesConsumable() == (int) blkSize);
         op->checksums = ComputeChecksums(&op->dataBuf, blkSize);
+        if (cih->chunkInfo.chunkSize <= offset + numBytesIO &&
+                (offset + numBytesIO) % CHECKSUM_BLOCKSIZE != 0) {
+            SetWriteTail(cih, offset - off + blkSize - CHECKSUM_BLOCKSIZE,
+                op->dataBuf, blkSize - CHECKSUM_BLOCKSIZE);
+        } else if (offset - off <= cih->writeTailOffset &&
+                cih->writeTailOffset < offset - off + blkSize) {
+            ClearWriteTail(*cih);
+        }
 
         // Trim data at the buffer boundary from the beginning, to make write
         // offset close to where we were asked from.
@@ -4837,6 +5037,10 @@ ChunkManager::WriteChunk(WriteOp* op, const DiskIo::FilePtr* filePtr /* = 0 */)
     if (! d) {
         return -ESERVERBUSY;
     }
+    d->SetQosClass(op->qosClass);
+    // Replication and recovery writes pass the file explicitly.
+    d->SetPriority(filePtr ?
+        QCDiskQueue::kPriorityLow : QCDiskQueue::kPriorityNormal);
     op->diskIo.reset(d);
     op->diskIOTime = microseconds();
     int res = op->diskIo->Write(
@@ -4849,12 +5053,53 @@ ChunkManager::WriteChunk(WriteOp* op, const DiskIo::FilePtr* filePtr /* = 0 */)
         cih->StartWrite(op);
     } else {
         op->diskIo.reset();
+        ClearWriteTail(*cih);
         cih->WriteStats(res, numBytesIO, 0);
         ReportIOFailure(cih, res);
     }
     return res;
 }
 
+void
+ChunkManager::SetWriteTail(ChunkInfoHandle* cih, int64_t blockOffset,
+    const IOBuffer& buf, int pos)
+{
+    ClearWriteTail(*cih);
+    if (mWriteTailCacheMaxSize <
+            mCounters.mWriteTailCacheSize + (int64_t)CHECKSUM_BLOCKSIZE) {
+        return;
+    }
+    // Copy the data, as the write buffers are owned by the disk io until
+    // the write completes.
+    int rem = (int)CHECKSUM_BLOCKSIZE;
+    for (IOBuffer::iterator it = buf.begin();
+            it != buf.end() && 0 < rem; ++it) {
+        const int nb = it->BytesConsumable();
+        if (nb <= pos) {
+            pos -= nb;
+            continue;
+        }
+        const int len = min(nb - pos, rem);
+        cih->writeTail.CopyIn(it->Consumer() + pos, len);
+        rem -= len;
+        pos = 0;
+    }
+    assert(0 == rem);
+    cih->writeTailOffset = blockOffset;
+    mCounters.mWriteTailCacheSize += cih->writeTail.BytesConsumable();
+}
+
+void
+ChunkManager::ClearWriteTail(ChunkInfoHandle& cih)
+{
+    if (cih.writeTailOffset < 0) {
+        return;
+    }
+    mCounters.mWriteTailCacheSize -= cih.writeTail.BytesConsumable();
+    cih.writeTail.Clear();
+    cih.writeTailOffset = -1;
+}
+
 void
 ChunkManager::UpdateChecksums(ChunkInfoHandle *cih, WriteOp *op)
 {
@@ -4899,6 +5144,9 @@ ChunkManager::WriteDone(WriteOp* op)
         return;
     }
     op->diskIOTime = max(int64_t(1), microseconds() - op->diskIOTime);
+    if (op->status < 0) {
+        ClearWriteTail(*cih);
+    }
     cih->WriteDone(op);
 }
 
@@ -5216,6 +5464,7 @@ ChunkManager::ReadChunkDone(ReadOp* op)
         // for checksums to verify, we did reads in multiples of
         // checksum block sizes.  so, get rid of the extra
         cih->ReadStats(op->status, readLen, op->diskIOTime);
+        AddToReadCache(cih, op);
         AdjustDataRead(op);
         return true;
     }
@@ -5516,6 +5765,476 @@ ChunkManager::AdjustDataRead(ReadOp *op)
     op->dataBuf.Trim(op->numBytesIO);
 }
 
+void
+ChunkManager::Scrub(time_t now)
+{
+    const int64_t elapsed = min(int64_t(10),
+        max(int64_t(0), (int64_t)(now - mScrubLastTime)));
+    mScrubLastTime = now;
+    if (mScrubBytesPerSec <= 0) {
+        return;
+    }
+    if (mScrubRateStartTime + 60 <= now) {
+        if (0 < mScrubRateStartTime) {
+            mCounters.mScrubBytesPerSec =
+                (mCounters.mScrubByteCount - mScrubRateStartBytes) /
+                (int64_t)(now - mScrubRateStartTime);
+        }
+        mScrubRateStartTime  = now;
+        mScrubRateStartBytes = mCounters.mScrubByteCount;
+    }
+    for (ChunkDirs::iterator it = mChunkDirs.begin();
+            it != mChunkDirs.end();
+            ++it) {
+        ChunkDirInfo& dir = *it;
+        if (dir.availableSpace < 0 || ! dir.diskQueue) {
+            continue;
+        }
+        if (! dir.scrubProgressLoadedFlag) {
+            if (dir.scrubProgressIoState ==
+                    ChunkDirInfo::kScrubProgressIoNone) {
+                LoadScrubProgress(dir);
+            }
+            if (! dir.scrubProgressLoadedFlag) {
+                continue; // Wait for the progress file read completion.
+            }
+        }
+        if (dir.scrubProgressDirtyFlag &&
+                dir.scrubProgressIoState ==
+                    ChunkDirInfo::kScrubProgressIoNone &&
+                dir.scrubCheckpointTime + mScrubCheckpointIntervalSecs <=
+                    now) {
+            SaveScrubProgress(dir, now);
+        }
+        dir.scrubBudget = min(mScrubBytesPerSec,
+            dir.scrubBudget + elapsed * mScrubBytesPerSec);
+        if (dir.scrubInFlightFlag || dir.scrubBudget <= 0) {
+            continue;
+        }
+        if (mScrubIdleQueueOnlyFlag) {
+            int     freeRequestCount = 0;
+            int     requestCount     = 0;
+            int64_t readBlockCount   = 0;
+            int64_t writeBlockCount  = 0;
+            int     blockSize        = 0;
+            if (! DiskIo::GetDiskQueuePendingCount(
+                    dir.diskQueue,
+                    freeRequestCount,
+                    requestCount,
+                    readBlockCount,
+                    writeBlockCount,
+                    blockSize) || 0 < requestCount) {
+                continue;
+            }
+        }
+        StartScrub(dir);
+    }
+}
+
+bool
+ChunkManager::StartScrub(ChunkDirInfo& dir)
+{
+    if (dir.scrubChunkIds.size() <= dir.scrubPos) {
+        // Take a snapshot of the directory chunk ids, in order to resume the
+        // pass from the last scrubbed chunk, or start the next pass.
+        bool passDoneFlag = ! dir.scrubChunkIds.empty();
+        for (int i = 0; i < 2; i++) {
+            if (passDoneFlag) {
+                dir.scrubPassCount++;
+                mCounters.mScrubPassCount++;
+                dir.scrubLastChunkId       = -1;
+                dir.scrubProgressDirtyFlag = true;
+                KFS_LOG_STREAM_INFO <<
+                    "scrub: " << dir.dirname <<
+                    " pass: "   << dir.scrubPassCount << " done" <<
+                    " bytes: "  << dir.scrubByteCount <<
+                    " errors: " << dir.scrubErrorCount <<
+                KFS_LOG_EOM;
+            }
+            dir.scrubChunkIds.clear();
+            dir.scrubPos = 0;
+            for (int k = 0; k < ChunkDirInfo::kChunkDirListCount; k++) {
+                ChunkDirList::Iterator it(dir.chunkLists[k]);
+                const ChunkInfoHandle* cih;
+                while ((cih = it.Next())) {
+                    if (dir.scrubLastChunkId < cih->chunkInfo.chunkId) {
+                        dir.scrubChunkIds.push_back(cih->chunkInfo.chunkId);
+                    }
+                }
+            }
+            if (! dir.scrubChunkIds.empty() || dir.scrubLastChunkId < 0) {
+                break;
+            }
+            passDoneFlag = true;
+        }
+        sort(dir.scrubChunkIds.begin(), dir.scrubChunkIds.end());
+    }
+    while (dir.scrubPos < dir.scrubChunkIds.size()) {
+        const kfsChunkId_t      chunkId = dir.scrubChunkIds[dir.scrubPos++];
+        ChunkInfoHandle** const ci      = mChunkTable.Find(chunkId);
+        ChunkInfoHandle*  const cih     = ci ? *ci : 0;
+        if (! cih || &cih->GetDirInfo() != &dir || ! IsChunkStable(cih) ||
+                ! cih->IsChunkReadable() || cih->IsRenameInFlight()) {
+            // Deleted, moved, or not stable, skip.
+            dir.scrubLastChunkId       = chunkId;
+            dir.scrubProgressDirtyFlag = true;
+            continue;
+        }
+        GetChunkMetadataOp* const op = new GetChunkMetadataOp();
+        op->chunkId             = chunkId;
+        op->readVerifyFlag      = true;
+        op->backgroundScrubFlag = true;
+        op->clnt                = &dir.scrubCb;
+        dir.scrubInFlightFlag = true;
+        op->Execute();
+        return true;
+    }
+    return false;
+}
+
+void
+ChunkManager::ScrubDone(ChunkDirInfo& dir, GetChunkMetadataOp& op)
+{
+    dir.scrubInFlightFlag = false;
+    const int64_t bytes = op.numBytesScrubbed;
+    dir.scrubByteCount += bytes;
+    mCounters.mScrubByteCount += bytes;
+    mCounters.mScrubChunkCount++;
+    dir.scrubBudget -= max(bytes, int64_t(KFS_CHUNK_HEADER_SIZE));
+    if (op.status == -ESERVERBUSY) {
+        // Out of io buffers or file descriptors, retry later.
+        if (0 < dir.scrubPos && dir.scrubPos <= dir.scrubChunkIds.size() &&
+                dir.scrubChunkIds[dir.scrubPos - 1] == op.chunkId) {
+            dir.scrubPos--;
+        }
+        delete &op;
+        return;
+    }
+    // Chunk deletion, version change, or chunk close can race with scrub,
+    // all other errors are disk io or checksum mismatch errors. The chunk
+    // read path reports such chunks to the meta server as corrupt.
+    if (op.status < 0 && op.status != -EBADF && op.status != -EBADVERS &&
+            op.status != -EAGAIN) {
+        dir.scrubErrorCount++;
+        mCounters.mScrubErrorCount++;
+        KFS_LOG_STREAM_ERROR <<
+            "scrub: " << dir.dirname <<
+            " chunk: "   << op.chunkId <<
+            " version: " << op.chunkVersion <<
+            " status: "  << op.status <<
+            " "          << op.statusMsg <<
+        KFS_LOG_EOM;
+    }
+    dir.scrubLastChunkId       = op.chunkId;
+    dir.scrubProgressDirtyFlag = true;
+    delete &op;
+}
+
+// The progress file is read and written by the directory io queue threads
+// the same way as the chunk files: the file is opened, read or written, and
+// closed asynchronously, and deleted and renamed with the queue's meta
+// requests.
+void
+ChunkManager::LoadScrubProgress(ChunkDirInfo& dir)
+{
+    dir.scrubProgressLoadedFlag = false;
+    dir.scrubProgressDirtyFlag  = false;
+    dir.scrubChunkIds.clear();
+    dir.scrubPos                = 0;
+    dir.scrubLastChunkId        = -1;
+    dir.scrubCheckpointTime     = globalNetManager().Now();
+    if (mScrubProgressFileName.empty() ||
+            0 < DiskIo::GetMinWriteBlkSize(dir.diskQueue)) {
+        dir.scrubProgressLoadedFlag = true;
+        return;
+    }
+    const string name = dir.dirname + mScrubProgressFileName;
+    if (StartScrubProgressIo(dir, name, ChunkDirInfo::kScrubProgressIoLoad,
+            kScrubProgressMaxSize)) {
+        const ssize_t res = dir.scrubProgressIo->Read(0, kScrubProgressMaxSize);
+        if (0 < res) {
+            return;
+        }
+        KFS_LOG_STREAM_ERROR <<
+            "scrub: failed to read " << name <<
+            " error: " << QCUtils::SysError((int)-res) <<
+        KFS_LOG_EOM;
+        dir.CancelScrubProgressIo();
+    }
+    dir.scrubProgressLoadedFlag = true;
+}
+
+void
+ChunkManager::SaveScrubProgress(ChunkDirInfo& dir, time_t now)
+{
+    dir.scrubCheckpointTime    = now;
+    dir.scrubProgressDirtyFlag = false;
+    if (mScrubProgressFileName.empty() ||
+            0 < DiskIo::GetMinWriteBlkSize(dir.diskQueue)) {
+        return;
+    }
+    // Remove the temporary file left by the previous failed save, if any,
+    // prior to creating it, then write, close, and rename it.
+    const string tmp = dir.dirname + mScrubProgressFileName + ".tmp";
+    string       errMsg;
+    dir.scrubProgressIoState = ChunkDirInfo::kScrubProgressIoDelete;
+    if (! DiskIo::Delete(tmp.c_str(), &dir.scrubProgressCb, &errMsg)) {
+        dir.scrubProgressIoState   = ChunkDirInfo::kScrubProgressIoNone;
+        dir.scrubProgressDirtyFlag = true;
+        KFS_LOG_STREAM_ERROR <<
+            "scrub: failed to delete " << tmp << " " << errMsg <<
+        KFS_LOG_EOM;
+    }
+}
+
+bool
+ChunkManager::StartScrubProgressIo(ChunkDirInfo& dir, const string& name,
+    int state, int64_t maxSize)
+{
+    const bool readOnlyFlag = state == ChunkDirInfo::kScrubProgressIoLoad;
+    string     errMsg;
+    dir.scrubProgressFile.reset(new DiskIo::File());
+    if (! dir.scrubProgressFile->Open(
+            name.c_str(),
+            maxSize,
+            readOnlyFlag,
+            false,         // inReserveFileSpaceFlag
+            ! readOnlyFlag,
+            &errMsg,
+            0,             // inRetryFlagPtr
+            mBufferedIoFlag || dir.bufferedIoFlag)) {
+        dir.scrubProgressFile.reset();
+        KFS_LOG_STREAM_ERROR <<
+            "scrub: failed to open " << name << " " << errMsg <<
+        KFS_LOG_EOM;
+        return false;
+    }
+    dir.scrubProgressIo.reset(
+        new DiskIo(dir.scrubProgressFile, &dir.scrubProgressCb));
+    dir.scrubProgressIoState = (ChunkDirInfo::ScrubProgressIoState)state;
+    return true;
+}
+
+void
+ChunkManager::ScrubProgressIoDone(ChunkDirInfo& dir, int code, void* data)
+{
+    const ChunkDirInfo::ScrubProgressIoState state = dir.scrubProgressIoState;
+    const string name = dir.dirname + mScrubProgressFileName;
+    const string tmp  = name + ".tmp";
+    int          err  = 0;
+    if (code == EVENT_DISK_ERROR) {
+        err = data ? *reinterpret_cast<const int*>(data) : -EIO;
+        if (0 <= err) {
+            err = -EIO;
+        }
+    }
+    if (state == ChunkDirInfo::kScrubProgressIoLoad) {
+        if (code == EVENT_DISK_READ) {
+            IOBuffer* const buf = reinterpret_cast<IOBuffer*>(data);
+            char            tmpBuf[kScrubProgressMaxSize];
+            const int       len  = buf ?
+                buf->CopyOut(tmpBuf, kScrubProgressMaxSize) : 0;
+            istringstream   is(string(tmpBuf, len));
+            kfsChunkId_t    chunkId   = -1;
+            int64_t         passCount = 0;
+            if (is >> chunkId >> passCount) {
+                dir.scrubLastChunkId = chunkId;
+                dir.scrubPassCount   = max(dir.scrubPassCount, passCount);
+                KFS_LOG_STREAM_INFO <<
+                    "scrub: " << dir.dirname <<
+                    " resuming pass: " << dir.scrubPassCount <<
+                    " after chunk: "   << chunkId <<
+                KFS_LOG_EOM;
+            }
+        } else if (code == EVENT_DISK_ERROR) {
+            // No progress file prior to the first save.
+            KFS_LOG_STREAM(err == -ENOENT ?
+                    MsgLogger::kLogLevelDEBUG : MsgLogger::kLogLevelERROR) <<
+                "scrub: failed to read " << name <<
+                " error: " << QCUtils::SysError(-err) <<
+            KFS_LOG_EOM;
+        } else {
+            die("scrub progress: invalid read completion");
+        }
+        dir.CancelScrubProgressIo();
+        dir.scrubProgressLoadedFlag = true;
+        return;
+    }
+    if (dir.availableSpace < 0 || ! dir.diskQueue ||
+            ! globalNetManager().IsRunning()) {
+        // Directory stopped, or shutdown in progress.
+        dir.CancelScrubProgressIo();
+        dir.scrubProgressIoState = ChunkDirInfo::kScrubProgressIoNone;
+        return;
+    }
+    if (state == ChunkDirInfo::kScrubProgressIoDelete) {
+        if (code != EVENT_DISK_DELETE_DONE && code != EVENT_DISK_ERROR) {
+            die("scrub progress: invalid delete completion");
+        }
+        if (err == -ENOENT) {
+            err = 0;
+        }
+        if (err == 0) {
+            // Write the io buffer block, and truncate the file on close.
+            ostringstream os;
+            os << dir.scrubLastChunkId << " " << dir.scrubPassCount << "\n";
+            const string progress = os.str();
+            IOBuffer     buf;
+            buf.CopyIn(progress.data(), (int)progress.size());
+            buf.ZeroFillLast();
+            dir.scrubProgressSize = (int)progress.size();
+            if (StartScrubProgressIo(dir, tmp,
+                    ChunkDirInfo::kScrubProgressIoWrite,
+                    buf.BytesConsumable())) {
+                const ssize_t res = dir.scrubProgressIo->Write(
+                    0, buf.BytesConsumable(), &buf, true);
+                if (0 < res) {
+                    return;
+                }
+                err = (int)res;
+            } else {
+                err = -EIO;
+            }
+        }
+    } else if (state == ChunkDirInfo::kScrubProgressIoWrite) {
+        if (code != EVENT_DISK_WROTE && code != EVENT_DISK_ERROR) {
+            die("scrub progress: invalid write completion");
+        }
+        dir.scrubProgressIo.reset();
+        string errMsg;
+        if (! dir.scrubProgressFile->Close(
+                err == 0 ? dir.scrubProgressSize : -1, &errMsg) &&
+                err == 0) {
+            err = -EIO;
+        }
+        dir.scrubProgressFile.reset();
+        if (err == 0) {
+            dir.scrubProgressIoState = ChunkDirInfo::kScrubProgressIoRename;
+            if (DiskIo::Rename(tmp.c_str(), name.c_str(),
+                    &dir.scrubProgressCb, &errMsg)) {
+                return;
+            }
+            err = -EIO;
+        }
+    } else if (state == ChunkDirInfo::kScrubProgressIoRename) {
+        if (code != EVENT_DISK_RENAME_DONE && code != EVENT_DISK_ERROR) {
+            die("scrub progress: invalid rename completion");
+        }
+    } else {
+        die("scrub progress: invalid state");
+    }
+    dir.CancelScrubProgressIo();
+    dir.scrubProgressIoState = ChunkDirInfo::kScrubProgressIoNone;
+    if (err != 0) {
+        // Retry with the next checkpoint.
+        dir.scrubProgressDirtyFlag = true;
+        KFS_LOG_STREAM_ERROR <<
+            "scrub: failed to write " << name <<
+            " error: " << QCUtils::SysError(-err) <<
+        KFS_LOG_EOM;
+    }
+}
+
+bool
+ChunkManager::IsReadCacheEnabled()
+{
+    if (! mReadCacheSizeSetFlag) {
+        const BufferManager& bufMgr = DiskIo::GetBufferManager();
+        const int64_t poolBytes = bufMgr.GetBufferPoolTotalBytes();
+        if (0 < mReadCacheMaxSize && poolBytes <= 0) {
+            return false; // Buffer pool is not initialized yet.
+        }
+        mReadCacheSizeSetFlag = true;
+        mReadCache.SetMaxSize(min(mReadCacheMaxSize,
+            (int64_t)(poolBytes * mReadCacheBufferPoolRatio)));
+        KFS_LOG_STREAM_INFO <<
+            "read cache:"
+            " max size: "    << mReadCacheMaxSize <<
+            " buffer pool: " << poolBytes <<
+            " ratio: "       << mReadCacheBufferPoolRatio <<
+            " effective: "   << mReadCache.GetMaxSize() <<
+        KFS_LOG_EOM;
+    }
+    return mReadCache.IsEnabled();
+}
+
+bool
+ChunkManager::ReadFromCache(ChunkInfoHandle* cih, ReadOp* op,
+    int64_t offset, size_t numBytesIO)
+{
+    // Only client reads of stable chunks use the cache. Do not attempt to
+    // serve checksum mismatch re-reads, as these are issued from the read
+    // completion.
+    if (! op->clientSMFlag || op->wop || 0 < op->retryCnt ||
+            cih->chunkInfo.chunkVersion < 0 || ! IsChunkStable(cih) ||
+            ! IsReadCacheEnabled()) {
+        return false;
+    }
+    const int blockIdx   = (int)OffsetToChecksumBlockNum(offset);
+    const int blockCount = (int)((numBytesIO + CHECKSUM_BLOCKSIZE - 1) /
+        CHECKSUM_BLOCKSIZE);
+    if (! mReadCache.Get(cih->chunkInfo.chunkId, cih->chunkInfo.chunkVersion,
+            blockIdx, blockCount, op->dataBuf)) {
+        return false;
+    }
+    const uint32_t* const checksums =
+        cih->chunkInfo.chunkBlockChecksum + blockIdx;
+    op->checksum.assign(checksums, checksums + blockCount);
+    if (op->skipVerifyDiskChecksumFlag &&
+            ((op->offset % CHECKSUM_BLOCKSIZE) != 0 ||
+            ((op->offset + op->numBytesIO) % CHECKSUM_BLOCKSIZE) != 0)) {
+        // The stored checksums cover entire blocks, let read completion
+        // compute the partial blocks checksums.
+        op->skipVerifyDiskChecksumFlag = false;
+    }
+    op->diskIOTime = 0;
+    AdjustDataRead(op);
+    op->status = op->numBytesIO;
+    // Invoke read completion directly: the data is already verified, and
+    // there is no disk io to complete.
+    op->HandleEvent(EVENT_CMD_DONE, 0);
+    return true;
+}
+
+void
+ChunkManager::AddToReadCache(ChunkInfoHandle* cih, ReadOp* op)
+{
+    if (! op->clientSMFlag || op->wop ||
+            cih->chunkInfo.chunkVersion < 0 || ! IsChunkStable(cih) ||
+            ! IsReadCacheEnabled()) {
+        return;
+    }
+    if (DiskIo::GetBufferManager().IsLowOnBuffers()) {
+        // Return buffers to the pool.
+        mReadCache.Shrink(mReadCache.GetSize() / 2);
+        return;
+    }
+    IOBuffer buf;
+    buf.Copy(&op->dataBuf, op->dataBuf.BytesConsumable());
+    for (int blockIdx = (int)OffsetToChecksumBlockNum(op->offset);
+            ! buf.IsEmpty();
+            blockIdx++) {
+        IOBuffer block;
+        block.Move(&buf, (int)CHECKSUM_BLOCKSIZE);
+        const uint32_t checksum = cih->chunkInfo.chunkBlockChecksum[blockIdx];
+        if (checksum == 0 || ! mReadCache.IsAdmissible(
+                cih->chunkInfo.chunkId, cih->chunkInfo.chunkVersion,
+                blockIdx)) {
+            continue;
+        }
+        // Blocks are verified by the read completion, unless the client
+        // requested to skip disk checksum verification. Verify such blocks
+        // only once admitted, in order to avoid the checksum computation cost
+        // on reads that do not populate the cache.
+        if (op->skipVerifyDiskChecksumFlag && checksum !=
+                ComputeBlockChecksum(&block, block.BytesConsumable())) {
+            continue;
+        }
+        mReadCache.Put(cih->chunkInfo.chunkId,
+            cih->chunkInfo.chunkVersion, blockIdx, block);
+    }
+}
+
 uint32_t
 ChunkManager::GetChecksum(kfsChunkId_t chunkId, int64_t chunkVersion,
     int64_t offset)
@@ -6587,6 +7306,7 @@ ChunkManager::Timeout()
         CheckChunkDirs();
         mNextChunkDirsCheckTime = now + mChunkDirsCheckIntervalSecs;
     }
+    Scrub(now);
     if (mNextGetFsSpaceAvailableTime < now) {
         GetFsSpaceAvailable();
         mNextGetFsSpaceAvailableTime = now + mGetFsSpaceAvailableIntervalSecs;
@@ -33,6 +33,7 @@
 #include "KfsOps.h"
 #include "DiskIo.h"
 #include "DirChecker.h"
+#include "ReadCache.h"
 
 #include "kfsio/ITimeout.h"
 #include "kfsio/CryptoKeys.h"
@@ -95,6 +96,14 @@ public:
         Counter mHelloResumeCount;
         Counter mHelloResumeFailedCount;
         Counter mPartialHelloResumeFailedCount;
+        Counter mWriteTailHitCount;
+        Counter mWriteTailMissCount;
+        Counter mWriteTailCacheSize;
+        Counter mScrubChunkCount;
+        Counter mScrubByteCount;
+        Counter mScrubErrorCount;
+        Counter mScrubPassCount;
+        Counter mScrubBytesPerSec;
 
         void Clear()
         {
@@ -116,6 +125,14 @@ public:
             mHelloResumeCount                    = 0;
             mHelloResumeFailedCount              = 0;
             mPartialHelloResumeFailedCount       = 0;
+            mWriteTailHitCount                   = 0;
+            mWriteTailMissCount                  = 0;
+            mWriteTailCacheSize                  = 0;
+            mScrubChunkCount                     = 0;
+            mScrubByteCount                      = 0;
+            mScrubErrorCount                     = 0;
+            mScrubPassCount                      = 0;
+            mScrubBytesPerSec                    = 0;
         }
     };
 
@@ -366,9 +383,13 @@ public:
     inline void LruUpdate(ChunkInfoHandle& cih);
     inline bool IsInLru(const ChunkInfoHandle& cih) const;
     inline void UpdateStale(ChunkInfoHandle& cih);
+    /// Discard the cached partial checksum block of the last append.
+    void ClearWriteTail(ChunkInfoHandle& cih);
 
     void GetCounters(Counters& counters)
         { counters = mCounters; }
+    void GetReadCacheCounters(ReadCache::Counters& counters) const
+        { mReadCache.GetCounters(counters); }
 
     /// Utility function that sets up a disk connection for an
     /// I/O operation on a chunk.
@@ -464,6 +485,7 @@ public:
     int FlushStaleQueue(KfsOp& op);
     int CanStartReplicationOrRecovery(kfsChunkId_t chunkId);
     MsgLogger::LogLevel GetHeartbeatCtrsLogLevel();
+    void ScrubDone(ChunkDirInfo& dir, GetChunkMetadataOp& op);
 private:
     template<typename IDT>
     class PendingWritesT
@@ -935,6 +957,24 @@ private:
     bool mCheckDirWritableFlag;
     int64_t mCheckDirTestWriteSize;
     string mCheckDirWritableTmpFileName;
+    /// Max total size of the partial checksum blocks retained by the small
+    /// appends, in order to avoid read modify write reads.
+    int64_t mWriteTailCacheMaxSize;
+    /// Read cache of checksum verified blocks. The effective cache size is
+    /// the min of the configured max size and the buffer pool ratio.
+    int64_t   mReadCacheMaxSize;
+    double    mReadCacheBufferPoolRatio;
+    bool      mReadCacheSizeSetFlag;
+    ReadCache mReadCache;
+    /// Background scrubber: per chunk directory verification rate limit,
+    /// zero turns the scrubber off.
+    int64_t mScrubBytesPerSec;
+    bool    mScrubIdleQueueOnlyFlag;
+    int     mScrubCheckpointIntervalSecs;
+    string  mScrubProgressFileName;
+    time_t  mScrubLastTime;
+    time_t  mScrubRateStartTime;
+    int64_t mScrubRateStartBytes;
 
     uint32_t mNullBlockChecksum;
 
@@ -1056,11 +1096,37 @@ private:
     /// adjust appropriately.
     void AdjustDataRead(ReadOp *op);
 
+    /// Read cache: serve the client read from the cache if all blocks are
+    /// present, and offer blocks verified by the read completion for
+    /// admission.
+    bool IsReadCacheEnabled();
+    bool ReadFromCache(ChunkInfoHandle* cih, ReadOp* op,
+        int64_t offset, size_t numBytesIO);
+    void AddToReadCache(ChunkInfoHandle* cih, ReadOp* op);
+
+    /// Background scrubber: verify checksums of the stable chunks, one chunk
+    /// per directory at a time, in chunk id order, when the directory io
+    /// queue is idle. The progress file is read and written asynchronously
+    /// by the directory io queue.
+    enum { kScrubProgressMaxSize = 4 << 10 };
+    void Scrub(time_t now);
+    bool StartScrub(ChunkDirInfo& dir);
+    void LoadScrubProgress(ChunkDirInfo& dir);
+    void SaveScrubProgress(ChunkDirInfo& dir, time_t now);
+    bool StartScrubProgressIo(ChunkDirInfo& dir, const string& name,
+        int state, int64_t maxSize);
+    void ScrubProgressIoDone(ChunkDirInfo& dir, int code, void* data);
+
     /// Pad the buffer with sufficient 0's so that checksumming works
     /// out.
     /// @param[in/out] buffer  The buffer to be padded with 0's
     void ZeroPad(IOBuffer *buffer);
 
+    /// Retain copy of the checksum block that starts at position pos of the
+    /// write buffer, if the write ends inside this block.
+    void SetWriteTail(ChunkInfoHandle* cih, int64_t blockOffset,
+        const IOBuffer& buf, int pos);
+
     /// Given a chunkId and offset, return the checksum of corresponding
     /// "checksum block"---i.e., the 64K block that contains offset.
     uint32_t GetChecksum(kfsChunkId_t chunkId, int64_t chunkVersion,
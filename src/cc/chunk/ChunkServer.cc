@@ -60,7 +60,9 @@ ChunkServer::Init(
     bool                  ipV6OnlyFlag,
     const string&         serverIp,
     int                   threadCount,
-    int                   firstCpuIdx)
+    int                   firstCpuIdx,
+    bool                  numaAwareFlag,
+    const string&         localSocketDir)
 {
     if (clientListener.port < 0) {
         KFS_LOG_STREAM_FATAL <<
@@ -100,13 +102,21 @@ ChunkServer::Init(
                 ipV6OnlyFlag,
                 threadCount,
                 firstCpuIdx,
-                mMutex) ||
+                mMutex,
+                numaAwareFlag) ||
             gClientManager.GetPort() <= 0) {
         KFS_LOG_STREAM_FATAL <<
             "failed to bind acceptor to: " << clientListener <<
         KFS_LOG_EOM;
         return false;
     }
+    if (! localSocketDir.empty() &&
+            ! gClientManager.BindLocalAcceptor(localSocketDir)) {
+        KFS_LOG_STREAM_FATAL <<
+            "failed to bind local acceptor in: " << localSocketDir <<
+        KFS_LOG_EOM;
+        return false;
+    }
     mLocation.Reset(serverIp.c_str(), gClientManager.GetPort());
     mConfigLocation = mLocation;
     return true;
@@ -50,7 +50,9 @@ public:
         bool                  ipV6OnlyFlag,
         const string&         serverIp,
         int                   threadCount,
-        int                   firstCpuIdx);
+        int                   firstCpuIdx,
+        bool                  numaAwareFlag  = false,
+        const string&         localSocketDir = string());
     bool MainLoop(
         const vector<string>& chunkDirs,
         const Properties&     props);
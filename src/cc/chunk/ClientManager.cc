@@ -177,6 +177,7 @@ private:
 
 ClientManager::ClientManager()
     : mAcceptorPtr(0),
+      mLocalAcceptorPtr(0),
       mIoTimeoutSec(5 * 60),
       mIdleTimeoutSec(10 * 60),
       mMaxClientCount(64 << 10),
@@ -185,7 +186,8 @@ ClientManager::ClientManager()
       mCurThreadIdx(0),
       mFirstClientThreadIndex(0),
       mThreadCount(0),
-      mThreadsPtr(0)
+      mThreadsPtr(0),
+      mNumaAwareFlag(false)
 {
     mCounters.Clear();
 }
@@ -193,6 +195,7 @@ ClientManager::ClientManager()
 ClientManager::~ClientManager()
 {
     delete mAcceptorPtr;
+    delete mLocalAcceptorPtr;
     delete &mAuth;
     delete [] mThreadsPtr;
     KfsOp::SetMutex(0);
@@ -204,12 +207,15 @@ ClientManager::BindAcceptor(
     bool                  ipV6OnlyFlag,
     int                   inThreadCount,
     int                   inFirstCpuIdx,
-    QCMutex*&             outMutexPtr)
+    QCMutex*&             outMutexPtr,
+    bool                  inNumaAwareFlag)
 {
     Stop();
     delete mAcceptorPtr;
+    delete mLocalAcceptorPtr;
     delete [] mThreadsPtr;
     mAcceptorPtr = 0;
+    mLocalAcceptorPtr = 0;
     mThreadsPtr  = 0;
     mThreadCount = 0;
     const bool kBindOnlyFlag = true;
@@ -220,14 +226,35 @@ ClientManager::BindAcceptor(
         static QCMutex sOpsMutex;
         KfsOp::SetMutex(&sOpsMutex);
         mThreadsPtr  = ClientThread::CreateThreads(
-            inThreadCount, inFirstCpuIdx, outMutexPtr);
+            inThreadCount, inFirstCpuIdx, outMutexPtr, inNumaAwareFlag);
         mThreadCount = mThreadsPtr ? inThreadCount : 0;
+        mNumaAwareFlag = inNumaAwareFlag &&
+            1 < ClientThread::GetNumaNodeCount();
     } else {
         outMutexPtr = 0;
     }
     return theOkFlag;
 }
 
+    bool
+ClientManager::BindLocalAcceptor(
+    const string& inSocketDir)
+{
+    delete mLocalAcceptorPtr;
+    mLocalAcceptorPtr = 0;
+    if (! mAcceptorPtr || GetPort() <= 0) {
+        return false;
+    }
+    const bool kBindOnlyFlag = true;
+    mLocalAcceptorPtr = new Acceptor(
+        globalNetManager(),
+        TcpSocket::GetLocalSocketPath(inSocketDir, GetPort()),
+        this,
+        kBindOnlyFlag
+    );
+    return mLocalAcceptorPtr->IsAcceptorStarted();
+}
+
     bool
 ClientManager::StartListening()
 {
@@ -235,6 +262,12 @@ ClientManager::StartListening()
         return false;
     }
     mAcceptorPtr->StartListening();
+    if (mLocalAcceptorPtr) {
+        mLocalAcceptorPtr->StartListening();
+        if (! mLocalAcceptorPtr->IsAcceptorStarted()) {
+            return false;
+        }
+    }
     return mAcceptorPtr->IsAcceptorStarted();
 }
 
@@ -263,7 +296,11 @@ ClientManager::CreateKfsCallbackObj(
     }
     mCounters.mAcceptCount++;
     mCounters.mClientCount++;
-    ClientThread* const theThreadPtr = GetNextClientThreadPtr();
+    if (inConnPtr->IsLocal()) {
+        mCounters.mLocalAcceptCount++;
+    }
+    ClientThread* const theThreadPtr = mNumaAwareFlag ?
+        GetNextClientThreadPtr(*inConnPtr) : GetNextClientThreadPtr();
     ClientSM*     const theClientPtr = new ClientSM(inConnPtr, theThreadPtr);
     if (! mAuth.Setup(*inConnPtr, *theClientPtr)) {
         delete theClientPtr;
@@ -332,6 +369,8 @@ ClientManager::Shutdown()
     KfsOp::SetMutex(0);
     delete mAcceptorPtr;
     mAcceptorPtr = 0;
+    delete mLocalAcceptorPtr;
+    mLocalAcceptorPtr = 0;
     mAuth.Clear();
 }
 
@@ -359,6 +398,33 @@ ClientManager::GetNextClientThreadPtr()
     return theRetPtr;
 }
 
+    ClientThread*
+ClientManager::GetNextClientThreadPtr(
+    const NetConnection& inConn)
+{
+    const int theNode = ClientThread::GetCpuNumaNode(inConn.GetIncomingCpu());
+    if (theNode < 0 || mThreadCount <= 0 ||
+            mThreadCount <= mFirstClientThreadIndex) {
+        mCounters.mNumaRemoteAcceptCount++;
+        return GetNextClientThreadPtr();
+    }
+    const int theFirstIdx = max(mFirstClientThreadIndex, 0);
+    int       theIdx      = max(mCurThreadIdx, theFirstIdx);
+    for (int i = theFirstIdx; i < mThreadCount; i++) {
+        if (mThreadsPtr[theIdx].GetNumaNode() == theNode) {
+            mCurThreadIdx = theIdx + 1 < mThreadCount ?
+                theIdx + 1 : theFirstIdx;
+            mCounters.mNumaLocalAcceptCount++;
+            return (mThreadsPtr + theIdx);
+        }
+        if (mThreadCount <= ++theIdx) {
+            theIdx = theFirstIdx;
+        }
+    }
+    mCounters.mNumaRemoteAcceptCount++;
+    return GetNextClientThreadPtr();
+}
+
     ClientThread*
 ClientManager::GetClientThread(
     int inIdx)
@@ -72,6 +72,9 @@ public:
         Counter mWaitTimeExceededCount;
         Counter mDiscardedBytesCount;
         Counter mOverClientLimitCount;
+        Counter mNumaLocalAcceptCount;
+        Counter mNumaRemoteAcceptCount;
+        Counter mLocalAcceptCount;
 
         void Clear()
         {
@@ -99,6 +102,9 @@ public:
             mWaitTimeExceededCount      = 0;
             mDiscardedBytesCount        = 0;
             mOverClientLimitCount       = 0;
+            mNumaLocalAcceptCount       = 0;
+            mNumaRemoteAcceptCount      = 0;
+            mLocalAcceptCount           = 0;
         }
     };
     bool BindAcceptor(
@@ -106,7 +112,13 @@ public:
         bool                  ipV6OnlyFlag,
         int                   inThreadCount,
         int                   inFirstCpuIdx,
-        QCMutex*&             outMutexPtr);
+        QCMutex*&             outMutexPtr,
+        bool                  inNumaAwareFlag = false);
+    /// Accept connections from the clients on the same host through unix
+    /// domain socket in the directory specified, in addition to the client
+    /// port. Must be invoked after BindAcceptor().
+    bool BindLocalAcceptor(
+        const string& inSocketDir);
     bool StartListening();
     virtual KfsCallbackObj* CreateKfsCallbackObj(
         NetConnectionPtr& inConnPtr);
@@ -206,6 +218,10 @@ public:
     const QCMutex* GetMutexPtr() const;
     ClientThread* GetCurrentClientThreadPtr();
     ClientThread* GetNextClientThreadPtr();
+    /// Returns next client thread bound to the NUMA node of the cpu that
+    /// received the connection's packets, or next thread if no such thread.
+    ClientThread* GetNextClientThreadPtr(
+        const NetConnection& inConn);
     ClientThread* GetClientThread(
         int inIdx);
     bool IsAuthEnabled() const;
@@ -221,6 +237,7 @@ private:
     class Auth;
 
     Acceptor*     mAcceptorPtr;
+    Acceptor*     mLocalAcceptorPtr;
     int           mIoTimeoutSec;
     int           mIdleTimeoutSec;
     int           mMaxClientCount;
@@ -230,6 +247,7 @@ private:
     int           mFirstClientThreadIndex;
     int           mThreadCount;
     ClientThread* mThreadsPtr;
+    bool          mNumaAwareFlag;
 
     ClientManager();
     ~ClientManager();
@@ -66,6 +66,7 @@ using std::string;
 using std::max;
 using std::make_pair;
 using std::list;
+using std::istringstream;
 
 // KFS client protocol state machine implementation.
 
@@ -75,6 +76,9 @@ bool     ClientSM::sEnforceMaxWaitFlag       = true;
 int      ClientSM::sMaxReqSizeDiscard        = 256 << 10;
 size_t   ClientSM::sMaxAppendRequestSize     = CHUNKSIZE;
 uint64_t ClientSM::sInstanceNum              = 10000;
+ClientSM::QosUidClasses ClientSM::sQosUidClasses;
+int      ClientSM::sQosDefaultClass          = 0;
+bool     ClientSM::sQosClientClassTagFlag    = false;
 
 inline time_t
 ClientSM::TimeNow() const
@@ -189,6 +193,59 @@ ClientSM::SetParameters(const Properties& prop)
     sMaxCmdHeaderReadAhead = prop.getValue(
         "chunkServer.clientSM.maxCmdHeaderReadAhead",
         sMaxCmdHeaderReadAhead);
+    sQosDefaultClass = min(BufferManager::kQosClassCount - 1, max(0,
+        prop.getValue("chunkServer.qos.defaultClass", sQosDefaultClass)));
+    sQosClientClassTagFlag = prop.getValue(
+        "chunkServer.qos.clientClassTag",
+        sQosClientClassTagFlag ? 1 : 0) != 0;
+    const Properties::String* const uidClasses =
+        prop.getValue("chunkServer.qos.uidClasses");
+    if (uidClasses) {
+        sQosUidClasses.clear();
+        istringstream is(uidClasses->GetStr());
+        kfsUid_t      uid;
+        int           qosClass;
+        while ((is >> uid >> qosClass)) {
+            if (0 <= qosClass && qosClass < BufferManager::kQosClassCount) {
+                sQosUidClasses[uid] = qosClass;
+            }
+        }
+    }
+}
+
+void
+ClientSM::ResolveQosClass(KfsOp& op)
+{
+    // The authenticated user class mapping takes precedence over the client
+    // supplied class tag, as the tag can not be validated.
+    int qosClass = -1;
+    if (IsAccessEnforced() && ! sQosUidClasses.empty()) {
+        QosUidClasses::const_iterator const it =
+            sQosUidClasses.find(mDelegationToken.GetUid());
+        if (it != sQosUidClasses.end()) {
+            qosClass = it->second;
+        }
+    }
+    if (qosClass < 0) {
+        qosClass = (sQosClientClassTagFlag && 0 <= op.qosClass) ?
+            min(BufferManager::kQosClassCount - 1, op.qosClass) :
+            sQosDefaultClass;
+    }
+    op.qosClass = qosClass;
+}
+
+inline void
+ClientSM::SetBufMgrQosClass(const KfsOp& op, Client* devCli)
+{
+    // The buffer manager client class is set for each buffer request. The
+    // requests are issued only when neither the client, nor the device
+    // buffer manager client is waiting, therefore the class change always
+    // takes effect.
+    assert(! IsWaitingForBuffers());
+    BufferManager::Client::SetQosClass(op.qosClass);
+    if (devCli) {
+        devCli->SetQosClass(op.qosClass);
+    }
 }
 
 ClientSM::ClientSM(
@@ -714,6 +771,7 @@ ClientSM::GetWriteOp(KfsOp& op, int align, int numBytes,
         }
         mDiscardByteCnt = 0;
         mCurOp          = &op;
+        SetBufMgrQosClass(op, mgrCli);
         if (mDevBufMgr && mDevBufMgr->GetForDiskIo(*mgrCli, bufferBytes)) {
             mDevBufMgr = 0;
         }
@@ -872,6 +930,7 @@ ClientSM::HandleClientCmd(IOBuffer& iobuf, int inCmdLen)
             return false;
         }
         op->CheckAccess(*this);
+        ResolveQosClass(*op);
     }
     iobuf.Consume(cmdLen);
 
@@ -1002,6 +1061,7 @@ ClientSM::HandleClientCmd(IOBuffer& iobuf, int inCmdLen)
                 op->statusMsg      = "exceeds max request size";
                 submitResponseFlag = true;
             } else {
+                SetBufMgrQosClass(*op, mgrCli);
                 if (mDevBufMgr &&
                         mDevBufMgr->GetForDiskIo(*mgrCli, bufferBytes)) {
                     mDevBufMgr = 0;
@@ -58,6 +58,7 @@ using std::pair;
 using std::list;
 using std::string;
 using std::vector;
+using std::map;
 
 class ClientSM;
 class Properties;
@@ -388,6 +389,10 @@ private:
     string                     mSessionKey;
     bool                       mHandleTerminateFlag;
 
+    typedef map<kfsUid_t, int> QosUidClasses;
+    static QosUidClasses       sQosUidClasses;
+    static int                 sQosDefaultClass;
+    static bool                sQosClientClassTagFlag;
     static int                 sMaxCmdHeaderReadAhead;
     static bool                sTraceRequestResponseFlag;
     static bool                sEnforceMaxWaitFlag;
@@ -425,6 +430,8 @@ private:
     inline Client* GetDevBufMgrClient(const BufferManager* bufMgr);
     inline void PutAndResetDevBufferManager(KfsOp& op, ByteCount opBytes);
     inline bool IsAccessEnforced() const;
+    void ResolveQosClass(KfsOp& op);
+    inline void SetBufMgrQosClass(const KfsOp& op, Client* devCli);
     inline bool IsWaitingForDevBufMgr() const;
     inline bool IsWaitingForBuffers() const;
     bool FailIfExceedsWait(
@@ -44,10 +44,17 @@
 #include "kfsio/checksum.h"
 
 #include <sstream>
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+#include <dirent.h>
 
 namespace KFS
 {
 using std::ostringstream;
+using std::vector;
+using std::max;
+using std::sort;
 using libkfsio::globalNetManager;
 
     inline int
@@ -194,9 +201,16 @@ public:
           mTmpRSReplicatorQueue(),
           mResolverCacheSize(mNetManager.GetResolverCacheSize()),
           mResolverCacheExpiration(mNetManager.GetResolverCacheExpiration()),
+          mResolverNegativeCacheExpiration(
+            mNetManager.GetResolverNegativeCacheExpiration()),
+          mResolverCacheRefreshAhead(
+            mNetManager.GetResolverCacheRefreshAhead()),
+          mResolverThreadCount(mNetManager.GetResolverThreadCount()),
           mUseOsResolverFlag(mNetManager.GetResolverOsFlag()),
           mResolverUpdateParamsFlag(false),
           mWakeupCnt(0),
+          mNumaNode(-1),
+          mClientAddCount(0),
           mOuter(inOuter),
           mNetManagerWatcher("client", mNetManager)
     {
@@ -223,6 +237,7 @@ public:
         );
         const bool theWakeupFlag = DispatchQueue::IsEmpty(mAddQueuePtr);
         DispatchQueue::PushBack(mAddQueuePtr, inClient);
+        mClientAddCount++;
         if (theWakeupFlag) {
             Wakeup();
         }
@@ -250,23 +265,27 @@ public:
     bool IsStarted() const
         { return mThread.IsStarted(); }
     void Start(
-        int inCpuIndex)
+        QCThread::CpuAffinity inAffinity,
+        int                   inNumaNode)
     {
         QCASSERT(GetMutex().IsOwned());
         if (! IsStarted()) {
             mShutdownFlag = false;
             mRunFlag      = true;
+            mNumaNode     = inNumaNode;
             const int kStackSize = 384 << 10;
             mThread.Start(
                 this,
                 kStackSize,
                 "ClientThread",
-                inCpuIndex < 0 ?
-                    QCThread::CpuAffinity::None() :
-                    QCThread::CpuAffinity(inCpuIndex)
+                inAffinity
             );
         }
     }
+    int GetNumaNode() const
+        { return mNumaNode; }
+    int64_t GetClientAddCount() const
+        { return mClientAddCount; }
     void Stop()
     {
         QCASSERT(GetMutex().IsOwned());
@@ -297,6 +316,9 @@ public:
         if (mResolverUpdateParamsFlag) {
             mNetManager.SetResolverParameters(mUseOsResolverFlag,
                 mResolverCacheSize, mResolverCacheExpiration);
+            mNetManager.SetResolverCacheParameters(
+                mResolverNegativeCacheExpiration,
+                mResolverCacheRefreshAhead, mResolverThreadCount);
             mResolverUpdateParamsFlag = false;
         }
         ClientThreadListEntry* theAddQueuePtr[kDispatchQueueCount];
@@ -532,6 +554,23 @@ public:
                 globalNetManager().GetResolverCacheExpiration();
             mResolverUpdateParamsFlag = true;
         }
+        if (mResolverNegativeCacheExpiration !=
+                globalNetManager().GetResolverNegativeCacheExpiration()) {
+            mResolverNegativeCacheExpiration =
+                globalNetManager().GetResolverNegativeCacheExpiration();
+            mResolverUpdateParamsFlag = true;
+        }
+        if (mResolverCacheRefreshAhead !=
+                globalNetManager().GetResolverCacheRefreshAhead()) {
+            mResolverCacheRefreshAhead =
+                globalNetManager().GetResolverCacheRefreshAhead();
+            mResolverUpdateParamsFlag = true;
+        }
+        if (mResolverThreadCount !=
+                globalNetManager().GetResolverThreadCount()) {
+            mResolverThreadCount = globalNetManager().GetResolverThreadCount();
+            mResolverUpdateParamsFlag = true;
+        }
     }
     static ClientThread* GetCurrentClientThreadPtr()
     {
@@ -564,9 +603,14 @@ private:
     TmpRSReplicatorQueue   mTmpRSReplicatorQueue;
     int                    mResolverCacheSize;
     int                    mResolverCacheExpiration;
+    int                    mResolverNegativeCacheExpiration;
+    int                    mResolverCacheRefreshAhead;
+    int                    mResolverThreadCount;
     bool                   mUseOsResolverFlag;
     bool                   mResolverUpdateParamsFlag;
     volatile int           mWakeupCnt;
+    int                    mNumaNode;
+    int64_t                mClientAddCount;
     ClientThread&          mOuter;
     NetManagerWatcher      mNetManagerWatcher;
     ClientThreadListEntry* mAddQueuePtr[kDispatchQueueCount];
@@ -749,6 +793,114 @@ private:
 ClientThread* ClientThreadImpl::sCurrentClientThreadPtr = 0;
 int           ClientThreadImpl::sLockCnt                = 0;
 
+// Cpu to NUMA node map, and per node cpu sets from linux sysfs. The map is
+// empty if sysfs node information is not available. The nodes with no cpus
+// (memory only nodes) are skipped, and the node index is the position in the
+// ascending node id order, as node ids are not necessarily contiguous.
+class NumaTopology
+{
+public:
+    static const NumaTopology& Get()
+    {
+        static const NumaTopology sTopology;
+        return sTopology;
+    }
+    int GetNodeCount() const
+        { return (int)mNodeCpus.size(); }
+    int GetCpuNode(
+        int inCpuIndex) const
+    {
+        return ((inCpuIndex < 0 || (int)mCpuNodes.size() <= inCpuIndex) ?
+            -1 : mCpuNodes[inCpuIndex]);
+    }
+    // Returns no affinity if the node cpu set can not be represented by
+    // QCThread::CpuAffinity.
+    QCThread::CpuAffinity GetNodeCpus(
+        int inNode) const
+    {
+        return ((inNode < 0 || GetNodeCount() <= inNode || ! mPinFlag) ?
+            QCThread::CpuAffinity::None() : mNodeCpus[inNode]);
+    }
+    bool IsPinningSupported() const
+        { return mPinFlag; }
+private:
+    vector<int>                   mCpuNodes;
+    vector<QCThread::CpuAffinity> mNodeCpus;
+    bool                          mPinFlag;
+
+    NumaTopology()
+        : mCpuNodes(),
+          mNodeCpus(),
+          mPinFlag(true)
+    {
+        const char* const kNodeDirPtr = "/sys/devices/system/node";
+        DIR* const        theDirPtr   = opendir(kNodeDirPtr);
+        if (! theDirPtr) {
+            return;
+        }
+        vector<int> theNodeIds;
+        const struct dirent* theEntryPtr;
+        while ((theEntryPtr = readdir(theDirPtr))) {
+            int  theId;
+            char theEnd;
+            if (sscanf(theEntryPtr->d_name, "node%d%c", &theId, &theEnd) == 1
+                    && 0 <= theId) {
+                theNodeIds.push_back(theId);
+            }
+        }
+        closedir(theDirPtr);
+        sort(theNodeIds.begin(), theNodeIds.end());
+        for (size_t k = 0; k < theNodeIds.size(); k++) {
+            char theName[64];
+            snprintf(theName, sizeof(theName), "%s/node%d/cpulist",
+                kNodeDirPtr, theNodeIds[k]);
+            FILE* const theFilePtr = fopen(theName, "r");
+            if (! theFilePtr) {
+                continue;
+            }
+            const int             theNode = GetNodeCount();
+            QCThread::CpuAffinity theCpus;
+            theCpus.Clear();
+            bool                  theEmptyFlag = true;
+            // Format: 0-3,8-11, or empty line for memory only node.
+            int theFirst;
+            while (fscanf(theFilePtr, "%d", &theFirst) == 1) {
+                int theLast = theFirst;
+                int theSep  = fgetc(theFilePtr);
+                if (theSep == '-') {
+                    if (fscanf(theFilePtr, "%d", &theLast) != 1) {
+                        break;
+                    }
+                    theSep = fgetc(theFilePtr);
+                }
+                for (int i = max(0, theFirst); i <= theLast; i++) {
+                    if ((int)mCpuNodes.size() <= i) {
+                        mCpuNodes.resize(i + 1, -1);
+                    }
+                    mCpuNodes[i] = theNode;
+                    theEmptyFlag = false;
+                    if (i < kMaxAffinityCpus) {
+                        theCpus.Set(i);
+                    } else {
+                        mPinFlag = false;
+                    }
+                }
+                if (theSep != ',') {
+                    break;
+                }
+            }
+            fclose(theFilePtr);
+            if (! theEmptyFlag) {
+                mNodeCpus.push_back(theCpus);
+            }
+        }
+    }
+    // QCThread::CpuAffinity is 64 bit mask, binding to a node with cpu
+    // index larger than 63 would use partial node cpu set, therefore pinning
+    // is turned off if such cpu is present.
+    enum { kMaxAffinityCpus = 64 };
+};
+
 ClientThreadListEntry::~ClientThreadListEntry()
 {
     if (mOpsHeadPtr || mOpsTailPtr || mGrantedFlag ||
@@ -892,11 +1044,37 @@ ClientThread::GetCurrentClientThreadPtr()
     return ClientThreadImpl::GetCurrentClientThreadPtr();
 }
 
+    int
+ClientThread::GetNumaNode() const
+{
+    return mImpl.GetNumaNode();
+}
+
+    int64_t
+ClientThread::GetClientAddCount() const
+{
+    return mImpl.GetClientAddCount();
+}
+
+    /* static */ int
+ClientThread::GetNumaNodeCount()
+{
+    return NumaTopology::Get().GetNodeCount();
+}
+
+    /* static */ int
+ClientThread::GetCpuNumaNode(
+    int inCpuIndex)
+{
+    return NumaTopology::Get().GetCpuNode(inCpuIndex);
+}
+
     /* static */ ClientThread*
 ClientThread::CreateThreads(
     int       inThreadCount,
     int       inFirstCpuIdx,
-    QCMutex*& outMutexPtr)
+    QCMutex*& outMutexPtr,
+    bool      inNumaAwareFlag)
 {
     if (inThreadCount <= 0) {
         outMutexPtr = 0;
@@ -904,10 +1082,31 @@ ClientThread::CreateThreads(
     }
     outMutexPtr = &ClientThreadImpl::GetMutex();
     QCStMutexLocker theLocker(outMutexPtr);
+    const NumaTopology& theTopology = NumaTopology::Get();
+    const int           theNodeCnt  =
+        inNumaAwareFlag ? theTopology.GetNodeCount() : 0;
+    if (inNumaAwareFlag) {
+        KFS_LOG_STREAM_INFO <<
+            "client threads: " << inThreadCount <<
+            " numa nodes: "    << theNodeCnt <<
+            (theTopology.IsPinningSupported() ? "" :
+                " cpu index exceeds affinity mask, no cpu binding") <<
+        KFS_LOG_EOM;
+    }
     ClientThread* const theThreadsPtr = new ClientThread[inThreadCount];
     for (int i = 0; i < inThreadCount; i++) {
-        theThreadsPtr[i].mImpl.Start(
-            inFirstCpuIdx < 0 ? -1 : inFirstCpuIdx + i);
+        if (0 < theNodeCnt) {
+            const int theNode = i % theNodeCnt;
+            theThreadsPtr[i].mImpl.Start(
+                theTopology.GetNodeCpus(theNode), theNode);
+        } else {
+            theThreadsPtr[i].mImpl.Start(
+                inFirstCpuIdx < 0 ?
+                    QCThread::CpuAffinity::None() :
+                    QCThread::CpuAffinity(inFirstCpuIdx + i),
+                -1
+            );
+        }
     }
     return theThreadsPtr;
 }
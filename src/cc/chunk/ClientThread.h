@@ -26,6 +26,8 @@
 #ifndef CLIENT_THREAD_H
 #define CLIENT_THREAD_H
 
+#include <inttypes.h>
+
 class QCMutex;
 class QCThread;
 
@@ -81,12 +83,22 @@ public:
     bool Lock();
     bool Unlock();
     const QCThread& GetThread() const;
+    /// NUMA node the thread is bound to, or -1 if not bound.
+    int GetNumaNode() const;
+    /// Number of client connections added to the thread.
+    int64_t GetClientAddCount() const;
     static ClientThread* GetCurrentClientThreadPtr();
     static const QCMutex& GetMutex();
+    /// With NUMA aware flag set, the threads are bound to the NUMA nodes
+    /// cpus in round robin order, and first cpu index is ignored.
     static ClientThread* CreateThreads(
         int       inThreadCount,
         int       inFirstCpuIdx,
-        QCMutex*& outMutexPtr);
+        QCMutex*& outMutexPtr,
+        bool      inNumaAwareFlag = false);
+    static int GetNumaNodeCount();
+    static int GetCpuNumaNode(
+        int inCpuIndex);
     static void SetParameters(
         ClientThread*     inThreadsPtr,
         int               inThreadCount,
@@ -33,6 +33,8 @@
 #include "common/Properties.h"
 #include "common/MsgLogger.h"
 #include "common/kfstypes.h"
+#include "common/time.h"
+#include "common/LatencyHistogram.h"
 
 #include "qcdio/QCDLList.h"
 #include "qcdio/QCMutex.h"
@@ -42,6 +44,8 @@
 #include "qcdio/qcdebug.h"
 
 #include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <algorithm>
 #include <limits>
 #include <set>
@@ -485,7 +489,9 @@ public:
         InputIterator* inBufferIteratorPtr,
         int            inBufferCount,
         IoCompletion*  inIoCompletionPtr,
-        Time           inTimeWaitNanoSec)
+        Time           inTimeWaitNanoSec,
+        int            inQosClass,
+        Priority       inPriority)
     {
         if (! mSimulatorPtr || mSimulatorPtr->Enqueue()) {
             return QCDiskQueue::Read(
@@ -494,7 +500,9 @@ public:
                 inBufferIteratorPtr,
                 inBufferCount,
                 inIoCompletionPtr,
-                inTimeWaitNanoSec);
+                inTimeWaitNanoSec,
+                inQosClass,
+                inPriority);
         }
         return EnqueueStatus(kRequestIdNone, kErrorOutOfRequests);
     }
@@ -506,7 +514,9 @@ public:
         IoCompletion*  inIoCompletionPtr,
         Time           inTimeWaitNanoSec,
         bool           inSyncFlag,
-        int64_t        inEofHint)
+        int64_t        inEofHint,
+        int            inQosClass,
+        Priority       inPriority)
     {
         if (! mSimulatorPtr || mSimulatorPtr->Enqueue()) {
             return QCDiskQueue::Write(
@@ -517,7 +527,9 @@ public:
                 inIoCompletionPtr,
                 inTimeWaitNanoSec,
                 inSyncFlag,
-                inEofHint
+                inEofHint,
+                inQosClass,
+                inPriority
             );
         }
         return EnqueueStatus(kRequestIdNone, kErrorOutOfRequests);
@@ -549,6 +561,20 @@ public:
         }
         return false;
     }
+    bool HasFileNamePrefixStartingWith(
+        const string& inPrefix) const
+    {
+        const char*       thePrefPtr     = mFileNamePrefixes.data();
+        const char* const thePrefsEndPtr = thePrefPtr +
+            mFileNamePrefixes.length();
+        while (thePrefPtr < thePrefsEndPtr) {
+            if (strncmp(thePrefPtr, inPrefix.data(), inPrefix.size()) == 0) {
+                return true;
+            }
+            thePrefPtr += strlen(thePrefPtr) + 1;
+        }
+        return false;
+    }
     bool IsInUse() const
         { return (! mFileNamePrefixes.empty()); }
     DiskIo::FilePtr GetDeleteNullFile()
@@ -704,6 +730,8 @@ public:
 
     typedef QCDLList<DiskIo, 0> IoQueue;
     typedef DiskIo::Counters Counters;
+    typedef DiskIo::QosCounters QosCounters;
+    enum { kQosClassCount = QCDiskQueue::kQosClassCount };
 
     DiskIoQueues(
             const Properties& inConfig)
@@ -723,6 +751,8 @@ public:
             "chunkServer.ioBufferPool.bufferSize", 4 << 10)),
           mBufferPoolLockMemoryFlag(inConfig.getValue(
             "chunkServer.ioBufferPool.lockMemory", 0) != 0),
+          mBufferPoolThreadCacheBatchSize(inConfig.getValue(
+            "chunkServer.ioBufferPool.threadCacheBatchSize", 32)),
           mDiskQueueMaxQueueDepth(max(8, inConfig.getValue(
             "chunkServer.diskQueue.maxDepth",
                 max(4 << 10, (int)(int64_t(mBufferPoolPartitionCount) *
@@ -788,13 +818,19 @@ public:
             "chunkServer.diskQueue.cpuAffinity", -1)),
           mDiskQueueTraceFlag(inConfig.getValue(
             "chunkServer.diskQueue.trace", 0) != 0),
-          mParameters(inConfig)
+          mParameters(inConfig),
+          mQosWeightCount(0)
     {
         mCounters.Clear();
+        for (int i = 0; i < kQosClassCount; i++) {
+            mQosCounters[i].Clear();
+            mQosWeights[i] = 1;
+        }
         IoQueue::Init(mIoInFlightQueuePtr);
         IoQueue::Init(mIoInFlightNoTimeoutQueuePtr);
         IoQueue::Init(mIoDoneQueuePtr);
         DiskQueueList::Init(mDiskQueuesPtr);
+        SetQosWeights(inConfig);
         // Call Timeout() every time NetManager goes trough its work loop.
         ITimeout::SetTimeoutInterval(0);
     }
@@ -815,7 +851,9 @@ public:
             mBufferPoolPartitionCount,
             mBufferPoolPartitionBufferCount,
             mBufferPoolBufferSize,
-            mBufferPoolLockMemoryFlag
+            mBufferPoolLockMemoryFlag,
+            // Buffers verification is more precise without thread caches.
+            mDebugVerifyIoBuffersFlag ? 0 : mBufferPoolThreadCacheBatchSize
         );
         if (theSysError) {
             if (inErrMessagePtr) {
@@ -1051,12 +1089,14 @@ public:
         }
         if ((theQueuePtr = FindDiskQueue(inDeviceId))) {
             theQueuePtr->AddFileNamePrefix(inDirNamePtr);
+            SetScheduler(*theQueuePtr);
             return true;
         }
         theQueuePtr = FindDiskQueueNotInUse();
         if (theQueuePtr) {
             theQueuePtr->AddFileNamePrefix(inDirNamePtr);
             theQueuePtr->SetDeviceId(inDeviceId);
+            SetScheduler(*theQueuePtr);
             return true;
         }
         int theMinWriteBlkSize = inMinWriteBlkSize;
@@ -1142,6 +1182,8 @@ public:
             }
             return false;
         }
+        SetQosWeights(*theQueuePtr);
+        SetScheduler(*theQueuePtr);
         return true;
     }
     DiskQueue::Time GetMaxEnqueueWaitTimeNanoSec() const
@@ -1270,6 +1312,132 @@ public:
     void GetCounters(
         Counters& outCounters)
         { outCounters = mCounters; }
+    void GetQosCounters(
+        int          inQosClass,
+        QosCounters& outCounters)
+    {
+        if (inQosClass < 0 || kQosClassCount <= inQosClass) {
+            outCounters.Clear();
+            return;
+        }
+        outCounters = mQosCounters[inQosClass];
+    }
+    void GetLatencyHistogram(
+        int               inPriority,
+        bool              inReadFlag,
+        LatencyHistogram& outHistogram)
+    {
+        if (inPriority < 0 || QCDiskQueue::kPriorityCount <= inPriority) {
+            outHistogram.Clear();
+            return;
+        }
+        outHistogram = mLatencyHistograms[inPriority][inReadFlag ? 0 : 1];
+    }
+    void QosDone(
+        int     inQosClass,
+        int     inPriority,
+        bool    inReadFlag,
+        int64_t inRetCode,
+        int64_t inStartUsec)
+    {
+        QosCounters&  theCounters = mQosCounters[inQosClass];
+        const int64_t theUsecs    =
+            max(int64_t(0), microseconds() - inStartUsec);
+        const int64_t theBytes    = max(int64_t(0), inRetCode);
+        mLatencyHistograms[inPriority][inReadFlag ? 0 : 1].Add(theUsecs);
+        if (inReadFlag) {
+            theCounters.mReadCount++;
+            theCounters.mReadByteCount += theBytes;
+            theCounters.mReadUsecs     += theUsecs;
+        } else {
+            theCounters.mWriteCount++;
+            theCounters.mWriteByteCount += theBytes;
+            theCounters.mWriteUsecs     += theUsecs;
+        }
+    }
+    void SetQosWeights(
+        DiskQueue& inQueue)
+    {
+        inQueue.SetQosWeights(mQosWeights, mQosWeightCount);
+        inQueue.GetBufferManager().SetQosWeights(
+            mQosWeights, mQosWeightCount);
+    }
+    void SetQosWeights(
+        const Properties& inProperties)
+    {
+        const Properties::String* const theWeightsPtr =
+            inProperties.getValue("chunkServer.qos.classWeights");
+        if (! theWeightsPtr) {
+            return;
+        }
+        const char* thePtr = theWeightsPtr->GetPtr();
+        mQosWeightCount = 0;
+        while (mQosWeightCount < kQosClassCount) {
+            char*      theEndPtr = 0;
+            const long theWeight = strtol(thePtr, &theEndPtr, 10);
+            if (theEndPtr == thePtr) {
+                break;
+            }
+            mQosWeights[mQosWeightCount++] = (int)theWeight;
+            thePtr = theEndPtr;
+        }
+        mBufferManager.SetQosWeights(mQosWeights, mQosWeightCount);
+        DiskQueueList::Iterator theIt(mDiskQueuesPtr);
+        DiskQueue* theQueuePtr;
+        while ((theQueuePtr = theIt.Next())) {
+            SetQosWeights(*theQueuePtr);
+        }
+    }
+    void SetScheduler(
+        DiskQueue& inQueue)
+    {
+        string theName = mParameters.getValue(
+            "chunkServer.diskQueue.scheduler", "fifo");
+        const string theDirs = mParameters.getValue(
+            "chunkServer.diskQueue.dirSchedulers", "");
+        for (size_t theNextPos = 0; theNextPos < theDirs.size(); ) {
+            size_t theEndPos = theDirs.find(';', theNextPos);
+            if (theEndPos == string::npos) {
+                theEndPos = theDirs.size();
+            }
+            const size_t theEqPos = theDirs.find('=', theNextPos);
+            if (theNextPos < theEqPos && theEqPos < theEndPos &&
+                    inQueue.HasFileNamePrefixStartingWith(
+                        theDirs.substr(theNextPos, theEqPos - theNextPos))) {
+                theName = theDirs.substr(
+                    theEqPos + 1, theEndPos - theEqPos - 1);
+                break;
+            }
+            theNextPos = theEndPos + 1;
+        }
+        QCDiskQueue::Scheduler theScheduler = QCDiskQueue::kSchedulerFifo;
+        if (theName == "deadline") {
+            theScheduler = QCDiskQueue::kSchedulerDeadline;
+        } else if (theName == "elevator") {
+            theScheduler = QCDiskQueue::kSchedulerElevator;
+        } else if (theName != "fifo") {
+            KFS_LOG_STREAM_ERROR <<
+                "invalid disk queue scheduler: " << theName <<
+                " using fifo" <<
+            KFS_LOG_EOM;
+        }
+        const string theDeadlines = mParameters.getValue(
+            "chunkServer.diskQueue.deadlinesMilliSec", "");
+        QCDiskQueue::Time theDeadlinesNanoSec[QCDiskQueue::kPriorityCount];
+        int               theCount = 0;
+        const char*       thePtr   = theDeadlines.c_str();
+        while (theCount < QCDiskQueue::kPriorityCount) {
+            char*           theEndPtr = 0;
+            const long long theMs     = strtoll(thePtr, &theEndPtr, 10);
+            if (theEndPtr == thePtr) {
+                break;
+            }
+            theDeadlinesNanoSec[theCount++] = QCDiskQueue::Time(theMs) *
+                1000 * 1000;
+            thePtr = theEndPtr;
+        }
+        inQueue.SetScheduler(theScheduler, theDeadlinesNanoSec, theCount);
+    }
     void SetInFlight(
         DiskIo* inIoPtr)
     {
@@ -1277,7 +1445,8 @@ public:
             return;
         }
         Pin(*inIoPtr);
-        inIoPtr->mEnqueueTime = Now();
+        inIoPtr->mEnqueueTime  = Now();
+        inIoPtr->mQosStartUsec = microseconds();
         QCStMutexLocker theLocker(mMutex);
         AddInFlight(*inIoPtr);
     }
@@ -1336,7 +1505,9 @@ public:
         DiskQueueList::Iterator theIt(mDiskQueuesPtr);
         while ((thePtr = theIt.Next())) {
             thePtr->SetParameters(mParameters);
+            SetScheduler(*thePtr);
         }
+        SetQosWeights(inProperties);
     }
     int GetMaxIoTimeSec() const
         { return mMaxIoTime; }
@@ -1525,6 +1696,7 @@ private:
     const int                      mBufferPoolPartitionBufferCount;
     const int                      mBufferPoolBufferSize;
     const int                      mBufferPoolLockMemoryFlag;
+    const int                      mBufferPoolThreadCacheBatchSize;
     const int                      mDiskQueueMaxQueueDepth;
     const int                      mDiskOverloadedPendingRequestCount;
     const int                      mDiskClearOverloadedPendingRequestCount;
@@ -1565,6 +1737,11 @@ private:
     const QCDiskQueue::CpuAffinity mCpuAffinity;
     const int                      mDiskQueueTraceFlag;
     Properties                     mParameters;
+    QosCounters                    mQosCounters[kQosClassCount];
+    int                            mQosWeights[kQosClassCount];
+    int                            mQosWeightCount;
+    LatencyHistogram               mLatencyHistograms[
+        QCDiskQueue::kPriorityCount][2];
 
     QCIoBufferPool& GetBufferPool()
         { return mBufferAllocator.GetBufferPool(); }
@@ -1874,6 +2051,32 @@ DiskIo::GetCounters(
     sDiskIoQueuesPtr->GetCounters(outCounters);
 }
 
+    /* static */ void
+DiskIo::GetQosCounters(
+    int                  inQosClass,
+    DiskIo::QosCounters& outCounters)
+{
+    if (! sDiskIoQueuesPtr) {
+        outCounters.Clear();
+        return;
+    }
+    sDiskIoQueuesPtr->GetQosCounters(inQosClass, outCounters);
+}
+
+    /* static */ void
+DiskIo::GetLatencyHistogram(
+    int               inPriority,
+    bool              inReadFlag,
+    LatencyHistogram& outHistogram)
+{
+    if (! sDiskIoQueuesPtr) {
+        outHistogram.Clear();
+        return;
+    }
+    sDiskIoQueuesPtr->GetLatencyHistogram(
+        inPriority, inReadFlag, outHistogram);
+}
+
      /* static */ bool
 DiskIo::Delete(
     const char*     inFileNamePtr,
@@ -2334,6 +2537,9 @@ DiskIo::DiskIo(
       mBlockIdx(0),
       mIoRetCode(0),
       mEnqueueTime(),
+      mQosStartUsec(0),
+      mQosClass(0),
+      mPriority(QCDiskQueue::kPriorityNormal),
       mWriteSyncFlag(false),
       mCachedFlag(false),
       mCompletionRequestId(QCDiskQueue::kRequestIdNone),
@@ -2490,7 +2696,9 @@ DiskIo::Read(
         0, // inBufferIteratorPtr // allocate buffers just beofre read
         theBufferCnt,
         this,
-        sDiskIoQueuesPtr->GetMaxEnqueueWaitTimeNanoSec()
+        sDiskIoQueuesPtr->GetMaxEnqueueWaitTimeNanoSec(),
+        mQosClass,
+        mPriority
     );
     if (theStatus.IsGood()) {
         theQueuePtr->ReadPending(inNumBytes, 0, mCachedFlag);
@@ -2902,7 +3110,9 @@ DiskIo::SubmitWrite(
         this,
         sDiskIoQueuesPtr->GetMaxEnqueueWaitTimeNanoSec(),
         inSyncFlag,
-        inEofHint
+        inEofHint,
+        mQosClass,
+        mPriority
     );
     if (theStatus.IsGood()) {
         inQueuePtr->WritePending(inNumBytes, 0, mCachedFlag);
@@ -3074,6 +3284,8 @@ DiskIo::RunCompletion()
     } else if (mReadLength > 0) {
         theQueuePtr->ReadPending(
             -int64_t(mReadLength), mIoRetCode, mCachedFlag);
+        sDiskIoQueuesPtr->QosDone(
+            mQosClass, mPriority, true, mIoRetCode, mQosStartUsec);
         theOpNamePtr = "read";
     } else if (! mIoBuffers.empty()) {
         theQueuePtr->WritePending(
@@ -3082,6 +3294,8 @@ DiskIo::RunCompletion()
             mIoRetCode,
             mCachedFlag
         );
+        sDiskIoQueuesPtr->QosDone(
+            mQosClass, mPriority, false, mIoRetCode, mQosStartUsec);
         theOpNamePtr = "write";
         if (mWriteSyncFlag) {
             sDiskIoQueuesPtr->SyncDone(mIoRetCode);
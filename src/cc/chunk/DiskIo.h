@@ -45,6 +45,7 @@ class IOBuffer;
 class DiskQueue;
 class Properties;
 class BufferManager;
+class LatencyHistogram;
 
 // Asynchronous disk io shim.
 // Creates and destroys low level disk queues. Runs io completion queue in the
@@ -108,6 +109,28 @@ public:
             mOpenFilesCount                = 0;
         }
     };
+    // Per QoS class disk io counters. Latency is measured from the request
+    // submission to the io completion, and includes disk queue wait time.
+    struct QosCounters
+    {
+        typedef int64_t Counter;
+
+        Counter mReadCount;
+        Counter mReadByteCount;
+        Counter mReadUsecs;
+        Counter mWriteCount;
+        Counter mWriteByteCount;
+        Counter mWriteUsecs;
+        void Clear()
+        {
+            mReadCount      = 0;
+            mReadByteCount  = 0;
+            mReadUsecs      = 0;
+            mWriteCount     = 0;
+            mWriteByteCount = 0;
+            mWriteUsecs     = 0;
+        }
+    };
     typedef int64_t Offset;
     typedef int64_t DeviceId;
 
@@ -143,6 +166,15 @@ public:
         DiskQueue* inDiskQueuePtr);
     static void GetCounters(
         Counters& outCounters);
+    static void GetQosCounters(
+        int          inQosClass,
+        QosCounters& outCounters);
+    /// Per io priority request latency histograms in microseconds, measured
+    /// the same way as QoS latency.
+    static void GetLatencyHistogram(
+        int               inPriority,
+        bool              inReadFlag,
+        LatencyHistogram& outHistogram);
     static bool Delete(
         const char*     inFileNamePtr,
         KfsCallbackObj* inCallbackObjPtr = 0,
@@ -286,6 +318,24 @@ public:
 
     FilePtr GetFilePtr() const
         { return mFilePtr; }
+    /// Set QoS class used for the subsequent reads and writes.
+    void SetQosClass(
+        int inQosClass)
+    {
+        if (0 <= inQosClass && inQosClass < QCDiskQueue::kQosClassCount) {
+            mQosClass = inQosClass;
+        }
+    }
+    /// Set disk queue scheduler priority used for the subsequent reads and
+    /// writes.
+    void SetPriority(
+        int inPriority)
+    {
+        if (QCDiskQueue::kPriorityHigh <= inPriority &&
+                inPriority < QCDiskQueue::kPriorityCount) {
+            mPriority = QCDiskQueue::Priority(inPriority);
+        }
+    }
 private:
     /// Owning KfsCallbackObj.
     KfsCallbackObj* const  mCallbackObjPtr;
@@ -297,6 +347,9 @@ private:
     int64_t                mBlockIdx;
     int64_t                mIoRetCode;
     time_t                 mEnqueueTime;
+    int64_t                mQosStartUsec;
+    int                    mQosClass;
+    QCDiskQueue::Priority  mPriority;
     bool                   mWriteSyncFlag;
     bool                   mCachedFlag;
     QCDiskQueue::RequestId mCompletionRequestId;
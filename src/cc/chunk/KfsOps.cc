@@ -38,6 +38,7 @@
 #include "utils.h"
 #include "MetaServerSM.h"
 #include "ClientManager.h"
+#include "ClientThread.h"
 
 #include "common/Version.h"
 #include "common/kfstypes.h"
@@ -45,6 +46,7 @@
 #include "common/RequestParser.h"
 #include "common/kfserrno.h"
 #include "common/IntToString.h"
+#include "common/LatencyHistogram.h"
 
 #include "kfsio/Globals.h"
 #include "kfsio/checksum.h"
@@ -685,6 +687,7 @@ KfsOp::KfsOp(KfsOp_t o)
       shortRpcFormatFlag(false),
       initialShortRpcFormatFlag(false),
       maxWaitMillisec(-1),
+      qosClass(-1),
       statusMsg(),
       clnt(0),
       generation(0),
@@ -1697,6 +1700,24 @@ HBAppend(ostream** os, int idx, const Watchdog::Counters& counters)
         "WD-changed-usec-ago-", idx);
 }
 
+inline static void
+HBAppend(ostream** os, const char* keyPrefix, int idx,
+    const QCIoBufferPool::Counters& counters)
+{
+    const QCIoBufferPool::Counters::Counter total =
+        counters.mGetCount + counters.mPutCount;
+    HBAppend(os, "gets",      counters.mGetCount,     keyPrefix, idx);
+    HBAppend(os, "get-hits",  counters.mGetHitCount,  keyPrefix, idx);
+    HBAppend(os, "puts",      counters.mPutCount,     keyPrefix, idx);
+    HBAppend(os, "put-hits",  counters.mPutHitCount,  keyPrefix, idx);
+    HBAppend(os, "hit-pct",   total <= 0 ? int64_t(0) :
+        (counters.mGetHitCount + counters.mPutHitCount) * 100 / total,
+        keyPrefix, idx);
+    HBAppend(os, "locks",     counters.mLockCount,    keyPrefix, idx);
+    HBAppend(os, "reclaimed", counters.mReclaimCount, keyPrefix, idx);
+    HBAppend(os, "cached",    counters.mCachedCount,  keyPrefix, idx);
+}
+
 template<typename T>
 inline static void
 AppendStorageTiersInfo(const char* prefix, T& os,
@@ -1824,6 +1845,26 @@ HBAppendCounters(ostream* hbos)
     HBAppend(os, "Read-chksum-skip-bytes",    cm.mReadSkipDiskVerifyByteCount);
     HBAppend(os, "Read-chksum-skip-cs-bytes",
         cm.mReadSkipDiskVerifyChecksumByteCount);
+    HBAppend(os, "Write-tail-hit",            cm.mWriteTailHitCount);
+    HBAppend(os, "Write-tail-miss",           cm.mWriteTailMissCount);
+    HBAppend(os, "Write-tail-cache-bytes",    cm.mWriteTailCacheSize);
+
+    ReadCache::Counters rc;
+    gChunkManager.GetReadCacheCounters(rc);
+    HBAppend(os, "Read-cache-hit",          rc.mHitCount);
+    HBAppend(os, "Read-cache-hit-bytes",    rc.mHitByteCount);
+    HBAppend(os, "Read-cache-miss",         rc.mMissCount);
+    HBAppend(os, "Read-cache-insert",       rc.mInsertCount);
+    HBAppend(os, "Read-cache-admit-reject", rc.mAdmitRejectCount);
+    HBAppend(os, "Read-cache-evict",        rc.mEvictCount);
+    HBAppend(os, "Read-cache-invalidate",   rc.mInvalidateCount);
+    HBAppend(os, "Read-cache-blocks",       rc.mBlockCount);
+    HBAppend(os, "Read-cache-bytes",        rc.mByteCount);
+    HBAppend(os, "Scrub-chunks",            cm.mScrubChunkCount);
+    HBAppend(os, "Scrub-bytes",             cm.mScrubByteCount);
+    HBAppend(os, "Scrub-errors",            cm.mScrubErrorCount);
+    HBAppend(os, "Scrub-passes",            cm.mScrubPassCount);
+    HBAppend(os, "Scrub-bytes-per-sec",     cm.mScrubBytesPerSec);
 
     MetaServerSM::Counters mc;
     gMetaServerSM.GetCounters(mc);
@@ -1837,6 +1878,13 @@ HBAppendCounters(ostream* hbos)
     gClientManager.GetCounters(cli);
     HBAppend(os, "Client-accept",             cli.mAcceptCount);
     HBAppend(os, "Client-active",             cli.mClientCount);
+    HBAppend(os, "Client-numa-local-accept",  cli.mNumaLocalAcceptCount);
+    HBAppend(os, "Client-numa-remote-accept", cli.mNumaRemoteAcceptCount);
+    HBAppend(os, "Client-local-accept",       cli.mLocalAcceptCount);
+    for (int i = 0; i < gClientManager.GetClientThreadCount(); i++) {
+        ClientThread* const thread = gClientManager.GetClientThread(i);
+        HBAppend(os, "Client-thread-add-", thread->GetClientAddCount(), 0, i);
+    }
     HBAppend(os, "Client-req-invalid",        cli.mBadRequestCount);
     HBAppend(os, "Client-req-invalid-header", cli.mBadRequestHeaderCount);
     HBAppend(os, "Client-req-invalid-length", cli.mRequestLengthExceededCount);
@@ -1865,6 +1913,22 @@ HBAppendCounters(ostream* hbos)
         globalNetManager().GetTimerOverrunCount());
     HBAppend(os, "Timer-overrun-sec",
         globalNetManager().GetTimerOverrunSec());
+    NetManager::Counters netCntrs;
+    globalNetManager().GetCounters(netCntrs);
+    HBAppend(os, "Net-loops",                 netCntrs.mLoopCount);
+    HBAppend(os, "Net-poll-wait-usec",        netCntrs.mPollWaitUsec);
+    HBAppend(os, "Net-dispatch-usec",         netCntrs.mDispatchUsec);
+    HBAppend(os, "Net-timer-usec",            netCntrs.mTimerUsec);
+    HBAppend(os, "Net-timeout-handlers",      netCntrs.mTimeoutHandlerCount);
+    HBAppend(os, "Net-timeout-handler-calls",
+        netCntrs.mTimeoutHandlerCallCount);
+    MemoryAccounting::Counters memCntrs;
+    MemoryAccounting::GetCounters(memCntrs);
+    for (int i = 0; i < MemoryAccounting::kSubsystemCount; i++) {
+        const string prefix = string("Mem-") + MemoryAccounting::GetName(i);
+        HBAppend(os, "-bytes", memCntrs.mBytes[i], prefix.c_str());
+        HBAppend(os, "-count", memCntrs.mCount[i], prefix.c_str());
+    }
 
     HBAppend(os, "Write-appenders",
         gAtomicRecordAppendManager.GetAppendersCount());
@@ -1939,6 +2003,27 @@ HBAppendCounters(ostream* hbos)
     HBAppend(os, "Buffer-req-denied-quota-bytes",
         bmCnts.mOverQuotaRequestDeniedByteCount);
 
+    QCIoBufferPool::Counters bpCnts;
+    bufMgr.GetBufferPoolCounters(bpCnts);
+    HBAppend(os, "Buffer-pool-", -1, bpCnts);
+    QCIoBufferPool::Counters bpCntsSum;
+    int                      bpIdx;
+    const int                kMaxBpThreadCountersToReport = 8;
+    for (bpIdx = 0;
+            bufMgr.GetBufferPoolThreadCacheCounters(bpIdx, bpCnts);
+            ++bpIdx) {
+        if (kMaxBpThreadCountersToReport <= bpIdx) {
+            bpCntsSum.Add(bpCnts);
+        } else {
+            HBAppend(os, "Buffer-pool-tc-", bpIdx, bpCnts);
+        }
+    }
+    if (kMaxBpThreadCountersToReport < bpIdx) {
+        --bpIdx;
+        HBAppend(os, "Buffer-pool-tc-", bpIdx,
+            kMaxBpThreadCountersToReport == bpIdx ? bpCnts : bpCntsSum);
+    }
+
     DiskIo::Counters dio;
     DiskIo::GetCounters(dio);
     HBAppend(os, "Disk-read-count",           dio.mReadCount);
@@ -1965,6 +2050,50 @@ HBAppendCounters(ostream* hbos)
     HBAppend(os, "Disk-timedout-write-bytes", dio.mTimedOutErrorWriteByteCount);
     HBAppend(os, "Disk-open-files",           dio.mOpenFilesCount);
 
+    for (int i = 0; i < BufferManager::kQosClassCount; i++) {
+        BufferManager::QosCounters bq;
+        bufMgr.GetQosCounters(i, bq);
+        DiskIo::QosCounters dq;
+        DiskIo::GetQosCounters(i, dq);
+        if (bq.mRequestCount <= 0 && dq.mReadCount <= 0 &&
+                dq.mWriteCount <= 0) {
+            continue;
+        }
+        HBAppend(os, "QoS-buf-req-",           bq.mRequestCount,        0, i);
+        HBAppend(os, "QoS-buf-req-bytes-",     bq.mRequestByteCount,    0, i);
+        HBAppend(os, "QoS-buf-req-denied-",    bq.mRequestDeniedCount,  0, i);
+        HBAppend(os, "QoS-buf-req-granted-",   bq.mRequestGrantedCount, 0, i);
+        HBAppend(os, "QoS-buf-req-granted-bytes-",
+            bq.mRequestGrantedByteCount, 0, i);
+        HBAppend(os, "QoS-buf-req-wait-usec-", bq.mRequestWaitUsecs,    0, i);
+        HBAppend(os, "QoS-buf-clients-wait-",  bq.mWaitingCount,        0, i);
+        HBAppend(os, "QoS-buf-bytes-wait-",    bq.mWaitingByteCount,    0, i);
+        HBAppend(os, "QoS-disk-read-count-",   dq.mReadCount,           0, i);
+        HBAppend(os, "QoS-disk-read-bytes-",   dq.mReadByteCount,       0, i);
+        HBAppend(os, "QoS-disk-read-usec-",    dq.mReadUsecs,           0, i);
+        HBAppend(os, "QoS-disk-write-count-",  dq.mWriteCount,          0, i);
+        HBAppend(os, "QoS-disk-write-bytes-",  dq.mWriteByteCount,      0, i);
+        HBAppend(os, "QoS-disk-write-usec-",   dq.mWriteUsecs,          0, i);
+    }
+
+    // Cumulative disk io latency by scheduler priority.
+    LatencyHistogram lh;
+    for (int i = 0; i < QCDiskQueue::kPriorityCount; i++) {
+        for (int k = 0; k < 2; k++) {
+            DiskIo::GetLatencyHistogram(i, k == 0, lh);
+            if (lh.GetCount() <= 0) {
+                continue;
+            }
+            const char* const pref = k == 0 ?
+                "Disk-prio-read-" : "Disk-prio-write-";
+            HBAppend(os, "count-",    lh.GetCount(),        pref, i);
+            HBAppend(os, "p50-usec-", lh.GetPercentile(50), pref, i);
+            HBAppend(os, "p90-usec-", lh.GetPercentile(90), pref, i);
+            HBAppend(os, "p99-usec-", lh.GetPercentile(99), pref, i);
+            HBAppend(os, "max-usec-", lh.GetMax(),          pref, i);
+        }
+    }
+
     MsgLogger::Counters msgLogCntrs;
     MsgLogger::GetLogger()->GetCounters(msgLogCntrs);
     HBAppend(os, "Msg-log-level",
@@ -1974,6 +2103,9 @@ HBAppendCounters(ostream* hbos)
     HBAppend(os, "Msg-log-write-errors",     msgLogCntrs.mWriteErrorCount);
     HBAppend(os, "Msg-log-wait",             msgLogCntrs.mAppendWaitCount);
     HBAppend(os, "Msg-log-waited-micro-sec", msgLogCntrs.mAppendWaitMicroSecs);
+    HBAppend(os, "Msg-log-thread-buffers",   msgLogCntrs.mThreadBufferCount);
+    HBAppend(os, "Msg-log-thread-buffer-drop",
+        msgLogCntrs.mThreadBufferDroppedCount);
 
     Replicator::Counters replCntrs;
     Replicator::GetCounters(replCntrs);
@@ -1988,6 +2120,10 @@ HBAppendCounters(ostream* hbos)
     HBAppend(os, "Replicator-read-bytes",  replCntrs.mReadByteCount);
     HBAppend(os, "Replicator-writes",      replCntrs.mWriteCount);
     HBAppend(os, "Replicator-write-bytes", replCntrs.mWriteByteCount);
+    HBAppend(os, "Recovery-queue-depth",   replCntrs.mRecoveryQueueDepth);
+    HBAppend(os, "Recovery-throttled",     replCntrs.mRecoveryThrottledCount);
+    HBAppend(os, "Recovery-bytes",         replCntrs.mRecoveryByteCount);
+    HBAppend(os, "Recovery-bytes-per-sec", replCntrs.mRecoveryBytesPerSec);
 
     HBAppend(os, "Ops-in-flight-count", gChunkServer.GetNumOps());
     HBAppend(os, "Socket-count",        globals().ctrOpenNetFds.GetValue());
@@ -1995,6 +2131,12 @@ HBAppendCounters(ostream* hbos)
     HBAppend(os, "Net-bytes-read",      globals().ctrNetBytesRead.GetValue());
     HBAppend(os, "Net-bytes-write",
         globals().ctrNetBytesWritten.GetValue());
+    HBAppend(os, "Net-ktls-sessions",
+        globals().ctrNetKtlsSessions.GetValue());
+    HBAppend(os, "Net-ktls-bytes-read",
+        globals().ctrNetKtlsBytesRead.GetValue());
+    HBAppend(os, "Net-ktls-bytes-write",
+        globals().ctrNetKtlsBytesWritten.GetValue());
     HBAppend(os, "Disk-bytes-read",     globals().ctrDiskBytesRead.GetValue());
     HBAppend(os, "Disk-bytes-write",
         globals().ctrDiskBytesWritten.GetValue());
@@ -2005,6 +2147,24 @@ HBAppendCounters(ostream* hbos)
     HBAppend(os, "Dns-errors",          globals().ctrNetDnsErrors.GetValue());
     HBAppend(os, "Dns-errors-usec",
         globals().ctrNetDnsErrors.GetTimeSpent());
+    // Client threads have their own net managers and resolvers, report the
+    // sum.
+    Resolver::Counters resolverCntrs;
+    globalNetManager().GetResolverCounters(resolverCntrs);
+    for (int i = 0; i < gClientManager.GetClientThreadCount(); i++) {
+        ClientThread* const thread = gClientManager.GetClientThread(i);
+        Resolver::Counters  cntrs;
+        thread->GetNetManager().GetResolverCounters(cntrs);
+        resolverCntrs.Add(cntrs);
+    }
+    HBAppend(os, "Dns-cache-hits",      resolverCntrs.mHitCount);
+    HBAppend(os, "Dns-cache-negative-hits", resolverCntrs.mNegativeHitCount);
+    HBAppend(os, "Dns-cache-misses",    resolverCntrs.mMissCount);
+    HBAppend(os, "Dns-cache-refresh",   resolverCntrs.mRefreshCount);
+    HBAppend(os, "Dns-cache-size",      resolverCntrs.mCacheSize);
+    HBAppend(os, "Dns-lookups",         resolverCntrs.mResolvedCount);
+    HBAppend(os, "Dns-lookup-errors",   resolverCntrs.mErrorCount);
+    HBAppend(os, "Dns-lookup-usec",     resolverCntrs.mResolveTimeUsec);
     HBAppend(os, "Total-ops-count",     KfsOp::GetOpsCount());
     HBAppend(os, "Auth-clnt",           gClientManager.IsAuthEnabled() ? 1 : 0);
     HBAppend(os, "Auth-rsync",          RemoteSyncSM::IsAuthEnabled()  ? 1 : 0);
@@ -2567,6 +2727,7 @@ WritePrepareOp::Execute()
         Done(EVENT_CMD_DONE, this);
         return;
     }
+    writeOp->qosClass = qosClass;
 
     if (needToForward) {
         ForwardToPeer(peerLoc, writeMaster, allowCSClearTextFlag);
@@ -2697,6 +2858,7 @@ WriteSyncOp::Execute()
         Submit();
         return;
     }
+    writeOp->qosClass = qosClass;
 
     writeOp->enqueueTime = globalNetManager().Now();
 
@@ -3152,7 +3314,9 @@ GetChunkMetadataOp::HandleScrubReadDone(int code, void* data)
         readOp.dataBuf.Trim(readOp.numBytes);
     }
     // verify checksum
-    gChunkManager.ReadChunkDone(&readOp);
+    if (! gChunkManager.ReadChunkDone(&readOp)) {
+        return 0; // Retry.
+    }
     status = readOp.status;
     if (0 <= status) {
         KFS_LOG_STREAM_DEBUG <<
@@ -3237,6 +3401,7 @@ StatsOp::Execute()
     os << "Num aios: " << 0 << "\r\n";
     os << "Num ops: " << gChunkServer.GetNumOps() << "\r\n";
     globals().counterManager.Show(os);
+    MemoryAccounting::Show(os, ": ", "\r\n");
     stats = os.str();
     status = 0;
     Submit();
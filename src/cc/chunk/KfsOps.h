@@ -41,6 +41,7 @@
 #include "common/RequestParser.h"
 #include "common/ReqOstream.h"
 #include "common/CIdChecksum.h"
+#include "common/MemoryAccounting.h"
 
 #include "qcdio/QCDLList.h"
 
@@ -255,7 +256,9 @@ public:
 
 typedef ReqOstreamT<ostream> ReqOstream;
 
-struct KfsOp : public KfsCallbackObj
+struct KfsOp :
+    public KfsCallbackObj,
+    public MemoryAccounted<MemoryAccounting::kSubsystemRequests>
 {
     class Display
     {
@@ -289,6 +292,7 @@ struct KfsOp : public KfsCallbackObj
     bool            shortRpcFormatFlag:1;
     bool            initialShortRpcFormatFlag:1;
     int64_t         maxWaitMillisec;
+    int             qosClass; // Client tag on input, resolved class after.
     string          statusMsg; // output, optional, mostly for debugging
     KfsCallbackObj* clnt;
     uint64_t        generation;
@@ -365,6 +369,7 @@ struct KfsOp : public KfsCallbackObj
         return parser
         .Def2("Cseq",       "c", &KfsOp::seq,            kfsSeq_t(-1))
         .Def2("Max-wait-ms","w", &KfsOp::maxWaitMillisec, int64_t(-1))
+        .Def2("QoS-class",  "Q", &KfsOp::qosClass,        int(-1))
         ;
     }
     static inline BufferManager* GetDeviceBufferManagerSelf(
@@ -793,6 +798,7 @@ struct ReplicateChunkOp : public KfsOp {
     int16_t         striperType;
     int16_t         numStripes;
     int16_t         numRecoveryStripes;
+    int16_t         availableStripes;
     int32_t         stripeSize;
     kfsSTier_t      minStorageTier;
     kfsSTier_t      maxStorageTier;
@@ -817,6 +823,7 @@ struct ReplicateChunkOp : public KfsOp {
         striperType(KFS_STRIPED_FILE_TYPE_NONE),
         numStripes(0),
         numRecoveryStripes(0),
+        availableStripes(-1),
         stripeSize(0),
         minStorageTier(kKfsSTierUndef),
         maxStorageTier(kKfsSTierUndef),
@@ -843,6 +850,7 @@ struct ReplicateChunkOp : public KfsOp {
             " stiper: "     << striperType <<
             " dstripes: "   << numStripes <<
             " rstripes: "   << numRecoveryStripes <<
+            " avail: "      << availableStripes <<
             " ssize: "      << stripeSize <<
             " fsize: "      << fileSize <<
             " fname: "      << pathName <<
@@ -873,6 +881,7 @@ struct ReplicateChunkOp : public KfsOp {
         .Def2("Num-stripes",          "SN", &ReplicateChunkOp::numStripes)
         .Def2("Num-recovery-stripes", "SR", &ReplicateChunkOp::numRecoveryStripes)
         .Def2("Stripe-size",          "SS", &ReplicateChunkOp::stripeSize)
+        .Def2("Available-stripes",    "AS", &ReplicateChunkOp::availableStripes, int16_t(-1))
         .Def2("Pathname",             "PN", &ReplicateChunkOp::pathName)
         .Def2("File-size",            "S",  &ReplicateChunkOp::fileSize,       int64_t(-1))
         .Def2("Min-tier",             "TL", &ReplicateChunkOp::minStorageTier, kKfsSTierUndef)
@@ -1939,6 +1948,7 @@ struct ChunkSpaceReleaseOp : public KfsClientChunkOp {
 
 struct GetChunkMetadataOp : public KfsClientChunkOp {
     bool         readVerifyFlag;
+    bool         backgroundScrubFlag; // Chunk server background scrub.
     int64_t      chunkSize; // output
     IOBuffer     dataBuf; // buffer with the checksum info
     size_t       numBytesIO;
@@ -1950,6 +1960,7 @@ struct GetChunkMetadataOp : public KfsClientChunkOp {
     GetChunkMetadataOp()
         : KfsClientChunkOp(CMD_GET_CHUNK_METADATA),
           readVerifyFlag(false),
+          backgroundScrubFlag(false),
           chunkSize(0),
           dataBuf(),
           numBytesIO(0),
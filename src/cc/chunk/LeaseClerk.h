@@ -116,7 +116,8 @@ private:
             SingleLinkedList<LeaseMapEntry>*,
             8 // start from 256 entries
         >,
-        StdFastAllocator<LeaseMapEntry>
+        StdFastTaggedAllocator<
+            LeaseMapEntry, MemoryAccounting::kSubsystemLeases>
     > LeaseMap;
     typedef vector<LeaseMapEntry::Key> TmpExpireQueue;
 
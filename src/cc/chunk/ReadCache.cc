@@ -0,0 +1,296 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \file ReadCache.cc
+// \brief Chunk server memory bounded cache of checksum verified blocks.
+//
+//----------------------------------------------------------------------------
+
+#include "ReadCache.h"
+
+#include <algorithm>
+
+namespace KFS
+{
+
+using std::max;
+
+    inline static uint64_t
+MixHash(
+    uint64_t inVal)
+{
+    inVal ^= inVal >> 33;
+    inVal *= 0xff51afd7ed558ccdULL;
+    inVal ^= inVal >> 33;
+    inVal *= 0xc4ceb9fe1a85ec53ULL;
+    inVal ^= inVal >> 33;
+    return inVal;
+}
+
+    uint64_t
+ReadCache::Key::Hash() const
+{
+    return MixHash(
+        uint64_t(mChunkId) ^
+        (uint64_t(mChunkVersion) * 0x9e3779b97f4a7c15ULL) ^
+        (uint64_t(mBlockIdx) << 48)
+    );
+}
+
+    void
+ReadCache::FrequencySketch::SetCapacity(
+    int64_t inEntryCount)
+{
+    size_t theWidth = 64;
+    while ((int64_t)theWidth < inEntryCount * 4) {
+        theWidth <<= 1;
+    }
+    if (theWidth == mMask + 1) {
+        return;
+    }
+    mMask       = theWidth - 1;
+    mAddCount   = 0;
+    mResetCount = (int64_t)theWidth * 10;
+    mCounters.assign(theWidth * kDepth, uint8_t(0));
+}
+
+    void
+ReadCache::FrequencySketch::Add(
+    uint64_t inHash)
+{
+    if (mCounters.empty()) {
+        return;
+    }
+    bool theAddedFlag = false;
+    for (int i = 0; i < kDepth; i++) {
+        uint8_t& theCount = mCounters[Index(inHash, i)];
+        if (theCount < kMaxCount) {
+            theCount++;
+            theAddedFlag = true;
+        }
+    }
+    if (theAddedFlag && mResetCount <= ++mAddCount) {
+        // Age all counters.
+        for (vector<uint8_t>::iterator theIt = mCounters.begin();
+                theIt != mCounters.end();
+                ++theIt) {
+            *theIt >>= 1;
+        }
+        mAddCount /= 2;
+    }
+}
+
+    int
+ReadCache::FrequencySketch::Estimate(
+    uint64_t inHash) const
+{
+    if (mCounters.empty()) {
+        return 0;
+    }
+    int theRet = kMaxCount;
+    for (int i = 0; i < kDepth; i++) {
+        const int theCount = mCounters[Index(inHash, i)];
+        if (theCount < theRet) {
+            theRet = theCount;
+        }
+    }
+    return theRet;
+}
+
+ReadCache::ReadCache(
+    int inBlockSize)
+    : mBlockSize(max(1, inBlockSize)),
+      mMaxSize(0),
+      mBlockTable(),
+      mChunkTable(),
+      mSketch(),
+      mCounters()
+{
+    for (int i = 0; i < kListCount; i++) {
+        mLruPtr[i] = 0;
+    }
+    mCounters.Clear();
+}
+
+ReadCache::~ReadCache()
+{
+    Shrink(0);
+}
+
+    void
+ReadCache::SetMaxSize(
+    int64_t inMaxSize)
+{
+    mMaxSize = max(int64_t(0), inMaxSize);
+    Shrink(mMaxSize);
+    mSketch.SetCapacity(mMaxSize / mBlockSize);
+}
+
+    bool
+ReadCache::Get(
+    kfsChunkId_t inChunkId,
+    int64_t      inChunkVersion,
+    int          inBlockIdx,
+    int          inBlockCount,
+    IOBuffer&    outBuf)
+{
+    if (! IsEnabled() || inBlockCount <= 0) {
+        return false;
+    }
+    bool theHitFlag = true;
+    for (int i = 0; i < inBlockCount; i++) {
+        const Key theKey(inChunkId, inChunkVersion, inBlockIdx + i);
+        mSketch.Add(theKey.Hash());
+        Entry** const theEntryPtr = mBlockTable.Find(theKey);
+        if (theEntryPtr) {
+            LruList::PushFront(mLruPtr, **theEntryPtr);
+        } else {
+            theHitFlag = false;
+        }
+    }
+    if (! theHitFlag) {
+        mCounters.mMissCount++;
+        return false;
+    }
+    for (int i = 0; i < inBlockCount; i++) {
+        const Key theKey(inChunkId, inChunkVersion, inBlockIdx + i);
+        const IOBuffer& theBuf = (*mBlockTable.Find(theKey))->mBuf;
+        const int       theLen = theBuf.BytesConsumable();
+        outBuf.Copy(&theBuf, theLen);
+        mCounters.mHitByteCount += theLen;
+    }
+    mCounters.mHitCount++;
+    return true;
+}
+
+    bool
+ReadCache::IsAdmissible(
+    kfsChunkId_t inChunkId,
+    int64_t      inChunkVersion,
+    int          inBlockIdx) const
+{
+    if (! IsEnabled()) {
+        return false;
+    }
+    const Key theKey(inChunkId, inChunkVersion, inBlockIdx);
+    if (mBlockTable.Find(theKey)) {
+        return false;
+    }
+    const Entry* const theVictimPtr = LruList::Back(mLruPtr);
+    return (mCounters.mByteCount + mBlockSize <= mMaxSize || ! theVictimPtr ||
+        mSketch.Estimate(theVictimPtr->mKey.Hash()) <
+            mSketch.Estimate(theKey.Hash()));
+}
+
+    bool
+ReadCache::Put(
+    kfsChunkId_t inChunkId,
+    int64_t      inChunkVersion,
+    int          inBlockIdx,
+    IOBuffer&    inBuf)
+{
+    if (! IsEnabled() || inBuf.BytesConsumable() != mBlockSize) {
+        return false;
+    }
+    const Key theKey(inChunkId, inChunkVersion, inBlockIdx);
+    if (mBlockTable.Find(theKey)) {
+        return false;
+    }
+    while (mMaxSize < mCounters.mByteCount + mBlockSize) {
+        Entry* const theVictimPtr = LruList::Back(mLruPtr);
+        if (! theVictimPtr) {
+            break;
+        }
+        if (mSketch.Estimate(theKey.Hash()) <=
+                mSketch.Estimate(theVictimPtr->mKey.Hash())) {
+            mCounters.mAdmitRejectCount++;
+            return false;
+        }
+        Remove(*theVictimPtr);
+        mCounters.mEvictCount++;
+    }
+    Entry& theEntry = *(new Entry(theKey));
+    theEntry.mBuf.Move(&inBuf);
+    bool theInsertedFlag = false;
+    mBlockTable.Insert(theKey, &theEntry, theInsertedFlag);
+    Entry*& theHeadPtr =
+        *mChunkTable.Insert(inChunkId, &theEntry, theInsertedFlag);
+    if (! theInsertedFlag) {
+        ChunkList::Insert(theEntry, *theHeadPtr);
+    }
+    LruList::PushFront(mLruPtr, theEntry);
+    mCounters.mInsertCount++;
+    mCounters.mBlockCount++;
+    mCounters.mByteCount += mBlockSize;
+    return true;
+}
+
+    void
+ReadCache::Remove(
+    Entry& inEntry)
+{
+    Entry** const theHeadPtr = mChunkTable.Find(inEntry.mKey.mChunkId);
+    if (theHeadPtr && *theHeadPtr == &inEntry) {
+        Entry& theNext = ChunkList::GetNext(inEntry);
+        if (&theNext == &inEntry) {
+            mChunkTable.Erase(inEntry.mKey.mChunkId);
+        } else {
+            *theHeadPtr = &theNext;
+        }
+    }
+    ChunkList::Remove(inEntry);
+    LruList::Remove(mLruPtr, inEntry);
+    mBlockTable.Erase(inEntry.mKey);
+    mCounters.mBlockCount--;
+    mCounters.mByteCount -= mBlockSize;
+    delete &inEntry;
+}
+
+    void
+ReadCache::Invalidate(
+    kfsChunkId_t inChunkId)
+{
+    Entry** const theHeadPtr = mChunkTable.Find(inChunkId);
+    if (! theHeadPtr) {
+        return;
+    }
+    Entry* const thePtr = *theHeadPtr;
+    while (ChunkList::IsInList(*thePtr)) {
+        Remove(ChunkList::GetNext(*thePtr));
+        mCounters.mInvalidateCount++;
+    }
+    Remove(*thePtr);
+    mCounters.mInvalidateCount++;
+}
+
+    void
+ReadCache::Shrink(
+    int64_t inTargetSize)
+{
+    Entry* thePtr;
+    while (inTargetSize < mCounters.mByteCount &&
+            (thePtr = LruList::Back(mLruPtr))) {
+        Remove(*thePtr);
+        mCounters.mEvictCount++;
+    }
+}
+
+} // namespace KFS
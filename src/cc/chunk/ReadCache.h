@@ -0,0 +1,274 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \file ReadCache.h
+// \brief Chunk server memory bounded cache of checksum verified blocks.
+//
+//----------------------------------------------------------------------------
+
+#ifndef READ_CACHE_H
+#define READ_CACHE_H
+
+#include "common/kfstypes.h"
+#include "common/LinearHash.h"
+#include "common/StdAllocator.h"
+#include "kfsio/IOBuffer.h"
+#include "qcdio/QCDLList.h"
+
+#include <vector>
+#include <inttypes.h>
+
+namespace KFS
+{
+
+using std::vector;
+
+// Cache of checksum blocks keyed by chunk id, chunk version, and block index.
+// The blocks share io buffers with the reads that populated the cache, thus
+// the cache memory is taken from the io buffer pool.
+// Admission uses TinyLFU: the access frequency of all requested blocks is
+// tracked by a count-min sketch with periodic aging, and once the cache is
+// full, a new block is admitted only if its estimated frequency is higher
+// than the frequency of the LRU eviction candidate. This keeps large
+// sequential scans from flushing frequently read small ranges, such as file
+// footers and indices.
+class ReadCache
+{
+public:
+    struct Counters
+    {
+        typedef int64_t Counter;
+
+        Counter mHitCount;
+        Counter mHitByteCount;
+        Counter mMissCount;
+        Counter mInsertCount;
+        Counter mAdmitRejectCount;
+        Counter mEvictCount;
+        Counter mInvalidateCount;
+        Counter mBlockCount;
+        Counter mByteCount;
+
+        void Clear()
+        {
+            mHitCount         = 0;
+            mHitByteCount     = 0;
+            mMissCount        = 0;
+            mInsertCount      = 0;
+            mAdmitRejectCount = 0;
+            mEvictCount       = 0;
+            mInvalidateCount  = 0;
+            mBlockCount       = 0;
+            mByteCount        = 0;
+        }
+    };
+
+    ReadCache(
+        int inBlockSize);
+    ~ReadCache();
+    void SetMaxSize(
+        int64_t inMaxSize);
+    int64_t GetMaxSize() const
+        { return mMaxSize; }
+    int64_t GetSize() const
+        { return mCounters.mByteCount; }
+    bool IsEnabled() const
+        { return (mBlockSize <= mMaxSize); }
+    // Returns true and appends the blocks to the buffer if all blocks in the
+    // range are present in the cache. Updates blocks access frequency
+    // regardless of the outcome.
+    bool Get(
+        kfsChunkId_t inChunkId,
+        int64_t      inChunkVersion,
+        int          inBlockIdx,
+        int          inBlockCount,
+        IOBuffer&    outBuf);
+    // Returns true if the block is not in the cache, and would be admitted.
+    bool IsAdmissible(
+        kfsChunkId_t inChunkId,
+        int64_t      inChunkVersion,
+        int          inBlockIdx) const;
+    // Offer single block for admission. The block data is moved from the
+    // buffer if admitted.
+    bool Put(
+        kfsChunkId_t inChunkId,
+        int64_t      inChunkVersion,
+        int          inBlockIdx,
+        IOBuffer&    inBuf);
+    // Remove all blocks of the chunk, all versions.
+    void Invalidate(
+        kfsChunkId_t inChunkId);
+    // Evict LRU blocks until the cache size is less or equal to the target.
+    void Shrink(
+        int64_t inTargetSize);
+    void GetCounters(
+        Counters& outCounters) const
+        { outCounters = mCounters; }
+private:
+    enum
+    {
+        kLruList   = 0,
+        kChunkList = 1,
+        kListCount = 2
+    };
+    struct Key
+    {
+        Key(
+            kfsChunkId_t inChunkId      = -1,
+            int64_t      inChunkVersion = -1,
+            int          inBlockIdx     = -1)
+            : mChunkId(inChunkId),
+              mChunkVersion(inChunkVersion),
+              mBlockIdx(inBlockIdx)
+            {}
+        bool operator==(
+            const Key& inRhs) const
+        {
+            return (
+                mChunkId      == inRhs.mChunkId &&
+                mChunkVersion == inRhs.mChunkVersion &&
+                mBlockIdx     == inRhs.mBlockIdx
+            );
+        }
+        bool operator<(
+            const Key& inRhs) const
+        {
+            return (
+                mChunkId < inRhs.mChunkId || (mChunkId == inRhs.mChunkId && (
+                mChunkVersion < inRhs.mChunkVersion ||
+                (mChunkVersion == inRhs.mChunkVersion &&
+                mBlockIdx < inRhs.mBlockIdx)))
+            );
+        }
+        uint64_t Hash() const;
+
+        kfsChunkId_t mChunkId;
+        int64_t      mChunkVersion;
+        int          mBlockIdx;
+    };
+    struct KeyHash
+    {
+        static size_t Hash(
+            const Key& inKey)
+            { return size_t(inKey.Hash()); }
+    };
+    class Entry
+    {
+    public:
+        Entry(
+            const Key& inKey)
+            : mKey(inKey),
+              mBuf()
+        {
+            for (int i = 0; i < kListCount; i++) {
+                mPrevPtr[i] = this;
+                mNextPtr[i] = this;
+            }
+        }
+        Key      mKey;
+        IOBuffer mBuf;
+    private:
+        Entry* mPrevPtr[kListCount];
+        Entry* mNextPtr[kListCount];
+        friend class QCDLListOp<Entry, kLruList>;
+        friend class QCDLListOp<Entry, kChunkList>;
+    };
+    // Count-min sketch with 4 bit saturating counters, stored one per byte
+    // for simplicity, and aging by halving all counters once the number of
+    // increments reaches 10 times the sketch width.
+    class FrequencySketch
+    {
+    public:
+        FrequencySketch()
+            : mCounters(),
+              mMask(0),
+              mAddCount(0),
+              mResetCount(0)
+            {}
+        void SetCapacity(
+            int64_t inEntryCount);
+        void Add(
+            uint64_t inHash);
+        int Estimate(
+            uint64_t inHash) const;
+    private:
+        enum { kDepth = 4 };
+        enum { kMaxCount = 15 };
+
+        vector<uint8_t> mCounters;
+        size_t          mMask;
+        int64_t         mAddCount;
+        int64_t         mResetCount;
+
+        size_t Index(
+            uint64_t inHash,
+            int      inRow) const
+        {
+            return (size_t(inRow) * (mMask + 1) +
+                (size_t(uint32_t(inHash) +
+                    uint32_t(inRow) * uint32_t((inHash >> 32) | 1)) & mMask));
+        }
+    };
+    typedef KVPair<Key, Entry*> BlockTableEntry;
+    typedef LinearHash<
+        BlockTableEntry,
+        KeyCompare<Key, KeyHash>,
+        DynamicArray<
+            SingleLinkedList<BlockTableEntry>*,
+            10
+        >,
+        StdFastTaggedAllocator<
+            BlockTableEntry, MemoryAccounting::kSubsystemCaches>
+    > BlockTable;
+    typedef KVPair<kfsChunkId_t, Entry*> ChunkTableEntry;
+    typedef LinearHash<
+        ChunkTableEntry,
+        KeyCompare<kfsChunkId_t>,
+        DynamicArray<
+            SingleLinkedList<ChunkTableEntry>*,
+            10
+        >,
+        StdFastTaggedAllocator<
+            ChunkTableEntry, MemoryAccounting::kSubsystemCaches>
+    > ChunkTable;
+    typedef QCDLList<Entry, kLruList>     LruList;
+    typedef QCDLListOp<Entry, kChunkList> ChunkList;
+
+    const int       mBlockSize;
+    int64_t         mMaxSize;
+    BlockTable      mBlockTable;
+    ChunkTable      mChunkTable;
+    FrequencySketch mSketch;
+    Entry*          mLruPtr[kListCount];
+    Counters        mCounters;
+
+    void Remove(
+        Entry& inEntry);
+private:
+    ReadCache(
+        const ReadCache& inCache);
+    ReadCache& operator=(
+        const ReadCache& inCache);
+};
+
+} // namespace KFS
+
+#endif /* READ_CACHE_H */
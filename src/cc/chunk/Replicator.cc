@@ -48,12 +48,14 @@
 #include "common/MsgLogger.h"
 #include "common/StdAllocator.h"
 #include "common/IntToString.h"
+#include "common/time.h"
 
 #include "kfsio/KfsCallbackObj.h"
 #include "kfsio/NetConnection.h"
 #include "kfsio/Globals.h"
 #include "kfsio/ClientAuthContext.h"
 #include "kfsio/checksum.h"
+#include "kfsio/ITimeout.h"
 
 #include "qcdio/qcstutils.h"
 
@@ -63,6 +65,7 @@
 
 #include <string>
 #include <sstream>
+#include <map>
 
 namespace KFS
 {
@@ -198,6 +201,333 @@ private:
     ReplicatorImpl& operator=(const ReplicatorImpl&);
 };
 
+static void StartReplicationOrRecovery(ReplicateChunkOp* op);
+
+// Chunk recovery scheduler. Limits the number of concurrently running RS
+// recoveries, and starts the queued recoveries with the fewest available
+// stripes first. Recovery reads are paced by two token buckets: the chunk
+// directory bucket limits the rate the recovered chunk is written at, and the
+// network bucket limits the rate the stripes are read from other chunk
+// servers. The recovery with exhausted budget waits until the timer refills
+// the buckets. The methods must be invoked from the main thread, or from
+// client thread with client manager mutex held.
+class RecoveryScheduler : public ITimeout
+{
+public:
+    typedef pair<int, uint64_t> Priority;
+    class TokenBucket
+    {
+    public:
+        TokenBucket()
+            : mTokens(0),
+              mTimeUsec(-1)
+            {}
+        bool IsAvailable(int64_t rate, int64_t nowUsec)
+        {
+            if (rate <= 0) {
+                mTimeUsec = -1;
+                return true;
+            }
+            // Allow one second burst.
+            mTokens = mTimeUsec < 0 ? rate : min(rate, mTokens +
+                min(int64_t(1000 * 1000), max(int64_t(0), nowUsec - mTimeUsec))
+                    * rate / (1000 * 1000));
+            mTimeUsec = nowUsec;
+            return (0 <= mTokens);
+        }
+        void Take(int64_t rate, int64_t bytes)
+        {
+            if (0 < rate) {
+                mTokens -= bytes;
+            }
+        }
+    private:
+        int64_t mTokens;
+        int64_t mTimeUsec;
+    };
+    class Waiter
+    {
+    public:
+        Waiter()
+            : mDirBucketPtr(0),
+              mNetBytes(0),
+              mDiskBytes(0),
+              mWaitingFlag(false),
+              mIt()
+            {}
+        bool IsThrottled() const
+            { return mWaitingFlag; }
+        virtual void Resume() = 0;
+    protected:
+        virtual ~Waiter()
+            {}
+    private:
+        typedef std::map<
+            Priority, Waiter*,
+            std::less<Priority>,
+            StdFastAllocator<std::pair<const Priority, Waiter*> >
+        > Waiters;
+
+        TokenBucket*      mDirBucketPtr;
+        int64_t           mNetBytes;
+        int64_t           mDiskBytes;
+        bool              mWaitingFlag;
+        Waiters::iterator mIt;
+    friend class RecoveryScheduler;
+    };
+
+    static RecoveryScheduler& Get()
+    {
+        static RecoveryScheduler sScheduler;
+        return sScheduler;
+    }
+    void SetParameters(const Properties& props)
+    {
+        mMaxRecoveries = props.getValue(
+            "chunkServer.replicator.maxConcurrentRecoveries",
+            mMaxRecoveries
+        );
+        mDiskBytesPerSec = props.getValue(
+            "chunkServer.replicator.recoveryDiskBytesPerSec",
+            mDiskBytesPerSec
+        );
+        mNetBytesPerSec = props.getValue(
+            "chunkServer.replicator.recoveryNetBytesPerSec",
+            mNetBytesPerSec
+        );
+    }
+    static Priority GetPriority(const ReplicateChunkOp& op)
+    {
+        // Number of stripes that can be lost before the chunk becomes
+        // unrecoverable. Old meta server does not send the number of
+        // available stripes.
+        return Priority(op.availableStripes < 0 ?
+            (int)op.numRecoveryStripes :
+            max(0, op.availableStripes - (int)op.numStripes),
+            sSeq++
+        );
+    }
+    void Enqueue(ReplicateChunkOp* op)
+    {
+        Register();
+        Queued::iterator const it = mQueuedChunks.find(op->chunkId);
+        if (it != mQueuedChunks.end()) {
+            KFS_LOG_STREAM_INFO << "recovery:"
+                " chunk: "            << op->chunkId <<
+                " canceling queued: " << it->second->second->Show() <<
+            KFS_LOG_EOM;
+            Cancel(it);
+        }
+        if (mQueue.empty() && CanStart()) {
+            StartReplicationOrRecovery(op);
+            return;
+        }
+        pair<Queue::iterator, bool> const res =
+            mQueue.insert(make_pair(GetPriority(*op), op));
+        mQueuedChunks.insert(make_pair(op->chunkId, res.first));
+        KFS_LOG_STREAM_DEBUG << "recovery:"
+            " queued: "  << mQueue.size() <<
+            " running: " << mRunningCount <<
+            " "          << op->Show() <<
+        KFS_LOG_EOM;
+    }
+    bool Cancel(kfsChunkId_t chunkId, kfsSeq_t targetVersion)
+    {
+        Queued::iterator const it = mQueuedChunks.find(chunkId);
+        if (it == mQueuedChunks.end() || (0 <= targetVersion &&
+                it->second->second->targetVersion != targetVersion)) {
+            return false;
+        }
+        Cancel(it);
+        return true;
+    }
+    void CancelAll()
+    {
+        while (! mQueuedChunks.empty()) {
+            Cancel(mQueuedChunks.begin());
+        }
+    }
+    void Shutdown()
+    {
+        CancelAll();
+        if (mRegisteredFlag) {
+            mRegisteredFlag = false;
+            globalNetManager().UnRegisterTimeoutHandler(this);
+        }
+    }
+    int GetQueuedCount() const
+        { return (int)mQueue.size(); }
+    void Started()
+        { mRunningCount++; }
+    void Done()
+    {
+        if (mRunningCount <= 0) {
+            die("recovery: invalid running count");
+            return;
+        }
+        mRunningCount--;
+        if (! mQueue.empty() && gClientManager.GetCurrentClientThreadPtr()) {
+            // Start the next recovery from the main thread timer.
+            globalNetManager().Wakeup();
+        }
+    }
+    TokenBucket* GetDirBucket(const string& dirName)
+        { return &mDirBuckets[dirName]; }
+    bool Acquire(
+        Waiter&      waiter,
+        TokenBucket* dirBucketPtr,
+        int64_t      netBytes,
+        int64_t      diskBytes,
+        Priority     priority)
+    {
+        if (waiter.mWaitingFlag) {
+            die("recovery: invalid throttle invocation");
+            return true;
+        }
+        waiter.mDirBucketPtr = dirBucketPtr;
+        waiter.mNetBytes     = netBytes;
+        waiter.mDiskBytes    = diskBytes;
+        if (mWaiters.empty() && TryAcquire(waiter, microseconds())) {
+            return true;
+        }
+        waiter.mIt          = mWaiters.insert(make_pair(priority, &waiter)
+            ).first;
+        waiter.mWaitingFlag = true;
+        ReplicatorImpl::Ctrs().mRecoveryThrottledCount++;
+        return false;
+    }
+    void Remove(Waiter& waiter)
+    {
+        if (waiter.mWaitingFlag) {
+            mWaiters.erase(waiter.mIt);
+            waiter.mWaitingFlag = false;
+        }
+    }
+    void GetCounters(Replicator::Counters& counters) const
+    {
+        counters.mRecoveryQueueDepth  = (int64_t)mQueue.size();
+        counters.mRecoveryBytesPerSec = mBytesPerSec;
+    }
+    virtual void Timeout()
+    {
+        const int64_t now = microseconds();
+        const int64_t kRateIntervalUsec = 1000 * 1000;
+        if (mRateTimeUsec + kRateIntervalUsec <= now) {
+            const int64_t bytes = ReplicatorImpl::Ctrs().mRecoveryByteCount;
+            if (0 < mRateTimeUsec) {
+                mBytesPerSec = (bytes - mRateByteCount) * kRateIntervalUsec /
+                    (now - mRateTimeUsec);
+            }
+            mRateTimeUsec  = now;
+            mRateByteCount = bytes;
+        }
+        for (Waiters::iterator it = mWaiters.begin(); it != mWaiters.end(); ) {
+            Waiter& waiter = *it->second;
+            if (! TryAcquire(waiter, now)) {
+                if (! mNetBucket.IsAvailable(mNetBytesPerSec, now)) {
+                    break;
+                }
+                ++it;
+                continue;
+            }
+            mWaiters.erase(it++);
+            waiter.mWaitingFlag = false;
+            waiter.Resume();
+        }
+        while (! mQueue.empty() && CanStart()) {
+            ReplicateChunkOp* const op = mQueue.begin()->second;
+            mQueuedChunks.erase(op->chunkId);
+            mQueue.erase(mQueue.begin());
+            StartReplicationOrRecovery(op);
+        }
+    }
+private:
+    typedef Waiter::Waiters Waiters;
+    typedef std::map<
+        Priority, ReplicateChunkOp*,
+        std::less<Priority>,
+        StdFastAllocator<std::pair<const Priority, ReplicateChunkOp*> >
+    > Queue;
+    typedef std::map<
+        kfsChunkId_t, Queue::iterator,
+        std::less<kfsChunkId_t>,
+        StdFastAllocator<std::pair<const kfsChunkId_t, Queue::iterator> >
+    > Queued;
+    typedef std::map<string, TokenBucket> DirBuckets;
+
+    Queue       mQueue;
+    Queued      mQueuedChunks;
+    Waiters     mWaiters;
+    DirBuckets  mDirBuckets;
+    TokenBucket mNetBucket;
+    int         mRunningCount;
+    int         mMaxRecoveries;
+    int64_t     mDiskBytesPerSec;
+    int64_t     mNetBytesPerSec;
+    int64_t     mRateTimeUsec;
+    int64_t     mRateByteCount;
+    int64_t     mBytesPerSec;
+    bool        mRegisteredFlag;
+
+    static uint64_t sSeq;
+
+    RecoveryScheduler()
+        : ITimeout(),
+          mQueue(),
+          mQueuedChunks(),
+          mWaiters(),
+          mDirBuckets(),
+          mNetBucket(),
+          mRunningCount(0),
+          mMaxRecoveries(16),
+          mDiskBytesPerSec(0),
+          mNetBytesPerSec(0),
+          mRateTimeUsec(0),
+          mRateByteCount(0),
+          mBytesPerSec(0),
+          mRegisteredFlag(false)
+        {}
+    virtual ~RecoveryScheduler()
+    {
+        if (mRegisteredFlag) {
+            globalNetManager().UnRegisterTimeoutHandler(this);
+        }
+    }
+    void Register()
+    {
+        if (! mRegisteredFlag) {
+            mRegisteredFlag = true;
+            globalNetManager().RegisterTimeoutHandler(this);
+        }
+    }
+    bool CanStart() const
+        { return (mMaxRecoveries <= 0 || mRunningCount < mMaxRecoveries); }
+    bool TryAcquire(Waiter& waiter, int64_t now)
+    {
+        if (! mNetBucket.IsAvailable(mNetBytesPerSec, now) ||
+                (waiter.mDirBucketPtr && ! waiter.mDirBucketPtr->IsAvailable(
+                    mDiskBytesPerSec, now))) {
+            return false;
+        }
+        mNetBucket.Take(mNetBytesPerSec, waiter.mNetBytes);
+        if (waiter.mDirBucketPtr) {
+            waiter.mDirBucketPtr->Take(mDiskBytesPerSec, waiter.mDiskBytes);
+        }
+        return true;
+    }
+    void Cancel(Queued::iterator it)
+    {
+        ReplicateChunkOp* const op = it->second->second;
+        mQueue.erase(it->second);
+        mQueuedChunks.erase(it);
+        op->status    = -ECANCELED;
+        op->statusMsg = "canceled";
+        ReplicatorImpl::Ctrs().mRecoveryCanceledCount++;
+        SubmitOpResponse(op);
+    }
+};
+uint64_t RecoveryScheduler::sSeq = 0;
+
 const int kDefaultReplicationReadSize = (int)(
     ((1 << 20) + CHECKSUM_BLOCKSIZE - 1) /
     CHECKSUM_BLOCKSIZE * CHECKSUM_BLOCKSIZE);
@@ -282,6 +612,9 @@ ReplicatorImpl::ReplicatorImpl(ReplicateChunkOp* op, const RemoteSyncSMPtr& peer
     mWriteOp.isFromReReplication = true;
     SET_HANDLER(&mReadOp, &ReadOp::HandleReplicatorDone);
     Ctrs().mReplicatorCount++;
+    if (! op->location.IsValid()) {
+        RecoveryScheduler::Get().Started();
+    }
 }
 
 ReplicatorImpl::~ReplicatorImpl()
@@ -624,6 +957,9 @@ ReplicatorImpl::HandleWriteDone(int code, void* data)
     mOffset += mWriteOp.numBytesIO;
     Ctrs().mWriteCount++;
     Ctrs().mWriteByteCount += mWriteOp.numBytesIO;
+    if (! mOwner->location.IsValid()) {
+        Ctrs().mRecoveryByteCount += mWriteOp.numBytesIO;
+    }
     if (mReadOp.offset == mOffset && ! mReadOp.dataBuf.IsEmpty()) {
         assert(mReadOp.dataBuf.BytesConsumable() < (int)CHECKSUM_BLOCKSIZE);
         // Write the remaining tail.
@@ -723,6 +1059,9 @@ ReplicatorImpl::HandleReplicationDone(int code, void* data)
     Ctrs().mReplicatorCount--;
     ReplicateChunkOp* const op = mOwner;
     mOwner = 0;
+    if (! op->location.IsValid()) {
+        RecoveryScheduler::Get().Done();
+    }
     ReplicationDone();
     SubmitOpResponse(op);
     return 0;
@@ -740,7 +1079,8 @@ class RSReplicatorImpl :
     public  ReplicatorImpl,
     private RSReplicatorEntry,
     private QCRefCountedObj,
-    private Reader::Completion
+    private Reader::Completion,
+    private RecoveryScheduler::Waiter
 {
 public:
     static void SetParameters(const Properties& props)
@@ -903,6 +1243,8 @@ private:
     bool                 mReplicationDoneFlag;
     int64_t              mPrevReadCount;
     int64_t              mPrevReadByteCount;
+    const RecoveryScheduler::Priority mPriority;
+    RecoveryScheduler::TokenBucket*   mDirBucketPtr;
 
     RSReplicatorImpl(
         ReplicateChunkOp* op,
@@ -914,6 +1256,7 @@ private:
           RSReplicatorEntry(clientThread),
           QCRefCountedObj(),
           Reader::Completion(),
+          RecoveryScheduler::Waiter(),
           mState(kNone),
           mMetaServer(metaServer),
           mAuthUpdateCount(authUpdateCount),
@@ -944,7 +1287,9 @@ private:
           mPendingCancelFlag(false),
           mReplicationDoneFlag(false),
           mPrevReadCount(0),
-          mPrevReadByteCount(0)
+          mPrevReadByteCount(0),
+          mPriority(RecoveryScheduler::GetPriority(*op)),
+          mDirBucketPtr(0)
     {
         if (mReadSize % IOBufferData::GetDefaultBufferSize() != 0) {
             FatalError("invalid read size");
@@ -977,6 +1322,12 @@ private:
             return; // ignore.
         }
         if (kNone == mState) {
+            if (IsThrottled()) {
+                RecoveryScheduler::Get().Remove(*this);
+                ReplicatorImpl::Cancel();
+                Terminate(ECANCELED);
+                return;
+            }
             ReplicatorImpl::Cancel();
             return;
         }
@@ -1010,10 +1361,35 @@ private:
     }
     virtual void Read()
     {
-        if (mState != kNone || mCancelFlag) {
+        if (mState != kNone || mCancelFlag || IsThrottled()) {
             FatalError("invalid read invocation");
             return;
         }
+        if (mOffset < mChunkSize && mOwner) {
+            // Charge the recovery budget with the stripes read from the
+            // network, and the recovered chunk data written to disk.
+            RecoveryScheduler& scheduler = RecoveryScheduler::Get();
+            if (! mDirBucketPtr) {
+                mDirBucketPtr = scheduler.GetDirBucket(gChunkManager.GetDirName(
+                    mChunkId, mWriteOp.chunkVersion));
+            }
+            if (! scheduler.Acquire(
+                    *this,
+                    mDirBucketPtr,
+                    int64_t(mReadSize) * mOwner->numStripes,
+                    mReadSize,
+                    mPriority)) {
+                return;
+            }
+        }
+        Enqueue(kRead);
+    }
+    virtual void Resume()
+    {
+        if (mState != kNone || mCancelFlag) {
+            FatalError("invalid resume invocation");
+            return;
+        }
         Enqueue(kRead);
     }
     virtual void ReplicationDone()
@@ -1754,24 +2130,28 @@ Properties RSReplicatorImpl::sAuthParams;
 int
 Replicator::GetNumReplications()
 {
-    return ReplicatorImpl::GetNumReplications();
+    return (ReplicatorImpl::GetNumReplications() +
+        RecoveryScheduler::Get().GetQueuedCount());
 }
 
 void
 Replicator::CancelAll()
 {
+    RecoveryScheduler::Get().CancelAll();
     ReplicatorImpl::CancelAll();
 }
 
 bool
 Replicator::Cancel(kfsChunkId_t chunkId, kfsSeq_t targetVersion)
 {
-    return ReplicatorImpl::CancelChunkReplication(chunkId, targetVersion);
+    return (RecoveryScheduler::Get().Cancel(chunkId, targetVersion) ||
+        ReplicatorImpl::CancelChunkReplication(chunkId, targetVersion));
 }
 
 void
 Replicator::Shutdown()
 {
+    RecoveryScheduler::Get().Shutdown();
     ReplicatorImpl::CancelAll();
     RSReplicatorImpl::Shutdown();
 }
@@ -1781,12 +2161,14 @@ Replicator::SetParameters(const Properties& props)
 {
     ReplicatorImpl::SetParameters(props);
     RSReplicatorImpl::SetParameters(props);
+    RecoveryScheduler::Get().SetParameters(props);
 }
 
 void
 Replicator::GetCounters(Replicator::Counters& counters)
 {
     ReplicatorImpl::GetCounters(counters);
+    RecoveryScheduler::Get().GetCounters(counters);
 }
 
 void
@@ -1822,6 +2204,34 @@ Replicator::Run(ReplicateChunkOp* op)
     }
     KFS_LOG_STREAM_DEBUG << op->Show() << KFS_LOG_EOM;
 
+    if (op->location.IsValid()) {
+        ReplicatorImpl::Ctrs().mReplicationCount++;
+        StartReplicationOrRecovery(op);
+        return;
+    }
+    ReplicatorImpl::Ctrs().mRecoveryCount++;
+    if (op->chunkOffset < 0 ||
+            op->chunkOffset % int64_t(CHUNKSIZE) != 0 ||
+            ! ValidateStripeParameters(
+                op->striperType,
+                op->numStripes,
+                op->numRecoveryStripes,
+                op->stripeSize) ||
+            op->location.port <= 0) {
+        op->status = -EINVAL;
+        KFS_LOG_STREAM_ERROR << "replication:"
+            "invalid request: " << op->Show() <<
+        KFS_LOG_EOM;
+        ReplicatorImpl::Ctrs().mRecoveryErrorCount++;
+        SubmitOpResponse(op);
+        return;
+    }
+    RecoveryScheduler::Get().Enqueue(op);
+}
+
+static void
+StartReplicationOrRecovery(ReplicateChunkOp* op)
+{
     const char*       p = op->chunkServerAccess.GetPtr();
     const char* const e = p + op->chunkServerAccess.GetSize();
     while (p < e && (*p & 0xFF) <= ' ') {
@@ -1858,7 +2268,6 @@ Replicator::Run(ReplicateChunkOp* op)
     }
     ReplicatorImpl* impl = 0;
     if (op->location.IsValid()) {
-        ReplicatorImpl::Ctrs().mReplicationCount++;
         RemoteSyncSMPtr peer;
         const bool kKeyIsNotEncryptedFlag = true;
         if (ReplicatorImpl::GetUseConnectionPoolFlag()) {
@@ -1914,23 +2323,7 @@ Replicator::Run(ReplicateChunkOp* op)
             ReplicatorImpl::Ctrs().mReplicationErrorCount++;
         }
     } else {
-        ReplicatorImpl::Ctrs().mRecoveryCount++;
-        if (op->chunkOffset < 0 ||
-                op->chunkOffset % int64_t(CHUNKSIZE) != 0 ||
-                ! ValidateStripeParameters(
-                    op->striperType,
-                    op->numStripes,
-                    op->numRecoveryStripes,
-                    op->stripeSize) ||
-                op->location.port <= 0) {
-            op->status = -EINVAL;
-            KFS_LOG_STREAM_ERROR << "replication:"
-                "invalid request: " << op->Show() <<
-            KFS_LOG_EOM;
-            ReplicatorImpl::Ctrs().mRecoveryErrorCount++;
-        } else {
-            impl = RSReplicatorImpl::Create(op, token, tokenLen, key, keyLen);
-        }
+        impl = RSReplicatorImpl::Create(op, token, tokenLen, key, keyLen);
     }
     if (impl) {
         impl->Run();
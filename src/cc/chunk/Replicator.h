@@ -55,6 +55,10 @@ public:
         Counter mWriteCount;
         Counter mReadByteCount;
         Counter mWriteByteCount;
+        Counter mRecoveryQueueDepth;
+        Counter mRecoveryThrottledCount;
+        Counter mRecoveryByteCount;
+        Counter mRecoveryBytesPerSec;
         Counters()
             : mReplicationCount(0),
               mReplicationErrorCount(0),
@@ -66,7 +70,11 @@ public:
               mReadCount(0),
               mWriteCount(0),
               mReadByteCount(0),
-              mWriteByteCount(0)
+              mWriteByteCount(0),
+              mRecoveryQueueDepth(0),
+              mRecoveryThrottledCount(0),
+              mRecoveryByteCount(0),
+              mRecoveryBytesPerSec(0)
             {}
         void Reset()
             { *this = Counters(); }
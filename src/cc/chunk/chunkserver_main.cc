@@ -150,6 +150,8 @@ private:
     bool           mClientListenerIpV6OnlyFlag;
     int            mClientThreadCount;
     int            mFirstCpuIndex;
+    bool           mClientThreadNumaAwareFlag;
+    string         mClientLocalSocketDir;
     string         mChunkServerHostname;
     string         mClusterKey;
     string         mNodeId;
@@ -164,6 +166,8 @@ private:
           mClientListenerIpV6OnlyFlag(false),
           mClientThreadCount(0),
           mFirstCpuIndex(-1),
+          mClientThreadNumaAwareFlag(false),
+          mClientLocalSocketDir(),
           mChunkServerHostname(),
           mClusterKey(),
           mNodeId(),
@@ -234,9 +238,20 @@ ChunkServerMain::LoadParams(const char* fileName)
         "chunkServer.clientThreadCount", mClientThreadCount);
     mFirstCpuIndex = mProp.getValue(
         "chunkServer.clientThreadFirstCpuIndex", mFirstCpuIndex);
+    mClientThreadNumaAwareFlag = mProp.getValue(
+        "chunkServer.clientThreadNumaAware",
+        mClientThreadNumaAwareFlag ? 1 : 0) != 0;
     KFS_LOG_STREAM_INFO << "chunk server client thread count: " <<
         mClientThreadCount <<  " first cpu: " << mFirstCpuIndex <<
+        " numa aware: " << mClientThreadNumaAwareFlag <<
     KFS_LOG_EOM;
+    mClientLocalSocketDir = mProp.getValue(
+        "chunkServer.clientLocalSocketDir", mClientLocalSocketDir);
+    if (! mClientLocalSocketDir.empty()) {
+        KFS_LOG_STREAM_INFO << "chunk server client local socket dir: " <<
+            mClientLocalSocketDir <<
+        KFS_LOG_EOM;
+    }
 
     mChunkServerHostname = mProp.getValue("chunkServer.hostname",
         mChunkServerHostname);
@@ -417,7 +432,9 @@ ChunkServerMain::Run(int argc, char **argv)
                 mClientListenerIpV6OnlyFlag,
                 mChunkServerHostname,
                 mClientThreadCount,
-                mFirstCpuIndex)) {
+                mFirstCpuIndex,
+                mClientThreadNumaAwareFlag,
+                mClientLocalSocketDir)) {
         ret = gChunkServer.MainLoop(mChunkDirs, mProp) ? 0 : 1;
     }
     NetErrorSimulatorConfigure(globalNetManager());
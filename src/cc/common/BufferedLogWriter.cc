@@ -26,12 +26,14 @@
 
 #include "BufferedLogWriter.h"
 #include "Properties.h"
+#include "kfsatomic.h"
 
 #include "qcdio/QCMutex.h"
 #include "qcdio/QCUtils.h"
 #include "qcdio/qcstutils.h"
 #include "qcdio/qcdebug.h"
 #include "qcdio/QCThread.h"
+#include "qcdio/QCDLList.h"
 
 #include <fcntl.h>
 #include <unistd.h>
@@ -45,6 +47,7 @@
 #include <stdarg.h>
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
 
 #include <vector>
 #include <string>
@@ -81,6 +84,8 @@ const char* const kBufferedLogWriter_LogLevels[] = {
 const int64_t kLogWriterMinLogFileSize               = 16 << 10;
 const int64_t kLogWriterMinOpenRetryIntervalMicroSec = 10000;
 const int     kLogWriterMinLogBufferSize             = 16 << 10;
+const int     kLogWriterMinThreadBufferSize          = 4 << 10;
+const int     kLogWriterMaxThreadBufferSize          = 64 << 20;
 const int64_t kLogWirterDefaultTimeToKeepSecs        = 60 * 60 * 24 * 30;
 const int     kLogWriterDefaulOpenFlags              =
     O_CREAT | O_APPEND | O_WRONLY /* | O_SYNC */;
@@ -157,8 +162,19 @@ public:
           mCpuAffinityIndex(-1),
           mMaxMsgStreamCount(256),
           mMsgStreamCount(0),
-          mMsgStreamHeadPtr(0)
+          mMsgStreamHeadPtr(0),
+          mThreadBufferKey(),
+          mThreadBufferSize(0),
+          mThreadBufferCount(0),
+          mThreadBufferDroppedCount(0),
+          mDrainRequestCount(0)
     {
+        ThreadBuffer::List::Init(mThreadBuffersPtr);
+        const int theErr = pthread_key_create(
+            &mThreadBufferKey, &Impl::DetachThreadBuffer);
+        if (theErr) {
+            QCUtils::FatalError("pthread_key_create", theErr);
+        }
         if (! mFileName.empty()) {
             mLogFileNamePrefixes.push_back(mFileName);
         }
@@ -187,6 +203,14 @@ public:
     virtual ~Impl()
     {
         Impl::Stop();
+        const int theErr = pthread_key_delete(mThreadBufferKey);
+        if (theErr) {
+            QCUtils::FatalError("pthread_key_delete", theErr);
+        }
+        ThreadBuffer* theBufPtr;
+        while ((theBufPtr = ThreadBuffer::List::PopBack(mThreadBuffersPtr))) {
+            delete theBufPtr;
+        }
         delete [] mBuf0Ptr;
         while (mMsgStreamHeadPtr) {
             QCASSERT(mMsgStreamCount > 0);
@@ -237,6 +261,12 @@ public:
         mCpuAffinityIndex = inProps.getValue(
             inPropsPrefix + "cpuAffinityIndex",
             mCpuAffinityIndex);
+        const int theThreadBufferSize = inProps.getValue(
+            inPropsPrefix + "threadBufferSize",
+            (int)mThreadBufferSize);
+        mThreadBufferSize = theThreadBufferSize <= 0 ? 0 :
+            min(kLogWriterMaxThreadBufferSize,
+                max(kLogWriterMinThreadBufferSize, theThreadBufferSize));
         string theLogFilePrefixes;
         for (LogFileNames::const_iterator theIt =
                 mLogFileNamePrefixes.begin();
@@ -303,6 +333,7 @@ public:
         if (! mRunFlag) {
             return;
         }
+        DrainThreadBuffers();
         FlushSelf();
         mRunFlag = false;
         mWriteCond.Notify();
@@ -407,12 +438,17 @@ public:
     void Flush()
     {
         QCStMutexLocker theLocker(mMutex);
+        DrainThreadBuffers();
         FlushSelf();
     }
     void Sync()
     {
         QCStMutexLocker theLocker(mMutex);
-        while (! FlushSelf() || mWritePtr) {
+        for (; ;) {
+            const bool theDrainedFlag = DrainThreadBuffers();
+            if (FlushSelf() && theDrainedFlag && ! mWritePtr) {
+                break;
+            }
             mBufWaitersCount++;
             mWriteDoneCond.Wait(mMutex);
             mBufWaitersCount--;
@@ -448,11 +484,14 @@ public:
         Counters& outCounters)
     {
         QCStMutexLocker theLocker(mMutex);
-        outCounters.mAppendCount         = mMsgAppendCount;
-        outCounters.mDroppedCount        = mTotalDroppedCount;
-        outCounters.mWriteErrorCount     = mWriteErrCount;
-        outCounters.mAppendWaitCount     = mBufWaitedCount;
-        outCounters.mAppendWaitMicroSecs = mTotalLogWaitedTime;
+        UpdateThreadBuffersDroppedCount();
+        outCounters.mAppendCount              = mMsgAppendCount;
+        outCounters.mDroppedCount             = mTotalDroppedCount;
+        outCounters.mWriteErrorCount          = mWriteErrCount;
+        outCounters.mAppendWaitCount          = mBufWaitedCount;
+        outCounters.mAppendWaitMicroSecs      = mTotalLogWaitedTime;
+        outCounters.mThreadBufferCount        = mThreadBufferCount;
+        outCounters.mThreadBufferDroppedCount = mThreadBufferDroppedCount;
     }
     void PrepareToFork()
         { mMutex.Lock(); }
@@ -473,7 +512,23 @@ public:
         if (! mRunFlag) {
             return;
         }
+        ThreadBuffer* const theBufPtr = GetThreadBuffer();
+        if (theBufPtr) {
+            const int theMaxLen = theBufPtr->GetMaxMsgLength();
+            if (inWriter.GetMsgLength() < theMaxLen) {
+                const int theLen = inWriter.Write(
+                    theBufPtr->GetMsgBufferPtr(), theMaxLen + 1);
+                if (0 <= theLen && theLen <= theMaxLen) {
+                    theBufPtr->Put(Now(), inLogLevel,
+                        theBufPtr->GetMsgBufferPtr(), theLen);
+                    return;
+                }
+            }
+        }
         QCStMutexLocker theLocker(mMutex);
+        if (theBufPtr && ! DrainThreadBuffersBeforeAppend()) {
+            return;
+        }
         static va_list theArgs; // dummy
         AppendSelf(inLogLevel, &inWriter, 0, "", theArgs);
     }
@@ -485,7 +540,26 @@ public:
         if (! mRunFlag) {
             return;
         }
+        ThreadBuffer* const theBufPtr = GetThreadBuffer();
+        if (theBufPtr) {
+            // Keep the arguments for the shared buffer append, in the case if
+            // the message does not fit into the thread buffer.
+            va_list theArgs;
+            va_copy(theArgs, inArgs);
+            const int theMaxLen = theBufPtr->GetMaxMsgLength();
+            const int theLen    = ::vsnprintf(theBufPtr->GetMsgBufferPtr(),
+                theMaxLen + 1, inFmtStrPtr, theArgs);
+            va_end(theArgs);
+            if (0 <= theLen && theLen <= theMaxLen) {
+                theBufPtr->Put(Now(), inLogLevel,
+                    theBufPtr->GetMsgBufferPtr(), theLen);
+                return;
+            }
+        }
         QCStMutexLocker theLocker(mMutex);
+        if (theBufPtr && ! DrainThreadBuffersBeforeAppend()) {
+            return;
+        }
         AppendSelf(inLogLevel, 0, -1, inFmtStrPtr, inArgs);
     }
     void AppendSelf(
@@ -568,8 +642,13 @@ public:
                 0;
             if (inStrLen < 0) {
                 if (theMaxMsgLen > 0) {
+                    // The arguments are used again if the message does not
+                    // fit, and the buffer is flushed.
+                    va_list theArgs;
+                    va_copy(theArgs, inArgs);
                     theRet += ::vsnprintf(
-                        mCurPtr + theLen, theMaxMsgLen, inFmtStrPtr, inArgs);
+                        mCurPtr + theLen, theMaxMsgLen, inFmtStrPtr, theArgs);
+                    va_end(theArgs);
                 }
             } else {
                 theRet += inStrLen;
@@ -629,18 +708,24 @@ public:
         );
         for (; ;) {
             while (mRunFlag && ! mWritePtr) {
-                const QCMutex::Time theTimeoutNanoSecs = NanoSec(max(
-                    QCMutex::Time(10000),
-                    (QCMutex::Time)(mFlushInterval > 0 ?
-                        mFlushInterval / 2 : Time(500000))
-                ));
-                mWriteCond.Wait(mMutex, theTimeoutNanoSecs);
-                if (mWritePtr) {
-                    break;
+                if (SyncAddAndFetch(mDrainRequestCount, int64_t(0)) <= 0) {
+                    const QCMutex::Time theTimeoutNanoSecs = NanoSec(max(
+                        QCMutex::Time(10000),
+                        (QCMutex::Time)(mFlushInterval > 0 ?
+                            mFlushInterval / 2 : Time(500000))
+                    ));
+                    mWriteCond.Wait(mMutex, theTimeoutNanoSecs);
+                    if (mWritePtr) {
+                        break;
+                    }
                 }
                 int64_t theSec      = 0;
                 int64_t theMicroSec = 0;
                 Now(theSec, theMicroSec);
+                DrainThreadBuffers();
+                if (mWritePtr) {
+                    break;
+                }
                 FlushIfNeeded(theSec, theMicroSec);
                 RunTimers(theSec, theMicroSec);
                 if (mDeleteOldLogsFlag && mMaxLogFiles > 0) {
@@ -651,6 +736,10 @@ public:
                 }
             }
             if (! mWritePtr && ! mRunFlag) {
+                // Write out the remaining thread buffers records, if any.
+                if (! DrainThreadBuffers() || ! FlushSelf() || mWritePtr) {
+                    continue;
+                }
                 QCASSERT(mBufWaitersCount <= 0);
                 break;
             }
@@ -810,6 +899,13 @@ public:
             return *(new MsgStream(
                 inLogLevel, inDiscardFlag, inTeeStreamPtr));
         }
+        ThreadBuffer* const theBufPtr = GetThreadBuffer();
+        if (theBufPtr && theBufPtr->mStreamPtr) {
+            MsgStream* const theRetPtr = theBufPtr->mStreamPtr;
+            theBufPtr->mStreamPtr = 0;
+            theRetPtr->Clear(inLogLevel, inDiscardFlag, inTeeStreamPtr);
+            return *theRetPtr;
+        }
         QCStMutexLocker theLocker(mMutex);
         MsgStream* theRetPtr = mMsgStreamHeadPtr;
         if (theRetPtr) {
@@ -832,10 +928,27 @@ public:
             delete &theStream;
             return;
         }
+        ThreadBuffer* const theBufPtr = GetThreadBuffer();
+        if (theBufPtr && (theStream.IsDiscard() ||
+                theStream.GetMsgLength() <= theBufPtr->GetMaxMsgLength())) {
+            if (! theStream.IsDiscard()) {
+                theBufPtr->Put(Now(), theStream.GetLogLevel(),
+                    theStream.GetMsgPtr(), theStream.GetMsgLength());
+            }
+            if (! theBufPtr->mStreamPtr) {
+                theStream.ClearTeeStreamPtr();
+                theStream.tie(0);
+                theBufPtr->mStreamPtr = &theStream;
+                return;
+            }
+        }
         QCStMutexLocker theLocker(mMutex);
-        if (! theStream.IsDiscard()) {
-            AppendSelf(theStream.GetLogLevel(),
-                theStream.GetMsgPtr(), theStream.GetMsgLength());
+        if (! theStream.IsDiscard() && (! theBufPtr ||
+                theBufPtr->GetMaxMsgLength() < theStream.GetMsgLength())) {
+            if (! theBufPtr || DrainThreadBuffersBeforeAppend()) {
+                AppendSelf(theStream.GetLogLevel(),
+                    theStream.GetMsgPtr(), theStream.GetMsgLength());
+            }
         }
         if (mMsgStreamCount < mMaxMsgStreamCount) {
             theStream.ClearTeeStreamPtr();
@@ -955,6 +1068,137 @@ private:
         MsgStream& operator=(
             const MsgStream&);
     };
+    struct RecordHeader
+    {
+        Time    mTime;
+        int32_t mLogLevel;
+        int32_t mLength; // Negative -- padding to the end of the buffer.
+    };
+    // Single producer single consumer ring buffer. The owning thread appends
+    // records without locking, and the records are moved into the shared
+    // buffer by the writer thread, or by flush / sync with the mutex held.
+    // If the ring buffer is full the record is dropped.
+    class ThreadBuffer
+    {
+    public:
+        typedef QCDLList<ThreadBuffer> List;
+
+        ThreadBuffer(
+            Impl& inImpl,
+            int   inSize,
+            int   inMaxMsgLength)
+            : mImpl(inImpl),
+              mStreamPtr(0),
+              mDetachedFlag(false),
+              mReportedDroppedCount(0),
+              mSize((inSize + kAlign - 1) / kAlign * kAlign),
+              mMaxMsgLength(inMaxMsgLength),
+              mBufPtr(new char[mSize + mMaxMsgLength + 1]),
+              mHead(0),
+              mTail(0),
+              mDroppedCount(0),
+              mHeadCache(0)
+            { List::Init(*this); }
+        ~ThreadBuffer()
+        {
+            delete mStreamPtr;
+            delete [] mBufPtr;
+        }
+        int GetMaxMsgLength() const
+            { return mMaxMsgLength; }
+        char* GetMsgBufferPtr()
+            { return (mBufPtr + mSize); }
+        bool Put(
+            Time        inTime,
+            LogLevel    inLogLevel,
+            const char* inMsgPtr,
+            int         inMsgLength)
+        {
+            const int64_t theRecSize  = RecordSize(inMsgLength);
+            const int64_t theTail     = SyncAddAndFetch(mTail, int64_t(0));
+            const int64_t thePos      = mHead % mSize;
+            const int64_t theTailRoom = mSize - thePos;
+            const int64_t thePadSize  =
+                theTailRoom < theRecSize ? theTailRoom : 0;
+            const int64_t theUsed     = mHead - theTail;
+            if (mSize - theUsed < thePadSize + theRecSize) {
+                SyncAddAndFetch(mDroppedCount, int64_t(1));
+                mImpl.RequestDrain();
+                return false;
+            }
+            if ((int64_t)sizeof(RecordHeader) <= thePadSize) {
+                reinterpret_cast<RecordHeader*>(mBufPtr + thePos)->mLength =
+                    -1;
+            }
+            RecordHeader& theHdr = *reinterpret_cast<RecordHeader*>(
+                mBufPtr + (0 < thePadSize ? 0 : thePos));
+            theHdr.mTime     = inTime;
+            theHdr.mLogLevel = inLogLevel;
+            theHdr.mLength   = inMsgLength;
+            memcpy(&theHdr + 1, inMsgPtr, inMsgLength);
+            SyncAddAndFetch(mHead, thePadSize + theRecSize);
+            if (mSize < 2 * (theUsed + thePadSize + theRecSize)) {
+                mImpl.RequestDrain();
+            }
+            return true;
+        }
+        const RecordHeader* Front()
+        {
+            if (mHeadCache <= mTail) {
+                mHeadCache = SyncAddAndFetch(mHead, int64_t(0));
+            }
+            while (mTail < mHeadCache) {
+                const int64_t thePos      = mTail % mSize;
+                const int64_t theTailRoom = mSize - thePos;
+                const RecordHeader* const theHdrPtr =
+                    reinterpret_cast<const RecordHeader*>(mBufPtr + thePos);
+                if (theTailRoom < (int64_t)sizeof(RecordHeader) ||
+                        theHdrPtr->mLength < 0) {
+                    SyncAddAndFetch(mTail, theTailRoom);
+                    continue;
+                }
+                return theHdrPtr;
+            }
+            return 0;
+        }
+        void Pop(
+            const RecordHeader& inHdr)
+            { SyncAddAndFetch(mTail, RecordSize(inHdr.mLength)); }
+        bool IsEmpty()
+            { return (! Front()); }
+        int64_t GetDroppedCount()
+            { return SyncAddAndFetch(mDroppedCount, int64_t(0)); }
+
+        Impl&      mImpl;
+        MsgStream* mStreamPtr;
+        bool       mDetachedFlag;
+        int64_t    mReportedDroppedCount;
+    private:
+        enum { kAlign = 8 };
+
+        const int64_t    mSize;
+        const int        mMaxMsgLength;
+        char* const      mBufPtr;
+        volatile int64_t mHead;
+        volatile int64_t mTail;
+        volatile int64_t mDroppedCount;
+        int64_t          mHeadCache; // Consumer's last seen head.
+        ThreadBuffer*    mPrevPtr[1];
+        ThreadBuffer*    mNextPtr[1];
+
+        static int64_t RecordSize(
+            int inMsgLength)
+        {
+            return ((int64_t)(sizeof(RecordHeader) + inMsgLength +
+                kAlign - 1) / kAlign * kAlign);
+        }
+        friend class QCDLListOp<ThreadBuffer>;
+    private:
+        ThreadBuffer(
+            const ThreadBuffer&);
+        ThreadBuffer& operator=(
+            const ThreadBuffer&);
+    };
 
     QCMutex      mMutex;
     QCCondVar    mWriteCond;
@@ -1011,6 +1255,12 @@ private:
     int          mMaxMsgStreamCount;
     int          mMsgStreamCount;
     MsgStream*   mMsgStreamHeadPtr;
+    pthread_key_t    mThreadBufferKey;
+    volatile int     mThreadBufferSize;
+    int              mThreadBufferCount;
+    Count            mThreadBufferDroppedCount;
+    volatile int64_t mDrainRequestCount;
+    ThreadBuffer*    mThreadBuffersPtr[1];
     char         mLogTimeStampPrefixStr[256];
 
     static inline Time Seconds(
@@ -1054,6 +1304,210 @@ private:
     }
     size_t GetMaxRecordSize() const
         { return (mMaxAppendLength + mTruncatedSuffix.size() + 1); }
+    ThreadBuffer* GetThreadBuffer()
+    {
+        if (mThreadBufferSize <= 0) {
+            return 0;
+        }
+        ThreadBuffer* thePtr = reinterpret_cast<ThreadBuffer*>(
+            pthread_getspecific(mThreadBufferKey));
+        if (thePtr) {
+            return thePtr;
+        }
+        QCStMutexLocker theLocker(mMutex);
+        const int theSize = mThreadBufferSize;
+        if (theSize <= 0 || ! mRunFlag) {
+            return 0;
+        }
+        thePtr = new ThreadBuffer(*this, theSize,
+            min(theSize / 4, mBufSize / 2));
+        const int theErr = pthread_setspecific(mThreadBufferKey, thePtr);
+        if (theErr) {
+            QCUtils::FatalError("pthread_setspecific", theErr);
+        }
+        ThreadBuffer::List::PushBack(mThreadBuffersPtr, *thePtr);
+        mThreadBufferCount++;
+        return thePtr;
+    }
+    static void DetachThreadBuffer(
+        void* inBufPtr)
+    {
+        ThreadBuffer& theBuf = *reinterpret_cast<ThreadBuffer*>(inBufPtr);
+        Impl&         theImpl = theBuf.mImpl;
+        QCStMutexLocker theLocker(theImpl.mMutex);
+        delete theBuf.mStreamPtr;
+        theBuf.mStreamPtr    = 0;
+        theBuf.mDetachedFlag = true;
+        // Keep the buffer until the writer moves the remaining records.
+        if (theBuf.IsEmpty()) {
+            theImpl.RemoveThreadBuffer(theBuf);
+        }
+    }
+    void RemoveThreadBuffer(
+        ThreadBuffer& inBuf)
+    {
+        QCASSERT(mMutex.IsOwned());
+        const int64_t theDelta =
+            inBuf.GetDroppedCount() - inBuf.mReportedDroppedCount;
+        mTotalDroppedCount        += theDelta;
+        mThreadBufferDroppedCount += theDelta;
+        ThreadBuffer::List::Remove(mThreadBuffersPtr, inBuf);
+        mThreadBufferCount--;
+        delete &inBuf;
+    }
+    void RequestDrain()
+    {
+        // Wake up the writer once, the remaining requests are coalesced
+        // until the next drain. The writer wakes up periodically anyway, thus
+        // the condition notify race with no mutex held is benign.
+        if (SyncAddAndFetch(mDrainRequestCount, int64_t(1)) == 1) {
+            mWriteCond.Notify();
+        }
+    }
+    void UpdateThreadBuffersDroppedCount()
+    {
+        ThreadBuffer::List::Iterator theIt(mThreadBuffersPtr);
+        ThreadBuffer*                thePtr;
+        while ((thePtr = theIt.Next())) {
+            const int64_t theCount = thePtr->GetDroppedCount();
+            const int64_t theDelta = theCount - thePtr->mReportedDroppedCount;
+            if (0 < theDelta) {
+                thePtr->mReportedDroppedCount = theCount;
+                mDroppedCount             += theDelta;
+                mTotalDroppedCount        += theDelta;
+                mThreadBufferDroppedCount += theDelta;
+            }
+        }
+    }
+    // Move thread buffers records into the shared buffer in time stamp order.
+    // Returns false if the shared buffer is full, and the write is in
+    // progress.
+    bool DrainThreadBuffers()
+    {
+        QCASSERT(mMutex.IsOwned());
+        if (ThreadBuffer::List::IsEmpty(mThreadBuffersPtr)) {
+            return true;
+        }
+        const int64_t theRequestCount =
+            SyncAddAndFetch(mDrainRequestCount, int64_t(0));
+        if (0 < theRequestCount) {
+            SyncAddAndFetch(mDrainRequestCount, -theRequestCount);
+        }
+        UpdateThreadBuffersDroppedCount();
+        for (; ;) {
+            ThreadBuffer*       theMinPtr    = 0;
+            const RecordHeader* theMinRecPtr = 0;
+            Time                theNextTime  = 0;
+            bool                theNextFlag  = false;
+            ThreadBuffer::List::Iterator theIt(mThreadBuffersPtr);
+            ThreadBuffer*                thePtr;
+            while ((thePtr = theIt.Next())) {
+                const RecordHeader* const theRecPtr = thePtr->Front();
+                if (! theRecPtr) {
+                    continue;
+                }
+                if (! theMinRecPtr || theRecPtr->mTime < theMinRecPtr->mTime) {
+                    if (theMinRecPtr) {
+                        theNextTime = theNextFlag ?
+                            min(theNextTime, theMinRecPtr->mTime) :
+                            theMinRecPtr->mTime;
+                        theNextFlag = true;
+                    }
+                    theMinPtr    = thePtr;
+                    theMinRecPtr = theRecPtr;
+                } else {
+                    theNextTime = theNextFlag ?
+                        min(theNextTime, theRecPtr->mTime) : theRecPtr->mTime;
+                    theNextFlag = true;
+                }
+            }
+            if (! theMinPtr) {
+                break;
+            }
+            // Take records from the same buffer while these precede the
+            // oldest record in all other buffers.
+            do {
+                if (! AppendRecord(*theMinRecPtr)) {
+                    return false;
+                }
+                theMinPtr->Pop(*theMinRecPtr);
+            } while ((theMinRecPtr = theMinPtr->Front()) &&
+                (! theNextFlag || theMinRecPtr->mTime <= theNextTime));
+        }
+        for (int i = mThreadBufferCount; 0 < i; i--) {
+            ThreadBuffer& theBuf = *ThreadBuffer::List::Front(mThreadBuffersPtr);
+            ThreadBuffer::List::PushBack(mThreadBuffersPtr,
+                *ThreadBuffer::List::PopFront(mThreadBuffersPtr));
+            if (theBuf.mDetachedFlag && theBuf.IsEmpty()) {
+                RemoveThreadBuffer(theBuf);
+            }
+        }
+        return true;
+    }
+    // Moves the thread buffers records into the shared buffer ahead of the
+    // calling thread's record that does not fit into its thread buffer, in
+    // order to preserve the thread's records order. Waits for the in flight
+    // write, if the shared buffer is full, for up to the max log wait time.
+    // Returns false, and counts the record as dropped, if the records cannot
+    // be moved.
+    bool DrainThreadBuffersBeforeAppend()
+    {
+        Time theStart      = 0;
+        Time theTimeWaited = 0;
+        while (! DrainThreadBuffers()) {
+            if (mMaxLogWaitTime <= theTimeWaited || ! mRunFlag) {
+                mDroppedCount++;
+                mTotalDroppedCount++;
+                if (0 < mBufWaitersCount) {
+                    mWriteDoneCond.Notify(); // Wake next thread.
+                }
+                return false;
+            }
+            if (theStart <= 0) {
+                theStart = Now();
+            }
+            mBufWaitersCount++;
+            mWriteDoneCond.Wait(mMutex,
+                NanoSec(mMaxLogWaitTime - theTimeWaited));
+            mBufWaitersCount--;
+            mBufWaitedCount++;
+            mTotalLogWaitedTime -= theTimeWaited;
+            theTimeWaited = Now() - theStart;
+            mTotalLogWaitedTime += theTimeWaited;
+        }
+        return true;
+    }
+    bool AppendRecord(
+        const RecordHeader& inRec)
+    {
+        const int64_t     theSec      = inRec.mTime / 1000000;
+        const int64_t     theMicroSec = inRec.mTime % 1000000;
+        const size_t      theMsgLen   = (size_t)inRec.mLength;
+        const char* const theMsgPtr   =
+            reinterpret_cast<const char*>(&inRec + 1);
+        for (int i = 0; ; i++) {
+            const size_t theLen = MsgPrefix(
+                theSec, theMicroSec, (LogLevel)inRec.mLogLevel);
+            if (0 < theLen && mCurPtr + theLen + theMsgLen < mEndPtr) {
+                memcpy(mCurPtr + theLen, theMsgPtr, theMsgLen);
+                mCurPtr += theLen + theMsgLen;
+                *mCurPtr++ = '\n';
+                mDroppedCount    = 0;
+                mCurLogWatedTime = 0;
+                mMsgAppendCount++;
+                return true;
+            }
+            if (0 < i || mCurPtr <= mBufPtr) {
+                // Does not fit into empty buffer.
+                mDroppedCount++;
+                mTotalDroppedCount++;
+                return true;
+            }
+            if (! FlushSelf()) {
+                return false;
+            }
+        }
+    }
     static void DeleteOldLogsFiles(
         string   inFileName,
         int64_t  inMinModTimeSec,
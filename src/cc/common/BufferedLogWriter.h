@@ -46,6 +46,11 @@ class Properties;
 // need to prevent blocking on message log write with "bad" disks in the cases
 // where the disk becomes unavailable or just cannot keep up. Chunk and meta
 // servers message log writes are configured with 0 write wait time by default.
+// With "threadBufferSize" parameter set, each thread appends log records into
+// its own ring buffer with no locking, and the writer thread merges the thread
+// buffers records into the log in time stamp order. The records are dropped
+// when the thread buffer is full, and the records that do not fit into the
+// thread buffer are appended into the shared buffer.
 class BufferedLogWriter
 {
 public:
@@ -70,6 +75,8 @@ public:
         int64_t mWriteErrorCount;
         int64_t mAppendWaitCount;
         int64_t mAppendWaitMicroSecs;
+        int64_t mThreadBufferCount;
+        int64_t mThreadBufferDroppedCount;
     };
     BufferedLogWriter(
         int         inFd                        = -1,
@@ -22,14 +22,18 @@
 //
 // \file FdWriter.h
 // \brief Basic file descriptor writer which can be used with MdStreamT.
-//
+// Optionally limits the write rate, in order to not starve other file system
+// users, for example transaction log writes.
 //----------------------------------------------------------------------------
 
 #ifndef FD_WRITER_H
 #define FD_WRITER_H
 
+#include "time.h"
+
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
 
 namespace KFS
 {
@@ -40,7 +44,10 @@ public:
     FdWriter(
         int inFd)
         : mFd(inFd),
-          mError(0)
+          mError(0),
+          mMaxWriteRate(0),
+          mStartTime(0),
+          mWrittenCount(0)
         {}
     ~FdWriter()
         {}
@@ -58,10 +65,26 @@ public:
                 mError = errno;
                 return false;
             }
-            thePtr += theNWr;
+            if (0 < theNWr) {
+                thePtr += theNWr;
+                if (0 < mMaxWriteRate) {
+                    Throttle(theNWr);
+                }
+            }
         }
         return true;
     }
+    void SetMaxWriteRate(
+        int64_t inBytesPerSec)
+    {
+        mMaxWriteRate = inBytesPerSec;
+        mStartTime    = 0;
+        mWrittenCount = 0;
+    }
+    int64_t GetMaxWriteRate() const
+        { return mMaxWriteRate; }
+    int64_t GetWrittenCount() const
+        { return mWrittenCount; }
     void ClearError()
         { mError = 0; }
     int GetError() const
@@ -69,6 +92,30 @@ public:
 private:
     const int mFd;
     int       mError;
+    int64_t   mMaxWriteRate;
+    int64_t   mStartTime;
+    int64_t   mWrittenCount;
+
+    void Throttle(
+        size_t inLength)
+    {
+        const int64_t kMicroseconds = 1000 * 1000;
+        const int64_t theNow        = microseconds();
+        if (mWrittenCount <= 0) {
+            mStartTime = theNow;
+        }
+        mWrittenCount += (int64_t)inLength;
+        const int64_t theWait = mWrittenCount * kMicroseconds / mMaxWriteRate -
+            (theNow - mStartTime);
+        if (theWait <= 0) {
+            return;
+        }
+        struct timespec theTs;
+        theTs.tv_sec  = (time_t)(theWait / kMicroseconds);
+        theTs.tv_nsec = (long)(theWait % kMicroseconds * 1000);
+        while (nanosleep(&theTs, &theTs) != 0 && errno == EINTR)
+            {}
+    }
 };
 
 }
@@ -0,0 +1,208 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// Log linear (HDR style) histogram of non negative integer values. Values
+// less than 2 * kSubBucketCount have their own buckets, larger values are
+// grouped into kSubBucketCount buckets per power of two, with max. relative
+// error 1 / kSubBucketCount. Values larger than kMaxValue are counted in the
+// last bucket. Add() is constant time, and does not allocate memory.
+//
+//----------------------------------------------------------------------------
+
+#ifndef KFS_COMMON_LATENCY_HISTOGRAM_H
+#define KFS_COMMON_LATENCY_HISTOGRAM_H
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <ostream>
+
+namespace KFS
+{
+using std::ostream;
+
+class LatencyHistogram
+{
+public:
+    enum { kSubBucketBits  = 3 };
+    enum { kSubBucketCount = 1 << kSubBucketBits };
+    enum { kMaxExponent    = 36 };
+    enum { kBucketCount    =
+        (kMaxExponent - kSubBucketBits + 1) * kSubBucketCount };
+    static const int64_t kMaxValue = (int64_t(1) << kMaxExponent) - 1;
+
+    LatencyHistogram()
+        { Clear(); }
+    void Clear()
+    {
+        memset(mBuckets, 0, sizeof(mBuckets));
+        mCount    = 0;
+        mTotal    = 0;
+        mMin      = 0;
+        mMax      = 0;
+        mFirstIdx = kBucketCount;
+        mLastIdx  = -1;
+    }
+    void Add(
+        int64_t inValue)
+    {
+        const int64_t theValue = inValue < 0 ? int64_t(0) : inValue;
+        const int     theIdx   = GetBucketIndex(theValue);
+        mBuckets[theIdx]++;
+        if (mCount <= 0) {
+            mMin = theValue;
+            mMax = theValue;
+        } else if (theValue < mMin) {
+            mMin = theValue;
+        } else if (mMax < theValue) {
+            mMax = theValue;
+        }
+        mCount++;
+        mTotal += theValue;
+        if (theIdx < mFirstIdx) {
+            mFirstIdx = theIdx;
+        }
+        if (mLastIdx < theIdx) {
+            mLastIdx = theIdx;
+        }
+    }
+    void Merge(
+        const LatencyHistogram& inHistogram)
+    {
+        if (inHistogram.mCount <= 0) {
+            return;
+        }
+        for (int i = inHistogram.mFirstIdx; i <= inHistogram.mLastIdx; i++) {
+            mBuckets[i] += inHistogram.mBuckets[i];
+        }
+        if (mCount <= 0 || inHistogram.mMin < mMin) {
+            mMin = inHistogram.mMin;
+        }
+        if (mCount <= 0 || mMax < inHistogram.mMax) {
+            mMax = inHistogram.mMax;
+        }
+        mCount += inHistogram.mCount;
+        mTotal += inHistogram.mTotal;
+        if (inHistogram.mFirstIdx < mFirstIdx) {
+            mFirstIdx = inHistogram.mFirstIdx;
+        }
+        if (mLastIdx < inHistogram.mLastIdx) {
+            mLastIdx = inHistogram.mLastIdx;
+        }
+    }
+    int64_t GetCount() const
+        { return mCount; }
+    int64_t GetTotal() const
+        { return mTotal; }
+    int64_t GetMin() const
+        { return mMin; }
+    int64_t GetMax() const
+        { return mMax; }
+    int64_t GetMean() const
+        { return (mCount <= 0 ? int64_t(0) : mTotal / mCount); }
+    // Returns the upper bound of the bucket that contains the specified
+    // percentile, or max. value if it is less than the upper bound.
+    int64_t GetPercentile(
+        double inPercentile) const
+    {
+        if (mCount <= 0) {
+            return 0;
+        }
+        int64_t theRank = (int64_t)(inPercentile * mCount / 100. + .5);
+        if (theRank < 1) {
+            theRank = 1;
+        }
+        int64_t theSum = 0;
+        for (int i = mFirstIdx; i <= mLastIdx; i++) {
+            theSum += mBuckets[i];
+            if (theRank <= theSum) {
+                const int64_t theVal = GetBucketUpperBound(i);
+                return (mMax < theVal ? mMax : theVal);
+            }
+        }
+        return mMax;
+    }
+    // Space separated list of non empty buckets: <lower bound>:<count>
+    ostream& Display(
+        ostream& inStream) const
+    {
+        const char* theDelimPtr = "";
+        for (int i = mFirstIdx; i <= mLastIdx; i++) {
+            if (mBuckets[i] <= 0) {
+                continue;
+            }
+            inStream << theDelimPtr << GetBucketLowerBound(i) << ":" <<
+                mBuckets[i];
+            theDelimPtr = " ";
+        }
+        return inStream;
+    }
+    static int GetBucketIndex(
+        int64_t inValue)
+    {
+        if (inValue < 2 * kSubBucketCount) {
+            return (int)(inValue < 0 ? int64_t(0) : inValue);
+        }
+        if (kMaxValue < inValue) {
+            return (kBucketCount - 1);
+        }
+        // Find the most significant bit.
+        int     theExp = kSubBucketBits + 1;
+        int64_t theVal = inValue >> (kSubBucketBits + 2);
+        while (0 < theVal) {
+            theVal >>= 1;
+            theExp++;
+        }
+        const int theShift = theExp - kSubBucketBits;
+        return ((theShift + 1) * kSubBucketCount +
+            (int)((inValue >> theShift) & (kSubBucketCount - 1)));
+    }
+    static int64_t GetBucketLowerBound(
+        int inIdx)
+    {
+        if (inIdx < 2 * kSubBucketCount) {
+            return inIdx;
+        }
+        const int theShift = inIdx / kSubBucketCount - 1;
+        return ((int64_t)(kSubBucketCount + inIdx % kSubBucketCount) <<
+            theShift);
+    }
+    static int64_t GetBucketUpperBound(
+        int inIdx)
+    {
+        if (kBucketCount - 1 <= inIdx) {
+            return kMaxValue;
+        }
+        return (GetBucketLowerBound(inIdx + 1) - 1);
+    }
+private:
+    int64_t mBuckets[kBucketCount];
+    int64_t mCount;
+    int64_t mTotal;
+    int64_t mMin;
+    int64_t mMax;
+    int     mFirstIdx;
+    int     mLastIdx;
+};
+
+} // namespace KFS
+
+#endif /* KFS_COMMON_LATENCY_HISTOGRAM_H */
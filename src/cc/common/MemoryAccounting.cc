@@ -0,0 +1,185 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \file MemoryAccounting.cc
+// \brief Per subsystem memory accounting.
+//
+//----------------------------------------------------------------------------
+
+#include "MemoryAccounting.h"
+#include "ThreadCacheAllocator.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ostream>
+
+namespace KFS
+{
+
+// The thread counters list, and the totals of the exited threads are
+// protected by the statically initialized mutex, and the key is created with
+// pthread_once, as accounting can be invoked by static constructors.
+static pthread_mutex_t             sMemoryAccountingMutex =
+    PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t              sMemoryAccountingInitOnce =
+    PTHREAD_ONCE_INIT;
+static pthread_key_t               sMemoryAccountingKey;
+static MemoryAccounting::Counters  sMemoryAccountingExited;
+static void*                       sMemoryAccountingListPtr = 0;
+
+__thread MemoryAccounting::ThreadCounters*
+    MemoryAccounting::sThreadCountersPtr = 0;
+
+    /* static */ void
+MemoryAccounting::Init()
+{
+    if (pthread_key_create(&sMemoryAccountingKey,
+            &MemoryAccounting::ThreadExit)) {
+        abort();
+    }
+}
+
+    /* static */ MemoryAccounting::ThreadCounters&
+MemoryAccounting::GetThreadCounters()
+{
+    pthread_once(&sMemoryAccountingInitOnce, &MemoryAccounting::Init);
+    ThreadCounters* const thePtr =
+        static_cast<ThreadCounters*>(malloc(sizeof(ThreadCounters)));
+    if (! thePtr) {
+        abort();
+    }
+    thePtr->Clear();
+    pthread_mutex_lock(&sMemoryAccountingMutex);
+    ThreadCounters* const theHeadPtr =
+        static_cast<ThreadCounters*>(sMemoryAccountingListPtr);
+    thePtr->mPrevPtr = 0;
+    thePtr->mNextPtr = theHeadPtr;
+    if (theHeadPtr) {
+        theHeadPtr->mPrevPtr = thePtr;
+    }
+    sMemoryAccountingListPtr = thePtr;
+    pthread_mutex_unlock(&sMemoryAccountingMutex);
+    pthread_setspecific(sMemoryAccountingKey, thePtr);
+    sThreadCountersPtr = thePtr;
+    return *thePtr;
+}
+
+    /* static */ void
+MemoryAccounting::ThreadExit(
+    void* inCountersPtr)
+{
+    ThreadCounters* const thePtr = static_cast<ThreadCounters*>(inCountersPtr);
+    if (! thePtr) {
+        return;
+    }
+    if (sThreadCountersPtr == thePtr) {
+        sThreadCountersPtr = 0;
+    }
+    pthread_mutex_lock(&sMemoryAccountingMutex);
+    for (int i = 0; i < kSubsystemCount; i++) {
+        sMemoryAccountingExited.mBytes[i] += thePtr->mBytes[i];
+        sMemoryAccountingExited.mCount[i] += thePtr->mCount[i];
+    }
+    if (thePtr->mPrevPtr) {
+        thePtr->mPrevPtr->mNextPtr = thePtr->mNextPtr;
+    } else {
+        sMemoryAccountingListPtr = thePtr->mNextPtr;
+    }
+    if (thePtr->mNextPtr) {
+        thePtr->mNextPtr->mPrevPtr = thePtr->mPrevPtr;
+    }
+    pthread_mutex_unlock(&sMemoryAccountingMutex);
+    free(thePtr);
+}
+
+    /* static */ void
+MemoryAccounting::GetCounters(
+    MemoryAccounting::Counters& outCounters)
+{
+    // The other threads' counters are read without synchronization, the
+    // result is approximate.
+    pthread_mutex_lock(&sMemoryAccountingMutex);
+    outCounters = sMemoryAccountingExited;
+    for (const ThreadCounters* thePtr =
+                static_cast<const ThreadCounters*>(sMemoryAccountingListPtr);
+            thePtr;
+            thePtr = thePtr->mNextPtr) {
+        for (int i = 0; i < kSubsystemCount; i++) {
+            outCounters.mBytes[i] += thePtr->mBytes[i];
+            outCounters.mCount[i] += thePtr->mCount[i];
+        }
+    }
+    pthread_mutex_unlock(&sMemoryAccountingMutex);
+}
+
+    /* static */ const char*
+MemoryAccounting::GetName(
+    int inSubsystem)
+{
+    switch (inSubsystem) {
+        case kSubsystemOther:     return "other";
+        case kSubsystemTreeNodes: return "tree-nodes";
+        case kSubsystemCSMap:     return "cs-map";
+        case kSubsystemLeases:    return "leases";
+        case kSubsystemIOBuffers: return "io-buffers";
+        case kSubsystemRequests:  return "requests";
+        case kSubsystemCaches:    return "caches";
+        default:                  break;
+    }
+    return "none";
+}
+
+    /* static */ ostream&
+MemoryAccounting::Show(
+    ostream&    inStream,
+    const char* inSeparatorPtr,
+    const char* inDelimiterPtr)
+{
+    const char* const theSepPtr   = inSeparatorPtr ? inSeparatorPtr : ": ";
+    const char* const theDelimPtr = inDelimiterPtr ? inDelimiterPtr : "\n";
+    Counters theCounters;
+    GetCounters(theCounters);
+    for (int i = 0; i < kSubsystemCount; i++) {
+        const char* const theNamePtr = GetName(i);
+        inStream <<
+            "Mem-" << theNamePtr << "-bytes" << theSepPtr <<
+                theCounters.mBytes[i] << theDelimPtr <<
+            "Mem-" << theNamePtr << "-count" << theSepPtr <<
+                theCounters.mCount[i] << theDelimPtr;
+    }
+    ThreadCache::Counters theTcCounters;
+    ThreadCache::GetCounters(theTcCounters);
+    inStream <<
+        "Mem-thread-cache-storage-bytes" << theSepPtr <<
+            theTcCounters.mStorageBytes << theDelimPtr <<
+        "Mem-thread-caches" << theSepPtr <<
+            theTcCounters.mThreadCacheCount << theDelimPtr <<
+        "Mem-thread-cache-refills" << theSepPtr <<
+            theTcCounters.mRefillCount << theDelimPtr <<
+        "Mem-thread-cache-releases" << theSepPtr <<
+            theTcCounters.mReleaseCount << theDelimPtr
+    ;
+    return inStream;
+}
+
+} // namespace KFS
@@ -0,0 +1,142 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \file MemoryAccounting.h
+// \brief Per subsystem memory accounting.
+//
+//----------------------------------------------------------------------------
+
+#ifndef COMMON_MEMORY_ACCOUNTING_H
+#define COMMON_MEMORY_ACCOUNTING_H
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <ostream>
+
+namespace KFS
+{
+using std::ostream;
+
+// Memory held by the allocators and objects tagged with a subsystem. The
+// counters are per thread, in order to avoid atomic operations and cache line
+// sharing in the allocation path, and are summed when read. Pool allocators
+// account the pool storage, and the objects in use.
+class MemoryAccounting
+{
+public:
+    enum Subsystem
+    {
+        kSubsystemNone      = -1,
+        kSubsystemOther     = 0,
+        kSubsystemTreeNodes = 1,
+        kSubsystemCSMap     = 2,
+        kSubsystemLeases    = 3,
+        kSubsystemIOBuffers = 4,
+        kSubsystemRequests  = 5,
+        kSubsystemCaches    = 6,
+        kSubsystemCount     = 7
+    };
+    struct Counters
+    {
+        typedef int64_t Counter;
+
+        Counter mBytes[kSubsystemCount];
+        Counter mCount[kSubsystemCount];
+
+        void Clear()
+        {
+            for (int i = 0; i < kSubsystemCount; i++) {
+                mBytes[i] = 0;
+                mCount[i] = 0;
+            }
+        }
+    };
+
+    static void Update(
+        int     inSubsystem,
+        int64_t inBytes,
+        int64_t inCount)
+    {
+        ThreadCounters* const thePtr = sThreadCountersPtr;
+        ThreadCounters&       theCounters = thePtr ? *thePtr :
+            GetThreadCounters();
+        theCounters.mBytes[inSubsystem] += inBytes;
+        theCounters.mCount[inSubsystem] += inCount;
+    }
+    static void Allocated(
+        int    inSubsystem,
+        size_t inBytes)
+        { Update(inSubsystem, (int64_t)inBytes, 1); }
+    static void Deallocated(
+        int    inSubsystem,
+        size_t inBytes)
+        { Update(inSubsystem, -(int64_t)inBytes, -1); }
+    static void GetCounters(
+        Counters& outCounters);
+    static const char* GetName(
+        int inSubsystem);
+    static ostream& Show(
+        ostream&    inStream,
+        const char* inSeparatorPtr,
+        const char* inDelimiterPtr);
+private:
+    struct ThreadCounters : public Counters
+    {
+        ThreadCounters* mPrevPtr;
+        ThreadCounters* mNextPtr;
+    };
+    static __thread ThreadCounters* sThreadCountersPtr;
+
+    static ThreadCounters& GetThreadCounters();
+    static void ThreadExit(
+        void* inCountersPtr);
+    static void Init();
+};
+
+// Class new and delete operators that account the objects of the class, and
+// all classes derived from it, to the subsystem. The class must have virtual
+// destructor in order to account the size of the derived classes.
+template<int TSubsystem>
+class MemoryAccounted
+{
+public:
+    static void* operator new(
+        size_t inSize)
+    {
+        void* const thePtr = ::operator new(inSize);
+        MemoryAccounting::Allocated(TSubsystem, inSize);
+        return thePtr;
+    }
+    static void operator delete(
+        void*  inPtr,
+        size_t inSize)
+    {
+        if (inPtr) {
+            MemoryAccounting::Deallocated(TSubsystem, inSize);
+            ::operator delete(inPtr);
+        }
+    }
+};
+
+} // namespace KFS
+
+#endif /* COMMON_MEMORY_ACCOUNTING_H */
@@ -33,6 +33,8 @@
 // than 0 then all allocated blocks are "leaked". If element is larger or
 // equal to the pointer size, then the allocation has no overhead.
 // Suitable for allocating very large number of small elements.
+// If TSubsystem isn't kSubsystemNone, the storage size and the in use count
+// are added to the subsystem memory accounting counters.
 //
 //----------------------------------------------------------------------------
 
@@ -46,6 +48,8 @@
 
 #include <algorithm>
 
+#include "MemoryAccounting.h"
+
 namespace KFS
 {
 
@@ -56,7 +60,8 @@ template<
     size_t TItemSize,
     size_t TMinStorageAlloc,
     size_t TMaxStorageAlloc,
-    bool   TForceCleanupFlag
+    bool   TForceCleanupFlag,
+    int    TSubsystem = MemoryAccounting::kSubsystemNone
 >
 class PoolAllocator
 {
@@ -75,6 +80,10 @@ public:
         if (! TForceCleanupFlag && mInUseCount > 0) {
             return; // Memory leak
         }
+        if (TSubsystem != MemoryAccounting::kSubsystemNone) {
+            MemoryAccounting::Update(TSubsystem,
+                -(int64_t)mStorageSize, -(int64_t)mInUseCount);
+        }
         while (mStorageListPtr) {
             char* const theCurPtr = mStorageListPtr;
             char** thePtr = reinterpret_cast<char**>(theCurPtr);
@@ -87,6 +96,7 @@ public:
     {
         if (mFreeListPtr) {
             mInUseCount++;
+            Account(0, 1);
             return GetNextFree();
         }
         char* theEndPtr = mFreeStoragePtr + GetElemSize();
@@ -103,11 +113,13 @@ public:
             mFreeStoragePtr += theHdrSize;
             mAllocSize = min(TMaxStorageAlloc, mAllocSize << 1);
             mStorageSize += theSize;
+            Account((int64_t)theSize, 0);
             theEndPtr = mFreeStoragePtr + GetElemSize();
         }
         char* const theRetPtr = mFreeStoragePtr;
         mFreeStoragePtr = theEndPtr;
         mInUseCount++;
+        Account(0, 1);
         return theRetPtr;
     }
     void Deallocate(
@@ -118,6 +130,7 @@ public:
         }
         assert(mInUseCount > 0);
         mInUseCount--;
+        Account(0, -1);
         Put(inPtr);
     }
     size_t GetInUseCount() const
@@ -137,6 +150,14 @@ private:
     size_t mStorageSize;
     size_t mInUseCount;
 
+    static void Account(
+        int64_t inBytes,
+        int64_t inCount)
+    {
+        if (TSubsystem != MemoryAccounting::kSubsystemNone) {
+            MemoryAccounting::Update(TSubsystem, inBytes, inCount);
+        }
+    }
     char* GetNextFree()
     {
         char* const theRetPtr = mFreeListPtr;
@@ -165,7 +186,8 @@ template<
     typename T,
     size_t   TMinStorageAlloc,
     size_t   TMaxStorageAlloc,
-    bool     TForceCleanupFlag
+    bool     TForceCleanupFlag,
+    int      TSubsystem = MemoryAccounting::kSubsystemNone
 >
 class PoolAllocatorAdapter
 {
@@ -205,14 +227,16 @@ public:
             TOther,
             TMinStorageAlloc,
             TMaxStorageAlloc,
-            TForceCleanupFlag
+            TForceCleanupFlag,
+            TSubsystem
         > other;
     };
     typedef PoolAllocator<
         sizeof(T),         // size_t TItemSize,
         TMinStorageAlloc,
         TMaxStorageAlloc,
-        TForceCleanupFlag
+        TForceCleanupFlag,
+        TSubsystem
     > Alloc;
     const Alloc& GetAllocator() const
     {
@@ -26,6 +26,10 @@
 // If available use GNU pool allocator, instead of boost pool allocator.
 // GNU allocator can be turned off at run time by setting environment variable
 // GLIBCXX_FORCE_NEW=1 to check for memory leaks with valgrind and such.
+// With KFS_STD_FAST_ALLOCATOR_USE_THREAD_CACHE defined the fast allocator uses
+// thread caching allocator, see ThreadCacheAllocator.h
+// The allocators with subsystem parameter other than kSubsystemNone account
+// the allocated bytes and number of allocations, see MemoryAccounting.h
 //
 //----------------------------------------------------------------------------
 
@@ -45,12 +49,21 @@
 #   define KFS_STD_FAST_POOL_ALLOCATOR_T __gnu_cxx::__pool_alloc
 #endif
 
+#include "MemoryAccounting.h"
+
+#if defined(KFS_STD_FAST_ALLOCATOR_USE_THREAD_CACHE)
+#   include "ThreadCacheAllocator.h"
+#   undef  KFS_STD_FAST_POOL_ALLOCATOR_T
+#   define KFS_STD_FAST_POOL_ALLOCATOR_T KFS::ThreadCacheAllocator
+#endif
+
 namespace KFS
 {
 
 template <
     typename T,
-    typename ALLOCATOR = KFS_STD_POOL_ALLOCATOR_T<T>
+    typename ALLOCATOR  = KFS_STD_POOL_ALLOCATOR_T<T>,
+    int      TSubsystem = MemoryAccounting::kSubsystemNone
 >
 class StdAllocator : public ALLOCATOR::template rebind<T>::other
 {
@@ -63,7 +76,14 @@ public:
     pointer allocate(
         size_type inCount)
     {
-        return (inCount == 0 ? (pointer)"" : MySuper::allocate(inCount));
+        if (inCount == 0) {
+            return (pointer)"";
+        }
+        pointer const thePtr = MySuper::allocate(inCount);
+        if (TSubsystem != MemoryAccounting::kSubsystemNone) {
+            MemoryAccounting::Allocated(TSubsystem, inCount * sizeof(T));
+        }
+        return thePtr;
     }
     void deallocate(
         pointer   inPtr,
@@ -71,12 +91,15 @@ public:
     {
         if (inCount != 0) {
             MySuper::deallocate(inPtr, inCount);
+            if (TSubsystem != MemoryAccounting::kSubsystemNone) {
+                MemoryAccounting::Deallocated(TSubsystem, inCount * sizeof(T));
+            }
         }
     }
     template <typename U>
     struct rebind
     {
-        typedef StdAllocator<U, ALLOCATOR> other;
+        typedef StdAllocator<U, ALLOCATOR, TSubsystem> other;
     };
     StdAllocator()
         : MySuper()
@@ -87,7 +110,7 @@ public:
         {}
     template<typename Tp, typename Ap>
     StdAllocator(
-        const StdAllocator<Tp, Ap>& inAlloc)
+        const StdAllocator<Tp, Ap, TSubsystem>& inAlloc)
         : MySuper(inAlloc)
         {}
     ~StdAllocator()
@@ -96,17 +119,18 @@ public:
 
 template <
     typename T,
-    typename ALLOCATOR = KFS_STD_FAST_POOL_ALLOCATOR_T<T>
+    typename ALLOCATOR  = KFS_STD_FAST_POOL_ALLOCATOR_T<T>,
+    int      TSubsystem = MemoryAccounting::kSubsystemNone
 >
-class StdFastAllocator : public StdAllocator<T, ALLOCATOR>
+class StdFastAllocator : public StdAllocator<T, ALLOCATOR, TSubsystem>
 {
 private:
-    typedef StdAllocator<T, ALLOCATOR> MySuper;
+    typedef StdAllocator<T, ALLOCATOR, TSubsystem> MySuper;
 public:
     template <typename U>
     struct rebind
     {
-        typedef StdFastAllocator<U, ALLOCATOR> other;
+        typedef StdFastAllocator<U, ALLOCATOR, TSubsystem> other;
     };
     StdFastAllocator()
         : MySuper()
@@ -117,13 +141,46 @@ public:
         {}
     template<typename Tp, typename Ap>
     StdFastAllocator(
-        const StdFastAllocator<Tp, Ap>& inAlloc)
+        const StdFastAllocator<Tp, Ap, TSubsystem>& inAlloc)
         : MySuper(inAlloc)
         {}
     ~StdFastAllocator()
         {}
 };
 
+// Fast allocator accounted to the memory subsystem.
+template <
+    typename T,
+    int      TSubsystem
+>
+class StdFastTaggedAllocator : public StdFastAllocator<
+    T, KFS_STD_FAST_POOL_ALLOCATOR_T<T>, TSubsystem>
+{
+private:
+    typedef StdFastAllocator<
+        T, KFS_STD_FAST_POOL_ALLOCATOR_T<T>, TSubsystem> MySuper;
+public:
+    template <typename U>
+    struct rebind
+    {
+        typedef StdFastTaggedAllocator<U, TSubsystem> other;
+    };
+    StdFastTaggedAllocator()
+        : MySuper()
+        {}
+    StdFastTaggedAllocator(
+        const StdFastTaggedAllocator& inAlloc)
+        : MySuper(inAlloc)
+        {}
+    template<typename Tp>
+    StdFastTaggedAllocator(
+        const StdFastTaggedAllocator<Tp, TSubsystem>& inAlloc)
+        : MySuper(inAlloc)
+        {}
+    ~StdFastTaggedAllocator()
+        {}
+};
+
 } // namespace KFS
 
 #endif /* STD_ALLOCATOR_H */
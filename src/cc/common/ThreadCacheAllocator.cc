@@ -0,0 +1,241 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \file ThreadCacheAllocator.cc
+// \brief Small object allocator with per thread free lists.
+//
+//----------------------------------------------------------------------------
+
+#include "ThreadCacheAllocator.h"
+#include "kfsatomic.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace KFS
+{
+
+// The central free lists, and the thread key are initialized with
+// pthread_once, and are never destroyed: the allocator can be used by static
+// constructors and destructors.
+struct ThreadCacheCentral
+{
+    pthread_mutex_t mMutex;
+    void*           mHeadPtr;
+    int64_t         mStorageBytes;
+    int64_t         mRefillCount;
+    int64_t         mReleaseCount;
+};
+
+static pthread_once_t     sThreadCacheInitOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t      sThreadCacheKey;
+static volatile int64_t   sThreadCacheCount = 0;
+static ThreadCacheCentral sThreadCacheCentral[ThreadCache::kClassCount];
+
+__thread ThreadCache::Cache* ThreadCache::sCachePtr = 0;
+
+    /* static */ void
+ThreadCache::Init()
+{
+    for (int i = 0; i < kClassCount; i++) {
+        ThreadCacheCentral& theCentral = sThreadCacheCentral[i];
+        if (pthread_mutex_init(&theCentral.mMutex, 0)) {
+            abort();
+        }
+        theCentral.mHeadPtr      = 0;
+        theCentral.mStorageBytes = 0;
+        theCentral.mRefillCount  = 0;
+        theCentral.mReleaseCount = 0;
+    }
+    if (pthread_key_create(&sThreadCacheKey, &ThreadCache::ThreadExit)) {
+        abort();
+    }
+}
+
+    /* static */ ThreadCache::Cache*
+ThreadCache::GetCache()
+{
+    if (sCachePtr) {
+        return sCachePtr;
+    }
+    pthread_once(&sThreadCacheInitOnce, &ThreadCache::Init);
+    Cache* const thePtr = static_cast<Cache*>(malloc(sizeof(Cache)));
+    if (! thePtr) {
+        return 0;
+    }
+    memset(thePtr, 0, sizeof(*thePtr));
+    if (pthread_setspecific(sThreadCacheKey, thePtr)) {
+        free(thePtr);
+        return 0;
+    }
+    SyncAddAndFetch(sThreadCacheCount, int64_t(1));
+    sCachePtr = thePtr;
+    return thePtr;
+}
+
+    /* static */ void*
+ThreadCache::AllocateSelf(
+    int inIdx)
+{
+    Cache* const theCachePtr = GetCache();
+    if (! theCachePtr) {
+        throw std::bad_alloc();
+    }
+    FreeList&           theList    = theCachePtr->mLists[inIdx];
+    const int           theBatch   = (GetMaxCacheCount(inIdx) + 1) / 2;
+    const size_t        theSize    = GetClassSize(inIdx);
+    ThreadCacheCentral& theCentral = sThreadCacheCentral[inIdx];
+    pthread_mutex_lock(&theCentral.mMutex);
+    theCentral.mRefillCount++;
+    while (theList.mCount < theBatch) {
+        Block* thePtr = static_cast<Block*>(theCentral.mHeadPtr);
+        if (! thePtr) {
+            if (0 < theList.mCount) {
+                // Partial batch, do not add storage while free objects are
+                // available.
+                break;
+            }
+            char* const theSlabPtr = static_cast<char*>(malloc(kSlabSize));
+            if (! theSlabPtr) {
+                break;
+            }
+            theCentral.mStorageBytes += kSlabSize;
+            // Carve the slab into the central list, the first object at the
+            // head of the list.
+            const size_t theCount = kSlabSize / theSize;
+            for (size_t i = theCount; 0 < i; ) {
+                --i;
+                Block* const theBlockPtr =
+                    reinterpret_cast<Block*>(theSlabPtr + i * theSize);
+                theBlockPtr->mNextPtr = thePtr;
+                thePtr = theBlockPtr;
+            }
+        }
+        theCentral.mHeadPtr = thePtr->mNextPtr;
+        thePtr->mNextPtr = theList.mHeadPtr;
+        theList.mHeadPtr = thePtr;
+        theList.mCount++;
+    }
+    pthread_mutex_unlock(&theCentral.mMutex);
+    Block* const thePtr = theList.mHeadPtr;
+    if (! thePtr) {
+        throw std::bad_alloc();
+    }
+    theList.mHeadPtr = thePtr->mNextPtr;
+    theList.mCount--;
+    return thePtr;
+}
+
+    /* static */ void
+ThreadCache::DeallocateSelf(
+    void* inPtr,
+    int   inIdx)
+{
+    Block* const        theBlockPtr = static_cast<Block*>(inPtr);
+    ThreadCacheCentral& theCentral  = sThreadCacheCentral[inIdx];
+    Cache* const        theCachePtr = GetCache();
+    if (! theCachePtr) {
+        pthread_mutex_lock(&theCentral.mMutex);
+        theBlockPtr->mNextPtr = static_cast<Block*>(theCentral.mHeadPtr);
+        theCentral.mHeadPtr   = theBlockPtr;
+        pthread_mutex_unlock(&theCentral.mMutex);
+        return;
+    }
+    FreeList& theList = theCachePtr->mLists[inIdx];
+    theBlockPtr->mNextPtr = theList.mHeadPtr;
+    theList.mHeadPtr      = theBlockPtr;
+    theList.mCount++;
+    const int theMax = GetMaxCacheCount(inIdx);
+    if (theList.mCount <= theMax) {
+        return;
+    }
+    // Keep half of the max, and release the remainder in one batch.
+    const int theKeep  = (theMax + 1) / 2;
+    Block*    theLastPtr = theList.mHeadPtr;
+    for (int i = 1; i < theKeep; i++) {
+        theLastPtr = theLastPtr->mNextPtr;
+    }
+    Block* const theFirstPtr = theLastPtr->mNextPtr;
+    theLastPtr->mNextPtr = 0;
+    theList.mCount       = theKeep;
+    theLastPtr = theFirstPtr;
+    while (theLastPtr->mNextPtr) {
+        theLastPtr = theLastPtr->mNextPtr;
+    }
+    pthread_mutex_lock(&theCentral.mMutex);
+    theCentral.mReleaseCount++;
+    theLastPtr->mNextPtr = static_cast<Block*>(theCentral.mHeadPtr);
+    theCentral.mHeadPtr  = theFirstPtr;
+    pthread_mutex_unlock(&theCentral.mMutex);
+}
+
+    /* static */ void
+ThreadCache::ThreadExit(
+    void* inCachePtr)
+{
+    Cache* const theCachePtr = static_cast<Cache*>(inCachePtr);
+    if (! theCachePtr) {
+        return;
+    }
+    if (sCachePtr == theCachePtr) {
+        sCachePtr = 0;
+    }
+    for (int i = 0; i < kClassCount; i++) {
+        FreeList& theList = theCachePtr->mLists[i];
+        Block* const theFirstPtr = theList.mHeadPtr;
+        if (! theFirstPtr) {
+            continue;
+        }
+        Block* theLastPtr = theFirstPtr;
+        while (theLastPtr->mNextPtr) {
+            theLastPtr = theLastPtr->mNextPtr;
+        }
+        ThreadCacheCentral& theCentral = sThreadCacheCentral[i];
+        pthread_mutex_lock(&theCentral.mMutex);
+        theCentral.mReleaseCount++;
+        theLastPtr->mNextPtr = static_cast<Block*>(theCentral.mHeadPtr);
+        theCentral.mHeadPtr  = theFirstPtr;
+        pthread_mutex_unlock(&theCentral.mMutex);
+    }
+    free(theCachePtr);
+    SyncAddAndFetch(sThreadCacheCount, int64_t(-1));
+}
+
+    /* static */ void
+ThreadCache::GetCounters(
+    ThreadCache::Counters& outCounters)
+{
+    outCounters.Clear();
+    pthread_once(&sThreadCacheInitOnce, &ThreadCache::Init);
+    for (int i = 0; i < kClassCount; i++) {
+        ThreadCacheCentral& theCentral = sThreadCacheCentral[i];
+        pthread_mutex_lock(&theCentral.mMutex);
+        outCounters.mStorageBytes += theCentral.mStorageBytes;
+        outCounters.mRefillCount  += theCentral.mRefillCount;
+        outCounters.mReleaseCount += theCentral.mReleaseCount;
+        pthread_mutex_unlock(&theCentral.mMutex);
+    }
+    outCounters.mThreadCacheCount = SyncAddAndFetch(
+        sThreadCacheCount, int64_t(0));
+}
+
+} // namespace KFS
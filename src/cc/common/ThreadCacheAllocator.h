@@ -0,0 +1,232 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \file ThreadCacheAllocator.h
+// \brief Small object allocator with per thread free lists.
+//
+//----------------------------------------------------------------------------
+
+#ifndef COMMON_THREAD_CACHE_ALLOCATOR_H
+#define COMMON_THREAD_CACHE_ALLOCATOR_H
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <new>
+
+namespace KFS
+{
+
+// Objects up to kMaxSize bytes are allocated from the size class free lists of
+// the calling thread. The free lists are refilled from, and trimmed to the
+// central free lists in batches, therefore the central lists' mutexes are
+// acquired only once per batch. The memory is carved from slabs that are never
+// returned to the system, like with the std pool allocators. Objects larger
+// than kMaxSize are allocated with the global operator new.
+// Objects can be freed by any thread; a thread's free lists are moved to the
+// central lists on thread exit.
+class ThreadCache
+{
+public:
+    enum
+    {
+        kClassShift       = 4,
+        kMaxSize          = 512,
+        kClassCount       = kMaxSize >> kClassShift,
+        kMaxCacheBytes    = 32 << 10,
+        kMinCacheCount    = 16,
+        kSlabSize         = 64 << 10
+    };
+    struct Counters
+    {
+        typedef int64_t Counter;
+
+        Counter mStorageBytes;
+        Counter mThreadCacheCount;
+        Counter mRefillCount;
+        Counter mReleaseCount;
+
+        void Clear()
+        {
+            mStorageBytes     = 0;
+            mThreadCacheCount = 0;
+            mRefillCount      = 0;
+            mReleaseCount     = 0;
+        }
+    };
+
+    static void* Allocate(
+        size_t inSize)
+    {
+        if ((size_t)kMaxSize < inSize) {
+            return ::operator new(inSize);
+        }
+        const int   theIdx   = GetClassIdx(inSize);
+        Cache* const theCachePtr = sCachePtr;
+        if (theCachePtr) {
+            FreeList& theList = theCachePtr->mLists[theIdx];
+            Block* const thePtr = theList.mHeadPtr;
+            if (thePtr) {
+                theList.mHeadPtr = thePtr->mNextPtr;
+                theList.mCount--;
+                return thePtr;
+            }
+        }
+        return AllocateSelf(theIdx);
+    }
+    static void Deallocate(
+        void*  inPtr,
+        size_t inSize)
+    {
+        if (! inPtr) {
+            return;
+        }
+        if ((size_t)kMaxSize < inSize) {
+            ::operator delete(inPtr);
+            return;
+        }
+        const int    theIdx      = GetClassIdx(inSize);
+        Cache* const theCachePtr = sCachePtr;
+        if (theCachePtr) {
+            FreeList& theList = theCachePtr->mLists[theIdx];
+            if (theList.mCount < GetMaxCacheCount(theIdx)) {
+                Block* const thePtr = static_cast<Block*>(inPtr);
+                thePtr->mNextPtr = theList.mHeadPtr;
+                theList.mHeadPtr = thePtr;
+                theList.mCount++;
+                return;
+            }
+        }
+        DeallocateSelf(inPtr, theIdx);
+    }
+    static void GetCounters(
+        Counters& outCounters);
+private:
+    struct Block
+    {
+        Block* mNextPtr;
+    };
+    struct FreeList
+    {
+        Block* mHeadPtr;
+        int    mCount;
+    };
+    struct Cache
+    {
+        FreeList mLists[kClassCount];
+    };
+    static __thread Cache* sCachePtr;
+
+    static int GetClassIdx(
+        size_t inSize)
+        { return (int)(inSize <= 0 ? 0 : ((inSize - 1) >> kClassShift)); }
+    static size_t GetClassSize(
+        int inIdx)
+        { return ((size_t)inIdx + 1) << kClassShift; }
+    static int GetMaxCacheCount(
+        int inIdx)
+    {
+        const int theCount = (int)(kMaxCacheBytes / GetClassSize(inIdx));
+        return (theCount < kMinCacheCount ? kMinCacheCount : theCount);
+    }
+    static void* AllocateSelf(
+        int inIdx);
+    static void DeallocateSelf(
+        void* inPtr,
+        int   inIdx);
+    static Cache* GetCache();
+    static void ThreadExit(
+        void* inCachePtr);
+    static void Init();
+};
+
+// STL allocator interface to the thread cache.
+template<typename T>
+class ThreadCacheAllocator
+{
+public:
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+    typedef T*        pointer;
+    typedef const T*  const_pointer;
+    typedef T&        reference;
+    typedef const T&  const_reference;
+    typedef T         value_type;
+
+    template<typename TOther>
+    struct rebind
+    {
+        typedef ThreadCacheAllocator<TOther> other;
+    };
+
+    ThreadCacheAllocator()
+        {}
+    ThreadCacheAllocator(
+        const ThreadCacheAllocator& /* inAlloc */)
+        {}
+    template<typename TOther>
+    ThreadCacheAllocator(
+        const ThreadCacheAllocator<TOther>& /* inAlloc */)
+        {}
+    ~ThreadCacheAllocator()
+        {}
+    pointer address(
+        reference inVal) const
+        { return &inVal; }
+    const_pointer address(
+        const_reference inVal) const
+        { return &inVal; }
+    pointer allocate(
+        size_type   inCount,
+        const void* /* inHintPtr */ = 0)
+    {
+        if (max_size() < inCount) {
+            throw std::bad_alloc();
+        }
+        return static_cast<pointer>(
+            ThreadCache::Allocate(inCount * sizeof(T)));
+    }
+    void deallocate(
+        pointer   inPtr,
+        size_type inCount)
+        { ThreadCache::Deallocate(inPtr, inCount * sizeof(T)); }
+    size_type max_size() const
+        { return (size_t(-1) / sizeof(T)); }
+    void construct(
+        pointer  inPtr,
+        const T& inVal)
+        { ::new(static_cast<void*>(inPtr)) T(inVal); }
+    void destroy(
+        pointer inPtr)
+        { inPtr->~T(); }
+    template<typename TOther>
+    bool operator==(
+        const ThreadCacheAllocator<TOther>& /* inAlloc */) const
+        { return true; }
+    template<typename TOther>
+    bool operator!=(
+        const ThreadCacheAllocator<TOther>& /* inAlloc */) const
+        { return false; }
+};
+
+} // namespace KFS
+
+#endif /* COMMON_THREAD_CACHE_ALLOCATOR_H */
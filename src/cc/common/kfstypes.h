@@ -140,7 +140,8 @@ inline static bool IsMetaLogWriteOrVrError(int status)
 
 #define KFS_FOR_EACH_EC_METHOD(f) \
     f(STRIPED_FILE_TYPE_RS) \
-    f(STRIPED_FILE_TYPE_RS_JERASURE)
+    f(STRIPED_FILE_TYPE_RS_JERASURE) \
+    f(STRIPED_FILE_TYPE_LRC)
 
 enum StripedFileType
 {
@@ -183,6 +184,40 @@ static inline bool ValidateStripeParameters(
     );
 }
 
+// Locally repairable code stripe layout. With m recovery stripes the data
+// stripes are split into l = (m + 1) / 2 contiguous, near equal size local
+// groups. The m - l global parity stripes immediately follow the data
+// stripes, and are followed by l local (xor) parity stripes, one per group.
+static inline int GetLrcLocalGroupCount(
+    int inRecoveryStripeCount)
+{
+    return ((inRecoveryStripeCount + 1) / 2);
+}
+
+static inline int GetLrcLocalGroupStart(
+    int inGroupIdx,
+    int inStripeCount,
+    int inRecoveryStripeCount)
+{
+    return (inGroupIdx * inStripeCount /
+        GetLrcLocalGroupCount(inRecoveryStripeCount));
+}
+
+// Returns local group index of the stripe, or -1 for global parity stripe.
+static inline int GetLrcStripeGroup(
+    int inStripeIdx,
+    int inStripeCount,
+    int inRecoveryStripeCount)
+{
+    const int theGroupCount = GetLrcLocalGroupCount(inRecoveryStripeCount);
+    if (inStripeIdx < inStripeCount) {
+        return ((inStripeIdx + 1) * theGroupCount - 1) / inStripeCount;
+    }
+    const int theLocalIdx =
+        inStripeIdx - (inStripeCount + inRecoveryStripeCount - theGroupCount);
+    return (theLocalIdx < 0 ? -1 : theLocalIdx);
+}
+
 enum AuthenticationType
 {
     kAuthenticationTypeUndef = 0x0,
@@ -27,6 +27,7 @@
 
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <time.h>
 #include "time.h"
 
 namespace KFS {
@@ -73,4 +74,20 @@ cputime(int64_t* user, int64_t* sys)
     return *user + *sys;
 }
 
+// Returns the calling thread's cpu time in microseconds, or the process cpu
+// time if thread cpu clock is not available.
+int64_t
+threadcputime()
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return (int64_t)ts.tv_sec*1000*1000 + ts.tv_nsec / 1000;
+    }
+#endif
+    int64_t user;
+    int64_t sys;
+    return cputime(&user, &sys);
+}
+
 } // namespace KFS
@@ -35,6 +35,7 @@ namespace KFS {
 bool getcurrenttime(int64_t* sec, int64_t* usec);
 int64_t microseconds();
 int64_t cputime(int64_t *user, int64_t *sys);
+int64_t threadcputime();
 
 } // namespace KFS
 
@@ -0,0 +1,56 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Unit test check macro and error count, included by the unit test
+// main source only. The checks can be used by the test's threads, the
+// failure message output and the error count update are serialized.
+//
+//----------------------------------------------------------------------------
+
+#ifndef KFS_DEVTOOLS_TEST_CHECK_H
+#define KFS_DEVTOOLS_TEST_CHECK_H
+
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
+
+#include <iostream>
+
+static int     sErrorCount = 0;
+static QCMutex sTestCheckMutex;
+
+inline static void
+TestCheckFailed(
+    const char* inFileNamePtr,
+    int         inLine,
+    const char* inExprPtr)
+{
+    QCStMutexLocker theLock(sTestCheckMutex);
+    std::cerr << inFileNamePtr << ":" << inLine << ": " << inExprPtr <<
+        " failed\n";
+    sErrorCount++;
+}
+
+#define CHECK(expr) \
+    if (! (expr)) { \
+        TestCheckFailed(__FILE__, __LINE__, #expr); \
+    }
+
+#endif /* KFS_DEVTOOLS_TEST_CHECK_H */
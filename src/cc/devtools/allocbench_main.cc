@@ -0,0 +1,245 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Stl allocator backends performance test: throughput and resident
+// set size of multi threaded std::map insert / erase churn with the pool,
+// thread cache, and the default allocators.
+//
+//----------------------------------------------------------------------------
+
+#include "common/StdAllocator.h"
+#include "common/ThreadCacheAllocator.h"
+#include "common/MemoryAccounting.h"
+#include "common/time.h"
+#include "qcdio/QCThread.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+using namespace KFS;
+using std::map;
+using std::less;
+using std::pair;
+using std::vector;
+using std::max;
+
+typedef pair<const int64_t, int64_t> BenchEntry;
+
+template<typename AllocT>
+class BenchWorker : public QCRunnable
+{
+public:
+    BenchWorker(
+        int     inId,
+        int     inLiveCount,
+        int64_t inOpsCount)
+        : QCRunnable(),
+          mId(inId),
+          mLiveCount(inLiveCount),
+          mOpsCount(inOpsCount),
+          mCheckSum(0),
+          mThread(this, "allocbench")
+        {}
+    virtual ~BenchWorker()
+        {}
+    void Start()
+        { mThread.Start(); }
+    void Join()
+        { mThread.Join(); }
+    virtual void Run()
+    {
+        typedef map<int64_t, int64_t, less<int64_t>, AllocT> Map;
+        Map      theMap;
+        uint64_t theRand = 0x9E3779B97F4A7C15ull * (uint64_t)(mId + 1);
+        for (int i = 0; i < mLiveCount; i++) {
+            theMap.insert(BenchEntry((int64_t)i, (int64_t)i));
+        }
+        // Erase and insert random keys, keeping the number of live entries
+        // about the same.
+        for (int64_t i = 0; i < mOpsCount; i++) {
+            theRand = theRand * 6364136223846793005ull +
+                1442695040888963407ull;
+            const int64_t theKey = (int64_t)((theRand >> 33) %
+                (uint64_t)(2 * mLiveCount));
+            typename Map::iterator const theIt = theMap.find(theKey);
+            if (theIt == theMap.end()) {
+                theMap.insert(BenchEntry(theKey, i));
+            } else {
+                mCheckSum += theIt->second;
+                theMap.erase(theIt);
+            }
+        }
+        mCheckSum += (int64_t)theMap.size();
+    }
+    int64_t GetCheckSum() const
+        { return mCheckSum; }
+private:
+    const int     mId;
+    const int     mLiveCount;
+    const int64_t mOpsCount;
+    int64_t       mCheckSum;
+    QCThread      mThread;
+};
+
+static int64_t
+GetRssBytes()
+{
+    FILE* const theFilePtr = fopen("/proc/self/statm", "r");
+    if (! theFilePtr) {
+        return -1;
+    }
+    long theSize = 0;
+    long theRss  = 0;
+    if (fscanf(theFilePtr, "%ld %ld", &theSize, &theRss) != 2) {
+        theRss = -1;
+    }
+    fclose(theFilePtr);
+    return (theRss < 0 ? int64_t(-1) : (int64_t)theRss * getpagesize());
+}
+
+template<typename AllocT>
+static int
+Bench(
+    const char* inNamePtr,
+    int         inThreadCount,
+    int         inLiveCount,
+    int64_t     inOpsCount)
+{
+    const int64_t theStartRss = GetRssBytes();
+    typedef BenchWorker<AllocT> Worker;
+    vector<Worker*> theWorkers;
+    for (int i = 0; i < inThreadCount; i++) {
+        theWorkers.push_back(new Worker(i, inLiveCount, inOpsCount));
+    }
+    const int64_t theStart = microseconds();
+    for (int i = 0; i < inThreadCount; i++) {
+        theWorkers[i]->Start();
+    }
+    int64_t theCheckSum = 0;
+    for (int i = 0; i < inThreadCount; i++) {
+        theWorkers[i]->Join();
+        theCheckSum += theWorkers[i]->GetCheckSum();
+        delete theWorkers[i];
+    }
+    const int64_t theUsecs = max(int64_t(1), microseconds() - theStart);
+    const int64_t theOps   = inOpsCount * inThreadCount;
+    struct rusage theRusage;
+    if (getrusage(RUSAGE_SELF, &theRusage)) {
+        theRusage.ru_maxrss = -1;
+    }
+    printf("%-16s %3d threads %10" PRId64 " ops %8.3f sec %12.0f ops/sec"
+        " max rss: %7.1f MB retained: %7.1f MB checksum: %" PRId64 "\n",
+        inNamePtr, inThreadCount, theOps, theUsecs * 1e-6,
+        theOps * 1e6 / theUsecs,
+        theRusage.ru_maxrss / 1024.,
+        (GetRssBytes() - theStartRss) / (1024. * 1024.),
+        theCheckSum);
+    fflush(stdout);
+    return 0;
+}
+
+template<typename AllocT>
+static int
+RunChild(
+    const char* inNamePtr,
+    int         inThreadCount,
+    int         inLiveCount,
+    int64_t     inOpsCount)
+{
+    // Run each backend in its own process, in order to measure its resident
+    // set size independently of the other backends.
+    fflush(stdout);
+    const pid_t thePid = fork();
+    if (thePid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (thePid == 0) {
+        _exit(Bench<AllocT>(
+            inNamePtr, inThreadCount, inLiveCount, inOpsCount));
+    }
+    int theStatus = 0;
+    if (waitpid(thePid, &theStatus, 0) != thePid ||
+            ! WIFEXITED(theStatus) || WEXITSTATUS(theStatus) != 0) {
+        fprintf(stderr, "%s: failed\n", inNamePtr);
+        return 1;
+    }
+    return 0;
+}
+
+int
+main(
+    int    argc,
+    char** argv)
+{
+    int     theThreadCount = 4;
+    int     theLiveCount   = 1 << 20;
+    int64_t theOpsCount    = 4 * 1000 * 1000;
+    int     theOpt;
+    while ((theOpt = getopt(argc, argv, "ht:l:n:")) != -1) {
+        switch (theOpt) {
+            case 't':
+                theThreadCount = atoi(optarg);
+                break;
+            case 'l':
+                theLiveCount = (int)atof(optarg);
+                break;
+            case 'n':
+                theOpsCount = (int64_t)atof(optarg);
+                break;
+            default:
+                printf("Usage: %s [-t threads] [-l entries] [-n ops]\n"
+                    " -t number of threads, default 4\n"
+                    " -l number of live map entries per thread, default 1M\n"
+                    " -n number of operations per thread, default 4e6\n",
+                    argv[0]);
+                return (theOpt == 'h' ? 0 : 1);
+        }
+    }
+    if (theThreadCount <= 0 || theLiveCount <= 0 || theOpsCount <= 0) {
+        fprintf(stderr, "invalid threads, entries, or ops count\n");
+        return 1;
+    }
+    int theRet = 0;
+    theRet |= RunChild<StdFastAllocator<BenchEntry> >("std-fast",
+        theThreadCount, theLiveCount, theOpsCount);
+    theRet |= RunChild<StdAllocator<BenchEntry> >("std-pool",
+        theThreadCount, theLiveCount, theOpsCount);
+    theRet |= RunChild<ThreadCacheAllocator<BenchEntry> >("thread-cache",
+        theThreadCount, theLiveCount, theOpsCount);
+    theRet |= RunChild<std::allocator<BenchEntry> >("malloc",
+        theThreadCount, theLiveCount, theOpsCount);
+    theRet |= RunChild<StdFastTaggedAllocator<BenchEntry,
+            MemoryAccounting::kSubsystemOther> >("std-fast-tagged",
+        theThreadCount, theLiveCount, theOpsCount);
+    return theRet;
+}
@@ -0,0 +1,308 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Chunk server client connection pool test. Two users' psk
+// authentication contexts are used with the pool, the same way as the readers
+// use the pool with chunk server authentication. The pooled clients connect
+// to a local listener that never responds, in order to keep the ops pending,
+// and the clients in the middle of authentication. Verifies that:
+// - the clients are keyed by the server location, and the authentication
+//   context, and never shared between the users,
+// - a client with no pending ops is re-used, a new client is created only if
+//   all clients have pending ops, up to the max clients per server, and the
+//   client with the least pending ops is used after that,
+// - Remove() deletes only the clients of the specified user, and the pool
+//   counters are consistent.
+//
+//----------------------------------------------------------------------------
+
+#include "libclient/ClientPool.h"
+#include "libclient/KfsOps.h"
+#include "kfsio/ClientAuthContext.h"
+#include "kfsio/NetManager.h"
+#include "kfsio/TcpSocket.h"
+#include "kfsio/SslFilter.h"
+#include "kfsio/Globals.h"
+#include "common/Properties.h"
+#include "common/MsgLogger.h"
+#include "TestCheck.h"
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace KFS;
+using namespace KFS::client;
+using std::cout;
+using std::cerr;
+using std::string;
+using std::vector;
+using std::istringstream;
+using std::ostringstream;
+using std::pair;
+using std::make_pair;
+
+class ClientPoolTest : public KfsNetClient::OpOwner
+{
+public:
+    enum { kMaxClientsPerServer = 2 };
+
+    ClientPoolTest(
+        NetManager&           inNetManager,
+        const ServerLocation& inServer,
+        const ServerLocation& inOtherServer)
+        : KfsNetClient::OpOwner(),
+          mNetManager(inNetManager),
+          mCtx(),
+          mPool(
+            inNetManager,
+            0,                 // inMaxRetryCount
+            10,                // inTimeSecBetweenRetries
+            5 * 60,            // inOpTimeoutSec
+            30 * 60,           // inIdleTimeoutSec
+            1,                 // inInitialSeqNum
+            "PT",              // inLogPrefixPtr
+            false,             // inResetConnectionOnOpTimeoutFlag
+            true,              // inRetryConnectOnlyFlag
+            MAX_RPC_HEADER_LEN,
+            false,             // inFailAllOpsOnOpTimeoutFlag
+            false,             // inMaxOneOutstandingOpFlag
+            0,                 // inAuthContextPtr
+            kMaxClientsPerServer
+          ),
+          mServer(inServer),
+          mOtherServer(inOtherServer),
+          mOps(),
+          mCanceledCount(0)
+    {
+        for (int i = 0; i < 2; i++) {
+            ostringstream theStream;
+            theStream <<
+                "client.auth.psk.keyId = user" << i << "\n"
+                "client.auth.psk.key   = " <<
+                    (i == 0 ? "MTIzNDU2Nzg5MDEyMzQ1Ng==" :
+                        "NjU0MzIxMDk4NzY1NDMyMQ==") << "\n"
+            ;
+            const string  theParams = theStream.str();
+            istringstream theInStream(theParams);
+            Properties    theProps;
+            theProps.loadProperties(theInStream, '=');
+            string theErrMsg;
+            CHECK(mCtx[i].SetParameters(
+                "client.auth.", theProps, 0, &theErrMsg, true) == 0);
+            CHECK(mCtx[i].IsEnabled());
+        }
+    }
+    virtual ~ClientPoolTest()
+        { CancelAll(); }
+    virtual void OpDone(
+        KfsOp*    inOpPtr,
+        bool      inCanceledFlag,
+        IOBuffer* /* inBufferPtr */)
+    {
+        CHECK(inCanceledFlag);
+        mCanceledCount++;
+        delete inOpPtr;
+    }
+    void Run()
+    {
+        ClientAuthContext* const theUserA = &mCtx[0];
+        ClientAuthContext* const theUserB = &mCtx[1];
+        ClientPool::Counters     theCounters;
+
+        // Keyed by the location and the user.
+        KfsNetClient& theA  = Get(mServer, theUserA);
+        CHECK(&Get(mServer, theUserA) == &theA);
+        KfsNetClient& theB  = Get(mServer, theUserB);
+        KfsNetClient& theA1 = Get(mOtherServer, theUserA);
+        KfsNetClient& theN  = Get(mServer, 0);
+        CHECK(&theA != &theB && &theA != &theA1 && &theA != &theN &&
+            &theB != &theN && &theA1 != &theB);
+        CHECK(theA.GetAuthContext() == theUserA &&
+            theB.GetAuthContext() == theUserB &&
+            theA1.GetAuthContext() == theUserA &&
+            ! theN.GetAuthContext());
+        mPool.GetCounters(theCounters);
+        CHECK(theCounters.mGetCount == 5 &&
+            theCounters.mReuseCount == 1 &&
+            theCounters.mCreateCount == 4 &&
+            theCounters.mRemoveCount == 0 &&
+            mPool.GetSize() == 4);
+
+        // New client only if all user's clients have pending ops.
+        Enqueue(theA);
+        Enqueue(theA);
+        CHECK(theA.GetPendingOpsCount() == 2);
+        CHECK(&Get(mServer, theUserB) == &theB);
+        KfsNetClient& theA2 = Get(mServer, theUserA);
+        CHECK(&theA2 != &theA && &theA2 != &theB &&
+            theA2.GetAuthContext() == theUserA);
+        Enqueue(theA2);
+        // Max clients per server reached, the least busy is used.
+        CHECK(&Get(mServer, theUserA) == &theA2);
+        Enqueue(theA2);
+        Enqueue(theA2);
+        CHECK(&Get(mServer, theUserA) == &theA);
+        Enqueue(theB);
+        CHECK(&Get(mServer, theUserB) != &theB);
+        mPool.GetCounters(theCounters);
+        CHECK(theCounters.mCreateCount == 6 && mPool.GetSize() == 6);
+
+        // Let the clients connect and start authentication with the listener
+        // that never responds.
+        for (int i = 0; i < 10; i++) {
+            mNetManager.MainLoop(0, false, 0, true);
+        }
+        CHECK(theA.GetPendingOpsCount() == 2 &&
+            theA2.GetPendingOpsCount() == 3);
+
+        // The users' clients must not be in use prior to removal.
+        CancelAll();
+        CHECK(mCanceledCount == 6);
+        mPool.Remove(theUserA);
+        mPool.GetCounters(theCounters);
+        CHECK(theCounters.mRemoveCount == 3 && mPool.GetSize() == 3);
+        CHECK(&Get(mServer, theUserB) == &theB);
+        CHECK(&Get(mServer, 0) == &theN);
+        KfsNetClient& theA3 = Get(mServer, theUserA);
+        CHECK(theA3.GetAuthContext() == theUserA);
+        mPool.GetCounters(theCounters);
+        CHECK(theCounters.mCreateCount == 7 && mPool.GetSize() == 4);
+        mPool.Remove(theUserB);
+        mPool.GetCounters(theCounters);
+        CHECK(theCounters.mRemoveCount == 5 && mPool.GetSize() == 2);
+        CHECK(&Get(mServer, 0) == &theN);
+        mPool.Remove(theUserA);
+        mPool.Remove(0);
+        mPool.GetCounters(theCounters);
+        CHECK(theCounters.mRemoveCount == 7 && mPool.GetSize() == 0 &&
+            theCounters.mGetCount ==
+                theCounters.mReuseCount + theCounters.mCreateCount);
+    }
+private:
+    typedef vector<pair<KfsNetClient*, KfsOp*> > Ops;
+
+    NetManager&          mNetManager;
+    // The contexts must outlive the pooled clients.
+    ClientAuthContext    mCtx[2];
+    ClientPool           mPool;
+    const ServerLocation mServer;
+    const ServerLocation mOtherServer;
+    Ops                  mOps;
+    int                  mCanceledCount;
+
+    // Sets up the client the same way as the reader does with chunk server
+    // access.
+    KfsNetClient& Get(
+        const ServerLocation& inLocation,
+        ClientAuthContext*    inCtxPtr)
+    {
+        KfsNetClient& theClient = mPool.Get(inLocation, true, inCtxPtr);
+        if (inCtxPtr) {
+            theClient.SetKey("csaccessid", "0123456789abcdef", 16);
+            if (! theClient.GetAuthContext()) {
+                theClient.SetAuthContext(inCtxPtr);
+            }
+        } else {
+            theClient.SetKey(0, 0, 0, 0);
+            theClient.SetAuthContext(0);
+        }
+        return theClient;
+    }
+    void Enqueue(
+        KfsNetClient& inClient)
+    {
+        KfsOp* const theOpPtr = new SizeOp(0, 1, 1);
+        CHECK(inClient.Enqueue(theOpPtr, this));
+        mOps.push_back(make_pair(&inClient, theOpPtr));
+    }
+    void CancelAll()
+    {
+        for (Ops::const_iterator theIt = mOps.begin();
+                theIt != mOps.end();
+                ++theIt) {
+            theIt->first->Cancel(theIt->second, this);
+        }
+        mOps.clear();
+    }
+private:
+    ClientPoolTest(
+        const ClientPoolTest& inTest);
+    ClientPoolTest& operator=(
+        const ClientPoolTest& inTest);
+};
+
+static int
+Listen(
+    TcpSocket&      inSocket,
+    ServerLocation& outLocation)
+{
+    int theStatus = inSocket.Bind(
+        ServerLocation("127.0.0.1", 0), TcpSocket::kTypeIpV4, false);
+    if (theStatus == 0) {
+        theStatus = inSocket.StartListening(true);
+    }
+    if (theStatus == 0) {
+        theStatus = inSocket.GetSockLocation(outLocation);
+    }
+    return theStatus;
+}
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    MsgLogger::Init(0, (1 < inArgCount && atoi(inArgsPtr[1]) != 0) ?
+        MsgLogger::kLogLevelDEBUG : MsgLogger::kLogLevelERROR);
+    libkfsio::InitGlobals();
+    SslFilter::Error theErr = SslFilter::Initialize();
+    CHECK(theErr == 0);
+    {
+        // The listeners accept no connections, and never respond.
+        TcpSocket      theListener;
+        TcpSocket      theOtherListener;
+        ServerLocation theServer;
+        ServerLocation theOtherServer;
+        CHECK(Listen(theListener, theServer) == 0 &&
+            Listen(theOtherListener, theOtherServer) == 0);
+        NetManager theNetManager(10);
+        if (sErrorCount == 0) {
+            ClientPoolTest theTest(theNetManager, theServer, theOtherServer);
+            if (sErrorCount == 0) {
+                theTest.Run();
+            }
+        }
+    }
+    theErr = SslFilter::Cleanup();
+    CHECK(theErr == 0);
+    libkfsio::DestroyGlobals();
+    MsgLogger::Stop();
+    if (sErrorCount == 0) {
+        cout << "Passed client pool test\n";
+        return 0;
+    }
+    cerr << "Client pool test failed, errors: " << sErrorCount << "\n";
+    return 1;
+}
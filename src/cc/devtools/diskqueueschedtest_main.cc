@@ -0,0 +1,450 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Disk queue request scheduler test. The single io thread is stalled
+// by the first request, while the test requests are queued. The test
+// verifies the order in which the queued requests are dispatched by:
+// - QoS weighted fair queuing,
+// - deadline scheduler priorities, and expired deadlines,
+// - elevator scheduler C-SCAN order,
+// - barrier (meta) requests with all schedulers.
+//
+//----------------------------------------------------------------------------
+
+#include "qcdio/QCDiskQueue.h"
+#include "qcdio/QCIoBufferPool.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/QCUtils.h"
+#include "qcdio/qcstutils.h"
+#include "TestCheck.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using std::cout;
+using std::cerr;
+using std::string;
+using std::vector;
+
+class DiskQueueSchedTest :
+    public QCDiskQueue::IoCompletion,
+    public QCDiskQueue::IoStartObserver
+{
+public:
+    enum
+    {
+        kBlockSize  = 4 << 10,
+        kBlockCount = 256,
+        // Barrier requests are recorded with this block index.
+        kBarrier    = -1
+    };
+    typedef vector<QCDiskQueue::BlockIdx> Blocks;
+
+    DiskQueueSchedTest(
+        const string& inFileName)
+        : QCDiskQueue::IoCompletion(),
+          QCDiskQueue::IoStartObserver(),
+          mFileName(inFileName),
+          mMutex(),
+          mCond(),
+          mBufferPool(),
+          mQueue(),
+          mStallFlag(false),
+          mStalledFlag(false),
+          mBarrierReqId(QCDiskQueue::kRequestIdNone),
+          mPendingCount(0),
+          mDone()
+        {}
+    virtual ~DiskQueueSchedTest()
+    {
+        mQueue.Stop();
+        unlink(mFileName.c_str());
+    }
+    bool Start()
+    {
+        const int theFd = open(mFileName.c_str(),
+            O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (theFd < 0 || ftruncate(theFd, off_t(kBlockSize) * kBlockCount)) {
+            cerr << mFileName << ": " << QCUtils::SysError(errno) << "\n";
+            if (0 <= theFd) {
+                close(theFd);
+            }
+            return false;
+        }
+        close(theFd);
+        const bool kLockMemoryFlag = false;
+        int theErr = mBufferPool.Create(1, 1024, kBlockSize, kLockMemoryFlag);
+        if (theErr) {
+            cerr << "buffer pool: " << QCUtils::SysError(theErr) << "\n";
+            return false;
+        }
+        const char* theNamePtr               = mFileName.c_str();
+        const int   kThreadCount             = 1;
+        const int   kMaxQueueDepth           = 512;
+        const int   kMaxBuffersPerRequest    = 16;
+        const bool  kBufferedIoFlag          = true;
+        const bool  kCreateExclusiveFlag     = false;
+        theErr = mQueue.Start(
+            kThreadCount,
+            kMaxQueueDepth,
+            kMaxBuffersPerRequest,
+            1,
+            &theNamePtr,
+            mBufferPool,
+            this,
+            QCDiskQueue::CpuAffinity::None(),
+            0,
+            kBufferedIoFlag,
+            kCreateExclusiveFlag
+        );
+        if (theErr) {
+            cerr << "disk queue: " << QCUtils::SysError(theErr) << "\n";
+            return false;
+        }
+        return true;
+    }
+    // Enqueues the read that stalls the io thread, and waits for the io
+    // thread to pick it up. The stall read block is not recorded.
+    void Stall(
+        QCDiskQueue::BlockIdx inBlockIdx)
+    {
+        QCStMutexLocker theLock(mMutex);
+        mDone.clear();
+        mStallFlag   = true;
+        mStalledFlag = false;
+        {
+            QCStMutexUnlocker theUnlock(mMutex);
+            Read(inBlockIdx, 0, QCDiskQueue::kPriorityNormal);
+        }
+        while (! mStalledFlag) {
+            mCond.Wait(mMutex);
+        }
+    }
+    void Read(
+        QCDiskQueue::BlockIdx inBlockIdx,
+        int                   inQosClass,
+        QCDiskQueue::Priority inPriority)
+    {
+        {
+            QCStMutexLocker theLock(mMutex);
+            mPendingCount++;
+        }
+        const QCDiskQueue::EnqueueStatus theStatus = mQueue.Read(
+            0, inBlockIdx, 0, 1, this, -1, inQosClass, inPriority);
+        if (theStatus.IsError()) {
+            cerr << "read enqueue: " <<
+                QCDiskQueue::ToString(theStatus.GetError()) << "\n";
+            sErrorCount++;
+            QCStMutexLocker theLock(mMutex);
+            mPendingCount--;
+        }
+    }
+    void Barrier()
+    {
+        QCStMutexLocker theLock(mMutex);
+        mPendingCount++;
+        const string theName = mFileName + ".nonexistent";
+        const QCDiskQueue::EnqueueStatus theStatus =
+            mQueue.Delete(theName.c_str(), this);
+        if (theStatus.IsError()) {
+            cerr << "delete enqueue: " <<
+                QCDiskQueue::ToString(theStatus.GetError()) << "\n";
+            sErrorCount++;
+            mPendingCount--;
+        } else {
+            mBarrierReqId = theStatus.GetRequestId();
+        }
+    }
+    // Resumes the io thread, and returns the queued requests in dispatch
+    // order.
+    Blocks Run()
+    {
+        QCStMutexLocker theLock(mMutex);
+        mStallFlag = false;
+        mCond.NotifyAll();
+        while (0 < mPendingCount) {
+            mCond.Wait(mMutex);
+        }
+        return mDone;
+    }
+    void SetQosWeights(
+        const int* inWeightsPtr,
+        int        inCount)
+        { mQueue.SetQosWeights(inWeightsPtr, inCount); }
+    void SetScheduler(
+        QCDiskQueue::Scheduler inScheduler,
+        const QCDiskQueue::Time* inDeadlinesPtr)
+    {
+        mQueue.SetScheduler(inScheduler, inDeadlinesPtr,
+            QCDiskQueue::kPriorityCount);
+    }
+    virtual bool Done(
+        QCDiskQueue::RequestId      inRequestId,
+        QCDiskQueue::FileIdx        /* inFileIdx */,
+        QCDiskQueue::BlockIdx       inStartBlockIdx,
+        QCDiskQueue::InputIterator& /* inBufferItr */,
+        int                         /* inBufferCount */,
+        QCDiskQueue::Error          /* inCompletionCode */,
+        int                         /* inSysErrorCode */,
+        int64_t                     /* inIoBytes */)
+    {
+        QCStMutexLocker theLock(mMutex);
+        if (mStalledFlag) {
+            mDone.push_back(inRequestId == mBarrierReqId ?
+                QCDiskQueue::BlockIdx(kBarrier) : inStartBlockIdx);
+        }
+        mStalledFlag = true;
+        if (--mPendingCount <= 0) {
+            mCond.NotifyAll();
+        }
+        return false; // Let the queue free the read buffers.
+    }
+    virtual void Notify(
+        QCDiskQueue::ReqType   /* inReqType */,
+        QCDiskQueue::RequestId /* inRequestId */,
+        QCDiskQueue::FileIdx   /* inFileIdx */,
+        QCDiskQueue::BlockIdx  /* inStartBlockIdx */,
+        int                    /* inBufferCount */)
+    {
+        QCStMutexLocker theLock(mMutex);
+        if (! mStallFlag || mStalledFlag) {
+            return;
+        }
+        mStalledFlag = true;
+        mCond.NotifyAll();
+        while (mStallFlag) {
+            mCond.Wait(mMutex);
+        }
+        // Do not record the stall request completion.
+        mStalledFlag = false;
+    }
+private:
+    const string           mFileName;
+    QCMutex                mMutex;
+    QCCondVar              mCond;
+    QCIoBufferPool         mBufferPool;
+    QCDiskQueue            mQueue;
+    bool                   mStallFlag;
+    bool                   mStalledFlag;
+    QCDiskQueue::RequestId mBarrierReqId;
+    int                    mPendingCount;
+    Blocks                 mDone;
+private:
+    DiskQueueSchedTest(
+        const DiskQueueSchedTest& inTest);
+    DiskQueueSchedTest& operator=(
+        const DiskQueueSchedTest& inTest);
+};
+
+static QCDiskQueue::Time
+MilliSec(
+    int64_t inMs)
+{
+    return (QCDiskQueue::Time(inMs) * 1000 * 1000);
+}
+
+static void
+Show(
+    const char*                       inNamePtr,
+    const DiskQueueSchedTest::Blocks& inBlocks)
+{
+    cout << inNamePtr << ":";
+    for (size_t i = 0; i < inBlocks.size(); i++) {
+        cout << " " << inBlocks[i];
+    }
+    cout << "\n";
+}
+
+static void
+TestQos(
+    DiskQueueSchedTest& inTest)
+{
+    // Class 1 has 3 times the weight of class 0. All class 0 requests are
+    // queued first. Blocks 1-30 are class 0, blocks 31-60 class 1.
+    const int theWeights[] = { 1, 3 };
+    inTest.SetQosWeights(theWeights, 2);
+    inTest.SetScheduler(QCDiskQueue::kSchedulerFifo, 0);
+    inTest.Stall(0);
+    for (int i = 1; i <= 60; i++) {
+        inTest.Read(i, i <= 30 ? 0 : 1, QCDiskQueue::kPriorityNormal);
+    }
+    const DiskQueueSchedTest::Blocks theDone = inTest.Run();
+    Show("qos", theDone);
+    CHECK(theDone.size() == 60);
+    int theClass1Count = 0;
+    QCDiskQueue::BlockIdx thePrev[2] = { 0, 30 };
+    for (size_t i = 0; i < theDone.size(); i++) {
+        const int theClass = theDone[i] <= 30 ? 0 : 1;
+        if (i < 20 && theClass == 1) {
+            theClass1Count++;
+        }
+        // Fifo order within class.
+        CHECK(thePrev[theClass] < theDone[i]);
+        thePrev[theClass] = theDone[i];
+    }
+    // Expected 15 of the first 20, allow for the start tag rounding.
+    CHECK(13 <= theClass1Count && theClass1Count <= 17);
+    const int theEqual[] = { 1, 1 };
+    inTest.SetQosWeights(theEqual, 2);
+}
+
+static void
+TestDeadline(
+    DiskQueueSchedTest& inTest)
+{
+    const QCDiskQueue::Time theDeadlines[QCDiskQueue::kPriorityCount] = {
+        MilliSec(10000), MilliSec(10000), MilliSec(10000), MilliSec(10000)
+    };
+    inTest.SetScheduler(QCDiskQueue::kSchedulerDeadline, theDeadlines);
+    inTest.Stall(0);
+    for (int i = 1; i <= 30; i++) {
+        inTest.Read(i, 0,
+            i <= 10 ? QCDiskQueue::kPriorityLow :
+            (i <= 20 ? QCDiskQueue::kPriorityHigh :
+                QCDiskQueue::kPriorityNormal));
+    }
+    DiskQueueSchedTest::Blocks theDone = inTest.Run();
+    Show("deadline priority", theDone);
+    CHECK(theDone.size() == 30);
+    for (size_t i = 0; i < theDone.size(); i++) {
+        // High, then normal, then low, and fifo order within priority.
+        CHECK(theDone[i] == (QCDiskQueue::BlockIdx)(
+            i < 10 ? i + 11 : (i < 20 ? i + 11 : i - 19)));
+    }
+    // Low priority requests with expired deadline go ahead of the high
+    // priority requests.
+    const QCDiskQueue::Time theShortLow[QCDiskQueue::kPriorityCount] = {
+        MilliSec(10000), MilliSec(10000), MilliSec(1), MilliSec(10000)
+    };
+    inTest.SetScheduler(QCDiskQueue::kSchedulerDeadline, theShortLow);
+    inTest.Stall(0);
+    for (int i = 1; i <= 5; i++) {
+        inTest.Read(i, 0, QCDiskQueue::kPriorityLow);
+    }
+    usleep(20 * 1000);
+    for (int i = 6; i <= 10; i++) {
+        inTest.Read(i, 0, QCDiskQueue::kPriorityHigh);
+    }
+    theDone = inTest.Run();
+    Show("deadline expired", theDone);
+    CHECK(theDone.size() == 10);
+    for (size_t i = 0; i < theDone.size(); i++) {
+        CHECK(theDone[i] == (QCDiskQueue::BlockIdx)(i + 1));
+    }
+}
+
+static void
+TestElevator(
+    DiskQueueSchedTest& inTest)
+{
+    const QCDiskQueue::Time theDeadlines[QCDiskQueue::kPriorityCount] = {
+        MilliSec(10000), MilliSec(10000), MilliSec(10000), MilliSec(10000)
+    };
+    inTest.SetScheduler(QCDiskQueue::kSchedulerElevator, theDeadlines);
+    // The stall request leaves the head at block 51.
+    inTest.Stall(50);
+    const int theBlocks[] = { 90, 10, 55, 30, 80, 5, 70, 20, 60 };
+    const int theCount    = (int)(sizeof(theBlocks) / sizeof(theBlocks[0]));
+    for (int i = 0; i < theCount; i++) {
+        inTest.Read(theBlocks[i], 0, QCDiskQueue::kPriorityNormal);
+    }
+    // High priority request goes first, regardless of the position.
+    inTest.Read(40, 0, QCDiskQueue::kPriorityHigh);
+    const DiskQueueSchedTest::Blocks theDone = inTest.Run();
+    Show("elevator", theDone);
+    const QCDiskQueue::BlockIdx theExpected[] =
+        { 40, 55, 60, 70, 80, 90, 5, 10, 20, 30 };
+    CHECK(theDone == DiskQueueSchedTest::Blocks(theExpected, theExpected +
+        sizeof(theExpected) / sizeof(theExpected[0])));
+}
+
+static void
+TestBarrier(
+    DiskQueueSchedTest&    inTest,
+    QCDiskQueue::Scheduler inScheduler)
+{
+    const QCDiskQueue::Time theDeadlines[QCDiskQueue::kPriorityCount] = {
+        MilliSec(10000), MilliSec(10000), MilliSec(10000), MilliSec(10000)
+    };
+    inTest.SetScheduler(inScheduler, theDeadlines);
+    const int theWeights[] = { 1, 100 };
+    inTest.SetQosWeights(theWeights, 2);
+    // The requests queued after the barrier can not be dispatched ahead of
+    // the barrier, regardless of the priority, class, or position.
+    inTest.Stall(0);
+    inTest.Read(90, 0, QCDiskQueue::kPriorityLow);
+    inTest.Read(80, 0, QCDiskQueue::kPriorityLow);
+    inTest.Barrier();
+    inTest.Read(1, 1, QCDiskQueue::kPriorityHigh);
+    inTest.Read(2, 1, QCDiskQueue::kPriorityHigh);
+    const DiskQueueSchedTest::Blocks theDone = inTest.Run();
+    Show("barrier", theDone);
+    CHECK(theDone.size() == 5 && theDone[2] == DiskQueueSchedTest::kBarrier);
+    for (size_t i = 0; i < theDone.size(); i++) {
+        CHECK(i < 2 ? 80 <= theDone[i] :
+            (i == 2 || theDone[i] == 1 || theDone[i] == 2));
+    }
+    const int theEqual[] = { 1, 1 };
+    inTest.SetQosWeights(theEqual, 2);
+}
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    char theName[] = "diskqueueschedtest.XXXXXX";
+    const int theFd = mkstemp(theName);
+    if (theFd < 0) {
+        cerr << "mkstemp: " << QCUtils::SysError(errno) << "\n";
+        return 1;
+    }
+    close(theFd);
+    {
+        DiskQueueSchedTest theTest(1 < inArgCount ? inArgsPtr[1] : theName);
+        if (! theTest.Start()) {
+            unlink(theName);
+            return 1;
+        }
+        TestQos(theTest);
+        TestDeadline(theTest);
+        TestElevator(theTest);
+        TestBarrier(theTest, QCDiskQueue::kSchedulerFifo);
+        TestBarrier(theTest, QCDiskQueue::kSchedulerDeadline);
+        TestBarrier(theTest, QCDiskQueue::kSchedulerElevator);
+    }
+    unlink(theName);
+    if (sErrorCount == 0) {
+        cout << "Passed disk queue scheduler test\n";
+        return 0;
+    }
+    cerr << "Disk queue scheduler test failed, errors: " << sErrorCount <<
+        "\n";
+    return 1;
+}
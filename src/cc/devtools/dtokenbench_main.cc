@@ -0,0 +1,174 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Chunk access token validation performance test.
+//
+//----------------------------------------------------------------------------
+
+#include "kfsio/ChunkAccessToken.h"
+#include "kfsio/DelegationToken.h"
+#include "kfsio/CryptoKeys.h"
+#include "kfsio/NetManager.h"
+#include "common/time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+using namespace KFS;
+using std::string;
+using std::vector;
+using std::ostringstream;
+using std::min;
+using std::max;
+
+static int
+Bench(
+    const char*           inNamePtr,
+    const CryptoKeys&     inKeys,
+    const vector<string>& inTokens,
+    int                   inTokenCount,
+    int64_t               inIterations,
+    int64_t               inTimeNow)
+{
+    int           theErrCount = 0;
+    string        theErrMsg;
+    const int64_t theStart    = microseconds();
+    for (int64_t i = 0; i < inIterations; i++) {
+        const int        theIdx   = (int)(i % inTokenCount);
+        const string&    theToken = inTokens[theIdx];
+        ChunkAccessToken theCAToken;
+        if (! theCAToken.Process(
+                theIdx + 1,
+                theToken.data(),
+                (int)theToken.size(),
+                inTimeNow,
+                inKeys,
+                &theErrMsg)) {
+            theErrCount++;
+        }
+    }
+    const int64_t theUsecs = max(int64_t(1), microseconds() - theStart);
+    printf("%-20s %6d tokens %10" PRId64 " validations %10.3f sec"
+        " %12.0f validations/sec\n",
+        inNamePtr, inTokenCount, inIterations, theUsecs * 1e-6,
+        inIterations * 1e6 / theUsecs);
+    // Tokens must not validate with the wrong chunk id.
+    for (int i = 0; i < inTokenCount; i++) {
+        ChunkAccessToken theCAToken;
+        if (theCAToken.Process(
+                i + 2,
+                inTokens[i].data(),
+                (int)inTokens[i].size(),
+                inTimeNow,
+                inKeys,
+                &theErrMsg)) {
+            theErrCount++;
+        }
+    }
+    if (theErrCount) {
+        printf("%s: %d errors, last: %s\n",
+            inNamePtr, theErrCount, theErrMsg.c_str());
+    }
+    return theErrCount;
+}
+
+int
+main(
+    int    argc,
+    char** argv)
+{
+    int64_t theIterations = 1000 * 1000;
+    int     theTokenCount = 4 << 10;
+    bool    theCacheFlag  = true;
+    int     theOpt;
+    while ((theOpt = getopt(argc, argv, "hn:t:d")) != -1) {
+        switch (theOpt) {
+            case 'n':
+                theIterations = (int64_t)atof(optarg);
+                break;
+            case 't':
+                theTokenCount = atoi(optarg);
+                break;
+            case 'd':
+                theCacheFlag = false;
+                break;
+            default:
+                printf("Usage: %s [-n iterations] [-t tokens] [-d]\n"
+                    " -n number of validations, default 1e6\n"
+                    " -t number of distinct tokens, default 4096\n"
+                    " -d disable hmac contexts and verified tokens cache\n",
+                    argv[0]);
+                return (theOpt == 'h' ? 0 : 1);
+        }
+    }
+    if (theIterations <= 0 || theTokenCount <= 0) {
+        fprintf(stderr, "invalid iterations or tokens count\n");
+        return 1;
+    }
+    DelegationToken::SetHmacCacheEnabled(theCacheFlag);
+    NetManager      theNetManager;
+    CryptoKeys      theKeys(theNetManager);
+    CryptoKeys::Key theKey;
+    const CryptoKeys::KeyId theKeyId = 12345;
+    const int64_t           theNow   = time(0);
+    if (! CryptoKeys::PseudoRand(theKey.WritePtr(), theKey.GetSize()) ||
+            ! theKeys.Add(theKeyId, theKey, theNow)) {
+        fprintf(stderr, "failed to create key\n");
+        return 1;
+    }
+    vector<string> theTokens;
+    theTokens.reserve(theTokenCount);
+    for (int i = 0; i < theTokenCount; i++) {
+        ostringstream theStream;
+        if (! ChunkAccessToken::WriteToken(
+                theStream,
+                i + 1,
+                1000 + i,
+                i,
+                theKeyId,
+                theNow,
+                ChunkAccessToken::kAllowReadFlag,
+                3600,
+                theKey.GetPtr(),
+                theKey.GetSize())) {
+            fprintf(stderr, "failed to create token\n");
+            return 1;
+        }
+        theTokens.push_back(theStream.str());
+    }
+    // Same few tokens, as with the requests of a single client: every
+    // validation after the first one is a verified tokens cache hit, if
+    // enabled. Then all tokens in round robin order: cache misses, but the
+    // precomputed key contexts are still used.
+    int theErrCount = 0;
+    theErrCount += Bench("repeated-tokens", theKeys, theTokens,
+        min(16, theTokenCount), theIterations, theNow);
+    theErrCount += Bench("distinct-tokens", theKeys, theTokens,
+        theTokenCount, theIterations, theNow);
+    return (theErrCount == 0 ? 0 : 1);
+}
@@ -0,0 +1,259 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Delegation token HMAC contexts and verified tokens cache test.
+// Verifies that the cached verification results are the same as with the
+// caches disabled, and that a verified token is rejected once it expires,
+// with a different subject, with a tampered signature, or when its key id
+// maps to a different key. Exercises key context LRU eviction with more keys
+// than cache entries, verified token entries collisions, and concurrent
+// validation from a few threads.
+//
+//----------------------------------------------------------------------------
+
+#include "kfsio/ChunkAccessToken.h"
+#include "kfsio/DelegationToken.h"
+#include "kfsio/CryptoKeys.h"
+#include "kfsio/NetManager.h"
+#include "qcdio/QCThread.h"
+#include "TestCheck.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace KFS;
+using std::cout;
+using std::cerr;
+using std::string;
+using std::vector;
+using std::ostringstream;
+
+enum
+{
+    kKeyCount     = 6, // More than the per thread key contexts.
+    kTokenCount   = 1024,
+    kValidForSec  = 3600
+};
+
+struct TestToken
+{
+    kfsChunkId_t      mChunkId;
+    kfsUid_t          mUid;
+    CryptoKeys::KeyId mKeyId;
+    string            mToken;
+};
+
+static bool
+Process(
+    kfsChunkId_t      inChunkId,
+    kfsUid_t          inUid,
+    const string&     inTokenStr,
+    int64_t           inTimeNow,
+    const CryptoKeys& inKeys)
+{
+    string           theErrMsg;
+    ChunkAccessToken theCAToken;
+    return theCAToken.Process(
+        inChunkId,
+        inUid,
+        inTokenStr.data(),
+        (int)inTokenStr.size(),
+        inTimeNow,
+        inKeys,
+        &theErrMsg
+    );
+}
+
+// Validates with the caches enabled, then disabled, and returns the
+// validation result if both are the same.
+static bool
+ProcessCmp(
+    kfsChunkId_t      inChunkId,
+    kfsUid_t          inUid,
+    const string&     inTokenStr,
+    int64_t           inTimeNow,
+    const CryptoKeys& inKeys)
+{
+    const bool theRet = Process(
+        inChunkId, inUid, inTokenStr, inTimeNow, inKeys);
+    DelegationToken::SetHmacCacheEnabled(false);
+    const bool theRef = Process(
+        inChunkId, inUid, inTokenStr, inTimeNow, inKeys);
+    DelegationToken::SetHmacCacheEnabled(true);
+    CHECK(theRet == theRef);
+    return theRet;
+}
+
+class ValidateWorker : public QCRunnable
+{
+public:
+    ValidateWorker(
+        const vector<TestToken>& inTokens,
+        const CryptoKeys&        inKeys,
+        int64_t                  inTimeNow,
+        int                      inIterations)
+        : QCRunnable(),
+          mTokens(inTokens),
+          mKeys(inKeys),
+          mTimeNow(inTimeNow),
+          mIterations(inIterations),
+          mThread(this, "dtokencachetest")
+        {}
+    virtual ~ValidateWorker()
+        {}
+    void Start()
+        { mThread.Start(); }
+    void Join()
+        { mThread.Join(); }
+    virtual void Run()
+    {
+        for (int i = 0; i < mIterations && sErrorCount <= 0; i++) {
+            const TestToken& theToken = mTokens[i % mTokens.size()];
+            CHECK(Process(theToken.mChunkId, theToken.mUid,
+                theToken.mToken, mTimeNow, mKeys));
+            CHECK(! Process(theToken.mChunkId + 1, theToken.mUid,
+                theToken.mToken, mTimeNow, mKeys));
+        }
+    }
+private:
+    const vector<TestToken>& mTokens;
+    const CryptoKeys&        mKeys;
+    const int64_t            mTimeNow;
+    const int                mIterations;
+    QCThread                 mThread;
+private:
+    ValidateWorker(
+        const ValidateWorker& inWorker);
+    ValidateWorker& operator=(
+        const ValidateWorker& inWorker);
+};
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    const int theThreadCount = 1 < inArgCount ? atoi(inArgsPtr[1]) : 4;
+    const int theIterations  = 2 < inArgCount ? atoi(inArgsPtr[2]) : 100000;
+    DelegationToken::SetHmacCacheEnabled(true);
+    NetManager      theNetManager;
+    CryptoKeys      theKeys(theNetManager);
+    CryptoKeys      theOtherKeys(theNetManager);
+    CryptoKeys::Key theKey[kKeyCount];
+    const int64_t   theNow = time(0);
+    for (int i = 0; i < kKeyCount; i++) {
+        CryptoKeys::Key theOtherKey;
+        if (! CryptoKeys::PseudoRand(theKey[i].WritePtr(),
+                    theKey[i].GetSize()) ||
+                ! CryptoKeys::PseudoRand(theOtherKey.WritePtr(),
+                    theOtherKey.GetSize()) ||
+                ! theKeys.Add(i + 1, theKey[i], theNow) ||
+                ! theOtherKeys.Add(i + 1, theOtherKey, theNow)) {
+            cerr << "failed to create keys\n";
+            return 1;
+        }
+    }
+    vector<TestToken> theTokens(kTokenCount);
+    for (int i = 0; i < kTokenCount; i++) {
+        TestToken& theToken = theTokens[i];
+        theToken.mChunkId = 1000 + i;
+        theToken.mUid     = 100 + i % 7;
+        theToken.mKeyId   = 1 + i % kKeyCount;
+        ostringstream theStream;
+        if (! ChunkAccessToken::WriteToken(
+                theStream,
+                theToken.mChunkId,
+                theToken.mUid,
+                i,
+                theToken.mKeyId,
+                theNow,
+                ChunkAccessToken::kAllowReadFlag,
+                kValidForSec,
+                theKey[theToken.mKeyId - 1].GetPtr(),
+                theKey[theToken.mKeyId - 1].GetSize())) {
+            cerr << "failed to create token\n";
+            return 1;
+        }
+        theToken.mToken = theStream.str();
+    }
+    uint64_t theRand = 1;
+    // All tokens and keys are used in the round robin order, more than the
+    // cache sizes, thus the key contexts are evicted, and the verified
+    // tokens entries are replaced.
+    for (int k = 0; k < 3; k++) {
+        for (int i = 0; i < kTokenCount; i++) {
+            const TestToken& theToken = theTokens[i];
+            // Repeat to hit the verified tokens cache.
+            for (int r = 0; r < 2; r++) {
+                CHECK(ProcessCmp(theToken.mChunkId, theToken.mUid,
+                    theToken.mToken, theNow, theKeys));
+            }
+            // Verified token with different subject.
+            CHECK(! ProcessCmp(theToken.mChunkId + 1,
+                theToken.mUid, theToken.mToken, theNow, theKeys));
+            CHECK(! ProcessCmp(theToken.mChunkId,
+                theToken.mUid + 1, theToken.mToken, theNow, theKeys));
+            // Verified token past expiration time, or issued in the future.
+            CHECK(! ProcessCmp(theToken.mChunkId, theToken.mUid,
+                theToken.mToken, theNow + kValidForSec + 1, theKeys));
+            CHECK(! ProcessCmp(theToken.mChunkId, theToken.mUid,
+                theToken.mToken, theNow - 24 * 3600, theKeys));
+            // Same key id, different key.
+            CHECK(! ProcessCmp(theToken.mChunkId, theToken.mUid,
+                theToken.mToken, theNow, theOtherKeys));
+            CHECK(ProcessCmp(theToken.mChunkId, theToken.mUid,
+                theToken.mToken, theNow, theKeys));
+            // Tampered token: the result must be the same as without the
+            // cache, base64 padding bits change might not change the token.
+            string theTampered = theToken.mToken;
+            theRand = theRand * 6364136223846793005ull +
+                1442695040888963407ull;
+            const size_t thePos = (size_t)(theRand >> 33) % theTampered.size();
+            theTampered[thePos] = theTampered[thePos] == 'A' ? 'B' : 'A';
+            ProcessCmp(theToken.mChunkId, theToken.mUid,
+                theTampered, theNow, theKeys);
+        }
+    }
+    vector<ValidateWorker*> theWorkers;
+    for (int i = 0; i < theThreadCount; i++) {
+        theWorkers.push_back(new ValidateWorker(
+            theTokens, theKeys, theNow, theIterations));
+    }
+    for (int i = 0; i < theThreadCount; i++) {
+        theWorkers[i]->Start();
+    }
+    for (int i = 0; i < theThreadCount; i++) {
+        theWorkers[i]->Join();
+        delete theWorkers[i];
+    }
+    if (sErrorCount == 0) {
+        cout << "Passed delegation token cache test\n";
+        return 0;
+    }
+    cerr << "Delegation token cache test failed, errors: " << sErrorCount <<
+        "\n";
+    return 1;
+}
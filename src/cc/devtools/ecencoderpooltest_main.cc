@@ -0,0 +1,298 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Erasure code encoder pool test. Concurrently executes batches of
+// RS encode tasks from a few threads, with the pool queue limit small enough
+// to trigger back pressure, and verifies that:
+// - recovery stripes are the same as produced by the encoder directly,
+// - batch status is the first encoder failure status,
+// - the pool task, batch and byte counters are consistent, and the queue is
+//   empty once all batches are executed.
+//
+//----------------------------------------------------------------------------
+
+#include "libclient/ECEncoderPool.h"
+#include "libclient/ECMethod.h"
+#include "common/kfstypes.h"
+#include "qcdio/QCThread.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace KFS;
+using client::ECMethod;
+using client::ECEncoderPool;
+using std::cout;
+using std::cerr;
+using std::vector;
+
+static int     sErrorCount = 0;
+static QCMutex sMutex;
+
+static void
+Error(
+    const char* inMsgPtr)
+{
+    QCStMutexLocker theLock(sMutex);
+    cerr << "error: " << inMsgPtr << "\n";
+    sErrorCount++;
+}
+
+// Encoder wrapper that fails the tasks with the specified length.
+class FailingEncoder : public ECMethod::Encoder
+{
+public:
+    enum { kFailLength = 4096 + 16 };
+
+    FailingEncoder(
+        ECMethod::Encoder& inEncoder)
+        : ECMethod::Encoder(),
+          mEncoder(inEncoder)
+        {}
+    virtual ~FailingEncoder()
+        {}
+    virtual int Encode(
+        int    inStripeCount,
+        int    inRecoveryStripeCount,
+        int    inLength,
+        void** inBuffersPtr)
+    {
+        if (inLength == kFailLength) {
+            return -EIO;
+        }
+        return mEncoder.Encode(inStripeCount, inRecoveryStripeCount,
+            inLength, inBuffersPtr);
+    }
+    virtual void Release()
+        {}
+private:
+    ECMethod::Encoder& mEncoder;
+};
+
+class EncodeTestWorker : public QCRunnable
+{
+public:
+    enum
+    {
+        kStripeCount         = 6,
+        kRecoveryStripeCount = 3,
+        kStripes             = kStripeCount + kRecoveryStripeCount,
+        kMaxLength           = 16 << 10
+    };
+
+    EncodeTestWorker(
+        int inId,
+        int inBatchCount)
+        : QCRunnable(),
+          mBatchCount(inBatchCount),
+          mRand(0x9E3779B97F4A7C15ull * (uint64_t)(inId + 1)),
+          mTaskCount(0),
+          mBatchesExecuted(0),
+          mByteCount(0),
+          mThread(this, "ecpooltest")
+        {}
+    virtual ~EncodeTestWorker()
+        {}
+    void Start()
+        { mThread.Start(); }
+    void Join()
+        { mThread.Join(); }
+    int64_t GetTaskCount() const
+        { return mTaskCount; }
+    int64_t GetBatchCount() const
+        { return mBatchesExecuted; }
+    int64_t GetByteCount() const
+        { return mByteCount; }
+    virtual void Run()
+    {
+        ECMethod::Encoder* const theEncoderPtr = ECMethod::FindEncoder(
+            KFS_STRIPED_FILE_TYPE_RS, kStripeCount, kRecoveryStripeCount, 0);
+        if (! theEncoderPtr) {
+            Error("no RS encoder");
+            return;
+        }
+        FailingEncoder        theFailingEncoder(*theEncoderPtr);
+        ECEncoderPool::Batch  theBatch;
+        vector<vector<char> > theData;
+        vector<vector<char> > theExpected;
+        vector<void*>         thePtrs(kStripes);
+        for (int b = 0; b < mBatchCount && sErrorCount <= 0; b++) {
+            // Mix of single task, small and large batches, every tenth
+            // batch has one failing task.
+            const int  theTaskCount = b % 7 == 0 ? 1 : 2 + Random() % 31;
+            const int  theFailIdx   = b % 10 == 5 ?
+                (int)(Random() % theTaskCount) : -1;
+            ECMethod::Encoder& theEncoder = 0 <= theFailIdx ?
+                (ECMethod::Encoder&)theFailingEncoder : *theEncoderPtr;
+            theData.resize(theTaskCount * kStripes);
+            theExpected.resize(theTaskCount * kStripes);
+            vector<int> theLengths(theTaskCount);
+            for (int t = 0; t < theTaskCount; t++) {
+                const int theLength = t == theFailIdx ?
+                    (int)FailingEncoder::kFailLength :
+                    (int)(1 + Random() % (kMaxLength / 16)) * 16;
+                theLengths[t] = theLength;
+                void** const theBufs = theBatch.Add(
+                    theEncoder, kStripeCount, kRecoveryStripeCount, theLength);
+                for (int i = 0; i < kStripes; i++) {
+                    vector<char>& theBuf = theData[t * kStripes + i];
+                    theBuf.resize(theLength);
+                    if (i < kStripeCount) {
+                        for (int k = 0; k < theLength; k += 8) {
+                            const uint64_t theVal = Random();
+                            memcpy(&theBuf[k], &theVal, sizeof(theVal));
+                        }
+                    } else {
+                        memset(&theBuf[0], 0, theLength);
+                    }
+                    theBufs[i] = &theBuf[0];
+                    mByteCount += i < kStripeCount ? theLength : 0;
+                }
+                if (t == theFailIdx) {
+                    continue;
+                }
+                for (int i = 0; i < kStripes; i++) {
+                    theExpected[t * kStripes + i] = theData[t * kStripes + i];
+                    thePtrs[i] = &theExpected[t * kStripes + i][0];
+                }
+                if (theEncoderPtr->Encode(kStripeCount, kRecoveryStripeCount,
+                        theLength, &thePtrs[0]) != 0) {
+                    Error("encode failure");
+                    return;
+                }
+            }
+            const int theStatus = theBatch.Execute();
+            mTaskCount += theTaskCount;
+            mBatchesExecuted++;
+            if (! theBatch.IsEmpty()) {
+                Error("batch is not empty after Execute()");
+            }
+            if (theStatus != (0 <= theFailIdx ? -EIO : 0)) {
+                Error("invalid batch status");
+            }
+            if (theBatch.GetOffloadedCount() < 0 ||
+                    theTaskCount < theBatch.GetOffloadedCount()) {
+                Error("invalid offloaded task count");
+            }
+            // Encoding of the tasks that follow the failed task in the same
+            // task range is skipped, thus the failed batch isn't verified.
+            for (int t = 0; t < theTaskCount && theFailIdx < 0; t++) {
+                for (int i = kStripeCount; i < kStripes; i++) {
+                    if (memcmp(&theData[t * kStripes + i][0],
+                            &theExpected[t * kStripes + i][0],
+                            theLengths[t]) != 0) {
+                        Error("recovery stripe mismatch");
+                        break;
+                    }
+                }
+            }
+        }
+        theEncoderPtr->Release();
+    }
+private:
+    const int mBatchCount;
+    uint64_t  mRand;
+    int64_t   mTaskCount;
+    int64_t   mBatchesExecuted;
+    int64_t   mByteCount;
+    QCThread  mThread;
+
+    uint64_t Random()
+    {
+        mRand = mRand * 6364136223846793005ull + 1442695040888963407ull;
+        return (mRand ^ (mRand >> 29));
+    }
+private:
+    EncodeTestWorker(
+        const EncodeTestWorker& inWorker);
+    EncodeTestWorker& operator=(
+        const EncodeTestWorker& inWorker);
+};
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    const int theThreadCount = 1 < inArgCount ? atoi(inArgsPtr[1]) : 4;
+    const int theBatchCount  = 2 < inArgCount ? atoi(inArgsPtr[2]) : 200;
+    // The pool parameters are read once, on the first use.
+    setenv("QFS_CLIENT_EC_ENCODER_THREADS",          "3",      1);
+    setenv("QFS_CLIENT_EC_ENCODER_MIN_BATCH_BYTES",  "0",      1);
+    setenv("QFS_CLIENT_EC_ENCODER_MAX_QUEUED_BYTES", "524288", 1);
+
+    vector<EncodeTestWorker*> theWorkers;
+    for (int i = 0; i < theThreadCount; i++) {
+        theWorkers.push_back(new EncodeTestWorker(i, theBatchCount));
+    }
+    for (int i = 0; i < theThreadCount; i++) {
+        theWorkers[i]->Start();
+    }
+    int64_t theTaskCount  = 0;
+    int64_t theBatches    = 0;
+    int64_t theByteCount  = 0;
+    for (int i = 0; i < theThreadCount; i++) {
+        theWorkers[i]->Join();
+        theTaskCount += theWorkers[i]->GetTaskCount();
+        theBatches   += theWorkers[i]->GetBatchCount();
+        theByteCount += theWorkers[i]->GetByteCount();
+        delete theWorkers[i];
+    }
+    ECEncoderPool::Stats theStats;
+    ECEncoderPool::GetStats(theStats);
+    cout <<
+        "threads: "        << theStats.mThreadCount <<
+        " batches: "       << theStats.mBatchCount <<
+        " inline: "        << theStats.mInlineBatchCount <<
+        " throttled: "     << theStats.mThrottledBatchCount <<
+        " tasks: "         << theStats.mTaskCount <<
+        " offloaded: "     << theStats.mOffloadedTaskCount <<
+        " max queue: "     << theStats.mMaxQueueDepth <<
+        " bytes: "         << theStats.mByteCount <<
+        "\n";
+    if (theStats.mTaskCount != theTaskCount ||
+            theStats.mBatchCount != theBatches ||
+            theStats.mByteCount != theByteCount) {
+        Error("pool task, batch, or byte count mismatch");
+    }
+    if (theStats.mQueueDepth != 0) {
+        Error("pool queue is not empty");
+    }
+    if (theStats.mInlineBatchCount < (theBatchCount + 6) / 7 *
+            theThreadCount) {
+        // Single task batches must always run on the calling thread.
+        Error("invalid inline batch count");
+    }
+    if (theStats.mTaskCount < theStats.mOffloadedTaskCount) {
+        Error("invalid offloaded task count");
+    }
+    if (sErrorCount == 0) {
+        cout << "Passed EC encoder pool test\n";
+        return 0;
+    }
+    cerr << "EC encoder pool test failed, errors: " << sErrorCount << "\n";
+    return 1;
+}
@@ -0,0 +1,289 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief IOBuffer performance test: typical io buffer operations.
+//
+//----------------------------------------------------------------------------
+
+#include "kfsio/IOBuffer.h"
+#include "common/time.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <vector>
+#include <algorithm>
+
+using namespace KFS;
+using std::vector;
+using std::max;
+
+// Free list allocator, similar to the io buffer pool used by the chunk and
+// meta servers.
+class BenchAllocator : public libkfsio::IOBufferAllocator
+{
+public:
+    BenchAllocator(
+        size_t inBufSize)
+        : mBufSize(inBufSize),
+          mFreeList()
+        {}
+    virtual ~BenchAllocator()
+    {
+        for (vector<char*>::iterator theIt = mFreeList.begin();
+                theIt != mFreeList.end();
+                ++theIt) {
+            free(*theIt);
+        }
+    }
+    virtual size_t GetBufferSize() const
+        { return mBufSize; }
+    virtual char* Allocate()
+    {
+        if (mFreeList.empty()) {
+            void* thePtr = 0;
+            if (posix_memalign(&thePtr, mBufSize, mBufSize)) {
+                abort();
+            }
+            return static_cast<char*>(thePtr);
+        }
+        char* const theRet = mFreeList.back();
+        mFreeList.pop_back();
+        return theRet;
+    }
+    virtual void Deallocate(
+        char* inBufPtr)
+        { mFreeList.push_back(inBufPtr); }
+private:
+    const size_t  mBufSize;
+    vector<char*> mFreeList;
+};
+
+static int64_t sCheckSum = 0;
+
+static void
+Report(
+    const char* inNamePtr,
+    int64_t     inStart,
+    int64_t     inIterations)
+{
+    const int64_t theUsecs = microseconds() - inStart;
+    printf("%-24s %10" PRId64 " iterations %10.3f sec %10.1f nsec/op\n",
+        inNamePtr, inIterations, theUsecs * 1e-6,
+        inIterations > 0 ? theUsecs * 1e3 / inIterations : 0.);
+}
+
+static void
+BenchAppend(
+    int64_t inIterations)
+{
+    // Small message append and consume, like rpc request and response
+    // headers.
+    const char    theMsg[] = "Cseq: 1234567\r\nStatus: 0\r\n\r\n";
+    const int     theLen   = (int)sizeof(theMsg) - 1;
+    const int64_t theStart = microseconds();
+    for (int64_t i = 0; i < inIterations; i++) {
+        IOBuffer theBuf;
+        for (int k = 0; k < 8; k++) {
+            theBuf.CopyIn(theMsg, theLen);
+        }
+        sCheckSum += theBuf.Consume(theBuf.BytesConsumable());
+    }
+    Report("append-small", theStart, inIterations);
+}
+
+static void
+BenchConsume(
+    int64_t inIterations,
+    int     inSize)
+{
+    // Append whole buffers, then consume in small pieces.
+    vector<char>  theData(inSize, 'x');
+    const int64_t theStart = microseconds();
+    for (int64_t i = 0; i < inIterations; i++) {
+        IOBuffer theBuf;
+        theBuf.CopyIn(&theData[0], inSize);
+        while (! theBuf.IsEmpty()) {
+            sCheckSum += theBuf.Consume(1000);
+        }
+    }
+    Report("consume", theStart, inIterations);
+}
+
+static void
+BenchCopyInOut(
+    int64_t inIterations,
+    int     inSize)
+{
+    vector<char>  theData(inSize, 'y');
+    vector<char>  theOut(inSize);
+    const int64_t theStart = microseconds();
+    for (int64_t i = 0; i < inIterations; i++) {
+        IOBuffer theBuf;
+        theBuf.CopyIn(&theData[0], inSize);
+        sCheckSum += theBuf.CopyOut(&theOut[0], inSize);
+    }
+    Report("copy-in-out", theStart, inIterations);
+}
+
+static void
+BenchShare(
+    int64_t inIterations,
+    int     inSize)
+{
+    // Share, split, and move: typical chunk server read / write data path,
+    // and client striper.
+    vector<char> theData(inSize, 'z');
+    IOBuffer     theSrc;
+    theSrc.CopyIn(&theData[0], inSize);
+    const int64_t theStart = microseconds();
+    for (int64_t i = 0; i < inIterations; i++) {
+        IOBuffer theCopy;
+        theCopy.Copy(&theSrc, inSize);
+        IOBuffer theDst;
+        while (! theCopy.IsEmpty()) {
+            sCheckSum += theDst.Move(&theCopy, 1500);
+        }
+        IOBuffer theTail;
+        sCheckSum += theTail.Move(&theDst, inSize / 2);
+        theDst.Move(&theTail);
+        sCheckSum += theDst.BytesConsumable();
+    }
+    Report("copy-move-split", theStart, inIterations);
+}
+
+static void
+BenchReplace(
+    int64_t inIterations,
+    int     inSize)
+{
+    vector<char> theData(inSize, 'r');
+    IOBuffer     theDst;
+    theDst.CopyIn(&theData[0], inSize);
+    const int theChunk = 1 << 10;
+    const int64_t theStart = microseconds();
+    for (int64_t i = 0; i < inIterations; i++) {
+        IOBuffer theSrc;
+        theSrc.CopyIn(&theData[0], theChunk);
+        const int theOffset = (int)((i * 7919) % (inSize - theChunk));
+        theDst.Replace(&theSrc, theOffset, theChunk);
+        IOBuffer theSrc2;
+        theSrc2.CopyIn(&theData[0], theChunk);
+        theDst.ReplaceKeepBuffersFull(&theSrc2, theOffset, theChunk);
+    }
+    sCheckSum += theDst.BytesConsumable();
+    Report("replace", theStart, inIterations);
+}
+
+static void
+BenchSocket(
+    int64_t inIterations,
+    int     inSize)
+{
+    int theFds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, theFds)) {
+        perror("socketpair");
+        abort();
+    }
+    vector<char> theData(inSize, 's');
+    const int64_t theStart = microseconds();
+    for (int64_t i = 0; i < inIterations; i++) {
+        IOBuffer theOut;
+        theOut.CopyIn(&theData[0], inSize);
+        IOBuffer theIn;
+        while (! theOut.IsEmpty()) {
+            const int theRet = theOut.Write(theFds[0]);
+            if (theRet <= 0) {
+                perror("write");
+                abort();
+            }
+            int theRem = theRet;
+            while (0 < theRem) {
+                const int theRd = theIn.Read(theFds[1], theRem);
+                if (theRd <= 0) {
+                    perror("read");
+                    abort();
+                }
+                theRem -= theRd;
+            }
+        }
+        sCheckSum += theIn.BytesConsumable();
+    }
+    Report("socket-write-read", theStart, inIterations);
+    close(theFds[0]);
+    close(theFds[1]);
+}
+
+int
+main(
+    int    argc,
+    char** argv)
+{
+    int64_t theIterations = 1000 * 1000;
+    int     theSize       = 64 << 10;
+    bool    thePoolFlag   = false;
+    int     theOpt;
+    while ((theOpt = getopt(argc, argv, "hn:s:p")) != -1) {
+        switch (theOpt) {
+            case 'n':
+                theIterations = (int64_t)atof(optarg);
+                break;
+            case 's':
+                theSize = (int)atof(optarg);
+                break;
+            case 'p':
+                thePoolFlag = true;
+                break;
+            default:
+                printf("Usage: %s [-n iterations] [-s size] [-p]\n"
+                    " -n number of small buffer op iterations, default 1e6\n"
+                    " -s large buffer size, default 64K\n"
+                    " -p use 4K free list buffer allocator\n",
+                    argv[0]);
+                return (theOpt == 'h' ? 0 : 1);
+        }
+    }
+    if (theIterations <= 0 || theSize < (4 << 10)) {
+        fprintf(stderr, "invalid iterations or size\n");
+        return 1;
+    }
+    static BenchAllocator sAllocator(4 << 10);
+    if (thePoolFlag && ! libkfsio::SetIOBufferAllocator(&sAllocator)) {
+        fprintf(stderr, "failed to set io buffer allocator\n");
+        return 1;
+    }
+    const int64_t theLargeIterations =
+        max(int64_t(1), theIterations * 4096 / theSize);
+    BenchAppend(theIterations);
+    BenchConsume(theLargeIterations, theSize);
+    BenchCopyInOut(theLargeIterations, theSize);
+    BenchShare(theLargeIterations, theSize);
+    BenchReplace(theIterations, theSize);
+    BenchSocket(theLargeIterations, theSize);
+    printf("checksum: %" PRId64 "\n", sCheckSum);
+    return 0;
+}
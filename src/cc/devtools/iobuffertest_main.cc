@@ -0,0 +1,510 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief IOBuffer test:
+// - differential fuzz test: random sequence of buffer operations applied to
+//   a few io buffers, and to their reference model strings,
+// - fragment list splice: fragments order, embedded and allocated nodes,
+//   iterators of the moved allocated nodes remain valid,
+// - data block reference count: sharing, unique owner detach, and
+//   concurrent reference count updates release the block exactly once.
+//
+//----------------------------------------------------------------------------
+
+#include "kfsio/IOBuffer.h"
+#include "qcdio/QCThread.h"
+#include "TestCheck.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace KFS;
+using std::cout;
+using std::cerr;
+using std::string;
+using std::vector;
+
+static uint64_t sRand = 1;
+
+static uint64_t
+Random()
+{
+    sRand = sRand * 6364136223846793005ull + 1442695040888963407ull;
+    return (sRand ^ (sRand >> 29));
+}
+
+static int
+Random(
+    int inMax)
+{
+    return (inMax <= 0 ? 0 : (int)(Random() % (uint64_t)(inMax + 1)));
+}
+
+static string
+RandomString(
+    int inLen)
+{
+    string theRet(inLen, ' ');
+    for (int i = 0; i < inLen; i++) {
+        theRet[i] = (char)('a' + Random() % 26);
+    }
+    return theRet;
+}
+
+static string
+GetContent(
+    const IOBuffer& inBuf)
+{
+    string theRet;
+    for (IOBuffer::iterator theIt = inBuf.begin();
+            theIt != inBuf.end();
+            ++theIt) {
+        theRet.append(theIt->Consumer(), theIt->BytesConsumable());
+    }
+    return theRet;
+}
+
+static int
+GetFragmentCount(
+    const IOBuffer& inBuf)
+{
+    int theRet = 0;
+    for (IOBuffer::iterator theIt = inBuf.begin();
+            theIt != inBuf.end();
+            ++theIt) {
+        theRet++;
+    }
+    return theRet;
+}
+
+static bool
+Verify(
+    const IOBuffer& inBuf,
+    const string&   inModel)
+{
+    if (inBuf.BytesConsumable() != (IOBuffer::BufPos)inModel.size()) {
+        return false;
+    }
+    if (GetContent(inBuf) != inModel) {
+        return false;
+    }
+    string theOut(inModel.size(), ' ');
+    return (inModel.empty() ||
+        (inBuf.CopyOut(&theOut[0], theOut.size()) ==
+            (IOBuffer::BufPos)theOut.size() && theOut == inModel));
+}
+
+// Appends fragments of random size, with random head room and available
+// space.
+static void
+AppendFragments(
+    IOBuffer& inBuf,
+    string&   inModel,
+    int       inCount)
+{
+    for (int i = 0; i < inCount; i++) {
+        const int theSize   = 1 + Random(8 << 10);
+        const int theOffset = Random(theSize - 1);
+        const int theLen    = 1 + Random(theSize - theOffset - 1);
+        IOBufferData theData(theSize);
+        const string theStr = RandomString(theOffset + theLen);
+        theData.CopyIn(theStr.data(), theStr.size());
+        theData.Consume(theOffset);
+        inBuf.Append(theData);
+        inModel.append(theStr, theOffset, theLen);
+    }
+}
+
+// Returns the operation code.
+static int
+ApplyRandomOp(
+    IOBuffer*       inBufs,
+    vector<string>& inModels)
+{
+    const int theCnt = (int)inModels.size();
+    const int theIdx = Random(theCnt - 1);
+    int       theOth = Random(theCnt - 2);
+    if (theIdx <= theOth) {
+        theOth++;
+    }
+    IOBuffer& theBuf   = inBufs[theIdx];
+    string&   theModel = inModels[theIdx];
+    IOBuffer& theOther = inBufs[theOth];
+    string&   theOModel = inModels[theOth];
+    const int theSize  = (int)theModel.size();
+    const int theOSize = (int)theOModel.size();
+    const int theOp = Random(13);
+    switch (theOp) {
+        case 0: {
+            const string theStr = RandomString(Random(10000));
+            CHECK(theBuf.CopyIn(theStr.data(), theStr.size()) ==
+                (IOBuffer::BufPos)theStr.size());
+            theModel += theStr;
+        }
+        break;
+        case 1: {
+            const int theLen = Random(theSize);
+            CHECK(theBuf.Consume(theLen) == theLen);
+            theModel.erase(0, theLen);
+        }
+        break;
+        case 2: {
+            const int theLen = Random(theOSize);
+            CHECK(theBuf.Move(&theOther, theLen) == theLen);
+            theModel.append(theOModel, 0, theLen);
+            theOModel.erase(0, theLen);
+        }
+        break;
+        case 3:
+            theBuf.Move(&theOther);
+            theModel += theOModel;
+            theOModel.clear();
+        break;
+        case 4:
+            CHECK(theBuf.Append(&theOther) == theOSize);
+            theModel += theOModel;
+            theOModel.clear();
+        break;
+        case 5: {
+            // Shared buffers.
+            IOBuffer* const theClonePtr = theOther.Clone();
+            theBuf.Move(theClonePtr);
+            delete theClonePtr;
+            theModel += theOModel;
+        }
+        break;
+        case 6:
+        case 7: {
+            // ReplaceKeepBuffersFull() destination buffers are full, and
+            // callers never request more than the source has.
+            const bool theKeepFullFlag = Random(1) == 0;
+            const int  theOffset = Random(theSize + 100);
+            const int  theLen    =
+                Random(theOSize + (theKeepFullFlag ? 0 : 100));
+            const int  theMove   = theLen < theOSize ? theLen : theOSize;
+            if (theSize < theOffset) {
+                theModel.append(theOffset - theSize, '\0');
+            }
+            theModel.replace(theOffset, theMove, theOModel, 0, theMove);
+            theOModel.erase(0, theMove);
+            if (theKeepFullFlag) {
+                theBuf.MakeBuffersFull();
+                theBuf.ReplaceKeepBuffersFull(&theOther, theOffset, theLen);
+            } else {
+                theBuf.Replace(&theOther, theOffset, theLen);
+            }
+        }
+        break;
+        case 8: {
+            const int theLen = Random(5000);
+            theBuf.ZeroFill(theLen);
+            theModel.append(theLen, '\0');
+        }
+        break;
+        case 9: {
+            const int theLen = Random(theSize);
+            // Trim of a shared block exposes the space past the trimmed
+            // producer to the subsequent appends, thus the shared buffer is
+            // "trimmed" by moving its head.
+            bool theSharedFlag = false;
+            for (IOBuffer::iterator theIt = theBuf.begin();
+                    theIt != theBuf.end() && ! theSharedFlag;
+                    ++theIt) {
+                theSharedFlag = theIt->IsShared();
+            }
+            if (theSharedFlag) {
+                IOBuffer theHead;
+                CHECK(theHead.Move(&theBuf, theLen) == theLen);
+                theBuf.Clear();
+                theBuf.Move(&theHead);
+            } else {
+                theBuf.Trim(theLen);
+            }
+            theModel.erase(theLen);
+        }
+        break;
+        case 10:
+            theBuf.MakeBuffersFull();
+            for (IOBuffer::iterator theIt = theBuf.begin();
+                    theIt != theBuf.end();
+                    ++theIt) {
+                CHECK(theIt->HasCompleteBuffer());
+            }
+        break;
+        case 11: {
+            const int theLen = Random(theOSize);
+            CHECK(theBuf.Copy(&theOther, theLen) == theLen);
+            theModel.append(theOModel, 0, theLen);
+        }
+        break;
+        case 12:
+            AppendFragments(theBuf, theModel, Random(3));
+        break;
+        default:
+            theBuf.Clear();
+            theModel.clear();
+        break;
+    }
+    return theOp;
+}
+
+static void
+FuzzTest(
+    int inSeed,
+    int inOpCount)
+{
+    const int      kBufCount = 4;
+    IOBuffer       theBufs[kBufCount];
+    vector<string> theModels(kBufCount);
+    sRand = (uint64_t)inSeed;
+    for (int i = 0; i < inOpCount && sErrorCount <= 0; i++) {
+        const int theOp = ApplyRandomOp(theBufs, theModels);
+        for (int k = 0; k < kBufCount; k++) {
+            if (! Verify(theBufs[k], theModels[k])) {
+                cerr << "seed: " << inSeed << " step: " << i <<
+                    " op: " << theOp << " buffer: " << k <<
+                    " content mismatch\n";
+                sErrorCount++;
+                break;
+            }
+        }
+    }
+}
+
+static void
+SpliceTest()
+{
+    // Fragments: the first two use embedded list nodes, the remaining are
+    // allocated.
+    IOBuffer                   theSrc;
+    string                     theModel;
+    vector<IOBuffer::iterator> theIts;
+    for (int i = 0; i < 6; i++) {
+        AppendFragments(theSrc, theModel, 1);
+        IOBuffer::iterator theIt = theSrc.end();
+        theIts.push_back(--theIt);
+    }
+    CHECK(GetFragmentCount(theSrc) == 6);
+    IOBuffer theDst;
+    string   theDstModel;
+    AppendFragments(theDst, theDstModel, 1);
+    theDst.Move(&theSrc);
+    theDstModel += theModel;
+    CHECK(theSrc.IsEmpty() && theSrc.begin() == theSrc.end());
+    CHECK(Verify(theDst, theDstModel));
+    CHECK(GetFragmentCount(theDst) == 7);
+    // Allocated nodes are relinked, their iterators remain valid and refer
+    // to the destination buffer elements.
+    IOBuffer::iterator theIt = theDst.begin();
+    for (int i = 0; i < 3; i++) {
+        ++theIt;
+    }
+    for (size_t i = 2; i < theIts.size(); i++, ++theIt) {
+        CHECK(theIts[i] == theIt);
+    }
+    CHECK(theIt == theDst.end());
+
+    // Embedded nodes in the middle of the list: consume the first fragments
+    // to free embedded nodes, then append, making allocated nodes precede
+    // the embedded ones.
+    IOBuffer theMid;
+    string   theMidModel;
+    AppendFragments(theMid, theMidModel, 4);
+    IOBuffer::iterator theFirst = theMid.begin();
+    const int theHead = (int)(theFirst->BytesConsumable() +
+        (++theFirst)->BytesConsumable());
+    theMid.Consume(theHead);
+    theMidModel.erase(0, theHead);
+    AppendFragments(theMid, theMidModel, 2);
+    CHECK(GetFragmentCount(theMid) == 4);
+    IOBuffer theMid2;
+    string   theMid2Model;
+    AppendFragments(theMid2, theMid2Model, 1);
+    theMid.Move(&theMid2);
+    theMidModel += theMid2Model;
+    AppendFragments(theMid, theMidModel, 1);
+    CHECK(Verify(theMid, theMidModel));
+    // Partial move splits and splices fragment ranges.
+    IOBuffer theTail;
+    const int theLen = (int)theMidModel.size() / 2;
+    CHECK(theTail.Move(&theMid, theLen) == theLen);
+    CHECK(Verify(theTail, theMidModel.substr(0, theLen)));
+    CHECK(Verify(theMid, theMidModel.substr(theLen)));
+    theTail.Move(&theMid);
+    CHECK(Verify(theTail, theMidModel));
+    CHECK(Verify(theMid, string()));
+}
+
+// Counts buffer allocations, to verify that the last reference releases the
+// data block exactly once.
+class CountingAllocator : public libkfsio::IOBufferAllocator
+{
+public:
+    enum { kBufSize = 4 << 10 };
+
+    CountingAllocator()
+        : mAllocCount(0),
+          mDeallocCount(0)
+        {}
+    virtual ~CountingAllocator()
+        {}
+    virtual size_t GetBufferSize() const
+        { return kBufSize; }
+    virtual char* Allocate()
+    {
+        SyncAddAndFetch(mAllocCount, 1);
+        return new char[kBufSize];
+    }
+    virtual void Deallocate(
+        char* inBufPtr)
+    {
+        SyncAddAndFetch(mDeallocCount, 1);
+        delete [] inBufPtr;
+    }
+    int GetAllocCount() const
+        { return mAllocCount; }
+    int GetDeallocCount() const
+        { return mDeallocCount; }
+private:
+    volatile int mAllocCount;
+    volatile int mDeallocCount;
+};
+
+class RefCountWorker : public QCRunnable
+{
+public:
+    RefCountWorker(
+        const IOBufferData& inData,
+        int                 inIterations)
+        : QCRunnable(),
+          mData(inData),
+          mIterations(inIterations),
+          mThread(this, "iobuffertest")
+        {}
+    virtual ~RefCountWorker()
+        {}
+    void Start()
+        { mThread.Start(); }
+    void Join()
+        { mThread.Join(); }
+    virtual void Run()
+    {
+        vector<IOBufferData> theCopies;
+        for (int i = 0; i < mIterations; i++) {
+            theCopies.push_back(mData);
+            if (theCopies.size() > 16) {
+                theCopies.clear();
+            }
+        }
+        theCopies.clear();
+        // Release the thread's reference.
+        mData = IOBufferData(0);
+    }
+private:
+    IOBufferData mData;
+    const int    mIterations;
+    QCThread     mThread;
+private:
+    RefCountWorker(
+        const RefCountWorker& inWorker);
+    RefCountWorker& operator=(
+        const RefCountWorker& inWorker);
+};
+
+static void
+RefCountTest()
+{
+    CountingAllocator theAllocator;
+    {
+        IOBufferData theData(0, 0, 10, theAllocator);
+        CHECK(theAllocator.GetAllocCount() == 1);
+        CHECK(! theData.IsShared());
+        {
+            IOBufferData theCopy(theData);
+            CHECK(theData.IsShared() && theCopy.IsShared());
+            IOBuffer theBuf;
+            theBuf.Append(theCopy);
+            IOBuffer* const theClonePtr = theBuf.Clone();
+            CHECK(theClonePtr->begin()->GetBufferPtr() ==
+                theData.GetBufferPtr());
+            delete theClonePtr;
+        }
+        CHECK(! theData.IsShared());
+        CHECK(theAllocator.GetDeallocCount() == 0);
+        // Shared buffer can not be detached.
+        IOBufferData theShared(theData);
+        CHECK(theShared.DetachBuffer(false) == 0);
+    }
+    CHECK(theAllocator.GetDeallocCount() == 1);
+    {
+        // Unique owner detach releases the ownership without the deleter.
+        IOBufferData theData(0, 0, 10, theAllocator);
+        char* const thePtr = theData.DetachBuffer(true);
+        CHECK(thePtr != 0);
+        theAllocator.Deallocate(thePtr);
+    }
+    CHECK(theAllocator.GetDeallocCount() == 2);
+    {
+        // Concurrent reference count updates.
+        const int               kThreadCount = 4;
+        IOBufferData            theData(0, 0, 10, theAllocator);
+        vector<RefCountWorker*> theWorkers;
+        for (int i = 0; i < kThreadCount; i++) {
+            theWorkers.push_back(new RefCountWorker(theData, 200000));
+        }
+        for (int i = 0; i < kThreadCount; i++) {
+            theWorkers[i]->Start();
+        }
+        for (int i = 0; i < kThreadCount; i++) {
+            theWorkers[i]->Join();
+            delete theWorkers[i];
+        }
+        CHECK(! theData.IsShared());
+        CHECK(theAllocator.GetDeallocCount() == 2);
+    }
+    CHECK(theAllocator.GetDeallocCount() == 3);
+    CHECK(theAllocator.GetAllocCount() == 3);
+}
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    const int theSeed  = 1 < inArgCount ? atoi(inArgsPtr[1]) : 1;
+    const int theSeeds = 2 < inArgCount ? atoi(inArgsPtr[2]) : 100;
+    const int theOps   = 3 < inArgCount ? atoi(inArgsPtr[3]) : 3000;
+    SpliceTest();
+    RefCountTest();
+    for (int i = 0; i < theSeeds && sErrorCount <= 0; i++) {
+        FuzzTest(theSeed + i, theOps);
+    }
+    if (sErrorCount == 0) {
+        cout << "Passed IOBuffer test\n";
+        return 0;
+    }
+    cerr << "IOBuffer test failed, errors: " << sErrorCount << "\n";
+    return 1;
+}
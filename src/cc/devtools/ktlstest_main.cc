@@ -0,0 +1,396 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Ssl filter kernel TLS offload test. Client and echo server PSK ssl
+// connections over loopback tcp socket pair are run with the "ktls" ssl
+// context parameter off and on. The echoed data must be the same as sent,
+// and the connection must be shut down cleanly, with the close notify alert
+// passed to ssl. With the parameter off, or if the kernel, or the openssl
+// library, or the negotiated cipher do not support the offload, the user
+// space TLS must be used, and the kernel TLS counters must not change.
+//
+//----------------------------------------------------------------------------
+
+#include "kfsio/SslFilter.h"
+#include "kfsio/Globals.h"
+#include "kfsio/NetConnection.h"
+#include "kfsio/NetManager.h"
+#include "kfsio/KfsCallbackObj.h"
+#include "common/MsgLogger.h"
+#include "common/Properties.h"
+#include "TestCheck.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace KFS
+{
+
+using std::cout;
+using std::cerr;
+using std::string;
+using std::istringstream;
+
+class KtlsTest : public SslFilterServerPsk
+{
+public:
+    KtlsTest()
+        : SslFilterServerPsk(),
+          mPskIdentity("ktlstest"),
+          mPskKey("ktls test key")
+        {}
+    virtual ~KtlsTest()
+        {}
+    // Returns the number of the offloaded sessions.
+    int Run(
+        bool inKtlsFlag,
+        int  inByteCount)
+    {
+        Properties        theProps;
+        const char* const kPrefix = "ktlsTest.";
+        string            thePropsStr;
+        thePropsStr += kPrefix;
+        thePropsStr += "ktls=";
+        thePropsStr += inKtlsFlag ? "1\n" : "0\n";
+        istringstream theStream(thePropsStr);
+        theProps.loadProperties(theStream, '=');
+        string theErrMsg;
+        SslFilter::Ctx* const theServerCtxPtr = SslFilter::CreateCtx(
+            true, true, kPrefix, theProps, &theErrMsg);
+        SslFilter::Ctx* const theClientCtxPtr = theServerCtxPtr ?
+            SslFilter::CreateCtx(false, true, kPrefix, theProps, &theErrMsg) :
+            0;
+        CHECK(theServerCtxPtr && theClientCtxPtr);
+        int theFds[2] = { -1, -1 };
+        if (! theClientCtxPtr || ! CreateSocketPair(theFds)) {
+            cerr << "error: " << theErrMsg << "\n";
+            SslFilter::FreeCtx(theServerCtxPtr);
+            SslFilter::FreeCtx(theClientCtxPtr);
+            sErrorCount++;
+            return 0;
+        }
+        const int64_t theSessions =
+            libkfsio::globals().ctrNetKtlsSessions.GetValue();
+        const int64_t theRead     =
+            libkfsio::globals().ctrNetKtlsBytesRead.GetValue();
+        const int64_t theWritten  =
+            libkfsio::globals().ctrNetKtlsBytesWritten.GetValue();
+        {
+            NetManager  theNetManager;
+            SslFilter   theServerFilter(*theServerCtxPtr,
+                0, 0, 0, this, 0, false);
+            SslFilter   theClientFilter(*theClientCtxPtr,
+                mPskKey.data(), mPskKey.size(), mPskIdentity.c_str(),
+                0, 0, false);
+            Peer theServer(theNetManager, theFds[0], theServerFilter, 0);
+            Peer theClient(theNetManager, theFds[1], theClientFilter,
+                inByteCount);
+            theServer.SetOther(theClient);
+            theClient.SetOther(theServer);
+            if (theServer.Start() && theClient.Start()) {
+                theNetManager.MainLoop();
+            } else {
+                sErrorCount++;
+            }
+            CHECK(theClient.GetReceivedCount() == inByteCount);
+            CHECK(theServer.GetReceivedCount() == inByteCount);
+            CHECK(theClient.IsDone() && theServer.IsDone());
+        }
+        SslFilter::FreeCtx(theServerCtxPtr);
+        SslFilter::FreeCtx(theClientCtxPtr);
+        const int64_t theSessionsCnt =
+            libkfsio::globals().ctrNetKtlsSessions.GetValue() - theSessions;
+        const int64_t theReadCnt     =
+            libkfsio::globals().ctrNetKtlsBytesRead.GetValue() - theRead;
+        const int64_t theWrittenCnt  =
+            libkfsio::globals().ctrNetKtlsBytesWritten.GetValue() - theWritten;
+        CHECK(0 <= theSessionsCnt && theSessionsCnt <= 2);
+        if (! inKtlsFlag || theSessionsCnt <= 0) {
+            // User space TLS fallback.
+            CHECK(theSessionsCnt == 0 && theReadCnt == 0 &&
+                theWrittenCnt == 0);
+        } else {
+            CHECK(0 < theReadCnt || 0 < theWrittenCnt);
+        }
+        return (int)theSessionsCnt;
+    }
+    virtual unsigned long GetPsk(
+        const char*    inIdentityPtr,
+        unsigned char* inPskBufferPtr,
+        unsigned int   inPskBufferLen,
+        string&        outAuthName)
+    {
+        if (inPskBufferLen <= mPskKey.size() ||
+                mPskIdentity != (inIdentityPtr ? inIdentityPtr : "")) {
+            return 0;
+        }
+        memcpy(inPskBufferPtr, mPskKey.data(), mPskKey.size());
+        outAuthName = mPskIdentity;
+        return mPskKey.size();
+    }
+private:
+    // Server echoes the received data, client sends the data, verifies the
+    // echo, and closes the connection once all data is received. The client
+    // close sends the close notify alert.
+    class Peer : public KfsCallbackObj
+    {
+    public:
+        Peer(
+            NetManager& inNetManager,
+            int         inFd,
+            SslFilter&  inFilter,
+            int         inByteCount)
+            : KfsCallbackObj(),
+              mNetManager(inNetManager),
+              mConnectionPtr(new NetConnection(new TcpSocket(inFd), this)),
+              mFilter(inFilter),
+              mOtherPtr(0),
+              mData(),
+              mByteCount(inByteCount),
+              mReceivedCount(0),
+              mDoneFlag(false)
+        {
+            SET_HANDLER(this, &Peer::EventHandler);
+            uint64_t theRand = 0x9E3779B97F4A7C15ull;
+            mData.resize(mByteCount);
+            for (int i = 0; i < mByteCount; i++) {
+                theRand = theRand * 6364136223846793005ull +
+                    1442695040888963407ull;
+                mData[i] = (char)(theRand >> 33);
+            }
+        }
+        virtual ~Peer()
+            { mConnectionPtr->Close(); }
+        void SetOther(
+            Peer& inOther)
+            { mOtherPtr = &inOther; }
+        bool Start()
+        {
+            string    theErrMsg;
+            const int theErr = mConnectionPtr->SetFilter(&mFilter, &theErrMsg);
+            if (theErr) {
+                cerr << "set filter error: " << theErr << " " << theErrMsg <<
+                    "\n";
+                return false;
+            }
+            const int kTimeout = 60;
+            mConnectionPtr->SetInactivityTimeout(kTimeout);
+            mConnectionPtr->SetMaxReadAhead(64 << 10);
+            mNetManager.AddConnection(mConnectionPtr);
+            if (0 < mByteCount) {
+                // Send in a few writes, to have more than one tls record.
+                const int kWriteSize = 100 << 10;
+                for (int thePos = 0; thePos < mByteCount;
+                        thePos += kWriteSize) {
+                    mConnectionPtr->GetOutBuffer().CopyIn(
+                        mData.data() + thePos,
+                        std::min(kWriteSize, mByteCount - thePos));
+                }
+                mConnectionPtr->StartFlush();
+            }
+            return true;
+        }
+        int GetReceivedCount() const
+            { return mReceivedCount; }
+        bool IsDone() const
+            { return mDoneFlag; }
+        int EventHandler(
+            int   inEventCode,
+            void* inEventDataPtr)
+        {
+            switch (inEventCode) {
+                case EVENT_NET_READ: {
+                    IOBuffer& theBuf = mConnectionPtr->GetInBuffer();
+                    const int theLen = theBuf.BytesConsumable();
+                    if (mByteCount <= 0) {
+                        // Echo.
+                        mReceivedCount += theLen;
+                        mConnectionPtr->Write(&theBuf);
+                        break;
+                    }
+                    string theRecv(theLen, ' ');
+                    theBuf.CopyOut(&theRecv[0], theLen);
+                    theBuf.Consume(theLen);
+                    if (mByteCount < mReceivedCount + theLen ||
+                            mData.compare(mReceivedCount, theLen, theRecv) !=
+                                0) {
+                        cerr << "error: echo data mismatch at: " <<
+                            mReceivedCount << "\n";
+                        sErrorCount++;
+                        Done();
+                        break;
+                    }
+                    mReceivedCount += theLen;
+                    if (mByteCount <= mReceivedCount) {
+                        Done();
+                    }
+                    break;
+                }
+                case EVENT_NET_WROTE:
+                    break;
+                case EVENT_NET_ERROR:
+                    // The server must receive the client close notify.
+                    if (mByteCount <= 0 && mConnectionPtr->IsGood() &&
+                            mOtherPtr->IsDone()) {
+                        Done();
+                        break;
+                    }
+                    // Fall through.
+                case EVENT_INACTIVITY_TIMEOUT:
+                default:
+                    cerr << "error: " << (mByteCount <= 0 ? "server" :
+                        "client") << " unexpected event: " << inEventCode <<
+                        " received: " << mReceivedCount << "\n";
+                    sErrorCount++;
+                    Done();
+                    mOtherPtr->Done();
+                    break;
+            }
+            if (mConnectionPtr->IsGood()) {
+                mConnectionPtr->StartFlush();
+            }
+            return 0;
+        }
+        void Done()
+        {
+            if (mDoneFlag) {
+                return;
+            }
+            mDoneFlag = true;
+            mConnectionPtr->Close();
+            if (mOtherPtr->IsDone()) {
+                mNetManager.Shutdown();
+            }
+        }
+    private:
+        NetManager&            mNetManager;
+        NetConnectionPtr const mConnectionPtr;
+        SslFilter&             mFilter;
+        Peer*                  mOtherPtr;
+        string                 mData;
+        const int              mByteCount;
+        int                    mReceivedCount;
+        bool                   mDoneFlag;
+    private:
+        Peer(
+            const Peer& inPeer);
+        Peer& operator=(
+            const Peer& inPeer);
+    };
+
+    const string mPskIdentity;
+    const string mPskKey;
+
+    static bool CreateSocketPair(
+        int* outFds)
+    {
+        const int theListenFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (theListenFd < 0) {
+            return false;
+        }
+        struct sockaddr_in theAddr;
+        memset(&theAddr, 0, sizeof(theAddr));
+        theAddr.sin_family      = AF_INET;
+        theAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        theAddr.sin_port        = 0;
+        socklen_t theLen = sizeof(theAddr);
+        bool theRet =
+            bind(theListenFd, (struct sockaddr*)&theAddr, theLen) == 0 &&
+            listen(theListenFd, 1) == 0 &&
+            getsockname(theListenFd, (struct sockaddr*)&theAddr,
+                &theLen) == 0 &&
+            0 <= (outFds[1] = socket(AF_INET, SOCK_STREAM, 0)) &&
+            connect(outFds[1], (struct sockaddr*)&theAddr, theLen) == 0 &&
+            0 <= (outFds[0] = accept(theListenFd, 0, 0)) &&
+            fcntl(outFds[0], F_SETFL, O_NONBLOCK) == 0 &&
+            fcntl(outFds[1], F_SETFL, O_NONBLOCK) == 0;
+        if (! theRet) {
+            perror("socket pair");
+            for (int i = 0; i < 2; i++) {
+                if (0 <= outFds[i]) {
+                    close(outFds[i]);
+                }
+            }
+        }
+        close(theListenFd);
+        return theRet;
+    }
+private:
+    KtlsTest(
+        const KtlsTest& inTest);
+    KtlsTest& operator=(
+        const KtlsTest& inTest);
+};
+
+}
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    using namespace KFS;
+    const int theByteCount = 1 < inArgCount ? atoi(inArgsPtr[1]) :
+        (8 << 20) + 123;
+    signal(SIGPIPE, SIG_IGN);
+    MsgLogger::Init(0, MsgLogger::kLogLevelINFO);
+    libkfsio::InitGlobals();
+    SslFilter::Error theErr = SslFilter::Initialize();
+    if (theErr) {
+        cerr << "SslFilter init error: " <<
+            SslFilter::GetErrorMsg(theErr) << "\n";
+        return 1;
+    }
+    {
+        KtlsTest theTest;
+        CHECK(theTest.Run(false, theByteCount) == 0);
+        const int theSessions = theTest.Run(true, theByteCount);
+        cout << "kernel tls: " << (0 < theSessions ?
+            "offloaded" : "not available, user space tls used") << "\n";
+    }
+    theErr = SslFilter::Cleanup();
+    if (theErr) {
+        cerr << "SslFilter cleanup error: " <<
+            SslFilter::GetErrorMsg(theErr) << "\n";
+        sErrorCount++;
+    }
+    libkfsio::DestroyGlobals();
+    MsgLogger::Stop();
+    if (sErrorCount == 0) {
+        cout << "Passed kernel tls test\n";
+        return 0;
+    }
+    cerr << "Kernel tls test failed, errors: " << sErrorCount << "\n";
+    return 1;
+}
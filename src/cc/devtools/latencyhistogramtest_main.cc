@@ -0,0 +1,244 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Latency histogram bucket, percentile, and merge unit test.
+//
+//----------------------------------------------------------------------------
+
+#include "common/LatencyHistogram.h"
+#include "TestCheck.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace KFS;
+using std::cout;
+using std::cerr;
+using std::vector;
+using std::ostringstream;
+using std::string;
+using std::sort;
+
+static bool
+CheckValue(
+    int64_t inValue)
+{
+    const int theIdx = LatencyHistogram::GetBucketIndex(inValue);
+    if (theIdx < 0 || LatencyHistogram::kBucketCount <= theIdx) {
+        cerr << "value: " << inValue << " invalid index: " << theIdx << "\n";
+        return false;
+    }
+    const int64_t theLower = LatencyHistogram::GetBucketLowerBound(theIdx);
+    const int64_t theUpper = LatencyHistogram::GetBucketUpperBound(theIdx);
+    if (inValue < theLower || theUpper < inValue) {
+        cerr << "value: " << inValue << " index: " << theIdx <<
+            " not in [" << theLower << "," << theUpper << "]\n";
+        return false;
+    }
+    // Relative error must not exceed 1 / kSubBucketCount.
+    if (LatencyHistogram::kSubBucketCount * (theUpper - theLower) >
+            theLower) {
+        if (2 * LatencyHistogram::kSubBucketCount <= theIdx) {
+            cerr << "value: " << inValue << " index: " << theIdx <<
+                " bucket width: " << (theUpper - theLower + 1) <<
+                " exceeds max relative error\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+static void
+TestBuckets()
+{
+    // Buckets are contiguous, non overlapping, and cover [0, kMaxValue].
+    CHECK(LatencyHistogram::GetBucketLowerBound(0) == 0);
+    for (int i = 0; i + 1 < LatencyHistogram::kBucketCount; i++) {
+        const int64_t theLower = LatencyHistogram::GetBucketLowerBound(i);
+        const int64_t theUpper = LatencyHistogram::GetBucketUpperBound(i);
+        CHECK(theLower <= theUpper);
+        CHECK(theUpper + 1 == LatencyHistogram::GetBucketLowerBound(i + 1));
+        CHECK(LatencyHistogram::GetBucketIndex(theLower) == i);
+        CHECK(LatencyHistogram::GetBucketIndex(theUpper) == i);
+    }
+    CHECK(LatencyHistogram::GetBucketUpperBound(
+        LatencyHistogram::kBucketCount - 1) == LatencyHistogram::kMaxValue);
+    CHECK(LatencyHistogram::GetBucketIndex(LatencyHistogram::kMaxValue) ==
+        LatencyHistogram::kBucketCount - 1);
+    // Out of range values.
+    CHECK(LatencyHistogram::GetBucketIndex(-1) == 0);
+    CHECK(LatencyHistogram::GetBucketIndex(LatencyHistogram::kMaxValue + 1) ==
+        LatencyHistogram::kBucketCount - 1);
+    CHECK(LatencyHistogram::GetBucketIndex(int64_t(1) << 62) ==
+        LatencyHistogram::kBucketCount - 1);
+    // Exhaustive check of the small values, then powers of two and their
+    // neighbors, then random values.
+    bool theOkFlag = true;
+    for (int64_t i = 0; i < (int64_t(1) << 16) && theOkFlag; i++) {
+        theOkFlag = CheckValue(i);
+    }
+    for (int i = 1; i < LatencyHistogram::kMaxExponent && theOkFlag; i++) {
+        const int64_t theVal = int64_t(1) << i;
+        theOkFlag = CheckValue(theVal - 1) && CheckValue(theVal) &&
+            CheckValue(theVal + 1);
+    }
+    for (int i = 0; i < 1000000 && theOkFlag; i++) {
+        const int64_t theVal = (((int64_t)rand() << 31) | rand()) %
+            (LatencyHistogram::kMaxValue + 1);
+        theOkFlag = CheckValue(theVal);
+    }
+    CHECK(theOkFlag);
+}
+
+static string
+ToString(
+    const LatencyHistogram& inHistogram)
+{
+    ostringstream theStream;
+    inHistogram.Display(theStream);
+    theStream << " count: " << inHistogram.GetCount() <<
+        " total: "          << inHistogram.GetTotal() <<
+        " min: "            << inHistogram.GetMin() <<
+        " max: "            << inHistogram.GetMax() <<
+        " mean: "           << inHistogram.GetMean();
+    for (int i = 0; i <= 100; i += 5) {
+        theStream << " p" << i << ": " << inHistogram.GetPercentile(i);
+    }
+    theStream << " p99.9: " << inHistogram.GetPercentile(99.9);
+    return theStream.str();
+}
+
+static int64_t
+RandomLatency()
+{
+    // Log uniform distribution of values with random "tail".
+    const int theExp = rand() % 28;
+    return ((((int64_t)rand() << 31) | rand()) % ((int64_t(1) << theExp) + 1));
+}
+
+static void
+TestPercentiles()
+{
+    LatencyHistogram theHistogram;
+    CHECK(theHistogram.GetCount() == 0);
+    CHECK(theHistogram.GetPercentile(50) == 0);
+    CHECK(theHistogram.GetMean() == 0);
+    vector<int64_t> theValues;
+    for (int i = 0; i < 10000; i++) {
+        theValues.push_back(RandomLatency());
+        theHistogram.Add(theValues.back());
+    }
+    sort(theValues.begin(), theValues.end());
+    CHECK(theHistogram.GetMin() == theValues.front());
+    CHECK(theHistogram.GetMax() == theValues.back());
+    CHECK(theHistogram.GetCount() == (int64_t)theValues.size());
+    const double thePercentiles[] = { 0, 1, 10, 50, 90, 99, 99.9, 100 };
+    for (size_t i = 0;
+            i < sizeof(thePercentiles) / sizeof(thePercentiles[0]);
+            i++) {
+        // Percentile is the upper bound of the bucket that contains the
+        // exact percentile value.
+        int64_t theRank = (int64_t)(
+            thePercentiles[i] * theValues.size() / 100. + .5);
+        if (theRank < 1) {
+            theRank = 1;
+        }
+        const int64_t theExact = theValues[theRank - 1];
+        const int64_t theVal   = theHistogram.GetPercentile(thePercentiles[i]);
+        const int     theIdx   = LatencyHistogram::GetBucketIndex(theExact);
+        CHECK(theExact <= theVal);
+        CHECK(theVal == std::min(theHistogram.GetMax(),
+            LatencyHistogram::GetBucketUpperBound(theIdx)));
+    }
+    theHistogram.Add(-5);
+    CHECK(theHistogram.GetMin() == 0);
+    theHistogram.Clear();
+    CHECK(ToString(theHistogram) == ToString(LatencyHistogram()));
+}
+
+static void
+TestMerge()
+{
+    // Merge of the histograms must be the same as the histogram of all
+    // values, including empty histograms, and disjoint value ranges.
+    for (int theTest = 0; theTest < 64; theTest++) {
+        LatencyHistogram theAll;
+        LatencyHistogram theParts[4];
+        const int        theCount = theTest % 8 == 0 ? 0 : rand() % 2000;
+        for (int i = 0; i < theCount; i++) {
+            const int     thePart = theTest % 3 == 0 ?
+                i * 4 / theCount : rand() % 4;
+            if (theTest % 5 == 0 && thePart == 2) {
+                continue;
+            }
+            const int64_t theVal  = RandomLatency();
+            theAll.Add(theVal);
+            theParts[thePart].Add(theVal);
+        }
+        LatencyHistogram theMerged;
+        for (int i = 3; 0 <= i; i--) {
+            theMerged.Merge(theParts[i]);
+        }
+        CHECK(ToString(theMerged) == ToString(theAll));
+        LatencyHistogram theMergedInto = theParts[1];
+        theMergedInto.Merge(theParts[0]);
+        theMergedInto.Merge(LatencyHistogram());
+        theMergedInto.Merge(theParts[3]);
+        theMergedInto.Merge(theParts[2]);
+        CHECK(ToString(theMergedInto) == ToString(theAll));
+    }
+    // Min and max of the merged histogram with the values in the first and
+    // the last bucket.
+    LatencyHistogram theLow;
+    LatencyHistogram theHigh;
+    theLow.Add(0);
+    theHigh.Add(LatencyHistogram::kMaxValue * 2);
+    theHigh.Merge(theLow);
+    CHECK(theHigh.GetMin() == 0);
+    CHECK(theHigh.GetMax() == LatencyHistogram::kMaxValue * 2);
+    CHECK(theHigh.GetPercentile(50) == 0);
+    CHECK(theHigh.GetPercentile(100) == LatencyHistogram::kMaxValue);
+}
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    const unsigned int theSeed = 1 < inArgCount ?
+        (unsigned int)atoi(inArgsPtr[1]) : 1;
+    srand(theSeed);
+    TestBuckets();
+    TestPercentiles();
+    TestMerge();
+    if (sErrorCount == 0) {
+        cout << "Passed latency histogram test\n";
+        return 0;
+    }
+    cerr << "Latency histogram test failed, errors: " << sErrorCount <<
+        " seed: " << theSeed << "\n";
+    return 1;
+}
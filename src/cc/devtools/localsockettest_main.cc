@@ -0,0 +1,243 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Unix domain socket transport test. Verifies that:
+// - the local address check, and the socket path are consistent,
+// - the data can be sent both ways through the unix domain socket bound and
+//   connected with BindLocal() and ConnectLocal(),
+// - the net connection to the local ip address connects through the unix
+//   domain socket in the net manager's local socket directory if the server
+//   is listening on the socket, and falls back to TCP if the socket does not
+//   exist, if the socket is stale, i.e. nobody listens on it, or if the net
+//   manager's local socket directory is not set.
+//
+//----------------------------------------------------------------------------
+
+#include "kfsio/TcpSocket.h"
+#include "kfsio/NetConnection.h"
+#include "kfsio/NetManager.h"
+#include "kfsio/KfsCallbackObj.h"
+#include "kfsio/Globals.h"
+#include "common/kfsdecls.h"
+#include "common/MsgLogger.h"
+#include "TestCheck.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+
+using namespace KFS;
+using std::cout;
+using std::cerr;
+using std::string;
+
+class ConnectCallback : public KfsCallbackObj
+{
+public:
+    ConnectCallback()
+        : KfsCallbackObj()
+        { SET_HANDLER(this, &ConnectCallback::EventHandler); }
+    int EventHandler(
+        int   /* inCode */,
+        void* /* inDataPtr */)
+        { return 0; }
+};
+
+// Accept with the listener in non blocking mode, allow the non blocking
+// connect to complete.
+static TcpSocket*
+Accept(
+    TcpSocket& inListener)
+{
+    for (int i = 0; i < 200; i++) {
+        TcpSocket* const theSockPtr = inListener.Accept();
+        if (theSockPtr) {
+            return theSockPtr;
+        }
+        usleep(10 * 1000);
+    }
+    return 0;
+}
+
+static void
+AddressTest(
+    const string& inDir)
+{
+    CHECK(TcpSocket::IsLocalIpAddress("127.0.0.1"));
+    CHECK(TcpSocket::IsLocalIpAddress("127.1.2.3"));
+    CHECK(TcpSocket::IsLocalIpAddress("::1"));
+    CHECK(! TcpSocket::IsLocalIpAddress("192.0.2.1"));
+    CHECK(! TcpSocket::IsLocalIpAddress("not-an-ip-address"));
+    CHECK(! TcpSocket::IsLocalIpAddress(0));
+    CHECK(TcpSocket::GetLocalSocketPath(inDir, 20000) ==
+        inDir + "/qfs.20000.sock");
+    TcpSocket theSocket;
+    CHECK(theSocket.BindLocal(inDir + "/" + string(256, 'x')) ==
+        -ENAMETOOLONG);
+    CHECK(! theSocket.IsGood());
+}
+
+static void
+SendRecvTest(
+    const string& inDir)
+{
+    const string theSockPath = inDir + "/sendrecv.sock";
+    TcpSocket    theListener;
+    CHECK(theListener.BindLocal(theSockPath) == 0);
+    CHECK(theListener.IsLocal());
+    CHECK(theListener.StartListening(false) == 0);
+    TcpSocket theClient;
+    CHECK(theClient.ConnectLocal(theSockPath, false) == 0);
+    CHECK(theClient.IsLocal());
+    TcpSocket* const theServerPtr = theListener.Accept();
+    CHECK(theServerPtr);
+    if (theServerPtr && theClient.IsGood()) {
+        CHECK(theServerPtr->IsLocal());
+        const char kRequest[]  = "request";
+        const char kResponse[] = "response";
+        char       theBuf[64];
+        CHECK(theClient.Send(kRequest, sizeof(kRequest)) ==
+            (int)sizeof(kRequest));
+        CHECK(theServerPtr->Recv(theBuf, sizeof(theBuf)) ==
+            (int)sizeof(kRequest) && memcmp(theBuf, kRequest,
+                sizeof(kRequest)) == 0);
+        CHECK(theServerPtr->Send(kResponse, sizeof(kResponse)) ==
+            (int)sizeof(kResponse));
+        CHECK(theClient.Recv(theBuf, sizeof(theBuf)) ==
+            (int)sizeof(kResponse) && memcmp(theBuf, kResponse,
+                sizeof(kResponse)) == 0);
+    }
+    delete theServerPtr;
+    theClient.Close();
+    theListener.Close();
+    unlink(theSockPath.c_str());
+}
+
+// Connects to the TCP listener location, and checks which of the listeners
+// has accepted the connection.
+static void
+ConnectTest(
+    NetManager&           inNetManager,
+    const ServerLocation& inLocation,
+    TcpSocket&            inTcpListener,
+    TcpSocket*            inLocalListenerPtr,
+    bool                  inExpectLocalFlag)
+{
+    ConnectCallback  theCallback;
+    NetConnectionPtr theConnPtr;
+    NetConnection::Connect(inNetManager, inLocation, &theCallback, 0,
+        false, 0, 60, theConnPtr);
+    CHECK(theConnPtr && theConnPtr->IsConnected());
+    if (theConnPtr && theConnPtr->IsConnected()) {
+        CHECK(theConnPtr->IsLocal() == inExpectLocalFlag);
+        TcpSocket* const theSockPtr = Accept(inExpectLocalFlag ?
+            *inLocalListenerPtr : inTcpListener);
+        CHECK(theSockPtr);
+        if (theSockPtr) {
+            CHECK(theSockPtr->IsLocal() == inExpectLocalFlag);
+            delete theSockPtr;
+        }
+        if (inLocalListenerPtr && ! inExpectLocalFlag) {
+            CHECK(! inLocalListenerPtr->Accept());
+        }
+    }
+    if (theConnPtr) {
+        theConnPtr->Close();
+    }
+}
+
+static void
+FallbackTest(
+    const string& inDir)
+{
+    TcpSocket      theTcpListener;
+    ServerLocation theLocation;
+    CHECK(theTcpListener.Bind(ServerLocation("127.0.0.1", 0),
+        TcpSocket::kTypeIpV4, false) == 0 &&
+        theTcpListener.StartListening(true) == 0 &&
+        theTcpListener.GetSockLocation(theLocation) == 0);
+    if (0 < sErrorCount) {
+        return;
+    }
+    const string theSockPath =
+        TcpSocket::GetLocalSocketPath(inDir, theLocation.port);
+    NetManager theNetManager;
+    theNetManager.SetLocalSocketDir(inDir);
+
+    // No socket, TCP.
+    ConnectTest(theNetManager, theLocation, theTcpListener, 0, false);
+
+    // Stale socket, the socket file exists, but nobody listens.
+    TcpSocket theStaleSocket;
+    CHECK(theStaleSocket.BindLocal(theSockPath) == 0);
+    theStaleSocket.Close();
+    CHECK(access(theSockPath.c_str(), F_OK) == 0);
+    ConnectTest(theNetManager, theLocation, theTcpListener, 0, false);
+
+    // Server listens on the socket, and the stale socket file is replaced.
+    TcpSocket theLocalListener;
+    CHECK(theLocalListener.BindLocal(theSockPath) == 0 &&
+        theLocalListener.StartListening(true) == 0);
+    ConnectTest(theNetManager, theLocation, theTcpListener,
+        &theLocalListener, true);
+
+    // Local connections turned off by the client.
+    theNetManager.SetLocalSocketDir(string());
+    ConnectTest(theNetManager, theLocation, theTcpListener,
+        &theLocalListener, false);
+
+    theLocalListener.Close();
+    theTcpListener.Close();
+    unlink(theSockPath.c_str());
+}
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    MsgLogger::Init(0, (1 < inArgCount && atoi(inArgsPtr[1]) != 0) ?
+        MsgLogger::kLogLevelDEBUG : MsgLogger::kLogLevelERROR);
+    libkfsio::InitGlobals();
+    char theDirName[] = "/tmp/localsockettest.XXXXXX";
+    if (! mkdtemp(theDirName)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    const string theDir(theDirName);
+    AddressTest(theDir);
+    SendRecvTest(theDir);
+    FallbackTest(theDir);
+    rmdir(theDirName);
+    libkfsio::DestroyGlobals();
+    MsgLogger::Stop();
+    if (sErrorCount == 0) {
+        cout << "Passed local socket test\n";
+        return 0;
+    }
+    cerr << "Local socket test failed, errors: " << sErrorCount << "\n";
+    return 1;
+}
@@ -0,0 +1,384 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Buffered log writer per thread ring buffers test.
+// The first phase threads append interleaved records with the writer's
+// periodic drain effectively disabled, and exit before the records are
+// written, in order to verify that the records of all threads are merged in
+// time stamp order, and that the exited threads buffers are freed once
+// drained.
+// The second phase threads append records with small ring buffers, in order
+// to exercise drops, ring buffers wrap around, and concurrent drain. Every
+// few records are appended with the message stream, and records larger than
+// the ring buffer maximum message size with the shared buffer. Verifies that
+// each thread records are written in order, and that every record is either
+// written, or counted as dropped.
+// The third phase threads append records while the main thread holds the
+// writer's mutex, in order to verify that the thread buffers appends do not
+// block, and that the records that do not fit are counted as dropped.
+//
+//----------------------------------------------------------------------------
+
+#include "common/BufferedLogWriter.h"
+#include "common/Properties.h"
+#include "qcdio/QCThread.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
+#include "TestCheck.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace KFS;
+using std::cout;
+using std::cerr;
+using std::string;
+using std::vector;
+using std::ifstream;
+using std::istringstream;
+using std::ostringstream;
+
+enum
+{
+    kThreadCount        = 4,
+    kMergeRecordCount   = 200,
+    kThreadBufferSize   = 16 << 10,
+    kLargeRecordSize    = kThreadBufferSize / 4 + 100,
+    kLargeRecordEvery   = 100,
+    kStreamRecordEvery  = 7
+};
+
+// Holds the threads after the first record append, and the main thread until
+// all threads are done appending.
+class Gate
+{
+public:
+    Gate(
+        int inCount)
+        : mMutex(),
+          mCond(),
+          mArrivedCount(0),
+          mDoneCount(0),
+          mCount(inCount),
+          mOpenFlag(false)
+        {}
+    void Arrive()
+    {
+        QCStMutexLocker theLock(mMutex);
+        mArrivedCount++;
+        mCond.NotifyAll();
+        while (! mOpenFlag) {
+            mCond.Wait(mMutex);
+        }
+    }
+    void Done()
+    {
+        QCStMutexLocker theLock(mMutex);
+        mDoneCount++;
+        mCond.NotifyAll();
+    }
+    void WaitArrived()
+    {
+        QCStMutexLocker theLock(mMutex);
+        while (mArrivedCount < mCount) {
+            mCond.Wait(mMutex);
+        }
+    }
+    void Open()
+    {
+        QCStMutexLocker theLock(mMutex);
+        mOpenFlag = true;
+        mCond.NotifyAll();
+    }
+    void WaitDone()
+    {
+        QCStMutexLocker theLock(mMutex);
+        while (mDoneCount < mCount) {
+            mCond.Wait(mMutex);
+        }
+    }
+private:
+    QCMutex   mMutex;
+    QCCondVar mCond;
+    int       mArrivedCount;
+    int       mDoneCount;
+    const int mCount;
+    bool      mOpenFlag;
+private:
+    Gate(
+        const Gate& inGate);
+    Gate& operator=(
+        const Gate& inGate);
+};
+
+class LogTestWorker : public QCRunnable
+{
+public:
+    LogTestWorker(
+        BufferedLogWriter& inWriter,
+        int                inPhase,
+        int                inId,
+        int                inRecordCount,
+        Gate*              inGatePtr)
+        : QCRunnable(),
+          mWriter(inWriter),
+          mPhase(inPhase),
+          mId(inId),
+          mRecordCount(inRecordCount),
+          mGatePtr(inGatePtr),
+          mThread(this, "logwritertest")
+        {}
+    virtual ~LogTestWorker()
+        {}
+    void Start()
+        { mThread.Start(); }
+    void Join()
+        { mThread.Join(); }
+    virtual void Run()
+    {
+        const string thePad(kLargeRecordSize, 'x');
+        for (int i = 0; i < mRecordCount; i++) {
+            if (mPhase != 1) {
+                if (mPhase == 0) {
+                    // Interleave the threads records time stamps.
+                    usleep(50);
+                }
+                mWriter.Append(BufferedLogWriter::kLogLevelINFO,
+                    "lwt %d %d %d", mPhase, mId, i);
+                // The first append creates the thread buffer.
+                if (i == 0 && mGatePtr) {
+                    mGatePtr->Arrive();
+                }
+            } else if (i % kLargeRecordEvery == kLargeRecordEvery - 1) {
+                mWriter.Append(BufferedLogWriter::kLogLevelINFO,
+                    "lwt %d %d %d %s", mPhase, mId, i, thePad.c_str());
+            } else if (i % kStreamRecordEvery == 0) {
+                BufferedLogWriter::StStream theStream(
+                    mWriter, BufferedLogWriter::kLogLevelINFO);
+                theStream.GetStream() << "lwt " << mPhase << " " << mId <<
+                    " " << i;
+            } else {
+                mWriter.Append(BufferedLogWriter::kLogLevelINFO,
+                    "lwt %d %d %d", mPhase, mId, i);
+            }
+        }
+        if (mGatePtr) {
+            mGatePtr->Done();
+        }
+    }
+private:
+    BufferedLogWriter& mWriter;
+    const int          mPhase;
+    const int          mId;
+    const int          mRecordCount;
+    Gate* const        mGatePtr;
+    QCThread           mThread;
+private:
+    LogTestWorker(
+        const LogTestWorker& inWorker);
+    LogTestWorker& operator=(
+        const LogTestWorker& inWorker);
+};
+
+static void
+RunThreads(
+    BufferedLogWriter& inWriter,
+    int                inPhase,
+    int                inRecordCount,
+    Gate*              inGatePtr = 0)
+{
+    vector<LogTestWorker*> theWorkers;
+    for (int i = 0; i < kThreadCount; i++) {
+        theWorkers.push_back(new LogTestWorker(
+            inWriter, inPhase, i, inRecordCount, inGatePtr));
+    }
+    for (int i = 0; i < kThreadCount; i++) {
+        theWorkers[i]->Start();
+    }
+    if (inGatePtr) {
+        // Exited threads buffers detach acquires the writer's mutex, thus
+        // the mutex is released before joining.
+        inGatePtr->WaitArrived();
+        inWriter.PrepareToFork();
+        inGatePtr->Open();
+        inGatePtr->WaitDone();
+        inWriter.ForkDone();
+    }
+    for (int i = 0; i < kThreadCount; i++) {
+        theWorkers[i]->Join();
+        delete theWorkers[i];
+    }
+}
+
+static void
+SetThreadBufferSize(
+    BufferedLogWriter& inWriter,
+    int                inSize)
+{
+    ostringstream theStream;
+    theStream << inSize;
+    Properties theProps;
+    theProps.setValue(string("logWriterTest.threadBufferSize"),
+        theStream.str());
+    inWriter.SetParameters(theProps, "logWriterTest.");
+}
+
+// Returns the number of records found, and validates the records order.
+static int64_t
+Verify(
+    const char* inFileNamePtr,
+    int         inPhase,
+    int         inRecordCount)
+{
+    ifstream theFile(inFileNamePtr);
+    CHECK(theFile.is_open());
+    // Time stamp prefix: mm-dd-yyyy hh:mm:ss.mmm
+    const size_t kTimeStampLen = 23;
+    vector<int>  theLastSeq(kThreadCount, -1);
+    string       theLastTime;
+    string       theLine;
+    int64_t      theCount = 0;
+    while (getline(theFile, theLine)) {
+        const size_t thePos = theLine.find(" lwt ");
+        if (thePos == string::npos) {
+            continue;
+        }
+        istringstream theStream(theLine.substr(thePos + 5));
+        int thePhase = -1;
+        int theId    = -1;
+        int theSeq   = -1;
+        string thePad;
+        theStream >> thePhase >> theId >> theSeq >> thePad;
+        if (thePhase != inPhase) {
+            continue;
+        }
+        if (theId < 0 || kThreadCount <= theId ||
+                theSeq <= theLastSeq[theId] || inRecordCount <= theSeq) {
+            cerr << "invalid record order: " << theLine.substr(0, 80) <<
+                "\n";
+            sErrorCount++;
+            break;
+        }
+        theLastSeq[theId] = theSeq;
+        CHECK(thePad.size() == (theSeq % kLargeRecordEvery ==
+            kLargeRecordEvery - 1 && inPhase == 1 ?
+                (size_t)kLargeRecordSize : 0));
+        if (inPhase == 0) {
+            const string theTime = theLine.substr(0, kTimeStampLen);
+            CHECK(theLastTime <= theTime);
+            theLastTime = theTime;
+        }
+        theCount++;
+    }
+    return theCount;
+}
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    const int theRecordCount = 1 < inArgCount ? atoi(inArgsPtr[1]) : 50000;
+    char      theFileName[]  = "/tmp/logwritertest.XXXXXX";
+    const int theFd          = mkstemp(theFileName);
+    if (theFd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(theFd);
+    {
+        const int64_t     kFlushIntervalMicroSec = int64_t(3600) * 1000000;
+        const int64_t     kMaxLogWaitMicroSec    = int64_t(60) * 1000000;
+        BufferedLogWriter theWriter(
+            -1,
+            theFileName,
+            1 << 20,
+            0,
+            5000000,
+            kFlushIntervalMicroSec,
+            -1,
+            -1,
+            BufferedLogWriter::kLogLevelDEBUG,
+            kMaxLogWaitMicroSec
+        );
+        SetThreadBufferSize(theWriter, kThreadBufferSize * 4);
+        // The records fit into the ring buffers, and the writer does not
+        // drain before sync.
+        RunThreads(theWriter, 0, kMergeRecordCount);
+        theWriter.Sync();
+        BufferedLogWriter::Counters theCounters;
+        theWriter.GetCounters(theCounters);
+        CHECK(theCounters.mDroppedCount == 0 &&
+            theCounters.mThreadBufferCount == 0);
+        CHECK(Verify(theFileName, 0, kMergeRecordCount) ==
+            kThreadCount * kMergeRecordCount);
+
+        SetThreadBufferSize(theWriter, kThreadBufferSize);
+        theWriter.SetFlushInterval(100 * 1000);
+        RunThreads(theWriter, 1, theRecordCount);
+        theWriter.Sync();
+        theWriter.GetCounters(theCounters);
+        const int64_t theFound = Verify(theFileName, 1, theRecordCount);
+        cout <<
+            "records: "        << (int64_t)kThreadCount * theRecordCount <<
+            " written: "       << theFound <<
+            " dropped: "       << theCounters.mDroppedCount <<
+            " thread buffer: " << theCounters.mThreadBufferDroppedCount <<
+            "\n";
+        CHECK(theCounters.mThreadBufferCount == 0);
+        CHECK(theFound + theCounters.mDroppedCount ==
+            (int64_t)kThreadCount * theRecordCount);
+
+        const int64_t theDroppedCount = theCounters.mDroppedCount;
+        Gate          theGate(kThreadCount);
+        RunThreads(theWriter, 2, theRecordCount, &theGate);
+        theWriter.Stop();
+        theWriter.GetCounters(theCounters);
+        const int64_t theHeldFound = Verify(theFileName, 2, theRecordCount);
+        cout <<
+            "records: "        << (int64_t)kThreadCount * theRecordCount <<
+            " written: "       << theHeldFound <<
+            " dropped: "       <<
+                theCounters.mDroppedCount - theDroppedCount <<
+            " with mutex held\n";
+        CHECK(theCounters.mThreadBufferCount == 0);
+        CHECK(theDroppedCount < theCounters.mDroppedCount &&
+            theDroppedCount < theCounters.mThreadBufferDroppedCount);
+        CHECK(theHeldFound + theCounters.mDroppedCount - theDroppedCount ==
+            (int64_t)kThreadCount * theRecordCount);
+    }
+    unlink(theFileName);
+    if (sErrorCount == 0) {
+        cout << "Passed log writer thread buffers test\n";
+        return 0;
+    }
+    cerr << "Log writer thread buffers test failed, errors: " << sErrorCount <<
+        "\n";
+    return 1;
+}
@@ -0,0 +1,283 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Locally repairable code erasure method test. Encodes random data,
+// and verifies that:
+// - every erasure pattern of 1 to global parity count + 1 stripes is decoded,
+// - decode succeeds if and only if CanDecode() returns true, for all larger
+//   erasure patterns,
+// - local repair stripes xor is the repaired stripe.
+//
+//----------------------------------------------------------------------------
+
+#include "libclient/ECMethod.h"
+#include "common/kfstypes.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace KFS;
+using client::ECMethod;
+using std::cout;
+using std::cerr;
+using std::string;
+using std::vector;
+
+static int sErrorCount = 0;
+
+class LrcTest
+{
+public:
+    LrcTest(
+        int inStripeCount,
+        int inRecoveryStripeCount,
+        int inLength)
+        : mStripeCount(inStripeCount),
+          mRecoveryStripeCount(inRecoveryStripeCount),
+          mCount(inStripeCount + inRecoveryStripeCount),
+          mLength(inLength),
+          mEncoderPtr(0),
+          mDecoderPtr(0),
+          mExpected(),
+          mBuffers(),
+          mBufferPtrs(),
+          mMissing(),
+          mPatternCount(0),
+          mDecodedCount(0)
+        {}
+    ~LrcTest()
+    {
+        if (mEncoderPtr) {
+            mEncoderPtr->Release();
+        }
+        if (mDecoderPtr) {
+            mDecoderPtr->Release();
+        }
+    }
+    bool Run()
+    {
+        string theErrMsg;
+        mEncoderPtr = ECMethod::FindEncoder(KFS_STRIPED_FILE_TYPE_LRC,
+            mStripeCount, mRecoveryStripeCount, &theErrMsg);
+        mDecoderPtr = ECMethod::FindDecoder(KFS_STRIPED_FILE_TYPE_LRC,
+            mStripeCount, mRecoveryStripeCount, &theErrMsg);
+        if (! mEncoderPtr || ! mDecoderPtr) {
+            return Error("no encoder or decoder: " + theErrMsg);
+        }
+        if (mDecoderPtr->IsMaximumDistanceSeparable()) {
+            return Error("LRC must not be maximum distance separable");
+        }
+        mExpected.resize(mCount);
+        mBuffers.resize(mCount);
+        mBufferPtrs.resize(mCount);
+        for (int i = 0; i < mCount; i++) {
+            mExpected[i].resize(mLength);
+            mBuffers[i].resize(mLength);
+            if (i < mStripeCount) {
+                for (int k = 0; k < mLength; k++) {
+                    mExpected[i][k] = (char)rand();
+                }
+            }
+            mBufferPtrs[i] = &mExpected[i][0];
+        }
+        if (mEncoderPtr->Encode(mStripeCount, mRecoveryStripeCount, mLength,
+                &mBufferPtrs[0]) != 0) {
+            return Error("encode failure");
+        }
+        if (! TestLocalRepair()) {
+            return false;
+        }
+        const int theMaxFailures = mEncoderPtr->GetMaxFailureCount(
+            mStripeCount, mRecoveryStripeCount);
+        if (theMaxFailures != mRecoveryStripeCount -
+                GetLrcLocalGroupCount(mRecoveryStripeCount) + 1) {
+            return Error("invalid max failure count");
+        }
+        for (int theSize = 1; theSize <= mRecoveryStripeCount; theSize++) {
+            mMissing.resize(theSize + 1);
+            if (! TestPatterns(0, 0, theSize, theSize <= theMaxFailures)) {
+                return false;
+            }
+        }
+        cout << "data stripes: " << mStripeCount <<
+            " recovery stripes: "  << mRecoveryStripeCount <<
+            " length: "            << mLength <<
+            " patterns: "          << mPatternCount <<
+            " decoded: "           << mDecodedCount <<
+            " passed\n";
+        return true;
+    }
+private:
+    const int              mStripeCount;
+    const int              mRecoveryStripeCount;
+    const int              mCount;
+    const int              mLength;
+    ECMethod::Encoder*     mEncoderPtr;
+    ECMethod::Decoder*     mDecoderPtr;
+    vector<vector<char> >  mExpected;
+    vector<vector<char> >  mBuffers;
+    vector<void*>          mBufferPtrs;
+    vector<int>            mMissing;
+    int64_t                mPatternCount;
+    int64_t                mDecodedCount;
+
+    bool Error(
+        const string& inMsg)
+    {
+        cerr << "data stripes: " << mStripeCount <<
+            " recovery stripes: "  << mRecoveryStripeCount <<
+            " length: "            << mLength <<
+            " error: "             << inMsg;
+        if (! mMissing.empty()) {
+            cerr << " missing:";
+            for (size_t i = 0; i < mMissing.size() && 0 <= mMissing[i]; i++) {
+                cerr << " " << mMissing[i];
+            }
+        }
+        cerr << "\n";
+        sErrorCount++;
+        return false;
+    }
+    bool TestLocalRepair()
+    {
+        vector<int>  theStripes(mCount);
+        vector<char> theXor(mLength);
+        for (int i = 0; i < mCount; i++) {
+            const int theCnt = mDecoderPtr->GetLocalRepairStripes(
+                mStripeCount, mRecoveryStripeCount, i, &theStripes[0]);
+            const int theGroup = GetLrcStripeGroup(
+                i, mStripeCount, mRecoveryStripeCount);
+            if (theGroup < 0) {
+                if (theCnt != 0) {
+                    return Error("global parity has local repair stripes");
+                }
+                continue;
+            }
+            if (theCnt <= 0) {
+                return Error("no local repair stripes");
+            }
+            memset(&theXor[0], 0, mLength);
+            for (int k = 0; k < theCnt; k++) {
+                const int theIdx = theStripes[k];
+                if (theIdx == i || GetLrcStripeGroup(theIdx,
+                        mStripeCount, mRecoveryStripeCount) != theGroup) {
+                    return Error("invalid local repair stripe");
+                }
+                for (int b = 0; b < mLength; b++) {
+                    theXor[b] ^= mExpected[theIdx][b];
+                }
+            }
+            if (memcmp(&theXor[0], &mExpected[i][0], mLength) != 0) {
+                return Error("local repair mismatch");
+            }
+        }
+        return true;
+    }
+    bool TestPatterns(
+        int  inStart,
+        int  inPos,
+        int  inSize,
+        bool inMustDecodeFlag)
+    {
+        if (inPos == inSize) {
+            mMissing[inPos] = -1;
+            return TestPattern(inMustDecodeFlag);
+        }
+        for (int i = inStart; i <= mCount - (inSize - inPos); i++) {
+            mMissing[inPos] = i;
+            if (! TestPatterns(i + 1, inPos + 1, inSize, inMustDecodeFlag)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool TestPattern(
+        bool inMustDecodeFlag)
+    {
+        mPatternCount++;
+        for (int i = 0; i < mCount; i++) {
+            memcpy(&mBuffers[i][0], &mExpected[i][0], mLength);
+            mBufferPtrs[i] = &mBuffers[i][0];
+        }
+        for (int i = 0; 0 <= mMissing[i]; i++) {
+            memset(&mBuffers[mMissing[i]][0], 0xFF, mLength);
+        }
+        const bool theCanDecodeFlag = mDecoderPtr->CanDecode(
+            mStripeCount, mRecoveryStripeCount, &mMissing[0]);
+        if (inMustDecodeFlag && ! theCanDecodeFlag) {
+            return Error("CanDecode() returned false");
+        }
+        const int theRet = mDecoderPtr->Decode(mStripeCount,
+            mRecoveryStripeCount, mLength, &mBufferPtrs[0], &mMissing[0]);
+        if ((theRet == 0) != theCanDecodeFlag) {
+            return Error("Decode() and CanDecode() mismatch");
+        }
+        if (theRet != 0) {
+            return true;
+        }
+        mDecodedCount++;
+        for (int i = 0; i < mCount; i++) {
+            if (memcmp(&mBuffers[i][0], &mExpected[i][0], mLength) != 0) {
+                return Error("decoded stripe mismatch");
+            }
+        }
+        return true;
+    }
+private:
+    LrcTest(
+        const LrcTest& inTest);
+    LrcTest& operator=(
+        const LrcTest& inTest);
+};
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    const unsigned int theSeed = 1 < inArgCount ?
+        (unsigned int)atoi(inArgsPtr[1]) : 1;
+    srand(theSeed);
+    const int theConfigs[][3] = {
+        // data stripes, recovery stripes, stripe length
+        {  2, 2,  4096 },
+        {  6, 3, 65536 },
+        {  5, 3,  4099 },
+        { 10, 4, 12288 },
+        { 12, 6,  4096 },
+        {  7, 5,   333 },
+    };
+    for (size_t i = 0; i < sizeof(theConfigs) / sizeof(theConfigs[0]); i++) {
+        LrcTest theTest(theConfigs[i][0], theConfigs[i][1], theConfigs[i][2]);
+        theTest.Run();
+    }
+    if (sErrorCount == 0) {
+        cout << "Passed LRC test\n";
+        return 0;
+    }
+    cerr << "LRC test failed, errors: " << sErrorCount <<
+        " seed: " << theSeed << "\n";
+    return 1;
+}
@@ -0,0 +1,318 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Io buffer pool thread cache stress test. Long running and one off
+// threads concurrently get and put single buffers and buffer batches from the
+// pool small enough to be periodically exhausted, in order to exercise the
+// thread cache reclaim, while the main thread reads the pool counts and
+// counters. Verifies that:
+// - no buffer is handed out to more than one owner at a time,
+// - the exited threads caches are returned to the pool, the free, and used
+//   counts, and the get and put counters are consistent once all threads
+//   exit.
+//
+//----------------------------------------------------------------------------
+
+#include "qcdio/QCIoBufferPool.h"
+#include "qcdio/QCThread.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <vector>
+
+using std::cout;
+using std::cerr;
+using std::vector;
+
+static int     sErrorCount = 0;
+static QCMutex sMutex;
+
+static void
+Error(
+    const char* inMsgPtr)
+{
+    QCStMutexLocker theLock(sMutex);
+    cerr << "error: " << inMsgPtr << "\n";
+    sErrorCount++;
+}
+
+enum
+{
+    kBufferSize     = 4 << 10,
+    kBatchSize      = 16,
+    kMaxHeldBuffers = 64
+};
+
+class BufferIterator :
+    public QCIoBufferPool::OutputIterator,
+    public QCIoBufferPool::InputIterator
+{
+public:
+    BufferIterator(
+        vector<char*>& inBufs,
+        size_t         inPos)
+        : mBufs(inBufs),
+          mPos(inPos)
+        {}
+    virtual ~BufferIterator()
+        {}
+    virtual void Put(
+        char* inBufPtr)
+        { mBufs.push_back(inBufPtr); }
+    virtual char* Get()
+        { return (mPos < mBufs.size() ? mBufs[mPos++] : 0); }
+private:
+    vector<char*>& mBufs;
+    size_t         mPos;
+private:
+    BufferIterator(
+        const BufferIterator& inIt);
+    BufferIterator& operator=(
+        const BufferIterator& inIt);
+};
+
+class PoolTestWorker : public QCRunnable
+{
+public:
+    PoolTestWorker(
+        QCIoBufferPool& inPool,
+        int             inId,
+        int             inIterations)
+        : QCRunnable(),
+          mPool(inPool),
+          mId(inId),
+          mIterations(inIterations),
+          mRand(0x9E3779B97F4A7C15ull * (uint64_t)(inId + 1)),
+          mGetCount(0),
+          mPutCount(0),
+          mFailedGetCount(0),
+          mThread(this, "pooltest")
+        {}
+    virtual ~PoolTestWorker()
+        {}
+    void Start()
+        { mThread.Start(); }
+    void Join()
+        { mThread.Join(); }
+    int64_t GetGetCount() const
+        { return mGetCount; }
+    int64_t GetPutCount() const
+        { return mPutCount; }
+    int64_t GetFailedGetCount() const
+        { return mFailedGetCount; }
+    virtual void Run()
+    {
+        vector<char*> theBufs;
+        for (int i = 0; i < mIterations && sErrorCount <= 0; i++) {
+            const int theOp = (int)(Random() % 4);
+            if (theOp == 0 && theBufs.size() < kMaxHeldBuffers) {
+                char* const theBufPtr = mPool.Get();
+                if (theBufPtr) {
+                    Mark(theBufPtr, theBufs.size());
+                    theBufs.push_back(theBufPtr);
+                    mGetCount++;
+                } else {
+                    mFailedGetCount++;
+                }
+            } else if (theOp == 1 && theBufs.size() < kMaxHeldBuffers) {
+                const int      theCnt = 1 + (int)(Random() % (2 * kBatchSize));
+                const size_t   thePos = theBufs.size();
+                BufferIterator theIt(theBufs, thePos);
+                if (mPool.Get(theIt, theCnt)) {
+                    if (theBufs.size() != thePos + theCnt) {
+                        Error("invalid batch get buffer count");
+                        return;
+                    }
+                    for (size_t k = thePos; k < theBufs.size(); k++) {
+                        Mark(theBufs[k], k);
+                    }
+                    mGetCount += theCnt;
+                } else {
+                    if (theBufs.size() != thePos) {
+                        Error("failed batch get returned buffers");
+                        return;
+                    }
+                    mFailedGetCount++;
+                }
+            } else if (theOp == 2 && ! theBufs.empty()) {
+                Verify(theBufs.back(), theBufs.size() - 1);
+                mPool.Put(theBufs.back());
+                theBufs.pop_back();
+                mPutCount++;
+            } else if (! theBufs.empty()) {
+                const size_t theCnt = 1 + Random() % theBufs.size();
+                const size_t thePos = theBufs.size() - theCnt;
+                for (size_t k = thePos; k < theBufs.size(); k++) {
+                    Verify(theBufs[k], k);
+                }
+                BufferIterator theIt(theBufs, thePos);
+                mPool.Put(theIt, (int)theCnt);
+                theBufs.resize(thePos);
+                mPutCount += theCnt;
+            }
+        }
+        for (size_t k = 0; k < theBufs.size(); k++) {
+            Verify(theBufs[k], k);
+            mPool.Put(theBufs[k]);
+            mPutCount++;
+        }
+    }
+private:
+    QCIoBufferPool& mPool;
+    const int       mId;
+    const int       mIterations;
+    uint64_t        mRand;
+    int64_t         mGetCount;
+    int64_t         mPutCount;
+    int64_t         mFailedGetCount;
+    QCThread        mThread;
+
+    uint64_t Random()
+    {
+        mRand = mRand * 6364136223846793005ull + 1442695040888963407ull;
+        return (mRand ^ (mRand >> 29));
+    }
+    // Write the owner id at the beginning and the end of the buffer, if the
+    // buffer is handed out to another thread while held by this one the
+    // marks will be overwritten.
+    void Mark(
+        char*  inBufPtr,
+        size_t inIdx)
+    {
+        const uint64_t theMark = ((uint64_t)mId << 32) | (uint64_t)inIdx;
+        memcpy(inBufPtr, &theMark, sizeof(theMark));
+        memcpy(inBufPtr + kBufferSize - sizeof(theMark), &theMark,
+            sizeof(theMark));
+    }
+    void Verify(
+        char*  inBufPtr,
+        size_t inIdx)
+    {
+        const uint64_t theMark = ((uint64_t)mId << 32) | (uint64_t)inIdx;
+        if (memcmp(inBufPtr, &theMark, sizeof(theMark)) != 0 ||
+                memcmp(inBufPtr + kBufferSize - sizeof(theMark), &theMark,
+                    sizeof(theMark)) != 0) {
+            Error("buffer is owned by more than one thread");
+        }
+    }
+private:
+    PoolTestWorker(
+        const PoolTestWorker& inWorker);
+    PoolTestWorker& operator=(
+        const PoolTestWorker& inWorker);
+};
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    const int theThreadCount = 1 < inArgCount ? atoi(inArgsPtr[1]) : 8;
+    const int theIterations  = 2 < inArgCount ? atoi(inArgsPtr[2]) : 200000;
+    const int theOneOffCount = 3 < inArgCount ? atoi(inArgsPtr[3]) : 200;
+    // Less buffers than the threads can hold, to exhaust the pool, and to
+    // make the threads reclaim each others caches.
+    const int      theBufCount = theThreadCount * kMaxHeldBuffers / 2 +
+        kBatchSize;
+    QCIoBufferPool thePool;
+    const int      theErr = thePool.Create(
+        2, theBufCount / 2, kBufferSize, false, kBatchSize);
+    if (theErr) {
+        cerr << "pool create failure: " << theErr << "\n";
+        return 1;
+    }
+    const int theTotal = thePool.GetTotalBufferCount();
+    vector<PoolTestWorker*> theWorkers;
+    for (int i = 0; i < theThreadCount; i++) {
+        theWorkers.push_back(new PoolTestWorker(thePool, i, theIterations));
+    }
+    for (int i = 0; i < theThreadCount; i++) {
+        theWorkers[i]->Start();
+    }
+    int64_t theGetCount    = 0;
+    int64_t thePutCount    = 0;
+    int64_t theFailedCount = 0;
+    // One off threads exit with buffers in their caches, while the long
+    // running threads are active.
+    for (int i = 0; i < theOneOffCount && sErrorCount <= 0; i++) {
+        PoolTestWorker theWorker(thePool, theThreadCount + i, 200);
+        theWorker.Start();
+        const int theFree = thePool.GetFreeBufferCount();
+        const int theUsed = thePool.GetUsedBufferCount();
+        if (theFree < 0 || theUsed < 0 || theTotal < theFree ||
+                theTotal < theUsed) {
+            Error("invalid free or used buffer count");
+        }
+        QCIoBufferPool::Counters theCounters;
+        thePool.GetCounters(theCounters);
+        if (theCounters.mCachedCount < 0 || theTotal <
+                theCounters.mCachedCount) {
+            Error("invalid cached buffer count");
+        }
+        theWorker.Join();
+        theGetCount    += theWorker.GetGetCount();
+        thePutCount    += theWorker.GetPutCount();
+        theFailedCount += theWorker.GetFailedGetCount();
+    }
+    for (int i = 0; i < theThreadCount; i++) {
+        theWorkers[i]->Join();
+        theGetCount    += theWorkers[i]->GetGetCount();
+        thePutCount    += theWorkers[i]->GetPutCount();
+        theFailedCount += theWorkers[i]->GetFailedGetCount();
+        delete theWorkers[i];
+    }
+    QCIoBufferPool::Counters theCounters;
+    thePool.GetCounters(theCounters);
+    cout <<
+        "buffers: "   << theTotal <<
+        " gets: "     << theGetCount <<
+        " failed: "   << theFailedCount <<
+        " hits: "     << theCounters.mGetHitCount <<
+        " locks: "    << theCounters.mLockCount <<
+        " reclaims: " << theCounters.mReclaimCount <<
+        "\n";
+    // The main thread did not get or put buffers, and all other threads
+    // have exited, thus all caches must have been returned to the pool.
+    if (theCounters.mCachedCount != 0 ||
+            thePool.GetFreeBufferCount() != theTotal ||
+            thePool.GetUsedBufferCount() != 0) {
+        Error("exited threads caches are not returned to the pool");
+    }
+    if (theGetCount != thePutCount ||
+            theCounters.mPutCount != thePutCount ||
+            theCounters.mGetHitCount > theCounters.mGetCount ||
+            theCounters.mPutHitCount > theCounters.mPutCount) {
+        Error("get and put counters mismatch");
+    }
+    if (theFailedCount <= 0 || theCounters.mReclaimCount <= 0) {
+        Error("pool was not exhausted");
+    }
+    if (sErrorCount == 0) {
+        cout << "Passed io buffer pool test\n";
+        return 0;
+    }
+    cerr << "Io buffer pool test failed, errors: " << sErrorCount << "\n";
+    return 1;
+}
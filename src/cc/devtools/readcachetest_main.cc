@@ -0,0 +1,262 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Chunk server read cache unit test. Verifies block content, chunk
+// version keying, TinyLFU admission: a sequential scan must not evict the
+// frequently read blocks, and a block read more often than the LRU victim
+// must be admitted, invalidation, shrink, and the counters.
+//
+//----------------------------------------------------------------------------
+
+#include "chunk/ReadCache.h"
+#include "kfsio/IOBuffer.h"
+#include "TestCheck.h"
+
+#include <string.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace KFS;
+using std::cout;
+using std::cerr;
+using std::vector;
+
+enum { kBlockSize = 4 << 10 };
+
+static char
+BlockByte(
+    kfsChunkId_t inChunkId,
+    int64_t      inVersion,
+    int          inBlockIdx)
+{
+    return (char)(inChunkId * 31 + inVersion * 7 + inBlockIdx);
+}
+
+static bool
+Put(
+    ReadCache&   inCache,
+    kfsChunkId_t inChunkId,
+    int64_t      inVersion,
+    int          inBlockIdx)
+{
+    vector<char> theData(kBlockSize, BlockByte(inChunkId, inVersion,
+        inBlockIdx));
+    IOBuffer theBuf;
+    theBuf.CopyIn(&theData[0], kBlockSize);
+    const bool theRet = inCache.Put(inChunkId, inVersion, inBlockIdx, theBuf);
+    // The data is moved from the buffer only if admitted.
+    CHECK(theBuf.BytesConsumable() == (theRet ? 0 : (int)kBlockSize));
+    return theRet;
+}
+
+// Returns true if all blocks are present, and verifies the content.
+static bool
+Get(
+    ReadCache&   inCache,
+    kfsChunkId_t inChunkId,
+    int64_t      inVersion,
+    int          inBlockIdx,
+    int          inBlockCount = 1)
+{
+    IOBuffer theBuf;
+    if (! inCache.Get(inChunkId, inVersion, inBlockIdx, inBlockCount,
+            theBuf)) {
+        CHECK(theBuf.IsEmpty());
+        return false;
+    }
+    CHECK(theBuf.BytesConsumable() == inBlockCount * kBlockSize);
+    vector<char> theData(kBlockSize);
+    for (int i = 0; i < inBlockCount; i++) {
+        CHECK(theBuf.CopyOut(&theData[0], kBlockSize) == kBlockSize);
+        theBuf.Consume(kBlockSize);
+        const char theByte = BlockByte(inChunkId, inVersion, inBlockIdx + i);
+        for (int k = 0; k < kBlockSize; k++) {
+            if (theData[k] != theByte) {
+                CHECK(theData[k] == theByte);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+static void
+CheckCounters(
+    const ReadCache& inCache)
+{
+    ReadCache::Counters theCounters;
+    inCache.GetCounters(theCounters);
+    CHECK(theCounters.mByteCount == theCounters.mBlockCount * kBlockSize);
+    CHECK(theCounters.mByteCount == inCache.GetSize());
+    CHECK(inCache.GetSize() <= inCache.GetMaxSize());
+    CHECK(theCounters.mBlockCount == theCounters.mInsertCount -
+        theCounters.mEvictCount - theCounters.mInvalidateCount);
+}
+
+static void
+TestDisabled()
+{
+    ReadCache theCache(kBlockSize);
+    CHECK(! theCache.IsEnabled());
+    CHECK(! Put(theCache, 1, 1, 0));
+    CHECK(! Get(theCache, 1, 1, 0));
+    theCache.SetMaxSize(kBlockSize - 1);
+    CHECK(! theCache.IsEnabled());
+    CHECK(! Put(theCache, 1, 1, 0));
+    CheckCounters(theCache);
+}
+
+static void
+TestBasic()
+{
+    ReadCache theCache(kBlockSize);
+    theCache.SetMaxSize(8 * kBlockSize);
+    CHECK(theCache.IsEnabled());
+    for (int i = 0; i < 4; i++) {
+        CHECK(theCache.IsAdmissible(1, 1, i));
+        CHECK(Put(theCache, 1, 1, i));
+        CHECK(! theCache.IsAdmissible(1, 1, i));
+        // Duplicate is not inserted.
+        CHECK(! Put(theCache, 1, 1, i));
+    }
+    CHECK(Get(theCache, 1, 1, 0, 4));
+    CHECK(Get(theCache, 1, 1, 2));
+    // All blocks in the range must be present.
+    CHECK(! Get(theCache, 1, 1, 2, 3));
+    // Other version of the same chunk is a different block.
+    CHECK(! Get(theCache, 1, 2, 0));
+    CHECK(Put(theCache, 1, 2, 0));
+    CHECK(Get(theCache, 1, 2, 0));
+    CHECK(Get(theCache, 1, 1, 0));
+    // Partial block is not cached.
+    IOBuffer theBuf;
+    theBuf.CopyIn("x", 1);
+    CHECK(! theCache.Put(2, 1, 0, theBuf));
+    CHECK(theBuf.BytesConsumable() == 1);
+    CHECK(Put(theCache, 2, 1, 0));
+    CheckCounters(theCache);
+
+    // Invalidate removes all versions of the chunk only.
+    ReadCache::Counters theCounters;
+    theCache.GetCounters(theCounters);
+    CHECK(theCounters.mBlockCount == 6);
+    theCache.Invalidate(1);
+    theCache.Invalidate(3);
+    CHECK(! Get(theCache, 1, 1, 0));
+    CHECK(! Get(theCache, 1, 2, 0));
+    CHECK(Get(theCache, 2, 1, 0));
+    theCache.GetCounters(theCounters);
+    CHECK(theCounters.mBlockCount == 1);
+    CHECK(theCounters.mInvalidateCount == 5);
+    CheckCounters(theCache);
+
+    // Re-insert after invalidation, then shrink.
+    for (int i = 0; i < 4; i++) {
+        CHECK(Put(theCache, 1, 1, i));
+    }
+    theCache.Shrink(2 * kBlockSize);
+    CHECK(theCache.GetSize() == 2 * kBlockSize);
+    // LRU blocks are evicted first.
+    CHECK(! Get(theCache, 2, 1, 0));
+    CHECK(Get(theCache, 1, 1, 2, 2));
+    theCache.SetMaxSize(0);
+    CHECK(theCache.GetSize() == 0);
+    CHECK(! Get(theCache, 1, 1, 3));
+    CheckCounters(theCache);
+}
+
+static void
+TestAdmission()
+{
+    const int  kCacheBlocks = 256;
+    ReadCache  theCache(kBlockSize);
+    theCache.SetMaxSize(kCacheBlocks * kBlockSize);
+    // Fill the cache with the "footer" blocks of many chunks, each read a
+    // few times.
+    for (int i = 0; i < kCacheBlocks; i++) {
+        CHECK(! Get(theCache, 100 + i, 1, 1023));
+        CHECK(Put(theCache, 100 + i, 1, 1023));
+    }
+    for (int k = 0; k < 4; k++) {
+        for (int i = 0; i < kCacheBlocks; i++) {
+            CHECK(Get(theCache, 100 + i, 1, 1023));
+        }
+    }
+    // Sequential scan of a large chunk must not flush the hot blocks.
+    int theAdmittedCount = 0;
+    const int kScanBlocks = 2 * kCacheBlocks;
+    for (int i = 0; i < kScanBlocks; i++) {
+        if (! Get(theCache, 1, 1, i)) {
+            if (theCache.IsAdmissible(1, 1, i)) {
+                theAdmittedCount++;
+            }
+            if (Put(theCache, 1, 1, i)) {
+                theAdmittedCount++;
+            }
+        }
+    }
+    CHECK(theAdmittedCount == 0);
+    for (int i = 0; i < kCacheBlocks; i++) {
+        CHECK(Get(theCache, 100 + i, 1, 1023));
+    }
+    ReadCache::Counters theCounters;
+    theCache.GetCounters(theCounters);
+    CHECK(theCounters.mAdmitRejectCount == kScanBlocks);
+    CHECK(theCounters.mEvictCount == 0);
+    CheckCounters(theCache);
+
+    // The block read more often than the LRU victim replaces the victim.
+    // The hot blocks were read 6 times, make the new block reads exceed that
+    // by enough to make sketch hash collisions irrelevant.
+    for (int k = 0; k < 12; k++) {
+        CHECK(! Get(theCache, 2, 1, 0));
+    }
+    CHECK(! theCache.IsAdmissible(2, 1, 1));
+    CHECK(theCache.IsAdmissible(2, 1, 0));
+    CHECK(Put(theCache, 2, 1, 0));
+    CHECK(Get(theCache, 2, 1, 0));
+    theCache.GetCounters(theCounters);
+    CHECK(theCounters.mEvictCount == 1);
+    CHECK(theCounters.mBlockCount == kCacheBlocks);
+    // The victim is the least recently used hot block.
+    CHECK(! Get(theCache, 100, 1, 1023));
+    for (int i = 1; i < kCacheBlocks; i++) {
+        CHECK(Get(theCache, 100 + i, 1, 1023));
+    }
+    CheckCounters(theCache);
+}
+
+int
+main(
+    int    /* inArgCount */,
+    char** /* inArgsPtr */)
+{
+    TestDisabled();
+    TestBasic();
+    TestAdmission();
+    if (sErrorCount == 0) {
+        cout << "Passed read cache test\n";
+        return 0;
+    }
+    cerr << "Read cache test failed, errors: " << sErrorCount << "\n";
+    return 1;
+}
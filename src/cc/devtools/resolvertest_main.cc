@@ -0,0 +1,320 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Host os resolver cache test. Numeric address and malformed host
+// names are used, in order to have deterministic successful and failed
+// resolutions with no dns server. The requests are issued with the net
+// manager time set ahead of the cached entries insertion time, in order to
+// exercise negative entries expiration, the background refresh ahead of
+// positive entries expiration, refresh coalescing, positive entries
+// expiration, negative entries eviction before positive entries, and
+// disabled negative caching, with no waiting.
+//
+//----------------------------------------------------------------------------
+
+#include "kfsio/Resolver.h"
+#include "kfsio/NetManager.h"
+#include "kfsio/ITimeout.h"
+#include "kfsio/Globals.h"
+#include "common/MsgLogger.h"
+#include "TestCheck.h"
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace KFS
+{
+
+using std::cout;
+using std::cerr;
+using std::string;
+using std::ostringstream;
+
+class ResolverTest : public ITimeout
+{
+public:
+    ResolverTest(
+        NetManager& inNetManager,
+        Resolver&   inResolver)
+        : ITimeout(),
+          mNetManager(inNetManager),
+          mResolver(inResolver),
+          mStep(0),
+          mPendingCount(0),
+          mStartTime(inNetManager.Now()),
+          mPrevCounters()
+        { mPrevCounters.Clear(); }
+    virtual ~ResolverTest()
+        {}
+    virtual void Timeout()
+    {
+        if (0 < mPendingCount) {
+            return;
+        }
+        if (mStartTime + kMaxTestTimeSec < mNetManager.Now() ||
+                0 < sErrorCount) {
+            CHECK(sErrorCount != 0);
+            mNetManager.Shutdown();
+            return;
+        }
+        if (RunStep()) {
+            mStep++;
+        }
+    }
+    enum
+    {
+        kCacheSize        = 4,
+        kExpirationSec    = 100,
+        kNegExpirationSec = 50,
+        kRefreshAheadSec  = 20,
+        kThreadCount      = 2,
+        kMaxTestTimeSec   = 30
+    };
+private:
+    class TestRequest : public Resolver::Request
+    {
+    public:
+        TestRequest(
+            ResolverTest& inTest,
+            const string& inHostName,
+            bool          inOkFlag)
+            : Resolver::Request(inHostName),
+              mTest(inTest),
+              mOkFlag(inOkFlag)
+            {}
+        virtual ~TestRequest()
+            {}
+        virtual void Done()
+        {
+            if (mOkFlag) {
+                CHECK(mStatus == 0 && mIpAddresses.size() == 1 &&
+                    mIpAddresses.front() == mHostName);
+            } else {
+                CHECK(mStatus != 0 && mIpAddresses.empty());
+            }
+            mTest.mPendingCount--;
+            delete this;
+        }
+    private:
+        ResolverTest& mTest;
+        const bool    mOkFlag;
+    };
+    friend class TestRequest;
+
+    NetManager&        mNetManager;
+    Resolver&          mResolver;
+    int                mStep;
+    int                mPendingCount;
+    const time_t       mStartTime;
+    Resolver::Counters mPrevCounters;
+
+    static const char* PositiveName()
+        { return "127.0.0.1"; }
+    static const char* NegativeName()
+        { return "qfs..test"; }
+    // Issues request with the net manager time set to the test start time
+    // plus the time offset. The cached entries are inserted with the
+    // current time, which is the same or slightly past the start time.
+    void Enqueue(
+        const string& inHostName,
+        bool          inOkFlag,
+        int           inTimeOffsetSec)
+    {
+        const time_t theNow = mNetManager.Now();
+        mPendingCount++;
+        mNetManager.SetTimeNow(mStartTime + inTimeOffsetSec);
+        const int theStatus = mResolver.Enqueue(
+            *(new TestRequest(*this, inHostName, inOkFlag)),
+            kMaxTestTimeSec);
+        mNetManager.SetTimeNow(theNow);
+        CHECK(theStatus == 0);
+    }
+    // Returns counters change since the last call.
+    Resolver::Counters GetDelta()
+    {
+        Resolver::Counters theCounters;
+        mResolver.GetCounters(theCounters);
+        Resolver::Counters theRet = theCounters;
+        theRet.mHitCount         -= mPrevCounters.mHitCount;
+        theRet.mNegativeHitCount -= mPrevCounters.mNegativeHitCount;
+        theRet.mMissCount        -= mPrevCounters.mMissCount;
+        theRet.mRefreshCount     -= mPrevCounters.mRefreshCount;
+        theRet.mResolvedCount    -= mPrevCounters.mResolvedCount;
+        theRet.mErrorCount       -= mPrevCounters.mErrorCount;
+        mPrevCounters = theCounters;
+        return theRet;
+    }
+    bool IsRefreshDone()
+    {
+        Resolver::Counters theCounters;
+        mResolver.GetCounters(theCounters);
+        return (mPrevCounters.mResolvedCount < theCounters.mResolvedCount);
+    }
+    // Each step verifies the counters changes of the previous step.
+    bool RunStep()
+    {
+        Resolver::Counters theDelta;
+        switch (mStep) {
+            case 0:
+                GetDelta();
+                // Misses, the same name requests are coalesced.
+                for (int i = 0; i < 2; i++) {
+                    Enqueue(PositiveName(), true, 0);
+                    Enqueue(NegativeName(), false, 0);
+                }
+                break;
+            case 1:
+                theDelta = GetDelta();
+                CHECK(theDelta.mMissCount == 4 &&
+                    theDelta.mResolvedCount == 1 &&
+                    theDelta.mErrorCount == 1 &&
+                    theDelta.mCacheSize == 2);
+                // Positive and negative hits.
+                Enqueue(PositiveName(), true, 0);
+                Enqueue(NegativeName(), false, 0);
+                break;
+            case 2:
+                theDelta = GetDelta();
+                CHECK(theDelta.mHitCount == 1 &&
+                    theDelta.mNegativeHitCount == 1 &&
+                    theDelta.mMissCount == 0 &&
+                    theDelta.mResolvedCount == 0 &&
+                    theDelta.mErrorCount == 0);
+                // Negative entry expired, positive entry is not yet due for
+                // refresh.
+                Enqueue(PositiveName(), true, kNegExpirationSec + 5);
+                Enqueue(NegativeName(), false, kNegExpirationSec + 5);
+                break;
+            case 3:
+                theDelta = GetDelta();
+                CHECK(theDelta.mHitCount == 1 &&
+                    theDelta.mNegativeHitCount == 0 &&
+                    theDelta.mMissCount == 1 &&
+                    theDelta.mRefreshCount == 0 &&
+                    theDelta.mResolvedCount == 0 &&
+                    theDelta.mErrorCount == 1);
+                // Refresh ahead of expiration, the second refresh is
+                // coalesced with the pending one.
+                Enqueue(PositiveName(), true,
+                    kExpirationSec - kRefreshAheadSec + 5);
+                Enqueue(PositiveName(), true,
+                    kExpirationSec - kRefreshAheadSec + 5);
+                break;
+            case 4:
+                if (! IsRefreshDone()) {
+                    return false;
+                }
+                theDelta = GetDelta();
+                CHECK(theDelta.mHitCount == 2 &&
+                    theDelta.mMissCount == 0 &&
+                    theDelta.mRefreshCount == 1 &&
+                    theDelta.mResolvedCount == 1);
+                // The refreshed entry is inserted with the current time,
+                // thus the same as the initial one, and must expire.
+                Enqueue(PositiveName(), true, kExpirationSec + 10);
+                break;
+            case 5:
+                theDelta = GetDelta();
+                CHECK(theDelta.mHitCount == 0 &&
+                    theDelta.mMissCount == 1 &&
+                    theDelta.mResolvedCount == 1);
+                // Negative entries are evicted first.
+                for (int i = 0; i < kCacheSize + 2; i++) {
+                    ostringstream theStream;
+                    theStream << "qfs" << i << "..test";
+                    Enqueue(theStream.str(), false, 0);
+                }
+                break;
+            case 6:
+                theDelta = GetDelta();
+                CHECK(theDelta.mMissCount == kCacheSize + 2 &&
+                    theDelta.mErrorCount == kCacheSize + 2 &&
+                    theDelta.mCacheSize == kCacheSize);
+                Enqueue(PositiveName(), true, 0);
+                break;
+            case 7:
+                theDelta = GetDelta();
+                CHECK(theDelta.mHitCount == 1 && theDelta.mMissCount == 0);
+                // Failures are not cached with negative caching disabled.
+                mResolver.SetParameters(0, kRefreshAheadSec, kThreadCount);
+                Enqueue("qfs.disabled..test", false, 0);
+                break;
+            case 8:
+            case 9:
+                theDelta = GetDelta();
+                CHECK(theDelta.mNegativeHitCount == 0 &&
+                    theDelta.mMissCount == 1 &&
+                    theDelta.mErrorCount == 1);
+                if (mStep == 8) {
+                    Enqueue("qfs.disabled..test", false, 0);
+                    break;
+                }
+                // Fall through.
+            default:
+                mNetManager.Shutdown();
+                break;
+        }
+        return true;
+    }
+private:
+    ResolverTest(
+        const ResolverTest& inTest);
+    ResolverTest& operator=(
+        const ResolverTest& inTest);
+};
+
+}
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    using namespace KFS;
+    MsgLogger::Init(0, (1 < inArgCount && atoi(inArgsPtr[1]) != 0) ?
+        MsgLogger::kLogLevelDEBUG : MsgLogger::kLogLevelINFO);
+    libkfsio::InitGlobals();
+    {
+        NetManager theNetManager(10);
+        Resolver   theResolver(theNetManager, Resolver::ResolverTypeOs);
+        theResolver.SetCacheSizeAndTimeout(ResolverTest::kCacheSize,
+            ResolverTest::kExpirationSec);
+        theResolver.SetParameters(ResolverTest::kNegExpirationSec,
+            ResolverTest::kRefreshAheadSec, ResolverTest::kThreadCount);
+        CHECK(theResolver.Start() == 0);
+        ResolverTest theTest(theNetManager, theResolver);
+        theNetManager.RegisterTimeoutHandler(&theTest);
+        theNetManager.MainLoop();
+        theNetManager.UnRegisterTimeoutHandler(&theTest);
+        theResolver.Shutdown();
+    }
+    libkfsio::DestroyGlobals();
+    MsgLogger::Stop();
+    if (sErrorCount == 0) {
+        cout << "Passed resolver cache test\n";
+        return 0;
+    }
+    cerr << "Resolver cache test failed, errors: " << sErrorCount << "\n";
+    return 1;
+}
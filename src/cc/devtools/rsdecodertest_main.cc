@@ -0,0 +1,264 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Reed-Solomon erasure method decoder test. Concurrently decodes
+// random data with a set of erasure patterns larger than the decoding
+// matrices cache, repeating each pattern a few times, in order to exercise
+// cache hits, evictions, and slot collisions between the threads.
+//
+//----------------------------------------------------------------------------
+
+#include "libclient/ECMethod.h"
+#include "common/kfstypes.h"
+#include "qcdio/QCThread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace KFS;
+using client::ECMethod;
+using std::cout;
+using std::cerr;
+using std::vector;
+
+class DecoderTestWorker : public QCRunnable
+{
+public:
+    DecoderTestWorker(
+        int                        inId,
+        int                        inStripeCount,
+        int                        inRecoveryStripeCount,
+        int                        inLength,
+        const vector<vector<int> >& inPatterns,
+        int                        inPasses)
+        : QCRunnable(),
+          mStripeCount(inStripeCount),
+          mRecoveryStripeCount(inRecoveryStripeCount),
+          mLength(inLength),
+          mPatterns(inPatterns),
+          mPasses(inPasses),
+          mRand(0x9E3779B97F4A7C15ull * (uint64_t)(inId + 1)),
+          mErrorCount(0),
+          mDecodeCount(0),
+          mThread(this, "rsdecodertest")
+        {}
+    virtual ~DecoderTestWorker()
+        {}
+    void Start()
+        { mThread.Start(); }
+    void Join()
+        { mThread.Join(); }
+    int GetErrorCount() const
+        { return mErrorCount; }
+    int64_t GetDecodeCount() const
+        { return mDecodeCount; }
+    virtual void Run()
+    {
+        ECMethod::Encoder* const theEncoderPtr = ECMethod::FindEncoder(
+            KFS_STRIPED_FILE_TYPE_RS, mStripeCount, mRecoveryStripeCount, 0);
+        ECMethod::Decoder* const theDecoderPtr = ECMethod::FindDecoder(
+            KFS_STRIPED_FILE_TYPE_RS, mStripeCount, mRecoveryStripeCount, 0);
+        if (! theEncoderPtr || ! theDecoderPtr) {
+            cerr << "no RS encoder or decoder\n";
+            mErrorCount++;
+            return;
+        }
+        const int             theCount = mStripeCount + mRecoveryStripeCount;
+        vector<vector<char> > theExpected(theCount);
+        vector<vector<char> > theBuffers(theCount);
+        vector<void*>         thePtrs(theCount);
+        for (int i = 0; i < theCount; i++) {
+            theExpected[i].resize(mLength + kAlign);
+            theBuffers[i].resize(mLength + kAlign);
+        }
+        const size_t thePatternCount = mPatterns.size();
+        for (int thePass = 0; thePass < mPasses && mErrorCount <= 0;
+                thePass++) {
+            for (size_t k = 0; k < thePatternCount && mErrorCount <= 0; k++) {
+                // Visit the patterns in a different order in each pass and
+                // in each thread.
+                const vector<int>& thePattern = mPatterns[
+                    (k * 7 + (size_t)Random() % 3 + (size_t)thePass) %
+                    thePatternCount];
+                for (int i = 0; i < theCount; i++) {
+                    char* const thePtr = Align(theExpected[i]);
+                    if (i < mStripeCount) {
+                        for (int b = 0; b < mLength; b += 8) {
+                            const uint64_t theVal = Random();
+                            memcpy(thePtr + b, &theVal, sizeof(theVal));
+                        }
+                    }
+                    thePtrs[i] = thePtr;
+                }
+                theEncoderPtr->Encode(mStripeCount, mRecoveryStripeCount,
+                    mLength, &thePtrs[0]);
+                for (int i = 0; i < theCount; i++) {
+                    char* const thePtr = Align(theBuffers[i]);
+                    memcpy(thePtr, Align(theExpected[i]), mLength);
+                    thePtrs[i] = thePtr;
+                }
+                for (size_t i = 0; 0 <= thePattern[i]; i++) {
+                    memset(thePtrs[thePattern[i]], 0, mLength);
+                }
+                if (theDecoderPtr->Decode(mStripeCount, mRecoveryStripeCount,
+                        mLength, &thePtrs[0], &thePattern[0]) != 0) {
+                    Error("decode failure", thePattern);
+                    break;
+                }
+                mDecodeCount++;
+                for (int i = 0; i < theCount; i++) {
+                    if (memcmp(thePtrs[i], Align(theExpected[i]),
+                            mLength) != 0) {
+                        Error("decoded stripe mismatch", thePattern);
+                        break;
+                    }
+                }
+            }
+        }
+        theEncoderPtr->Release();
+        theDecoderPtr->Release();
+    }
+private:
+    enum { kAlign = 16 };
+
+    const int                   mStripeCount;
+    const int                   mRecoveryStripeCount;
+    const int                   mLength;
+    const vector<vector<int> >& mPatterns;
+    const int                   mPasses;
+    uint64_t                    mRand;
+    int                         mErrorCount;
+    int64_t                     mDecodeCount;
+    QCThread                    mThread;
+
+    uint64_t Random()
+    {
+        mRand = mRand * 6364136223846793005ull + 1442695040888963407ull;
+        return (mRand ^ (mRand >> 29));
+    }
+    static char* Align(
+        vector<char>& inBuf)
+    {
+        char* const thePtr = &inBuf[0];
+        return (thePtr + (kAlign - (size_t)thePtr % kAlign) % kAlign);
+    }
+    void Error(
+        const char*        inMsgPtr,
+        const vector<int>& inPattern)
+    {
+        cerr << mStripeCount << "+" << mRecoveryStripeCount <<
+            " error: " << inMsgPtr << " missing:";
+        for (size_t i = 0; 0 <= inPattern[i]; i++) {
+            cerr << " " << inPattern[i];
+        }
+        cerr << "\n";
+        mErrorCount++;
+    }
+private:
+    DecoderTestWorker(
+        const DecoderTestWorker& inWorker);
+    DecoderTestWorker& operator=(
+        const DecoderTestWorker& inWorker);
+};
+
+static int
+RunTest(
+    int inStripeCount,
+    int inRecoveryStripeCount,
+    int inLength,
+    int inPatternCount,
+    int inThreadCount,
+    int inPasses)
+{
+    const int            theCount = inStripeCount + inRecoveryStripeCount;
+    vector<vector<int> > thePatterns(inPatternCount);
+    for (int p = 0; p < inPatternCount; p++) {
+        // Every recovery stripe count is used, from single to max. erasures.
+        const int theMissingCnt = 1 + p % inRecoveryStripeCount;
+        vector<int>& thePattern = thePatterns[p];
+        while ((int)thePattern.size() < theMissingCnt) {
+            const int theIdx = rand() % theCount;
+            size_t    i      = 0;
+            while (i < thePattern.size() && thePattern[i] != theIdx) {
+                i++;
+            }
+            if (thePattern.size() <= i) {
+                thePattern.push_back(theIdx);
+            }
+        }
+        thePattern.push_back(-1);
+    }
+    vector<DecoderTestWorker*> theWorkers;
+    for (int i = 0; i < inThreadCount; i++) {
+        theWorkers.push_back(new DecoderTestWorker(i, inStripeCount,
+            inRecoveryStripeCount, inLength, thePatterns, inPasses));
+    }
+    for (int i = 0; i < inThreadCount; i++) {
+        theWorkers[i]->Start();
+    }
+    int     theErrorCount  = 0;
+    int64_t theDecodeCount = 0;
+    for (int i = 0; i < inThreadCount; i++) {
+        theWorkers[i]->Join();
+        theErrorCount  += theWorkers[i]->GetErrorCount();
+        theDecodeCount += theWorkers[i]->GetDecodeCount();
+        delete theWorkers[i];
+    }
+    cout << inStripeCount << "+" << inRecoveryStripeCount <<
+        " patterns: " << inPatternCount <<
+        " threads: "  << inThreadCount <<
+        " decoded: "  << theDecodeCount <<
+        (theErrorCount == 0 ? " passed" : " failed") << "\n";
+    return theErrorCount;
+}
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    const unsigned int theSeed = 1 < inArgCount ?
+        (unsigned int)atoi(inArgsPtr[1]) : 1;
+    srand(theSeed);
+    const int theConfigs[][3] = {
+        // data stripes, recovery stripes, stripe length
+        {  6,  3, 4096 },
+        { 16,  4, 4096 },
+        { 20,  4, 8192 },
+        { 10,  8, 4096 },
+        { 64, 32, 1024 },
+    };
+    int theErrorCount = 0;
+    for (size_t i = 0; i < sizeof(theConfigs) / sizeof(theConfigs[0]); i++) {
+        theErrorCount += RunTest(theConfigs[i][0], theConfigs[i][1],
+            theConfigs[i][2], 200, 3, 4);
+    }
+    if (theErrorCount == 0) {
+        cout << "Passed RS decoder test\n";
+        return 0;
+    }
+    cerr << "RS decoder test failed, errors: " << theErrorCount <<
+        " seed: " << theSeed << "\n";
+    return 1;
+}
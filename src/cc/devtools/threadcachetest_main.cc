@@ -0,0 +1,347 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Thread cache allocator test. Verifies that:
+// - the exited thread's free lists are returned to the central lists, and
+//   re-used with no additional storage,
+// - the freed objects of all size classes are re-used,
+// - concurrently allocated objects do not overlap, with objects of random
+//   sizes allocated, filled with the owner's pattern, and freed by the
+//   allocating thread or handed off to and freed by other threads,
+// - the STL allocator interface works with the node based containers.
+//
+//----------------------------------------------------------------------------
+
+#include "common/ThreadCacheAllocator.h"
+#include "qcdio/QCThread.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
+#include "TestCheck.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <vector>
+#include <list>
+#include <map>
+
+using std::cout;
+using std::cerr;
+using std::vector;
+using std::list;
+using std::map;
+using std::less;
+using std::pair;
+using namespace KFS;
+
+static QCMutex sMutex;
+
+enum
+{
+    kMaxTestSize   = ThreadCache::kMaxSize + 64,
+    kMaxHeld       = 256,
+    kHandOffMax    = 1024,
+    kThreadCount   = 8
+};
+
+struct Object
+{
+    Object(
+        char*  inPtr  = 0,
+        size_t inSize = 0,
+        char   inFill = 0)
+        : mPtr(inPtr),
+          mSize(inSize),
+          mFill(inFill)
+        {}
+    char*  mPtr;
+    size_t mSize;
+    char   mFill;
+};
+
+static Object
+Allocate(
+    size_t inSize,
+    char   inFill)
+{
+    char* const thePtr = static_cast<char*>(ThreadCache::Allocate(inSize));
+    memset(thePtr, inFill, inSize);
+    return Object(thePtr, inSize, inFill);
+}
+
+static void
+Deallocate(
+    const Object& inObj)
+{
+    for (size_t i = 0; i < inObj.mSize; i++) {
+        if (inObj.mPtr[i] != inObj.mFill) {
+            CHECK(! "object content changed");
+            break;
+        }
+    }
+    ThreadCache::Deallocate(inObj.mPtr, inObj.mSize);
+}
+
+static int64_t
+GetStorageBytes()
+{
+    ThreadCache::Counters theCounters;
+    ThreadCache::GetCounters(theCounters);
+    return theCounters.mStorageBytes;
+}
+
+class AllocateAndExit : public QCRunnable
+{
+public:
+    AllocateAndExit(
+        size_t inSize,
+        int    inCount)
+        : QCRunnable(),
+          mSize(inSize),
+          mCount(inCount)
+        {}
+    virtual ~AllocateAndExit()
+        {}
+    virtual void Run()
+    {
+        vector<Object> theObjs;
+        for (int i = 0; i < mCount; i++) {
+            theObjs.push_back(Allocate(mSize, (char)i));
+        }
+        for (int i = 0; i < mCount; i++) {
+            Deallocate(theObjs[i]);
+        }
+    }
+private:
+    const size_t mSize;
+    const int    mCount;
+private:
+    AllocateAndExit(
+        const AllocateAndExit& inRunnable);
+    AllocateAndExit& operator=(
+        const AllocateAndExit& inRunnable);
+};
+
+// The size class is not used before this test, thus the exited thread's
+// cache is required to satisfy the main thread's allocations with no new
+// slabs.
+static void
+ThreadExitTest()
+{
+    const size_t kSize  = 200;
+    const int    kCount = 2 * ThreadCache::kSlabSize / 208;
+    ThreadCache::Counters theStart;
+    ThreadCache::GetCounters(theStart);
+    AllocateAndExit theRunnable(kSize, kCount);
+    QCThread        theThread(&theRunnable, "threadexit");
+    theThread.Start();
+    theThread.Join();
+    ThreadCache::Counters theCounters;
+    ThreadCache::GetCounters(theCounters);
+    CHECK(theCounters.mThreadCacheCount == theStart.mThreadCacheCount);
+    CHECK(theStart.mReleaseCount < theCounters.mReleaseCount);
+    const int64_t theStorage = theCounters.mStorageBytes;
+    CHECK(theStart.mStorageBytes < theStorage);
+    theRunnable.Run();
+    CHECK(GetStorageBytes() == theStorage);
+}
+
+// Allocate and free all size classes twice, the second round must re-use
+// the freed objects.
+static void
+ReuseTest()
+{
+    const int kCount = 3 * ThreadCache::kMaxCacheBytes / ThreadCache::kMaxSize;
+    int64_t theStorage = 0;
+    for (int theRound = 0; theRound < 2; theRound++) {
+        vector<Object> theObjs;
+        for (size_t theSize = 1; theSize <= kMaxTestSize; theSize++) {
+            for (int i = 0; i < kCount; i++) {
+                theObjs.push_back(Allocate(theSize, (char)theObjs.size()));
+            }
+        }
+        for (size_t i = 0; i < theObjs.size(); i++) {
+            Deallocate(theObjs[i]);
+        }
+        if (theRound == 0) {
+            theStorage = GetStorageBytes();
+        } else {
+            CHECK(GetStorageBytes() == theStorage);
+        }
+    }
+}
+
+class StressWorker : public QCRunnable
+{
+public:
+    StressWorker(
+        int             inId,
+        int             inIterations,
+        vector<Object>& inHandOff)
+        : QCRunnable(),
+          mId(inId),
+          mIterations(inIterations),
+          mRand(0x9E3779B97F4A7C15ull * (uint64_t)(inId + 1)),
+          mHandOff(inHandOff),
+          mThread(this, "threadcache")
+        {}
+    virtual ~StressWorker()
+        {}
+    void Start()
+        { mThread.Start(); }
+    void Join()
+        { mThread.Join(); }
+    virtual void Run()
+    {
+        vector<Object> theObjs;
+        for (int i = 0; i < mIterations && sErrorCount <= 0; i++) {
+            const int theOp = (int)(Random() % 8);
+            if (theOp < 4 && theObjs.size() < kMaxHeld) {
+                const size_t theSize = 1 + (size_t)(Random() % kMaxTestSize);
+                theObjs.push_back(Allocate(theSize,
+                    (char)(mId * 31 + theObjs.size())));
+            } else if (theOp < 6 && ! theObjs.empty()) {
+                const size_t theIdx = (size_t)(Random() % theObjs.size());
+                Deallocate(theObjs[theIdx]);
+                theObjs[theIdx] = theObjs.back();
+                theObjs.pop_back();
+            } else if (theOp == 6 && ! theObjs.empty()) {
+                QCStMutexLocker theLock(sMutex);
+                if (mHandOff.size() < kHandOffMax) {
+                    mHandOff.push_back(theObjs.back());
+                    theObjs.pop_back();
+                }
+            } else {
+                Object theObj;
+                {
+                    QCStMutexLocker theLock(sMutex);
+                    if (! mHandOff.empty()) {
+                        theObj = mHandOff.back();
+                        mHandOff.pop_back();
+                    }
+                }
+                if (theObj.mPtr) {
+                    Deallocate(theObj);
+                }
+            }
+        }
+        for (size_t i = 0; i < theObjs.size(); i++) {
+            Deallocate(theObjs[i]);
+        }
+    }
+private:
+    const int       mId;
+    const int       mIterations;
+    uint64_t        mRand;
+    vector<Object>& mHandOff;
+    QCThread        mThread;
+
+    uint64_t Random()
+    {
+        mRand = mRand * 6364136223846793005ull + 1442695040888963407ull;
+        return (mRand >> 33);
+    }
+private:
+    StressWorker(
+        const StressWorker& inWorker);
+    StressWorker& operator=(
+        const StressWorker& inWorker);
+};
+
+static void
+StressTest(
+    int inIterations)
+{
+    ThreadCache::Counters theStart;
+    ThreadCache::GetCounters(theStart);
+    vector<Object>        theHandOff;
+    vector<StressWorker*> theWorkers;
+    for (int i = 0; i < kThreadCount; i++) {
+        theWorkers.push_back(new StressWorker(i, inIterations, theHandOff));
+    }
+    for (int i = 0; i < kThreadCount; i++) {
+        theWorkers[i]->Start();
+    }
+    for (int i = 0; i < kThreadCount; i++) {
+        theWorkers[i]->Join();
+        delete theWorkers[i];
+    }
+    for (size_t i = 0; i < theHandOff.size(); i++) {
+        Deallocate(theHandOff[i]);
+    }
+    ThreadCache::Counters theCounters;
+    ThreadCache::GetCounters(theCounters);
+    CHECK(theCounters.mThreadCacheCount == theStart.mThreadCacheCount);
+    CHECK(theStart.mRefillCount < theCounters.mRefillCount);
+    CHECK(theStart.mReleaseCount < theCounters.mReleaseCount);
+}
+
+static void
+ContainerTest()
+{
+    typedef list<int, ThreadCacheAllocator<int> > List;
+    typedef map<int, int, less<int>,
+        ThreadCacheAllocator<pair<const int, int> > > Map;
+    const int kCount = 10000;
+    List theList;
+    Map  theMap;
+    for (int i = 0; i < kCount; i++) {
+        theList.push_back(i);
+        theMap[i] = -i;
+    }
+    for (int i = 0; i < kCount; i += 2) {
+        theMap.erase(i);
+    }
+    int theExpected = 0;
+    for (List::const_iterator theIt = theList.begin();
+            theIt != theList.end();
+            ++theIt) {
+        CHECK(*theIt == theExpected);
+        theExpected++;
+    }
+    CHECK(theExpected == kCount);
+    CHECK((int)theMap.size() == kCount / 2);
+    for (Map::const_iterator theIt = theMap.begin();
+            theIt != theMap.end();
+            ++theIt) {
+        CHECK(theIt->first % 2 == 1 && theIt->second == -theIt->first);
+    }
+}
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    const int theIterations = 1 < inArgCount ? atoi(inArgsPtr[1]) : 200000;
+    ThreadExitTest();
+    ReuseTest();
+    StressTest(theIterations);
+    ReuseTest();
+    ContainerTest();
+    if (sErrorCount == 0) {
+        cout << "Passed thread cache test\n";
+        return 0;
+    }
+    cerr << "Thread cache test failed, errors: " << sErrorCount << "\n";
+    return 1;
+}
@@ -0,0 +1,371 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Net manager timeout handlers timer wheel test. The timeout handlers
+// are run with synthetic time, advanced in 1 ms steps, larger steps, and
+// jumps. Each handler verifies that it is invoked no earlier than its due
+// time, and no later than the time step past its due time, and the test
+// verifies that no enabled handler is overdue after each step. The handlers
+// intervals are around the wheel levels boundaries, and beyond the wheel
+// range. Covers the wheel slot by slot advance, large overrun re-evaluation,
+// re-scheduling, disabling, and un-registering handlers from Timeout(), and
+// Disable() and SetTimeoutInterval() between the steps.
+//
+//----------------------------------------------------------------------------
+
+#include "kfsio/NetManager.h"
+#include "kfsio/ITimeout.h"
+#include "TestCheck.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+using namespace KFS;
+using std::cout;
+using std::cerr;
+using std::max;
+using std::min;
+using std::vector;
+
+static int64_t sMaxLateMs  = 1;
+
+class TestHandler : public ITimeout
+{
+public:
+    enum Action
+    {
+        kActionNone       = 0,
+        kActionToggle     = 1, // Alternate own interval.
+        kActionSetOther   = 2, // Alternate the other handler's interval.
+        kActionDisable    = 3, // Disable self after a few calls.
+        kActionUnregister = 4  // Unregister self after a few calls.
+    };
+    enum { kActionCallCount = 3 };
+
+    TestHandler(
+        NetManager&  inNetManager,
+        int          inIntervalMs,
+        Action       inAction,
+        TestHandler* inOtherPtr)
+        : ITimeout(),
+          mNetManager(inNetManager),
+          mAction(inAction),
+          mOtherPtr(inOtherPtr),
+          mCallCount(0),
+          mPrevCallMs(-1),
+          mMinCallMs(-1),
+          mRegisteredFlag(false)
+        { SetTimeoutInterval(inIntervalMs); }
+    virtual ~TestHandler()
+        { Unregister(); }
+    void Register(
+        int64_t inNowMs)
+    {
+        mRegisteredFlag = true;
+        mMinCallMs      = inNowMs;
+        mNetManager.RegisterTimeoutHandler(this);
+    }
+    void Unregister()
+    {
+        mRegisteredFlag = false;
+        mNetManager.UnRegisterTimeoutHandler(this);
+    }
+    // Sets the interval, and enables the handler. If the interval since the
+    // last invocation has already passed, the handler is due now.
+    void SetInterval(
+        int     inIntervalMs,
+        int64_t inNowMs)
+    {
+        SetTimeoutInterval(inIntervalMs);
+        mMinCallMs = inNowMs;
+    }
+    void Disable()
+        { ITimeout::Disable(); }
+    bool IsActive() const
+        { return (mRegisteredFlag && ! mDisabled); }
+    int GetInterval() const
+        { return mIntervalMs; }
+    int64_t GetCallCount() const
+        { return mCallCount; }
+    int64_t GetPrevCallMs() const
+        { return mPrevCallMs; }
+    int64_t GetDueMs() const
+    {
+        return (mPrevCallMs < 0 ? mMinCallMs :
+            max(mMinCallMs, mPrevCallMs + max(0, mIntervalMs)));
+    }
+    virtual void Timeout()
+    {
+        const int64_t theNowMs = GetLastCallTimeMs();
+        CHECK(IsActive());
+        // Handler with no interval is due at every run.
+        const int64_t theLate = mIntervalMs <= 0 ? 0 : theNowMs - GetDueMs();
+        if (theLate < 0 || sMaxLateMs <= theLate) {
+            cerr << "interval: " << mIntervalMs <<
+                " late: "        << theLate <<
+                " max: "         << sMaxLateMs <<
+                " calls: "       << mCallCount <<
+                "\n";
+            sErrorCount++;
+        }
+        mCallCount++;
+        mPrevCallMs = theNowMs;
+        mMinCallMs  = -1;
+        switch (mAction) {
+            case kActionToggle:
+                SetTimeoutInterval(mIntervalMs == 7 ? 301 : 7);
+                break;
+            case kActionSetOther:
+                mOtherPtr->SetInterval(
+                    mOtherPtr->GetInterval() == 700 ? 1300 : 700, theNowMs);
+                break;
+            case kActionDisable:
+                if (kActionCallCount <= mCallCount) {
+                    Disable();
+                }
+                break;
+            case kActionUnregister:
+                if (kActionCallCount <= mCallCount) {
+                    Unregister();
+                }
+                break;
+            default:
+                break;
+        }
+    }
+private:
+    NetManager&        mNetManager;
+    const Action       mAction;
+    TestHandler* const mOtherPtr;
+    int64_t            mCallCount;
+    int64_t            mPrevCallMs;
+    int64_t            mMinCallMs;
+    bool               mRegisteredFlag;
+private:
+    TestHandler(
+        const TestHandler& inHandler);
+    TestHandler& operator=(
+        const TestHandler& inHandler);
+};
+
+class TimeoutWheelTest
+{
+public:
+    TimeoutWheelTest()
+        : mNetManager(),
+          mHandlers(),
+          // Past the net manager's timer wheel start time.
+          mNowMs(ITimeout::NowMs() + 1000),
+          mRunCount(0)
+        {}
+    ~TimeoutWheelTest()
+    {
+        for (size_t i = 0; i < mHandlers.size(); i++) {
+            delete mHandlers[i];
+        }
+    }
+    TestHandler& Add(
+        int                 inIntervalMs,
+        TestHandler::Action inAction   = TestHandler::kActionNone,
+        TestHandler*        inOtherPtr = 0)
+    {
+        TestHandler* const thePtr = new TestHandler(
+            mNetManager, inIntervalMs, inAction, inOtherPtr);
+        mHandlers.push_back(thePtr);
+        thePtr->Register(mNowMs);
+        Run();
+        return *thePtr;
+    }
+    // Advances the time in steps.
+    void Advance(
+        int64_t inDurationMs,
+        int64_t inStepMs)
+    {
+        sMaxLateMs = inStepMs;
+        const int64_t theEndMs = mNowMs + inDurationMs;
+        while (mNowMs < theEndMs && sErrorCount <= 0) {
+            mNowMs = min(theEndMs, mNowMs + inStepMs);
+            Run();
+        }
+        sMaxLateMs = 1;
+    }
+    int64_t Now() const
+        { return mNowMs; }
+    int64_t GetRunCount() const
+        { return mRunCount; }
+    int64_t GetCallCount() const
+    {
+        int64_t theCount = 0;
+        for (size_t i = 0; i < mHandlers.size(); i++) {
+            theCount += mHandlers[i]->GetCallCount();
+        }
+        return theCount;
+    }
+    NetManager& GetNetManager()
+        { return mNetManager; }
+private:
+    // Runs the handlers, and verifies that no handler is overdue.
+    void Run()
+    {
+        mNetManager.RunTimeoutHandlers(mNowMs);
+        mRunCount++;
+        for (size_t i = 0; i < mHandlers.size(); i++) {
+            const TestHandler& theHandler = *mHandlers[i];
+            if (theHandler.IsActive() && theHandler.GetDueMs() <= mNowMs &&
+                    theHandler.GetPrevCallMs() < mNowMs) {
+                cerr << "overdue: interval: " << theHandler.GetInterval() <<
+                    " by: "    << mNowMs - theHandler.GetDueMs() <<
+                    " calls: " << theHandler.GetCallCount() <<
+                    "\n";
+                sErrorCount++;
+            }
+        }
+    }
+
+    NetManager           mNetManager;
+    vector<TestHandler*> mHandlers;
+    int64_t              mNowMs;
+    int64_t              mRunCount;
+private:
+    TimeoutWheelTest(
+        const TimeoutWheelTest& inTest);
+    TimeoutWheelTest& operator=(
+        const TimeoutWheelTest& inTest);
+};
+
+static void
+RunTest(
+    int64_t inDurationMs)
+{
+    TimeoutWheelTest theTest;
+    // Intervals at the wheel levels boundaries: 64, 64^2, 64^3 ms.
+    const int kIntervals[] = {
+        1, 2, 63, 64, 65, 100, 1000, 4095, 4096, 4097, 10000,
+        262143, 262144, 262145, 1000000
+    };
+    const size_t kIntervalsCount = sizeof(kIntervals) / sizeof(kIntervals[0]);
+    vector<TestHandler*> theHandlers;
+    for (size_t i = 0; i < kIntervalsCount; i++) {
+        theHandlers.push_back(&theTest.Add(kIntervals[i]));
+    }
+    const int64_t theRunCount  = theTest.GetRunCount();
+    TestHandler&  theEveryLoop = theTest.Add(0);
+    TestHandler&  theToggle    = theTest.Add(7, TestHandler::kActionToggle);
+    TestHandler&  theOther     = theTest.Add(700);
+    theTest.Add(500, TestHandler::kActionSetOther, &theOther);
+    TestHandler&  theDisable   = theTest.Add(30, TestHandler::kActionDisable);
+    TestHandler&  theUnregister =
+        theTest.Add(40, TestHandler::kActionUnregister);
+    NetManager::Counters theCounters;
+    theTest.GetNetManager().GetCounters(theCounters);
+    CHECK(theCounters.mTimeoutHandlerCount == (int64_t)kIntervalsCount + 6);
+
+    // Wheel advance one slot at a time.
+    theTest.Advance(inDurationMs, 1);
+    CHECK(theEveryLoop.GetCallCount() == theTest.GetRunCount() - theRunCount);
+    CHECK(theDisable.GetCallCount() == TestHandler::kActionCallCount);
+    CHECK(theUnregister.GetCallCount() == TestHandler::kActionCallCount);
+    CHECK(10 < theToggle.GetCallCount() && 10 < theOther.GetCallCount());
+    for (size_t i = 0; i < kIntervalsCount; i++) {
+        CHECK(theHandlers[i]->GetCallCount() ==
+            1 + inDurationMs / kIntervals[i]);
+    }
+    // Several wheel slots per step, less than the overrun threshold.
+    theTest.Advance(inDurationMs, 1000);
+    theTest.Advance(inDurationMs, 4000);
+    // Large overruns, all handlers are re-evaluated.
+    theTest.Advance(5000, 5000);
+    theTest.Advance(inDurationMs, 1);
+    theTest.Advance(3 * 3600 * 1000, 3600 * 1000);
+    theTest.Advance(inDurationMs, 1);
+
+    // Disable and re-enable between the steps.
+    TestHandler& theHandler = *theHandlers[5];
+    const int64_t theCount = theHandler.GetCallCount();
+    theHandler.Disable();
+    theEveryLoop.Disable();
+    const int64_t theEveryLoopCount = theEveryLoop.GetCallCount();
+    theTest.Advance(10000, 1);
+    CHECK(theHandler.GetCallCount() == theCount &&
+        theEveryLoop.GetCallCount() == theEveryLoopCount);
+    // Re-enabled handlers are due at the next run.
+    theHandler.SetInterval(kIntervals[5], theTest.Now() + 1);
+    theEveryLoop.SetInterval(0, theTest.Now() + 1);
+    theTest.Advance(10000, 1);
+    CHECK(theHandler.GetCallCount() == theCount + 10000 / kIntervals[5]);
+    CHECK(theEveryLoop.GetCallCount() == theEveryLoopCount + 10000);
+    // Longer and shorter intervals for the enabled handler, the time
+    // since the last invocation counts towards the new interval.
+    theHandler.SetInterval(20000, theTest.Now() + 1);
+    theTest.Advance(30000, 1);
+    theHandler.SetInterval(10, theTest.Now() + 1);
+    theTest.Advance(30000, 1);
+    // Disabled handler re-enabled from other handler's Timeout().
+    const int64_t theOtherCount = theOther.GetCallCount();
+    theOther.Disable();
+    theTest.Advance(10000, 1);
+    CHECK(theOtherCount < theOther.GetCallCount());
+    theTest.Advance(inDurationMs, 1);
+
+    theTest.GetNetManager().GetCounters(theCounters);
+    CHECK(theCounters.mTimeoutHandlerCallCount == theTest.GetCallCount());
+    CHECK(theCounters.mTimeoutHandlerCount == (int64_t)kIntervalsCount + 5);
+}
+
+// Intervals beyond the wheel range, the handlers are re-scheduled when the
+// top level slot expires.
+static void
+RunLongIntervalTest()
+{
+    TimeoutWheelTest theTest;
+    const int kFiveHoursMs = 5 * 3600 * 1000;
+    const int kSixHoursMs  = 6 * 3600 * 1000;
+    TestHandler& theFiveHours = theTest.Add(kFiveHoursMs);
+    TestHandler& theSixHours  = theTest.Add(kSixHoursMs);
+    theTest.Add(333);
+    theTest.Advance(13 * 3600 * 1000, 1000);
+    CHECK(theFiveHours.GetCallCount() == 3);
+    CHECK(theSixHours.GetCallCount() == 3);
+    theTest.Advance(13 * 3600 * 1000, 4000);
+    CHECK(theFiveHours.GetCallCount() == 6);
+    CHECK(theSixHours.GetCallCount() == 5);
+}
+
+int
+main(
+    int    inArgCount,
+    char** inArgsPtr)
+{
+    const int64_t theDurationMs =
+        1 < inArgCount ? atoi(inArgsPtr[1]) : 600 * 1000;
+    RunTest(theDurationMs);
+    RunLongIntervalTest();
+    if (sErrorCount == 0) {
+        cout << "Passed timeout handlers timer wheel test\n";
+        return 0;
+    }
+    cerr << "Timeout handlers timer wheel test failed, errors: " <<
+        sErrorCount << "\n";
+    return 1;
+}
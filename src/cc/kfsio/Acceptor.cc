@@ -30,6 +30,7 @@
 #include "qcdio/QCUtils.h"
 
 #include <stdlib.h>
+#include <unistd.h>
 
 namespace KFS
 {
@@ -43,6 +44,7 @@ Acceptor::Acceptor(
     IAcceptorOwner*       owner,
     bool                  bindOnlyFlag)
     : mLocation(location),
+      mLocalSocketPath(),
       mIpV6OnlyFlag(ipV6OnlyFlag),
       mAcceptorOwner(owner),
       mConn(),
@@ -61,6 +63,26 @@ Acceptor::Acceptor(
     IAcceptorOwner* owner,
     bool            bindOnlyFlag /* = false */)
     : mLocation(string(), port),
+      mLocalSocketPath(),
+      mIpV6OnlyFlag(false),
+      mAcceptorOwner(owner),
+      mConn(),
+      mNetManager(netManager)
+{
+    SET_HANDLER(this, &Acceptor::RecvConnection);
+    Acceptor::Bind();
+    if (! bindOnlyFlag) {
+        Acceptor::StartListening();
+    }
+}
+
+Acceptor::Acceptor(
+    NetManager&     netManager,
+    const string&   localSocketPath,
+    IAcceptorOwner* owner,
+    bool            bindOnlyFlag)
+    : mLocation(),
+      mLocalSocketPath(localSocketPath),
       mIpV6OnlyFlag(false),
       mAcceptorOwner(owner),
       mConn(),
@@ -78,9 +100,19 @@ Acceptor::~Acceptor()
     if (mConn) {
         mConn->Close();
         mConn.reset();
+        if (! mLocalSocketPath.empty()) {
+            unlink(mLocalSocketPath.c_str());
+        }
     }
 }
 
+string
+Acceptor::GetName() const
+{
+    return (mLocalSocketPath.empty() ?
+        mLocation.ToString() : "unix:" + mLocalSocketPath);
+}
+
 void
 Acceptor::Bind()
 {
@@ -92,21 +124,21 @@ Acceptor::Bind()
         mConn.reset();
     }
     TcpSocket* const sock = new TcpSocket();
-    const int res = sock->Bind(
+    const int res = mLocalSocketPath.empty() ? sock->Bind(
         mLocation,
         (mLocation.hostname.empty() && mIpV6OnlyFlag) ?
             TcpSocket::kTypeIpV6 : TcpSocket::kTypeIpV4,
         mIpV6OnlyFlag
-    );
+    ) : sock->BindLocal(mLocalSocketPath);
     if (res < 0) {
         KFS_LOG_STREAM_ERROR <<
-            "failed to bind to: " << mLocation <<
+            "failed to bind to: " << GetName() <<
             " error: " << QCUtils::SysError(-res) <<
         KFS_LOG_EOM;
         delete sock;
         return;
     }
-    if (mLocation.port == 0) {
+    if (mLocalSocketPath.empty() && mLocation.port == 0) {
         ServerLocation loc;
         const int err = sock->GetSockLocation(loc);
         if (err) {
@@ -154,7 +186,7 @@ Acceptor::RecvConnection(int code, void* data)
             // Under normal circumstances it would come up here only with the
             // error simulator enabled.
             KFS_LOG_STREAM_INFO <<
-                "acceptor on: " << mLocation <<
+                "acceptor on: " << GetName() <<
                 " error: " <<
                     QCUtils::SysError(mConn ? mConn->GetSocketError() : 0) <<
                 (mNetManager.IsRunning() ? ", restarting" : ", exiting") <<
@@ -168,7 +200,7 @@ Acceptor::RecvConnection(int code, void* data)
                 StartListening();
                 if (! IsAcceptorStarted()) {
                     KFS_LOG_STREAM_FATAL <<
-                        "failed to restart acceptor on: " << mLocation <<
+                        "failed to restart acceptor on: " << GetName() <<
                     KFS_LOG_EOM;
                     MsgLogger::Stop();
                     abort();
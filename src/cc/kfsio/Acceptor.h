@@ -93,6 +93,13 @@ public:
         bool                  ipV6OnlyFlag,
         IAcceptorOwner*       owner,
         bool                  bindOnlyFlag);
+    /// Listen on unix domain socket bound to the path specified. The socket
+    /// file is removed when the acceptor is destroyed.
+    Acceptor(
+        NetManager&     netManager,
+        const string&   localSocketPath,
+        IAcceptorOwner* owner,
+        bool            bindOnlyFlag);
     ~Acceptor();
     void StartListening();
 
@@ -112,6 +119,8 @@ public:
         { return mLocation.port; }
     const ServerLocation& GetLocation() const
         { return mLocation; }
+    const string& GetLocalSocketPath() const
+        { return mLocalSocketPath; }
     NetManager& GetNetManager()
         { return mNetManager; }
 private:
@@ -120,12 +129,14 @@ private:
     /// port on which the Acceptor is listening for connections.
     ///
     ServerLocation        mLocation;
+    string                mLocalSocketPath;
     bool                  mIpV6OnlyFlag;
     IAcceptorOwner* const mAcceptorOwner;
     NetConnectionPtr      mConn;
     NetManager&           mNetManager;
 
     void Bind();
+    string GetName() const;
 };
 
 }
@@ -38,6 +38,7 @@
 #include <openssl/rand.h>
 
 #include <string.h>
+#include <pthread.h>
 
 #include <ostream>
 #include <istream>
@@ -117,6 +118,320 @@ static inline ostream& operator << (
 
 };
 
+// Per thread cache of HMAC contexts initialized with the token keys. HMAC
+// re-initialization with the same key re-uses the precomputed inner and outer
+// key pad digest states, therefore the signature computation only hashes the
+// token fields, and the key setup and digest lookup are performed once per
+// key and thread. The cache also keeps recently verified tokens, as the same
+// token is typically presented with every chunk read and write request.
+class HmacCache
+{
+public:
+    typedef CryptoKeys::Key   Key;
+    typedef CryptoKeys::KeyId KeyId;
+#if OPENSSL_VERSION_NUMBER < 0x30000000L
+    typedef HMAC_CTX          Ctx;
+#else
+    typedef EVP_MAC_CTX       Ctx;
+#endif
+    enum { kMaxTokenLength   = 64 };
+    enum { kMaxSubjectLength = 32 };
+
+    class KeyCtx
+    {
+    public:
+        KeyCtx()
+            : mCtxPtr(0),
+              mKeyId(),
+              mKey(),
+              mGeneration(0),
+              mLastUsed(0)
+            {}
+        ~KeyCtx()
+            { Free(mCtxPtr); }
+        bool Matches(
+            KeyId       inKeyId,
+            const char* inKeyPtr) const
+        {
+            return (mCtxPtr && mKeyId == inKeyId &&
+                memcmp(mKey.GetPtr(), inKeyPtr, Key::kLength) == 0);
+        }
+        Ctx& GetCtx()
+            { return *mCtxPtr; }
+        uint64_t GetGeneration() const
+            { return mGeneration; }
+    private:
+        Ctx*     mCtxPtr;
+        KeyId    mKeyId;
+        Key      mKey;
+        uint64_t mGeneration;
+        uint64_t mLastUsed;
+
+        friend class HmacCache;
+    private:
+        KeyCtx(
+            const KeyCtx& inCtx);
+        KeyCtx& operator=(
+            const KeyCtx& inCtx);
+    };
+
+    static bool IsEnabled()
+        { return sEnabledFlag; }
+    static void SetEnabled(
+        bool inFlag)
+        { sEnabledFlag = inFlag; }
+    static HmacCache& Get()
+    {
+        const int theErr = pthread_once(&sKeyOnce, &HmacCache::CreateKey);
+        if (theErr) {
+            QCUtils::FatalError("pthread_once", theErr);
+        }
+        HmacCache* thePtr =
+            reinterpret_cast<HmacCache*>(pthread_getspecific(sKey));
+        if (! thePtr) {
+            thePtr = new HmacCache();
+            const int theErr = pthread_setspecific(sKey, thePtr);
+            if (theErr) {
+                QCUtils::FatalError("pthread_setspecific", theErr);
+            }
+        }
+        return *thePtr;
+    }
+    static Ctx* New()
+    {
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+        Ctx* const thePtr = new HMAC_CTX;
+        HMAC_CTX_init(thePtr);
+        return thePtr;
+#elif OPENSSL_VERSION_NUMBER < 0x30000000L
+        return HMAC_CTX_new();
+#else
+        EVP_MAC* const theMac = EVP_MAC_fetch(NULL, "HMAC", NULL);
+        QCRTASSERT(theMac);
+        Ctx* const thePtr = EVP_MAC_CTX_new(theMac);
+        EVP_MAC_free(theMac);
+        return thePtr;
+#endif
+    }
+    static void Free(
+        Ctx* inCtxPtr)
+    {
+        if (! inCtxPtr) {
+            return;
+        }
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+        HMAC_CTX_cleanup(inCtxPtr);
+        delete inCtxPtr;
+#elif OPENSSL_VERSION_NUMBER < 0x30000000L
+        HMAC_CTX_free(inCtxPtr);
+#else
+        EVP_MAC_CTX_free(inCtxPtr);
+#endif
+    }
+    // Null key pointer re-initializes context with the previously set key.
+    static bool Init(
+        Ctx&        inCtx,
+        const char* inKeyPtr,
+        int         inKeyLen)
+    {
+#if OPENSSL_VERSION_NUMBER < 0x1000000fL
+        if (inKeyPtr) {
+            HMAC_Init_ex(&inCtx, inKeyPtr, inKeyLen, EVP_sha1(), 0);
+        } else {
+            HMAC_Init_ex(&inCtx, 0, 0, 0, 0);
+        }
+        return true;
+#elif OPENSSL_VERSION_NUMBER < 0x30000000L
+        return (inKeyPtr ?
+            HMAC_Init_ex(&inCtx, inKeyPtr, inKeyLen, EVP_sha1(), 0) :
+            HMAC_Init_ex(&inCtx, 0, 0, 0, 0)) != 0;
+#else
+        if (! inKeyPtr) {
+            // Do not pass the digest parameter, in order to avoid digest
+            // fetch, and re-use the key pad states.
+            return (EVP_MAC_init(&inCtx, 0, 0, 0) != 0);
+        }
+        OSSL_PARAM theParams[2];
+        char theName[] = {"SHA1"};
+        theParams[0] = OSSL_PARAM_construct_utf8_string("digest", theName, 0);
+        theParams[1] = OSSL_PARAM_construct_end();
+        return (EVP_MAC_init(
+            &inCtx,
+            reinterpret_cast<const unsigned char*>(inKeyPtr), inKeyLen,
+            theParams) != 0);
+#endif
+    }
+    static bool Update(
+        Ctx&        inCtx,
+        const char* inPtr,
+        int         inLen)
+    {
+#if OPENSSL_VERSION_NUMBER < 0x1000000fL
+        HMAC_Update(&inCtx, reinterpret_cast<const unsigned char*>(inPtr),
+            inLen);
+        return true;
+#elif OPENSSL_VERSION_NUMBER < 0x30000000L
+        return (HMAC_Update(&inCtx,
+            reinterpret_cast<const unsigned char*>(inPtr), inLen) != 0);
+#else
+        return (EVP_MAC_update(&inCtx,
+            reinterpret_cast<const unsigned char*>(inPtr), inLen) != 0);
+#endif
+    }
+    static bool Final(
+        Ctx&  inCtx,
+        char* inSignBufPtr,
+        int   inMaxLen,
+        int&  outLen)
+    {
+#if OPENSSL_VERSION_NUMBER < 0x30000000L
+        unsigned int theLen = 0;
+        (void)inMaxLen;
+#   if OPENSSL_VERSION_NUMBER < 0x1000000fL
+        HMAC_Final(&inCtx, reinterpret_cast<unsigned char*>(inSignBufPtr),
+            &theLen);
+        const bool theRetFlag = true;
+#   else
+        const bool theRetFlag = HMAC_Final(&inCtx,
+            reinterpret_cast<unsigned char*>(inSignBufPtr), &theLen) != 0;
+#   endif
+#else
+        size_t theLen = 0;
+        const bool theRetFlag = EVP_MAC_final(&inCtx,
+            reinterpret_cast<unsigned char*>(inSignBufPtr), &theLen,
+            inMaxLen) != 0;
+#endif
+        outLen = (int)theLen;
+        return theRetFlag;
+    }
+    KeyCtx* Find(
+        KeyId       inKeyId,
+        const char* inKeyPtr)
+    {
+        KeyCtx* theLruPtr = mKeyCtx;
+        for (KeyCtx* thePtr = mKeyCtx; thePtr < mKeyCtx + kKeyCtxCount;
+                ++thePtr) {
+            if (thePtr->Matches(inKeyId, inKeyPtr)) {
+                thePtr->mLastUsed = ++mUseCount;
+                return thePtr;
+            }
+            if (thePtr->mLastUsed < theLruPtr->mLastUsed) {
+                theLruPtr = thePtr;
+            }
+        }
+        KeyCtx& theCtx = *theLruPtr;
+        theCtx.mGeneration = 0;
+        if (! theCtx.mCtxPtr && ! (theCtx.mCtxPtr = New())) {
+            return 0;
+        }
+        if (! Init(*theCtx.mCtxPtr, inKeyPtr, Key::kLength)) {
+            Free(theCtx.mCtxPtr);
+            theCtx.mCtxPtr = 0;
+            return 0;
+        }
+        theCtx.mKeyId      = inKeyId;
+        theCtx.mKey        = Key(inKeyPtr);
+        theCtx.mGeneration = ++mGeneration;
+        theCtx.mLastUsed   = ++mUseCount;
+        return &theCtx;
+    }
+    bool IsVerified(
+        const KeyCtx& inKeyCtx,
+        const char*   inTokenPtr,
+        int           inTokenLen,
+        const char*   inSubjectPtr,
+        int           inSubjectLen,
+        int64_t       inTimeNowSec) const
+    {
+        const VerifiedToken& theEntry =
+            mTokens[Index(inTokenPtr, inTokenLen)];
+        return (
+            theEntry.mKeyGeneration == inKeyCtx.GetGeneration() &&
+            inTimeNowSec <= theEntry.mExpirationTime &&
+            theEntry.mSubjectLen == inSubjectLen &&
+            memcmp(theEntry.mToken, inTokenPtr, inTokenLen) == 0 &&
+            (inSubjectLen <= 0 ||
+                memcmp(theEntry.mSubject, inSubjectPtr, inSubjectLen) == 0)
+        );
+    }
+    void SetVerified(
+        const KeyCtx& inKeyCtx,
+        const char*   inTokenPtr,
+        int           inTokenLen,
+        const char*   inSubjectPtr,
+        int           inSubjectLen,
+        int64_t       inExpirationTime)
+    {
+        VerifiedToken& theEntry = mTokens[Index(inTokenPtr, inTokenLen)];
+        theEntry.mKeyGeneration  = inKeyCtx.GetGeneration();
+        theEntry.mExpirationTime = inExpirationTime;
+        theEntry.mSubjectLen     = inSubjectLen;
+        memcpy(theEntry.mToken, inTokenPtr, inTokenLen);
+        if (0 < inSubjectLen) {
+            memcpy(theEntry.mSubject, inSubjectPtr, inSubjectLen);
+        }
+    }
+private:
+    enum { kKeyCtxCount = 4 };
+    enum { kTokenCount  = 256 };
+    struct VerifiedToken
+    {
+        VerifiedToken()
+            : mKeyGeneration(0),
+              mExpirationTime(0),
+              mSubjectLen(0)
+            {}
+        uint64_t mKeyGeneration;
+        int64_t  mExpirationTime;
+        int      mSubjectLen;
+        char     mToken[kMaxTokenLength];
+        char     mSubject[kMaxSubjectLength];
+    };
+
+    KeyCtx        mKeyCtx[kKeyCtxCount];
+    uint64_t      mGeneration;
+    uint64_t      mUseCount;
+    VerifiedToken mTokens[kTokenCount];
+
+    static bool           sEnabledFlag;
+    static pthread_once_t sKeyOnce;
+    static pthread_key_t  sKey;
+
+    HmacCache()
+        : mGeneration(0),
+          mUseCount(0)
+        {}
+    static size_t Index(
+        const char* inTokenPtr,
+        int         inTokenLen)
+    {
+        // The token ends with the signature, use its trailing bytes as hash.
+        const unsigned char* const thePtr =
+            reinterpret_cast<const unsigned char*>(inTokenPtr) + inTokenLen;
+        return ((size_t(thePtr[-1]) | (size_t(thePtr[-2]) << 8)) &
+            (kTokenCount - 1));
+    }
+    static void CreateKey()
+    {
+        const int theErr = pthread_key_create(&sKey, &HmacCache::Delete);
+        if (theErr) {
+            QCUtils::FatalError("pthread_key_create", theErr);
+        }
+    }
+    static void Delete(
+        void* inPtr)
+        { delete reinterpret_cast<HmacCache*>(inPtr); }
+private:
+    HmacCache(
+        const HmacCache& inCache);
+    HmacCache& operator=(
+        const HmacCache& inCache);
+};
+
+bool           HmacCache::sEnabledFlag = true;
+pthread_once_t HmacCache::sKeyOnce     = PTHREAD_ONCE_INIT;
+pthread_key_t  HmacCache::sKey;
+
 class DelegationToken::WorkBuf
 {
 public:
@@ -144,109 +459,52 @@ public:
         const char* theSubjectPtr = 0;
         const int   theSubjectLen = inSubjectPtr ?
             inSubjectPtr->Get(inToken, theSubjectPtr) : 0;
-#if OPENSSL_VERSION_NUMBER < 0x10100000L
-        HMAC_CTX theCtx;
-        HMAC_CTX_init(&theCtx);
-#elif OPENSSL_VERSION_NUMBER < 0x30000000L
-        HMAC_CTX& theCtx = *HMAC_CTX_new();
-#else
-        EVP_MAC* const theMac = EVP_MAC_fetch(NULL, "HMAC", NULL);
-        QCRTASSERT(theMac);
-        EVP_MAC_CTX&   theCtx = *EVP_MAC_CTX_new(theMac);
-        EVP_MAC_free(theMac);
-#endif
-#if OPENSSL_VERSION_NUMBER < 0x30000000L
-        unsigned int
-#else
-        size_t
-#endif
-        theLen = 0;
-#if OPENSSL_VERSION_NUMBER < 0x1000000fL
-        const bool theRetFlag = true;
-        HMAC_Init_ex(&theCtx, inKeyPtr, inKeyLen, EVP_sha1(), 0);
-        if (0 < theSubjectLen) {
-            HMAC_Update(
-                &theCtx,
-                reinterpret_cast<const unsigned char*>(theSubjectPtr),
-                theSubjectLen
-            );
+        HmacCache::KeyCtx* const theKeyCtxPtr =
+            (inKeyLen == CryptoKeys::Key::kLength && HmacCache::IsEnabled()) ?
+            HmacCache::Get().Find(inToken.GetKeyId(), inKeyPtr) : 0;
+        return Sign(theKeyCtxPtr, inKeyPtr, inKeyLen,
+            theSubjectPtr, theSubjectLen, inSignBufPtr, inErrMsgPtr);
+    }
+    bool Verify(
+        const DelegationToken& inToken,
+        const char*            inKeyPtr,
+        int                    inKeyLen,
+        Subject*               inSubjectPtr,
+        int64_t                inTimeNowSec,
+        string*                inErrMsgPtr)
+    {
+        QCASSERT((int)kTokenSize <= (int)HmacCache::kMaxTokenLength);
+        const char* theSubjectPtr = 0;
+        const int   theSubjectLen = inSubjectPtr ?
+            inSubjectPtr->Get(inToken, theSubjectPtr) : 0;
+        HmacCache* const         theCachePtr =
+            (inKeyLen == CryptoKeys::Key::kLength && HmacCache::IsEnabled() &&
+                theSubjectLen <= HmacCache::kMaxSubjectLength) ?
+            &HmacCache::Get() : 0;
+        HmacCache::KeyCtx* const theKeyCtxPtr = theCachePtr ?
+            theCachePtr->Find(inToken.GetKeyId(), inKeyPtr) : 0;
+        if (theKeyCtxPtr && theCachePtr->IsVerified(*theKeyCtxPtr,
+                mBuffer, kTokenSize, theSubjectPtr, theSubjectLen,
+                inTimeNowSec)) {
+            return true;
         }
-        HMAC_Update(
-            &theCtx,
-            reinterpret_cast<const unsigned char*>(mBuffer),
-            kTokenFiledsSize
-        );
-        HMAC_Final(
-            &theCtx,
-            reinterpret_cast<unsigned char*>(inSignBufPtr),
-            &theLen
-        );
-#elif OPENSSL_VERSION_NUMBER < 0x30000000L
-        const bool theRetFlag =
-            HMAC_Init_ex(&theCtx, inKeyPtr, inKeyLen, EVP_sha1(), 0) &&
-            (theSubjectLen <= 0 ||
-                HMAC_Update(
-                    &theCtx,
-                    reinterpret_cast<const unsigned char*>(theSubjectPtr),
-                    theSubjectLen
-                )) &&
-            HMAC_Update(
-                &theCtx,
-                reinterpret_cast<const unsigned char*>(mBuffer),
-                kTokenFiledsSize
-            ) &&
-            HMAC_Final(
-                &theCtx,
-                reinterpret_cast<unsigned char*>(inSignBufPtr),
-                &theLen
-            );
-#else
-        OSSL_PARAM theParams[2];
-        char theName[] = {"SHA1"};
-        theParams[0] = OSSL_PARAM_construct_utf8_string("digest", theName, 0);
-        theParams[1] = OSSL_PARAM_construct_end();
-
-        const bool theRetFlag =
-            EVP_MAC_init(
-                &theCtx,
-                reinterpret_cast<const unsigned char*>(inKeyPtr), inKeyLen,
-                theParams) &&
-            (theSubjectLen <= 0 ||
-                EVP_MAC_update(
-                    &theCtx,
-                    reinterpret_cast<const unsigned char*>(theSubjectPtr),
-                    theSubjectLen
-                )) &&
-            EVP_MAC_update(
-                &theCtx,
-                reinterpret_cast<const unsigned char*>(mBuffer),
-                kTokenFiledsSize
-            ) &&
-            EVP_MAC_final(
-                &theCtx,
-                reinterpret_cast<unsigned char*>(inSignBufPtr),
-                &theLen,
-                kSignatureLength
-            );
-#endif
-        if (! theRetFlag) {
+        char theSignature[kSignatureLength];
+        if (! Sign(theKeyCtxPtr, inKeyPtr, inKeyLen,
+                theSubjectPtr, theSubjectLen, theSignature, inErrMsgPtr)) {
+            return false;
+        }
+        if (memcmp(theSignature, inToken.mSignature, kSignatureLength) != 0) {
             if (inErrMsgPtr) {
-                EvpErrorStr("HMAC failure: ", inErrMsgPtr);
-            } else {
-                KFS_LOG_STREAM_ERROR <<
-                    "HMAC failure: " << EvpError() <<
-                KFS_LOG_EOM;
+                *inErrMsgPtr = "invalid signature";
             }
+            return false;
         }
-        QCRTASSERT(! theRetFlag || theLen == kSignatureLength);
-#if OPENSSL_VERSION_NUMBER < 0x10100000L
-        HMAC_CTX_cleanup(&theCtx);
-#elif OPENSSL_VERSION_NUMBER < 0x30000000L
-        HMAC_CTX_free(&theCtx);
-#else
-        EVP_MAC_CTX_free(&theCtx);
-#endif
-        return theRetFlag;
+        if (theKeyCtxPtr) {
+            theCachePtr->SetVerified(*theKeyCtxPtr,
+                mBuffer, kTokenSize, theSubjectPtr, theSubjectLen,
+                inToken.GetIssuedTime() + inToken.GetValidForSec());
+        }
+        return true;
     }
     void Serialize(
         const DelegationToken& inToken)
@@ -830,6 +1088,43 @@ public:
         }
         return 0;
     }
+private:
+    bool Sign(
+        HmacCache::KeyCtx* inKeyCtxPtr,
+        const char*        inKeyPtr,
+        int                inKeyLen,
+        const char*        inSubjectPtr,
+        int                inSubjectLen,
+        char*              inSignBufPtr,
+        string*            inErrMsgPtr)
+    {
+        HmacCache::Ctx* const theCtxPtr = inKeyCtxPtr ?
+            &inKeyCtxPtr->GetCtx() : HmacCache::New();
+        QCRTASSERT(theCtxPtr);
+        int        theLen     = 0;
+        const bool theRetFlag =
+            HmacCache::Init(*theCtxPtr,
+                inKeyCtxPtr ? 0 : inKeyPtr, inKeyLen) &&
+            (inSubjectLen <= 0 ||
+                HmacCache::Update(*theCtxPtr, inSubjectPtr, inSubjectLen)) &&
+            HmacCache::Update(*theCtxPtr, mBuffer, kTokenFiledsSize) &&
+            HmacCache::Final(
+                *theCtxPtr, inSignBufPtr, kSignatureLength, theLen);
+        if (! theRetFlag) {
+            if (inErrMsgPtr) {
+                EvpErrorStr("HMAC failure: ", inErrMsgPtr);
+            } else {
+                KFS_LOG_STREAM_ERROR <<
+                    "HMAC failure: " << EvpError() <<
+                KFS_LOG_EOM;
+            }
+        }
+        QCRTASSERT(! theRetFlag || theLen == kSignatureLength);
+        if (! inKeyCtxPtr) {
+            HmacCache::Free(theCtxPtr);
+        }
+        return theRetFlag;
+    }
 private:
     enum {
         kTokenFiledsSize =
@@ -1055,22 +1350,15 @@ DelegationToken::Process(
         }
         return -EINVAL;
     }
-    char theSignature[kSignatureLength];
-    if (! theBuf.Sign(
+    if (! theBuf.Verify(
             *this,
             theKey.GetPtr(),
             theKey.GetSize(),
             inSubjectPtr,
-            theSignature,
+            inTimeNowSec,
             outErrMsgPtr)) {
         return -EINVAL;
     }
-    if (memcmp(theSignature, mSignature, kSignatureLength) != 0) {
-        if (outErrMsgPtr) {
-            *outErrMsgPtr = "invalid signature";
-        }
-        return -EINVAL;
-    }
     return (inMaxSessionKeyLength <= 0 ? 0 : theBuf.MakeSessionKey(
         *this,
         theKey.GetPtr(),
@@ -1118,6 +1406,13 @@ DelegationToken::Validate(
     return (memcmp(mSignature, theSignBuf, kSignatureLength) == 0);
 }
 
+    /* static */ void
+DelegationToken::SetHmacCacheEnabled(
+    bool inFlag)
+{
+    HmacCache::SetEnabled(inFlag);
+}
+
     string
 DelegationToken::CalcSessionKey(
     const char*               inKeyPtr,
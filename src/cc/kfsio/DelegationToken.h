@@ -229,6 +229,10 @@ public:
             inSessionKeyKeyLen
         );
     }
+    // Per thread HMAC key contexts and verified tokens caches are enabled by
+    // default. Intended to be used at startup, for testing.
+    static void SetHmacCacheEnabled(
+        bool inFlag);
     static int DecryptSessionKeyFromString(
         const CryptoKeys& inKeys,
         const char*       inStrPtr,
@@ -44,6 +44,10 @@ struct Globals_t
     Counter ctrOpenDiskFds;
     Counter ctrNetBytesRead;
     Counter ctrNetBytesWritten;
+    // TLS sessions and bytes with kernel TLS offload.
+    Counter ctrNetKtlsSessions;
+    Counter ctrNetKtlsBytesRead;
+    Counter ctrNetKtlsBytesWritten;
     Counter ctrDiskBytesRead;
     Counter ctrDiskBytesWritten;
     // track the # of failed read/writes
@@ -30,9 +30,7 @@
 
 #include "IOBuffer.h"
 #include "Globals.h"
-
-#include "qcdio/QCMutex.h"
-#include "qcdio/qcstutils.h"
+#include "common/MemoryAccounting.h"
 
 #include <sys/types.h>
 #include <sys/uio.h>
@@ -75,104 +73,36 @@ DoRead(const char* buf, bool startFlag)
     }
 }
 
-class IOBufferDetacher
+// The buffers owned by IOBufferData are accounted to io buffers memory
+// subsystem: the buffers are added by Init(), and removed by the deleters,
+// or by DetachBuffer().
+inline static void
+AccountBuffer(size_t size, int count)
 {
-public:
-    static char* Detach(IOBufferData::IOBufferBlockPtr& data)
-    {
-        if (! data.unique()) {
-            return 0;
-        }
-        char* const dbuf = data.get();
-        if (! dbuf) {
-            return dbuf;
-        }
-        const void* buf = dbuf;
-        sInstance.DetachSelf(buf);
-        data.reset();
-        if (buf) {
-            // Deleter must be different, than one of supported deleters. There
-            // is no way to recover from this failure, as is isn't possible to
-            // determine deleter type when arbitrary deleter is used. Non
-            // default deleter must implement required detach logic, if needed.
-            //
-            // The alternative is to check whether or not one of the supported
-            // deleters is used prior to data.reset() invocation, and possibly
-            // maintain deleter instance "do not delte" flag, insteadof using
-            // global do not delete list, at the price of deleter instance size
-            // increase.
-            // The alternative approach doesn't seem to be warranted given the
-            // overhead, and rather rare / uncommon use of this functionality..
-            abort();
-        }
-        return dbuf;
-    };
-    static bool Detached(const void* buf)
-        { return sInstance.DetachedSelf(buf); }
-private:
-    IOBufferDetacher()
-        : mMutex(),
-          mList(),
-          mHasEntriesFlag(false)
-        { mList.reserve(128); }
-    void DetachSelf(const void*& buf)
-    {
-        QCStMutexLocker lock(mMutex);
-        // Do not assign, uless the value changes, as store might not be atomic.
-        if (! mHasEntriesFlag) {
-            mHasEntriesFlag = true;
-        }
-        mList.push_back(&buf);
-    }
-    bool DetachedSelf(const void* buf)
-    {
-        // Flag fetch should not present a problem as Detach and Detached must
-        // be invoked from the same thread with the same buffer.
-        if (mHasEntriesFlag) {
-            QCStMutexLocker lock(mMutex);
-            List::iterator it;
-            for (it = mList.begin(); it != mList.end() && **it != buf; ++it)
-                {}
-            if (it != mList.end()) {
-                **it = 0;
-                mList.erase(it);
-                if (mList.empty()) {
-                    mHasEntriesFlag = false;
-                }
-                return true;
-            }
-        }
-        return false;
-    }
-private:
-    typedef vector<const void**> List;
-
-    QCMutex       mMutex;
-    List          mList;
-    volatile bool mHasEntriesFlag;
-
-    static IOBufferDetacher sInstance;
-};
-IOBufferDetacher IOBufferDetacher::sInstance;
+    MemoryAccounting::Update(MemoryAccounting::kSubsystemIOBuffers,
+        count * (int64_t)size, count);
+}
 
 struct IOBufferArrayDeallocator
 {
+    IOBufferArrayDeallocator(
+        size_t size)
+        : mSize(size)
+        {}
     void operator()(char* buf)
     {
-        if (IOBufferDetacher::Detached(buf)) {
-            return;
-        }
+        AccountBuffer(mSize, -1);
         delete [] buf;
     }
+private:
+    size_t mSize;
 };
 
 struct IOBufferDeallocator
 {
     void operator()(char* buf)
     {
-        if (IOBufferDetacher::Detached(buf)) {
-            return;
-        }
+        AccountBuffer(sIOBufferAllocator->GetBufferSize(), -1);
         sIOBufferAllocator->Deallocate(buf);
     }
 };
@@ -185,9 +115,7 @@ struct IOBufferDeallocatorCustom
         {}
     void operator()(char* buf)
     {
-        if (IOBufferDetacher::Detached(buf)) {
-            return;
-        }
+        AccountBuffer(mAllocator.GetBufferSize(), -1);
         mAllocator.Deallocate(buf);
     }
 private:
@@ -233,7 +161,9 @@ IOBufferData::Init(char* buf, IOBufferData::BufPos bufSize)
     if (size <= 0 && ! buf) {
         mData.reset();
     } else {
-        mData.reset(buf ? buf : new char [size], IOBufferArrayDeallocator());
+        mData.reset(buf ? buf : new char [size],
+            IOBufferArrayDeallocator(size));
+        AccountBuffer(size, 1);
     }
     mProducer = mData.get();
     mEnd      = mProducer + size;
@@ -257,6 +187,7 @@ IOBufferData::Init(char* buf, libkfsio::IOBufferAllocator& allocator)
     if (! (mProducer = mData.get())) {
         abort();
     }
+    AccountBuffer(allocator.GetBufferSize(), 1);
     mEnd      = mProducer + allocator.GetBufferSize();
     mConsumer = mProducer;
 }
@@ -467,8 +398,9 @@ IOBufferData::DetachBuffer(bool consumerAtBufferStartFlag)
     if (consumerAtBufferStartFlag && mData.get() != mConsumer) {
         return 0;
     }
-    char* const buf = IOBufferDetacher::Detach(mData);
+    char* const buf = mData.Detach();
     if (buf) {
+        AccountBuffer(mEnd - buf, -1);
         mEnd      = 0;
         mConsumer = 0;
         mProducer = 0;
@@ -1707,7 +1639,7 @@ IOBuffer::MakeBuffersFull()
     }
     // Move write data to the start of the buffers, to make it aligned.
     BList buf;
-    buf.swap(mBuf);
+    buf.splice(buf.end(), mBuf);
     while (! buf.empty()) {
         IOBufferData& s  = buf.front();
         const BufPos nb = s.BytesConsumable();
@@ -33,11 +33,13 @@
 
 #include "common/DisplayData.h"
 #include "common/StdAllocator.h"
+#include "common/kfsatomic.h"
 
 #include <stdint.h>
 #include <stdio.h>
 
 #include <list>
+#include <new>
 #include <streambuf>
 #include <ostream>
 #include <istream>
@@ -99,6 +101,185 @@ public:
 bool SetIOBufferVerifier(IOBufferVerifier* verifier);
 } // namespace libkfsio
 
+///
+/// \class IOBufferBlockPtr
+/// \brief Reference counted data block pointer, with shared_ptr like
+/// interface.
+/// The reference count and deleter are kept in small control block allocated
+/// from the pool. Buffers are routinely handed over between network, disk io,
+/// and client threads, therefore the reference count is atomic. The last
+/// owner, however, does not need atomic decrement: once the count is 1, no
+/// other thread can possibly obtain a reference. This makes release of non
+/// shared blocks, by far the most common case, free of atomic read modify
+/// write operations.
+class IOBufferBlockPtr
+{
+private:
+    class Block
+    {
+    public:
+        char* Get() const
+            { return mPtr; }
+        void Ref()
+            { SyncAddAndFetch(mRefCount, 1); }
+        void Unref()
+        {
+            if (IsUnique() || SyncAddAndFetch(mRefCount, -1) <= 0) {
+                Dispose();
+            }
+        }
+        bool IsUnique() const
+        {
+#ifdef __ATOMIC_ACQUIRE
+            return (__atomic_load_n(&mRefCount, __ATOMIC_ACQUIRE) == 1);
+#else
+            return (mRefCount == 1);
+#endif
+        }
+        // Invoke deleter and release the block.
+        virtual void Dispose() = 0;
+        // Release the block without invoking deleter.
+        virtual void Destroy() = 0;
+    protected:
+        Block(
+            char* ptr)
+            : mPtr(ptr),
+              mRefCount(1)
+            {}
+        virtual ~Block()
+            {}
+    private:
+        char* const  mPtr;
+        volatile int mRefCount;
+    private:
+        Block(const Block&);
+        Block& operator=(const Block&);
+    };
+    template<typename T>
+    class BlockT : public Block
+    {
+    public:
+        typedef StdFastAllocator<BlockT> Allocator;
+
+        static Block* Create(
+            char* ptr,
+            T     deleter)
+            { return new (Allocator().allocate(1)) BlockT(ptr, deleter); }
+        virtual void Dispose()
+        {
+            char* const ptr = Get();
+            T           deleter(mDeleter);
+            Destroy();
+            deleter(ptr);
+        }
+        virtual void Destroy()
+        {
+            this->~BlockT();
+            Allocator().deallocate(this, 1);
+        }
+    private:
+        T mDeleter;
+
+        BlockT(
+            char* ptr,
+            T     deleter)
+            : Block(ptr),
+              mDeleter(deleter)
+            {}
+        virtual ~BlockT()
+            {}
+    };
+public:
+    IOBufferBlockPtr()
+        : mBlock(0)
+        {}
+    template<typename T>
+    IOBufferBlockPtr(
+        char* ptr,
+        T     deleter)
+        : mBlock(ptr ? BlockT<T>::Create(ptr, deleter) : 0)
+        {}
+    IOBufferBlockPtr(
+        const IOBufferBlockPtr& other)
+        : mBlock(other.mBlock)
+    {
+        if (mBlock) {
+            mBlock->Ref();
+        }
+    }
+#if __cplusplus >= 201103L
+    IOBufferBlockPtr(
+        IOBufferBlockPtr&& other)
+        : mBlock(other.mBlock)
+        { other.mBlock = 0; }
+    IOBufferBlockPtr& operator=(
+        IOBufferBlockPtr&& other)
+    {
+        swap(other);
+        return *this;
+    }
+#endif
+    ~IOBufferBlockPtr()
+    {
+        if (mBlock) {
+            mBlock->Unref();
+        }
+    }
+    IOBufferBlockPtr& operator=(
+        const IOBufferBlockPtr& other)
+    {
+        if (other.mBlock) {
+            other.mBlock->Ref();
+        }
+        Block* const prev = mBlock;
+        mBlock = other.mBlock;
+        if (prev) {
+            prev->Unref();
+        }
+        return *this;
+    }
+    void swap(
+        IOBufferBlockPtr& other)
+    {
+        Block* const tmp = mBlock;
+        mBlock = other.mBlock;
+        other.mBlock = tmp;
+    }
+    void reset()
+    {
+        if (mBlock) {
+            mBlock->Unref();
+            mBlock = 0;
+        }
+    }
+    template<typename T>
+    void reset(
+        char* ptr,
+        T     deleter)
+    {
+        IOBufferBlockPtr tmp(ptr, deleter);
+        swap(tmp);
+    }
+    char* get() const
+        { return (mBlock ? mBlock->Get() : 0); }
+    bool unique() const
+        { return (mBlock && mBlock->IsUnique()); }
+    /// Release ownership of non shared data block without invoking deleter.
+    /// Returns 0 if the block is shared.
+    char* Detach()
+    {
+        if (! unique()) {
+            return 0;
+        }
+        char* const ret = mBlock->Get();
+        mBlock->Destroy();
+        mBlock = 0;
+        return ret;
+    }
+private:
+    Block* mBlock;
+};
+
 ///
 /// \class IOBufferData
 /// \brief An IOBufferData contains a buffer and associated
@@ -108,7 +289,7 @@ class IOBufferData
 public:
     typedef int64_t BufPos;
     /// Data buffer that is ref-counted for sharing.
-    typedef shared_ptr<char> IOBufferBlockPtr;
+    typedef KFS::IOBufferBlockPtr IOBufferBlockPtr;
 
     IOBufferData();
     IOBufferData(BufPos bufsz);
@@ -123,6 +304,12 @@ public:
     /// that are passed in
     IOBufferData(const IOBufferData &other, char *s, char *e, char* p = 0);
     ~IOBufferData();
+#if __cplusplus >= 201103L
+    IOBufferData(const IOBufferData&) = default;
+    IOBufferData& operator=(const IOBufferData&) = default;
+    IOBufferData(IOBufferData&&) = default;
+    IOBufferData& operator=(IOBufferData&&) = default;
+#endif
 
     ///
     /// Read data from file descriptor into the buffer.
@@ -253,10 +440,306 @@ private:
 class IOBuffer
 {
 private:
-    typedef list<
-        IOBufferData,
-        StdFastAllocator<IOBufferData>
-    > BList;
+    /// Buffer fragment list: doubly linked list with std::list like
+    /// interface, with the first kInlineNodeCount nodes embedded into the
+    /// list itself. The nodes beyond that are allocated from the pool.
+    /// Short buffers, like rpc requests headers and responses, thus do not
+    /// incur list node allocation. Like with std::list, insert, erase, and
+    /// splice do not invalidate iterators and references to the other list
+    /// elements. Unlike std::list, splice of the element in the embedded node
+    /// moves the element into a new node, and invalidates iterators and
+    /// references to the spliced element. Therefore IOBuffer iterators
+    /// must not be used after the elements are moved into another IOBuffer
+    /// by Move(), Append(), Replace(), etc. Splice moves at most
+    /// kInlineNodeCount elements, and relinks the remaining nodes, splice of
+    /// the whole list is O(1).
+    class BList
+    {
+    private:
+        enum { kInlineNodeCount = 2 };
+        struct NodeBase
+        {
+            NodeBase* mPrevPtr;
+            NodeBase* mNextPtr;
+        };
+        struct Node : public NodeBase
+        {
+            union
+            {
+                char    mStorage[sizeof(IOBufferData)];
+                void*   mAlignPtr;
+                int64_t mAlign;
+            };
+            IOBufferData& Get()
+                { return *reinterpret_cast<IOBufferData*>(mStorage); }
+        };
+        typedef StdFastAllocator<Node> Allocator;
+    public:
+        class const_iterator
+        {
+        public:
+            const_iterator()
+                : mNodePtr(0)
+                {}
+            const IOBufferData& operator*() const
+                { return static_cast<Node*>(mNodePtr)->Get(); }
+            const IOBufferData* operator->() const
+                { return &static_cast<Node*>(mNodePtr)->Get(); }
+            const_iterator& operator++()
+            {
+                mNodePtr = mNodePtr->mNextPtr;
+                return *this;
+            }
+            const_iterator operator++(int)
+            {
+                const_iterator const ret(*this);
+                mNodePtr = mNodePtr->mNextPtr;
+                return ret;
+            }
+            const_iterator& operator--()
+            {
+                mNodePtr = mNodePtr->mPrevPtr;
+                return *this;
+            }
+            const_iterator operator--(int)
+            {
+                const_iterator const ret(*this);
+                mNodePtr = mNodePtr->mPrevPtr;
+                return ret;
+            }
+            bool operator==(const const_iterator& other) const
+                { return (mNodePtr == other.mNodePtr); }
+            bool operator!=(const const_iterator& other) const
+                { return (mNodePtr != other.mNodePtr); }
+        protected:
+            NodeBase* mNodePtr;
+
+            explicit const_iterator(NodeBase* node)
+                : mNodePtr(node)
+                {}
+            friend class BList;
+        };
+        class iterator : public const_iterator
+        {
+        public:
+            iterator()
+                : const_iterator()
+                {}
+            IOBufferData& operator*() const
+                { return static_cast<Node*>(mNodePtr)->Get(); }
+            IOBufferData* operator->() const
+                { return &static_cast<Node*>(mNodePtr)->Get(); }
+            iterator& operator++()
+            {
+                mNodePtr = mNodePtr->mNextPtr;
+                return *this;
+            }
+            iterator operator++(int)
+            {
+                iterator const ret(*this);
+                mNodePtr = mNodePtr->mNextPtr;
+                return ret;
+            }
+            iterator& operator--()
+            {
+                mNodePtr = mNodePtr->mPrevPtr;
+                return *this;
+            }
+            iterator operator--(int)
+            {
+                iterator const ret(*this);
+                mNodePtr = mNodePtr->mPrevPtr;
+                return ret;
+            }
+        private:
+            explicit iterator(NodeBase* node)
+                : const_iterator(node)
+                {}
+            friend class BList;
+        };
+
+        BList()
+            : mHead(),
+              mInlineFree(kInlineAllFree)
+        {
+            mHead.mPrevPtr = &mHead;
+            mHead.mNextPtr = &mHead;
+        }
+        ~BList()
+            { clear(); }
+        bool empty() const
+            { return (mHead.mNextPtr == &mHead); }
+        iterator begin()
+            { return iterator(mHead.mNextPtr); }
+        iterator end()
+            { return iterator(&mHead); }
+        const_iterator begin() const
+            { return const_iterator(mHead.mNextPtr); }
+        const_iterator end() const
+            { return const_iterator(const_cast<NodeBase*>(&mHead)); }
+        IOBufferData& front()
+            { return static_cast<Node*>(mHead.mNextPtr)->Get(); }
+        IOBufferData& back()
+            { return static_cast<Node*>(mHead.mPrevPtr)->Get(); }
+        const IOBufferData& front() const
+            { return static_cast<Node*>(mHead.mNextPtr)->Get(); }
+        const IOBufferData& back() const
+            { return static_cast<Node*>(mHead.mPrevPtr)->Get(); }
+        iterator insert(iterator pos, const IOBufferData& data)
+        {
+            Node* const node = AllocateNode();
+            new (node->mStorage) IOBufferData(data);
+            Link(pos.mNodePtr, node);
+            return iterator(node);
+        }
+        void push_back(const IOBufferData& data)
+            { insert(end(), data); }
+#if __cplusplus >= 201103L
+        iterator insert(iterator pos, IOBufferData&& data)
+        {
+            Node* const node = AllocateNode();
+            new (node->mStorage) IOBufferData(
+                static_cast<IOBufferData&&>(data));
+            Link(pos.mNodePtr, node);
+            return iterator(node);
+        }
+        void push_back(IOBufferData&& data)
+            { insert(end(), static_cast<IOBufferData&&>(data)); }
+#endif
+        iterator erase(iterator pos)
+        {
+            NodeBase* const next = pos.mNodePtr->mNextPtr;
+            Unlink(pos.mNodePtr);
+            DeallocateNode(static_cast<Node*>(pos.mNodePtr));
+            return iterator(next);
+        }
+        iterator erase(iterator first, iterator last)
+        {
+            while (first != last) {
+                first = erase(first);
+            }
+            return last;
+        }
+        void pop_front()
+            { erase(begin()); }
+        void pop_back()
+            { erase(iterator(mHead.mPrevPtr)); }
+        void clear()
+            { erase(begin(), end()); }
+        void splice(iterator pos, BList& other, iterator it)
+        {
+            iterator last = it;
+            splice(pos, other, it, ++last);
+        }
+        void splice(iterator pos, BList& other, iterator first, iterator last)
+        {
+            if (first == last || pos == first || pos == last) {
+                return;
+            }
+            NodeBase* const prev = first.mNodePtr->mPrevPtr;
+            if (&other != this &&
+                    other.mInlineFree != (unsigned int)kInlineAllFree) {
+                // Replace the other list's embedded nodes in the range with
+                // the nodes of this list, then relink the range.
+                NodeBase* node = first.mNodePtr;
+                while (node != last.mNodePtr) {
+                    NodeBase* const next = node->mNextPtr;
+                    if (other.IsInline(node)) {
+                        other.ReplaceNode(static_cast<Node*>(node),
+                            AllocateNode());
+                    }
+                    node = next;
+                }
+            }
+            Relink(pos.mNodePtr, prev->mNextPtr, last.mNodePtr->mPrevPtr);
+        }
+        void splice(iterator pos, BList& other)
+        {
+            if (&other == this || other.empty()) {
+                return;
+            }
+            // At most kInlineNodeCount elements are moved, the remaining
+            // nodes are relinked.
+            for (int i = 0; i < kInlineNodeCount; i++) {
+                if ((other.mInlineFree & (1u << i)) == 0) {
+                    other.ReplaceNode(other.mInline + i, AllocateNode());
+                }
+            }
+            Relink(pos.mNodePtr, other.mHead.mNextPtr, other.mHead.mPrevPtr);
+        }
+    private:
+        enum { kInlineAllFree = (1u << kInlineNodeCount) - 1 };
+
+        NodeBase     mHead;
+        unsigned int mInlineFree;
+        Node         mInline[kInlineNodeCount];
+
+        static void Link(NodeBase* pos, NodeBase* node)
+        {
+            node->mPrevPtr = pos->mPrevPtr;
+            node->mNextPtr = pos;
+            pos->mPrevPtr->mNextPtr = node;
+            pos->mPrevPtr = node;
+        }
+        static void Unlink(NodeBase* node)
+        {
+            node->mPrevPtr->mNextPtr = node->mNextPtr;
+            node->mNextPtr->mPrevPtr = node->mPrevPtr;
+        }
+        // Move node chain [first, last] before pos.
+        static void Relink(NodeBase* pos, NodeBase* first, NodeBase* last)
+        {
+            first->mPrevPtr->mNextPtr = last->mNextPtr;
+            last->mNextPtr->mPrevPtr = first->mPrevPtr;
+            first->mPrevPtr = pos->mPrevPtr;
+            last->mNextPtr  = pos;
+            pos->mPrevPtr->mNextPtr = first;
+            pos->mPrevPtr = last;
+        }
+        // Move the element into the node allocated by another list, and
+        // replace the node in this list with it.
+        void ReplaceNode(Node* node, Node* dst)
+        {
+#if __cplusplus >= 201103L
+            new (dst->mStorage) IOBufferData(
+                static_cast<IOBufferData&&>(node->Get()));
+#else
+            new (dst->mStorage) IOBufferData(node->Get());
+#endif
+            dst->mPrevPtr = node->mPrevPtr;
+            dst->mNextPtr = node->mNextPtr;
+            node->mPrevPtr->mNextPtr = dst;
+            node->mNextPtr->mPrevPtr = dst;
+            DeallocateNode(node);
+        }
+        bool IsInline(const NodeBase* node) const
+        {
+            return ((uintptr_t)node - (uintptr_t)mInline <
+                (uintptr_t)sizeof(mInline));
+        }
+        Node* AllocateNode()
+        {
+            for (int i = 0; mInlineFree != 0 && i < kInlineNodeCount; i++) {
+                if ((mInlineFree & (1u << i)) != 0) {
+                    mInlineFree &= ~(1u << i);
+                    return (mInline + i);
+                }
+            }
+            return Allocator().allocate(1);
+        }
+        void DeallocateNode(Node* node)
+        {
+            node->Get().~IOBufferData();
+            if (IsInline(node)) {
+                mInlineFree |= 1u << (node - mInline);
+            } else {
+                Allocator().deallocate(node, 1);
+            }
+        }
+    private:
+        BList(const BList&);
+        BList& operator=(const BList&);
+    };
 public:
     typedef IOBufferData::BufPos BufPos;
     typedef BList::const_iterator iterator;
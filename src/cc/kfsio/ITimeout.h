@@ -36,6 +36,8 @@
 namespace KFS
 {
 
+class NetManager;
+
 ///
 /// \file ITimeout.h
 /// \brief Define the ITimeout interface.
@@ -52,11 +54,21 @@ namespace KFS
 /// There is no guarantee that the desired interval will hold between
 /// successive invocations of Timeout().
 ///
+/// Once registered, the timer is kept by the net manager in a timer wheel
+/// keyed by the next expiration time, and therefore the timer interval and
+/// enabled state must only be changed from the net manager's thread, or with
+/// the net manager's event loop mutex held, or while the event loop is not
+/// running. SetTimeoutInterval() asserts this in debug builds.
+/// Disable() and ResetTimer() do not re-schedule the timer, the net manager
+/// re-evaluates the timer at its previously scheduled expiration time.
+///
 class ITimeout
 {
 public:
     ITimeout()
-        : mIntervalMs(0), mDisabled(false), mLastCall(0)
+        : mIntervalMs(0), mDisabled(false), mLastCall(0),
+          mTimeoutNetManagerPtr(0), mTimeoutListIdx(-1),
+          mTimeoutExpireMs(0)
         {  List::Init(*this); }
     virtual ~ITimeout() { assert(! List::IsInList(*this)); }
     void Disable() {
@@ -70,6 +82,9 @@ public:
         if (resetTimer) {
             ResetTimer();
         }
+        if (mTimeoutNetManagerPtr) {
+            Reschedule();
+        }
     }
     int GetTimeElapsed() {
         return (NowMs() - mLastCall);
@@ -101,9 +116,14 @@ protected:
     bool      mDisabled;
 private:
     typedef QCDLListOp<ITimeout> List;
-    int64_t   mLastCall;
-    ITimeout* mPrevPtr[1];
-    ITimeout* mNextPtr[1];
+    int64_t     mLastCall;
+    NetManager* mTimeoutNetManagerPtr;
+    int         mTimeoutListIdx;
+    int64_t     mTimeoutExpireMs;
+    ITimeout*   mPrevPtr[1];
+    ITimeout*   mNextPtr[1];
+
+    void Reschedule();
 
     friend class NetManager;
     friend class QCDLListOp<ITimeout>;
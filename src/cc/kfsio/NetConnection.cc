@@ -27,12 +27,14 @@
 
 #include "Globals.h"
 #include "NetConnection.h"
+#include "NetManager.h"
 #include "common/kfsdecls.h"
 #include "common/MsgLogger.h"
 #include "qcdio/QCUtils.h"
 
 #include <cerrno>
 #include <time.h>
+#include <sys/stat.h>
 
 namespace KFS
 {
@@ -92,6 +94,28 @@ NetConnection::Connect(
     return ret;
 }
 
+int
+NetConnection::ConnectLocal(const ServerLocation& loc, bool nonBlockingFlag)
+{
+    const NetManager* const netManager = mNetManagerEntry.GetNetManager();
+    if (! netManager || netManager->GetLocalSocketDir().empty() ||
+            ! TcpSocket::IsLocalIpAddress(loc.hostname.c_str())) {
+        return -ENOENT;
+    }
+    const string path = TcpSocket::GetLocalSocketPath(
+        netManager->GetLocalSocketDir(), loc.port);
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || ! S_ISSOCK(st.st_mode)) {
+        return -ENOENT;
+    }
+    const int res = mSock->ConnectLocal(path, nonBlockingFlag);
+    NET_CONNECTION_LOG_STREAM_DEBUG <<
+        "connect: " << loc << " via: " << path <<
+        " status: " << res <<
+    KFS_LOG_EOM;
+    return res;
+}
+
 void
 NetConnection::NameResolutionDone(const ServerLocation& loc,
     int status, const char* errMsg)
@@ -121,7 +145,10 @@ NetConnection::NameResolutionDone(const ServerLocation& loc,
             mCallbackObj->HandleEvent(EVENT_NET_ERROR, &status);
         } else {
             const bool nonBlockingFlag = true;
-            int        res             = mSock->Connect(loc, nonBlockingFlag);
+            int        res             = ConnectLocal(loc, nonBlockingFlag);
+            if (0 != res && -EINPROGRESS != res) {
+                res = mSock->Connect(loc, nonBlockingFlag);
+            }
             if (0 != res && -EINPROGRESS != res) {
                 mLastError = res;
                 Close();
@@ -253,6 +253,11 @@ public:
         return (mSock && mSock->IsGood());
     }
 
+    /// Is connected through unix domain socket?
+    bool IsLocal() const {
+        return (IsConnected() && mSock->IsLocal());
+    }
+
     string GetPeerName() const {
         if (IsGood()) {
             if (IsNameResolutionPending()) {
@@ -352,6 +357,10 @@ public:
         return (mSock ? mSock->GetSocketError() : 0);
     }
 
+    int GetIncomingCpu() const {
+        return (mSock ? mSock->GetIncomingCpu() : -1);
+    }
+
     /// Close the connection.
     void Close(bool clearOutBufferFlag = true) {
         if (mFilter) {
@@ -486,6 +495,7 @@ public:
         bool IsPendingClose() const       { return mPendingCloseFlag; }
         bool IsNameResolutionPending() const
             { return mPendingNameResolutionFlag; }
+        NetManager* GetNetManager() const { return mNetManager; }
         time_t TimeNow() const;
 
     private:
@@ -584,6 +594,7 @@ private:
 
     void NameResolutionDone(const ServerLocation& loc,
         int status, const char* errMsg);
+    int ConnectLocal(const ServerLocation& loc, bool nonBlockingFlag);
 private:
     // No copies.
     NetConnection(const NetConnection&);
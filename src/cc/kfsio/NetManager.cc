@@ -123,7 +123,11 @@ NetManager::NetManager(int timeoutMs)
       mMaxAcceptsPerRead(1),
       mResolverCacheSize(8 << 10),
       mResolverCacheExpiration(-1),
+      mResolverNegativeCacheExpiration(-1),
+      mResolverCacheRefreshAhead(-1),
+      mResolverThreadCount(1),
       mResolverOsFlag(false),
+      mLocalSocketDir(),
       mPoll(*(new QCFdPoll(true))), // Wakeable
       mPollEventHook(0),
       mResolver(0),
@@ -131,9 +135,18 @@ NetManager::NetManager(int timeoutMs)
       mPendingReadList(),
       mPendingUpdate(),
       mCurTimeoutHandler(0),
+      mTimeoutWheelMs(mNowUsec / 1000),
+      mTimeoutWheelCount(0),
+      mCounters(),
+      mMainLoopMutex(0),
+      mMainLoopThread(),
+      mMainLoopRunningFlag(false),
       mEpollError()
 {
-    TimeoutHandlers::Init(mTimeoutHandlers);
+    mCounters.Clear();
+    for (int i = 0; i < kTimeoutListCount; i++) {
+        TimeoutHandlers::Init(mTimeoutLists[i]);
+    }
     mPendingUpdate.reserve(1 << 10);
 }
 
@@ -216,6 +229,8 @@ NetManager::EnqueueSelf(Resolver::Request& req, int timeout)
             Resolver::ResolverTypeOs : Resolver::ResolverTypeExt);
         mResolver->SetCacheSizeAndTimeout(
             mResolverCacheSize, mResolverCacheExpiration);
+        mResolver->SetParameters(mResolverNegativeCacheExpiration,
+            mResolverCacheRefreshAhead, mResolverThreadCount);
         const int status = mResolver->Start();
         if (0 != status) {
             delete mResolver;
@@ -247,27 +262,251 @@ NetManager::SetResolverParameters(bool useOsResolverFlag,
     }
 }
 
+void
+NetManager::SetResolverCacheParameters(int negativeCacheExpiration,
+    int cacheRefreshAhead, int threadCount)
+{
+    mResolverNegativeCacheExpiration = negativeCacheExpiration;
+    mResolverCacheRefreshAhead       = cacheRefreshAhead;
+    mResolverThreadCount             = threadCount;
+    for (int i = 0; i < 2; i++) {
+        Resolver* const resolver = 0 == i ? mResolver : mResolverPrev;
+        if (resolver) {
+            resolver->SetParameters(mResolverNegativeCacheExpiration,
+                mResolverCacheRefreshAhead, mResolverThreadCount);
+        }
+    }
+}
+
+void
+NetManager::GetResolverCounters(Resolver::Counters& counters) const
+{
+    counters.Clear();
+    for (int i = 0; i < 2; i++) {
+        Resolver* const resolver = 0 == i ? mResolver : mResolverPrev;
+        if (resolver) {
+            Resolver::Counters cntrs;
+            resolver->GetCounters(cntrs);
+            counters.Add(cntrs);
+        }
+    }
+}
+
 void
 NetManager::RegisterTimeoutHandler(ITimeout* handler)
 {
-    if (handler) {
-        TimeoutHandlers::PushBack(mTimeoutHandlers, *handler);
+    if (! handler) {
+        return;
     }
+    if (handler->mTimeoutNetManagerPtr != this) {
+        if (handler->mTimeoutNetManagerPtr) {
+            handler->mTimeoutNetManagerPtr->UnRegisterTimeoutHandler(
+                handler);
+        }
+        handler->mTimeoutNetManagerPtr = this;
+        mCounters.mTimeoutHandlerCount++;
+    }
+    ScheduleTimeoutHandler(*handler);
 }
 
 void
 NetManager::UnRegisterTimeoutHandler(ITimeout* handler)
 {
-    if (! handler) {
+    if (! handler || handler->mTimeoutNetManagerPtr != this) {
+        return;
+    }
+    RemoveTimeoutHandler(*handler);
+    handler->mTimeoutNetManagerPtr = 0;
+    mCounters.mTimeoutHandlerCount--;
+}
+
+void
+ITimeout::Reschedule()
+{
+    assert(mTimeoutNetManagerPtr->IsTimeoutHandlersOwner());
+    mTimeoutNetManagerPtr->ScheduleTimeoutHandler(*this);
+}
+
+bool
+NetManager::IsTimeoutHandlersOwner() const
+{
+    return (! mMainLoopRunningFlag ||
+        pthread_equal(mMainLoopThread, pthread_self()) ||
+        (mMainLoopMutex && mMainLoopMutex->IsOwned()));
+}
+
+inline void
+NetManager::AppendTimeoutHandler(ITimeout& handler, int listIdx)
+{
+    assert(handler.mTimeoutListIdx < 0);
+    handler.mTimeoutListIdx = listIdx;
+    TimeoutHandlers::PushBack(mTimeoutLists[listIdx], handler);
+    if (listIdx < kTimeoutWheelSlots) {
+        mTimeoutWheelCount++;
+    }
+}
+
+void
+NetManager::RemoveTimeoutHandler(ITimeout& handler)
+{
+    const int listIdx = handler.mTimeoutListIdx;
+    if (listIdx < 0) {
         return;
     }
-    if (mCurTimeoutHandler == handler) {
-        mCurTimeoutHandler = &ITimeout::List::GetNext(*handler);
-        if (mCurTimeoutHandler == TimeoutHandlers::Front(mTimeoutHandlers)) {
+    if (mCurTimeoutHandler == &handler) {
+        mCurTimeoutHandler = &ITimeout::List::GetNext(handler);
+        if (mCurTimeoutHandler == TimeoutHandlers::Front(
+                mTimeoutLists[kTimeoutListEveryLoop])) {
             mCurTimeoutHandler = 0;
         }
     }
-    TimeoutHandlers::Remove(mTimeoutHandlers, *handler);
+    TimeoutHandlers::Remove(mTimeoutLists[listIdx], handler);
+    if (listIdx < kTimeoutWheelSlots) {
+        mTimeoutWheelCount--;
+    }
+    handler.mTimeoutListIdx = -1;
+}
+
+void
+NetManager::InsertTimeoutHandler(ITimeout& handler, int64_t expireMs)
+{
+    if (expireMs < mTimeoutWheelMs) {
+        AppendTimeoutHandler(handler, kTimeoutListExpired);
+        return;
+    }
+    // The level is determined by the most significant slot index bits that
+    // differ between the expiration and the current wheel time, thus the
+    // entry is moved into the lower level when the wheel time enters the
+    // entry's slot.
+    const int64_t kMaxMask = (int64_t(1) <<
+        (kTimeoutWheelBits * kTimeoutWheelLevels)) - 1;
+    if (kMaxMask < (expireMs ^ mTimeoutWheelMs)) {
+        // Beyond the wheel range, re-evaluate at the end of the range.
+        expireMs = mTimeoutWheelMs | kMaxMask;
+    }
+    int level = 0;
+    for (int64_t diff = (expireMs ^ mTimeoutWheelMs) >> kTimeoutWheelBits;
+            diff != 0;
+            diff >>= kTimeoutWheelBits) {
+        level++;
+    }
+    handler.mTimeoutExpireMs = expireMs;
+    AppendTimeoutHandler(handler, level * kTimeoutWheelSize + int(
+        (expireMs >> (level * kTimeoutWheelBits)) & (kTimeoutWheelSize - 1)));
+}
+
+void
+NetManager::ScheduleTimeoutHandler(ITimeout& handler)
+{
+    if (handler.mDisabled) {
+        if (handler.mTimeoutListIdx != kTimeoutListDisabled) {
+            RemoveTimeoutHandler(handler);
+            AppendTimeoutHandler(handler, kTimeoutListDisabled);
+        }
+    } else if (handler.mIntervalMs <= 0) {
+        // Do not move the handler to the end of the list, in order to
+        // ensure that the handler isn't invoked twice by the current loop.
+        if (handler.mTimeoutListIdx != kTimeoutListEveryLoop) {
+            RemoveTimeoutHandler(handler);
+            AppendTimeoutHandler(handler, kTimeoutListEveryLoop);
+        }
+    } else {
+        RemoveTimeoutHandler(handler);
+        InsertTimeoutHandler(handler,
+            handler.mLastCall + handler.mIntervalMs);
+    }
+}
+
+void
+NetManager::RunTimeoutHandlers(int64_t nowMs)
+{
+    ITimeout* handler;
+    if (mTimeoutWheelCount <= 0) {
+        mTimeoutWheelMs = max(mTimeoutWheelMs, nowMs + 1);
+    } else if (mTimeoutWheelMs + kTimeoutWheelSize * kTimeoutWheelSize <=
+            nowMs) {
+        // Large timer overrun, re-evaluate all handlers instead of advancing
+        // the wheel one slot at a time.
+        for (int i = 0; i < kTimeoutWheelSlots; i++) {
+            while ((handler = TimeoutHandlers::PopFront(mTimeoutLists[i]))) {
+                handler->mTimeoutListIdx = -1;
+                mTimeoutWheelCount--;
+                AppendTimeoutHandler(*handler, kTimeoutListExpired);
+            }
+        }
+        assert(0 == mTimeoutWheelCount);
+        mTimeoutWheelMs = nowMs + 1;
+    } else {
+        while (mTimeoutWheelMs <= nowMs) {
+            if (0 == (mTimeoutWheelMs & (kTimeoutWheelSize - 1))) {
+                // Cascade the upper levels' slots starting from the top, as
+                // the entries might move into the next level's current slot.
+                int level = 1;
+                while (level + 1 < kTimeoutWheelLevels &&
+                        0 == (mTimeoutWheelMs & ((int64_t(1) <<
+                            (kTimeoutWheelBits * (level + 1))) - 1))) {
+                    level++;
+                }
+                for (; 0 < level; level--) {
+                    ITimeout** const list = mTimeoutLists[
+                        level * kTimeoutWheelSize + int((mTimeoutWheelMs >>
+                            (level * kTimeoutWheelBits)) &
+                            (kTimeoutWheelSize - 1))];
+                    while ((handler = TimeoutHandlers::PopFront(list))) {
+                        handler->mTimeoutListIdx = -1;
+                        mTimeoutWheelCount--;
+                        InsertTimeoutHandler(
+                            *handler, handler->mTimeoutExpireMs);
+                    }
+                }
+            }
+            ITimeout** const list = mTimeoutLists[
+                int(mTimeoutWheelMs & (kTimeoutWheelSize - 1))];
+            while ((handler = TimeoutHandlers::PopFront(list))) {
+                handler->mTimeoutListIdx = -1;
+                mTimeoutWheelCount--;
+                AppendTimeoutHandler(*handler, kTimeoutListExpired);
+            }
+            mTimeoutWheelMs++;
+            if (mTimeoutWheelCount <= 0) {
+                mTimeoutWheelMs = max(mTimeoutWheelMs, nowMs + 1);
+                break;
+            }
+        }
+    }
+    // Handlers can register, unregister, and re-schedule themselves and other
+    // handlers. A handler can be invoked at most once, as the next
+    // expiration time of the invoked handler is always in the future.
+    while ((handler = TimeoutHandlers::PopFront(
+            mTimeoutLists[kTimeoutListExpired]))) {
+        handler->mTimeoutListIdx = -1;
+        if (handler->mDisabled || handler->mIntervalMs <= 0) {
+            ScheduleTimeoutHandler(*handler);
+        } else if (handler->mLastCall + handler->mIntervalMs <= nowMs) {
+            InsertTimeoutHandler(*handler, max(mTimeoutWheelMs,
+                nowMs + handler->mIntervalMs));
+            mCounters.mTimeoutHandlerCallCount++;
+            handler->TimerExpired(nowMs);
+        } else {
+            InsertTimeoutHandler(*handler, max(mTimeoutWheelMs,
+                handler->mLastCall + handler->mIntervalMs));
+        }
+    }
+    ITimeout** const everyLoop = mTimeoutLists[kTimeoutListEveryLoop];
+    mCurTimeoutHandler = TimeoutHandlers::Front(everyLoop);
+    while (mCurTimeoutHandler) {
+        ITimeout& cur = *mCurTimeoutHandler;
+        mCurTimeoutHandler = &ITimeout::List::GetNext(cur);
+        if (mCurTimeoutHandler == TimeoutHandlers::Front(everyLoop)) {
+            mCurTimeoutHandler = 0;
+        }
+        if (cur.mDisabled) {
+            ScheduleTimeoutHandler(cur);
+            continue;
+        }
+        mCounters.mTimeoutHandlerCallCount++;
+        cur.TimerExpired(nowMs);
+    }
 }
 
 inline void
@@ -513,6 +752,9 @@ NetManager::MainLoop(
 {
     QCStMutexLocker locker(mutex);
 
+    mMainLoopMutex       = mutex;
+    mMainLoopThread      = pthread_self();
+    mMainLoopRunningFlag = true;
     if (! runOnceFlag || mLastTimerTime != mNow) {
         UpdateGetCurrentTime(mNow, mNowUsec);
         mLastTimerTime = mNow;
@@ -555,6 +797,7 @@ NetManager::MainLoop(
         const int fdCount = mConnectionsCount + 1;
         assert(mPendingUpdate.empty());
         mPollFlag = true;
+        const int64_t pollStartUsec = microseconds();
         QCStMutexUnlocker unlocker(mutex);
         const int ret = mPoll.Poll(fdCount, timeout);
         if (ret < 0 && ret != -EINTR && ret != -EAGAIN) {
@@ -571,6 +814,8 @@ NetManager::MainLoop(
         sec *= 1000;
         const int64_t nowMs = sec + usec / 1000;
         mNowUsec = sec * 1000 + usec;
+        mCounters.mLoopCount++;
+        mCounters.mPollWaitUsec += max(int64_t(0), mNowUsec - pollStartUsec);
         for (PendingUpdate::const_iterator it = mPendingUpdate.begin();
                 it != mPendingUpdate.end();
                 ++it) {
@@ -581,15 +826,10 @@ NetManager::MainLoop(
         if (dispatcher) {
             dispatcher->DispatchStart();
         }
-        mCurTimeoutHandler = TimeoutHandlers::Front(mTimeoutHandlers);
-        while (mCurTimeoutHandler) {
-            ITimeout& cur = *mCurTimeoutHandler;
-            mCurTimeoutHandler = &ITimeout::List::GetNext(cur);
-            if (mCurTimeoutHandler == TimeoutHandlers::Front(mTimeoutHandlers)) {
-                mCurTimeoutHandler = 0;
-            }
-            cur.TimerExpired(nowMs);
-        }
+        const int64_t timerStartUsec = microseconds();
+        RunTimeoutHandlers(nowMs);
+        const int64_t dispatchStartUsec = microseconds();
+        mCounters.mTimerUsec += dispatchStartUsec - timerStartUsec;
         // Move pending read list into temporary list, as the pending read might
         // change as a result of event dispatch.
         NetManagerEntry pendingRead;
@@ -649,6 +889,8 @@ NetManager::MainLoop(
         }
         mRemove.clear();
         UpdateGetCurrentTime(mNow, mNowUsec);
+        mCounters.mDispatchUsec +=
+            max(int64_t(0), mNowUsec - dispatchStartUsec);
         int slotCnt = min(int(kTimerWheelSize), int(mNow - mLastTimerTime));
         if (mLastTimerTime + timerOverrunWarningTime < mNow) {
             KFS_LOG_STREAM_INFO <<
@@ -690,6 +932,7 @@ NetManager::MainLoop(
         mTimerRunningFlag = false;
         mLastTimerTime = mNow;
         mTimerWheelBucketItr = mRemove.end();
+        mCounters.mTimerUsec += max(int64_t(0), microseconds() - mNowUsec);
         if (runOnceFlag) {
             break;
         }
@@ -705,6 +948,7 @@ NetManager::MainLoop(
             mRunFlag = true;
         }
     }
+    mMainLoopRunningFlag = false;
     if (dispatcher) {
         dispatcher->DispatchExit();
     }
@@ -736,9 +980,16 @@ void
 NetManager::CleanUp(bool childAtForkFlag, bool onlyCloseFdFlag)
 {
     mShutdownFlag = true;
-    while (! TimeoutHandlers::IsEmpty(mTimeoutHandlers)) {
-        TimeoutHandlers::PopFront(mTimeoutHandlers);
+    for (int i = 0; i < kTimeoutListCount; i++) {
+        ITimeout* handler;
+        while ((handler = TimeoutHandlers::PopFront(mTimeoutLists[i]))) {
+            handler->mTimeoutListIdx       = -1;
+            handler->mTimeoutNetManagerPtr = 0;
+        }
     }
+    mCurTimeoutHandler             = 0;
+    mTimeoutWheelCount             = 0;
+    mCounters.mTimeoutHandlerCount = 0;
     if (childAtForkFlag) {
         mPoll.Close();
     }
@@ -37,6 +37,8 @@
 #include <list>
 #include <vector>
 
+#include <pthread.h>
+
 class QCFdPoll;
 class QCMutex;
 
@@ -87,6 +89,31 @@ public:
     void RegisterTimeoutHandler(ITimeout *handler);
     void UnRegisterTimeoutHandler(ITimeout *handler);
 
+    /// Event loop iteration counters.
+    struct Counters
+    {
+        typedef int64_t Counter;
+
+        Counter mLoopCount;
+        Counter mPollWaitUsec;
+        Counter mDispatchUsec;
+        Counter mTimerUsec;
+        Counter mTimeoutHandlerCount;
+        Counter mTimeoutHandlerCallCount;
+
+        void Clear()
+        {
+            mLoopCount               = 0;
+            mPollWaitUsec            = 0;
+            mDispatchUsec            = 0;
+            mTimerUsec               = 0;
+            mTimeoutHandlerCount     = 0;
+            mTimeoutHandlerCallCount = 0;
+        }
+    };
+    void GetCounters(Counters& counters) const
+        { counters = mCounters; }
+
     void SetBacklogLimit(int64_t v)
         { mMaxOutgoingBacklog = v; }
     void ChangeDiskOverloadState(bool v);
@@ -109,6 +136,9 @@ public:
         Dispatcher* dispatcher           = 0,
         bool        runOnceFlag          = false);
     void Wakeup();
+    /// Invoke the timeout handlers that are due at the time specified.
+    /// Invoked by MainLoop(), public for the timer wheel unit test.
+    void RunTimeoutHandlers(int64_t nowMs);
 
     void Shutdown()
         { mRunFlag = false; }
@@ -162,6 +192,22 @@ public:
         { return mResolverCacheSize; }
     int GetResolverCacheExpiration() const
         { return mResolverCacheExpiration; }
+    void SetResolverCacheParameters(int negativeCacheExpiration,
+        int cacheRefreshAhead, int threadCount);
+    int GetResolverNegativeCacheExpiration() const
+        { return mResolverNegativeCacheExpiration; }
+    int GetResolverCacheRefreshAhead() const
+        { return mResolverCacheRefreshAhead; }
+    int GetResolverThreadCount() const
+        { return mResolverThreadCount; }
+    void GetResolverCounters(Resolver::Counters& counters) const;
+    /// Connect to the servers on this host through the unix domain sockets
+    /// in the directory specified, if the server's socket exists. Empty
+    /// string turns off the local connections.
+    void SetLocalSocketDir(const string& dir)
+        { mLocalSocketDir = dir; }
+    const string& GetLocalSocketDir() const
+        { return mLocalSocketDir; }
     int Enqueue(Resolver::Request& req, int timeout)
     {
         if (mResolver) {
@@ -233,8 +279,22 @@ private:
     typedef NetManagerEntry::PendingReadList PendingReadList;
     typedef vector<NetConnection*>           PendingUpdate;
     enum { kTimerWheelSize = (1 << 8) };
+    /// Timeout handlers hierarchical timer wheel with millisecond resolution:
+    /// each level has 64 slots, the level slot width is 64 times the width
+    /// of the slot of the level below, thus the 4 levels cover ~4.6 hours,
+    /// with the handlers with longer intervals re-scheduled when their
+    /// top level slot expires.
+    enum { kTimeoutWheelBits     = 6 };
+    enum { kTimeoutWheelSize     = 1 << kTimeoutWheelBits };
+    enum { kTimeoutWheelLevels   = 4 };
+    enum { kTimeoutWheelSlots    = kTimeoutWheelSize * kTimeoutWheelLevels };
+    enum { kTimeoutListEveryLoop = kTimeoutWheelSlots };
+    enum { kTimeoutListExpired   = kTimeoutListEveryLoop + 1 };
+    enum { kTimeoutListDisabled  = kTimeoutListExpired + 1 };
+    enum { kTimeoutListCount     = kTimeoutListDisabled + 1 };
     class ResolverRequest;
     friend class ResolverRequest;
+    friend class ITimeout;
 
     List            mRemove;
     List::iterator  mTimerWheelBucketItr;
@@ -265,7 +325,11 @@ private:
     int             mMaxAcceptsPerRead;
     int             mResolverCacheSize;
     int             mResolverCacheExpiration;
+    int             mResolverNegativeCacheExpiration;
+    int             mResolverCacheRefreshAhead;
+    int             mResolverThreadCount;
     bool            mResolverOsFlag;
+    string          mLocalSocketDir;
     QCFdPoll&       mPoll;
     PollEventHook*  mPollEventHook;
     Resolver*       mResolver;
@@ -274,14 +338,29 @@ private:
     PendingUpdate   mPendingUpdate;
     /// Handlers that are notified whenever a call to select()
     /// returns.  To the handlers, the notification is a timeout signal.
+    /// The handlers with non positive interval are invoked on every loop
+    /// iteration, the remaining enabled handlers are in the timer wheel.
     ITimeout*       mCurTimeoutHandler;
-    ITimeout*       mTimeoutHandlers[1];
+    int64_t         mTimeoutWheelMs;
+    int             mTimeoutWheelCount;
+    Counters        mCounters;
+    ITimeout*       mTimeoutLists[kTimeoutListCount][1];
+    /// The event loop thread and mutex, the timeout handlers must only be
+    /// re-scheduled by the event loop thread, or with the mutex held.
+    QCMutex*        mMainLoopMutex;
+    pthread_t       mMainLoopThread;
+    volatile bool   mMainLoopRunningFlag;
     List            mEpollError;
     List            mTimerWheel[kTimerWheelSize + 1];
 
     void CheckIfOverloaded();
     void CleanUp(bool childAtForkFlag = false, bool onlyCloseFdFlag = false);
     inline void UpdateTimer(NetManagerEntry& entry, int timeOut);
+    inline void AppendTimeoutHandler(ITimeout& handler, int listIdx);
+    void ScheduleTimeoutHandler(ITimeout& handler);
+    void InsertTimeoutHandler(ITimeout& handler, int64_t expireMs);
+    void RemoveTimeoutHandler(ITimeout& handler);
+    bool IsTimeoutHandlersOwner() const;
     void UpdateSelf(NetManagerEntry& entry, int fd,
         bool resetTimer, bool epollError);
     void PollRemove(int fd);
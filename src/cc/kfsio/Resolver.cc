@@ -57,6 +57,7 @@ namespace KFS
 {
 using KFS::libkfsio::globals;
 using std::max;
+using std::min;
 using std::pair;
 
 class Resolver::Impl
@@ -69,20 +70,27 @@ public:
           mPendingRequests(),
           mCache(),
           mExpirationList(),
+          mNegativeExpirationList(),
           mSearchEntry(),
           mMaxCacheSize(8 << 10),
-          mExpirationTimeSec(-1)
+          mExpirationTimeSec(-1),
+          mNegativeExpirationTimeSec(-1),
+          mRefreshAheadSec(-1),
+          mCounters()
     {
         memset(&mAddrInfoHints, 0, sizeof(mAddrInfoHints));
         mAddrInfoHints.ai_family   = AF_UNSPEC;   // Allow IPv4 or IPv6
         mAddrInfoHints.ai_socktype = SOCK_STREAM; // Datagram socket
         mAddrInfoHints.ai_flags    = 0;
         mAddrInfoHints.ai_protocol = 0;           // Any protocol
+        mCounters.Clear();
     }
     virtual ~Impl()
         {}
     virtual int Start() = 0;
     virtual void Shutdown() = 0;
+    virtual void SetThreadCount(
+        int inThreadCount) = 0;
     int Enqueue(
         Request& inRequest,
         int      inTimeout)
@@ -91,7 +99,7 @@ public:
         if (! mRunFlag) {
             return -EINVAL;
         }
-        if (Find(inRequest)) {
+        if (Find(inRequest, inTimeout)) {
             return 0;
         }
         if (AddToPending(inRequest)) {
@@ -105,10 +113,28 @@ public:
     {
         mMaxCacheSize      = inMaxCacheSize;
         mExpirationTimeSec = inTimeoutSec;
-        if (mMaxCacheSize <= 0 || mExpirationTimeSec <= 0) {
+        if (! IsCacheEnabled()) {
             mCache.clear();
         }
     }
+    void SetParameters(
+        int inNegativeTimeoutSec,
+        int inRefreshAheadSec,
+        int inThreadCount)
+    {
+        mNegativeExpirationTimeSec = inNegativeTimeoutSec;
+        mRefreshAheadSec           = inRefreshAheadSec;
+        if (! IsCacheEnabled()) {
+            mCache.clear();
+        }
+        SetThreadCount(inThreadCount);
+    }
+    void GetCounters(
+        Counters& outCounters) const
+    {
+        outCounters = mCounters;
+        outCounters.mCacheSize = (Counters::Counter)mCache.size();
+    }
 protected:
     NetManager&     mNetManager;
     volatile bool   mRunFlag;
@@ -120,43 +146,24 @@ protected:
         Request& inRequest,
         bool     inExpireFlag = true)
     {
-        if (0 < mExpirationTimeSec && 0 < mMaxCacheSize) {
+        if (0 == inRequest.mStatus) {
+            mCounters.mResolvedCount++;
+        } else {
+            mCounters.mErrorCount++;
+        }
+        mCounters.mResolveTimeUsec +=
+            max(int64_t(0), mNetManager.NowUsec() - inRequest.mStartUsec);
+        if (IsCacheEnabled()) {
+            const time_t theNow = mNetManager.Now();
             if (inExpireFlag) {
-                const time_t theExpTime =
-                    mNetManager.Now() - mExpirationTimeSec;
-                Entry*       thePtr;
-                while ((thePtr = &Entry::List::GetNext(mExpirationList)) !=
-                        &mExpirationList && thePtr->mTime < theExpTime) {
-                    KFS_LOG_STREAM_DEBUG <<
-                        "cached expired: " << thePtr->mHostName <<
-                    KFS_LOG_EOM;
-                    mCache.erase(*thePtr);
-                }
+                Expire(mExpirationList, theNow);
+                Expire(mNegativeExpirationList, theNow);
             }
-            if (0 == inRequest.mStatus) {
-                Entry* thePtr;
-                while (mMaxCacheSize < mCache.size() &&
-                        (thePtr = &Entry::List::GetNext(mExpirationList)) !=
-                            &mExpirationList) {
-                    KFS_LOG_STREAM_DEBUG <<
-                        " cache size: " << mCache.size() <<
-                        " max: "        << mMaxCacheSize <<
-                        " evicting: "   << thePtr->mHostName <<
-                    KFS_LOG_EOM;
-                    mCache.erase(*thePtr);
-                }
-                Entry theEntry(inRequest.mHostName);
-                theEntry.mTime        = mNetManager.Now();
-                theEntry.mIpAddresses = inRequest.mIpAddresses;
-                theEntry.mMaxResults  = inRequest.mMaxResults;
-                pair<Cache::iterator, bool> const
-                    theRes = mCache.insert(theEntry);
-                Entry& theInserted = const_cast<Entry&>(*theRes.first);
-                if (! theRes.second) {
-                    theInserted = theEntry;
-                }
-                Entry::List::Insert(
-                    theInserted, Entry::List::GetPrev(mExpirationList));
+            if (0 == inRequest.mStatus ?
+                    0 < mExpirationTimeSec :
+                    (0 < mNegativeExpirationTimeSec &&
+                        -ECANCELED != inRequest.mStatus)) {
+                Insert(inRequest, theNow);
             }
         }
         if (1 != mPendingRequests.erase(PendingReqEntry(inRequest))) {
@@ -180,7 +187,7 @@ protected:
     {
         const int64_t theTime    = mNetManager.NowUsec() - inRequest.mStartUsec;
         Counter&      theCounter = 0 == inRequest.mStatus ?
-            globals().ctrNetDnsErrors : globals().ctrNetDnsErrors;
+            globals().ctrNetDnsResolvedCtr : globals().ctrNetDnsErrors;
         theCounter.Update(1);
         theCounter.UpdateTime(theTime);
         inRequest.Done();
@@ -188,6 +195,17 @@ protected:
     virtual int EnqueueSelf(
         Request& inRequest,
         int      inTimeout) = 0;
+    static bool DeleteIfRefresh(
+        Request& inRequest)
+    {
+        RefreshRequest* const thePtr =
+            dynamic_cast<RefreshRequest*>(&inRequest);
+        if (! thePtr || thePtr->mNextPendingPtr) {
+            return false;
+        }
+        delete thePtr;
+        return true;
+    }
 private:
     typedef Request::IpAddresses IpAddresses;
 
@@ -197,9 +215,11 @@ private:
         Entry(
             const string& inHostName = string())
             : mMaxResults(),
-              mTime(),
+              mStatus(0),
+              mExpirationTime(),
               mHostName(inHostName),
-              mIpAddresses()
+              mIpAddresses(),
+              mStatusMsg()
             { List::Init(*this); }
         ~Entry()
             { List::Remove(*this); }
@@ -213,9 +233,11 @@ private:
         typedef QCDLListOp<Entry, 0> List;
 
         int         mMaxResults;
-        time_t      mTime;
+        int         mStatus;
+        time_t      mExpirationTime;
         string      mHostName;
         IpAddresses mIpAddresses;
+        string      mStatusMsg;
         Entry*      mPrevPtr[1];
         Entry*      mNextPtr[1];
 
@@ -225,7 +247,7 @@ private:
     typedef std::set<
         Entry,
         std::less<Entry>,
-        StdFastAllocator< Entry>
+        StdFastTaggedAllocator<Entry, MemoryAccounting::kSubsystemCaches>
     > Cache;
     class PendingReqEntry
     {
@@ -261,44 +283,172 @@ private:
         std::less<PendingReqEntry>,
         StdFastAllocator< PendingReqEntry>
     > PendingRequests;
+    // Background cache entry refresh, completion updates the cache.
+    class RefreshRequest : public Request
+    {
+    public:
+        RefreshRequest(
+            const string& inHostName,
+            int           inMaxResults)
+            : Request(inHostName, inMaxResults)
+            {}
+        virtual void Done()
+            { delete this; }
+    protected:
+        virtual ~RefreshRequest()
+            {}
+        friend class Impl;
+    };
 
     PendingRequests mPendingRequests;
     Cache           mCache;
     Entry           mExpirationList;
+    Entry           mNegativeExpirationList;
     Entry           mSearchEntry;
     size_t          mMaxCacheSize;
     int             mExpirationTimeSec;
+    int             mNegativeExpirationTimeSec;
+    int             mRefreshAheadSec;
+    Counters        mCounters;
 
+    bool IsCacheEnabled() const
+    {
+        return (0 < mMaxCacheSize &&
+            (0 < mExpirationTimeSec || 0 < mNegativeExpirationTimeSec));
+    }
+    void Expire(
+        Entry& inList,
+        time_t inNow)
+    {
+        // Entries in each list have the same time to live, thus the lists
+        // are ordered by expiration time.
+        Entry* thePtr;
+        while ((thePtr = &Entry::List::GetNext(inList)) != &inList &&
+                thePtr->mExpirationTime < inNow) {
+            KFS_LOG_STREAM_DEBUG <<
+                "cached expired: " << thePtr->mHostName <<
+                " status: "        << thePtr->mStatus <<
+            KFS_LOG_EOM;
+            mCache.erase(*thePtr);
+        }
+    }
+    void Insert(
+        const Request& inRequest,
+        time_t         inNow)
+    {
+        const bool theNegativeFlag = 0 != inRequest.mStatus;
+        mSearchEntry.mHostName = inRequest.mHostName;
+        Cache::iterator theIt = mCache.find(mSearchEntry);
+        mSearchEntry.mHostName = string();
+        if (mCache.end() == theIt) {
+            theIt = mCache.insert(Entry(inRequest.mHostName)).first;
+        } else if (theNegativeFlag && 0 == theIt->mStatus &&
+                inNow <= theIt->mExpirationTime) {
+            // Keep serving the valid result, i.e. refresh failure.
+            return;
+        }
+        Entry& theEntry = const_cast<Entry&>(*theIt);
+        theEntry.mMaxResults     = inRequest.mMaxResults;
+        theEntry.mStatus         = inRequest.mStatus;
+        theEntry.mStatusMsg      = inRequest.mStatusMsg;
+        theEntry.mIpAddresses    = inRequest.mIpAddresses;
+        theEntry.mExpirationTime = inNow + (theNegativeFlag ?
+            mNegativeExpirationTimeSec : mExpirationTimeSec);
+        if (! Entry::List::IsInList(theEntry)) {
+            // The list pointers were copied on insertion.
+            Entry::List::Init(theEntry);
+        }
+        Entry& theList = theNegativeFlag ?
+            mNegativeExpirationList : mExpirationList;
+        Entry::List::Insert(theEntry, Entry::List::GetPrev(theList));
+        // Evict negative entries first, then the oldest entries.
+        while (mMaxCacheSize < mCache.size()) {
+            Entry* thePtr = &Entry::List::GetNext(mNegativeExpirationList);
+            if (thePtr == &mNegativeExpirationList) {
+                thePtr = &Entry::List::GetNext(mExpirationList);
+                if (thePtr == &mExpirationList) {
+                    break;
+                }
+            }
+            KFS_LOG_STREAM_DEBUG <<
+                " cache size: " << mCache.size() <<
+                " max: "        << mMaxCacheSize <<
+                " evicting: "   << thePtr->mHostName <<
+            KFS_LOG_EOM;
+            mCache.erase(*thePtr);
+        }
+    }
     bool Find(
-        Request& inRequest)
+        Request& inRequest,
+        int      inTimeout)
     {
-        if (mExpirationTimeSec <= 0 || mMaxCacheSize <= 0) {
+        if (! IsCacheEnabled()) {
             return false;
         }
         mSearchEntry.mHostName = inRequest.mHostName;
         const Cache::iterator theIt = mCache.find(mSearchEntry);
         mSearchEntry.mHostName = string();
         if (mCache.end() == theIt) {
+            mCounters.mMissCount++;
             return false;
         }
-        if (theIt->mTime + mExpirationTimeSec < mNetManager.Now()) {
+        const time_t theNow = mNetManager.Now();
+        if (theIt->mExpirationTime < theNow) {
             mCache.erase(theIt);
+            mCounters.mMissCount++;
             return false;
         }
+        if (0 != theIt->mStatus) {
+            inRequest.mIpAddresses.clear();
+            inRequest.mStatus    = theIt->mStatus;
+            inRequest.mStatusMsg = theIt->mStatusMsg;
+            mCounters.mNegativeHitCount++;
+            DoneSelf(inRequest);
+            return true;
+        }
         if (0 < theIt->mMaxResults &&
                 (inRequest.mMaxResults <= 0 ||
                 theIt->mMaxResults < inRequest.mMaxResults) &&
                 (size_t)theIt->mMaxResults <
                     theIt->mIpAddresses.size()) {
+            mCounters.mMissCount++;
             return false;
         }
         inRequest.mIpAddresses = theIt->mIpAddresses;
         inRequest.mStatus      = 0;
         inRequest.mStatusMsg.clear();
+        mCounters.mHitCount++;
+        if (0 < mRefreshAheadSec &&
+                theIt->mExpirationTime - mRefreshAheadSec <= theNow) {
+            // Refresh might complete, and update the cache, synchronously.
+            Refresh(theIt->mHostName, theIt->mMaxResults, inTimeout);
+        }
         DoneSelf(inRequest);
         return true;
     }
-
+    void Refresh(
+        string inHostName,
+        int    inMaxResults,
+        int    inTimeout)
+    {
+        RefreshRequest& theRequest =
+            *(new RefreshRequest(inHostName, inMaxResults));
+        if (mPendingRequests.find(PendingReqEntry(theRequest)) !=
+                mPendingRequests.end()) {
+            delete &theRequest;
+            return;
+        }
+        KFS_LOG_STREAM_DEBUG <<
+            "refreshing: " << inHostName <<
+        KFS_LOG_EOM;
+        mCounters.mRefreshCount++;
+        theRequest.mStartUsec = mNetManager.NowUsec();
+        AddToPending(theRequest);
+        if (0 != EnqueueSelf(theRequest, inTimeout)) {
+            mPendingRequests.erase(PendingReqEntry(theRequest));
+            delete &theRequest;
+        }
+    }
     bool AddToPending(
         Request& inRequest)
     {
@@ -331,10 +481,12 @@ public:
           QCRunnable(),
           ITimeout(),
           mQueue(),
-          mThread(),
+          mDoneQueue(),
           mMutex(),
           mCondVar(),
-          mDoneCount(0)
+          mDoneCount(0),
+          mThreadCount(1),
+          mStartedThreadCount(0)
         {}
     virtual ~OsImpl()
         { OsImpl::Shutdown(); }
@@ -344,9 +496,8 @@ public:
             return -EINVAL;
         }
         mRunFlag = true;
-        const int kStackSize = 64 << 10;
         mNetManager.RegisterTimeoutHandler(this);
-        mThread.Start(this, kStackSize, "Resolver");
+        StartThreads();
         return 0;
     }
     virtual void Shutdown()
@@ -356,10 +507,29 @@ public:
             return;
         }
         mRunFlag = false;
-        mCondVar.Notify();
+        mCondVar.NotifyAll();
         theLock.Unlock();
-        mThread.Join();
+        for (int i = 0; i < mStartedThreadCount; i++) {
+            mThreads[i].Join();
+        }
+        mStartedThreadCount = 0;
         mNetManager.UnRegisterTimeoutHandler(this);
+        // Completions will not be delivered, delete background requests.
+        Queue    theDoneQueue;
+        Request* thePtr;
+        theDoneQueue.PushBack(mDoneQueue);
+        while ((thePtr = theDoneQueue.PopFront())) {
+            DeleteIfRefresh(*thePtr);
+        }
+    }
+    virtual void SetThreadCount(
+        int inThreadCount)
+    {
+        // Threads are only added while running.
+        mThreadCount = max(1, min(int(kMaxThreadCount), inThreadCount));
+        if (mRunFlag) {
+            StartThreads();
+        }
     }
     virtual int EnqueueSelf(
         Request& inRequest,
@@ -371,12 +541,10 @@ public:
         if (! mRunFlag) {
             return -EINVAL;
         }
-        const bool theWakeFlag = mQueue.IsEmpty();
         mQueue.PushBack(inRequest);
         theLock.Unlock();
-        if (theWakeFlag) {
-            mCondVar.Notify();
-        }
+        // Wake up one idle thread, if any, for every request.
+        mCondVar.Notify();
         return 0;
     }
     virtual void Timeout()
@@ -403,21 +571,19 @@ public:
             while (mRunFlag && mQueue.IsEmpty()) {
                 mCondVar.Wait(mMutex);
             }
-            Queue theQueue;
-            theQueue.PushBack(mQueue);
-            QCStMutexUnlocker theUnlocker(mMutex);
-            Request* thePtr = theQueue.Front();
-            while (thePtr) {
-                Process(*thePtr);
-                thePtr = Queue::GetNext(*thePtr);
-            }
-            theUnlocker.Lock();
-            const bool theWakeupFlag =
-                ! theQueue.IsEmpty() && mDoneQueue.IsEmpty();
-            mDoneQueue.PushBack(theQueue);
-            if (theWakeupFlag) {
-                SyncAddAndFetch(mDoneCount, 1);
-                mNetManager.Wakeup();
+            // Take one request at a time, in order to resolve in parallel
+            // with the other threads.
+            Request* const theReqPtr = mQueue.PopFront();
+            if (theReqPtr) {
+                QCStMutexUnlocker theUnlocker(mMutex);
+                Process(*theReqPtr);
+                theUnlocker.Lock();
+                const bool theWakeupFlag = mDoneQueue.IsEmpty();
+                mDoneQueue.PushBack(*theReqPtr);
+                if (theWakeupFlag) {
+                    SyncAddAndFetch(mDoneCount, 1);
+                    mNetManager.Wakeup();
+                }
             }
             if (! mRunFlag && mQueue.IsEmpty()) {
                 break;
@@ -433,13 +599,25 @@ public:
         {}
 private:
     typedef SingleLinkedQueue<Request, OsImpl> Queue;
+    enum { kMaxThreadCount = 32 };
 
     Queue        mQueue;
     Queue        mDoneQueue;
-    QCThread     mThread;
     QCMutex      mMutex;
     QCCondVar    mCondVar;
     volatile int mDoneCount;
+    int          mThreadCount;
+    int          mStartedThreadCount;
+    QCThread     mThreads[kMaxThreadCount];
+
+    void StartThreads()
+    {
+        const int kStackSize = 64 << 10;
+        while (mStartedThreadCount < mThreadCount) {
+            mThreads[mStartedThreadCount++].Start(
+                this, kStackSize, "Resolver");
+        }
+    }
 
     void Process(
         Request& inReq)
@@ -461,7 +639,8 @@ private:
             return;
         }
         inReq.mStatusMsg.clear();
-        int theErr = 0;
+        int  theErr = 0;
+        char theNameBuf[sizeof(mNameBuf)];
         for (struct addrinfo const* thePtr = theResPtr;
                 thePtr;
                 thePtr = thePtr->ai_next) {
@@ -471,15 +650,15 @@ private:
             const socklen_t theSize = thePtr->ai_family == AF_INET ?
                 INET6_ADDRSTRLEN : INET6_ADDRSTRLEN;
             const int theStatus = getnameinfo(
-                thePtr->ai_addr, thePtr->ai_addrlen, mNameBuf, theSize,
+                thePtr->ai_addr, thePtr->ai_addrlen, theNameBuf, theSize,
                 0, 0, NI_NUMERICHOST | NI_NUMERICSERV
             );
             if (0 != theStatus) {
                 theErr = theStatus;
                 continue;
             }
-            mNameBuf[theSize] = 0;
-            inReq.mIpAddresses.push_back(string(mNameBuf));
+            theNameBuf[theSize] = 0;
+            inReq.mIpAddresses.push_back(string(theNameBuf));
             if (0 < inReq.mMaxResults &&
                     (size_t)inReq.mMaxResults <= inReq.mIpAddresses.size()) {
                 break;
@@ -538,6 +717,9 @@ public:
     }
     virtual void Shutdown()
         { mRunFlag = false; }
+    virtual void SetThreadCount(
+        int /* inThreadCount */)
+        {}
     virtual int EnqueueSelf(
         Request& inRequest,
         int      inTimeout)
@@ -1018,6 +1200,23 @@ Resolver::SetCacheSizeAndTimeout(
     return mImpl.SetCacheSizeAndTimeout(inMaxCacheSize, inTimeoutSec);
 }
 
+    void
+Resolver::SetParameters(
+    int inNegativeTimeoutSec,
+    int inRefreshAheadSec,
+    int inThreadCount)
+{
+    mImpl.SetParameters(
+        inNegativeTimeoutSec, inRefreshAheadSec, inThreadCount);
+}
+
+    void
+Resolver::GetCounters(
+    Resolver::Counters& outCounters) const
+{
+    mImpl.GetCounters(outCounters);
+}
+
     void
 Resolver::ChildAtFork()
 {
@@ -50,6 +50,44 @@ public:
         ResolverTypeOs  = 0,
         ResolverTypeExt = 1
     };
+    struct Counters
+    {
+        typedef int64_t Counter;
+
+        Counter mHitCount;
+        Counter mNegativeHitCount;
+        Counter mMissCount;
+        Counter mRefreshCount;
+        Counter mResolvedCount;
+        Counter mErrorCount;
+        Counter mResolveTimeUsec;
+        Counter mCacheSize;
+
+        void Clear()
+        {
+            mHitCount         = 0;
+            mNegativeHitCount = 0;
+            mMissCount        = 0;
+            mRefreshCount     = 0;
+            mResolvedCount    = 0;
+            mErrorCount       = 0;
+            mResolveTimeUsec  = 0;
+            mCacheSize        = 0;
+        }
+        Counters& Add(
+            const Counters& inRhs)
+        {
+            mHitCount         += inRhs.mHitCount;
+            mNegativeHitCount += inRhs.mNegativeHitCount;
+            mMissCount        += inRhs.mMissCount;
+            mRefreshCount     += inRhs.mRefreshCount;
+            mResolvedCount    += inRhs.mResolvedCount;
+            mErrorCount       += inRhs.mErrorCount;
+            mResolveTimeUsec  += inRhs.mResolveTimeUsec;
+            mCacheSize        += inRhs.mCacheSize;
+            return *this;
+        }
+    };
 
     class Request
     {
@@ -105,6 +143,17 @@ public:
     void SetCacheSizeAndTimeout(
         size_t inMaxCacheSize,
         int    inTimeoutSec);
+    // Failed resolutions are cached for inNegativeTimeoutSec, if positive.
+    // Cached entries are refreshed in the background on access, if the
+    // remaining time to expiration is less than inRefreshAheadSec.
+    // The number of threads applies to the host os resolver only, as the
+    // requests are processed in parallel by the external resolver.
+    void SetParameters(
+        int inNegativeTimeoutSec,
+        int inRefreshAheadSec,
+        int inThreadCount);
+    void GetCounters(
+        Counters& outCounters) const;
     void ChildAtFork();
     static int Initialize();
     static void Cleanup();
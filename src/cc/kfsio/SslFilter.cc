@@ -50,6 +50,10 @@
 #include <string>
 #include <algorithm>
 
+#if defined(SSL_OP_ENABLE_KTLS) && ! defined(OPENSSL_NO_KTLS)
+#   define QFS_SSL_FILTER_KTLS
+#endif
+
 namespace KFS
 {
 using std::string;
@@ -257,6 +261,20 @@ public:
 #   endif
 #endif
         ));
+        if (inParams.getValue(
+                theParamName.Truncate(thePrefLen).Append("ktls"), 0) != 0) {
+#ifdef QFS_SSL_FILTER_KTLS
+            // Install session keys into the socket after handshake, if the
+            // kernel and the negotiated cipher support it. Otherwise the data
+            // path transparently falls back to user space TLS.
+            SSL_CTX_set_options(theRetPtr, SSL_OP_ENABLE_KTLS);
+#else
+            KFS_LOG_STREAM_INFO <<
+                theParamName <<
+                ": kernel TLS is not supported by openssl library" <<
+            KFS_LOG_EOM;
+#endif
+        }
         SSL_CTX_set_timeout(
                 theRetPtr,
                 inParams.getValue(
@@ -449,7 +467,10 @@ public:
           mSslErrorFlag(false),
           mShutdownCompleteFlag(false),
           mVerifyOrGetPskInvokedFlag(false),
-          mRenegotiationPendingFlag(false)
+          mRenegotiationPendingFlag(false),
+          mKtlsCheckedFlag(false),
+          mKtlsSendFlag(false),
+          mKtlsRecvFlag(false)
     {
         if (! mSslPtr) {
             return;
@@ -465,7 +486,9 @@ public:
             }
 #endif
             SetPskCB();
-            SSL_set_read_ahead(mSslPtr, 1);
+            // Read ahead prevents kernel receive offload if the record that
+            // follows the handshake is already buffered.
+            SSL_set_read_ahead(mSslPtr, IsKtlsEnabled() ? 0 : 1);
             mServerFlag = ! SSL_in_connect_init(mSslPtr);
         } else {
             mError = GetAndClearErr();
@@ -545,7 +568,23 @@ public:
             }
             return (0 <= theRet ? -EAGAIN : theRet);
         }
+        if (mKtlsRecvFlag && ! mSslEofFlag && IsNoSslReadPending()) {
+            // Kernel decrypts application data records, read directly into
+            // io buffer, unless ssl has already buffered data.
+            theRet = inIoBuffer.Read(inSocket.GetFd(), inMaxRead);
+            if (theRet != -EIO) {
+                if (0 < theRet) {
+                    globals().ctrNetKtlsBytesRead.Update(theRet);
+                }
+                return theRet;
+            }
+            // Non application data record, i.e. alert or post handshake
+            // message, let ssl handle it.
+        }
         theRet = inIoBuffer.Read(-1, inMaxRead, this);
+        if (mKtlsRecvFlag && 0 < theRet) {
+            globals().ctrNetKtlsBytesRead.Update(theRet);
+        }
         mReadPendingFlag = 0 < inMaxRead && inMaxRead <= theRet &&
             0 < SSL_peek(mSslPtr, &theByte, sizeof(theByte));
         return theRet;
@@ -575,6 +614,15 @@ public:
         if (inIoBuffer.IsEmpty()) {
             return 0;
         }
+        if (mKtlsSendFlag && ! SSL_want_write(mSslPtr)) {
+            // Kernel encrypts and frames application data records, write io
+            // buffer directly, with no user space copy.
+            theRet = inIoBuffer.Write(inSocket.GetFd());
+            if (0 < theRet) {
+                globals().ctrNetKtlsBytesWritten.Update(theRet);
+            }
+            return theRet;
+        }
         ERR_clear_error();
         int theWrCnt = 0;
         for (IOBuffer::iterator theIt = inIoBuffer.begin();
@@ -594,6 +642,9 @@ public:
         }
         if (0 < theWrCnt) {
             globals().ctrNetBytesWritten.Update(theWrCnt);
+            if (mKtlsSendFlag) {
+                globals().ctrNetKtlsBytesWritten.Update(theWrCnt);
+            }
             return theWrCnt;
         }
         return SslRetToErr(theRet, ! inIoBuffer.IsEmpty());
@@ -652,6 +703,9 @@ public:
             mSslEofFlag                = false;
             mSslErrorFlag              = false;
             mVerifyOrGetPskInvokedFlag = false;
+            mKtlsCheckedFlag           = false;
+            mKtlsSendFlag              = false;
+            mKtlsRecvFlag              = false;
             mAuthName.clear();
             mPeerPskId.clear();
             mServerFlag = ! SSL_in_connect_init(mSslPtr);
@@ -745,7 +799,8 @@ public:
     }
     virtual bool RenewSession()
     {
-        if (! mSslPtr || mError != 0) {
+        if (! mSslPtr || mError != 0 || mKtlsSendFlag || mKtlsRecvFlag) {
+            // Renegotiation is not supported with kernel TLS.
             return false;
         }
         mRenegotiationPendingFlag =
@@ -834,6 +889,9 @@ private:
     bool              mShutdownCompleteFlag:1;
     bool              mVerifyOrGetPskInvokedFlag:1;
     bool              mRenegotiationPendingFlag:1;
+    bool              mKtlsCheckedFlag:1;
+    bool              mKtlsSendFlag:1;
+    bool              mKtlsRecvFlag:1;
 
     struct OpenSslInit
     {
@@ -1098,12 +1156,56 @@ private:
             theTimeValidFlag
         );
     }
+    bool IsKtlsEnabled() const
+    {
+#ifdef QFS_SSL_FILTER_KTLS
+        return ((SSL_get_options(mSslPtr) & SSL_OP_ENABLE_KTLS) != 0);
+#else
+        return false;
+#endif
+    }
+    bool IsNoSslReadPending() const
+    {
+#ifdef QFS_SSL_FILTER_KTLS
+        return (SSL_pending(mSslPtr) <= 0 && ! SSL_has_pending(mSslPtr));
+#else
+        return false;
+#endif
+    }
+    void UpdateKtls()
+    {
+        mKtlsCheckedFlag = true;
+#ifdef QFS_SSL_FILTER_KTLS
+        if (! IsKtlsEnabled()) {
+            return;
+        }
+        // Openssl installs the keys into the socket on the handshake
+        // completion, if the negotiated cipher and the kernel support it.
+        mKtlsSendFlag = BIO_get_ktls_send(SSL_get_wbio(mSslPtr));
+        mKtlsRecvFlag = BIO_get_ktls_recv(SSL_get_rbio(mSslPtr));
+        if (mKtlsSendFlag || mKtlsRecvFlag) {
+            globals().ctrNetKtlsSessions.Update(1);
+        }
+        if (IsDebugTrace()) {
+            KFS_LOG_STREAM_DEBUG <<
+                "ktls"
+                " impl: "   << reinterpret_cast<const void*>(this) <<
+                " cipher: " << SSL_get_cipher_name(mSslPtr) <<
+                " send: "   << mKtlsSendFlag <<
+                " recv: "   << mKtlsRecvFlag <<
+            KFS_LOG_EOM;
+        }
+#endif
+    }
     int DoHandshake()
     {
         if (SSL_is_init_finished(mSslPtr)) {
             if (! VerifyPeerIfNeeded()) {
                 return -EINVAL;
             }
+            if (! mKtlsCheckedFlag) {
+                UpdateKtls();
+            }
             if (! mServerFlag && ! mSessionStoredFlag) {
                 StoreClientSession();
             }
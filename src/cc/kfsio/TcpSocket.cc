@@ -30,6 +30,7 @@
 #include "common/MsgLogger.h"
 #include "common/IntToString.h"
 #include "qcdio/QCUtils.h"
+#include "qcdio/QCMutex.h"
 #include "qcdio/qcstutils.h"
 
 #include "Globals.h"
@@ -46,15 +47,20 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <ifaddrs.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <vector>
 
 namespace KFS {
 
 using std::min;
 using std::max;
 using std::string;
+using std::vector;
 using KFS::libkfsio::globals;
 
 static inline void
@@ -94,25 +100,24 @@ int TcpSocket::sMaxOpenSockets =  1 << (sizeof(int) * 8 - 2);
 struct TcpSocket::Address
 {
     Address(TcpSocket::Type type)
-        : mProto(type == TcpSocket::kTypeIpV6 ? AF_INET6 : AF_INET)
+        : mProto(type == TcpSocket::kTypeIpV6 ? AF_INET6 :
+            (type == TcpSocket::kTypeLocal ? AF_UNIX : AF_INET))
         { memset(&mIp, 0, sizeof(mIp)); }
     struct sockaddr* Ptr()
     {
         return (mProto == AF_INET ?
             reinterpret_cast<struct sockaddr*>(&mIp.v4) :
-            reinterpret_cast<struct sockaddr*>(&mIp.v6)
+            (mProto == AF_UNIX ?
+                reinterpret_cast<struct sockaddr*>(&mIp.un) :
+                reinterpret_cast<struct sockaddr*>(&mIp.v6))
         );
     }
     const struct sockaddr* Ptr() const
-    {
-        return (mProto == AF_INET ?
-            reinterpret_cast<const struct sockaddr*>(&mIp.v4) :
-            reinterpret_cast<const struct sockaddr*>(&mIp.v6)
-        );
-    }
+        { return const_cast<Address*>(this)->Ptr(); }
     socklen_t Size() const
     {
-        return (socklen_t)(mProto == AF_INET ? sizeof(mIp.v4) : sizeof(mIp.v6));
+        return (socklen_t)(mProto == AF_INET ? sizeof(mIp.v4) :
+            (mProto == AF_UNIX ? sizeof(mIp.un) : sizeof(mIp.v6)));
     }
     void SetAddrAny(int port)
     {
@@ -126,8 +131,25 @@ struct TcpSocket::Address
             mIp.v6.sin6_port   = htons(port);
         }
     }
+    int SetLocal(const string& path)
+    {
+        memset(&mIp, 0, sizeof(mIp));
+        if (path.empty()) {
+            return -EINVAL;
+        }
+        if (sizeof(mIp.un.sun_path) <= path.size()) {
+            return -ENAMETOOLONG;
+        }
+        mProto = AF_UNIX;
+        mIp.un.sun_family = AF_UNIX;
+        memcpy(mIp.un.sun_path, path.data(), path.size());
+        return 0;
+    }
     int GetLocation(ServerLocation& location)
     {
+        if (mProto == AF_UNIX) {
+            return -EAFNOSUPPORT;
+        }
         char ipname[(INET_ADDRSTRLEN < INET6_ADDRSTRLEN ?
             INET6_ADDRSTRLEN : INET_ADDRSTRLEN) + 1];
         const socklen_t size = mProto == AF_INET ?
@@ -143,6 +165,11 @@ struct TcpSocket::Address
     }
     string ToString() const
     {
+        if (mProto == AF_UNIX) {
+            const char* const path = mIp.un.sun_path;
+            return ("unix:" + string(path,
+                strnlen(path, sizeof(mIp.un.sun_path))));
+        }
         char ipname[(INET_ADDRSTRLEN < INET6_ADDRSTRLEN ?
             INET6_ADDRSTRLEN : INET_ADDRSTRLEN) + 1];
         const socklen_t size = mProto == AF_INET ?
@@ -283,8 +310,8 @@ struct TcpSocket::Address
     }
     TcpSocket::Type GetType() const
     {
-        return (mProto == AF_INET6 ?
-            TcpSocket::kTypeIpV6 : TcpSocket::kTypeIpV4);
+        return (mProto == AF_INET6 ? TcpSocket::kTypeIpV6 :
+            (mProto == AF_UNIX ? TcpSocket::kTypeLocal : TcpSocket::kTypeIpV4));
     }
     int GetProtocol() const
         { return mProto; }
@@ -294,6 +321,7 @@ private:
     {
         struct sockaddr_in  v4;
         struct sockaddr_in6 v6;
+        struct sockaddr_un  un;
     } mIp;
 
     void* GetAddr()
@@ -330,6 +358,114 @@ TcpSocket::IsValidConnectToIpAddress(const char* ipAddrPtr)
     return (ipAddrPtr && Address::IsValidConnectToIpAddress(ipAddrPtr));
 }
 
+// Host network interfaces addresses cache. The addresses are fetched with
+// getifaddrs() at most once per refresh interval, in order to avoid the
+// netlink round trip on every local connect attempt.
+class LocalIpAddresses
+{
+public:
+    static bool Has(
+        const struct in_addr* addr4,
+        const struct in6_addr* addr6)
+    {
+        QCStMutexLocker locker(sMutex);
+        const int64_t now = microseconds();
+        if (sNextRefreshUsec <= now) {
+            Refresh();
+            sNextRefreshUsec = now + kRefreshIntervalUsec;
+        }
+        if (addr6) {
+            for (size_t i = 0; i < sAddrs6.size(); i++) {
+                if (0 == memcmp(&sAddrs6[i], addr6, sizeof(*addr6))) {
+                    return true;
+                }
+            }
+        } else {
+            for (size_t i = 0; i < sAddrs4.size(); i++) {
+                if (sAddrs4[i].s_addr == addr4->s_addr) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+private:
+    enum { kRefreshIntervalUsec = 30 * 1000 * 1000 };
+
+    static QCMutex                 sMutex;
+    static int64_t                 sNextRefreshUsec;
+    static vector<struct in_addr>  sAddrs4;
+    static vector<struct in6_addr> sAddrs6;
+
+    static void Refresh()
+    {
+        struct ifaddrs* ifaddr = 0;
+        if (getifaddrs(&ifaddr)) {
+            // Keep the previous addresses, and retry with the next refresh.
+            KFS_LOG_STREAM_ERROR <<
+                "getifaddrs: " << QCUtils::SysError(errno) <<
+            KFS_LOG_EOM;
+            return;
+        }
+        sAddrs4.clear();
+        sAddrs6.clear();
+        for (const struct ifaddrs* ptr = ifaddr; ptr; ptr = ptr->ifa_next) {
+            if (! ptr->ifa_addr) {
+                continue;
+            }
+            if (ptr->ifa_addr->sa_family == AF_INET6) {
+                sAddrs6.push_back(
+                    reinterpret_cast<const struct sockaddr_in6*>(
+                        ptr->ifa_addr)->sin6_addr);
+            } else if (ptr->ifa_addr->sa_family == AF_INET) {
+                sAddrs4.push_back(
+                    reinterpret_cast<const struct sockaddr_in*>(
+                        ptr->ifa_addr)->sin_addr);
+            }
+        }
+        freeifaddrs(ifaddr);
+    }
+};
+QCMutex                 LocalIpAddresses::sMutex;
+int64_t                 LocalIpAddresses::sNextRefreshUsec = 0;
+vector<struct in_addr>  LocalIpAddresses::sAddrs4;
+vector<struct in6_addr> LocalIpAddresses::sAddrs6;
+
+/* static */ bool
+TcpSocket::IsLocalIpAddress(const char* ipAddrPtr)
+{
+    if (! ipAddrPtr) {
+        return false;
+    }
+    struct in_addr  addr4;
+    struct in6_addr addr6;
+    if (strchr(ipAddrPtr, ':')) {
+        if (inet_pton(AF_INET6, ipAddrPtr, &addr6) != 1) {
+            return false;
+        }
+        return (IN6_IS_ADDR_LOOPBACK(&addr6) ||
+            LocalIpAddresses::Has(0, &addr6));
+    }
+    if (inet_pton(AF_INET, ipAddrPtr, &addr4) != 1) {
+        return false;
+    }
+    return ((ntohl(addr4.s_addr) >> 24) == IN_LOOPBACKNET ||
+        LocalIpAddresses::Has(&addr4, 0));
+}
+
+/* static */ string
+TcpSocket::GetLocalSocketPath(const string& dir, int port)
+{
+    string ret(dir);
+    if (! ret.empty() && '/' != *ret.rbegin()) {
+        ret += '/';
+    }
+    ret += "qfs.";
+    AppendDecIntToString(ret, port);
+    ret += ".sock";
+    return ret;
+}
+
 TcpSocket::~TcpSocket()
 {
     Close();
@@ -395,6 +531,42 @@ TcpSocket::Bind(
     return 0;
 }
 
+int
+TcpSocket::BindLocal(const string& path)
+{
+    Close();
+    if (sMaxOpenSockets <= globals().ctrOpenNetFds.GetValue()) {
+        return -ENFILE;
+    }
+    Address addr(kTypeLocal);
+    const int ret = addr.SetLocal(path);
+    if (ret < 0) {
+        return ret;
+    }
+    mSockFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (mSockFd < 0) {
+        return PerrorFatal("socket");
+    }
+    mType = kTypeLocal;
+    if (IsCountableSocketFd(mSockFd)){
+        UpdateSocketCount(1);
+    }
+    if (fcntl(mSockFd, F_SETFD, FD_CLOEXEC)) {
+        Perror("set FD_CLOEXEC");
+    }
+    // Remove stale socket left by the previous instance. Do not remove
+    // anything but sockets in order to guard against misconfiguration.
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode) &&
+            unlink(path.c_str())) {
+        Perror(path.c_str());
+    }
+    if (bind(mSockFd, addr.Ptr(), addr.Size())) {
+        return PerrorFatal(addr);
+    }
+    return 0;
+}
+
 TcpSocket*
 TcpSocket::Accept(int* status /* = 0 */)
 {
@@ -496,6 +668,14 @@ TcpSocket::Connect(const ServerLocation& location, bool nonblockingConnect)
     return (ret < 0 ? ret : Connect(remoteAddr, nonblockingConnect));
 }
 
+int
+TcpSocket::ConnectLocal(const string& path, bool nonblockingConnect)
+{
+    Address remoteAddr(kTypeLocal);
+    const int ret = remoteAddr.SetLocal(path);
+    return (ret < 0 ? ret : Connect(remoteAddr, nonblockingConnect));
+}
+
 void
 TcpSocket::SetupSocket()
 {
@@ -515,7 +695,8 @@ TcpSocket::SetupSocket()
     }
 #endif
     // turn off NAGLE
-    if (SetSockOpt(mSockFd, IPPROTO_TCP, TCP_NODELAY, flag)) {
+    if (kTypeLocal != mType &&
+            SetSockOpt(mSockFd, IPPROTO_TCP, TCP_NODELAY, flag)) {
         Perror("setsockopt TCP_NODELAY");
     }
 
@@ -652,6 +833,20 @@ TcpSocket::GetSocketError() const
     return err;
 }
 
+int
+TcpSocket::GetIncomingCpu() const
+{
+#ifdef SO_INCOMING_CPU
+    int       cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (0 <= mSockFd &&
+            getsockopt(mSockFd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == 0) {
+        return cpu;
+    }
+#endif
+    return -1;
+}
+
 string
 TcpSocket::ToString(const Address& saddr)
 {
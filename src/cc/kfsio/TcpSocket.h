@@ -42,9 +42,10 @@ class TcpSocket
 public:
     enum Type
     {
-        kTypeNone = 0x0,
-        kTypeIpV4 = 0x1,
-        kTypeIpV6 = 0x2
+        kTypeNone  = 0x0,
+        kTypeIpV4  = 0x1,
+        kTypeIpV6  = 0x2,
+        kTypeLocal = 0x4
     };
     enum { kFakeValidFd = ~(1 << (sizeof(int) * 8 - 1)) };
     TcpSocket(
@@ -82,6 +83,10 @@ public:
     /// Setup and bind TCP socket to the port specified.
     int Bind(const ServerLocation& location, Type type, bool ipV6OnlyFlag);
 
+    /// Setup and bind unix domain socket to the path specified. The stale
+    /// socket file left by the previous process, if any, is removed.
+    int BindLocal(const string& path);
+
     /// Start listening;
     int StartListening(bool nonBlockingAccept, int maxQueue = 8192);
 
@@ -100,6 +105,9 @@ public:
     /// nonblockingConnect and connect returned that error code
     int Connect(const ServerLocation& location, bool nonblockingConnect);
 
+    /// Connect to the unix domain socket bound to the path specified.
+    int ConnectLocal(const string& path, bool nonblockingConnect);
+
     /// Peek to see if any data is available.  This call will not
     /// remove the data from the underlying socket buffers.
     /// @retval Returns # of bytes copied in or -1 if there was an error.
@@ -132,10 +140,20 @@ public:
     int Shutdown() { return Shutdown(true, true); }
     /// Get and clear pending socket error: getsockopt(SO_ERROR)
     int GetSocketError() const;
+    /// Cpu that processed the most recent incoming packet, or -1 if unknown.
+    int GetIncomingCpu() const;
     Type GetType() const { return mType; }
+    bool IsLocal() const { return (kTypeLocal == mType); }
     static int Validate(const string& address);
     static bool IsValidConnectToAddress(const ServerLocation& location);
     static bool IsValidConnectToIpAddress(const char* ipAddrPtr);
+    /// Return true if the address is loopback address, or is assigned to one
+    /// of the host network interfaces. The interfaces addresses are cached,
+    /// and refreshed every 30 seconds.
+    static bool IsLocalIpAddress(const char* ipAddrPtr);
+    /// Unix domain socket path of the server listening on the port, with the
+    /// socket directory specified.
+    static string GetLocalSocketPath(const string& dir, int port);
     static int GetDefaultRecvBufSize() { return sRecvBufSize; }
     static int GetDefaultSendBufSize() { return sSendBufSize; }
     static void SetDefaultRecvBufSize(int size) { sRecvBufSize = size; }
@@ -31,6 +31,8 @@
 #include "KfsNetClient.h"
 
 #include <map>
+#include <vector>
+#include <algorithm>
 #include <utility>
 #include <sstream>
 
@@ -42,17 +44,52 @@ namespace client
 using std::pair;
 using std::make_pair;
 using std::map;
+using std::vector;
+using std::max;
 using std::less;
 using std::ostringstream;
 using std::string;
 
 // Client connection (KfsNetClient) pool. Used to reduce number of chunk
-// server connections. Presently used only with radix sort with write append
-// with M clients each appending to N buckets.
+// server connections. Presently used with radix sort with write append with M
+// clients each appending to N buckets, by the readers with the
+// "client.connectionPool" option, and by the process wide shared pool used by
+// all protocol workers with "client.sharedConnectionPool" option.
+// Connections are not shared between different authentication contexts, i.e.
+// between different users. Up to max clients per server connections are
+// created per chunk server and authentication context. The connection with the
+// least number of pending ops is used, and a new connection is created only if
+// all existing connections have pending ops.
 class ClientPool
 {
 public:
     typedef KfsNetClient::Stats Stats;
+    struct Counters
+    {
+        typedef int64_t Counter;
+
+        Counters()
+            : mGetCount(0),
+              mReuseCount(0),
+              mCreateCount(0),
+              mRemoveCount(0)
+            {}
+        void Clear()
+            { *this = Counters(); }
+        template<typename T>
+        void Enumerate(
+            T& inFunctor) const
+        {
+            inFunctor("Get",    mGetCount);
+            inFunctor("Reuse",  mReuseCount);
+            inFunctor("Create", mCreateCount);
+            inFunctor("Remove", mRemoveCount);
+        }
+        Counter mGetCount;
+        Counter mReuseCount;
+        Counter mCreateCount;
+        Counter mRemoveCount;
+    };
 
     ClientPool(
         NetManager&        inNetManager,
@@ -67,7 +104,8 @@ public:
         int                inMaxContentLength               = MAX_RPC_HEADER_LEN,
         bool               inFailAllOpsOnOpTimeoutFlag      = false,
         bool               inMaxOneOutstandingOpFlag        = false,
-        ClientAuthContext* inAuthContextPtr                 = 0)
+        ClientAuthContext* inAuthContextPtr                 = 0,
+        int                inMaxClientsPerServer            = 1)
         : mClients(),
           mNetManager(inNetManager),
           mMaxRetryCount(inMaxRetryCount),
@@ -81,47 +119,105 @@ public:
           mMaxContentLength(inMaxContentLength),
           mFailAllOpsOnOpTimeoutFlag(inFailAllOpsOnOpTimeoutFlag),
           mMaxOneOutstandingOpFlag(inMaxOneOutstandingOpFlag),
-          mAuthContextPtr(inAuthContextPtr)
+          mAuthContextPtr(inAuthContextPtr),
+          mMaxClientsPerServer(max(1, inMaxClientsPerServer)),
+          mSize(0),
+          mCounters()
         {}
     ~ClientPool()
     {
         for (Clients::const_iterator it = mClients.begin();
                 it != mClients.end();
                 ++it) {
-            delete it->second;
+            for (ServerClients::const_iterator
+                    theIt = it->second.begin();
+                    theIt != it->second.end();
+                    ++theIt) {
+                delete *theIt;
+            }
         }
     }
     KfsNetClient& Get(
-        const ServerLocation& inLocation,
-        bool                  inShortRpcFormatFlag)
+        const ServerLocation&    inLocation,
+        bool                     inShortRpcFormatFlag,
+        const ClientAuthContext* inAuthContextPtr = 0)
+    {
+        mCounters.mGetCount++;
+        ServerClients& theClients =
+            mClients[make_pair(inLocation, inAuthContextPtr)];
+        KfsNetClient* theClientPtr       = 0;
+        size_t        theMinPendingCount = 0;
+        for (ServerClients::const_iterator theIt = theClients.begin();
+                theIt != theClients.end();
+                ++theIt) {
+            const size_t theCount = (*theIt)->GetPendingOpsCount();
+            if (! theClientPtr || theCount < theMinPendingCount) {
+                theClientPtr       = *theIt;
+                theMinPendingCount = theCount;
+                if (theCount <= 0) {
+                    break;
+                }
+            }
+        }
+        if (theClientPtr && (theMinPendingCount <= 0 ||
+                mMaxClientsPerServer <= (int)theClients.size())) {
+            mCounters.mReuseCount++;
+            return *theClientPtr;
+        }
+        ostringstream theStream;
+        theStream <<
+            mLogPrefix << (mLogPrefix.empty() ? "" : ":") <<
+            inLocation.hostname << ":" << inLocation.port;
+        if (! theClients.empty()) {
+            theStream << "#" << theClients.size();
+        }
+        const string thePrefix = theStream.str();
+        theClientPtr = new KfsNetClient(
+            mNetManager,
+            inLocation.hostname,
+            inLocation.port,
+            mMaxRetryCount,
+            mTimeSecBetweenRetries,
+            mOpTimeoutSec,
+            mIdleTimeoutSec,
+            mInitialSeqNum++,
+            thePrefix.c_str(),
+            mResetConnectionOnOpTimeoutFlag,
+            mMaxContentLength,
+            mFailAllOpsOnOpTimeoutFlag,
+            mMaxOneOutstandingOpFlag,
+            mAuthContextPtr
+        );
+        theClients.push_back(theClientPtr);
+        mSize++;
+        mCounters.mCreateCount++;
+        theClientPtr->SetRetryConnectOnly(mRetryConnectOnlyFlag);
+        theClientPtr->SetRpcFormat(inShortRpcFormatFlag ?
+            KfsNetClient::kRpcFormatShort : KfsNetClient::kRpcFormatLong);
+        return *theClientPtr;
+    }
+    // Delete all clients with the specified authentication context. The
+    // clients must not be in use, i.e. all the clients' users with this
+    // authentication context must be already deleted.
+    void Remove(
+        const ClientAuthContext* inAuthContextPtr)
     {
-        Clients::iterator it = mClients.find(inLocation);
-        if (it == mClients.end()) {
-            ostringstream theStream;
-            theStream <<
-                mLogPrefix << (mLogPrefix.empty() ? "" : ":") <<
-                inLocation.hostname << ":" << inLocation.port;
-            const string thePrefix = theStream.str();
-            it = mClients.insert(make_pair(inLocation, new KfsNetClient(
-                mNetManager,
-                inLocation.hostname,
-                inLocation.port,
-                mMaxRetryCount,
-                mTimeSecBetweenRetries,
-                mOpTimeoutSec,
-                mIdleTimeoutSec,
-                mInitialSeqNum++,
-                thePrefix.c_str(),
-                mResetConnectionOnOpTimeoutFlag,
-                mMaxContentLength,
-                mFailAllOpsOnOpTimeoutFlag,
-                mMaxOneOutstandingOpFlag,
-                mAuthContextPtr))).first;
-            it->second->SetRetryConnectOnly(mRetryConnectOnlyFlag);
-            it->second->SetRpcFormat(inShortRpcFormatFlag ?
-                KfsNetClient::kRpcFormatShort : KfsNetClient::kRpcFormatLong);
+        Clients::iterator it = mClients.begin();
+        while (it != mClients.end()) {
+            if (it->first.second != inAuthContextPtr) {
+                ++it;
+                continue;
+            }
+            for (ServerClients::const_iterator
+                    theIt = it->second.begin();
+                    theIt != it->second.end();
+                    ++theIt) {
+                delete *theIt;
+                mSize--;
+                mCounters.mRemoveCount++;
+            }
+            mClients.erase(it++);
         }
-        return *(it->second);
     }
     void GetStats(
         Stats& outStats) const
@@ -131,10 +227,18 @@ public:
         for (Clients::const_iterator it = mClients.begin();
                 it != mClients.end();
                 ++it) {
-            it->second->GetStats(theStats);
-            outStats.Add(theStats);
+            for (ServerClients::const_iterator
+                    theIt = it->second.begin();
+                    theIt != it->second.end();
+                    ++theIt) {
+                (*theIt)->GetStats(theStats);
+                outStats.Add(theStats);
+            }
         }
     }
+    void GetCounters(
+        Counters& outCounters) const
+        { outCounters = mCounters; }
     void ClearMaxOneOutstandingOpFlag(
         bool inFailAllOpsOnOpTimeoutFlag)
     {
@@ -143,32 +247,63 @@ public:
                 return;
             }
             mFailAllOpsOnOpTimeoutFlag = inFailAllOpsOnOpTimeoutFlag;
-            for (Clients::const_iterator theIt = mClients.begin();
-                    theIt != mClients.end();
-                    ++theIt) {
-                theIt->second->SetFailAllOpsOnOpTimeoutFlag(
-                    mFailAllOpsOnOpTimeoutFlag);
+            for (Clients::const_iterator it = mClients.begin();
+                    it != mClients.end();
+                    ++it) {
+                for (ServerClients::const_iterator
+                        theIt = it->second.begin();
+                        theIt != it->second.end();
+                        ++theIt) {
+                    (*theIt)->SetFailAllOpsOnOpTimeoutFlag(
+                        mFailAllOpsOnOpTimeoutFlag);
+                }
             }
             return;
         }
         mMaxOneOutstandingOpFlag   = false;
         mFailAllOpsOnOpTimeoutFlag = inFailAllOpsOnOpTimeoutFlag;
-        for (Clients::const_iterator theIt = mClients.begin();
-                theIt != mClients.end();
-                ++theIt) {
-            theIt->second->SetFailAllOpsOnOpTimeoutFlag(
-                mFailAllOpsOnOpTimeoutFlag);
-            theIt->second->ClearMaxOneOutstandingOpFlag();
+        for (Clients::const_iterator it = mClients.begin();
+                it != mClients.end();
+                ++it) {
+            for (ServerClients::const_iterator
+                    theIt = it->second.begin();
+                    theIt != it->second.end();
+                    ++theIt) {
+                (*theIt)->SetFailAllOpsOnOpTimeoutFlag(
+                    mFailAllOpsOnOpTimeoutFlag);
+                (*theIt)->ClearMaxOneOutstandingOpFlag();
+            }
+        }
+    }
+    // Increase max content length of the existing and new clients.
+    void SetMinMaxContentLength(
+        int inMaxContentLength)
+    {
+        if (inMaxContentLength <= mMaxContentLength) {
+            return;
+        }
+        mMaxContentLength = inMaxContentLength;
+        for (Clients::const_iterator it = mClients.begin();
+                it != mClients.end();
+                ++it) {
+            for (ServerClients::const_iterator
+                    theIt = it->second.begin();
+                    theIt != it->second.end();
+                    ++theIt) {
+                (*theIt)->SetMaxContentLength(mMaxContentLength);
+            }
         }
     }
     size_t GetSize() const
-        { return mClients.size(); }
+        { return mSize; }
 private:
+    typedef pair<ServerLocation, const ClientAuthContext*> Key;
+    typedef vector<KfsNetClient*>                          ServerClients;
     typedef map<
-        ServerLocation,
-        KfsNetClient*,
-        less<ServerLocation>,
-        StdFastAllocator<pair<const ServerLocation, KfsNetClient*> >
+        Key,
+        ServerClients,
+        less<Key>,
+        StdFastAllocator<pair<const Key, ServerClients> >
     > Clients;
     Clients            mClients;
     NetManager&        mNetManager;
@@ -184,6 +319,9 @@ private:
     bool               mFailAllOpsOnOpTimeoutFlag;
     bool               mMaxOneOutstandingOpFlag;
     ClientAuthContext* mAuthContextPtr;
+    const int          mMaxClientsPerServer;
+    size_t             mSize;
+    Counters           mCounters;
 private:
     ClientPool(
         const ClientPool& inPool);
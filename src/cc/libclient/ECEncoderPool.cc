@@ -0,0 +1,390 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// Erasure code encoder thread pool implementation. The batches with unclaimed
+// tasks are kept in the FIFO list. The pool threads claim ranges of tasks from
+// the oldest batch, while the thread that executes the batch claims tasks only
+// from its own batch, then waits for the pool threads to finish the claimed
+// ranges.
+//
+//----------------------------------------------------------------------------
+
+#include "ECEncoderPool.h"
+
+#include "common/time.h"
+
+#include "qcdio/QCThread.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
+#include "qcdio/qcdebug.h"
+
+#include <algorithm>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace KFS
+{
+namespace client
+{
+using std::min;
+using std::max;
+
+class ECEncoderPool::Impl
+{
+public:
+    typedef QCDLList<Batch, 0> Queue;
+
+    static Impl& Get()
+    {
+        static Impl sImpl;
+        return sImpl;
+    }
+    int Execute(
+        Batch&  inBatch,
+        int64_t inByteCount)
+    {
+        const int theCount = (int)inBatch.mLengths.size();
+        QCStMutexLocker theLock(mMutex);
+        mStats.mBatchCount++;
+        mStats.mTaskCount += theCount;
+        mStats.mByteCount += inByteCount;
+        if (mThreadCount <= 0 || theCount < 2 ||
+                inByteCount < mMinBatchBytes) {
+            mStats.mInlineBatchCount++;
+            return RunInline(inBatch, theLock);
+        }
+        if (0 < mQueuedBytes && mMaxQueuedBytes < mQueuedBytes + inByteCount) {
+            // Back pressure: the pool is busy, use the calling thread.
+            mStats.mThrottledBatchCount++;
+            return RunInline(inBatch, theLock);
+        }
+        if (mThreads.empty()) {
+            StartThreads();
+        }
+        inBatch.mNextIdx     = 0;
+        inBatch.mClaimCount  = max(1, theCount / (2 * (mThreadCount + 1)));
+        inBatch.mDoneCount   = 0;
+        inBatch.mStatus      = 0;
+        inBatch.mQueuedBytes = inByteCount;
+        mQueuedBytes        += inByteCount;
+        mStats.mQueueDepth  += theCount;
+        mStats.mMaxQueueDepth = max(mStats.mMaxQueueDepth, mStats.mQueueDepth);
+        Queue::PushBack(mQueue, inBatch);
+        mWorkCond.NotifyAll();
+        int theStart;
+        int theEnd;
+        while (Claim(inBatch, theStart, theEnd)) {
+            Run(inBatch, theStart, theEnd, false);
+        }
+        while (inBatch.mDoneCount < theCount) {
+            inBatch.mWaitingFlag = true;
+            mDoneCond.Wait(mMutex);
+        }
+        inBatch.mWaitingFlag = false;
+        return inBatch.mStatus;
+    }
+    void GetStats(
+        Stats& outStats)
+    {
+        QCStMutexLocker theLock(mMutex);
+        outStats = mStats;
+        outStats.mThreadCount = (int64_t)mThreads.size();
+    }
+private:
+    class Worker : public QCRunnable
+    {
+    public:
+        Worker(
+            Impl& inImpl)
+            : QCRunnable(),
+              mImpl(inImpl),
+              mThread()
+            {}
+        virtual ~Worker()
+            {}
+        void Start()
+        {
+            const int kStackSize = 64 << 10;
+            mThread.Start(this, kStackSize, "ECEncoder");
+        }
+        void Join()
+            { mThread.Join(); }
+        virtual void Run()
+            { mImpl.Work(); }
+    private:
+        Impl&    mImpl;
+        QCThread mThread;
+    };
+    typedef vector<Worker*> Threads;
+
+    QCMutex   mMutex;
+    QCCondVar mWorkCond;
+    QCCondVar mDoneCond;
+    Batch*    mQueue[1];
+    Threads   mThreads;
+    int       mThreadCount;
+    int64_t   mMaxQueuedBytes;
+    int64_t   mMinBatchBytes;
+    int64_t   mQueuedBytes;
+    bool      mStopFlag;
+    Stats     mStats;
+
+    Impl()
+        : mMutex(),
+          mWorkCond(),
+          mDoneCond(),
+          mThreads(),
+          mThreadCount(GetEnv("QFS_CLIENT_EC_ENCODER_THREADS",
+            min(int64_t(8), max(int64_t(0),
+                (int64_t)sysconf(_SC_NPROCESSORS_ONLN) - 1)))),
+          mMaxQueuedBytes(GetEnv("QFS_CLIENT_EC_ENCODER_MAX_QUEUED_BYTES",
+            int64_t(256) << 20)),
+          mMinBatchBytes(GetEnv("QFS_CLIENT_EC_ENCODER_MIN_BATCH_BYTES",
+            int64_t(256) << 10)),
+          mQueuedBytes(0),
+          mStopFlag(false),
+          mStats()
+        { Queue::Init(mQueue); }
+    ~Impl()
+    {
+        QCStMutexLocker theLock(mMutex);
+        mStopFlag = true;
+        mWorkCond.NotifyAll();
+        Threads theThreads;
+        theThreads.swap(mThreads);
+        {
+            QCStMutexUnlocker theUnlock(mMutex);
+            for (Threads::const_iterator theIt = theThreads.begin();
+                    theIt != theThreads.end();
+                    ++theIt) {
+                (*theIt)->Join();
+                delete *theIt;
+            }
+        }
+    }
+    static int64_t GetEnv(
+        const char* inNamePtr,
+        int64_t     inDefault)
+    {
+        const char* const thePtr = getenv(inNamePtr);
+        if (! thePtr || ! *thePtr) {
+            return inDefault;
+        }
+        char*         theEndPtr = 0;
+        const int64_t theRet    = (int64_t)strtoll(thePtr, &theEndPtr, 0);
+        return ((theEndPtr && *theEndPtr == 0) ? theRet : inDefault);
+    }
+    void StartThreads()
+    {
+        for (int i = 0; i < mThreadCount; i++) {
+            Worker* const theWorkerPtr = new Worker(*this);
+            mThreads.push_back(theWorkerPtr);
+            theWorkerPtr->Start();
+        }
+    }
+    bool Claim(
+        Batch& inBatch,
+        int&   outStart,
+        int&   outEnd)
+    {
+        const int theCount = (int)inBatch.mLengths.size();
+        if (theCount <= inBatch.mNextIdx) {
+            return false;
+        }
+        outStart = inBatch.mNextIdx;
+        outEnd   = min(theCount, outStart + inBatch.mClaimCount);
+        inBatch.mNextIdx = outEnd;
+        int64_t theBytes = 0;
+        for (int i = outStart; i < outEnd; i++) {
+            theBytes += inBatch.mLengths[i];
+        }
+        theBytes *= inBatch.mStripeCount;
+        inBatch.mQueuedBytes -= theBytes;
+        mQueuedBytes         -= theBytes;
+        mStats.mQueueDepth   -= outEnd - outStart;
+        if (theCount <= outEnd) {
+            Queue::Remove(mQueue, inBatch);
+        }
+        return true;
+    }
+    void Run(
+        Batch& inBatch,
+        int    inStart,
+        int    inEnd,
+        bool   inOffloadedFlag)
+    {
+        int64_t theCpuTime;
+        int     theStatus;
+        {
+            QCStMutexUnlocker theUnlock(mMutex);
+            theCpuTime = threadcputime();
+            theStatus  = inBatch.Run(inStart, inEnd);
+            theCpuTime = threadcputime() - theCpuTime;
+        }
+        if (theStatus != 0 && inBatch.mStatus == 0) {
+            inBatch.mStatus = theStatus;
+        }
+        inBatch.mCpuMicroSec += theCpuTime;
+        mStats.mCpuMicroSec  += theCpuTime;
+        if (inOffloadedFlag) {
+            inBatch.mOffloadedCount      += inEnd - inStart;
+            mStats.mOffloadedTaskCount   += inEnd - inStart;
+        }
+        inBatch.mDoneCount += inEnd - inStart;
+        if ((int)inBatch.mLengths.size() <= inBatch.mDoneCount &&
+                inBatch.mWaitingFlag) {
+            mDoneCond.NotifyAll();
+        }
+    }
+    int RunInline(
+        Batch&                 inBatch,
+        const QCStMutexLocker& /* inLock */)
+    {
+        const int theCount = (int)inBatch.mLengths.size();
+        inBatch.mStatus    = 0;
+        inBatch.mNextIdx   = theCount;
+        inBatch.mDoneCount = 0;
+        Run(inBatch, 0, theCount, false);
+        return inBatch.mStatus;
+    }
+    void Work()
+    {
+        QCStMutexLocker theLock(mMutex);
+        while (! mStopFlag) {
+            Batch* const theBatchPtr = Queue::Front(mQueue);
+            int          theStart;
+            int          theEnd;
+            if (! theBatchPtr || ! Claim(*theBatchPtr, theStart, theEnd)) {
+                mWorkCond.Wait(mMutex);
+                continue;
+            }
+            // The batch can be deleted by its owner after Run() returns.
+            Run(*theBatchPtr, theStart, theEnd, true);
+        }
+    }
+private:
+    Impl(
+        const Impl& inImpl);
+    Impl& operator=(
+        const Impl& inImpl);
+};
+
+ECEncoderPool::Batch::Batch()
+    : mEncoderPtr(0),
+      mStripeCount(0),
+      mRecoveryStripeCount(0),
+      mBuffers(),
+      mLengths(),
+      mQueuedBytes(0),
+      mNextIdx(0),
+      mClaimCount(1),
+      mDoneCount(0),
+      mStatus(0),
+      mWaitingFlag(false),
+      mByteCount(0),
+      mCpuMicroSec(0),
+      mOffloadedCount(0)
+{
+    Impl::Queue::Init(*this);
+}
+
+ECEncoderPool::Batch::~Batch()
+{
+    QCASSERT(mNextIdx <= mDoneCount);
+}
+
+void
+ECEncoderPool::Batch::Clear()
+{
+    mBuffers.clear();
+    mLengths.clear();
+}
+
+void**
+ECEncoderPool::Batch::Add(
+    ECMethod::Encoder& inEncoder,
+    int                inStripeCount,
+    int                inRecoveryStripeCount,
+    int                inLength)
+{
+    QCASSERT(mLengths.empty() || (mEncoderPtr == &inEncoder &&
+        mStripeCount == inStripeCount &&
+        mRecoveryStripeCount == inRecoveryStripeCount));
+    mEncoderPtr          = &inEncoder;
+    mStripeCount         = inStripeCount;
+    mRecoveryStripeCount = inRecoveryStripeCount;
+    const size_t theSize = mBuffers.size();
+    mBuffers.resize(theSize + inStripeCount + inRecoveryStripeCount);
+    mLengths.push_back(inLength);
+    return &mBuffers[theSize];
+}
+
+int
+ECEncoderPool::Batch::Execute()
+{
+    mByteCount      = 0;
+    mCpuMicroSec    = 0;
+    mOffloadedCount = 0;
+    if (mLengths.empty()) {
+        return 0;
+    }
+    int64_t theBytes = 0;
+    for (vector<int>::const_iterator theIt = mLengths.begin();
+            theIt != mLengths.end();
+            ++theIt) {
+        theBytes += *theIt;
+    }
+    theBytes *= mStripeCount;
+    const int theStatus = Impl::Get().Execute(*this, theBytes);
+    mByteCount = theBytes;
+    Clear();
+    return theStatus;
+}
+
+int
+ECEncoderPool::Batch::Run(
+    int inStart,
+    int inEnd)
+{
+    const int theStride = mStripeCount + mRecoveryStripeCount;
+    for (int i = inStart; i < inEnd; i++) {
+        const int theStatus = mEncoderPtr->Encode(
+            mStripeCount,
+            mRecoveryStripeCount,
+            mLengths[i],
+            &mBuffers[i * theStride]
+        );
+        if (theStatus != 0) {
+            return theStatus;
+        }
+    }
+    return 0;
+}
+
+/* static */ void
+ECEncoderPool::GetStats(
+    ECEncoderPool::Stats& outStats)
+{
+    Impl::Get().GetStats(outStats);
+}
+
+}} /* namespace client KFS */
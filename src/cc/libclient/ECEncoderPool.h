@@ -0,0 +1,161 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// Erasure code encoder thread pool. The striper adds the encode requests for
+// the strides it has buffered into a batch, and executes the batch. The batch
+// tasks are run by the pool threads and by the calling thread, and the
+// execution returns when all tasks of the batch are complete, thus the
+// recovery stripes of each file are computed and written in order.
+//
+// The pool is configured with the following environment variables:
+// QFS_CLIENT_EC_ENCODER_THREADS -- number of pool threads, 0 disables the
+// pool, the default is min(8, number of cpus - 1).
+// QFS_CLIENT_EC_ENCODER_MAX_QUEUED_BYTES -- when the amount of data queued to
+// the pool exceeds the limit, the batch is executed by the calling thread.
+// QFS_CLIENT_EC_ENCODER_MIN_BATCH_BYTES -- smaller batches are executed by the
+// calling thread.
+//
+//----------------------------------------------------------------------------
+
+#ifndef KFS_LIBCLIENT_ECENCODERPOOL_H
+#define KFS_LIBCLIENT_ECENCODERPOOL_H
+
+#include "ECMethod.h"
+
+#include "qcdio/QCDLList.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace KFS
+{
+namespace client
+{
+using std::vector;
+
+class ECEncoderPool
+{
+private:
+    class Impl;
+public:
+    struct Stats
+    {
+        typedef int64_t Counter;
+        Stats()
+            : mThreadCount(0),
+              mQueueDepth(0),
+              mMaxQueueDepth(0),
+              mBatchCount(0),
+              mInlineBatchCount(0),
+              mThrottledBatchCount(0),
+              mTaskCount(0),
+              mOffloadedTaskCount(0),
+              mByteCount(0),
+              mCpuMicroSec(0)
+            {}
+        template<typename T>
+        void Enumerate(
+            T& inFunctor) const
+        {
+            inFunctor("Threads",        mThreadCount);
+            inFunctor("QueueDepth",     mQueueDepth);
+            inFunctor("MaxQueueDepth",  mMaxQueueDepth);
+            inFunctor("Batches",        mBatchCount);
+            inFunctor("InlineBatches",  mInlineBatchCount);
+            inFunctor("Throttled",      mThrottledBatchCount);
+            inFunctor("Tasks",          mTaskCount);
+            inFunctor("OffloadedTasks", mOffloadedTaskCount);
+            inFunctor("Bytes",          mByteCount);
+            inFunctor("CpuMicroSec",    mCpuMicroSec);
+        }
+        Counter mThreadCount;
+        Counter mQueueDepth;
+        Counter mMaxQueueDepth;
+        Counter mBatchCount;
+        Counter mInlineBatchCount;
+        Counter mThrottledBatchCount;
+        Counter mTaskCount;
+        Counter mOffloadedTaskCount;
+        Counter mByteCount;
+        Counter mCpuMicroSec;
+    };
+    class Batch
+    {
+    public:
+        Batch();
+        ~Batch();
+        void Clear();
+        // Adds encode task, and returns pointer to the stripe buffers array
+        // of inStripeCount + inRecoveryStripeCount entries to fill in. All
+        // tasks in the batch must have the same stripe counts and encoder.
+        void** Add(
+            ECMethod::Encoder& inEncoder,
+            int                inStripeCount,
+            int                inRecoveryStripeCount,
+            int                inLength);
+        // Executes all tasks, and returns the first non 0 encoder status, if
+        // any. The batch is empty on return.
+        int Execute();
+        bool IsEmpty() const
+            { return mLengths.empty(); }
+        // Stats of the last Execute() invocation.
+        int64_t GetByteCount() const
+            { return mByteCount; }
+        int64_t GetCpuMicroSec() const
+            { return mCpuMicroSec; }
+        int64_t GetOffloadedCount() const
+            { return mOffloadedCount; }
+    private:
+        ECMethod::Encoder* mEncoderPtr;
+        int                mStripeCount;
+        int                mRecoveryStripeCount;
+        vector<void*>      mBuffers;
+        vector<int>        mLengths;
+        int64_t            mQueuedBytes;
+        int                mNextIdx;
+        int                mClaimCount;
+        int                mDoneCount;
+        int                mStatus;
+        bool               mWaitingFlag;
+        int64_t            mByteCount;
+        int64_t            mCpuMicroSec;
+        int64_t            mOffloadedCount;
+        Batch*             mPrevPtr[1];
+        Batch*             mNextPtr[1];
+
+        int Run(
+            int inStart,
+            int inEnd);
+        friend class Impl;
+        friend class QCDLListOp<Batch, 0>;
+    private:
+        Batch(
+            const Batch& inBatch);
+        Batch& operator=(
+            const Batch& inBatch);
+    };
+    static void GetStats(
+        Stats& outStats);
+};
+
+}} /* namespace client KFS */
+
+#endif /* KFS_LIBCLIENT_ECENCODERPOOL_H */
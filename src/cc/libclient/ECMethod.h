@@ -41,12 +41,19 @@ public:
     class Encoder
     {
     public:
+        // Encode must be reentrant, as the same encoder instance can be
+        // invoked concurrently by the encoder pool threads.
         virtual int Encode(
             int    inStripeCount,
             int    inRecoveryStripeCount,
             int    inLength,
             void** inBuffersPtr) = 0;
         virtual void Release() = 0;
+        // Returns max. number of stripes that can always be rebuilt.
+        virtual int GetMaxFailureCount(
+            int /* inStripeCount */,
+            int inRecoveryStripeCount) const
+            { return inRecoveryStripeCount; }
     protected:
         Encoder()
             {}
@@ -71,6 +78,37 @@ public:
             int const* inMissingStripesIdx) = 0;
         virtual void Release() = 0;
         virtual bool SupportsOneRecoveryStripeRebuild() const = 0;
+        // Codes where not any inStripeCount stripes are sufficient to
+        // rebuild the remaining stripes must return false. For such codes
+        // the missing stripe list passed to Decode() is terminated by -1,
+        // can have less than inRecoveryStripeCount entries, and Decode()
+        // must return non 0 if the missing stripes cannot be rebuilt.
+        virtual bool IsMaximumDistanceSeparable() const
+            { return true; }
+        // Returns true if Decode() can rebuild the stripes with the
+        // specified -1 terminated list of missing stripe indices.
+        virtual bool CanDecode(
+            int        /* inStripeCount */,
+            int        inRecoveryStripeCount,
+            int const* inMissingStripesIdxPtr) const
+        {
+            int theCnt = 0;
+            while (0 <= inMissingStripesIdxPtr[theCnt]) {
+                theCnt++;
+            }
+            return (theCnt <= inRecoveryStripeCount);
+        }
+        // Local repair support. Returns the number of stripes, and their
+        // indices, local parity stripe last, xor of which is the stripe
+        // with the specified index, or 0 if the stripe can only be rebuilt
+        // with Decode(). The index buffer must have room for inStripeCount
+        // entries.
+        virtual int GetLocalRepairStripes(
+            int  /* inStripeCount */,
+            int  /* inRecoveryStripeCount */,
+            int  /* inStripeIdx */,
+            int* /* outStripesIdxPtr */) const
+            { return 0; }
     protected:
         Decoder()
             {}
@@ -0,0 +1,570 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/19
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// Locally repairable code erasure method. The stripe layout is defined in
+// common/kfstypes.h: each local parity stripe is xor of the data stripes in
+// its group, global parity stripe j is sum of a^((i + 1) * (j + 1)) * d[i]
+// over all data stripes i in GF(2^8). Single data or local parity stripe
+// failure can be repaired by reading only the stripes of its local group.
+// Any global parity count + 1 failures can be repaired with Decode().
+// GF(2^8) arithmetic is provided by qcrs, the field is the same as the one
+// used by the Reed-Solomon coder.
+//
+//----------------------------------------------------------------------------
+
+#include "ECMethodDef.h"
+
+#include "common/kfstypes.h"
+#include "common/IntToString.h"
+#include "common/StBuffer.h"
+
+#include "qcdio/QCUtils.h"
+#include "qcrs/rs.h"
+
+#include <algorithm>
+
+#include <string.h>
+#include <stdint.h>
+
+namespace KFS
+{
+namespace client
+{
+
+using std::min;
+
+class LrcECMethod : public ECMethod
+{
+public:
+    static ECMethod* GetMethod()
+    {
+        static LrcECMethod sMethod;
+        return &sMethod;
+    }
+protected:
+    LrcECMethod()
+        : ECMethod(),
+          mDescription(Describe()),
+          mCoder()
+        {}
+    virtual ~LrcECMethod()
+    {
+        LrcECMethod::Unregister(KFS_STRIPED_FILE_TYPE_LRC);
+    }
+    virtual bool Init(
+        int inMethodType)
+    {
+        QCRTASSERT(inMethodType == KFS_STRIPED_FILE_TYPE_LRC);
+        return (inMethodType == KFS_STRIPED_FILE_TYPE_LRC);
+    }
+    virtual string GetDescription() const
+        { return mDescription; }
+    void Release(
+        int inMethodType)
+    {
+        QCRTASSERT(inMethodType == KFS_STRIPED_FILE_TYPE_LRC);
+    }
+    virtual Encoder* GetEncoder(
+        int     inMethodType,
+        int     inStripeCount,
+        int     inRecoveryStripeCount,
+        string* outErrMsgPtr)
+    {
+        QCRTASSERT(inMethodType == KFS_STRIPED_FILE_TYPE_LRC);
+        if (! Validate(inMethodType, inStripeCount, inRecoveryStripeCount,
+                outErrMsgPtr)) {
+            return 0;
+        }
+        return &mCoder;
+    }
+    virtual Decoder* GetDecoder(
+        int     inMethodType,
+        int     inStripeCount,
+        int     inRecoveryStripeCount,
+        string* outErrMsgPtr)
+    {
+        QCRTASSERT(inMethodType == KFS_STRIPED_FILE_TYPE_LRC);
+        if (! Validate(inMethodType, inStripeCount, inRecoveryStripeCount,
+                outErrMsgPtr)) {
+            return 0;
+        }
+        return &mCoder;
+    };
+    virtual bool Validate(
+        int     inMethodType,
+        int     inStripeCount,
+        int     inRecoveryStripeCount,
+        string* outErrMsgPtr)
+    {
+        if (inMethodType != KFS_STRIPED_FILE_TYPE_LRC) {
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = "LRC: invalid method type";
+            }
+            return false;
+        }
+        if (inRecoveryStripeCount < kMinRecoveryStripeCount ||
+                KFS_MAX_RECOVERY_STRIPE_COUNT < inRecoveryStripeCount) {
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = "LRC: invalid recovery stripe count";
+            }
+            return false;
+        }
+        if (inStripeCount < GetLrcLocalGroupCount(inRecoveryStripeCount) ||
+                kMaxStripeCount < inStripeCount + inRecoveryStripeCount) {
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = "LRC: invalid data stripe count";
+            }
+            return false;
+        }
+        return true;
+    }
+private:
+    enum { kMinRecoveryStripeCount = 2 };
+    enum { kMaxStripeCount         = 255 };
+    enum { kBlockSize              = 4 << 10 };
+
+    class LrcCoder :
+        public ECMethod::Encoder,
+        public ECMethod::Decoder
+    {
+    public:
+        LrcCoder()
+            : ECMethod::Encoder(),
+              ECMethod::Decoder()
+            {}
+        virtual ~LrcCoder()
+            {}
+        virtual int Encode(
+            int    inStripeCount,
+            int    inRecoveryStripeCount,
+            int    inLength,
+            void** inBuffersPtr)
+        {
+            for (int i = 0; i < inRecoveryStripeCount; i++) {
+                EncodeStripe(inStripeCount, inRecoveryStripeCount, inLength,
+                    inBuffersPtr, i);
+            }
+            return 0;
+        }
+        virtual int GetMaxFailureCount(
+            int /* inStripeCount */,
+            int inRecoveryStripeCount) const
+        {
+            return (inRecoveryStripeCount -
+                GetLrcLocalGroupCount(inRecoveryStripeCount) + 1);
+        }
+        virtual bool SupportsOneRecoveryStripeRebuild() const
+            { return true; }
+        virtual bool IsMaximumDistanceSeparable() const
+            { return false; }
+        virtual int GetLocalRepairStripes(
+            int  inStripeCount,
+            int  inRecoveryStripeCount,
+            int  inStripeIdx,
+            int* outStripesIdxPtr) const
+        {
+            const int theGroup = GetLrcStripeGroup(
+                inStripeIdx, inStripeCount, inRecoveryStripeCount);
+            if (theGroup < 0) {
+                return 0;
+            }
+            const int theParityIdx = inStripeCount + inRecoveryStripeCount -
+                GetLrcLocalGroupCount(inRecoveryStripeCount) + theGroup;
+            const int theEnd       = GetLrcLocalGroupStart(
+                theGroup + 1, inStripeCount, inRecoveryStripeCount);
+            int       theCnt       = 0;
+            for (int i = GetLrcLocalGroupStart(
+                        theGroup, inStripeCount, inRecoveryStripeCount);
+                    i < theEnd;
+                    i++) {
+                if (i != inStripeIdx) {
+                    outStripesIdxPtr[theCnt++] = i;
+                }
+            }
+            if (inStripeIdx != theParityIdx) {
+                outStripesIdxPtr[theCnt++] = theParityIdx;
+            }
+            return theCnt;
+        }
+        virtual int Decode(
+            int        inStripeCount,
+            int        inRecoveryStripeCount,
+            int        inLength,
+            void**     inBuffersPtr,
+            int const* inMissingStripesIdxPtr)
+        {
+            const int theCnt = inStripeCount + inRecoveryStripeCount;
+            char      theMissingFlags[kMaxStripeCount];
+            int       theDataIdx[kMaxStripeCount];
+            int       theDataCnt = 0;
+            memset(theMissingFlags, 0, sizeof(theMissingFlags));
+            for (int const* thePtr = inMissingStripesIdxPtr;
+                    0 <= *thePtr;
+                    ++thePtr) {
+                const int theIdx = *thePtr;
+                if (theCnt <= theIdx) {
+                    return -1;
+                }
+                if (theMissingFlags[theIdx]) {
+                    continue;
+                }
+                theMissingFlags[theIdx] = 1;
+                if (theIdx < inStripeCount) {
+                    if (! inBuffersPtr[theIdx]) {
+                        return -1;
+                    }
+                    theDataIdx[theDataCnt++] = theIdx;
+                }
+            }
+            for (int i = 0; i < theCnt; i++) {
+                if (! theMissingFlags[i] && ! inBuffersPtr[i]) {
+                    if (i < inStripeCount) {
+                        return -1;
+                    }
+                    theMissingFlags[i] = 1;
+                }
+            }
+            if (0 < theDataCnt) {
+                const int theRet = DecodeData(
+                    inStripeCount,
+                    inRecoveryStripeCount,
+                    inLength,
+                    inBuffersPtr,
+                    theMissingFlags,
+                    theDataIdx,
+                    theDataCnt
+                );
+                if (theRet != 0) {
+                    return theRet;
+                }
+            }
+            for (int i = inStripeCount; i < theCnt; i++) {
+                if (theMissingFlags[i] && inBuffersPtr[i]) {
+                    EncodeStripe(inStripeCount, inRecoveryStripeCount,
+                        inLength, inBuffersPtr, i - inStripeCount);
+                }
+            }
+            return 0;
+        }
+        virtual bool CanDecode(
+            int        inStripeCount,
+            int        inRecoveryStripeCount,
+            int const* inMissingStripesIdxPtr) const
+        {
+            const int theCnt = inStripeCount + inRecoveryStripeCount;
+            char      theMissingFlags[kMaxStripeCount];
+            int       theDataIdx[kMaxStripeCount];
+            int       theDataCnt = 0;
+            memset(theMissingFlags, 0, sizeof(theMissingFlags));
+            for (int const* thePtr = inMissingStripesIdxPtr;
+                    0 <= *thePtr;
+                    ++thePtr) {
+                const int theIdx = *thePtr;
+                if (theCnt <= theIdx) {
+                    return false;
+                }
+                if (theMissingFlags[theIdx]) {
+                    continue;
+                }
+                theMissingFlags[theIdx] = 1;
+                if (theIdx < inStripeCount) {
+                    theDataIdx[theDataCnt++] = theIdx;
+                }
+            }
+            if (theDataCnt <= 0) {
+                return true;
+            }
+            StBufferT<unsigned char, 64> theMatrixBuf;
+            unsigned char* const theMatrixPtr =
+                theMatrixBuf.Resize(2 * theDataCnt * theDataCnt);
+            int                  theRows[kMaxStripeCount];
+            return (SelectRows(inStripeCount, inRecoveryStripeCount,
+                theMissingFlags, theDataIdx, theDataCnt, theMatrixPtr,
+                theMatrixPtr + theDataCnt * theDataCnt, theRows) ==
+                theDataCnt);
+        }
+        virtual void Release()
+            {}
+    private:
+        static unsigned char Mul(
+            unsigned char inX,
+            unsigned char inY)
+            { return rs_gf_mul(inX, inY); }
+        static unsigned char Inverse(
+            unsigned char inVal)
+            { return rs_gf_inv(inVal); }
+        static unsigned char GetCoefficient(
+            int inStripeCount,
+            int inRecoveryStripeCount,
+            int inRow,
+            int inStripeIdx)
+        {
+            const int theGlobalCnt = inRecoveryStripeCount -
+                GetLrcLocalGroupCount(inRecoveryStripeCount);
+            if (inRow < theGlobalCnt) {
+                return rs_gf_pow2((inStripeIdx + 1) * (inRow + 1));
+            }
+            return (GetLrcStripeGroup(
+                    inStripeIdx, inStripeCount, inRecoveryStripeCount) ==
+                inRow - theGlobalCnt ? 1 : 0);
+        }
+        static void MulAdd(
+            unsigned char inCoefficient,
+            const char*   inSrcPtr,
+            char*         inDstPtr,
+            int           inLength)
+            { rs_gf_muladd(inCoefficient, inLength, inSrcPtr, inDstPtr); }
+        static void EncodeStripe(
+            int    inStripeCount,
+            int    inRecoveryStripeCount,
+            int    inLength,
+            void** inBuffersPtr,
+            int    inRow)
+        {
+            char* const theDstPtr =
+                reinterpret_cast<char*>(inBuffersPtr[inStripeCount + inRow]);
+            memset(theDstPtr, 0, inLength);
+            for (int i = 0; i < inStripeCount; i++) {
+                MulAdd(
+                    GetCoefficient(
+                        inStripeCount, inRecoveryStripeCount, inRow, i),
+                    reinterpret_cast<const char*>(inBuffersPtr[i]),
+                    theDstPtr,
+                    inLength
+                );
+            }
+        }
+        // Adds row to the row echelon form matrix, and returns true if the
+        // row is linearly independent of the rows already added.
+        static bool AddRow(
+            const unsigned char* inRowPtr,
+            int                  inSize,
+            unsigned char*       ioEchelonPtr,
+            int*                 ioPivotsPtr,
+            int&                 ioRank)
+        {
+            unsigned char* const theRowPtr = ioEchelonPtr + ioRank * inSize;
+            memcpy(theRowPtr, inRowPtr, inSize);
+            for (int r = 0; r < ioRank; r++) {
+                const unsigned char theCoef = theRowPtr[ioPivotsPtr[r]];
+                if (theCoef == 0) {
+                    continue;
+                }
+                const unsigned char* const thePtr = ioEchelonPtr + r * inSize;
+                for (int c = 0; c < inSize; c++) {
+                    theRowPtr[c] ^= Mul(theCoef, thePtr[c]);
+                }
+            }
+            int thePivot = 0;
+            while (thePivot < inSize && theRowPtr[thePivot] == 0) {
+                thePivot++;
+            }
+            if (inSize <= thePivot) {
+                return false;
+            }
+            const unsigned char theInv = Inverse(theRowPtr[thePivot]);
+            for (int c = 0; c < inSize; c++) {
+                theRowPtr[c] = Mul(theInv, theRowPtr[c]);
+            }
+            ioPivotsPtr[ioRank++] = thePivot;
+            return true;
+        }
+        // Gauss-Jordan elimination, the matrix must be non singular.
+        static void Invert(
+            unsigned char* inMatrixPtr,
+            unsigned char* outInversePtr,
+            int            inSize)
+        {
+            memset(outInversePtr, 0, inSize * inSize);
+            for (int i = 0; i < inSize; i++) {
+                outInversePtr[i * inSize + i] = 1;
+            }
+            for (int c = 0; c < inSize; c++) {
+                int p = c;
+                while (inMatrixPtr[p * inSize + c] == 0) {
+                    p++;
+                    QCRTASSERT(p < inSize);
+                }
+                if (p != c) {
+                    for (int i = 0; i < inSize; i++) {
+                        std::swap(inMatrixPtr[p * inSize + i],
+                            inMatrixPtr[c * inSize + i]);
+                        std::swap(outInversePtr[p * inSize + i],
+                            outInversePtr[c * inSize + i]);
+                    }
+                }
+                const unsigned char theInv =
+                    Inverse(inMatrixPtr[c * inSize + c]);
+                for (int i = 0; i < inSize; i++) {
+                    inMatrixPtr[c * inSize + i] =
+                        Mul(theInv, inMatrixPtr[c * inSize + i]);
+                    outInversePtr[c * inSize + i] =
+                        Mul(theInv, outInversePtr[c * inSize + i]);
+                }
+                for (int r = 0; r < inSize; r++) {
+                    const unsigned char theCoef = inMatrixPtr[r * inSize + c];
+                    if (r == c || theCoef == 0) {
+                        continue;
+                    }
+                    for (int i = 0; i < inSize; i++) {
+                        inMatrixPtr[r * inSize + i] ^=
+                            Mul(theCoef, inMatrixPtr[c * inSize + i]);
+                        outInversePtr[r * inSize + i] ^=
+                            Mul(theCoef, outInversePtr[c * inSize + i]);
+                    }
+                }
+            }
+        }
+        // Selects linearly independent parity rows for the missing data
+        // stripes, and returns their count. The stripes can be rebuilt if
+        // the count is equal to the missing data stripe count.
+        static int SelectRows(
+            int            inStripeCount,
+            int            inRecoveryStripeCount,
+            const char*    inMissingFlagsPtr,
+            const int*     inDataIdxPtr,
+            int            inDataCnt,
+            unsigned char* outMatrixPtr,
+            unsigned char* inEchelonPtr,
+            int*           outRowsPtr)
+        {
+            const int theSize      = inDataCnt;
+            const int theGlobalCnt = inRecoveryStripeCount -
+                GetLrcLocalGroupCount(inRecoveryStripeCount);
+            int       thePivots[kMaxStripeCount];
+            int       theRank = 0;
+            // Use local parity rows first, as these are the least expensive
+            // to apply.
+            for (int k = 0; k < inRecoveryStripeCount && theRank < theSize;
+                    k++) {
+                const int theRow = (k + theGlobalCnt) % inRecoveryStripeCount;
+                if (inMissingFlagsPtr[inStripeCount + theRow]) {
+                    continue;
+                }
+                unsigned char* const theRowPtr =
+                    outMatrixPtr + theRank * theSize;
+                for (int i = 0; i < theSize; i++) {
+                    theRowPtr[i] = GetCoefficient(inStripeCount,
+                        inRecoveryStripeCount, theRow, inDataIdxPtr[i]);
+                }
+                if (AddRow(theRowPtr, theSize, inEchelonPtr, thePivots,
+                        theRank)) {
+                    outRowsPtr[theRank - 1] = theRow;
+                }
+            }
+            return theRank;
+        }
+        static int DecodeData(
+            int         inStripeCount,
+            int         inRecoveryStripeCount,
+            int         inLength,
+            void**      inBuffersPtr,
+            const char* inMissingFlagsPtr,
+            const int*  inDataIdxPtr,
+            int         inDataCnt)
+        {
+            const int theSize = inDataCnt;
+            StBufferT<unsigned char, 64> theMatrixBuf;
+            unsigned char* const theMatrixPtr   =
+                theMatrixBuf.Resize(3 * theSize * theSize);
+            unsigned char* const theEchelonPtr  =
+                theMatrixPtr + theSize * theSize;
+            unsigned char* const theInversePtr  =
+                theEchelonPtr + theSize * theSize;
+            int                  theRows[kMaxStripeCount];
+            if (SelectRows(inStripeCount, inRecoveryStripeCount,
+                    inMissingFlagsPtr, inDataIdxPtr, inDataCnt,
+                    theMatrixPtr, theEchelonPtr, theRows) < theSize) {
+                return -1;
+            }
+            Invert(theMatrixPtr, theInversePtr, theSize);
+            // Single stripe repair with xor parity is done in place.
+            StBufferT<char, 1> theSyndromeBuf;
+            char* const theSyndromePtr =
+                (theSize <= 1 && theInversePtr[0] == 1) ? 0 :
+                theSyndromeBuf.Resize(theSize * kBlockSize);
+            for (int thePos = 0; thePos < inLength; thePos += kBlockSize) {
+                const int theLen = min((int)kBlockSize, inLength - thePos);
+                for (int s = 0; s < theSize; s++) {
+                    char* const theDstPtr = theSyndromePtr ?
+                        theSyndromePtr + s * kBlockSize :
+                        reinterpret_cast<char*>(
+                            inBuffersPtr[inDataIdxPtr[s]]) + thePos;
+                    memcpy(theDstPtr, reinterpret_cast<const char*>(
+                        inBuffersPtr[inStripeCount + theRows[s]]) + thePos,
+                        theLen);
+                    for (int i = 0; i < inStripeCount; i++) {
+                        if (inMissingFlagsPtr[i]) {
+                            continue;
+                        }
+                        MulAdd(
+                            GetCoefficient(inStripeCount,
+                                inRecoveryStripeCount, theRows[s], i),
+                            reinterpret_cast<const char*>(
+                                inBuffersPtr[i]) + thePos,
+                            theDstPtr,
+                            theLen
+                        );
+                    }
+                }
+                if (! theSyndromePtr) {
+                    continue;
+                }
+                for (int s = 0; s < theSize; s++) {
+                    char* const theDstPtr = reinterpret_cast<char*>(
+                        inBuffersPtr[inDataIdxPtr[s]]) + thePos;
+                    memset(theDstPtr, 0, theLen);
+                    for (int t = 0; t < theSize; t++) {
+                        MulAdd(theInversePtr[s * theSize + t],
+                            theSyndromePtr + t * kBlockSize,
+                            theDstPtr, theLen);
+                    }
+                }
+            }
+            return 0;
+        }
+    };
+
+    const string mDescription;
+    LrcCoder     mCoder;
+
+    static string Describe()
+    {
+        string theRet;
+        theRet += "id: ";
+        AppendDecIntToString(theRet, int(KFS_STRIPED_FILE_TYPE_LRC)) +=
+            "; lrc"
+            "; local groups: (recovery stripes + 1) / 2"
+            "; recovery stripes range: [";
+        AppendDecIntToString(theRet, int(kMinRecoveryStripeCount)) +=
+            ", ";
+        AppendDecIntToString(theRet, KFS_MAX_RECOVERY_STRIPE_COUNT) +=
+            "]; data stripes range: [local groups, ";
+        AppendDecIntToString(theRet, int(kMaxStripeCount)) +=
+            " - recovery stripes]"
+        ;
+        return theRet;
+    }
+};
+
+KFS_REGISTER_EC_METHOD(STRIPED_FILE_TYPE_LRC, LrcECMethod::GetMethod());
+
+}} /* namespace client KFS */
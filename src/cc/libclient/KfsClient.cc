@@ -1765,6 +1765,16 @@ int KfsClientImpl::Init(const string& metaServerHost, int metaServerPort,
             properties->getValue("client.resolverCacheExpiration",
                 mNetManager.GetResolverCacheExpiration())
         );
+        mNetManager.SetResolverCacheParameters(
+            properties->getValue("client.resolverNegativeCacheExpiration",
+                mNetManager.GetResolverNegativeCacheExpiration()),
+            properties->getValue("client.resolverCacheRefreshAhead",
+                mNetManager.GetResolverCacheRefreshAhead()),
+            properties->getValue("client.resolverThreadCount",
+                mNetManager.GetResolverThreadCount())
+        );
+        mNetManager.SetLocalSocketDir(properties->getValue(
+            "client.localSocketDir", mNetManager.GetLocalSocketDir()));
         properties->copyWithPrefix("client.", mConfig);
         string nodeId = properties->getValue("client.nodeId", mNodeId);
         const char* const kFilePrefix    = "FILE:";
@@ -4881,6 +4891,15 @@ KfsClientImpl::StartProtocolWorker()
     }
     params.mUseClientPoolFlag = mConfig.getValue(
         "client.connectionPool", params.mUseClientPoolFlag ? 1 : 0) != 0;
+    params.mSharedConnectionPoolFlag = mConfig.getValue(
+        "client.sharedConnectionPool",
+        params.mSharedConnectionPoolFlag ? 1 : 0) != 0;
+    params.mSharedMaxConnectionsPerServer = mConfig.getValue(
+        "client.sharedConnectionPool.maxConnectionsPerServer",
+        params.mSharedMaxConnectionsPerServer);
+    params.mSharedIdleTimeoutSec = mConfig.getValue(
+        "client.sharedConnectionPool.idleTimeoutSec",
+        params.mSharedIdleTimeoutSec);
     params.mMetaServerNodes = mConfig.getValue(
         KfsClient::GetMetaServerNodesParamName(), params.mMetaServerNodes);
     params.mClientRackId    = mConfig.getValue(
@@ -4888,6 +4907,12 @@ KfsClientImpl::StartProtocolWorker()
     params.mResolverUseOsResolverFlag = mNetManager.GetResolverOsFlag();
     params.mResolverCacheSize         = mNetManager.GetResolverCacheSize();
     params.mResolverCacheExpiration   = mNetManager.GetResolverCacheExpiration();
+    params.mResolverNegativeCacheExpiration =
+        mNetManager.GetResolverNegativeCacheExpiration();
+    params.mResolverCacheRefreshAhead =
+        mNetManager.GetResolverCacheRefreshAhead();
+    params.mResolverThreadCount       = mNetManager.GetResolverThreadCount();
+    params.mLocalSocketDir            = mNetManager.GetLocalSocketDir();
     params.mNodeId                    = mNodeId;
     mProtocolWorker = new KfsProtocolWorker(
         mMetaServerLoc.hostname,
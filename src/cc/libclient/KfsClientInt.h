@@ -682,12 +682,16 @@ private:
     typedef map<
         string, FAttr*,
         less<string>,
-        StdFastAllocator<pair<const string, FAttr*> >
+        StdFastTaggedAllocator<
+            pair<const string, FAttr*>, MemoryAccounting::kSubsystemCaches>
     > NameToFAttrMap;
     typedef map<
         pair<kfsFileId_t, string>, FAttr*,
         less<pair<kfsFileId_t, string> >,
-        StdFastAllocator<pair<const pair<kfsFileId_t, string>, FAttr*> >
+        StdFastTaggedAllocator<
+            pair<const pair<kfsFileId_t, string>, FAttr*>,
+            MemoryAccounting::kSubsystemCaches
+        >
     > FidNameToFAttrMap;
     class FAttr : public FileAttr
     {
@@ -729,7 +733,8 @@ private:
         sizeof(FAttr),
         1  << 20,
         32 << 20,
-        true
+        true,
+        MemoryAccounting::kSubsystemCaches
     > FAttrPool;
     typedef vector<int>                        FreeFileTableEntires;
     typedef vector<pair<kfsFileId_t, size_t> > TmpPath;
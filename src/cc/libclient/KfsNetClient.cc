@@ -238,6 +238,8 @@ public:
     }
     bool IsConnected() const
         { return (mConnPtr && mConnPtr->IsGood()); }
+    bool IsLocalConnection() const
+        { return (mConnPtr && mConnPtr->IsLocal()); }
     int64_t GetDisconnectCount() const
         { return mDisconnectCount; }
     bool Start(
@@ -486,6 +488,8 @@ public:
         { return mRetryConnectOnlyFlag; }
     bool WasDisconnected() const
         { return ((mDataSentFlag || mDataReceivedFlag) && ! IsConnected()); }
+    size_t GetPendingOpsCount() const
+        { return mPendingOpQueue.size(); }
     void SetRetryConnectOnly(
         bool inFlag)
         { mRetryConnectOnlyFlag = inFlag; }
@@ -2865,6 +2869,13 @@ KfsNetClient::IsConnected() const
     return mImpl.IsConnected();
 }
 
+    bool
+KfsNetClient::IsLocalConnection() const
+{
+    Impl::StRef theRef(mImpl);
+    return mImpl.IsLocalConnection();
+}
+
     int64_t
 KfsNetClient::GetDisconnectCount() const
 {
@@ -3049,6 +3060,12 @@ KfsNetClient::IsAllDataSent() const
     return mImpl.IsAllDataSent();
 }
 
+    size_t
+KfsNetClient::GetPendingOpsCount() const
+{
+    return mImpl.GetPendingOpsCount();
+}
+
     bool
 KfsNetClient::IsDataReceived() const
 {
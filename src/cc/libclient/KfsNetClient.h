@@ -169,6 +169,8 @@ public:
         const QCThread*    inThreadPtr                      = 0);
     virtual ~KfsNetClient(); // virtual for debugging: obj. type from pointer.
     bool IsConnected() const;
+    /// Is connected to the server on this host through unix domain socket?
+    bool IsLocalConnection() const;
     int64_t GetDisconnectCount() const; // Used to detect disconnects
     bool Start(
         string             inServerName,
@@ -240,6 +242,7 @@ public:
     bool IsDataSent() const;
     bool IsRetryConnectOnly() const;
     bool WasDisconnected() const;
+    size_t GetPendingOpsCount() const;
     void SetRetryConnectOnly(
         bool inFlag);
     void GetStats(
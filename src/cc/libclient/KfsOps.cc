@@ -43,6 +43,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <stdlib.h>
 
 namespace KFS
 {
@@ -63,6 +64,14 @@ static const char* InitHostName()
 }
 static const char* const sHostName(InitHostName());
 
+// Chunk server QoS class tag, see chunkServer.qos.clientClassTag.
+static int InitQosClass()
+{
+    const char* const ptr = getenv("QFS_CLIENT_QOS_CLASS");
+    return ((ptr && *ptr) ? atoi(ptr) : -1);
+}
+static const int sQosClass(InitQosClass());
+
 inline ReqOstream&
 KfsOp::ParentHeaders(ReqOstream& os) const
 {
@@ -82,6 +91,10 @@ KfsOp::ParentHeaders(ReqOstream& os) const
         os << (shortRpcFormatFlag ? "w:" : "Max-wait-ms: ") <<
             maxWaitMillisec << "\r\n";
     }
+    if (0 <= sQosClass) {
+        os << (shortRpcFormatFlag ? "Q:" : "QoS-class: ") << sQosClass <<
+            "\r\n";
+    }
     return os;
 }
 
@@ -563,6 +576,9 @@ AllocateOp::Request(ReqOstream& os)
     if (invalidateAllFlag) {
         os << (shortRpcFormatFlag ? "I:1\r\n" : "Invalidate-all: 1\r\n");
     }
+    if (allocBatchFlag) {
+        os << (shortRpcFormatFlag ? "AB:1\r\n" : "Allocate-batch: 1\r\n");
+    }
     if (masterServer.IsValid()) {
         os << (shortRpcFormatFlag ? "C:" : "Chunk-master: ") <<
             masterServer << "\r\n";
@@ -579,6 +595,31 @@ AllocateOp::Request(ReqOstream& os)
     os << "\r\n";
 }
 
+void
+AllocateBatchOp::Request(ReqOstream& os)
+{
+    os <<
+        "ALLOCATE_BATCH\r\n" << ReqHeaders(*this) <<
+        (shortRpcFormatFlag ? "H:" : "Client-host: ") <<
+            sHostName << "\r\n";
+    if (! pathname.empty()) {
+        os << (shortRpcFormatFlag ? "N:" : "Pathname: ") <<
+            pathname << "\r\n";
+    }
+    os <<
+        (shortRpcFormatFlag ? "P:" : "File-handle: ")   << fid << "\r\n" <<
+        (shortRpcFormatFlag ? "O:" : "Chunk-offsets: ");
+    for (Allocs::const_iterator it = allocs.begin();
+            allocs.end() != it;
+            ++it) {
+        if (allocs.begin() != it) {
+            os << " ";
+        }
+        os << (*it)->fileOffset;
+    }
+    os << "\r\n\r\n";
+}
+
 void
 TruncateOp::Request(ReqOstream& os)
 {
@@ -1380,6 +1421,8 @@ AllocateOp::ParseResponseHeaderSelf(const Properties& prop)
         }
     }
     allCSShortRpcFlag = shortRpcFormatFlag && prop.getValue("SS", 0) != 0;
+    allocBatchFlag    = prop.getValue(
+        shortRpcFormatFlag ? "AB" : "Allocate-batch", 0) != 0;
     const int numReplicas = prop.getValue(
         shortRpcFormatFlag ? "R" : "Num-replicas", 0);
     if (0 < numReplicas) {
@@ -1429,6 +1472,46 @@ AllocateOp::ParseResponseHeaderSelf(const Properties& prop)
         shortRpcFormatFlag ? "C" : "C-access", string());
 }
 
+void
+AllocateBatchOp::ParseResponseHeaderSelf(const Properties& prop)
+{
+    numChunks = prop.getValue(shortRpcFormatFlag ? "C" : "Num-chunks", 0);
+}
+
+///
+/// The response content is the sequence of the individual allocation
+/// responses, each terminated by an empty line, in the request order.
+///
+int
+AllocateBatchOp::ParseAllocations()
+{
+    if (numChunks != (int)allocs.size()) {
+        return -EINVAL;
+    }
+    const char*       ptr = contentBuf;
+    const char* const end = ptr + (contentBuf ? contentLength : 0);
+    Properties        prop(shortRpcFormatFlag ? 16 : 10);
+    for (Allocs::const_iterator it = allocs.begin();
+            allocs.end() != it;
+            ++it) {
+        const char* const blk = ptr;
+        while (ptr + 3 < end && (ptr[0] != '\r' || ptr[1] != '\n' ||
+                ptr[2] != '\r' || ptr[3] != '\n')) {
+            ++ptr;
+        }
+        if (end <= ptr + 3) {
+            return -EINVAL;
+        }
+        ptr += 4;
+        prop.clear();
+        prop.loadProperties(blk, ptr - blk, ':');
+        AllocateOp& op = **it;
+        op.shortRpcFormatFlag = shortRpcFormatFlag;
+        op.ParseResponseHeader(prop);
+    }
+    return 0;
+}
+
 void
 GetAllocOp::ParseResponseHeaderSelf(const Properties& prop)
 {
@@ -30,6 +30,7 @@
 #include "common/kfstypes.h"
 #include "common/Properties.h"
 #include "common/StdAllocator.h"
+#include "common/MemoryAccounting.h"
 #include "common/RequestParser.h"
 #include "common/ReqOstream.h"
 #include "kfsio/NetConnection.h"
@@ -128,12 +129,15 @@ enum KfsOp_t {
     CMD_META_VR_RECONFIGURATION,
     CMD_META_VR_GET_STATUS,
     CMD_LINK,
+    CMD_ALLOCATE_BATCH,
+    CMD_META_GET_REQUEST_HISTOGRAMS,
     CMD_NCMDS
 };
 
 typedef ReqOstreamT<ostream> ReqOstream;
 
-struct KfsOp {
+struct KfsOp :
+    public MemoryAccounted<MemoryAccounting::kSubsystemRequests> {
     class Display
     {
     public:
@@ -1043,6 +1047,10 @@ struct AllocateOp : public KfsOp {
     bool                   invalidateAllFlag;
     bool                   allowCSClearTextFlag;
     bool                   allCSShortRpcFlag;
+    // input: client supports batch allocation, and asks the meta server to
+    // report batch allocation support
+    // result: meta server supports batch allocation
+    bool                   allocBatchFlag;
     int64_t                chunkLeaseDuration;
     int64_t                chunkServerAccessValidForTime;
     int64_t                chunkServerAccessIssuedTime;
@@ -1063,6 +1071,7 @@ struct AllocateOp : public KfsOp {
           invalidateAllFlag(false),
           allowCSClearTextFlag(false),
           allCSShortRpcFlag(false),
+          allocBatchFlag(false),
           chunkLeaseDuration(-1),
           chunkServerAccessValidForTime(0),
           chunkServerAccessIssuedTime(0),
@@ -1084,6 +1093,7 @@ struct AllocateOp : public KfsOp {
         invalidateAllFlag             = false;
         allowCSClearTextFlag          = false;
         allCSShortRpcFlag             = false;
+        allocBatchFlag                = false;
         chunkLeaseDuration            = -1;
         chunkServerAccessValidForTime = 0;
         chunkServerAccessIssuedTime   = 0;
@@ -1123,6 +1133,38 @@ struct AllocateOp : public KfsOp {
     }
 };
 
+// Allocate a group of chunks in one meta server round trip. The results are
+// stored into the corresponding allocation ops, the same way as if every
+// allocation op was executed individually.
+struct AllocateBatchOp : public KfsOp {
+    typedef vector<AllocateOp*> Allocs;
+    kfsFileId_t fid;
+    string      pathname;
+    Allocs      allocs;    // input: chunk offsets, output: allocation results
+    int         numChunks; // result
+    AllocateBatchOp(kfsSeq_t s, kfsFileId_t f, const string& p)
+        : KfsOp(CMD_ALLOCATE_BATCH, s),
+          fid(f),
+          pathname(p),
+          allocs(),
+          numChunks(0)
+        {}
+    void Request(ReqOstream& os);
+    virtual void ParseResponseHeaderSelf(const Properties& prop);
+    int ParseAllocations();
+    virtual ostream& ShowSelf(ostream& os) const {
+        os << "allocate batch:"
+            " fid: "     << fid <<
+            " offsets:";
+        for (Allocs::const_iterator it = allocs.begin();
+                allocs.end() != it;
+                ++it) {
+            os << " " << (*it)->fileOffset;
+        }
+        return os;
+    }
+};
+
 struct TruncateOp : public KfsOp {
     const char* pathname;
     kfsFileId_t fid;
@@ -39,6 +39,7 @@
 #include "common/MsgLogger.h"
 #include "common/StdAllocator.h"
 #include "common/IntToString.h"
+#include "common/MemoryAccounting.h"
 #include "qcdio/QCUtils.h"
 #include "qcdio/QCThread.h"
 #include "qcdio/QCMutex.h"
@@ -51,9 +52,11 @@
 #include "Writer.h"
 #include "Reader.h"
 #include "ClientPool.h"
+#include "ECEncoderPool.h"
 
 #include <algorithm>
 #include <map>
+#include <vector>
 #include <string>
 #include <cerrno>
 #include <limits>
@@ -70,6 +73,8 @@ using std::make_pair;
 using std::pair;
 using std::map;
 using std::less;
+using std::vector;
+using std::find;
 using KFS::libkfsio::globals;
 
 // KFS client side protocol worker thread implementation.
@@ -81,13 +86,293 @@ public:
     typedef KfsNetClient         MetaServer;
     typedef QCDLList<Request, 0> WorkQueue;
 
+    // Process wide network thread, and chunk server connection pool shared by
+    // all protocol workers with shared connection pool option. The protocol
+    // workers' requests are processed by the shared thread, in order to
+    // multiplex the ops issued by all workers over the same chunk server
+    // connections. The shared thread, network manager, and pool parameters
+    // are set by the first worker, and the shared thread is stopped when the
+    // last worker detaches.
+    class Shared :
+        public QCRunnable,
+        public ITimeout
+    {
+    public:
+        static Shared& Get(
+            const Parameters& inParameters)
+        {
+            QCStMutexLocker theLock(sMutex);
+            if (sInstancePtr) {
+                sInstancePtr->CheckParameters(inParameters);
+            } else {
+                sInstancePtr = new Shared(inParameters);
+                sInstancePtr->mThread.Start(sInstancePtr, kStackSize);
+            }
+            sInstancePtr->mRefCount++;
+            return *sInstancePtr;
+        }
+        static void Put(
+            Shared& inShared)
+        {
+            QCStMutexLocker theLock(sMutex);
+            QCASSERT(&inShared == sInstancePtr && 0 < inShared.mRefCount);
+            if (0 < --inShared.mRefCount) {
+                return;
+            }
+            sInstancePtr = 0;
+            {
+                QCStMutexLocker theSharedLock(inShared.mMutex);
+                QCRTASSERT(inShared.mImpls.empty());
+                inShared.mStopFlag = true;
+            }
+            inShared.mNetManager.Wakeup();
+            inShared.mThread.Join();
+            delete &inShared;
+        }
+        NetManager& GetNetManager()
+            { return mNetManager; }
+        ClientPool& GetClientPool()
+            { return mClientPool; }
+        void Attach(
+            Impl& inImpl)
+        {
+            {
+                QCStMutexLocker theLock(mMutex);
+                if (inImpl.mSharedAttachedFlag) {
+                    return;
+                }
+                inImpl.mSharedAttachedFlag = true;
+                mImpls.push_back(&inImpl);
+                mMaxContentLength = max(
+                    mMaxContentLength, GetMaxContentLength(inImpl));
+            }
+            mNetManager.Wakeup();
+        }
+        void WaitDetached(
+            Impl& inImpl)
+        {
+            QCStMutexLocker theLock(mMutex);
+            while (inImpl.mSharedAttachedFlag) {
+                mDetachedCond.Wait(mMutex);
+            }
+        }
+        virtual void Run()
+        {
+            mNetManager.RegisterTimeoutHandler(this);
+            mNetManager.MainLoop();
+            mNetManager.UnRegisterTimeoutHandler(this);
+        }
+        virtual void Timeout()
+        {
+            bool theStopFlag;
+            {
+                QCStMutexLocker theLock(mMutex);
+                mTmpImpls = mImpls;
+                mClientPool.SetMinMaxContentLength(mMaxContentLength);
+                theStopFlag = mStopFlag;
+            }
+            for (Impls::const_iterator theIt = mTmpImpls.begin();
+                    theIt != mTmpImpls.end();
+                    ++theIt) {
+                Impl& theImpl = **theIt;
+                theImpl.Timeout();
+                if (theImpl.mSharedStoppedFlag) {
+                    QCStMutexLocker theLock(mMutex);
+                    mImpls.erase(find(mImpls.begin(), mImpls.end(), &theImpl));
+                    theImpl.mSharedAttachedFlag = false;
+                    mDetachedCond.NotifyAll();
+                }
+            }
+            mTmpImpls.clear();
+            if (theStopFlag) {
+                mNetManager.Shutdown();
+            }
+        }
+    private:
+        typedef vector<Impl*> Impls;
+        enum { kStackSize = 64 << 10 };
+
+        NetManager  mNetManager;
+        ClientPool  mClientPool;
+        QCThread    mThread;
+        QCMutex     mMutex;
+        QCCondVar   mDetachedCond;
+        Impls       mImpls;
+        Impls       mTmpImpls;
+        int         mMaxContentLength;
+        int         mRefCount;
+        bool        mStopFlag;
+        // The first worker's parameters, only the settings of the shared
+        // thread, network manager, and pool are used.
+        const Parameters mParameters;
+
+        static QCMutex sMutex;
+        static Shared* sInstancePtr;
+
+        Shared(
+            const Parameters& inParameters)
+            : QCRunnable(),
+              ITimeout(),
+              mNetManager(),
+              mClientPool(
+                mNetManager,
+                0,                          // inMaxRetryCount,
+                0,                          // inTimeSecBetweenRetries,
+                inParameters.mOpTimeoutSec,
+                GetIdleTimeoutSec(inParameters),
+                inParameters.mChunkServerInitialSeqNum > 0 ?
+                    inParameters.mChunkServerInitialSeqNum :
+                    GetInitalSeqNum(),
+                "PWS",
+                false,                       // inResetConnectionOnOpTimeoutFlag
+                true,                        // inRetryConnectOnlyFlag
+                GetMaxContentLength(inParameters.mMaxReadSize),
+                false,                       // inFailAllOpsOnOpTimeoutFlag
+                false,                       // inMaxOneOutstandingOpFlag
+                0,                           // inAuthContextPtr
+                inParameters.mSharedMaxConnectionsPerServer
+              ),
+              mThread(0, "KfsProtocolWorkerShared"),
+              mMutex(),
+              mDetachedCond(),
+              mImpls(),
+              mTmpImpls(),
+              mMaxContentLength(GetMaxContentLength(inParameters.mMaxReadSize)),
+              mRefCount(0),
+              mStopFlag(false),
+              mParameters(inParameters)
+        {
+            mNetManager.SetResolverParameters(
+                inParameters.mResolverUseOsResolverFlag,
+                inParameters.mResolverCacheSize,
+                inParameters.mResolverCacheExpiration);
+            mNetManager.SetResolverCacheParameters(
+                inParameters.mResolverNegativeCacheExpiration,
+                inParameters.mResolverCacheRefreshAhead,
+                inParameters.mResolverThreadCount);
+            mNetManager.SetLocalSocketDir(inParameters.mLocalSocketDir);
+        }
+        virtual ~Shared()
+            {}
+        // The shared thread settings are set by the first worker, and the
+        // subsequent workers' settings are ignored, except the max read size
+        // which only raises the pool's max content length.
+        void CheckParameters(
+            const Parameters& inParameters) const
+        {
+            const Parameters& theFirst = mParameters;
+            string            theDiff;
+            if (theFirst.mOpTimeoutSec != inParameters.mOpTimeoutSec) {
+                theDiff += " op timeout";
+            }
+            if (GetIdleTimeoutSec(theFirst) !=
+                    GetIdleTimeoutSec(inParameters)) {
+                theDiff += " idle timeout";
+            }
+            if (theFirst.mMaxReadSize != inParameters.mMaxReadSize) {
+                theDiff += " max read size";
+            }
+            if (theFirst.mSharedMaxConnectionsPerServer !=
+                    inParameters.mSharedMaxConnectionsPerServer) {
+                theDiff += " max connections per server";
+            }
+            if (theFirst.mResolverUseOsResolverFlag !=
+                        inParameters.mResolverUseOsResolverFlag ||
+                    theFirst.mResolverCacheSize !=
+                        inParameters.mResolverCacheSize ||
+                    theFirst.mResolverCacheExpiration !=
+                        inParameters.mResolverCacheExpiration ||
+                    theFirst.mResolverNegativeCacheExpiration !=
+                        inParameters.mResolverNegativeCacheExpiration ||
+                    theFirst.mResolverCacheRefreshAhead !=
+                        inParameters.mResolverCacheRefreshAhead ||
+                    theFirst.mResolverThreadCount !=
+                        inParameters.mResolverThreadCount) {
+                theDiff += " resolver";
+            }
+            if (theFirst.mLocalSocketDir != inParameters.mLocalSocketDir) {
+                theDiff += " local socket dir";
+            }
+            if (theDiff.empty()) {
+                return;
+            }
+            KFS_LOG_STREAM_WARN <<
+                "shared connection pool: the first protocol worker's"
+                " settings are used, the following settings differ:" <<
+                theDiff <<
+            KFS_LOG_EOM;
+        }
+        static int GetIdleTimeoutSec(
+            const Parameters& inParameters)
+        {
+            return (0 <= inParameters.mSharedIdleTimeoutSec ?
+                inParameters.mSharedIdleTimeoutSec :
+                inParameters.mIdleTimeoutSec);
+        }
+        static int GetMaxContentLength(
+            const Impl& inImpl)
+            { return GetMaxContentLength(inImpl.mMaxReadSize); }
+        static int GetMaxContentLength(
+            int inMaxReadSize)
+        {
+            return (int)min(
+                int64_t(inMaxReadSize) + (64 << 10),
+                int64_t(std::numeric_limits<int>::max())
+            );
+        }
+    private:
+        Shared(
+            const Shared& inShared);
+        Shared& operator=(
+            const Shared& inShared);
+    };
+    friend class Shared;
+
+    // Owns the network manager, or references the shared one.
+    class NetRuntime
+    {
+    public:
+        NetRuntime(
+            const Parameters& inParameters)
+            : mSharedPtr(inParameters.mSharedConnectionPoolFlag ?
+                &Shared::Get(inParameters) : 0),
+              mNetManagerPtr(mSharedPtr ?
+                &mSharedPtr->GetNetManager() : new NetManager())
+            {}
+        ~NetRuntime()
+        {
+            if (mSharedPtr) {
+                Shared::Put(*mSharedPtr);
+            } else {
+                delete mNetManagerPtr;
+            }
+        }
+        Shared* GetSharedPtr() const
+            { return mSharedPtr; }
+        NetManager& GetNetManager() const
+            { return *mNetManagerPtr; }
+    private:
+        Shared* const     mSharedPtr;
+        NetManager* const mNetManagerPtr;
+    private:
+        NetRuntime(
+            const NetRuntime& inRuntime);
+        NetRuntime& operator=(
+            const NetRuntime& inRuntime);
+    };
+
     Impl(
         string            inMetaHost,
         int               inMetaPort,
         const Parameters& inParameters)
         : QCRunnable(),
           ITimeout(),
-          mNetManager(),
+          mNetRuntime(inParameters),
+          mSharedPtr(mNetRuntime.GetSharedPtr()),
+          mNetManager(mNetRuntime.GetNetManager()),
+          mSharedAttachedFlag(false),
+          mSharedStoppedFlag(false),
+          mSharedStartedFlag(false),
           mMetaServer(
             mNetManager,
             inMetaHost,
@@ -138,7 +423,8 @@ public:
           mStopRequest(),
           mWorker(this, "KfsProtocolWorker"),
           mMutex(),
-          mClientPoolPtr(inParameters.mUseClientPoolFlag ?
+          mClientPoolPtr(mSharedPtr ? &mSharedPtr->GetClientPool() :
+            inParameters.mUseClientPoolFlag ?
             new ClientPool(
                 mNetManager,
                 0,                          // inMaxRetryCount,
@@ -165,10 +451,17 @@ public:
         WorkQueue::Init(mWorkQueue);
         FreeSyncRequests::Init(mFreeSyncRequests);
         CleanupList::Init(mCleanupList);
-        mNetManager.SetResolverParameters(
-            inParameters.mResolverUseOsResolverFlag,
-            inParameters.mResolverCacheSize,
-            inParameters.mResolverCacheExpiration);
+        if (! mSharedPtr) {
+            mNetManager.SetResolverParameters(
+                inParameters.mResolverUseOsResolverFlag,
+                inParameters.mResolverCacheSize,
+                inParameters.mResolverCacheExpiration);
+            mNetManager.SetResolverCacheParameters(
+                inParameters.mResolverNegativeCacheExpiration,
+                inParameters.mResolverCacheRefreshAhead,
+                inParameters.mResolverThreadCount);
+            mNetManager.SetLocalSocketDir(inParameters.mLocalSocketDir);
+        }
         mMetaServer.SetMaxMetaLogWriteRetryCount(mMetaMaxRetryCount);
         mMetaServer.SetRackId(inParameters.mClientRackId);
         mMetaServer.SetNodeId(inParameters.mNodeId.c_str());
@@ -183,7 +476,12 @@ public:
         );
     }
     virtual ~Impl()
-        { Impl::Stop(); }
+    {
+        Impl::Stop();
+        if (! mSharedPtr) {
+            delete mClientPoolPtr;
+        }
+    }
     virtual void Run()
     {
         mNetManager.RegisterTimeoutHandler(this);
@@ -192,6 +490,15 @@ public:
     }
     void Start()
     {
+        if (mSharedPtr) {
+            if (! mSharedStartedFlag) {
+                mSharedStartedFlag  = true;
+                mSharedStoppedFlag  = false;
+                mStopRequest.mState = Request::kStateNone;
+                mSharedPtr->Attach(*this);
+            }
+            return;
+        }
         if (mWorker.IsStarted()) {
             return;
         }
@@ -207,7 +514,14 @@ public:
                 Enqueue(mStopRequest);
             }
         }
-        mWorker.Join();
+        if (mSharedPtr) {
+            if (mSharedStartedFlag) {
+                mSharedPtr->WaitDetached(*this);
+                mSharedStartedFlag = false;
+            }
+        } else {
+            mWorker.Join();
+        }
         {
             QCStMutexLocker lock(mMutex);
             QCRTASSERT(
@@ -291,7 +605,19 @@ public:
             }
             QCASSERT(mWorkers.empty());
             mMetaServer.Shutdown();
-            mNetManager.Shutdown();
+            if (mSharedPtr) {
+                // The pooled connections with this worker's authentication
+                // context are no longer used, and the context can be deleted
+                // once this worker is stopped.
+                ClientAuthContext* const theCtxPtr =
+                    mMetaServer.GetAuthContext();
+                if (theCtxPtr) {
+                    mClientPoolPtr->Remove(theCtxPtr);
+                }
+                mSharedStoppedFlag = true;
+            } else {
+                mNetManager.Shutdown();
+            }
         }
     }
     int64_t Execute(
@@ -1687,7 +2013,12 @@ private:
     };
     friend class FileReader;
 
-    NetManager           mNetManager;
+    NetRuntime           mNetRuntime;
+    Shared* const        mSharedPtr;
+    NetManager&          mNetManager;
+    bool                 mSharedAttachedFlag;
+    bool                 mSharedStoppedFlag;
+    bool                 mSharedStartedFlag;
     MetaServer           mMetaServer;
     int                  mMetaOpTimeout;
     int                  mMetaTimeBetweenRetries;
@@ -1944,11 +2275,57 @@ private:
             mClientPoolPtr->GetStats(theStats);
             theStats.Enumerate(theEnumerator.SetPrefix("ChunkServer.Pool."));
             theEnumerator("Size", mClientPoolPtr->GetSize());
+            theEnumerator("Shared", mSharedPtr ? 1 : 0);
+            ClientPool::Counters thePoolCounters;
+            mClientPoolPtr->GetCounters(thePoolCounters);
+            thePoolCounters.Enumerate(theEnumerator);
         }
+        ECEncoderPool::Stats theEncoderStats;
+        ECEncoderPool::GetStats(theEncoderStats);
+        theEncoderStats.Enumerate(theEnumerator.SetPrefix("ECEncoder."));
         theEnumerator.SetPrefix("Network.");
         theEnumerator("Sockets",       globals().ctrOpenNetFds.GetValue());
         theEnumerator("BytesSent",     globals().ctrNetBytesWritten.GetValue());
         theEnumerator("BytesReceived", globals().ctrNetBytesRead.GetValue());
+        theEnumerator("KtlsSessions",
+            globals().ctrNetKtlsSessions.GetValue());
+        theEnumerator("KtlsBytesSent",
+            globals().ctrNetKtlsBytesWritten.GetValue());
+        theEnumerator("KtlsBytesReceived",
+            globals().ctrNetKtlsBytesRead.GetValue());
+        Resolver::Counters theResolverCounters;
+        mNetManager.GetResolverCounters(theResolverCounters);
+        theEnumerator.SetPrefix("Resolver.");
+        theEnumerator("CacheHits",    theResolverCounters.mHitCount);
+        theEnumerator("CacheNegativeHits",
+            theResolverCounters.mNegativeHitCount);
+        theEnumerator("CacheMisses",  theResolverCounters.mMissCount);
+        theEnumerator("CacheRefresh", theResolverCounters.mRefreshCount);
+        theEnumerator("CacheSize",    theResolverCounters.mCacheSize);
+        theEnumerator("Resolved",     theResolverCounters.mResolvedCount);
+        theEnumerator("Errors",       theResolverCounters.mErrorCount);
+        theEnumerator("ResolveUsec",  theResolverCounters.mResolveTimeUsec);
+        NetManager::Counters theNetCounters;
+        mNetManager.GetCounters(theNetCounters);
+        theEnumerator.SetPrefix("NetManager.");
+        theEnumerator("Loops",        theNetCounters.mLoopCount);
+        theEnumerator("PollWaitUsec", theNetCounters.mPollWaitUsec);
+        theEnumerator("DispatchUsec", theNetCounters.mDispatchUsec);
+        theEnumerator("TimerUsec",    theNetCounters.mTimerUsec);
+        theEnumerator("TimeoutHandlers",
+            theNetCounters.mTimeoutHandlerCount);
+        theEnumerator("TimeoutHandlerCalls",
+            theNetCounters.mTimeoutHandlerCallCount);
+        MemoryAccounting::Counters theMemCounters;
+        MemoryAccounting::GetCounters(theMemCounters);
+        theEnumerator.SetPrefix("Memory.");
+        for (int i = 0; i < MemoryAccounting::kSubsystemCount; i++) {
+            const string theName = MemoryAccounting::GetName(i);
+            theEnumerator((theName + ".Bytes").c_str(),
+                theMemCounters.mBytes[i]);
+            theEnumerator((theName + ".Count").c_str(),
+                theMemCounters.mCount[i]);
+        }
         return theRet;
     }
 private:
@@ -1958,6 +2335,9 @@ private:
         const Impl& inImpl);
 };
 
+QCMutex                          KfsProtocolWorker::Impl::Shared::sMutex;
+KfsProtocolWorker::Impl::Shared* KfsProtocolWorker::Impl::Shared::sInstancePtr = 0;
+
 KfsProtocolWorker::Request::Request(
     KfsProtocolWorker::RequestType            inRequestType  /* = kRequestTypeUnknown */,
     KfsProtocolWorker::FileInstance           inFileInstance /* = 0 */,
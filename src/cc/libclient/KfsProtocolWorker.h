@@ -244,7 +244,14 @@ public:
               mResolverUseOsResolverFlag(inResolverUseOsResolverFlag),
               mResolverCacheSize(inResolverCacheSize),
               mResolverCacheExpiration(inResolverCacheExpiration),
-              mNodeId(inNodeId)
+              mResolverNegativeCacheExpiration(-1),
+              mResolverCacheRefreshAhead(-1),
+              mResolverThreadCount(1),
+              mNodeId(inNodeId),
+              mLocalSocketDir(),
+              mSharedConnectionPoolFlag(false),
+              mSharedMaxConnectionsPerServer(4),
+              mSharedIdleTimeoutSec(-1)
             {}
             int                 mMetaMaxRetryCount;
             int                 mMetaTimeSecBetweenRetries;
@@ -275,7 +282,14 @@ public:
             bool                mResolverUseOsResolverFlag;
             int                 mResolverCacheSize;
             int                 mResolverCacheExpiration;
+            int                 mResolverNegativeCacheExpiration;
+            int                 mResolverCacheRefreshAhead;
+            int                 mResolverThreadCount;
             string              mNodeId;
+            string              mLocalSocketDir;
+            bool                mSharedConnectionPoolFlag;
+            int                 mSharedMaxConnectionsPerServer;
+            int                 mSharedIdleTimeoutSec;
     };
     KfsProtocolWorker(
         std::string       inMetaHost,
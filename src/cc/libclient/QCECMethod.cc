@@ -31,9 +31,14 @@
 #include "common/IntToString.h"
 
 #include "qcdio/QCUtils.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
 
 #include <algorithm>
 
+#include <errno.h>
+#include <string.h>
+
 namespace KFS
 {
 namespace client
@@ -117,7 +122,8 @@ protected:
             }
             return false;
         }
-        if (inRecoveryStripeCount != RS_LIB_MAX_RECOVERY_BLOCKS) {
+        if (inRecoveryStripeCount <= 0 ||
+                RS_LIB_MAX_WIDE_RECOVERY_BLOCKS < inRecoveryStripeCount) {
             if (outErrMsgPtr) {
                 *outErrMsgPtr = "QCRS: invalid recovery stripe count";
             }
@@ -140,8 +146,8 @@ private:
             int    inLength,
             void** inBuffersPtr)
         {
-            rs_encode(inStripeCount + inRecoveryStripeCount,
-                inLength, inBuffersPtr);
+            rs_encode_n(inStripeCount + inRecoveryStripeCount,
+                inRecoveryStripeCount, inLength, inBuffersPtr);
             return 0;
         }
         virtual void Release()
@@ -151,12 +157,17 @@ private:
     {
     public:
         QCRSDecoder()
-            : ECMethod::Decoder()
-            {}
+            : ECMethod::Decoder(),
+              mMutex()
+        {
+            for (int i = 0; i < kCacheSize; i++) {
+                mCache[i].mStripeCount = 0;
+            }
+        }
         virtual ~QCRSDecoder()
             {}
         virtual bool SupportsOneRecoveryStripeRebuild() const
-            { return false; }
+            { return true; }
         virtual int Decode(
             int        inStripeCount,
             int        inRecoveryStripeCount,
@@ -164,18 +175,80 @@ private:
             void**     inBuffersPtr,
             int const* inMissingStripesIdxPtr)
         {
-            rs_decode3(
-                inStripeCount + inRecoveryStripeCount,
-                inLength,
-                inMissingStripesIdxPtr[0],
-                inMissingStripesIdxPtr[1],
-                inMissingStripesIdxPtr[2],
-                inBuffersPtr
-            );
+            rs_decoder theDecoder;
+            if (! GetDecoder(inStripeCount, inRecoveryStripeCount,
+                    inMissingStripesIdxPtr, theDecoder)) {
+                return -EINVAL;
+            }
+            rs_decode_n(&theDecoder, inLength, inBuffersPtr);
             return 0;
         }
         virtual void Release()
             {}
+    private:
+        // Decoding matrices cache, keyed by the missing stripes set. The
+        // matrix inversion cost is comparable with decoding a few KB.
+        enum { kCacheSize = 64 };
+        struct Entry
+        {
+            int        mStripeCount;
+            int        mRecoveryStripeCount;
+            uint64_t   mMissing[2];
+            rs_decoder mDecoder;
+        };
+        QCMutex mMutex;
+        Entry   mCache[kCacheSize];
+
+        bool GetDecoder(
+            int         inStripeCount,
+            int         inRecoveryStripeCount,
+            int const*  inMissingStripesIdxPtr,
+            rs_decoder& outDecoder)
+        {
+            const int theBlockCount = inStripeCount + inRecoveryStripeCount;
+            int       theMissing[RS_LIB_MAX_WIDE_RECOVERY_BLOCKS + 1];
+            uint64_t  theKey[2] = { 0, 0 };
+            int       theCnt    = 0;
+            while (theCnt < inRecoveryStripeCount &&
+                    0 <= inMissingStripesIdxPtr[theCnt]) {
+                const int theIdx = inMissingStripesIdxPtr[theCnt];
+                if (theBlockCount <= theIdx) {
+                    return false;
+                }
+                theKey[theIdx >> 6] |= uint64_t(1) << (theIdx & 63);
+                theMissing[theCnt++] = theIdx;
+            }
+            theMissing[theCnt] = -1;
+            const size_t theSlot = (size_t)((
+                (theKey[0] * 0x9E3779B97F4A7C15ull) ^
+                (theKey[1] * 0xC2B2AE3D27D4EB4Full) ^
+                (uint64_t)(inStripeCount << 8 | inRecoveryStripeCount)
+            ) >> 32) % kCacheSize;
+            Entry& theEntry = mCache[theSlot];
+            {
+                QCStMutexLocker theLocker(mMutex);
+                if (theEntry.mStripeCount == inStripeCount &&
+                        theEntry.mRecoveryStripeCount ==
+                            inRecoveryStripeCount &&
+                        theEntry.mMissing[0] == theKey[0] &&
+                        theEntry.mMissing[1] == theKey[1]) {
+                    memcpy(&outDecoder, &theEntry.mDecoder,
+                        sizeof(outDecoder));
+                    return true;
+                }
+            }
+            if (rs_decoder_init(&outDecoder, theBlockCount,
+                    inRecoveryStripeCount, theMissing) != 0) {
+                return false;
+            }
+            QCStMutexLocker theLocker(mMutex);
+            theEntry.mStripeCount         = inStripeCount;
+            theEntry.mRecoveryStripeCount = inRecoveryStripeCount;
+            theEntry.mMissing[0]          = theKey[0];
+            theEntry.mMissing[1]          = theKey[1];
+            memcpy(&theEntry.mDecoder, &outDecoder, sizeof(outDecoder));
+            return true;
+        }
     };
     const string mDescription;
     QCRSEncoder  mEncoder;
@@ -187,9 +260,9 @@ private:
         theRet += "id: ";
         AppendDecIntToString(theRet, int(KFS_STRIPED_FILE_TYPE_RS)) +=
             "; qcrs"
-            "; recovery stripes: 0 or ";
-        AppendDecIntToString(theRet, RS_LIB_MAX_RECOVERY_BLOCKS) +=
-            "; data stripes range: [1, ";
+            "; recovery stripes range: [1, ";
+        AppendDecIntToString(theRet, RS_LIB_MAX_WIDE_RECOVERY_BLOCKS) +=
+            "] or 0; data stripes range: [1, ";
         AppendDecIntToString(theRet,
                 min(RS_LIB_MAX_DATA_BLOCKS, KFS_MAX_DATA_STRIPE_COUNT)) +=
             "] or [1, ";
@@ -26,6 +26,7 @@
 #include "RSStriper.h"
 #include "Writer.h"
 #include "ECMethod.h"
+#include "ECEncoderPool.h"
 
 #include "kfsio/IOBuffer.h"
 #include "kfsio/checksum.h"
@@ -556,9 +557,9 @@ public:
         int    theFailedCount     = GetWriteFailuresCount(
             inChunkOffset, theChunkBlockStart, theChunkBlockEnd);
         // Allow one failure, after 1 retry.
-        if (mRecoveryStripeCount <= theFailedCount ||
+        if (mMaxWriteFailureCount <= theFailedCount ||
                 (inRetryCount < inMaxRetryCount && inRetryCount > 0 &&
-                (mRecoveryStripeCount > 1 ? 1 : 0) <= theFailedCount)) {
+                (mMaxWriteFailureCount > 1 ? 1 : 0) <= theFailedCount)) {
             return true;
         }
         mWriteFailures.insert(inChunkOffset);
@@ -610,6 +611,8 @@ private:
     WriteFailures            mWriteFailures;
     Buffer* const            mBuffersPtr;
     ECMethod::Encoder* const mEncoderPtr;
+    const int                mMaxWriteFailureCount;
+    ECEncoderPool::Batch     mEncodeBatch;
 
     RSWriteStriper(
         int                inStripeSize,
@@ -632,7 +635,12 @@ private:
           mLastPartialFlushPos(0),
           mWriteFailures(),
           mBuffersPtr(new Buffer[inStripeCount + inRecoveryStripeCount]),
-          mEncoderPtr(inEncoderPtr)
+          mEncoderPtr(inEncoderPtr),
+          mMaxWriteFailureCount(inEncoderPtr ?
+            inEncoderPtr->GetMaxFailureCount(
+                inStripeCount, inRecoveryStripeCount) :
+            inRecoveryStripeCount),
+          mEncodeBatch()
         {}
     bool IsChunkWriterFailed(
         Offset inOffset) const
@@ -827,7 +835,8 @@ private:
             thePendingCount += mBuffersPtr[i].mBuffer.BytesConsumable();
         }
         for (int thePos = 0, thePrevLen = 0; thePos < theSize; ) {
-            int theLen = theSize - thePos;
+            int  theLen      = theSize - thePos;
+            bool theTempFlag = false;
             for (int i = 0; i < mStripeCount; i++) {
                 IOBuffer&           theBuf  = mBuffersPtr[i].mBuffer;
                 IOBuffer::iterator& theIt   = mBuffersPtr[i].mCurIt;
@@ -869,12 +878,14 @@ private:
                     } while (theRem > 0);
                     theLen = kAlign;
                     theSkip -= theLen; // To cancel the thePrevLen addition.
+                    theTempFlag = true;
                 } else {
                     theBufSize -= theBufSize % kAlign;
                     theLen = min(theLen, theBufSize);
                     if (PtrFront(thePtr, kAlign) != 0) {
                         theLen = min((int)kTempBufSize, theLen);
                         mBufPtr[i] = memcpy(GetTempBufPtr(i), thePtr, theLen);
+                        theTempFlag = true;
                     } else {
                         mBufPtr[i] = const_cast<char*>(thePtr);
                     }
@@ -889,16 +900,14 @@ private:
                     " len: " << theLen <<
                 KFS_LOG_EOM;
             }
-            const int theStatus = mEncoderPtr->Encode(
-                mStripeCount, mRecoveryStripeCount, theLen, mBufPtr);
-            if (theStatus != 0) {
-                KFS_LOG_STREAM_ERROR << mLogPrefix <<
-                    "recovery:"
-                    " encode error: " << theStatus <<
-                    " off: "          << mRecoveryEndPos <<
-                    " pos: "          << thePos <<
-                    " len: "          << theLen <<
-                KFS_LOG_EOM;
+            void** const theBufsPtr = mEncodeBatch.Add(*mEncoderPtr,
+                mStripeCount, mRecoveryStripeCount, theLen);
+            for (int i = 0; i < mStripeCount + mRecoveryStripeCount; i++) {
+                theBufsPtr[i] = mBufPtr[i];
+            }
+            // The temporary buffers are re-used by the next iteration, thus
+            // the batch with such buffers has to be executed now.
+            if (theTempFlag && ! EncodeBatch(thePos, theLen)) {
                 return false;
             }
             for (int i = mStripeCount;
@@ -909,6 +918,9 @@ private:
             thePos += theLen;
             thePrevLen = theLen;
         }
+        if (! EncodeBatch(theSize, 0)) {
+            return false;
+        }
         if (IOBuffer::IsDebugVerify()) {
             for (int i = mStripeCount;
                     i < mStripeCount + mRecoveryStripeCount;
@@ -944,6 +956,31 @@ private:
         mPendingCount = thePendingCount;
         return true;
     }
+    bool EncodeBatch(
+        int inPos,
+        int inLen)
+    {
+        if (mEncodeBatch.IsEmpty()) {
+            return true;
+        }
+        const int theStatus = mEncodeBatch.Execute();
+        EncodeDone(
+            mEncodeBatch.GetByteCount(),
+            mEncodeBatch.GetCpuMicroSec(),
+            mEncodeBatch.GetOffloadedCount()
+        );
+        if (theStatus != 0) {
+            KFS_LOG_STREAM_ERROR << mLogPrefix <<
+                "recovery:"
+                " encode error: " << theStatus <<
+                " off: "          << mRecoveryEndPos <<
+                " pos: "          << inPos <<
+                " len: "          << inLen <<
+            KFS_LOG_EOM;
+            return false;
+        }
+        return true;
+    }
     void TrimBufferFront(
         Buffer& inBuf,
         int&    ioStrideTrim,
@@ -1078,6 +1115,7 @@ public:
             thePtr->Delete(*this, mInFlightList);
         }
         delete [] mBufIteratorsPtr;
+        delete [] mLocalRepairStripesPtr;
         delete mZeroBufferPtr;
         if (mDecoderPtr) {
             mDecoderPtr->Release();
@@ -1799,6 +1837,7 @@ private:
         int       mRecursionCount;
         int       mRecoverySize;
         int       mBadStripeCount;
+        bool      mLocalRepairFlag;
 
         static Request& Create(
             Outer&    inOuter,
@@ -1861,8 +1900,9 @@ private:
             mStatus         = 0;
             mRecoveryRound  = 0;
             mRecursionCount = 0;
-            mRecoverySize   = 0;
-            mBadStripeCount = 0;
+            mRecoverySize    = 0;
+            mBadStripeCount  = 0;
+            mLocalRepairFlag = false;
             const int theBufCount = inOuter.GetBufferCount();
             for (int i = 0; i < theBufCount; i++) {
                 GetBuffer(i).Clear();
@@ -1898,7 +1938,7 @@ private:
                     " round: "       << mRecoveryRound    <<
                 KFS_LOG_EOM;
                 if (inNewFailureFlag && mRecoveryRound <= 0 &&
-                        Recovery(inOuter)) {
+                        ! mLocalRepairFlag && Recovery(inOuter)) {
                     return;
                 }
             } else if (mRecoveryRound > 0 &&
@@ -2010,7 +2050,8 @@ private:
               mRecoveryRound(0),
               mRecursionCount(0),
               mRecoverySize(0),
-              mBadStripeCount(0)
+              mBadStripeCount(0),
+              mLocalRepairFlag(false)
             { Requests::Init(*this); }
         ~Request()
             {}
@@ -2038,6 +2079,14 @@ private:
             if (mPendingCount > 0) {
                 return;
             }
+            if (mLocalRepairFlag) {
+                if (inOuter.FinishLocalRepair(*this)) {
+                    inOuter.RequestCompletion(*this);
+                } else {
+                    inOuter.RestartChunkRecovery(*this);
+                }
+                return;
+            }
             if (mRecoverySize > 0 ||
                     inOuter.mStripeCount <= inOuter.mRecoverStripeIdx) {
                 inOuter.FinishRecovery(*this);
@@ -2391,6 +2440,12 @@ private:
             Clear();
             mPos                = inPos;
             mChunkBlockStartPos = mPos - mPos % inOuter.mChunkBlockSize;
+            if (! inOuter.IsMaximumDistanceSeparable()) {
+                // Not any stripe subset of data stripe count size can be
+                // used for recovery, read all data stripes.
+                mMissingIdx[mMissingCnt++] = inBadStripeIdx;
+                return;
+            }
             const int theCnt    = inOuter.GetBufferCount();
             StBufferT<StripeIdx, (32 + 1) * 2> theTmpBuf;
             StripeIdx* const theSwappedIdx = theTmpBuf.Resize(
@@ -2568,6 +2623,8 @@ private:
     uint32_t                 mNextRand;
     uint32_t                 mRecoveriesCount;
     ECMethod::Decoder* const mDecoderPtr;
+    int                      mLocalRepairCount;
+    int*                     mLocalRepairStripesPtr;
     Request*                 mPendingQueue[1];
     Request*                 mFreeList[1];
     Request*                 mInFlightList[1];
@@ -2615,12 +2672,25 @@ private:
           mPendingCount(0),
           mNextRand((uint32_t)inInitialSeqNum),
           mRecoveriesCount(0),
-          mDecoderPtr(inDecoderPtr)
+          mDecoderPtr(inDecoderPtr),
+          mLocalRepairCount(0),
+          mLocalRepairStripesPtr(0)
     {
         QCASSERT(inRecoverChunkPos < 0 || inRecoverChunkPos % CHUNKSIZE == 0);
         Requests::Init(mPendingQueue);
         Requests::Init(mFreeList);
         Requests::Init(mInFlightList);
+        // Local repair relies on the file size to validate the stripe sizes.
+        if (0 <= mRecoverStripeIdx && 0 <= mFileSize && mDecoderPtr) {
+            mLocalRepairStripesPtr = new int[mStripeCount];
+            mLocalRepairCount = mDecoderPtr->GetLocalRepairStripes(
+                mStripeCount, mRecoveryStripeCount, mRecoverStripeIdx,
+                mLocalRepairStripesPtr);
+        }
+    }
+    bool IsMaximumDistanceSeparable() const
+    {
+        return (! mDecoderPtr || mDecoderPtr->IsMaximumDistanceSeparable());
     }
     void QueueRequest(
         Request& inRequest)
@@ -2655,6 +2725,21 @@ private:
                 inBuffer.begin() != inBuffer.end()) {
             return kErrorParameters;
         }
+        SetRecoveryPos(inChunkOffset, inLength);
+        Request& theRequest = GetRequest(inRequestId, GetPos(), 0);
+        theRequest.mRecoverySize = -inLength;
+        theRequest.mRecoveryPos  = GetChunkBlockStartFilePos() + inChunkOffset;
+        if (! InitLocalRepair(theRequest)) {
+            InitChunkRecovery(theRequest);
+        }
+        QueueRequest(theRequest);
+        Read();
+        return inLength;
+    }
+    void SetRecoveryPos(
+        Offset inChunkOffset,
+        int    inLength)
+    {
         SetPos(
             mRecoverBlockPos +
             inChunkOffset / mStripeSize * mStrideSize +
@@ -2662,9 +2747,12 @@ private:
             ((mRecoverStripeIdx < mStripeCount && inLength <= mStripeSize) ?
                 mStripeSize * mRecoverStripeIdx : 0)
         );
-        Request& theRequest = GetRequest(inRequestId, GetPos(), 0);
-        theRequest.mRecoverySize = -inLength;
-        theRequest.mRecoveryPos  = GetChunkBlockStartFilePos() + inChunkOffset;
+    }
+    void InitChunkRecovery(
+        Request& theRequest)
+    {
+        const int kChunkSize = (int)CHUNKSIZE;
+        const int inLength   = -theRequest.mRecoverySize;
         mRecoveryInfo.SetIfEmpty(*this, theRequest.mPos, mRecoverStripeIdx);
         Offset thePos = theRequest.mRecoveryPos;
         if (mStripeSize < inLength) {
@@ -2690,9 +2778,133 @@ private:
                 QCASSERT(theRequest.mRecoverySize == inLength);
             }
         }
-        QueueRequest(theRequest);
+    }
+    // Read only the local group stripes, if the decoder supports local
+    // repair of the stripe being recovered.
+    bool InitLocalRepair(
+        Request& inRequest)
+    {
+        if (mLocalRepairCount <= 0) {
+            return false;
+        }
+        inRequest.mRecoverySize    = -inRequest.mRecoverySize;
+        inRequest.mSize            = inRequest.mRecoverySize;
+        inRequest.mLocalRepairFlag = true;
+        for (int i = 0; i < mLocalRepairCount; i++) {
+            const int theIdx = mLocalRepairStripesPtr[i];
+            inRequest.mPendingCount +=
+                inRequest.GetBuffer(theIdx).InitRecoveryRead(
+                    *this,
+                    inRequest.mRecoveryPos + theIdx * (Offset)CHUNKSIZE,
+                    inRequest.mRecoverySize
+                );
+        }
+        KFS_LOG_STREAM_DEBUG << mLogPrefix <<
+            "local repair:"
+            " pos: "     << inRequest.mRecoveryPos  <<
+            " size: "    << inRequest.mRecoverySize <<
+            " stripe: "  << mRecoverStripeIdx       <<
+            " stripes: " << mLocalRepairCount       <<
+        KFS_LOG_EOM;
+        return true;
+    }
+    // Returns false if any local group stripe read has failed, or its size
+    // does not match the file size, in which case the recovery must be
+    // re-started with all the stripes.
+    bool FinishLocalRepair(
+        Request& inRequest)
+    {
+        const int    theSize     = inRequest.mRecoverySize;
+        const Offset theChunkPos = GetChunkPos(inRequest.mRecoveryPos);
+        for (int i = 0; i < mLocalRepairCount; i++) {
+            const int theIdx      = mLocalRepairStripesPtr[i];
+            Buffer&   theBuf      = inRequest.GetBuffer(theIdx);
+            const int theRdSize   = theBuf.GetReadSize();
+            const int theExpected = (int)max(Offset(0), min(Offset(theSize),
+                GetChunkSize(theIdx, mRecoverBlockPos, mFileSize) -
+                theChunkPos));
+            if (theRdSize != theExpected || theBuf.mBuf.mSize != 0 ||
+                    theBuf.mBufR.mSize != 0) {
+                KFS_LOG_STREAM_INFO << mLogPrefix <<
+                    "local repair failed:"
+                    " pos: "      << inRequest.mRecoveryPos <<
+                    " size: "     << theSize                <<
+                    " stripe: "   << theIdx                 <<
+                    " status: "   << theBuf.GetStatus()     <<
+                    " read: "     << theRdSize              <<
+                    " expected: " << theExpected            <<
+                    " chunk: "    << theBuf.mChunkId        <<
+                    " version: "  << theBuf.mChunkVersion   <<
+                KFS_LOG_EOM;
+                return false;
+            }
+        }
+        IOBuffer theResult;
+        if (mUseDefaultBufferAllocatorFlag) {
+            theResult.EnsureSpaceAvailable(theSize);
+        } else {
+            theResult.Append(NewDataBuffer(theSize));
+        }
+        if (theResult.ZeroFillSpaceAvailable(theSize) != theSize) {
+            InternalError("local repair: invalid buffer space");
+            inRequest.mStatus = kErrorIO;
+            return true;
+        }
+        theResult.RemoveSpaceAvailable();
+        for (int i = 0; i < mLocalRepairCount; i++) {
+            Buffer& theBuf = inRequest.GetBuffer(mLocalRepairStripesPtr[i]);
+            XorIn(theBuf.mBufL.mBuffer, theResult);
+            theBuf.mBufL.mBuffer.Clear();
+        }
+        Buffer& theBuf = inRequest.GetBuffer(mRecoverStripeIdx);
+        theBuf.Clear();
+        theBuf.mPos = inRequest.mRecoveryPos +
+            mRecoverStripeIdx * (Offset)CHUNKSIZE;
+        theBuf.mBuf.mBuffer.Move(&theResult);
+        mRecoveriesCount++;
+        return true;
+    }
+    void RestartChunkRecovery(
+        Request& inRequest)
+    {
+        Requests::Remove(mInFlightList, inRequest);
+        const Offset theRecoveryPos = inRequest.mRecoveryPos;
+        const int    theSize        = inRequest.mRecoverySize;
+        SetRecoveryPos(GetChunkPos(theRecoveryPos), theSize);
+        inRequest.Reset(*this, inRequest.mRequestId, GetPos(), 0);
+        inRequest.mRecoverySize = -theSize;
+        inRequest.mRecoveryPos  = theRecoveryPos;
+        InitChunkRecovery(inRequest);
+        QueueRequest(inRequest);
         Read();
-        return inLength;
+    }
+    static void XorIn(
+        const IOBuffer& inSrc,
+        IOBuffer&       inDst)
+    {
+        IOBuffer::iterator theSrcIt  = inSrc.begin();
+        IOBuffer::iterator theDstIt  = inDst.begin();
+        int                theSrcPos = 0;
+        int                theDstPos = 0;
+        while (theSrcIt != inSrc.end() && theDstIt != inDst.end()) {
+            const int theLen = min(
+                theSrcIt->BytesConsumable() - theSrcPos,
+                theDstIt->BytesConsumable() - theDstPos);
+            const char* const theSrcPtr = theSrcIt->Consumer() + theSrcPos;
+            char* const       theDstPtr =
+                const_cast<char*>(theDstIt->Consumer()) + theDstPos;
+            for (int i = 0; i < theLen; i++) {
+                theDstPtr[i] ^= theSrcPtr[i];
+            }
+            if (theSrcIt->BytesConsumable() <= (theSrcPos += theLen)) {
+                ++theSrcIt;
+                theSrcPos = 0;
+            }
+            if (theDstIt->BytesConsumable() <= (theDstPos += theLen)) {
+                ++theDstIt;
+                theDstPos = 0;
+            }
+        }
     }
     void InvalidChunkSize(
          Request& inRequest,
@@ -3273,6 +3485,7 @@ private:
         int        theEndPosHead     = -1;
         Offset     theEndChunkSize   = -1;
         Offset     theMaxChunkSize   = -1;
+        const bool theMdsFlag        = IsMaximumDistanceSeparable();
         theMissingIdx[mRecoveryStripeCount] = -1; // Jerasure end of list.
         for (int thePos = 0; thePos < theSize; ) {
             int theLen = theSize - thePos;
@@ -3453,10 +3666,13 @@ private:
                 }
                 QCASSERT(
                     theMissingCnt == mRecoveryStripeCount ||
-                    inRequest.mRecoveryRound > 0
+                    inRequest.mRecoveryRound > 0 ||
+                    ! theMdsFlag
                 );
+                // With non MDS code all present stripes might be needed.
                 for (int i = theBufCount - 1;
-                        theMissingCnt < mRecoveryStripeCount &&
+                        theMdsFlag &&
+                            theMissingCnt < mRecoveryStripeCount &&
                             mStripeCount <= i;
                         i--) {
                     if (mBufPtr[i]) {
@@ -3472,6 +3688,7 @@ private:
                         theMissingIdx[theMissingCnt++] = i;
                     }
                 }
+                theMissingIdx[theMissingCnt] = -1;
                 if (theEndPosIdx + 1 < mStripeCount) {
                     theNextEndPos = min(theEndPos, GetNextStipeReadSize(
                         inRequest, theEndChunkSize, theEndPosHead));
@@ -3503,7 +3720,8 @@ private:
             QCRTASSERT(
                 theLen > 0 &&
                 (theLen % kAlign == 0 || theLen < kAlign) &&
-                theMissingCnt == mRecoveryStripeCount
+                (theMissingCnt == mRecoveryStripeCount ||
+                    (! theMdsFlag && theMissingCnt < mRecoveryStripeCount))
             );
             if (thePos == 0 || thePos + theLen >= theSize) {
                 KFS_LOG_STREAM_INFO << mLogPrefix       <<
@@ -930,8 +930,13 @@ private:
                 const ServerLocation& theLocation =
                     mGetAllocOp.chunkServers[mChunkServerIdx];
                 if (mOuter.mClientPoolPtr) {
+                    // Do not share connections between different users.
                     mChunkServerPtr = &mOuter.mClientPoolPtr->Get(
-                        theLocation, mGetAllocOp.allCSShortRpcFlag);
+                        theLocation,
+                        mGetAllocOp.allCSShortRpcFlag,
+                        mChunkServerAccess.IsEmpty() ? 0 :
+                            mOuter.mMetaServer.GetAuthContext()
+                    );
                 } else {
                     mChunkServerPtr = &mChunkServer;
                     mChunkServer.SetRpcFormat(mGetAllocOp.allCSShortRpcFlag ?
@@ -1368,6 +1373,11 @@ private:
             );
             mOuter.mStats.mReadCount++;
             mOuter.mStats.mReadByteCount += theDoneCount;
+            if (GetChunkServer().IsLocalConnection()) {
+                mOuter.mStats.mLocalReadByteCount  += theDoneCount;
+            } else {
+                mOuter.mStats.mRemoteReadByteCount += theDoneCount;
+            }
             if (theDoneCount < inOp.mTmpBuffer.BytesConsumable()) {
                 // Move available space, if any, to the end of the short read.
                 IOBuffer theBuf;
@@ -91,6 +91,8 @@ public:
               mRetriesCount(0),
               mReadCount(0),
               mReadByteCount(0),
+              mLocalReadByteCount(0),
+              mRemoteReadByteCount(0),
               mReadErrorsCount(0),
               mReadChecksumErrorsCount(0),
               mReadRecoveriesCount(0)
@@ -110,6 +112,8 @@ public:
             mRetriesCount            += inStats.mRetriesCount;
             mReadCount               += inStats.mReadCount;
             mReadByteCount           += inStats.mReadByteCount;
+            mLocalReadByteCount      += inStats.mLocalReadByteCount;
+            mRemoteReadByteCount     += inStats.mRemoteReadByteCount;
             mReadErrorsCount         += inStats.mReadErrorsCount;
             mReadChecksumErrorsCount += inStats.mReadChecksumErrorsCount;
             mReadRecoveriesCount     += inStats.mReadRecoveriesCount;
@@ -131,6 +135,8 @@ public:
             inFunctor("ReadRecoveries",     mReadRecoveriesCount);
             inFunctor("Reads",              mReadCount);
             inFunctor("ReadBytes",          mReadByteCount);
+            inFunctor("LocalReadBytes",     mLocalReadByteCount);
+            inFunctor("RemoteReadBytes",    mRemoteReadByteCount);
         }
         Counter mMetaOpsQueuedCount;
         Counter mMetaOpsCancelledCount;
@@ -142,6 +148,10 @@ public:
         Counter mRetriesCount;
         Counter mReadCount;
         Counter mReadByteCount;
+        // Bytes read from the chunk servers on this host through unix domain
+        // socket, and over the network.
+        Counter mLocalReadByteCount;
+        Counter mRemoteReadByteCount;
         Counter mReadErrorsCount;
         Counter mReadChecksumErrorsCount;
         Counter mReadRecoveriesCount;
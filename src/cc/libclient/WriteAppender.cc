@@ -1051,7 +1051,11 @@ private:
         const ServerLocation& theMaster = mAllocOp.chunkServers.front();
         if (mClientPoolPtr) {
             mChunkServerPtr = &mClientPoolPtr->Get(
-                theMaster, mAllocOp.allCSShortRpcFlag);
+                theMaster,
+                mAllocOp.allCSShortRpcFlag,
+                mAllocOp.chunkServerAccessToken.empty() ? 0 :
+                    mMetaServer.GetAuthContext()
+            );
         } else {
             mChunkServerPtr = 0;
             const ServerLocation theCurLoc = mChunkServer.GetServerLocation();
@@ -30,6 +30,7 @@
 #include <cerrno>
 #include <sstream>
 #include <bitset>
+#include <vector>
 #include <string.h>
 
 #include "kfsio/IOBuffer.h"
@@ -59,6 +60,7 @@ using std::max;
 using std::string;
 using std::ostream;
 using std::ostringstream;
+using std::vector;
 
 // Kfs client write state machine implementation.
 class Writer::Impl :
@@ -131,7 +133,11 @@ public:
           mOpStartTime(0),
           mCompletionDepthCount(0),
           mStriperProcessCount(0),
-          mStriperPtr(0)
+          mStriperPtr(0),
+          mAllocBatchFlag(false),
+          mAllocBatchDepth(0),
+          mAllocBatchPtr(0),
+          mAllocBatches()
         { Writers::Init(mWriters); }
     int Open(
         kfsFileId_t inFileId,
@@ -291,6 +297,17 @@ public:
         while (! Writers::IsEmpty(mWriters)) {
             delete Writers::Front(mWriters);
         }
+        delete mAllocBatchPtr;
+        mAllocBatchPtr = 0;
+        while (! mAllocBatches.empty()) {
+            AllocBatch* const theBatchPtr = mAllocBatches.back();
+            mMetaServer.Cancel(theBatchPtr, this);
+            if (! mAllocBatches.empty() &&
+                    theBatchPtr == mAllocBatches.back()) {
+                mAllocBatches.pop_back();
+                delete theBatchPtr;
+            }
+        }
         if (mTruncateOp.fid >= 0) {
             mMetaServer.Cancel(&mTruncateOp, this);
         }
@@ -366,6 +383,7 @@ public:
 
 private:
     typedef KfsNetClient ChunkServer;
+    class AllocBatch;
 
     class ChunkWriter : public KfsCallbackObj, private KfsNetClient::OpOwner
     {
@@ -525,7 +543,9 @@ private:
               mChunkAccessExpireTime(0),
               mCSAccessExpireTime(0),
               mUpdateLeaseOp(0, -1, 0),
-              mSleepTimer(inOuter.mNetManager, *this)
+              mSleepTimer(inOuter.mNetManager, *this),
+              mAllocBatchPtr(0),
+              mAllocBatchIdx(0)
         {
             SET_HANDLER(this, &ChunkWriter::EventHandler);
             Queue::Init(mPendingQueue);
@@ -696,7 +716,7 @@ private:
                 }
                 mChunkServer.Stop();
                 if (mLastOpPtr == &mAllocOp) {
-                    mOuter.mMetaServer.Cancel(mLastOpPtr, this);
+                    CancelAlloc();
                 }
                 mClosingFlag        = false;
                 mAllocOp.fileOffset = -1;
@@ -793,6 +813,35 @@ private:
         {
             return (mAllocOp.fileOffset >= 0 ? mOpenChunkBlockFileOffset : -1);
         }
+        AllocateOp& GetAllocOp()
+            { return mAllocOp; }
+        void SetAllocBatch(
+            AllocBatch* inBatchPtr,
+            size_t      inIdx)
+        {
+            mAllocBatchPtr = inBatchPtr;
+            mAllocBatchIdx = inIdx;
+        }
+        // Send allocation that was queued for the batch individually.
+        void StartAlloc()
+        {
+            QCASSERT(&mAllocOp == mLastOpPtr);
+            mAllocBatchPtr = 0;
+            EnqueueAlloc();
+        }
+        void AllocBatchDone(
+            const KfsOp& inBatchOp,
+            bool         inCanceledFlag)
+        {
+            QCASSERT(mAllocBatchPtr);
+            mAllocBatchPtr = 0;
+            if (inBatchOp.status != 0) {
+                mAllocOp.status    = inBatchOp.status;
+                mAllocOp.statusMsg = inBatchOp.statusMsg;
+                mAllocOp.lastError = inBatchOp.lastError;
+            }
+            OpDone(&mAllocOp, inCanceledFlag, 0);
+        }
 
     private:
         typedef std::vector<WriteInfo>                      WriteIds;
@@ -828,6 +877,8 @@ private:
         time_t         mCSAccessExpireTime;
         WritePrepareOp mUpdateLeaseOp;
         Timer          mSleepTimer;
+        AllocBatch*    mAllocBatchPtr;
+        size_t         mAllocBatchIdx;
         WriteOp*       mPendingQueue[1];
         WriteOp*       mInFlightQueue[1];
         ChunkWriter*   mPrevPtr[1];
@@ -867,6 +918,10 @@ private:
             mAllocOp.maxAppendersPerChunk = 0;
             mAllocOp.allowCSClearTextFlag = false;
             mAllocOp.allCSShortRpcFlag    = false;
+            // Ask if batch allocation is supported until the first response
+            // with batch allocation support.
+            mAllocOp.allocBatchFlag       =
+                0 < mOuter.mReplicaCount && ! mOuter.mAllocBatchFlag;
             mAllocOp.chunkLeaseDuration            = -1;
             mAllocOp.chunkServerAccessValidForTime = 0;
             mAllocOp.chunkServerAccessIssuedTime   = 0;
@@ -874,12 +929,35 @@ private:
             mAllocOp.chunkAccess.clear();
             mAllocOp.chunkServerAccessToken.clear();
             mOuter.mStats.mChunkAllocCount++;
+            if (mOuter.QueueAllocate(*this)) {
+                // Allocation will be sent as part of the batch.
+                mLastOpPtr   = &mAllocOp;
+                mOpStartTime = Now();
+                return;
+            }
+            EnqueueAlloc();
+        }
+        void EnqueueAlloc()
+        {
             // Use 5x chunk op timeout for "allocation" that can require
             // chunk version change.
             const int theMetaOpTimeout = mOuter.mMetaServer.GetOpTimeoutSec();
             EnqueueMeta(mAllocOp, 0, max(0, max(mOuter.mOpTimeoutSec,
                     5 * theMetaOpTimeout) - theMetaOpTimeout));
         }
+        void CancelAlloc()
+        {
+            if (mAllocBatchPtr) {
+                mAllocBatchPtr->Cancel(mAllocBatchIdx);
+                mAllocBatchPtr = 0;
+                mOuter.mStats.mMetaOpsCancelledCount++;
+                if (mLastOpPtr == &mAllocOp) {
+                    mLastOpPtr = 0;
+                }
+            } else {
+                mOuter.mMetaServer.Cancel(&mAllocOp, this);
+            }
+        }
         void Done(
             AllocateOp& inOp,
             bool        inCanceledFlag,
@@ -889,6 +967,9 @@ private:
             if (inCanceledFlag) {
                 return;
             }
+            if (mAllocOp.allocBatchFlag) {
+                mOuter.mAllocBatchFlag = true;
+            }
             if (inOp.status != 0 || (mAllocOp.chunkServers.empty() &&
                     ! mAllocOp.invalidateAllFlag)) {
                 mAllocOp.chunkId = 0;
@@ -1467,7 +1548,7 @@ private:
         void Reset()
         {
             if (mLastOpPtr == &mAllocOp) {
-                mOuter.mMetaServer.Cancel(mLastOpPtr, this);
+                CancelAlloc();
             }
             Reset(mAllocOp);
             mWriteIds.clear();
@@ -1721,6 +1802,60 @@ private:
         ChunkWriter& operator=(
             const ChunkWriter& inChunkWriter);
     };
+    // Chunk allocations queued by the writers during a single write queue
+    // pass, sent to the meta server with one request.
+    class AllocBatch : public AllocateBatchOp
+    {
+    public:
+        typedef vector<ChunkWriter*> Writers;
+
+        AllocBatch(
+            kfsFileId_t   inFileId,
+            const string& inPathName)
+            : AllocateBatchOp(0, inFileId, inPathName),
+              mWriters(),
+              mCanceledOps()
+            {}
+        ~AllocBatch()
+        {
+            for (Allocs::const_iterator theIt = mCanceledOps.begin();
+                    mCanceledOps.end() != theIt;
+                    ++theIt) {
+                delete *theIt;
+            }
+        }
+        void Add(
+            ChunkWriter& inWriter)
+        {
+            inWriter.SetAllocBatch(this, mWriters.size());
+            mWriters.push_back(&inWriter);
+            allocs.push_back(&inWriter.GetAllocOp());
+        }
+        // Detach the writer. The request might be already sent, and can be
+        // re-sent on retry, therefore replace the allocation op with a copy
+        // that receives the allocation result.
+        void Cancel(
+            size_t inIdx)
+        {
+            QCASSERT(inIdx < mWriters.size() && mWriters[inIdx]);
+            AllocateOp* const theOpPtr = new AllocateOp(
+                0, allocs[inIdx]->fid, allocs[inIdx]->pathname);
+            theOpPtr->fileOffset = allocs[inIdx]->fileOffset;
+            mCanceledOps.push_back(theOpPtr);
+            allocs[inIdx]   = theOpPtr;
+            mWriters[inIdx] = 0;
+        }
+        Writers mWriters;
+    private:
+        Allocs mCanceledOps;
+    private:
+        AllocBatch(
+            const AllocBatch& inBatch);
+        AllocBatch& operator=(
+            const AllocBatch& inBatch);
+    };
+    typedef vector<AllocBatch*> AllocBatches;
+
     friend class ChunkWriter;
     friend class Striper;
 
@@ -1760,6 +1895,10 @@ private:
     int                 mCompletionDepthCount;
     int                 mStriperProcessCount;
     Striper*            mStriperPtr;
+    bool                mAllocBatchFlag;
+    int                 mAllocBatchDepth;
+    AllocBatch*         mAllocBatchPtr;
+    AllocBatches        mAllocBatches;
     ChunkWriter*        mWriters[1];
 
     void InternalError(
@@ -1884,6 +2023,10 @@ private:
             " status: " << (inOpPtr ? inOpPtr->status : 0) <<
             " " << (inOpPtr ? inOpPtr->statusMsg : string()) <<
         KFS_LOG_EOM;
+        if (inOpPtr && CMD_ALLOCATE_BATCH == inOpPtr->op) {
+            AllocBatchDone(*static_cast<AllocBatch*>(inOpPtr), inCanceledFlag);
+            return;
+        }
         QCASSERT(inOpPtr == &mTruncateOp);
         if (inOpPtr != &mTruncateOp) {
             return;
@@ -1954,6 +2097,9 @@ private:
     void QueueWrite(
         Offset inWriteThreshold)
     {
+        // Chunk allocations issued by the writers started by this pass are
+        // collected, and sent as a batch at the end of the pass.
+        mAllocBatchDepth++;
         if (mStriperPtr) {
             QCStValueIncrementor<int> theIncrement(mStriperProcessCount, 1);
             const int theErrCode =
@@ -1961,19 +2107,110 @@ private:
             if (theErrCode != 0 && mErrorCode == 0) {
                 mErrorCode = theErrCode;
             }
+        } else {
+            const Offset theQueuedCount = QueueWrite(
+                mBuffer,
+                mBuffer.BytesConsumable(),
+                mOffset,
+                inWriteThreshold
+            );
+            if (theQueuedCount > 0) {
+                mOffset += theQueuedCount;
+                StartQueuedWrite(theQueuedCount);
+            }
+        }
+        if (--mAllocBatchDepth <= 0) {
+            StartAllocBatch();
+        }
+    }
+    bool QueueAllocate(
+        ChunkWriter& inWriter)
+    {
+        if (! mAllocBatchFlag || mAllocBatchDepth <= 0 ||
+                mReplicaCount <= 0 ||
+                inWriter.GetAllocOp().invalidateAllFlag) {
+            return false;
+        }
+        if (! mAllocBatchPtr) {
+            mAllocBatchPtr = new AllocBatch(mFileId, mPathName);
+        }
+        mAllocBatchPtr->Add(inWriter);
+        return true;
+    }
+    void StartAllocBatch()
+    {
+        AllocBatch* const theBatchPtr = mAllocBatchPtr;
+        if (! theBatchPtr) {
             return;
         }
-        const Offset theQueuedCount = QueueWrite(
-            mBuffer,
-            mBuffer.BytesConsumable(),
-            mOffset,
-            inWriteThreshold
-        );
-        if (theQueuedCount > 0) {
-            mOffset += theQueuedCount;
-            StartQueuedWrite(theQueuedCount);
+        mAllocBatchPtr = 0;
+        AllocBatch::Writers& theWriters = theBatchPtr->mWriters;
+        size_t               theCnt     = 0;
+        for (size_t i = 0; i < theWriters.size(); i++) {
+            if (theWriters[i]) {
+                theWriters[i]->SetAllocBatch(theBatchPtr, theCnt);
+                theBatchPtr->allocs[theCnt] = theBatchPtr->allocs[i];
+                theWriters[theCnt++]        = theWriters[i];
+            }
+        }
+        theWriters.resize(theCnt);
+        theBatchPtr->allocs.resize(theCnt);
+        if (theCnt <= 1) {
+            // Nothing to gain from batching a single allocation.
+            if (0 < theCnt) {
+                theWriters.front()->StartAlloc();
+            }
+            delete theBatchPtr;
+            return;
+        }
+        mStats.mChunkAllocBatchCount++;
+        mStats.mMetaOpsQueuedCount++;
+        mAllocBatches.push_back(theBatchPtr);
+        KFS_LOG_STREAM_DEBUG << mLogPrefix <<
+            "meta +> " << theBatchPtr->Show() <<
+        KFS_LOG_EOM;
+        const int theMetaOpTimeout = mMetaServer.GetOpTimeoutSec();
+        if (! mMetaServer.Enqueue(theBatchPtr, this, 0,
+                max(0, max(mOpTimeoutSec, 5 * theMetaOpTimeout) -
+                    theMetaOpTimeout))) {
+            InternalError("meta allocate batch enqueue failure");
+            theBatchPtr->status = kErrorFault;
+            OpDone(theBatchPtr, false, 0);
         }
     }
+    void AllocBatchDone(
+        AllocBatch& inBatch,
+        bool        inCanceledFlag)
+    {
+        StRef theRef(*this);
+        AllocBatches::iterator const theIt = find(
+            mAllocBatches.begin(), mAllocBatches.end(), &inBatch);
+        QCRTASSERT(mAllocBatches.end() != theIt);
+        mAllocBatches.erase(theIt);
+        if (! inCanceledFlag && 0 == inBatch.status) {
+            const int theStatus = inBatch.ParseAllocations();
+            if (0 != theStatus) {
+                KFS_LOG_STREAM_ERROR << mLogPrefix <<
+                    "invalid allocate batch response: " << inBatch.Show() <<
+                    " chunks: " << inBatch.numChunks <<
+                    " length: " << inBatch.contentLength <<
+                    " turning off batch allocation" <<
+                KFS_LOG_EOM;
+                inBatch.status    = theStatus;
+                inBatch.statusMsg = "invalid allocate batch response";
+                mAllocBatchFlag   = false;
+            }
+        }
+        AllocBatch::Writers& theWriters = inBatch.mWriters;
+        for (size_t i = 0; i < theWriters.size(); i++) {
+            ChunkWriter* const theWriterPtr = theWriters[i];
+            if (theWriterPtr) {
+                theWriters[i] = 0;
+                theWriterPtr->AllocBatchDone(inBatch, inCanceledFlag);
+            }
+        }
+        delete &inBatch;
+    }
     Offset QueueWrite(
         IOBuffer& inBuffer,
         Offset    inSize,
@@ -2195,6 +2432,18 @@ Writer::Striper::StartQueuedWrite(
     mOuter.StartQueuedWrite(inQueuedCount);
 }
 
+void
+Writer::Striper::EncodeDone(
+    Writer::Offset inByteCount,
+    int64_t        inCpuMicroSec,
+    int64_t        inOffloadedCount)
+{
+    mOuter.mStats.mEncodeCount++;
+    mOuter.mStats.mEncodeByteCount      += inByteCount;
+    mOuter.mStats.mEncodeCpuMicroSec    += inCpuMicroSec;
+    mOuter.mStats.mEncodeOffloadedCount += inOffloadedCount;
+}
+
 Writer::Writer(
     Writer::MetaServer& inMetaServer,
     Writer::Completion* inCompletionPtr,
@@ -79,13 +79,18 @@ public:
               mChunkOpsQueuedCount(0),
               mSleepTimeSec(0),
               mChunkAllocCount(0),
+              mChunkAllocBatchCount(0),
               mOpsWriteCount(0),
               mOpsWriteByteCount(0),
               mAllocRetriesCount(0),
               mRetriesCount(0),
               mWriteCount(0),
               mWriteByteCount(0),
-              mBufferCompactionCount(0)
+              mBufferCompactionCount(0),
+              mEncodeCount(0),
+              mEncodeByteCount(0),
+              mEncodeCpuMicroSec(0),
+              mEncodeOffloadedCount(0)
             {}
         void Clear()
             { *this = Stats(); }
@@ -97,6 +102,7 @@ public:
             mChunkOpsQueuedCount   += inStats.mChunkOpsQueuedCount;
             mSleepTimeSec          += inStats.mSleepTimeSec;
             mChunkAllocCount       += inStats.mChunkAllocCount;
+            mChunkAllocBatchCount  += inStats.mChunkAllocBatchCount;
             mOpsWriteCount         += inStats.mOpsWriteCount;
             mOpsWriteByteCount     += inStats.mOpsWriteByteCount;
             mAllocRetriesCount     += inStats.mAllocRetriesCount;
@@ -104,6 +110,10 @@ public:
             mWriteCount            += inStats.mWriteCount;
             mWriteByteCount        += inStats.mWriteByteCount;
             mBufferCompactionCount += inStats.mBufferCompactionCount;
+            mEncodeCount           += inStats.mEncodeCount;
+            mEncodeByteCount       += inStats.mEncodeByteCount;
+            mEncodeCpuMicroSec     += inStats.mEncodeCpuMicroSec;
+            mEncodeOffloadedCount  += inStats.mEncodeOffloadedCount;
             return *this;
         }
         template<typename T>
@@ -115,6 +125,7 @@ public:
             inFunctor("ChunkOpsQueued",    mChunkOpsQueuedCount);
             inFunctor("SleepTimeSec",      mSleepTimeSec);
             inFunctor("ChunkAlloc",        mChunkAllocCount);
+            inFunctor("ChunkAllocBatch",   mChunkAllocBatchCount);
             inFunctor("OpsWrite",          mOpsWriteCount);
             inFunctor("OpsWriteByteCount", mOpsWriteByteCount);
             inFunctor("AllocRetries",      mAllocRetriesCount);
@@ -122,12 +133,17 @@ public:
             inFunctor("Retries",           mRetriesCount);
             inFunctor("Writes" ,           mWriteCount);
             inFunctor("WriteBytes",        mWriteByteCount);
+            inFunctor("Encode",            mEncodeCount);
+            inFunctor("EncodeBytes",       mEncodeByteCount);
+            inFunctor("EncodeCpuMicroSec", mEncodeCpuMicroSec);
+            inFunctor("EncodeOffloaded",   mEncodeOffloadedCount);
         }
         Counter mMetaOpsQueuedCount;
         Counter mMetaOpsCancelledCount;
         Counter mChunkOpsQueuedCount;
         Counter mSleepTimeSec;
         Counter mChunkAllocCount;
+        Counter mChunkAllocBatchCount;
         Counter mOpsWriteCount;
         Counter mOpsWriteByteCount;
         Counter mAllocRetriesCount;
@@ -135,6 +151,10 @@ public:
         Counter mWriteCount;
         Counter mWriteByteCount;
         Counter mBufferCompactionCount;
+        Counter mEncodeCount;
+        Counter mEncodeByteCount;
+        Counter mEncodeCpuMicroSec;
+        Counter mEncodeOffloadedCount;
     };
     class Striper
     {
@@ -179,6 +199,10 @@ public:
             Offset inQueuedCount);
         bool IsWriteQueued() const
             { return mWriteQueuedFlag; }
+        void EncodeDone(
+            Offset  inByteCount,
+            int64_t inCpuMicroSec,
+            int64_t inOffloadedCount);
     private:
         Impl& mOuter;
         bool  mWriteQueuedFlag;
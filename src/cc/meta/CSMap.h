@@ -1249,7 +1249,8 @@ private:
             KeyVal,
             size_t(8)   << 20, // size_t TMinStorageAlloc,
             size_t(128) << 20, // size_t TMaxStorageAlloc,
-            false              // bool   TForceCleanupFlag
+            false,             // bool   TForceCleanupFlag
+            MemoryAccounting::kSubsystemCSMap
         >,
         CSMap
     > Map;
@@ -40,12 +40,14 @@
 #include "LogWriter.h"
 #include "MetaVrSM.h"
 #include "MetaVrLogSeq.h"
+#include "CheckpointCompressor.h"
 #include "util.h"
 
 #include "common/MdStream.h"
 #include "common/FdWriter.h"
 #include "common/StBuffer.h"
 #include "common/IntToString.h"
+#include "common/MsgLogger.h"
 
 #include <iostream>
 #include <iomanip>
@@ -124,8 +126,12 @@ Checkpoint::write(
     }
     if (status == 0) {
         FdWriter fdw(fd);
+        fdw.SetMaxWriteRate(maxwriterate);
+        // The checksum is computed over uncompressed checkpoint content.
+        CheckpointCompressor cpw(fdw, compressionlevel);
         const bool kSyncFlag = false;
-        MdStreamT<FdWriter> os(&fdw, kSyncFlag, string(), writebuffersize);
+        MdStreamT<CheckpointCompressor> os(
+            &cpw, kSyncFlag, string(), writebuffersize);
         os << dec;
         os << "checkpoint/" << logseq.mLogSeq << "/" << errchksum <<
             "/" << logseq.mEpochSeq << "/" << logseq.mViewSeq << '\n';
@@ -175,7 +181,12 @@ Checkpoint::write(
             const string md = os.GetMd();
             os << "checksum/" << md << '\n';
             os.SetStream(0);
-            if ((status = fdw.GetError()) != 0) {
+            if (! cpw.Close() && 0 == fdw.GetError()) {
+                status = cpw.GetError();
+            } else {
+                status = fdw.GetError();
+            }
+            if (status != 0) {
                 if (status > 0) {
                     status = -status;
                 }
@@ -183,6 +194,16 @@ Checkpoint::write(
                 status = -EIO;
             }
         }
+        if (status == 0 && cpw.IsCompressed()) {
+            KFS_LOG_STREAM_INFO <<
+                "checkpoint: "    << cpname <<
+                " uncompressed: " << cpw.GetInByteCount() <<
+                " compressed: "   << cpw.GetOutByteCount() <<
+                " ratio: "        << (cpw.GetOutByteCount() <= 0 ? 0. :
+                    (double)cpw.GetInByteCount() / cpw.GetOutByteCount()) <<
+                " cpu usec: "     << cpw.GetCpuUsec() <<
+            KFS_LOG_EOM;
+        }
         if (status == 0) {
             if (close(fd)) {
                 status = errno > 0 ? -errno : -EIO;
@@ -57,8 +57,12 @@ class Checkpoint
 public:
     static const int  VERSION           = 1;
     static const bool kHexIntFormatFlag = true;
+    // Incremental mode log compactor exit status with no log records since
+    // the last checkpoint, i.e. the last checkpoint is up to date.
+    static const int  kNoLogRecordsExitStatus = 2;
     void setCPDir(const string& d)
         { cpdir = d; }
+    const string& getCPDir() const { return cpdir; }
     const string name() const { return cpname; }
     int write(
         const string&       logname,
@@ -68,12 +72,18 @@ public:
     void setWriteSyncFlag(bool flag) { writesync = flag; }
     size_t getWriteBufferSize() const { return writebuffersize; }
     void setWriteBufferSize(size_t size) { writebuffersize = size; }
+    int64_t getMaxWriteRate() const { return maxwriterate; }
+    void setMaxWriteRate(int64_t rate) { maxwriterate = rate; }
+    int getCompressionLevel() const { return compressionlevel; }
+    void setCompressionLevel(int level) { compressionlevel = level; }
     string cpfile(
         const MetaVrLogSeq& committedseq);
 private:
     string  cpdir;       //!< dir for CP files
     bool    writesync;
     size_t  writebuffersize;
+    int64_t maxwriterate; //!< bytes per second, 0 -- no limit
+    int     compressionlevel; //!< gzip level, negative -- no compression
     string  cpname;
 
     friend class MetaServerGlobals;
@@ -81,6 +91,8 @@ private:
         : cpdir(dir),
           writesync(true),
           writebuffersize(16 << 20),
+          maxwriterate(0),
+          compressionlevel(-1),
           cpname()
         {}
     ~Checkpoint()
@@ -0,0 +1,321 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/18
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// Checkpoint compression implementation.
+//
+//----------------------------------------------------------------------------
+
+#include "CheckpointCompressor.h"
+
+#include "common/FdWriter.h"
+#include "common/time.h"
+
+#include <zlib.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+namespace KFS
+{
+
+// Gzip wrapper, see deflateInit2() windowBits.
+const int kGzipWindowBits = 15 + 16;
+const int kMemLevel       = 8;
+const int kOutBufferSize  = 256 << 10;
+
+class CheckpointCompressor::Stream
+{
+public:
+    Stream()
+        : mStream()
+        {}
+    z_stream mStream;
+    char     mBuffer[kOutBufferSize];
+};
+
+CheckpointCompressor::Counters CheckpointCompressor::sCounters;
+
+CheckpointCompressor::CheckpointCompressor(
+    FdWriter& inWriter,
+    int       inCompressionLevel)
+    : mWriter(inWriter),
+      mStreamPtr(0),
+      mError(0),
+      mInByteCount(0),
+      mOutByteCount(0),
+      mCpuUsec(0)
+{
+    if (inCompressionLevel < 0) {
+        return;
+    }
+    mStreamPtr = new Stream();
+    if (Z_OK != deflateInit2(&mStreamPtr->mStream,
+            inCompressionLevel < Z_BEST_COMPRESSION ?
+                inCompressionLevel : Z_BEST_COMPRESSION,
+            Z_DEFLATED, kGzipWindowBits, kMemLevel, Z_DEFAULT_STRATEGY)) {
+        mError = ENOMEM;
+        delete mStreamPtr;
+        mStreamPtr = 0;
+    }
+}
+
+CheckpointCompressor::~CheckpointCompressor()
+{
+    if (mStreamPtr) {
+        deflateEnd(&mStreamPtr->mStream);
+        delete mStreamPtr;
+    }
+}
+
+    bool
+CheckpointCompressor::write(
+    const void* inBufPtr,
+    size_t      inLength)
+{
+    if (0 != mError) {
+        return false;
+    }
+    mInByteCount += inLength;
+    if (! mStreamPtr) {
+        mOutByteCount += inLength;
+        return mWriter.write(inBufPtr, inLength);
+    }
+    return Deflate(inBufPtr, inLength, Z_NO_FLUSH);
+}
+
+    bool
+CheckpointCompressor::Close()
+{
+    if (! mStreamPtr || 0 != mError) {
+        return (0 == mError);
+    }
+    const bool theRet = Deflate(0, 0, Z_FINISH);
+    sCounters.mCompressInByteCount  += mInByteCount;
+    sCounters.mCompressOutByteCount += mOutByteCount;
+    sCounters.mCompressCpuUsec      += mCpuUsec;
+    return theRet;
+}
+
+    bool
+CheckpointCompressor::Deflate(
+    const void* inBufPtr,
+    size_t      inLength,
+    int         inFlush)
+{
+    const int64_t theStart  = threadcputime();
+    z_stream&     theStream = mStreamPtr->mStream;
+    theStream.next_in  = (Bytef*)inBufPtr;
+    theStream.avail_in = (uInt)inLength;
+    bool theRet = true;
+    for (; ;) {
+        theStream.next_out  = (Bytef*)mStreamPtr->mBuffer;
+        theStream.avail_out = (uInt)sizeof(mStreamPtr->mBuffer);
+        const int    theStatus = deflate(&theStream, inFlush);
+        const size_t theLen    =
+            sizeof(mStreamPtr->mBuffer) - theStream.avail_out;
+        if (Z_OK != theStatus && Z_STREAM_END != theStatus &&
+                Z_BUF_ERROR != theStatus) {
+            mError = EIO;
+            theRet = false;
+            break;
+        }
+        if (0 < theLen) {
+            mOutByteCount += theLen;
+            if (! mWriter.write(mStreamPtr->mBuffer, theLen)) {
+                mError = mWriter.GetError();
+                if (0 == mError) {
+                    mError = EIO;
+                }
+                theRet = false;
+                break;
+            }
+        }
+        if (Z_FINISH == inFlush ?
+                Z_STREAM_END == theStatus :
+                (0 == theStream.avail_in && 0 < theStream.avail_out)) {
+            break;
+        }
+    }
+    mCpuUsec += threadcputime() - theStart;
+    return theRet;
+}
+
+    /* static */ int
+CheckpointCompressor::WriteCompressCounters(
+    int inFd)
+{
+    char      theBuf[128];
+    const int theLen = snprintf(theBuf, sizeof(theBuf), "%lld %lld %lld\n",
+        (long long)sCounters.mCompressInByteCount,
+        (long long)sCounters.mCompressOutByteCount,
+        (long long)sCounters.mCompressCpuUsec
+    );
+    if (theLen <= 0 || (int)sizeof(theBuf) <= theLen) {
+        return -EINVAL;
+    }
+    // The counters line is less than PIPE_BUF, and is written atomically.
+    const ssize_t theNWr = ::write(inFd, theBuf, (size_t)theLen);
+    if (theNWr < 0) {
+        return (0 < errno ? -errno : -EIO);
+    }
+    return (theNWr == theLen ? 0 : -EIO);
+}
+
+    /* static */ int
+CheckpointCompressor::ReadCompressCounters(
+    int       inFd,
+    Counters& outCounters)
+{
+    outCounters = Counters();
+    char          theBuf[128];
+    const ssize_t theNRd = ::read(inFd, theBuf, sizeof(theBuf) - 1);
+    if (theNRd < 0) {
+        return (0 < errno ? -errno : -EIO);
+    }
+    theBuf[theNRd] = 0;
+    long long theIn  = 0;
+    long long theOut = 0;
+    long long theCpu = 0;
+    if (sscanf(theBuf, "%lld %lld %lld", &theIn, &theOut, &theCpu) != 3 ||
+            theIn < 0 || theOut < 0 || theCpu < 0) {
+        return -EINVAL;
+    }
+    outCounters.mCompressInByteCount  = (int64_t)theIn;
+    outCounters.mCompressOutByteCount = (int64_t)theOut;
+    outCounters.mCompressCpuUsec      = (int64_t)theCpu;
+    sCounters.mCompressInByteCount  += outCounters.mCompressInByteCount;
+    sCounters.mCompressOutByteCount += outCounters.mCompressOutByteCount;
+    sCounters.mCompressCpuUsec      += outCounters.mCompressCpuUsec;
+    return 0;
+}
+
+    /* static */ int
+CheckpointCompressor::ReadHeader(
+    const char* inFileNamePtr,
+    char*       inBufPtr,
+    size_t      inBufSize)
+{
+    gzFile const theFilePtr = gzopen(inFileNamePtr, "rb");
+    if (! theFilePtr) {
+        return (0 < errno ? -errno : -ENOMEM);
+    }
+    int theRet = gzread(theFilePtr, inBufPtr, (unsigned int)inBufSize);
+    if (theRet < 0) {
+        int theErr = 0;
+        gzerror(theFilePtr, &theErr);
+        theRet = (Z_ERRNO == theErr && 0 < errno) ? -errno : -EIO;
+    }
+    gzclose(theFilePtr);
+    return theRet;
+}
+
+CheckpointInputStream::CheckpointInputStream(
+    size_t inBufSize)
+    : streambuf(),
+      istream(this),
+      mFilePtr(0),
+      mBufPtr(new char[inBufSize]),
+      mBufSize(inBufSize),
+      mCompressedFlag(false),
+      mOutByteCount(0),
+      mCpuUsec(0)
+{
+    setg(mBufPtr, mBufPtr, mBufPtr);
+}
+
+CheckpointInputStream::~CheckpointInputStream()
+{
+    CheckpointInputStream::close();
+    delete [] mBufPtr;
+}
+
+    int
+CheckpointInputStream::open(
+    const char* inFileNamePtr)
+{
+    close();
+    clear();
+    gzFile const theFilePtr = gzopen(inFileNamePtr, "rb");
+    if (! theFilePtr) {
+        const int theErr = 0 < errno ? errno : ENOMEM;
+        setstate(failbit);
+        return -theErr;
+    }
+    gzbuffer(theFilePtr, (unsigned int)kOutBufferSize);
+    mFilePtr        = theFilePtr;
+    mCompressedFlag = false;
+    mOutByteCount   = 0;
+    mCpuUsec        = 0;
+    setg(mBufPtr, mBufPtr, mBufPtr);
+    return 0;
+}
+
+    void
+CheckpointInputStream::close()
+{
+    if (! mFilePtr) {
+        return;
+    }
+    gzFile const theFilePtr = (gzFile)mFilePtr;
+    mFilePtr = 0;
+    if (mCompressedFlag) {
+        CheckpointCompressor::Counters& theCtrs =
+            CheckpointCompressor::sCounters;
+        theCtrs.mDecompressInByteCount  += gzoffset(theFilePtr);
+        theCtrs.mDecompressOutByteCount += mOutByteCount;
+        theCtrs.mDecompressCpuUsec      += mCpuUsec;
+    }
+    gzclose(theFilePtr);
+    setg(mBufPtr, mBufPtr, mBufPtr);
+}
+
+    /* virtual */ int
+CheckpointInputStream::underflow()
+{
+    if (gptr() < egptr()) {
+        return streambuf::traits_type::to_int_type(*gptr());
+    }
+    if (! mFilePtr) {
+        return streambuf::traits_type::eof();
+    }
+    gzFile const  theFilePtr = (gzFile)mFilePtr;
+    const int64_t theStart   = threadcputime();
+    const int     theNRd     =
+        gzread(theFilePtr, mBufPtr, (unsigned int)mBufSize);
+    if (theNRd <= 0) {
+        if (theNRd < 0) {
+            setstate(badbit);
+        }
+        return streambuf::traits_type::eof();
+    }
+    if (0 == mOutByteCount) {
+        mCompressedFlag = 0 == gzdirect(theFilePtr);
+    }
+    if (mCompressedFlag) {
+        mCpuUsec += threadcputime() - theStart;
+    }
+    mOutByteCount += theNRd;
+    setg(mBufPtr, mBufPtr, mBufPtr + theNRd);
+    return streambuf::traits_type::to_int_type(*gptr());
+}
+
+} // namespace KFS
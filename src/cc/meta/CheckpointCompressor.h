@@ -0,0 +1,167 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/18
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// Checkpoint compression. Compressed checkpoint is a gzip stream of the
+// uncompressed checkpoint, therefore the checkpoint checksum is computed over
+// the uncompressed content. Checkpoint reader transparently handles both
+// compressed and uncompressed checkpoints, and the file name is the same in
+// both cases. The meta data sync fetches checkpoint as is, and does not need
+// to be aware of the compression.
+//
+//----------------------------------------------------------------------------
+
+#ifndef KFS_META_CHECKPOINT_COMPRESSOR_H
+#define KFS_META_CHECKPOINT_COMPRESSOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <istream>
+#include <streambuf>
+
+namespace KFS
+{
+using std::istream;
+using std::streambuf;
+
+class FdWriter;
+
+class CheckpointCompressor
+{
+public:
+    enum { kCompressionLevelNone = -1 };
+    class Counters
+    {
+    public:
+        Counters()
+            : mCompressInByteCount(0),
+              mCompressOutByteCount(0),
+              mCompressCpuUsec(0),
+              mDecompressInByteCount(0),
+              mDecompressOutByteCount(0),
+              mDecompressCpuUsec(0)
+            {}
+        int64_t mCompressInByteCount;
+        int64_t mCompressOutByteCount;
+        int64_t mCompressCpuUsec;
+        int64_t mDecompressInByteCount;
+        int64_t mDecompressOutByteCount;
+        int64_t mDecompressCpuUsec;
+    };
+    // Compression level less than 0 turns off compression, all writes are
+    // passed to the writer.
+    CheckpointCompressor(
+        FdWriter& inWriter,
+        int       inCompressionLevel);
+    ~CheckpointCompressor();
+    bool write(
+        const void* inBufPtr,
+        size_t      inLength);
+    void flush()
+        {}
+    // Flush compressor state, and write gzip trailer.
+    bool Close();
+    int GetError() const
+        { return mError; }
+    bool IsCompressed() const
+        { return (0 != mStreamPtr); }
+    int64_t GetInByteCount() const
+        { return mInByteCount; }
+    int64_t GetOutByteCount() const
+        { return mOutByteCount; }
+    int64_t GetCpuUsec() const
+        { return mCpuUsec; }
+    static void GetCounters(
+        Counters& outCounters)
+        { outCounters = sCounters; }
+    // The checkpoint is written by the forked child or by the log compactor
+    // process. The checkpoint writer process clears the counters before
+    // writing the checkpoint, and then writes the compression counters into
+    // the pipe. The meta server reads the counters once the writer process
+    // exits, and adds these to its counters.
+    static void ClearCounters()
+        { sCounters = Counters(); }
+    static int WriteCompressCounters(
+        int inFd);
+    static int ReadCompressCounters(
+        int       inFd,
+        Counters& outCounters);
+    static int ReadHeader(
+        const char* inFileNamePtr,
+        char*       inBufPtr,
+        size_t      inBufSize);
+private:
+    class Stream;
+
+    FdWriter& mWriter;
+    Stream*   mStreamPtr;
+    int       mError;
+    int64_t   mInByteCount;
+    int64_t   mOutByteCount;
+    int64_t   mCpuUsec;
+
+    static Counters sCounters;
+
+    bool Deflate(
+        const void* inBufPtr,
+        size_t      inLength,
+        int         inFlush);
+    friend class CheckpointInputStream;
+private:
+    CheckpointCompressor(
+        const CheckpointCompressor& inCompressor);
+    CheckpointCompressor& operator=(
+        const CheckpointCompressor& inCompressor);
+};
+
+// Checkpoint input stream. Reads both compressed and uncompressed checkpoints.
+class CheckpointInputStream : private streambuf, public istream
+{
+public:
+    CheckpointInputStream(
+        size_t inBufSize = size_t(1) << 20);
+    virtual ~CheckpointInputStream();
+    int open(
+        const char* inFileNamePtr);
+    void close();
+    bool is_open() const
+        { return (0 != mFilePtr); }
+    bool IsCompressed() const
+        { return mCompressedFlag; }
+protected:
+    virtual int underflow();
+private:
+    void*       mFilePtr;
+    char* const mBufPtr;
+    size_t      mBufSize;
+    bool        mCompressedFlag;
+    int64_t     mOutByteCount;
+    int64_t     mCpuUsec;
+private:
+    CheckpointInputStream(
+        const CheckpointInputStream& inStream);
+    CheckpointInputStream& operator=(
+        const CheckpointInputStream& inStream);
+};
+
+} // namespace KFS
+
+#endif /* KFS_META_CHECKPOINT_COMPRESSOR_H */
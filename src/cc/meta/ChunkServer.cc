@@ -2895,6 +2895,7 @@ ChunkServer::ReplicateChunk(fid_t fid, chunkId_t chunkId,
         req.numStripes         = recoveryInfo.numStripes;
         req.numRecoveryStripes = recoveryInfo.numRecoveryStripes;
         req.stripeSize         = recoveryInfo.stripeSize;
+        req.availableStripes   = recoveryInfo.availableStripes;
         req.fileSize           = recoveryInfo.fileSize;
         req.dataServer.reset();
         req.srcLocation.hostname.clear();
@@ -84,6 +84,12 @@ public:
         return (thread != 0); // Thread invokes flush.
     }
     static bool IsPrimary(ClientThread* thread);
+    static void ResponseSent(ClientThread* thread, const MetaRequest& op)
+    {
+        if (0 < op.dispatchTime) {
+            ResponseSentSelf(thread, op);
+        }
+    }
     void PrepareCurrentThreadToFork();
     inline void PrepareToFork();
     inline void ForkDone();
@@ -93,6 +99,7 @@ private:
 
     static bool EnqueueSelf(ClientThread* thread, MetaRequest& op);
     static void SubmitRequestSelf(ClientThread* thread, MetaRequest& op);
+    static void ResponseSentSelf(ClientThread* thread, const MetaRequest& op);
 private:
     ClientManager(const ClientManager&);
     ClientManager& operator=(const ClientManager&);
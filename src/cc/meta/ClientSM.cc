@@ -41,6 +41,7 @@
 #include "kfsio/DelegationToken.h"
 #include "common/MsgLogger.h"
 #include "common/Properties.h"
+#include "common/time.h"
 #include "AuditLog.h"
 #include "AuthContext.h"
 
@@ -205,6 +206,7 @@ ClientSM::SendResponse(MetaRequest *op)
     ReqOstream ros(mOstream.Set(mNetConnection->GetOutBuffer()));
     op->response(ros, mNetConnection->GetOutBuffer());
     mOstream.Reset();
+    ClientManager::ResponseSent(mClientThread, *op);
     if (mRecursionCnt <= 0) {
         mNetConnection->StartFlush();
     }
@@ -571,6 +573,7 @@ ClientSM::HandleClientCmd(IOBuffer& iobuf, int cmdLen)
         " rd: "   << mNetConnection->GetNumBytesToRead() <<
         " wr: "   << mNetConnection->GetNumBytesToWrite() <<
     KFS_LOG_EOM;
+    op->recvTime            = microseconds();
     op->clientIp            = mClientLocation.hostname;
     op->fromClientSMFlag    = true;
     op->clnt                = this;
@@ -765,16 +768,29 @@ ClientSM::Handle(MetaDelegateCancel& op)
     return false; // Not done continue processing.
 }
 
-bool
-ClientSM::Handle(MetaAllocate& op)
+template<typename T> void
+ClientSM::SetDelegation(T& op) const
 {
     if (! mDelegationValidFlag) {
-        return false;
+        return;
     }
     op.delegationSeq          = mDelegationSeq;
     op.delegationValidForTime = mDelegationValidForTime;
     op.delegationFlags        = mDelegationFlags;
-    op.delegationFlags        = mDelegationIssuedTime;
+    op.delegationIssuedTime   = mDelegationIssuedTime;
+}
+
+bool
+ClientSM::Handle(MetaAllocate& op)
+{
+    SetDelegation(op);
+    return false;
+}
+
+bool
+ClientSM::Handle(MetaAllocateBatch& op)
+{
+    SetDelegation(op);
     return false;
 }
 
@@ -103,6 +103,7 @@ public:
     bool Handle(MetaLookup& op);
     bool Handle(MetaDelegateCancel& op);
     bool Handle(MetaAllocate& op);
+    bool Handle(MetaAllocateBatch& op);
     int& GetLogQueueCounter()
         { return mLogQueueCounter; }
 private:
@@ -158,6 +159,7 @@ private:
         { return (mPendingOpsCount >= sMaxPendingOps); }
     void HandleAuthenticate(IOBuffer& iobuf);
     void HandleDelegation(MetaDelegate& op);
+    template<typename T> void SetDelegation(T& op) const;
     void CloseConnection(const char* msg = 0);
 
     static int  sMaxPendingOps;
@@ -32,6 +32,7 @@
 #include "ClientSM.h"
 #include "NetDispatch.h"
 #include "LogWriter.h"
+#include "CheckpointCompressor.h"
 
 #include "qcdio/QCIoBufferPool.h"
 #include "qcdio/QCUtils.h"
@@ -42,11 +43,14 @@
 #include "common/Version.h"
 #include "common/StdAllocator.h"
 #include "common/rusage.h"
+#include "common/AverageFilter.h"
 
 #include "kfsio/Globals.h"
 #include "kfsio/IOBuffer.h"
 #include "kfsio/IOBufferWriter.h"
 
+#include "libclient/ECMethod.h"
+
 #include <algorithm>
 #include <functional>
 #include <sstream>
@@ -164,6 +168,85 @@ IsObjectStoreBlock(fid_t fid, chunkOff_t pos)
         pos <= fa->nextChunkOffset());
 }
 
+// Returns true if only the chunks of the same locally repairable code group
+// need to be placed on different racks, as there are not enough racks to
+// place each chunk of the chunk block on its own rack.
+static inline bool
+IsLrcGroupPlacement(const MetaFattr& fa, size_t rackCount)
+{
+    return (fa.striperType == KFS_STRIPED_FILE_TYPE_LRC &&
+        0 < fa.numRecoveryStripes &&
+        rackCount < (size_t)(fa.numStripes + fa.numRecoveryStripes));
+}
+
+static inline int
+GetLrcStripeGroup(const MetaFattr& fa, chunkOff_t offset)
+{
+    return GetLrcStripeGroup(
+        (int)(offset % fa.ChunkBlkSize() / (chunkOff_t)CHUNKSIZE),
+        fa.numStripes, fa.numRecoveryStripes);
+}
+
+// Returns true if the chunk block can be rebuilt from the available stripes.
+// With maximum distance separable codes, like Reed-Solomon, any data stripe
+// count of available stripes is sufficient. Otherwise the missing stripes that
+// can be repaired from their local groups are considered available, and the
+// erasure coding method decides if the remaining stripes can be rebuilt.
+// The missing stripes list must have room for the -1 terminator.
+static bool
+CanRecoverStripes(const MetaFattr& fa, int goodCnt,
+    int* missing, int missingCnt)
+{
+    if (goodCnt < (int)fa.numStripes) {
+        return false;
+    }
+    if (missingCnt <= 0) {
+        return true;
+    }
+    client::ECMethod::Decoder* const decoder =
+        client::ECMethod::FindDecoder(fa.striperType,
+            fa.numStripes, fa.numRecoveryStripes, 0);
+    if (! decoder) {
+        return true;
+    }
+    bool ret = true;
+    if (! decoder->IsMaximumDistanceSeparable()) {
+        const int           cnt = fa.numStripes + fa.numRecoveryStripes;
+        StBufferT<char, 64> missingFlagsBuf;
+        char* const         missingFlags = missingFlagsBuf.Resize(cnt);
+        StBufferT<int, 64>  stripesBuf;
+        int* const          stripes = stripesBuf.Resize(cnt);
+        memset(missingFlags, 0, cnt);
+        for (int i = 0; i < missingCnt; i++) {
+            missingFlags[missing[i]] = 1;
+        }
+        bool repairedFlag;
+        do {
+            repairedFlag = false;
+            for (int i = 0; i < missingCnt; ) {
+                const int n = decoder->GetLocalRepairStripes(
+                    fa.numStripes, fa.numRecoveryStripes, missing[i], stripes);
+                int k = 0;
+                while (k < n && ! missingFlags[stripes[k]]) {
+                    k++;
+                }
+                if (0 < n && n <= k) {
+                    missingFlags[missing[i]] = 0;
+                    missing[i] = missing[--missingCnt];
+                    repairedFlag = true;
+                } else {
+                    i++;
+                }
+            }
+        } while (repairedFlag && 0 < missingCnt);
+        missing[missingCnt] = -1;
+        ret = decoder->CanDecode(
+            fa.numStripes, fa.numRecoveryStripes, missing);
+    }
+    decoder->Release();
+    return ret;
+}
+
 static inline void
 ResubmitRequest(MetaRequest& req)
 {
@@ -2219,6 +2302,14 @@ LayoutManager::LayoutManager()
       mCleanupFlag(false),
       mObjectStorageTiersBits((uint32_t)1 << kKfsSTierMax),
       mObjectStoreDeleteNoTierCount(0),
+      mChunkAllocCount(0),
+      mChunkAllocBatchCount(0),
+      mChunkAllocBatchChunkCount(0),
+      mPrevChunkAllocCount(0),
+      mChunkAllocAvgNextTime(0),
+      mChunkAlloc5SecAvgRate(0),
+      mChunkAlloc10SecAvgRate(0),
+      mChunkAlloc15SecAvgRate(0),
       mChunkInfosTmp(),
       mChunkInfos2Tmp(),
       mServersTmp(),
@@ -3287,6 +3378,14 @@ LayoutManager::Validate(MetaCreate& createOp) const
             "data stripe count exceeds max allowed for files with recovery";
         return false;
     }
+    if (0 < createOp.numRecoveryStripes && ! client::ECMethod::IsValid(
+            createOp.striperType,
+            createOp.numStripes,
+            createOp.numRecoveryStripes,
+            &createOp.statusMsg)) {
+        createOp.status = -EINVAL;
+        return false;
+    }
     if (0 == createOp.numReplicas) {
         if (! mObjectStoreEnabledFlag) {
             createOp.statusMsg = "object store is not enabled";
@@ -5376,10 +5475,14 @@ LayoutManager::CanBeRecovered(
         return false;
     }
     vector<MetaChunkInfo*>::const_iterator it = cblk.begin();
-    unsigned int     stripeIdx = 0;
-    int              localCnt;
-    int&             goodCnt   = outGoodCnt ? *outGoodCnt : localCnt;
-    chunkOff_t const end       = start + fa->ChunkBlkSize();
+    unsigned int       stripeIdx = 0;
+    int                localCnt;
+    int&               goodCnt   = outGoodCnt ? *outGoodCnt : localCnt;
+    chunkOff_t const   end       = start + fa->ChunkBlkSize();
+    const unsigned int stripeCnt = fa->numStripes + fa->numRecoveryStripes;
+    StBufferT<int, 32> missingBuf;
+    int* const         missing   = missingBuf.Resize(stripeCnt + 1);
+    int                missingCnt = 0;
     goodCnt = 0;
     for (chunkOff_t pos = start;
             pos < end;
@@ -5401,9 +5504,14 @@ LayoutManager::CanBeRecovered(
         }
         if (mChunkToServerMap.HasServers(GetCsEntry(**it))) {
             goodCnt++;
+        } else {
+            missing[missingCnt++] = (int)stripeIdx;
         }
         ++it;
     }
+    while (stripeIdx < stripeCnt) {
+        missing[missingCnt++] = (int)stripeIdx++;
+    }
     if (incompleteChunkBlockFlag && incompleteChunkBlockWriteHasLeaseFlag) {
         for (it = cblk.begin(); it != cblk.end(); ++it) {
             if (mChunkLeases.GetChunkWriteLease((*it)->chunkId)) {
@@ -5412,7 +5520,7 @@ LayoutManager::CanBeRecovered(
             }
         }
     }
-    return ((int)fa->numStripes <= goodCnt);
+    return CanRecoverStripes(*fa, goodCnt, missing, missingCnt);
 }
 
 typedef KeyOnly<const MetaFattr*> KeyOnlyFattrPtr;
@@ -6823,6 +6931,11 @@ LayoutManager::AllocateChunk(
     StTmp<ChunkPlacement> placementTmp(mChunkPlacementTmp);
     ChunkPlacement&       placement = placementTmp.Get();
     if (req.stripedFileFlag) {
+        const MetaFattr* const fa       = metatree.getFattr(req.fid);
+        const bool             lrcFlag  =
+            fa && IsLrcGroupPlacement(*fa, mRacks.size());
+        const int              lrcGroup =
+            lrcFlag ? GetLrcStripeGroup(*fa, req.offset) : -1;
         // For replication greater than one do the same placement, but
         // only take into the account write masters, or the chunk server
         // hosting the first replica.
@@ -6841,9 +6954,15 @@ LayoutManager::AllocateChunk(
                 }
                 if (lease->allocInFlight &&
                         lease->allocInFlight->status == 0) {
-                    placement.ExcludeServerAndRack(
-                        lease->allocInFlight->servers,
-                        it->second);
+                    if (lrcFlag && lrcGroup != GetLrcStripeGroup(
+                            *fa, lease->allocInFlight->offset)) {
+                        placement.ExcludeServer(
+                            lease->allocInFlight->servers);
+                    } else {
+                        placement.ExcludeServerAndRack(
+                            lease->allocInFlight->servers,
+                            it->second);
+                    }
                 } else {
                     placement.ExcludeServerAndRack(
                         lease->chunkServer, it->second);
@@ -6857,7 +6976,11 @@ LayoutManager::AllocateChunk(
                 ++it) {
             Servers& srvs = serversTmp.Get();
             mChunkToServerMap.GetServers(GetCsEntry(**it), srvs);
-            placement.ExcludeServerAndRack(srvs, (*it)->chunkId);
+            if (lrcFlag && lrcGroup != GetLrcStripeGroup(*fa, (*it)->offset)) {
+                placement.ExcludeServer(srvs);
+            } else {
+                placement.ExcludeServerAndRack(srvs, (*it)->chunkId);
+            }
         }
     }
     req.servers.reserve(req.numReplicas);
@@ -7555,9 +7678,55 @@ LayoutManager::GetChunkWriteLease(MetaAllocate& req)
     return;
 }
 
+void
+LayoutManager::UpdateChunkAllocAvg(time_t now)
+{
+    if (now < mChunkAllocAvgNextTime) {
+        return;
+    }
+    if (mChunkAllocAvgNextTime <= 0) {
+        mChunkAllocAvgNextTime = now;
+    }
+    const int64_t rate = ((mChunkAllocCount - mPrevChunkAllocCount) <<
+        LogWriter::Counters::kRateFracBits) / (1 + now - mChunkAllocAvgNextTime);
+    mPrevChunkAllocCount = mChunkAllocCount;
+    while (mChunkAllocAvgNextTime <= now) {
+        mChunkAlloc5SecAvgRate  = AverageFilter::Calculate(
+            mChunkAlloc5SecAvgRate, rate,
+            AverageFilter::kAvg5SecondsDecayExponent);
+        mChunkAlloc10SecAvgRate = AverageFilter::Calculate(
+            mChunkAlloc10SecAvgRate, rate,
+            AverageFilter::kAvg10SecondsDecayExponent);
+        mChunkAlloc15SecAvgRate = AverageFilter::Calculate(
+            mChunkAlloc15SecAvgRate, rate,
+            AverageFilter::kAvg15SecondsDecayExponent);
+        mChunkAllocAvgNextTime++;
+    }
+}
+
+bool
+LayoutManager::IsAllocationAllowed(MetaAllocateBatch& req)
+{
+    if (req.clientProtoVers < mMinChunkAllocClientProtoVersion) {
+        req.status    = -EPERM;
+        req.statusMsg = "client upgrade required";
+        return false;
+    }
+    if (InRecovery()) {
+        req.statusMsg = "meta server in recovery mode";
+        req.status    = -EBUSY;
+        return false;
+    }
+    mChunkAllocBatchCount++;
+    mChunkAllocBatchChunkCount += req.allocs.size();
+    return true;
+}
+
 bool
 LayoutManager::IsAllocationAllowed(MetaAllocate& req)
 {
+    UpdateChunkAllocAvg(TimeNow());
+    mChunkAllocCount++;
     if (req.clientProtoVers < mMinChunkAllocClientProtoVersion) {
         req.status    = -EPERM;
         req.statusMsg = "client upgrade required";
@@ -9181,10 +9350,15 @@ LayoutManager::Handle(MetaPing& inReq, bool wormModeFlag)
     // Initial headers.
     mWOstream.Set(mPingResponse);
     mPingUpdateTime = TimeNow();
+    UpdateChunkAllocAvg(mPingUpdateTime);
     LogWriter::Counters logCtrs;
     MetaRequest::GetLogWriter().GetCounters(logCtrs);
     const MetaFattr* const fa   = metatree.getFattr(ROOTFID);
     const MetaCheckpoint&  cpOp = mCheckpoint.GetOp();
+    CheckpointCompressor::Counters cpCounters;
+    CheckpointCompressor::GetCounters(cpCounters);
+    NetManager::Counters netCtrs;
+    mNetManager.GetCounters(netCtrs);
     mWOstream <<
         "Build-version: "       << KFS_BUILD_VERSION_STRING << "\r\n"
         "Source-version: "      << KFS_SOURCE_REVISION_STRING << "\r\n"
@@ -9208,6 +9382,11 @@ LayoutManager::Handle(MetaPing& inReq, bool wormModeFlag)
         "Chunk srvs= "          << ChunkServer::GetChunkServerCount() << "\t"
         "Requests= "            << MetaRequest::GetRequestCount() << "\t"
         "Sockets= "             << globals().ctrOpenNetFds.GetValue() << "\t"
+        "Net loops= "           << netCtrs.mLoopCount << "\t"
+        "Net poll wait usec= "  << netCtrs.mPollWaitUsec << "\t"
+        "Net dispatch usec= "   << netCtrs.mDispatchUsec << "\t"
+        "Net timer usec= "      << netCtrs.mTimerUsec << "\t"
+        "Net timeout handlers= " << netCtrs.mTimeoutHandlerCount << "\t"
         "Chunks= "              << mChunkToServerMap.Size() << "\t"
         "Pending replication= " << mChunkToServerMap.GetCount(
             CSMap::Entry::kStatePendingReplication) << "\t"
@@ -9335,8 +9514,42 @@ LayoutManager::Handle(MetaPing& inReq, bool wormModeFlag)
             cpOp.GetLastFailedCount() << "\t"
         "Checkpoint Interval= "                  <<
             cpOp.GetIntervalSec() << "\t"
+        "Checkpoint Compression Level= "         <<
+            cpOp.GetCompressionLevel() << "\t"
+        "Checkpoint Last Size= "                 <<
+            cpOp.GetLastCheckpointSize() << "\t"
+        "Checkpoint Last Compression Ratio= "    <<
+            cpOp.GetLastCompressionRatio() << "\t"
+        "Checkpoint Last Compress Cpu Usec= "    <<
+            cpOp.GetLastCompressCpuUsec() << "\t"
+        "Checkpoint Compress In Bytes= "         <<
+            cpCounters.mCompressInByteCount << "\t"
+        "Checkpoint Compress Out Bytes= "        <<
+            cpCounters.mCompressOutByteCount << "\t"
+        "Checkpoint Compress Cpu Usec= "         <<
+            cpCounters.mCompressCpuUsec << "\t"
+        "Checkpoint Decompress In Bytes= "       <<
+            cpCounters.mDecompressInByteCount << "\t"
+        "Checkpoint Decompress Out Bytes= "      <<
+            cpCounters.mDecompressOutByteCount << "\t"
+        "Checkpoint Decompress Cpu Usec= "       <<
+            cpCounters.mDecompressCpuUsec << "\t"
         "Object Store Delete No Tier= "          <<
-            mObjectStoreDeleteNoTierCount
+            mObjectStoreDeleteNoTierCount << "\t"
+        "Chunk Allocations= "                    <<
+            mChunkAllocCount << "\t"
+        "Chunk Allocation Batches= "             <<
+            mChunkAllocBatchCount << "\t"
+        "Chunk Allocation Batch Chunks= "        <<
+            mChunkAllocBatchChunkCount << "\t"
+        "Chunk Allocation 5 Sec Avg Rate= "      <<
+            (mChunkAlloc5SecAvgRate >> AverageFilter::kAvgFracBits) << "\t"
+        "Chunk Allocation 10 Sec Avg Rate= "     <<
+            (mChunkAlloc10SecAvgRate >> AverageFilter::kAvgFracBits) << "\t"
+        "Chunk Allocation 15 Sec Avg Rate= "     <<
+            (mChunkAlloc15SecAvgRate >> AverageFilter::kAvgFracBits) << "\t"
+        "Chunk Allocation Avg Rate Div= "        <<
+            (int64_t(1) << LogWriter::Counters::kRateFracBits)
     ;
     mWOstream.flush();
     mWOstream.Reset();
@@ -11367,6 +11580,9 @@ LayoutManager::GetPlacementExcludes(
         panic("chunk mapping / getalloc mismatch");
         return false;
     }
+    const bool     lrcFlag  = IsLrcGroupPlacement(*fa, mRacks.size());
+    const int      lrcGroup =
+        lrcFlag ? GetLrcStripeGroup(*fa, chunk->offset) : -1;
     StTmp<Servers> serversTmp(mServers3Tmp);
     for (vector<MetaChunkInfo*>::const_iterator it = cblk.begin();
             it != cblk.end();
@@ -11394,7 +11610,11 @@ LayoutManager::GetPlacementExcludes(
                 return false; // Early termination -- ignore the rest
             }
         }
-        placement.ExcludeServerAndRack(servers, ce.GetChunkId());
+        if (lrcFlag && lrcGroup != GetLrcStripeGroup(*fa, (*it)->offset)) {
+            placement.ExcludeServer(servers);
+        } else {
+            placement.ExcludeServerAndRack(servers, ce.GetChunkId());
+        }
     }
     return true;
 }
@@ -11518,6 +11738,13 @@ LayoutManager::CanReplicateChunkNow(
         int              notStable = 0;
         unsigned int     stripeIdx = 0;
         bool             holeFlag  = false;
+        const bool       lrcFlag   = IsLrcGroupPlacement(*fa, mRacks.size());
+        const int        lrcGroup  =
+            lrcFlag ? GetLrcStripeGroup(*fa, chunk->offset) : -1;
+        StBufferT<int, 32> missingBuf;
+        int* const       missing   = missingBuf.Resize(
+            fa->numStripes + fa->numRecoveryStripes + 1);
+        int              missingCnt = 0;
         vector<MetaChunkInfo*>::const_iterator it = cblk.begin();
         StTmp<Servers> serversTmp(mServers4Tmp);
         for (chunkOff_t pos = start;
@@ -11555,17 +11782,23 @@ LayoutManager::CanReplicateChunkNow(
             const CSMap::Entry& ce   = GetCsEntry(**it);
             if (mChunkToServerMap.GetConnectedServers(ce, srvs) > 0) {
                 good++;
+            } else {
+                missing[missingCnt++] = (int)stripeIdx;
             }
             if (chunkId != curChunkId) {
                 const chunkOff_t kObjStoreBlockPos = -1;
                 GetInFlightChunkModificationOpCount(
                     curChunkId, kObjStoreBlockPos, &srvs);
             }
-            placement.ExcludeServerAndRack(srvs, curChunkId);
+            if (lrcFlag && lrcGroup != GetLrcStripeGroup(*fa, (*it)->offset)) {
+                placement.ExcludeServer(srvs);
+            } else {
+                placement.ExcludeServerAndRack(srvs, curChunkId);
+            }
             ++it;
         }
-        if (notStable > 0 ||
-                (notStable == 0 && good < (int)fa->numStripes)) {
+        if (notStable > 0 || (notStable == 0 &&
+                ! CanRecoverStripes(*fa, good, missing, missingCnt))) {
             if (! servers.empty()) {
                 // Can not use recovery instead of replication.
                 SetReplicationState(c, CSMap::Entry::kStateNoDestination);
@@ -11663,6 +11896,7 @@ LayoutManager::CanReplicateChunkNow(
         recoveryInfo->numStripes         = fa->numStripes;
         recoveryInfo->numRecoveryStripes = fa->numRecoveryStripes;
         recoveryInfo->stripeSize         = fa->stripeSize;
+        recoveryInfo->availableStripes   = (int16_t)good;
         recoveryInfo->fileSize           = fa->filesize;
     }
     // if any of the chunkservers are retiring, we need to make copies
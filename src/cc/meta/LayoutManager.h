@@ -423,7 +423,7 @@ private:
         RLEntry,
         KeyCompare<RLEntry::Key>,
         StBufferT<SingleLinkedList<RLEntry>*, 4>,
-        StdFastAllocator<RLEntry>
+        StdFastTaggedAllocator<RLEntry, MemoryAccounting::kSubsystemLeases>
     > ChunkReadLeases;
     struct ChunkReadLeasesHead
     {
@@ -518,14 +518,14 @@ private:
         REntry,
         KeyCompare<REntry::Key, EntryKeyHash>,
         DynamicArray<SingleLinkedList<REntry>*, 13>,
-        StdFastAllocator<REntry>
+        StdFastTaggedAllocator<REntry, MemoryAccounting::kSubsystemLeases>
     > ReadLeases;
     typedef EntryT<EntryKey, WriteLease> WEntry;
     typedef LinearHash <
         WEntry,
         KeyCompare<WEntry::Key, EntryKeyHash>,
         DynamicArray<SingleLinkedList<WEntry>*, 13>,
-        StdFastAllocator<WEntry>
+        StdFastTaggedAllocator<WEntry, MemoryAccounting::kSubsystemLeases>
     > WriteLeases;
     typedef TimerWheel<
         REntry,
@@ -561,7 +561,7 @@ private:
         FEntry,
         KeyCompare<FEntry::Key>,
         DynamicArray<SingleLinkedList<FEntry>*, 13>,
-        StdFastAllocator<FEntry>
+        StdFastTaggedAllocator<FEntry, MemoryAccounting::kSubsystemLeases>
     > FileLeases;
     typedef TimerWheel<
         FEntry,
@@ -956,6 +956,7 @@ ChunkRecoveryInfo()
       numStripes(0),
       numRecoveryStripes(0),
       stripeSize(0),
+      availableStripes(-1),
       fileSize(-1)
     {}
     bool HasRecovery() const
@@ -968,6 +969,7 @@ ChunkRecoveryInfo()
         numStripes         = 0;
         numRecoveryStripes = 0;
         stripeSize         = 0;
+        availableStripes   = -1;
         fileSize           = -1;
     }
 
@@ -977,6 +979,7 @@ ChunkRecoveryInfo()
     int16_t    numStripes;
     int16_t    numRecoveryStripes;
     int32_t    stripeSize;
+    int16_t    availableStripes;
     chunkOff_t fileSize;
 };
 
@@ -1037,6 +1040,7 @@ public:
         const vector<MetaChunkInfo*>& chunkBlock);
 
     bool IsAllocationAllowed(MetaAllocate& req);
+    bool IsAllocationAllowed(MetaAllocateBatch& req);
 
     /// When allocating a chunk for append, we try to re-use an
     /// existing chunk for a which a valid write lease exists.
@@ -2574,6 +2578,14 @@ protected:
     bool                     mCleanupFlag;
     uint32_t                 mObjectStorageTiersBits;
     uint64_t                 mObjectStoreDeleteNoTierCount;
+    int64_t                  mChunkAllocCount;
+    int64_t                  mChunkAllocBatchCount;
+    int64_t                  mChunkAllocBatchChunkCount;
+    int64_t                  mPrevChunkAllocCount;
+    time_t                   mChunkAllocAvgNextTime;
+    int64_t                  mChunkAlloc5SecAvgRate;
+    int64_t                  mChunkAlloc10SecAvgRate;
+    int64_t                  mChunkAlloc15SecAvgRate;
 
     StTmp<vector<MetaChunkInfo*> >::Tmp mChunkInfosTmp;
     StTmp<vector<MetaChunkInfo*> >::Tmp mChunkInfos2Tmp;
@@ -2719,6 +2731,7 @@ protected:
     RackId GetRackId(const string& loc) const;
     RackId GetRackId(const MetaRequest& req) const;
     void ScheduleCleanup(size_t maxScanCount = 1);
+    void UpdateChunkAllocAvg(time_t now);
     void RemoveRetiring(CSMap::Entry& ci, Servers& servers, int numReplicas);
     void DeleteChunk(fid_t fid, chunkId_t chunkId, const Servers& servers,
         bool staleChunkIdFlag = false);
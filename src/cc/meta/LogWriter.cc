@@ -1383,8 +1383,9 @@ private:
                     theStartTime : microseconds();
                 theFirstItemFlag = false;
                 if (META_LOG_WRITER_CONTROL != thePtr->op) {
+                    theReq.logTime = theStartTime - theReq.submitTime;
                     if (0 == thePtr->status) {
-                        mLogTimeUsec += theStartTime - theReq.submitTime;
+                        mLogTimeUsec += theReq.logTime;
                         mLogTimeOpsCount++;
                     } else {
                         mLogErrorOpsCount++;
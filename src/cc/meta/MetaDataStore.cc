@@ -25,6 +25,7 @@
 
 #include "MetaDataStore.h"
 #include "MetaVrLogSeq.h"
+#include "CheckpointCompressor.h"
 #include "util.h"
 
 #include "common/Properties.h"
@@ -1452,25 +1453,21 @@ private:
         size_t      inReadBufSize,
         VrLogSeq&   outLogSeq)
     {
-        const int theFd = open(inNamePtr, O_RDONLY);
-        if (theFd < 0) {
-            const int theErr = errno;
-            KFS_LOG_STREAM_ERROR <<
-                "open: " << inNamePtr <<
-                ": " << QCUtils::SysError(theErr) <<
-            KFS_LOG_EOM;
-            return (0 < theErr ? -theErr : -EINVAL);
+        if (inReadBufSize <= 1) {
+            return -EINVAL;
         }
-        seq_t         theRet   = -EINVAL;
-        const ssize_t theRdLen = read(theFd, inReadBufPtr, inReadBufSize);
+        // Checkpoint might be compressed.
+        seq_t     theRet   = -EINVAL;
+        const int theRdLen = CheckpointCompressor::ReadHeader(
+            inNamePtr, inReadBufPtr, inReadBufSize - 1);
         if (theRdLen < 0) {
-            const int theErr = errno;
             KFS_LOG_STREAM_ERROR <<
                 "read: " << inNamePtr <<
-                ": " << QCUtils::SysError(theErr) <<
+                ": " << QCUtils::SysError(-theRdLen) <<
             KFS_LOG_EOM;
-            theRet = 0 < theErr ? -theErr : -EINVAL;
+            theRet = theRdLen;
         } else {
+            inReadBufPtr[theRdLen] = 0;
             const char* theStPtr  = strstr(inReadBufPtr, "\nlog/");
             if (theStPtr) {
                 theStPtr += 5;
@@ -1511,7 +1508,6 @@ private:
                 KFS_LOG_EOM;
             }
         }
-        close(theFd);
         return theRet;
     }
 private:
@@ -29,6 +29,7 @@
 #include "MetaRequest.h"
 #include "LogReceiver.h"
 #include "MetaDataStore.h"
+#include "CheckpointCompressor.h"
 #include "util.h"
 
 #include "qcdio/qcdebug.h"
@@ -40,6 +41,7 @@
 #include "common/SingleLinkedQueue.h"
 #include "common/IntToString.h"
 #include "common/RequestParser.h"
+#include "common/time.h"
 
 #include "kfsio/NetManager.h"
 #include "kfsio/ClientAuthContext.h"
@@ -234,7 +236,13 @@ public:
           mClusterKey(),
           mSyncCommitName(),
           mStrBuffer(),
-          mMetaMds()
+          mMetaMds(),
+          mStreamClients(),
+          mConnectionsCount(1),
+          mMaxReadRate(0),
+          mReadRateCredit(0),
+          mReadRateTime(0),
+          mReadRateLimitedFlag(false)
     {
         SET_HANDLER(this, &Impl::LogWriteDone);
         mStartupNetManager.SetResolverParameters(
@@ -279,7 +287,14 @@ public:
             mReadOpsCount = max(size_t(1), inParameters.getValue(
                 theName.Truncate(thePrefLen).Append("maxReadOpsCount"),
                 mReadOpsCount));
-        }
+            mConnectionsCount = max(1, min((int)mReadOpsCount,
+                inParameters.getValue(
+                theName.Truncate(thePrefLen).Append("connectionsCount"),
+                mConnectionsCount)));
+        }
+        mMaxReadRate = max(int64_t(0), inParameters.getValue(
+            theName.Truncate(thePrefLen).Append("maxReadRate"),
+            mMaxReadRate));
         const int theReadOpsCount = (int)mReadOpsCount;
         if (kMinReadSize * theReadOpsCount <= inMaxReadSize &&
                 inMaxReadSize < mMaxReadSize * theReadOpsCount) {
@@ -287,6 +302,11 @@ public:
                 theReadOpsCount;
         }
         mKfsNetClient.SetMaxContentLength(3 * mMaxReadSize / 2);
+        for (StreamClients::const_iterator theIt = mStreamClients.begin();
+                mStreamClients.end() != theIt;
+                ++theIt) {
+            (*theIt)->SetMaxContentLength(3 * mMaxReadSize / 2);
+        }
         mFetchOnRestartFileName = inParameters.getValue(
             theName.Truncate(thePrefLen).Append("fetchOnRestartFileName"),
             mFetchOnRestartFileName);
@@ -420,6 +440,22 @@ public:
         for (size_t i = 0; i < mReadOpsCount; i++) {
             mFreeList.PutFront(mReadOpsPtr[i]);
         }
+        while ((int)mStreamClients.size() + 1 < mConnectionsCount) {
+            KfsNetClient* const theClientPtr = new KfsNetClient(
+                mKfsNetClient.GetNetManager(),
+                string(),          // inHost
+                0,                 // inPort
+                mKfsNetClient.GetMaxRetryCount(),
+                mKfsNetClient.GetTimeSecBetweenRetries(),
+                mKfsNetClient.GetOpTimeoutSec(),
+                4 * 60,            // inIdleTimeoutSec
+                RandomSeq()        // inInitialSeqNum
+            );
+            theClientPtr->SetAuthContext(&mAuthContext);
+            theClientPtr->SetMaxContentLength(3 * mMaxReadSize / 2);
+            theClientPtr->SetFailAllOpsOnOpTimeoutFlag(true);
+            mStreamClients.push_back(theClientPtr);
+        }
         mCheckpointDir = inCheckpointDirPtr;
         mLogDir        = inLogDirPtr;
         mSyncCommitName = mCheckpointDir;
@@ -582,7 +618,9 @@ public:
         }
         if (! mLogSeq.IsValid()) {
             KFS_LOG_STREAM_INFO <<
-                "attempting to fetch checkpoint and logs from other node(s)" <<
+                "attempting to fetch checkpoint and logs from other node(s)"
+                " connections: " << mConnectionsCount <<
+                " max read rate: " << mMaxReadRate <<
             KFS_LOG_EOM;
             mKfsNetClient.ClearMetaServerLocations();
             mServerIdx = 0;
@@ -716,6 +754,12 @@ public:
         }
         mSleepingFlag = false;
         Reset();
+        for (StreamClients::const_iterator theIt = mStreamClients.begin();
+                mStreamClients.end() != theIt;
+                ++theIt) {
+            delete *theIt;
+        }
+        mStreamClients.clear();
         delete [] mReadOpsPtr;
         mReadOpsPtr = 0;
         FreeWriteOps();
@@ -811,6 +855,10 @@ public:
                 }
             }
         }
+        if (mReadRateLimitedFlag && ! mSleepingFlag && ! IsReadRateLimited()) {
+            mReadRateLimitedFlag = false;
+            StartReads();
+        }
         if (! mSleepingFlag ||
                 mKfsNetClient.GetNetManager().Now() < mWakeupTime) {
             return;
@@ -840,6 +888,7 @@ private:
         MetaRequest,
         MetaRequest::GetNext
     > FreeWriteOpList;
+    typedef vector<KfsNetClient*> StreamClients;
     typedef set<
         string,
         less<string>,
@@ -919,6 +968,12 @@ private:
     string            mSyncCommitName;
     string            mStrBuffer;
     MetaMds           mMetaMds;
+    StreamClients     mStreamClients;
+    int               mConnectionsCount;
+    int64_t           mMaxReadRate;
+    int64_t           mReadRateCredit;
+    int64_t           mReadRateTime;
+    bool              mReadRateLimitedFlag;
     char              mCommmitBuf[kMaxCommitLineLen];
 
     int DeleteFetchOnRestartFile()
@@ -959,10 +1014,73 @@ private:
     {
         if (! mPendingList.IsEmpty()) {
             ClearPendingList();
-            mKfsNetClient.Stop();
+            StopClients();
             QCASSERT(mPendingList.IsEmpty());
         }
     }
+    void StopClients()
+    {
+        mKfsNetClient.Stop();
+        for (StreamClients::const_iterator theIt = mStreamClients.begin();
+                mStreamClients.end() != theIt;
+                ++theIt) {
+            (*theIt)->Stop();
+        }
+    }
+    void CancelClients()
+    {
+        mKfsNetClient.Cancel();
+        for (StreamClients::const_iterator theIt = mStreamClients.begin();
+                mStreamClients.end() != theIt;
+                ++theIt) {
+            (*theIt)->Cancel();
+        }
+    }
+    // Reads of the file with known size, after the first read, are spread
+    // over additional connections to the same node, in order to increase
+    // throughput with large bandwidth delay product. Fetching different
+    // parts of the same file from different nodes is not possible, as
+    // checkpoint and log segments are not byte for byte identical on
+    // different nodes.
+    KfsNetClient& GetReadClient(
+        const ReadOp& inOp)
+    {
+        if (mStreamClients.empty() || mFileSize <= 0 || inOp.mPos <= 0 ||
+                mReadPipelineFlag || ! (mWriteToFileFlag || mSetServerFlag)) {
+            return mKfsNetClient;
+        }
+        const size_t theIdx = (size_t)(&inOp - mReadOpsPtr) %
+            (mStreamClients.size() + 1);
+        if (0 == theIdx) {
+            return mKfsNetClient;
+        }
+        KfsNetClient& theClient = *mStreamClients[theIdx - 1];
+        if (&theClient.GetNetManager() != &mKfsNetClient.GetNetManager()) {
+            theClient.Stop();
+            theClient.SetNetManager(mKfsNetClient.GetNetManager());
+        }
+        if (theClient.GetServerLocation() !=
+                mKfsNetClient.GetServerLocation()) {
+            const bool    kCancelPendingOpsFlag = true;
+            string* const kOutErrMsgPtr         = 0;
+            const bool    kForceConnectFlag     = false;
+            theClient.SetServer(mKfsNetClient.GetServerLocation(),
+                kCancelPendingOpsFlag, kOutErrMsgPtr, kForceConnectFlag);
+        }
+        return theClient;
+    }
+    bool IsReadRateLimited()
+    {
+        if (mMaxReadRate <= 0) {
+            return false;
+        }
+        const int64_t theNow = microseconds();
+        mReadRateCredit = min(mMaxReadRate, mReadRateCredit +
+            min(int64_t(1000) * 1000, max(int64_t(0), theNow - mReadRateTime)) *
+            mMaxReadRate / (int64_t(1000) * 1000));
+        mReadRateTime = theNow;
+        return (mReadRateCredit <= 0);
+    }
     void StopKeepData()
     {
         if (mThread.IsStarted()) {
@@ -1010,8 +1128,9 @@ private:
     void InitRead()
     {
         StopAndClearPending();
-        mReadPipelineFlag = false;
-        mNextReadPos      = 0;
+        mReadPipelineFlag    = false;
+        mReadRateLimitedFlag = false;
+        mNextReadPos         = 0;
         mPos              = 0;
         mFileSize         = -1;
         mNextBlockSeq     = 0;
@@ -1047,7 +1166,7 @@ private:
     bool InitMetaVrPrimarySelector()
     {
         mSetServerFlag = false;
-        mKfsNetClient.Stop();
+        StopClients();
         mKfsNetClient.ClearMetaServerLocations();
         size_t theCount = 0;
         for (Servers::const_iterator theIt = mServers.begin();
@@ -1088,6 +1207,9 @@ private:
         ReadOp& theOp = *theOpPtr;
         theOp.mPos = inNextReadPos;
         mPendingList.PushBack(theOp);
+        if (0 < mMaxReadRate) {
+            mReadRateCredit -= mCurMaxReadSize;
+        }
         return StartRead(theOp);
     }
     bool StartRead(
@@ -1108,7 +1230,7 @@ private:
         inOp.fileName.clear();
         inOp.statusMsg.clear();
         inOp.mBuffer.Clear();
-        if (! mKfsNetClient.Enqueue(&inOp, this, &inOp.mBuffer)) {
+        if (! GetReadClient(inOp).Enqueue(&inOp, this, &inOp.mBuffer)) {
             panic("metad data sync: read op enqueue failure");
             return false;
         }
@@ -1345,7 +1467,7 @@ private:
                 // position, to handle current log segment grows while read
                 // RPC are in flight.
                 ClearPendingList();
-                mKfsNetClient.Cancel();
+                CancelClients();
                 mNextReadPos      = mPos;
                 mReadPipelineFlag = false;
                 break;
@@ -1401,29 +1523,40 @@ private:
         if (theEofFlag) {
             ReadDone();
         } else {
-            if (mFileSize < 0) {
-                if (mReadPipelineFlag) {
-                    while (StartRead()) {
-                        mNextReadPos += mCurMaxReadSize;
-                    }
-                } else {
-                    mNextReadPos    = mPos;
-                    mCurMaxReadSize = mMaxReadSize;
-                    if (StartRead()) {
-                        mNextReadPos += mCurMaxReadSize;
-                    }
+            StartReads();
+        }
+    }
+    void StartReads()
+    {
+        if (mFileSize < 0) {
+            if (mReadPipelineFlag) {
+                while (! ReadRateLimit() && StartRead()) {
+                    mNextReadPos += mCurMaxReadSize;
                 }
-            } else {
-                while (mNextReadPos < mFileSize && StartRead()) {
+            } else if (! ReadRateLimit()) {
+                mNextReadPos    = mPos;
+                mCurMaxReadSize = mMaxReadSize;
+                if (StartRead()) {
                     mNextReadPos += mCurMaxReadSize;
                 }
             }
+        } else {
+            while (mNextReadPos < mFileSize && ! ReadRateLimit() &&
+                    StartRead()) {
+                mNextReadPos += mCurMaxReadSize;
+            }
         }
     }
+    bool ReadRateLimit()
+    {
+        // Timeout() resumes reads once read rate credit becomes available.
+        mReadRateLimitedFlag = IsReadRateLimited();
+        return mReadRateLimitedFlag;
+    }
     void ReadDone()
     {
         ClearPendingList();
-        mKfsNetClient.Cancel();
+        CancelClients();
         QCRTASSERT(mPendingList.IsEmpty());
         if (0 <= mFd) {
             const int theFd = mFd;
@@ -1632,12 +1765,13 @@ private:
         }
         mWriteOpGeneration++;
         ClearPendingList();
-        mKfsNetClient.Stop();
+        StopClients();
         QCRTASSERT(mPendingList.IsEmpty());
         mBuffer.Clear();
-        mPos          = 0;
-        mNextReadPos  = 0;
-        mSleepingFlag = false;
+        mPos                 = 0;
+        mNextReadPos         = 0;
+        mSleepingFlag        = false;
+        mReadRateLimitedFlag = false;
     }
     class FieldParser
     {
@@ -2447,19 +2581,19 @@ private:
             outEmpytFsFlag = true;
             return inFsId;
         }
+        close(theFd);
         StBufferT<char, 1> theBuf;
         theBuf.Resize(4 << 10);
-        ssize_t theNRd = read(theFd, theBuf.GetPtr(), theBuf.GetSize() - 1);
+        // Checkpoint might be compressed.
+        const int theNRd = CheckpointCompressor::ReadHeader(
+            theFileName.c_str(), theBuf.GetPtr(), theBuf.GetSize() - 1);
         int64_t theRet;
         if (theNRd < 0) {
-            theRet = GetErrno();
+            theRet = theNRd;
             KFS_LOG_STREAM_ERROR <<
                 "read " << theFileName << ": " <<
-                QCUtils::SysError(theRet) <<
+                QCUtils::SysError(-theNRd) <<
             KFS_LOG_EOM;
-            if (0 < theRet) {
-                theRet = -theRet;
-            }
         } else {
             theBuf.GetPtr()[theNRd] = 0;
             const char* thePtr = strstr(
@@ -2483,7 +2617,6 @@ private:
                 }
             }
         }
-        close(theFd);
         return theRet;
     }
 private:
@@ -66,7 +66,8 @@ protected:
             size_t(8)   << 20, // size_t TMinStorageAlloc,
             size_t(128) << 20, // size_t TMaxStorageAlloc,
                 // no explicit ~Tree() or cleanup implemented yet.
-            false              // bool   TForceCleanupFlag
+            false,             // bool   TForceCleanupFlag
+            MemoryAccounting::kSubsystemTreeNodes
         > Alloc;
         Allocator() : alloc() {}
         void* allocate() {
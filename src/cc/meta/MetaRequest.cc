@@ -37,6 +37,7 @@
 #include "ClientSM.h"
 #include "Replay.h"
 #include "MetaVrOps.h"
+#include "CheckpointCompressor.h"
 
 #include "kfsio/Globals.h"
 #include "kfsio/checksum.h"
@@ -60,13 +61,18 @@
 #include <sys/stat.h>
 #include <signal.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <string.h>
+#include <spawn.h>
 
 #include <map>
 #include <iomanip>
 #include <sstream>
 #include <limits>
 #include <fstream>
+#include <vector>
+
+extern char **environ;
 
 namespace KFS {
 
@@ -80,6 +86,7 @@ using std::make_pair;
 using std::numeric_limits;
 using std::hex;
 using std::ofstream;
+using std::vector;
 using KFS::libkfsio::globals;
 
 static bool    gWormMode = false;
@@ -2804,6 +2811,163 @@ MetaAllocate::ShowSelf(ostream& os) const
     return os;
 }
 
+/* virtual */
+MetaAllocateBatch::~MetaAllocateBatch()
+{
+    for (Allocs::const_iterator it = allocs.begin();
+            allocs.end() != it;
+            ++it) {
+        MetaRequest::Release(*it);
+    }
+}
+
+/* virtual */ bool
+MetaAllocateBatch::dispatch(ClientSM& sm)
+{
+    return sm.Handle(*this);
+}
+
+/* virtual */ void
+MetaAllocateBatch::handle()
+{
+    suspended = false;
+    if (startedFlag) {
+        BuildResponse();
+        return;
+    }
+    startedFlag = true;
+    if (status < 0) {
+        return;
+    }
+    const char*       p = chunkOffsets.GetPtr();
+    const char* const e = p + chunkOffsets.GetSize();
+    while (p < e) {
+        chunkOff_t offset = -1;
+        if (! ParseInt(p, e - p, offset)) {
+            while (p < e && (*p & 0xFF) <= ' ') {
+                p++;
+            }
+            if (p != e) {
+                status    = -EINVAL;
+                statusMsg = "chunk offsets list parse error";
+            }
+            break;
+        }
+        if (offset < 0) {
+            status    = -EINVAL;
+            statusMsg = "invalid chunk offset";
+            break;
+        }
+        if (size_t(kMaxChunkCount) <= allocs.size()) {
+            status    = -EINVAL;
+            statusMsg = "exceeded max chunk allocation batch size";
+            break;
+        }
+        const chunkOff_t chunkOffset = chunkStartOffset(offset);
+        Allocs::const_iterator it;
+        for (it = allocs.begin();
+                allocs.end() != it &&
+                    chunkOffset != chunkStartOffset((*it)->offset);
+                ++it)
+            {}
+        if (allocs.end() != it) {
+            status    = -EINVAL;
+            statusMsg = "duplicate chunk offset";
+            break;
+        }
+        MetaAllocate& alloc = *(new MetaAllocate(opSeqno, fid, offset));
+        allocs.push_back(&alloc);
+        InitAllocate(alloc);
+    }
+    if (0 == status && allocs.empty()) {
+        status    = -EINVAL;
+        statusMsg = "empty chunk offsets list";
+    }
+    if (0 != status || ! gLayoutManager.IsAllocationAllowed(*this)) {
+        return;
+    }
+    // Hold an extra reference in order to build the response here, if all
+    // allocations complete before the last allocation submit returns.
+    suspended    = true;
+    pendingCount = (int)allocs.size() + 1;
+    for (Allocs::const_iterator it = allocs.begin();
+            allocs.end() != it;
+            ++it) {
+        submit_request(*it);
+    }
+    if (0 < --pendingCount) {
+        return;
+    }
+    suspended = false;
+    BuildResponse();
+}
+
+void
+MetaAllocateBatch::InitAllocate(MetaAllocate& alloc)
+{
+    alloc.SetClientContext(*this);
+    alloc.pathname               = pathname;
+    alloc.clientHost             = clientHost;
+    alloc.delegationSeq          = delegationSeq;
+    alloc.delegationValidForTime = delegationValidForTime;
+    alloc.delegationFlags        = delegationFlags;
+    alloc.delegationIssuedTime   = delegationIssuedTime;
+    alloc.clnt                   = this;
+}
+
+int
+MetaAllocateBatch::AllocDone(int code, void* data)
+{
+    if (EVENT_CMD_DONE != code || ! data || pendingCount <= 0) {
+        panic("MetaAllocateBatch::AllocDone invalid invocation");
+        return 1;
+    }
+    if (0 < --pendingCount) {
+        return 0;
+    }
+    submit_request(this);
+    return 0;
+}
+
+void
+MetaAllocateBatch::BuildResponse()
+{
+    if (0 != status) {
+        return;
+    }
+    // Chunk access tokens are generated here, by the main thread, as the
+    // response method is invoked by the client thread.
+    ostream&   os = sWOStream.Set(resp);
+    ReqOstream ros(os);
+    for (Allocs::const_iterator it = allocs.begin();
+            allocs.end() != it;
+            ++it) {
+        (*it)->response(ros);
+    }
+    os.flush();
+    sWOStream.Reset();
+    if (! os) {
+        resp.Clear();
+        status    = -ENOMEM;
+        statusMsg = "response exceeds max. size";
+    }
+}
+
+ostream&
+MetaAllocateBatch::ShowSelf(ostream& os) const
+{
+    return (os << "allocate batch:"
+        " seq: "     << opSeqno      <<
+        " status: "  << status       <<
+        " "          << statusMsg    <<
+        " path: "    << pathname     <<
+        " fid: "     << fid          <<
+        " offsets: " << chunkOffsets <<
+        " client: "  << clientHost   <<
+        " / "        << clientIp
+    );
+}
+
 bool
 MetaLogChunkVersionChange::start()
 {
@@ -3905,6 +4069,73 @@ DoFork(int childTimeLimit, const char* childName)
     return ret;
 }
 
+/*
+ * Start log compactor to write checkpoint by loading the prior checkpoint and
+ * replaying log segments. Unlike fork(), posix_spawn() does not copy the page
+ * tables, and there is no copy on write of the meta server's address space
+ * while the checkpoint is being written. The compactor writes checkpoint
+ * compression counters into descriptor 3, the counters pipe write end.
+ */
+static int
+SpawnLogCompactor(
+    const string& compactor,
+    const string& cpDir,
+    const string& nextLogName,
+    seq_t         lastLogNum,
+    int64_t       maxWriteRate,
+    int           compressionLevel,
+    bool          writeSyncFlag,
+    int           timeLimitSec,
+    int           countersFd)
+{
+    const string::size_type pos    = nextLogName.rfind('/');
+    const string            logDir = string::npos == pos ? string(".") :
+        (0 == pos ? string("/") : nextLogName.substr(0, pos));
+    vector<string> args;
+    args.push_back(compactor);
+    args.push_back("-l");
+    args.push_back(logDir);
+    args.push_back("-c");
+    args.push_back(cpDir);
+    args.push_back("-i");
+    args.push_back(toString(lastLogNum));
+    args.push_back("-n");
+    args.push_back(nextLogName);
+    args.push_back("-R");
+    args.push_back(toString(maxWriteRate));
+    args.push_back("-z");
+    args.push_back(toString(compressionLevel));
+    args.push_back("-s");
+    args.push_back(writeSyncFlag ? "1" : "0");
+    args.push_back("-t");
+    args.push_back(toString(timeLimitSec));
+    if (0 <= countersFd) {
+        args.push_back("-S");
+    }
+    vector<char*> argv;
+    for (vector<string>::iterator it = args.begin(); args.end() != it; ++it) {
+        argv.push_back(&(*it)[0]);
+    }
+    argv.push_back(0);
+    posix_spawn_file_actions_t actions;
+    int err = posix_spawn_file_actions_init(&actions);
+    if (0 != err) {
+        return (0 < err ? -err : -EFAULT);
+    }
+    if (0 <= countersFd) {
+        err = posix_spawn_file_actions_adddup2(&actions, countersFd, 3);
+    }
+    pid_t pid = -1;
+    if (0 == err) {
+        err = posix_spawnp(&pid, argv[0], &actions, 0, &argv[0], environ);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    if (0 != err) {
+        return (0 < err ? -err : -EFAULT);
+    }
+    return (int)pid;
+}
+
 /* virtual */ void
 MetaDumpChunkToServerMap::handle()
 {
@@ -4181,6 +4412,7 @@ MetaStats::handle()
     ostringstream& os = GetTmpOStringStream();
     status = 0;
     globals().counterManager.Show(os);
+    MemoryAccounting::Show(os, ": ", "\r\n");
     stats = os.str();
 }
 
@@ -4296,6 +4528,27 @@ MetaGetRequestCounters::handle()
     systemCpuMicroSec = gNetDispatch.GetSystemCpuMicroSec();
 }
 
+/* virtual */ void
+MetaGetRequestHistograms::handle()
+{
+    if (! HasEnoughIoBuffersForResponse(*this)) {
+        return;
+    }
+    if (! HasMetaServerStatsAccess(*this)) {
+        return;
+    }
+    if (resetFlag && ! HasMetaServerAdminAccess(*this)) {
+        return;
+    }
+    status    = 0;
+    startTime = gNetDispatch.GetHistogramsStartTime();
+    timeNow   = microseconds();
+    gNetDispatch.GetHistogramsCsv(resp);
+    if (resetFlag) {
+        gNetDispatch.ResetHistograms();
+    }
+}
+
 /* virtual */ void
 MetaCheckpoint::handle()
 {
@@ -4311,17 +4564,45 @@ MetaCheckpoint::handle()
             " done; status: " << status <<
             " failures: "     << failedCount <<
         KFS_LOG_EOM;
-        if (status < 0) {
+        const string fileName = cp.cpfile(runningCheckpointId);
+        if (incrementalFlag && Checkpoint::kNoLogRecordsExitStatus == status) {
+            // No log records since the latest checkpoint, the latest
+            // checkpoint remains current.
+            KFS_LOG_STREAM_INFO <<
+                "checkpoint: " << runningCheckpointId <<
+                " no log records since the last checkpoint: " <<
+                    lastCheckpointId <<
+            KFS_LOG_EOM;
+            failedCount      = 0;
+            lastCheckpointId = runningCheckpointId;
+            status           = 0;
+        } else if (0 == status && incrementalFlag && ! file_exists(fileName)) {
+            KFS_LOG_STREAM_ERROR <<
+                "checkpoint: " << runningCheckpointId <<
+                " log compactor did not create: " << fileName <<
+            KFS_LOG_EOM;
+            status = -ENOENT;
+        }
+        if (status != 0) {
             failedCount++;
-        } else {
+        } else if (lastCheckpointId != runningCheckpointId) {
             failedCount = 0;
             lastCheckpointId = runningCheckpointId;
-            const string fileName = cp.cpfile(lastCheckpointId);
+            struct stat st;
+            lastCheckpointSize = stat(fileName.c_str(), &st) == 0 ?
+                (int64_t)st.st_size : int64_t(-1);
             gNetDispatch.GetMetaDataStore().RegisterCheckpoint(
                 fileName.c_str(),
                 lastCheckpointId,
                 runningCheckpointLogSegmentNum
             );
+            if (0 <= countersFd) {
+                ReadCompressCounters();
+            }
+        }
+        if (0 <= countersFd) {
+            close(countersFd);
+            countersFd = -1;
         }
         if (0 <= lockFd) {
             close(lockFd);
@@ -4424,13 +4705,54 @@ MetaCheckpoint::handle()
     runningCheckpointId            = committedSeq;
     lastRun                        = now;
     runningCheckpointLogSegmentNum = finishLog->logSegmentNum;
+    // The checkpoint writer process passes the compression counters back
+    // through the pipe.
+    int countersPipe[2] = { -1, -1 };
+    if (0 <= checkpointCompressionLevel) {
+        if (pipe(countersPipe)) {
+            const int err = errno;
+            KFS_LOG_STREAM_ERROR <<
+                "checkpoint: counters pipe: " << QCUtils::SysError(err) <<
+            KFS_LOG_EOM;
+            countersPipe[0] = -1;
+            countersPipe[1] = -1;
+        } else if (fcntl(countersPipe[0], F_SETFD, FD_CLOEXEC) ||
+                fcntl(countersPipe[0], F_SETFL, O_NONBLOCK)) {
+            const int err = errno;
+            KFS_LOG_STREAM_ERROR <<
+                "checkpoint: counters pipe: " << QCUtils::SysError(err) <<
+            KFS_LOG_EOM;
+            close(countersPipe[0]);
+            close(countersPipe[1]);
+            countersPipe[0] = -1;
+            countersPipe[1] = -1;
+        }
+    }
     // DoFork() / PrepareCurrentThreadToFork() releases and re-acquires the
     // global mutex by waiting on condition with this mutex, but must ensure
     // that no other RPC gets processed. If log commit sequence has changed
     // after DoFork() invocation, then there is a bug with the prepare to
     // fork logic, and checkpoint will not be valid. In such case do not write
     // the checkpoint in the child, and "panic" the parent.
-    if ((pid = DoFork(checkpointWriteTimeoutSec, "meta-checkpoint")) == 0) {
+    if (incrementalFlag) {
+        // The log segments since the last checkpoint are the checkpoint
+        // "delta". Log compactor loads the last checkpoint, replays the
+        // segments, and writes new full checkpoint. No fork is required, and
+        // the meta server continues processing requests while the checkpoint
+        // is written, but the compactor needs about the same memory as the
+        // meta server file system tree.
+        pid = SpawnLogCompactor(
+            logCompactorPath,
+            cp.getCPDir(),
+            finishLog->logName,
+            runningCheckpointLogSegmentNum - 1,
+            checkpointMaxWriteRate,
+            checkpointCompressionLevel,
+            checkpointWriteSyncFlag,
+            checkpointWriteTimeoutSec,
+            countersPipe[1]
+        );
+    } else if ((pid = DoFork(checkpointWriteTimeoutSec, "meta-checkpoint")) == 0) {
         MetaVrLogSeq logSeq;
         int64_t      errChecksum = -1;
         fid_t        fidSeed     = -1;
@@ -4443,11 +4765,17 @@ MetaCheckpoint::handle()
             metatree.setUpdatePathSpaceUsage(true);
             cp.setWriteSyncFlag(checkpointWriteSyncFlag);
             cp.setWriteBufferSize(checkpointWriteBufferSize);
+            cp.setMaxWriteRate(checkpointMaxWriteRate);
+            cp.setCompressionLevel(checkpointCompressionLevel);
+            CheckpointCompressor::ClearCounters();
             status = cp.write(
                 finishLog->logName,
                 runningCheckpointId,
                 errChecksum
             );
+            if (0 == status && 0 <= countersPipe[1]) {
+                CheckpointCompressor::WriteCompressCounters(countersPipe[1]);
+            }
         }
         // Child does not attempt graceful exit.
         _exit(status == 0 ? 0 : 1);
@@ -4456,11 +4784,22 @@ MetaCheckpoint::handle()
         panic("checkpoint: meta data changed after prepare to fork");
     }
     finishLog = 0;
+    if (0 <= countersPipe[1]) {
+        close(countersPipe[1]);
+    }
     if (pid < 0) {
+        if (0 <= countersPipe[0]) {
+            close(countersPipe[0]);
+        }
         status = (int)pid;
+        if (0 <= lockFd) {
+            close(lockFd);
+            lockFd = -1;
+        }
         KFS_LOG_STREAM_ERROR <<
             "checkpoint: " << runningCheckpointId <<
-            " fork failure: " << QCUtils::SysError(-status) <<
+            (incrementalFlag ? " log compactor start failure: " :
+                " fork failure: ") << QCUtils::SysError(-status) <<
         KFS_LOG_EOM;
         return;
     }
@@ -4469,10 +4808,33 @@ MetaCheckpoint::handle()
         " => "         << runningCheckpointId <<
         " pid: "       << pid <<
     KFS_LOG_EOM;
-    suspended = true;
+    countersFd = countersPipe[0];
+    suspended  = true;
     gChildProcessTracker.Track(pid, this);
 }
 
+void
+MetaCheckpoint::ReadCompressCounters()
+{
+    CheckpointCompressor::Counters counters;
+    const int err = CheckpointCompressor::ReadCompressCounters(
+        countersFd, counters);
+    if (0 != err) {
+        KFS_LOG_STREAM_ERROR <<
+            "checkpoint: " << lastCheckpointId <<
+            " failed to read compression counters: " <<
+                QCUtils::SysError(-err) <<
+        KFS_LOG_EOM;
+        return;
+    }
+    if (counters.mCompressOutByteCount <= 0) {
+        return;
+    }
+    lastCompressionRatio = (double)counters.mCompressInByteCount /
+        counters.mCompressOutByteCount;
+    lastCompressCpuUsec  = counters.mCompressCpuUsec;
+}
+
 void
 MetaCheckpoint::ScheduleNow()
 {
@@ -4500,6 +4862,21 @@ MetaCheckpoint::SetParameters(const Properties& props)
     flushNewViewDelaySec = props.getValue(
         "metaServer.checkpoint.flushNewViewDelaySec",
         flushNewViewDelaySec);
+    checkpointMaxWriteRate = max(int64_t(0), props.getValue(
+        "metaServer.checkpoint.maxWriteRate",
+        checkpointMaxWriteRate));
+    checkpointCompressionLevel = min(9, props.getValue(
+        "metaServer.checkpoint.compressionLevel",
+        checkpointCompressionLevel));
+    incrementalFlag = props.getValue(
+        "metaServer.checkpoint.incremental",
+        incrementalFlag ? 1 : 0) != 0;
+    logCompactorPath = props.getValue(
+        "metaServer.checkpoint.logCompactor",
+        logCompactorPath);
+    if (logCompactorPath.empty()) {
+        incrementalFlag = false;
+    }
 }
 
 int*
@@ -4972,6 +5349,21 @@ MetaAllocate::response(ReqOstream& os)
     responseSelf(os);
 }
 
+void
+MetaAllocateBatch::response(ReqOstream& os, IOBuffer& buf)
+{
+    if (! OkHeader(this, os)) {
+        return;
+    }
+    os <<
+        (shortRpcFormatFlag ? "C:" : "Num-chunks: ") << allocs.size() << "\r\n" <<
+        (shortRpcFormatFlag ? "l:" : "Content-length: ") <<
+            resp.BytesConsumable() << "\r\n"
+    "\r\n";
+    os.flush();
+    buf.Move(&resp);
+}
+
 void
 MetaAllocate::writeChunkAccess(ReqOstream& os)
 {
@@ -5053,6 +5445,9 @@ MetaAllocate::responseSelf(ReqOstream& os)
     if (appendChunk) {
         os << (shortRpcFormatFlag ? "O:" : "Chunk-offset: ") <<
             offset << "\r\n";
+    } else if (allocBatchFlag) {
+        // Let the client know that batch allocation is supported.
+        os << (shortRpcFormatFlag ? "AB:1\r\n" : "Allocate-batch: 1\r\n");
     }
     assert(! servers.empty() || invalidateAllFlag);
     if (! shortRpcFormatFlag && ! servers.empty()) {
@@ -5575,6 +5970,22 @@ MetaGetRequestCounters::response(ReqOstream &os, IOBuffer& buf)
     buf.Move(&resp);
 }
 
+void
+MetaGetRequestHistograms::response(ReqOstream &os, IOBuffer& buf)
+{
+    if (! OkHeader(this, os)) {
+        return;
+    }
+    os <<
+        (shortRpcFormatFlag ? "l:" : "Content-length: ") <<
+            resp.BytesConsumable()  << "\r\n"
+        "Start-time-usec: " << startTime << "\r\n"
+        "Time-usec: "       << timeNow   << "\r\n"
+    "\r\n";
+    os.flush();
+    buf.Move(&resp);
+}
+
 void
 MetaGetPathName::response(ReqOstream& os)
 {
@@ -6131,6 +6542,10 @@ MetaChunkReplicate::request(ReqOstream& os)
             rs << (shortRpcFormatFlag ? "S:" : "File-size: ") <<
                 fileSize << "\r\n";
         }
+        if (0 <= availableStripes) {
+            rs << (shortRpcFormatFlag ? "AS:" : "Available-stripes: ") <<
+                availableStripes << "\r\n";
+        }
     } else {
         rs << (shortRpcFormatFlag ? "SC:" : "Chunk-location: ") <<
             srcLocation << "\r\n";
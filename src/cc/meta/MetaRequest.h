@@ -52,6 +52,7 @@
 #include "common/ReqOstream.h"
 #include "common/RequestParser.h"
 #include "common/kfsatomic.h"
+#include "common/MemoryAccounting.h"
 #include "common/CIdChecksum.h"
 #include "common/LinearHash.h"
 #include "common/SingleLinkedQueue.h"
@@ -180,7 +181,9 @@ using std::less;
     f(VR_LOG_START_VIEW) \
     f(VR_GET_STATUS) \
     f(SETATIME) \
-    f(LINK)
+    f(LINK) \
+    f(ALLOCATE_BATCH) \
+    f(GET_REQUEST_HISTOGRAMS)
 
 enum MetaOp {
 #define KfsMakeMetaOpEnumEntry(name) META_##name,
@@ -199,7 +202,8 @@ typedef ReqOstreamT<ostream> ReqOstream;
 /*!
  * \brief Meta request base class
  */
-struct MetaRequest {
+struct MetaRequest :
+    public MemoryAccounted<MemoryAccounting::kSubsystemRequests> {
     typedef vector<
         ChunkServerPtr,
         StdAllocator<ChunkServerPtr>
@@ -270,6 +274,9 @@ struct MetaRequest {
     int             clientRackId;    //!< set by client
     int64_t         submitTime;      //!< to time requests, optional.
     int64_t         processTime;     //!< same as previous
+    int64_t         recvTime;        //!< client thread receive time
+    int64_t         logTime;         //!< log write and commit wait time
+    int64_t         dispatchTime;    //!< request processing completion time
     string          statusMsg;       //!< optional human readable status message
     seq_t           opSeqno;         //!< command sequence # sent by the client
     seq_t           seqno;           //!< sequence no. global ordering
@@ -304,6 +311,9 @@ struct MetaRequest {
           clientRackId(-1),
           submitTime(0),
           processTime(0),
+          recvTime(0),
+          logTime(0),
+          dispatchTime(0),
           statusMsg(),
           opSeqno(opSeq),
           seqno(-1),
@@ -425,6 +435,25 @@ struct MetaRequest {
             DecIntParser::Parse(ioPtr, inLen, outValue));
     }
     int* GetLogQueueCounter() const;
+    //!< Copy client, and authentication context from the request that this
+    //!< request is created on behalf of.
+    void SetClientContext(const MetaRequest& req)
+    {
+        clientProtoVers     = req.clientProtoVers;
+        clientRackId        = req.clientRackId;
+        fromChunkServerFlag = req.fromChunkServerFlag;
+        validDelegationFlag = req.validDelegationFlag;
+        shortRpcFormatFlag  = req.shortRpcFormatFlag;
+        clientIp            = req.clientIp;
+        clientReportedIp    = req.clientReportedIp;
+        nodeId              = req.nodeId;
+        authUid             = req.authUid;
+        authGid             = req.authGid;
+        euser               = req.euser;
+        egroup              = req.egroup;
+        maxWaitMillisec     = req.maxWaitMillisec;
+        sessionEndTime      = req.sessionEndTime;
+    }
     const int GetRecursionCount() const
         { return recursionCount; }
     bool Write(ostream& os, bool omitDefaultsFlag = false) const;
@@ -455,6 +484,9 @@ protected:
         submitCount         = 0;
         submitTime          = 0;
         processTime         = 0;
+        recvTime            = 0;
+        logTime             = 0;
+        dispatchTime        = 0;
         statusMsg           = string();
         opSeqno             = -1;
         seqno               = -1;
@@ -1344,6 +1376,9 @@ struct MetaAllocate: public MetaRequest, public  KfsCallbackObj {
     uint32_t             numServerReplies;
     int                  firstFailedServerIdx;
     bool                 invalidateAllFlag;
+    //!< client supports batch allocation, and requests the meta server to
+    //!< report if it supports batch allocation
+    bool                 allocBatchFlag;
     const FAPermissions* permissions;
     MetaAllocate*        next;
     int64_t              leaseId;
@@ -1390,6 +1425,7 @@ struct MetaAllocate: public MetaRequest, public  KfsCallbackObj {
           numServerReplies(0),
           firstFailedServerIdx(-1),
           invalidateAllFlag(false),
+          allocBatchFlag(false),
           permissions(0),
           next(0),
           leaseId(-1),
@@ -1449,6 +1485,7 @@ struct MetaAllocate: public MetaRequest, public  KfsCallbackObj {
         .Def2("Max-appenders",  "M", &MetaAllocate::maxAppendersPerChunk,    int(64))
         .Def2("Invalidate-all", "I", &MetaAllocate::invalidateAllFlag,         false)
         .Def2("Chunk-master",   "C", &MetaAllocate::chunkServerName                 )
+        .Def2("Allocate-batch", "AB", &MetaAllocate::allocBatchFlag,           false)
         ;
     }
 private:
@@ -1528,6 +1565,72 @@ struct MetaLogChunkAllocate : public MetaRequest {
     }
 };
 
+/*!
+ * \brief allocate a group of chunks of a file, for example all chunks of
+ * RS chunk block, in one round trip. The request creates and executes
+ * allocation request for every chunk, and responds when all chunk allocations
+ * complete. Each chunk allocation is executed and logged exactly as single
+ * chunk allocation, and the log writer commits the resulting log records as
+ * a group.
+ */
+struct MetaAllocateBatch: public MetaRequest, public KfsCallbackObj {
+    typedef vector<MetaAllocate*> Allocs;
+    enum { kMaxChunkCount = 512 };
+
+    fid_t                fid;
+    StringBufT<21 * 32>  chunkOffsets; //!< offsets of the chunks to allocate
+    StringBufT<64>       clientHost;
+    StringBufT<256>      pathname;
+    DelegationToken::TokenSeq delegationSeq;
+    uint32_t             delegationValidForTime;
+    uint16_t             delegationFlags;
+    int64_t              delegationIssuedTime;
+    Allocs               allocs;
+    IOBuffer             resp;
+    MetaAllocateBatch()
+        : MetaRequest(META_ALLOCATE_BATCH, kLogNever),
+          KfsCallbackObj(),
+          fid(-1),
+          chunkOffsets(),
+          clientHost(),
+          pathname(),
+          delegationSeq(-1),
+          delegationValidForTime(0),
+          delegationFlags(0),
+          delegationIssuedTime(0),
+          allocs(),
+          resp(),
+          pendingCount(0),
+          startedFlag(false)
+    {
+        SET_HANDLER(this, &MetaAllocateBatch::AllocDone);
+    }
+    virtual ~MetaAllocateBatch();
+    virtual void handle();
+    virtual void response(ReqOstream& os, IOBuffer& buf);
+    virtual ostream& ShowSelf(ostream& os) const;
+    virtual bool dispatch(ClientSM& sm);
+    int AllocDone(int code, void* data);
+    bool Validate()
+    {
+        return (0 <= fid && ! chunkOffsets.empty());
+    }
+    template<typename T> static T& ParserDef(T& parser)
+    {
+        return MetaRequest::ParserDef(parser)
+        .Def2("File-handle",   "P", &MetaAllocateBatch::fid,     fid_t(-1))
+        .Def2("Chunk-offsets", "O", &MetaAllocateBatch::chunkOffsets      )
+        .Def2("Pathname",      "N", &MetaAllocateBatch::pathname          )
+        .Def2("Client-host",   "H", &MetaAllocateBatch::clientHost        )
+        ;
+    }
+private:
+    int  pendingCount;
+    bool startedFlag;
+    void InitAllocate(MetaAllocate& alloc);
+    void BuildResponse();
+};
+
 /*!
  * \brief truncate a file
  */
@@ -2702,6 +2805,7 @@ struct MetaChunkReplicate: public MetaChunkRequest {
     int16_t                             numStripes;
     int16_t                             numRecoveryStripes;
     int32_t                             stripeSize;
+    int16_t                             availableStripes;
     ChunkServerPtr                      dataServer;  //!< where to get a copy from
     ServerLocation                      srcLocation;
     string                              pathname;
@@ -2730,6 +2834,7 @@ struct MetaChunkReplicate: public MetaChunkRequest {
           numStripes(0),
           numRecoveryStripes(0),
           stripeSize(0),
+          availableStripes(-1),
           dataServer(src),
           srcLocation(loc),
           pathname(),
@@ -3607,6 +3712,40 @@ private:
     int64_t  systemCpuMicroSec;
 };
 
+// Request latency histograms by request type and processing phase, and client
+// threads queue depth histograms.
+struct MetaGetRequestHistograms : public MetaRequest {
+    bool resetFlag;
+    MetaGetRequestHistograms()
+        : MetaRequest(META_GET_REQUEST_HISTOGRAMS, kLogNever),
+          resetFlag(false),
+          resp(),
+          startTime(0),
+          timeNow(0)
+        {}
+    virtual void handle();
+    virtual void response(ReqOstream &os, IOBuffer& buf);
+    virtual ostream& ShowSelf(ostream& os) const
+    {
+        return os << "get-request-histograms" <<
+            (resetFlag ? " reset" : "");
+    }
+    bool Validate()
+    {
+        return true;
+    }
+    template<typename T> static T& ParserDef(T& parser)
+    {
+        return MetaRequest::ParserDef(parser)
+        .Def2("Reset", "R", &MetaGetRequestHistograms::resetFlag, false)
+        ;
+    }
+private:
+    IOBuffer resp;
+    int64_t  startTime;
+    int64_t  timeNow;
+};
+
 struct MetaLogWriterControl;
 
 struct MetaCheckpoint : public MetaRequest {
@@ -3622,6 +3761,14 @@ struct MetaCheckpoint : public MetaRequest {
           flushNewViewDelaySec(10),
           checkpointWriteSyncFlag(true),
           checkpointWriteBufferSize(16 << 20),
+          checkpointMaxWriteRate(0),
+          checkpointCompressionLevel(-1),
+          lastCheckpointSize(-1),
+          lastCompressionRatio(0),
+          lastCompressCpuUsec(0),
+          countersFd(-1),
+          incrementalFlag(false),
+          logCompactorPath("logcompactor"),
           lastCheckpointId(),
           runningCheckpointId(),
           runningCheckpointLogSegmentNum(-1),
@@ -3645,6 +3792,14 @@ struct MetaCheckpoint : public MetaRequest {
         { return failedCount; }
     int GetIntervalSec() const
         { return intervalSec; }
+    int GetCompressionLevel() const
+        { return checkpointCompressionLevel; }
+    int64_t GetLastCheckpointSize() const
+        { return lastCheckpointSize; }
+    double GetLastCompressionRatio() const
+        { return lastCompressionRatio; }
+    int64_t GetLastCompressCpuUsec() const
+        { return lastCompressCpuUsec; }
 private:
     string                lockFileName;
     int                   lockFd;
@@ -3656,6 +3811,14 @@ private:
     int                   flushNewViewDelaySec;
     bool                  checkpointWriteSyncFlag;
     size_t                checkpointWriteBufferSize;
+    int64_t               checkpointMaxWriteRate;
+    int                   checkpointCompressionLevel;
+    int64_t               lastCheckpointSize;
+    double                lastCompressionRatio;
+    int64_t               lastCompressCpuUsec;
+    int                   countersFd;
+    bool                  incrementalFlag;
+    string                logCompactorPath;
     MetaVrLogSeq          lastCheckpointId;
     MetaVrLogSeq          runningCheckpointId;
     seq_t                 runningCheckpointLogSegmentNum;
@@ -3663,6 +3826,8 @@ private:
     time_t                lastRunDoneTime;
     MetaLogWriterControl* finishLog;
     MetaVrLogSeq          flushViewLogSeq;
+
+    void ReadCompressCounters();
 };
 
 /*!
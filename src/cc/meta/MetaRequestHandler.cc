@@ -160,6 +160,9 @@ MakeMetaRequestHandler(
     .MakeParser("ALLOCATE",
         META_ALLOCATE,
         static_cast<const MetaAllocate*>(0))
+    .MakeParser("ALLOCATE_BATCH",
+        META_ALLOCATE_BATCH,
+        static_cast<const MetaAllocateBatch*>(0))
     .MakeParser("RETIRE_CHUNKSERVER",
         META_RETIRE_CHUNKSERVER,
         static_cast<const MetaRetireChunkserver*>(0))
@@ -231,6 +234,9 @@ MakeMetaRequestHandler(
     .MakeParser("GET_REQUEST_COUNTERS",
         META_GET_REQUEST_COUNTERS,
         static_cast<const MetaGetRequestCounters*>(0))
+    .MakeParser("GET_REQUEST_HISTOGRAMS",
+        META_GET_REQUEST_HISTOGRAMS,
+        static_cast<const MetaGetRequestHistograms*>(0))
     .MakeParser("DISCONNECT",
         META_DISCONNECT,
         static_cast<const MetaDisconnect*>(0))
@@ -53,6 +53,7 @@
 #include "common/rusage.h"
 #include "common/SingleLinkedQueue.h"
 #include "common/StdAllocator.h"
+#include "common/LatencyHistogram.h"
 
 #include "qcdio/QCThread.h"
 #include "qcdio/QCUtils.h"
@@ -830,6 +831,270 @@ private:
     MetaOpCounters& operator=(const MetaOpCounters&);
 }* MetaOpCounters::sInstance(MetaOpCounters::MakeInstance());
 
+// Request latency histograms by request type and processing phase. Histograms
+// are allocated on first use, in order to keep memory footprint proportional
+// to the number of request types actually used.
+class RequestHistograms
+{
+public:
+    enum Phase
+    {
+        kPhaseQueue    = 0, // Client thread to main thread queue wait.
+        kPhaseLog      = 1, // Transaction log write and commit wait.
+        kPhaseProcess  = 2, // Request processing: start() and handle().
+        kPhaseWait     = 3, // Suspended: chunk servers, or other requests.
+        kPhaseResponse = 4, // Dispatch to response formatted in client thread.
+        kPhaseTotal    = 5, // Receive to dispatch: all the above but response.
+        kPhaseCount
+    };
+    typedef LatencyHistogram Histogram;
+
+    RequestHistograms(
+        int count)
+        : mEntries(count, (Entry*)0),
+          mCount(0)
+        {}
+    ~RequestHistograms()
+    {
+        for (Entries::const_iterator it = mEntries.begin();
+                it != mEntries.end();
+                ++it) {
+            delete *it;
+        }
+    }
+    void Add(
+        int     idx,
+        Phase   phase,
+        int64_t usec)
+    {
+        Entry*& entry = mEntries[idx];
+        if (! entry) {
+            entry = new Entry();
+        }
+        entry->Get(phase).Add(usec);
+        mCount++;
+    }
+    void Merge(
+        const RequestHistograms& other)
+    {
+        if (other.mCount <= 0) {
+            return;
+        }
+        for (size_t i = 0; i < other.mEntries.size(); i++) {
+            const Entry* const entry = other.mEntries[i];
+            if (! entry) {
+                continue;
+            }
+            for (int k = 0; k < kPhaseCount; k++) {
+                const Histogram* const hist = entry->Find(k);
+                if (hist && 0 < hist->GetCount()) {
+                    Entry*& dest = mEntries[i];
+                    if (! dest) {
+                        dest = new Entry();
+                    }
+                    dest->Get((Phase)k).Merge(*hist);
+                }
+            }
+        }
+        mCount += other.mCount;
+    }
+    void Clear()
+    {
+        if (mCount <= 0) {
+            return;
+        }
+        for (Entries::const_iterator it = mEntries.begin();
+                it != mEntries.end();
+                ++it) {
+            if (*it) {
+                (*it)->Clear();
+            }
+        }
+        mCount = 0;
+    }
+    int64_t GetCount() const
+        { return mCount; }
+    const Histogram* Find(
+        int idx,
+        int phase) const
+    {
+        const Entry* const entry = mEntries[idx];
+        return (entry ? entry->Find(phase) : 0);
+    }
+    static const char* GetPhaseName(
+        int phase)
+    {
+        static const char* const kNames[kPhaseCount] = {
+            "queue",
+            "log",
+            "process",
+            "wait",
+            "response",
+            "total"
+        };
+        return ((phase < 0 || kPhaseCount <= phase) ? "" : kNames[phase]);
+    }
+    static ostream& DisplayCsvHeader(
+        ostream& os)
+    {
+        return (os <<
+            "Name,Phase,Count,Total,Min,Mean,P50,P90,P99,P99.9,Max,Buckets\n");
+    }
+    static ostream& DisplayCsv(
+        ostream&         os,
+        const char*      name,
+        int              nameIdx,
+        const char*      phase,
+        const Histogram& hist)
+    {
+        const char* const kDelim = ",";
+        os << name;
+        if (0 <= nameIdx) {
+            os << nameIdx;
+        }
+        os <<
+            kDelim << phase <<
+            kDelim << hist.GetCount() <<
+            kDelim << hist.GetTotal() <<
+            kDelim << hist.GetMin() <<
+            kDelim << hist.GetMean() <<
+            kDelim << hist.GetPercentile(50) <<
+            kDelim << hist.GetPercentile(90) <<
+            kDelim << hist.GetPercentile(99) <<
+            kDelim << hist.GetPercentile(99.9) <<
+            kDelim << hist.GetMax() <<
+            kDelim
+        ;
+        return hist.Display(os) << "\n";
+    }
+private:
+    class Entry
+    {
+    public:
+        Entry()
+        {
+            for (int i = 0; i < kPhaseCount; i++) {
+                mHistograms[i] = 0;
+            }
+        }
+        ~Entry()
+        {
+            for (int i = 0; i < kPhaseCount; i++) {
+                delete mHistograms[i];
+            }
+        }
+        Histogram& Get(
+            Phase phase)
+        {
+            if (! mHistograms[phase]) {
+                mHistograms[phase] = new Histogram();
+            }
+            return *mHistograms[phase];
+        }
+        const Histogram* Find(
+            int phase) const
+            { return mHistograms[phase]; }
+        void Clear()
+        {
+            for (int i = 0; i < kPhaseCount; i++) {
+                if (mHistograms[i]) {
+                    mHistograms[i]->Clear();
+                }
+            }
+        }
+    private:
+        Histogram* mHistograms[kPhaseCount];
+    private:
+        Entry(const Entry&);
+        Entry& operator=(const Entry&);
+    };
+    typedef vector<Entry*> Entries;
+
+    Entries mEntries;
+    int64_t mCount;
+private:
+    RequestHistograms(const RequestHistograms&);
+    RequestHistograms& operator=(const RequestHistograms&);
+};
+
+// Client thread histograms. Each client thread updates its own instance without
+// holding any locks, and periodically merges it into the request stats gatherer
+// while holding the dispatch mutex.
+class ClientThreadHistograms
+{
+public:
+    typedef LatencyHistogram Histogram;
+    enum
+    {
+        kRequestQueue  = 0,
+        kResponseQueue = 1,
+        kResponse      = 2,
+        kCount
+    };
+
+    ClientThreadHistograms(
+        int count)
+        : mRequests(count),
+          mCount(0)
+        {}
+    void ResponseSent(
+        int     idx,
+        int64_t usec)
+    {
+        mRequests.Add(0,   RequestHistograms::kPhaseResponse, usec);
+        mRequests.Add(idx, RequestHistograms::kPhaseResponse, usec);
+        mHistograms[kResponse].Add(usec);
+        mCount++;
+    }
+    void QueueDepth(
+        int     queue,
+        int64_t depth)
+    {
+        mHistograms[queue].Add(depth);
+        mCount++;
+    }
+    void MergeThread(
+        const ClientThreadHistograms& other)
+    {
+        for (int i = 0; i < kCount; i++) {
+            mHistograms[i].Merge(other.mHistograms[i]);
+        }
+        mCount += other.mCount;
+    }
+    void Clear()
+    {
+        for (int i = 0; i < kCount; i++) {
+            mHistograms[i].Clear();
+        }
+        mRequests.Clear();
+        mCount = 0;
+    }
+    int64_t GetCount() const
+        { return mCount; }
+    const RequestHistograms& GetRequests() const
+        { return mRequests; }
+    const Histogram& Get(
+        int queue) const
+        { return mHistograms[queue]; }
+    static const char* GetName(
+        int queue)
+    {
+        static const char* const kNames[kCount] = {
+            "request-queue-depth",
+            "response-queue-depth",
+            "response"
+        };
+        return ((queue < 0 || kCount <= queue) ? "" : kNames[queue]);
+    }
+private:
+    RequestHistograms mRequests;
+    Histogram         mHistograms[kCount];
+    int64_t           mCount;
+private:
+    ClientThreadHistograms(const ClientThreadHistograms&);
+    ClientThreadHistograms& operator=(const ClientThreadHistograms&);
+};
+
 class RequestStatsGatherer
 {
 public:
@@ -838,8 +1103,19 @@ public:
         static RequestStatsGatherer sRequestStatsGatherer;
         return sRequestStatsGatherer;
     }
-    void OpDone(
+    static int GetRequestIdx(
         const MetaRequest& op)
+    {
+        return ((op.op < 0 || op.op >= META_NUM_OPS_COUNT) ?
+                (int)kOtherReqId :
+            ((op.op == META_ALLOCATE &&
+                op.logAction == MetaRequest::kLogNever) ?
+                (int)kReqTypeAllocNoLog : (int)op.op + 1));
+    }
+    static int GetRequestTypesCount()
+        { return kReqTypesCnt; }
+    void OpDone(
+        MetaRequest& op)
     {
         if (! gNetDispatch.IsRunning()) {
             // Do not count RPCs during initialization restore / replay.
@@ -857,12 +1133,7 @@ public:
                 " was submitted: " << op.submitCount <<
             KFS_LOG_EOM;
         }
-        const int idx =
-            ((op.op < 0 || op.op >= META_NUM_OPS_COUNT) ?
-                (int)kOtherReqId :
-            ((op.op == META_ALLOCATE &&
-                op.logAction == MetaRequest::kLogNever) ?
-                (int)kReqTypeAllocNoLog : (int)op.op + 1));
+        const int     idx         = GetRequestIdx(op);
         const int64_t reqTime     = reqTimeUsec > 0 ? reqTimeUsec : 0;
         const int64_t reqProcTime =
             reqProcTimeUsec > 0 ? reqProcTimeUsec : 0;
@@ -876,6 +1147,9 @@ public:
             mRequest[  0].mErr++;
             mRequest[idx].mErr++;
         }
+        if (mHistogramsEnabledFlag) {
+            UpdateHistograms(op, idx, timeNowUsec, reqTime, reqProcTime);
+        }
         if (timeNowUsec < mNextTime) {
             return;
         }
@@ -942,7 +1216,86 @@ public:
             mLogLevel = logLevel;
         }
         mNextTime += mStatsIntervalMicroSec;
+        mHistogramsEnabledFlag = props.getValue(
+            "metaServer.statsGatherer.latencyHistograms",
+            mHistogramsEnabledFlag ? 1 : 0) != 0;
+    }
+    void ResponseSent(
+        const MetaRequest& op,
+        int64_t            usec)
+    {
+        const int idx = GetRequestIdx(op);
+        mHistograms.Add(0,   RequestHistograms::kPhaseResponse, usec);
+        mHistograms.Add(idx, RequestHistograms::kPhaseResponse, usec);
+    }
+    void Merge(
+        int                     threadIdx,
+        ClientThreadHistograms& histograms)
+    {
+        if (histograms.GetCount() <= 0) {
+            return;
+        }
+        if (mHistogramsEnabledFlag) {
+            mHistograms.Merge(histograms.GetRequests());
+            if ((int)mClientThreadHistograms.size() <= threadIdx) {
+                mClientThreadHistograms.resize(threadIdx + 1, 0);
+            }
+            ClientThreadHistograms*& dest =
+                mClientThreadHistograms[threadIdx];
+            if (! dest) {
+                dest = new ClientThreadHistograms(kReqTypesCnt);
+            }
+            dest->MergeThread(histograms);
+        }
+        histograms.Clear();
+    }
+    void GetHistogramsCsv(
+        ostream& os)
+    {
+        RequestHistograms::DisplayCsvHeader(os);
+        for (int i = 0; i < kCpuUser; i++) {
+            for (int k = 0; k < RequestHistograms::kPhaseCount; k++) {
+                const RequestHistograms::Histogram* const hist =
+                    mHistograms.Find(i, k);
+                if (hist && 0 < hist->GetCount()) {
+                    RequestHistograms::DisplayCsv(os, GetRowName(i), -1,
+                        RequestHistograms::GetPhaseName(k), *hist);
+                }
+            }
+        }
+        for (size_t i = 0; i < mClientThreadHistograms.size(); i++) {
+            const ClientThreadHistograms* const hists =
+                mClientThreadHistograms[i];
+            if (! hists) {
+                continue;
+            }
+            for (int k = 0; k < ClientThreadHistograms::kCount; k++) {
+                const ClientThreadHistograms::Histogram& hist = hists->Get(k);
+                if (0 < hist.GetCount()) {
+                    RequestHistograms::DisplayCsv(os, "CLIENT_THREAD_", (int)i,
+                        ClientThreadHistograms::GetName(k), hist);
+                }
+            }
+        }
     }
+    void GetHistogramsCsv(
+        IOBuffer& buf)
+    {
+        GetHistogramsCsv(mWOStream.Set(buf));
+        mWOStream.Reset();
+    }
+    void ResetHistograms()
+    {
+        mHistograms.Clear();
+        for (size_t i = 0; i < mClientThreadHistograms.size(); i++) {
+            if (mClientThreadHistograms[i]) {
+                mClientThreadHistograms[i]->Clear();
+            }
+        }
+        mHistogramsStartTime = microseconds();
+    }
+    int64_t GetHistogramsStartTime() const
+        { return mHistogramsStartTime; }
     void GetStatsCsv(
         ostream& os)
     {
@@ -1020,14 +1373,20 @@ private:
         int64_t mTime;
         int64_t mProcTime;
     };
-    int64_t             mNextTime;
-    int64_t             mStatsIntervalMicroSec;
-    int64_t             mOpTimeWarningThresholdMicroSec;
-    int64_t             mUserCpuMicroSec;
-    int64_t             mSystemCpuMicroSec;
-    MsgLogger::LogLevel mLogLevel;
-    Counter             mRequest[kReqTypesCnt];
-    IOBuffer::WOStream  mWOStream;
+    typedef vector<ClientThreadHistograms*> ClientThreadsHistograms;
+
+    int64_t                 mNextTime;
+    int64_t                 mStatsIntervalMicroSec;
+    int64_t                 mOpTimeWarningThresholdMicroSec;
+    int64_t                 mUserCpuMicroSec;
+    int64_t                 mSystemCpuMicroSec;
+    MsgLogger::LogLevel     mLogLevel;
+    Counter                 mRequest[kReqTypesCnt];
+    IOBuffer::WOStream      mWOStream;
+    bool                    mHistogramsEnabledFlag;
+    int64_t                 mHistogramsStartTime;
+    RequestHistograms       mHistograms;
+    ClientThreadsHistograms mClientThreadHistograms;
 
     RequestStatsGatherer()
         : mNextTime(0),
@@ -1036,8 +1395,52 @@ private:
           mUserCpuMicroSec(0),
           mSystemCpuMicroSec(0),
           mLogLevel(MsgLogger::kLogLevelNOTICE),
-          mWOStream()
+          mWOStream(),
+          mHistogramsEnabledFlag(false),
+          mHistogramsStartTime(microseconds()),
+          mHistograms(kReqTypesCnt),
+          mClientThreadHistograms()
         {}
+    ~RequestStatsGatherer()
+    {
+        for (size_t i = 0; i < mClientThreadHistograms.size(); i++) {
+            delete mClientThreadHistograms[i];
+        }
+    }
+    void UpdateHistograms(
+        MetaRequest& op,
+        int          idx,
+        int64_t      timeNowUsec,
+        int64_t      reqTime,
+        int64_t      reqProcTime)
+    {
+        const int64_t logTime  = max(int64_t(0), op.logTime);
+        const int64_t waitTime =
+            max(int64_t(0), reqTime - logTime - reqProcTime);
+        int64_t       total    = reqTime;
+        if (0 < op.recvTime) {
+            const int64_t queueTime =
+                max(int64_t(0), op.submitTime - op.recvTime);
+            total += queueTime;
+            AddHistogram(idx, RequestHistograms::kPhaseQueue, queueTime);
+        }
+        AddHistogram(idx, RequestHistograms::kPhaseLog,     logTime);
+        AddHistogram(idx, RequestHistograms::kPhaseProcess, reqProcTime);
+        AddHistogram(idx, RequestHistograms::kPhaseWait,    waitTime);
+        AddHistogram(idx, RequestHistograms::kPhaseTotal,   total);
+        if (op.fromClientSMFlag && op.clnt) {
+            // Response phase is measured by the client manager.
+            op.dispatchTime = timeNowUsec;
+        }
+    }
+    void AddHistogram(
+        int                      idx,
+        RequestHistograms::Phase phase,
+        int64_t                  usec)
+    {
+        mHistograms.Add(0,   phase, usec);
+        mHistograms.Add(idx, phase, usec);
+    }
 
     static const char* GetRowName(
         int idx)
@@ -1110,6 +1513,21 @@ void NetDispatch::GetStatsCsv(IOBuffer& buf)
     sReqStatsGatherer.GetStatsCsv(buf);
 }
 
+void NetDispatch::GetHistogramsCsv(IOBuffer& buf)
+{
+    sReqStatsGatherer.GetHistogramsCsv(buf);
+}
+
+void NetDispatch::ResetHistograms()
+{
+    sReqStatsGatherer.ResetHistograms();
+}
+
+int64_t NetDispatch::GetHistogramsStartTime() const
+{
+    return sReqStatsGatherer.GetHistogramsStartTime();
+}
+
 int64_t NetDispatch::GetUserCpuMicroSec() const
 {
     return sReqStatsGatherer.GetUserCpuMicroSec();
@@ -1565,7 +1983,10 @@ public:
           mFlushQueue(8 << 10),
           mAuthContext(),
           mAuthCtxUpdateCount(gLayoutManager.GetAuthCtxUpdateCount() - 1),
-          mNetManagerWatcher("client", mNetManager)
+          mNetManagerWatcher("client", mNetManager),
+          mIdx(-1),
+          mHistogramsMergeTime(0),
+          mHistograms(RequestStatsGatherer::GetRequestTypesCount())
     {
         gLayoutManager.UpdateClientAuthContext(
             mAuthCtxUpdateCount, mAuthContext);
@@ -1580,12 +2001,13 @@ public:
         ClientThread::DispatchStart();
         assert(mCliQueue.IsEmpty());
     }
-    bool Start(QCMutex* mutex, int cpuIndex)
+    bool Start(QCMutex* mutex, int cpuIndex, int idx)
     {
         if (mThread.IsStarted()) {
             return true;
         }
         mMutex = mutex;
+        mIdx   = idx;
         const int kStackSize = 384 << 10;
         const int err = mThread.TryToStart(
             this, kStackSize, "ClientThread",
@@ -1627,8 +2049,18 @@ public:
         assert(mReqPendingQueue.IsEmpty());
         // Dispatch requests.
         MetaRequest* op;
+        int64_t      reqCount = 0;
         while ((op = reqPendingQueue.PopFront())) {
             submit_request(op);
+            reqCount++;
+        }
+        if (0 < reqCount) {
+            mHistograms.QueueDepth(Histograms::kRequestQueue, reqCount);
+        }
+        const time_t now = mNetManager.Now();
+        if (mHistogramsMergeTime != now) {
+            mHistogramsMergeTime = now;
+            sReqStatsGatherer.Merge(mIdx, mHistograms);
         }
         MetaRequest::GetLogWriter().ScheduleFlush();
         gNetDispatch.ForkDone();
@@ -1647,7 +2079,9 @@ public:
         // attempting to send multiple responses with single write call.
         FlushQueue::iterator it = mFlushQueue.begin();
         NetConnectionPtr conn;
+        int64_t          respCount = 0;
         while ((op = reqQueue.PopFront())) {
+            respCount++;
             op->next = op; // Mark op, for the client manager's dispatch.
             const NetConnectionPtr& cn = GetConnection(*op);
             if (cn && ! cn->IsWriteReady()) {
@@ -1675,6 +2109,9 @@ public:
             (*cit)->StartFlush();
             cit->reset();
         }
+        if (0 < respCount) {
+            mHistograms.QueueDepth(Histograms::kResponseQueue, respCount);
+        }
         // Add new connections to the net manager.
         const bool runningFlag = mNetManager.IsRunning();
         ClientSM*  cli;
@@ -1748,6 +2185,11 @@ public:
         { return mAuthContext; }
     bool IsPrimary() const
         { return mPrimaryFlag; }
+    void ResponseSent(const MetaRequest& op, int64_t usec)
+    {
+        mHistograms.ResponseSent(
+            RequestStatsGatherer::GetRequestIdx(op), usec);
+    }
 private:
     class CliAccessor
     {
@@ -1758,6 +2200,7 @@ private:
     typedef vector<NetConnectionPtr>                             FlushQueue;
     typedef SingleLinkedQueue<MetaRequest, MetaRequest::GetNext> ReqQueue;
     typedef SingleLinkedQueue<ClientSM,    CliAccessor>          CliQueue;
+    typedef ClientThreadHistograms                               Histograms;
 
     QCMutex*           mMutex;
     QCThread           mThread;
@@ -1771,6 +2214,9 @@ private:
     uint64_t           mAuthCtxUpdateCount;
     bool               mPrimaryFlag;
     NetManagerWatcher  mNetManagerWatcher;
+    int                mIdx;
+    time_t             mHistogramsMergeTime;
+    Histograms         mHistograms;
     char               mParseBuffer[MAX_RPC_HEADER_LEN];
 
     const NetConnectionPtr& GetConnection(MetaRequest& op)
@@ -1820,7 +2266,7 @@ ClientManager::Impl::StartAcceptor(int threadCount, int startCpuAffinity,
         int cpuIndex = startCpuAffinity;
         mClientThreads = new ClientManager::ClientThread[mClientThreadCount];
         for (int i = 0; i < mClientThreadCount; i++) {
-            if (! mClientThreads[i].Start(&mMutex, cpuIndex)) {
+            if (! mClientThreads[i].Start(&mMutex, cpuIndex, i)) {
                 delete [] mClientThreads;
                 mClientThreads     = 0;
                 mClientThreadCount = -1;
@@ -1989,6 +2435,18 @@ ClientManager::SubmitRequestSelf(ClientManager::ClientThread* thread,
     thread->Add(op);
 }
 
+/* static */ void
+ClientManager::ResponseSentSelf(ClientManager::ClientThread* thread,
+    const MetaRequest& op)
+{
+    const int64_t usec = max(int64_t(0), microseconds() - op.dispatchTime);
+    if (thread) {
+        thread->ResponseSent(op, usec);
+    } else {
+        sReqStatsGatherer.ResponseSent(op, usec);
+    }
+}
+
 /* static */ AuthContext&
 ClientManager::GetAuthContext(ClientThread* inThread)
 {
@@ -68,6 +68,9 @@ public:
     void GetStatsCsv(IOBuffer& buf);
     int64_t GetUserCpuMicroSec() const;
     int64_t GetSystemCpuMicroSec() const;
+    void GetHistogramsCsv(IOBuffer& buf);
+    void ResetHistograms();
+    int64_t GetHistogramsStartTime() const;
     QCMutex* GetMutex() const { return mMutex; }
     QCMutex* GetClientManagerMutex() const { return mClientManagerMutex; }
     const CryptoKeys& GetCryptoKeys() const { return mCryptoKeys; }
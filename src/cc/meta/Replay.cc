@@ -2436,6 +2436,33 @@ Replay::playLogs(bool includeLastLogFlag)
         playLogs(lastLogNum, includeLastLogFlag) : status);
 }
 
+int
+Replay::playLogsThrough(seq_t lastlog)
+{
+    if (number < 0 || lastlog < number) {
+        KFS_LOG_STREAM_ERROR <<
+            "invalid last log segment: " << lastlog <<
+            " checkpoint log segment: "  << number <<
+        KFS_LOG_EOM;
+        return -EINVAL;
+    }
+    gLayoutManager.SetPrimary(false);
+    gLayoutManager.StopServicing();
+    const int status = getLastLogNum();
+    if (0 != status) {
+        return status;
+    }
+    if (lastLogNum < lastlog) {
+        KFS_LOG_STREAM_ERROR <<
+            "log segment: "                    << lastlog <<
+            " is not complete, last complete: " << lastLogNum <<
+        KFS_LOG_EOM;
+        return -EINVAL;
+    }
+    const bool kIncludeLastLogFlag = false;
+    return playLogs(lastlog, kIncludeLastLogFlag);
+}
+
 int
 Replay::playLogs(seq_t last, bool includeLastLogFlag)
 {
@@ -2868,11 +2895,13 @@ Replay::runCommitQueue(
 }
 
 bool
-Replay::commitAll()
+Replay::commitAll(bool setPrimaryFlag)
 {
     ReplayState&               state = replayTokenizer.GetState();
     ReplayState::EnterAndLeave enterAndLeave(state);
-    gLayoutManager.SetPrimary(true);
+    if (setPrimaryFlag) {
+        gLayoutManager.SetPrimary(true);
+    }
     return replayTokenizer.GetState().commitAll();
 }
 
@@ -65,6 +65,9 @@ public:
     //!< starting from log for logno(),
     //!< replay all logs we have in the logdir.
     int playAllLogs() { return playLogs(true); }
+    //!< replay complete log segments up to and including the specified
+    //!< log segment, used by incremental checkpoint compaction.
+    int playLogsThrough(seq_t lastlog);
     bool getAppendToLastLogFlag() const { return appendToLastLogFlag; }
     int getLastLogIntBase() const { return lastLogIntBase; }
     inline void setRollSeeds(int64_t roll);
@@ -124,7 +127,7 @@ public:
         seq_t               seed,
         int64_t             status,
         int64_t             errChecksum);
-    bool commitAll();
+    bool commitAll(bool setPrimaryFlag = true);
     bool submit(MetaRequest& req)
         { return (enqueueFlag && enqueue(req)); }
     vrNodeId_t getPrimaryNodeId() const
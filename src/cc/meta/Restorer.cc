@@ -32,6 +32,7 @@
 #include "Restorer.h"
 #include "DiskEntry.h"
 #include "Checkpoint.h"
+#include "CheckpointCompressor.h"
 #include "LayoutManager.h"
 #include "NetDispatch.h"
 #include "LogWriter.h"
@@ -970,12 +971,11 @@ Restorer::rebuild(const string& cpname, int16_t minReplicas)
     }
     sMinReplicasPerFile     = minReplicas;
     sVrSequenceRequiredFlag = mVrSequenceRequiredFlag;
-    ifstream file;
-    file.open(cpname.c_str(), ifstream::binary | ifstream::in);
-    if (file.fail()) {
-        const int err = errno;
+    CheckpointInputStream file;
+    const int err = file.open(cpname.c_str());
+    if (err != 0) {
         KFS_LOG_STREAM_FATAL <<
-            cpname << ": " << QCUtils::SysError(err) <<
+            cpname << ": " << QCUtils::SysError(-err) <<
         KFS_LOG_EOM;
         return false;
     }
@@ -1007,7 +1007,7 @@ Restorer::rebuild(const string& cpname, int16_t minReplicas)
             break;
         }
     }
-    if (is_ok && ! file.eof()) {
+    if (is_ok && (! file.eof() || file.bad())) {
         KFS_LOG_STREAM_FATAL <<
             "error " << cpname << ":" << tokenizer.getEntryCount() <<
             ":" << tokenizer.getEntry() <<
@@ -23,6 +23,13 @@
 //
 // \brief Convert prior versions of checkpoints and log by loading checkpoint,
 // replaying all log segments, then writing new checkpoint and log segment.
+// In incremental mode create new checkpoint by loading the base checkpoint,
+// and replaying complete log segments up to and including the specified
+// segment. The meta server uses this mode in order to avoid fork based
+// checkpoint write. The log segments are the "delta" between the base and new
+// checkpoints. The compactor builds the complete file system tree in memory,
+// and writes the complete checkpoint, therefore its memory use is about the
+// same as the meta server's file system tree memory use.
 //
 //----------------------------------------------------------------------------
 
@@ -32,12 +39,14 @@
 #include "Replay.h"
 #include "MetaRequest.h"
 #include "LogWriter.h"
+#include "CheckpointCompressor.h"
 #include "util.h"
 
 #include "common/MsgLogger.h"
 #include "common/MdStream.h"
 #include "qcdio/QCUtils.h"
 #include "kfsio/CryptoKeys.h"
+#include "kfsio/ProcessRestarter.h"
 
 #include <sys/stat.h>
 #include <errno.h>
@@ -52,6 +61,77 @@ namespace KFS
 using std::cout;
 using std::cerr;
 
+static int
+CompactIncremental(
+    const string& lockFn,
+    seq_t         lastLogNum,
+    const string& nextLogName,
+    int64_t       maxWriteRate,
+    bool          writeSyncFlag)
+{
+    const bool kAllowEmptyCheckpointFlag = false;
+    int status = restore_checkpoint(lockFn, kAllowEmptyCheckpointFlag);
+    if (0 != status) {
+        KFS_LOG_STREAM_FATAL <<
+            "checkpoint load failure: " << QCUtils::SysError(-status) <<
+        KFS_LOG_EOM;
+        return status;
+    }
+    if ((status = replayer.playLogsThrough(lastLogNum)) != 0) {
+        KFS_LOG_STREAM_FATAL <<
+            "log segments replay failure: " << QCUtils::SysError(-status) <<
+        KFS_LOG_EOM;
+        return status;
+    }
+    // The meta server starts the compactor after all records of the closed
+    // log segment are committed, but the commit record of the segment's last
+    // block is written into the next segment. Commit the remaining records.
+    const bool kSetPrimaryFlag = false;
+    if (replayer.getCommitted() < replayer.getLastLogSeq() &&
+            ! replayer.commitAll(kSetPrimaryFlag)) {
+        KFS_LOG_STREAM_FATAL <<
+            "log segment: "  << lastLogNum <<
+            " commit failure" <<
+        KFS_LOG_EOM;
+        return -EINVAL;
+    }
+    if (replayer.getCommitted() != replayer.getLastLogSeq()) {
+        KFS_LOG_STREAM_FATAL <<
+            "log segment: "  << lastLogNum <<
+            " committed: "   << replayer.getCommitted() <<
+            " last log: "    << replayer.getLastLogSeq() <<
+            " has uncommitted log records" <<
+        KFS_LOG_EOM;
+        return -EINVAL;
+    }
+    if (replayer.getCommitted() == replayer.getCheckpointCommitted()) {
+        KFS_LOG_STREAM_INFO <<
+            "no log records since checkpoint: " <<
+                replayer.getCheckpointCommitted() <<
+        KFS_LOG_EOM;
+        return Checkpoint::kNoLogRecordsExitStatus;
+    }
+    metatree.disableFidToPathname();
+    metatree.setUpdatePathSpaceUsage(true);
+    cp.setWriteSyncFlag(writeSyncFlag);
+    cp.setMaxWriteRate(maxWriteRate);
+    if ((status = cp.write(
+            nextLogName,
+            replayer.getCommitted(),
+            replayer.getErrChksum())) != 0) {
+        KFS_LOG_STREAM_FATAL <<
+            "checkpoint write failure: " << QCUtils::SysError(-status) <<
+        KFS_LOG_EOM;
+    } else {
+        KFS_LOG_STREAM_INFO <<
+            "checkpoint: " << replayer.getCheckpointCommitted() <<
+            " => "         << replayer.getCommitted() <<
+            " "            << cp.name() <<
+        KFS_LOG_EOM;
+    }
+    return status;
+}
+
 static int
 LogCompactorMain(int argc, char** argv)
 {
@@ -66,9 +146,43 @@ LogCompactorMain(int argc, char** argv)
     bool    wormModeFlag    = false;
     bool    setWormModeFlag = false;
     int     status          = 0;
+    seq_t   lastLogNum      = -1;
+    string  nextLogName;
+    int64_t maxWriteRate    = 0;
+    int     compressionLevel = -1;
+    bool    writeSyncFlag   = true;
+    int     timeLimitSec    = 0;
+    int     countersFd      = -1;
 
-    while ((optchar = getopt(argc, argv, "hpl:c:r:L:T:C:W:")) != -1) {
+    while ((optchar = getopt(argc, argv, "hpl:c:r:L:T:C:W:i:n:R:z:s:t:S")) != -1) {
         switch (optchar) {
+            case 'i':
+                lastLogNum = (seq_t)atoll(optarg);
+                if (lastLogNum < 0) {
+                    status = 1;
+                }
+                break;
+            case 'n':
+                nextLogName = optarg;
+                break;
+            case 'R':
+                maxWriteRate = (int64_t)atoll(optarg);
+                break;
+            case 'z':
+                compressionLevel = atoi(optarg);
+                if (9 < compressionLevel) {
+                    status = 1;
+                }
+                break;
+            case 's':
+                writeSyncFlag = 0 != atoi(optarg);
+                break;
+            case 't':
+                timeLimitSec = atoi(optarg);
+                break;
+            case 'S':
+                countersFd = 3;
+                break;
             case 'L':
                 lockFn = optarg;
                 break;
@@ -108,7 +222,11 @@ LogCompactorMain(int argc, char** argv)
                 break;
         }
     }
-    if (newLogDir.empty() || newCpDir.empty()) {
+    if (0 <= lastLogNum ?
+            (nextLogName.empty() || ! newLogDir.empty() ||
+                ! newCpDir.empty() || 0 < numReplicasPerFile ||
+                setWormModeFlag) :
+            (newLogDir.empty() || newCpDir.empty() || 0 <= countersFd)) {
         status = 1;
     }
     if (help || 0 != status) {
@@ -121,6 +239,16 @@ LogCompactorMain(int argc, char** argv)
                 " converting from prior format]\n"
             "-T <new log directroy> -- requires -C\n"
             "-C <new checkpoint directroy> -- requires -T\n"
+            "[-i <last log segment number> -- incremental mode, requires -n]\n"
+            "[-n <next log segment name> -- checkpoint log segment name]\n"
+            "[-R <max checkpoint write rate bytes per second> (default 0 --"
+                " unlimited)]\n"
+            "[-z <checkpoint gzip compression level 0-9> (default -1 --"
+                " no compression)]\n"
+            "[-s {0|1} -- synchronous checkpoint write (default 1)]\n"
+            "[-t <time limit sec> -- incremental mode time limit]\n"
+            "[-S -- incremental mode, write checkpoint compression counters"
+                " into descriptor 3]\n"
             "-T and -C are intended for log and checkpoint conversion from prior"
             " versions. With these options log compactor reads all log segments,"
             " including the last partial segment, then writes checkpoint, and"
@@ -130,11 +258,50 @@ LogCompactorMain(int argc, char** argv)
             " replaying all log segments except last partial segment is"
             " no longer supported, with new log ahead format. This mode is no"
             " longer required as meta server now writes checkpoints.\n"
+            "With -i log compactor loads the latest checkpoint from the"
+            " checkpoint directory, replays complete log segments up to and"
+            " including the specified segment, and writes new checkpoint into"
+            " the same checkpoint directory. The log segment must end with"
+            " committed log record. The meta server uses this mode with"
+            " incremental checkpoint enabled. Exit status " <<
+                Checkpoint::kNoLogRecordsExitStatus <<
+            " means that there are no log records since the latest"
+            " checkpoint, and no checkpoint was written.\n"
         ;
         return (0 == status ? 0 : 1);
     }
+    if (0 <= lastLogNum) {
+        // Close descriptors inherited from the meta server.
+        ProcessRestarter::CloseFds(countersFd < 0 ? 3 : countersFd + 1);
+        if (0 < timeLimitSec) {
+            alarm(timeLimitSec);
+        }
+    }
     MdStream::Init();
     MsgLogger::Init(0, MsgLogger::kLogLevelINFO);
+    cp.setCompressionLevel(compressionLevel);
+    if (0 <= lastLogNum) {
+        checkpointer_setup_paths(cpdir);
+        replayer.setLogDir(logdir.c_str());
+        status = CompactIncremental(lockFn, lastLogNum, nextLogName,
+            maxWriteRate, writeSyncFlag);
+        if (0 == status && 0 <= countersFd) {
+            const int err =
+                CheckpointCompressor::WriteCompressCounters(countersFd);
+            if (0 != err) {
+                KFS_LOG_STREAM_ERROR <<
+                    "compression counters write failure: " <<
+                        QCUtils::SysError(-err) <<
+                KFS_LOG_EOM;
+            }
+        }
+        MsgLogger::Stop();
+        MdStream::Cleanup();
+        // Do not attempt graceful exit, the process is started by the meta
+        // server, and the tree can be large.
+        _exit((status == 0 || status == Checkpoint::kNoLogRecordsExitStatus) ?
+            status : 1);
+    }
     struct stat       st[2] = { {0}, {0} };
     const char* const nm[2] = { newLogDir.c_str(), newCpDir.c_str() };
     for (int i = 0; i < 2; i++) {
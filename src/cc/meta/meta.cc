@@ -209,7 +209,8 @@ typedef LinearHash<
         MetaFattrExtEntry,
         size_t(1)   << 20, // size_t TMinStorageAlloc,
         size_t(128) << 20, // size_t TMaxStorageAlloc,
-        false              // bool   TForceCleanupFlag
+        false,             // bool   TForceCleanupFlag
+        MemoryAccounting::kSubsystemTreeNodes
     >
 > MetaFattrExtAttributes;
 
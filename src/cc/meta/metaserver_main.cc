@@ -587,6 +587,17 @@ MetaServer::SetParameters(const Properties& props)
            "metaServer.resolverCacheExpiration",
             globalNetManager().GetResolverCacheExpiration())
     );
+    globalNetManager().SetResolverCacheParameters(
+        props.getValue(
+            "metaServer.resolverNegativeCacheExpiration",
+            globalNetManager().GetResolverNegativeCacheExpiration()),
+        props.getValue(
+            "metaServer.resolverCacheRefreshAhead",
+            globalNetManager().GetResolverCacheRefreshAhead()),
+        props.getValue(
+            "metaServer.resolverThreadCount",
+            globalNetManager().GetResolverThreadCount())
+    );
     if (mLogWriterRunningFlag) {
         MetaLogWriterControl* const op = new MetaLogWriterControl(
             MetaLogWriterControl::kSetParameters);
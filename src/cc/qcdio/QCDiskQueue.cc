@@ -42,6 +42,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <dirent.h>
+#include <time.h>
 
 #ifdef QC_OS_NAME_DARWIN
 #include <sys/param.h>
@@ -67,6 +68,7 @@ public:
           mThreadsPtr(0),
           mBuffersPtr(0),
           mRequestsPtr(0),
+          mElevatorPosPtr(0),
           mFdPtr(0),
           mFilePendingReqCountPtr(0),
           mIoVecPtr(0),
@@ -92,12 +94,25 @@ public:
           mIoStartObserverPtr(0),
           mRequestProcessorsPtr(0),
           mNextThreadIdx(0),
+          mQosActiveCount(0),
+          mQosVirtualTime(0),
+          mScheduler(kSchedulerFifo),
           mCreateExclusiveFlag(true),
           mRunFlag(false),
           mRequestAffinityFlag(false),
           mSerializeMetaRequestsFlag(true),
           mBarrierFlag(false)
-        {}
+    {
+        for (int i = 0; i < kQosClassCount; i++) {
+            mQosPendingCount[i] = 0;
+            mQosCost[i]         = kQosCostScale;
+            mQosTag[i]          = 0;
+        }
+        mDeadlines[kPriorityHigh]   = Time(50)    * 1000 * 1000;
+        mDeadlines[kPriorityNormal] = Time(200)   * 1000 * 1000;
+        mDeadlines[kPriorityLow]    = Time(2000)  * 1000 * 1000;
+        mDeadlines[kPriorityIdle]   = Time(10000) * 1000 * 1000;
+    }
     virtual ~Queue()
         { Queue::Stop(); }
     inline void Done(
@@ -138,7 +153,9 @@ public:
         int            inBufferCount,
         IoCompletion*  inIoCompletionPtr,
         Time           inTimeWaitNanoSec,
-        int64_t        inEofHint);
+        int64_t        inEofHint,
+        int            inQosClass,
+        Priority       inPriority);
     bool Cancel(
         RequestId inRequestId);
     IoCompletion* CancelOrSetCompletionIfInFlight(
@@ -169,6 +186,31 @@ public:
     void CloseAllFiles();
     int GetBlockSize() const
         { return mBlockSize; }
+    void SetQosWeights(
+        const int* inWeightsPtr,
+        int        inCount)
+    {
+        QCStMutexLocker theLocker(mMutex);
+        for (int i = 0; i < kQosClassCount; i++) {
+            const int theWeight = (inWeightsPtr && i < inCount) ?
+                Min(int(kQosCostScale), Max(1, inWeightsPtr[i])) : 1;
+            mQosCost[i] = kQosCostScale / theWeight;
+        }
+    }
+    void SetScheduler(
+        Scheduler   inScheduler,
+        const Time* inDeadlinesNanoSecPtr,
+        int         inCount)
+    {
+        QCStMutexLocker theLocker(mMutex);
+        mScheduler = inScheduler;
+        for (int i = 0; inDeadlinesNanoSecPtr &&
+                i < Min(int(kPriorityCount), inCount); i++) {
+            if (0 <= inDeadlinesNanoSecPtr[i]) {
+                mDeadlines[i] = inDeadlinesNanoSecPtr[i];
+            }
+        }
+    }
     EnqueueStatus CheckOpenStatus(
         FileIdx       inFileIdx,
         IoCompletion* inIoCompletionPtr,
@@ -254,9 +296,13 @@ private:
               mReqType(kReqTypeNone),
               mInFlightFlag(false),
               mFreeBuffersIfNoIoCompletionFlag(false),
+              mQosQueuedFlag(false),
+              mQosClass(0),
+              mPriority(kPriorityNormal),
               mBufferCount(0),
               mFileIdx(0),
               mBlockIdx(0),
+              mDeadline(0),
               mIoCompletionPtr(0)
             {}
         ~Request()
@@ -270,9 +316,13 @@ private:
         ReqType       mReqType:8;
         bool          mInFlightFlag:1;
         bool          mFreeBuffersIfNoIoCompletionFlag:1;
+        bool          mQosQueuedFlag:1;
+        unsigned int  mQosClass:8;
+        unsigned int  mPriority:2;
         int           mBufferCount;
         uint64_t      mFileIdx:16;
         uint64_t      mBlockIdx:48;
+        Time          mDeadline;
         IoCompletion* mIoCompletionPtr;
     };
 
@@ -446,6 +496,7 @@ private:
     IoThread*          mThreadsPtr;
     char**             mBuffersPtr;
     Request*           mRequestsPtr;
+    uint64_t*          mElevatorPosPtr;
     int*               mFdPtr;
     unsigned int*      mFilePendingReqCountPtr;
     struct iovec*      mIoVecPtr;
@@ -471,6 +522,13 @@ private:
     IoStartObserver*   mIoStartObserverPtr;
     RequestProcessor** mRequestProcessorsPtr;
     int                mNextThreadIdx;
+    int                mQosActiveCount;
+    int                mQosPendingCount[kQosClassCount];
+    int64_t            mQosCost[kQosClassCount];
+    int64_t            mQosTag[kQosClassCount];
+    int64_t            mQosVirtualTime;
+    Scheduler          mScheduler;
+    Time               mDeadlines[kPriorityCount];
     bool               mCreateExclusiveFlag;
     bool               mRunFlag;
     bool               mRequestAffinityFlag;
@@ -484,6 +542,8 @@ private:
         kIoQueueIdx   = 1,
         kRequestQueueCount
     };
+    enum { kQosMaxScanCount = 64 };
+    enum { kQosCostScale = 1 << 16 };
     enum
     {
         kFreeFdOffset  = 2,
@@ -612,6 +672,8 @@ private:
         inReq.mInFlightFlag    = false;
         inReq.mIoCompletionPtr = 0;
         inReq.mBufferCount     = 0;
+        inReq.mQosClass        = 0;
+        inReq.mPriority        = kPriorityNormal;
         Insert(mRequestsPtr[kFreeQueueIdx], inReq);
         if (mReqWaitersCount > 0) {
             QCASSERT(mFreeCount > 0);
@@ -664,6 +726,11 @@ private:
     {
         Trace("enqueue", inReq);
         Insert(mRequestsPtr[kIoQueueIdx + inThreadIdx], inReq);
+        inReq.mDeadline = Now() + mDeadlines[inReq.mPriority];
+        inReq.mQosQueuedFlag = true;
+        if (mQosPendingCount[inReq.mQosClass]++ == 0) {
+            mQosActiveCount++;
+        }
         mPendingCount++;
         mFilePendingReqCountPtr[inReq.mFileIdx]++;
         if (inReq.mReqType == kReqTypeRead) {
@@ -678,15 +745,145 @@ private:
     Request* Dequeue(
         int inThreadIdx)
     {
-        Request* const theReqPtr = Front(kIoQueueIdx + inThreadIdx);
+        const RequestIdx theQueueIdx = kIoQueueIdx + inThreadIdx;
+        Request*         theReqPtr   = Front(theQueueIdx);
         if (theReqPtr) {
+            if (! theReqPtr->IsBarrier()) {
+                if (mScheduler != kSchedulerFifo) {
+                    theReqPtr = SchedulerSelect(theQueueIdx, *theReqPtr);
+                } else if (1 < mQosActiveCount) {
+                    theReqPtr = QosSelect(theQueueIdx, *theReqPtr);
+                }
+            }
+            QosDispatch(*theReqPtr);
+            if (mScheduler == kSchedulerElevator) {
+                mElevatorPosPtr[inThreadIdx] = ElevatorPos(*theReqPtr) +
+                    uint64_t(Max(0, theReqPtr->mBufferCount));
+            }
             RemoveWithSubRequests(*theReqPtr);
         }
         return theReqPtr;
     }
+    static Time Now()
+    {
+        struct timespec theTs = { 0, 0 };
+        clock_gettime(CLOCK_MONOTONIC, &theTs);
+        return (Time(theTs.tv_sec) * 1000 * 1000 * 1000 + theTs.tv_nsec);
+    }
+    static uint64_t ElevatorPos(
+        const Request& inReq)
+    {
+        return ((uint64_t(inReq.mFileIdx) << kBlockBitCount) |
+            uint64_t(inReq.mBlockIdx));
+    }
+    // Deadline and elevator schedulers. Dispatch the request with the
+    // earliest expired deadline, if any, otherwise the request with the
+    // highest priority, and with the smallest QoS start tag or elevator
+    // distance. The look ahead stops at the first barrier request.
+    Request* SchedulerSelect(
+        RequestIdx inQueueIdx,
+        Request&   inFront)
+    {
+        const bool     theElevatorFlag = mScheduler == kSchedulerElevator;
+        const uint64_t theHeadPos      =
+            mElevatorPosPtr[inQueueIdx - kIoQueueIdx];
+        const Time     theNow          = Now();
+        Request*       theExpiredPtr   = 0;
+        Request*       theBestPtr      = 0;
+        uint64_t       theBestKey      = 0;
+        int            theScanCount    = 0;
+        for (RequestIdx theIdx = &inFront - mRequestsPtr;
+                theIdx != inQueueIdx && theScanCount < kQosMaxScanCount;
+                theIdx = mRequestsPtr[theIdx].mNextIdx) {
+            Request& theReq = mRequestsPtr[theIdx];
+            if (theReq.mReqType == kReqTypeNone) {
+                continue; // Sub request.
+            }
+            if (theReq.IsBarrier()) {
+                break;
+            }
+            theScanCount++;
+            if (theReq.mDeadline <= theNow) {
+                if (! theExpiredPtr ||
+                        theReq.mDeadline < theExpiredPtr->mDeadline) {
+                    theExpiredPtr = &theReq;
+                }
+                continue;
+            }
+            if (theExpiredPtr) {
+                continue;
+            }
+            // Elevator distance has 64 bits, and its most significant bits
+            // are file index, therefore the priority is compared first.
+            const uint64_t theKey = theElevatorFlag ?
+                ElevatorPos(theReq) - theHeadPos :
+                uint64_t(QosStartTag(theReq.mQosClass));
+            if (! theBestPtr || theReq.mPriority < theBestPtr->mPriority ||
+                    (theReq.mPriority == theBestPtr->mPriority &&
+                        theKey < theBestKey)) {
+                theBestPtr = &theReq;
+                theBestKey = theKey;
+            }
+        }
+        return (theExpiredPtr ? theExpiredPtr :
+            (theBestPtr ? theBestPtr : &inFront));
+    }
+    int64_t QosStartTag(
+        int inQosClass) const
+        { return Max(mQosTag[inQosClass], mQosVirtualTime); }
+    // Start time fair queuing: pick the oldest request of the class with the
+    // smallest start tag. The look ahead stops at the first barrier request,
+    // in order to preserve the barrier semantics.
+    Request* QosSelect(
+        RequestIdx inQueueIdx,
+        Request&   inFront)
+    {
+        Request*     theBestPtr   = &inFront;
+        int64_t      theBestTag   = QosStartTag(inFront.mQosClass);
+        unsigned int theSeenMask  = 1u << inFront.mQosClass;
+        int          theScanCount = 0;
+        for (RequestIdx theIdx = inFront.mNextIdx;
+                theIdx != inQueueIdx && theScanCount < kQosMaxScanCount;
+                theIdx = mRequestsPtr[theIdx].mNextIdx) {
+            Request& theReq = mRequestsPtr[theIdx];
+            if (theReq.mReqType == kReqTypeNone) {
+                continue; // Sub request.
+            }
+            if (theReq.IsBarrier()) {
+                break;
+            }
+            theScanCount++;
+            const unsigned int theBit = 1u << theReq.mQosClass;
+            if ((theSeenMask & theBit) != 0) {
+                continue;
+            }
+            theSeenMask |= theBit;
+            const int64_t theTag = QosStartTag(theReq.mQosClass);
+            if (theTag < theBestTag) {
+                theBestTag = theTag;
+                theBestPtr = &theReq;
+            }
+        }
+        return theBestPtr;
+    }
+    void QosDispatch(
+        const Request& inReq)
+    {
+        const int     theClass = inReq.mQosClass;
+        const int64_t theStart = QosStartTag(theClass);
+        mQosVirtualTime   = theStart;
+        mQosTag[theClass] = theStart +
+            Max(1, inReq.mBufferCount) * mQosCost[theClass];
+    }
     void RemoveWithSubRequests(
         Request& inReq)
     {
+        if (inReq.mQosQueuedFlag) {
+            inReq.mQosQueuedFlag = false;
+            if (--mQosPendingCount[inReq.mQosClass] == 0) {
+                mQosActiveCount--;
+            }
+        }
         // If there are more than one "sub request" then the list head has
         // buffer count larger than request max buffers per request.
         int      theBufCount = inReq.mBufferCount;
@@ -1029,6 +1226,8 @@ QCDiskQueue::Queue::StopSelf()
     mRequestBufferCount = 0;
     delete [] mRequestsPtr;
     mRequestsPtr = 0;
+    delete [] mElevatorPosPtr;
+    mElevatorPosPtr = 0;
     delete [] mPendingCloseHeadPtr;
     mPendingCloseHeadPtr = 0;
     mPendingCloseTailPtr = 0;
@@ -1180,6 +1379,12 @@ QCDiskQueue::Queue::Start(
         (mRequestAffinityFlag ? inThreadCount - 1 : 0);
     const int theReqCnt = mRequestQueueCount + inMaxQueueDepth;
     mRequestsPtr = new Request[theReqCnt];
+    // Elevator scheduler position, the end of the last dispatched request,
+    // per io queue.
+    mElevatorPosPtr = new uint64_t[mRequestQueueCount - kIoQueueIdx];
+    for (int i = kIoQueueIdx; i < mRequestQueueCount; i++) {
+        mElevatorPosPtr[i - kIoQueueIdx] = 0;
+    }
     // Init list heads: kFreeQueueIdx kIoQueueIdx.
     for (mTotalCount = 0; mTotalCount < mRequestQueueCount; mTotalCount++) {
         Init(mRequestsPtr[mTotalCount]);
@@ -1214,9 +1419,13 @@ QCDiskQueue::Queue::Enqueue(
     int                         inBufferCount,
     QCDiskQueue::IoCompletion*  inIoCompletionPtr,
     QCDiskQueue::Time           inTimeWaitNanoSec,
-    int64_t                     inEofHint)
+    int64_t                     inEofHint,
+    int                         inQosClass,
+    QCDiskQueue::Priority       inPriority)
 {
     if ((inReqType != kReqTypeRead && ! IsWriteReqType(inReqType)) ||
+            inQosClass < 0 || kQosClassCount <= inQosClass ||
+            inPriority < kPriorityHigh || kPriorityCount <= inPriority ||
             inBufferCount <= 0 ||
             inBufferCount > (mRequestBufferCount *
                 (mTotalCount - mRequestQueueCount)) ||
@@ -1254,6 +1463,8 @@ QCDiskQueue::Queue::Enqueue(
     theReq.mFileIdx         = inFileIdx;
     theReq.mBlockIdx        = inBlockIdx;
     theReq.mIoCompletionPtr = inIoCompletionPtr;
+    theReq.mQosClass        = inQosClass;
+    theReq.mPriority        = inPriority;
     if (inBufferIteratorPtr) {
         BuffersIterator theItr(*this, theReq, inBufferCount);
         for (int i = 0; i < inBufferCount; i++) {
@@ -2526,7 +2737,9 @@ QCDiskQueue::Enqueue(
     int                         inBufferCount,
     QCDiskQueue::IoCompletion*  inIoCompletionPtr,
     QCDiskQueue::Time           inTimeWaitNanoSec,
-    int64_t                     inEofHint)
+    int64_t                     inEofHint,
+    int                         inQosClass,
+    QCDiskQueue::Priority       inPriority)
 {
     if (! mQueuePtr) {
         return EnqueueStatus(kRequestIdNone, kErrorParameter);
@@ -2539,7 +2752,9 @@ QCDiskQueue::Enqueue(
         inBufferCount,
         inIoCompletionPtr,
         inTimeWaitNanoSec,
-        inEofHint);
+        inEofHint,
+        inQosClass,
+        inPriority);
 }
 
     bool
@@ -2728,6 +2943,27 @@ QCDiskQueue::GetBlockSize() const
     return (mQueuePtr ? mQueuePtr->GetBlockSize() : 0);
 }
 
+    void
+QCDiskQueue::SetQosWeights(
+    const int* inWeightsPtr,
+    int        inCount)
+{
+    if (mQueuePtr) {
+        mQueuePtr->SetQosWeights(inWeightsPtr, inCount);
+    }
+}
+
+    void
+QCDiskQueue::SetScheduler(
+    QCDiskQueue::Scheduler   inScheduler,
+    const QCDiskQueue::Time* inDeadlinesNanoSecPtr,
+    int                      inCount)
+{
+    if (mQueuePtr) {
+        mQueuePtr->SetScheduler(inScheduler, inDeadlinesNanoSecPtr, inCount);
+    }
+}
+
     QCDiskQueue::Status
 QCDiskQueue::AllocateFileSpace(
     QCDiskQueue::FileIdx inFileIdx)
@@ -95,6 +95,26 @@ public:
     };
 
     enum { kRequestIdNone = -1 };
+    // Number of the request QoS classes. Read and write requests are
+    // dispatched in weighted fair order across the classes, see
+    // SetQosWeights().
+    enum { kQosClassCount = 8 };
+    // Read and write request dispatch order within a queue, see
+    // SetScheduler().
+    enum Scheduler
+    {
+        kSchedulerFifo     = 0,
+        kSchedulerDeadline = 1,
+        kSchedulerElevator = 2
+    };
+    enum Priority
+    {
+        kPriorityHigh   = 0,
+        kPriorityNormal = 1,
+        kPriorityLow    = 2,
+        kPriorityIdle   = 3,
+        kPriorityCount
+    };
 
     typedef int      RequestId;
     typedef int      FileIdx;
@@ -328,7 +348,9 @@ public:
         int            inBufferCount,
         IoCompletion*  inIoCompletionPtr,
         Time           inTimeWaitNanoSec = -1,
-        int64_t        inEofHint         = -1);
+        int64_t        inEofHint         = -1,
+        int            inQosClass        = 0,
+        Priority       inPriority        = kPriorityNormal);
 
     EnqueueStatus Read(
         FileIdx        inFileIdx,
@@ -336,7 +358,9 @@ public:
         InputIterator* inBufferIteratorPtr,
         int            inBufferCount,
         IoCompletion*  inIoCompletionPtr,
-        Time           inTimeWaitNanoSec = -1)
+        Time           inTimeWaitNanoSec = -1,
+        int            inQosClass        = 0,
+        Priority       inPriority        = kPriorityNormal)
     {
         return Enqueue(
             kReqTypeRead,
@@ -345,7 +369,10 @@ public:
             inBufferIteratorPtr,
             inBufferCount,
             inIoCompletionPtr,
-            inTimeWaitNanoSec);
+            inTimeWaitNanoSec,
+            -1,
+            inQosClass,
+            inPriority);
     }
 
     EnqueueStatus Write(
@@ -356,7 +383,9 @@ public:
         IoCompletion*  inIoCompletionPtr,
         Time           inTimeWaitNanoSec = -1,
         bool           inSyncFlag        = false,
-        int64_t        inEofHint         = -1)
+        int64_t        inEofHint         = -1,
+        int            inQosClass        = 0,
+        Priority       inPriority        = kPriorityNormal)
     {
         return Enqueue(
             inSyncFlag ? kReqTypeWriteSync : kReqTypeWrite,
@@ -366,7 +395,9 @@ public:
             inBufferCount,
             inIoCompletionPtr,
             inTimeWaitNanoSec,
-            inEofHint);
+            inEofHint,
+            inQosClass,
+            inPriority);
     }
 
     CompletionStatus SyncIo(
@@ -473,6 +504,31 @@ public:
 
     int GetBlockSize() const;
 
+    // Sets relative QoS class weights. The classes with no weight specified,
+    // or with weight less than 1 are assigned weight 1, the max weight is
+    // 65536. The io threads dispatch the read and write requests with the
+    // smallest weighted start tag first, while preserving the meta (barrier)
+    // requests order.
+    void SetQosWeights(
+        const int* inWeightsPtr,
+        int        inCount);
+
+    // Sets read and write request scheduler. Fifo dispatches requests in
+    // the QoS order (see above), and is intended for devices with no seek
+    // penalty. Deadline dispatches requests in priority, then QoS order.
+    // Elevator dispatches requests in priority, then ascending file index and
+    // block order starting from the end of the last dispatched request, with
+    // wrap around (C-SCAN), in order to batch sequential requests on rotating
+    // media. With both deadline and elevator, the request with the expired
+    // deadline is dispatched first. The request deadline is its priority
+    // deadline relative to the enqueue time. The priorities with no deadline
+    // specified, or with deadline less than 0 keep the current deadline.
+    // Meta (barrier) requests order is preserved with all schedulers.
+    void SetScheduler(
+        Scheduler   inScheduler,
+        const Time* inDeadlinesNanoSecPtr = 0,
+        int         inCount               = 0);
+
     Status AllocateFileSpace(
         FileIdx inFileIdx);
 
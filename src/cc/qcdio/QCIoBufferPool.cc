@@ -33,6 +33,9 @@
 #include <sys/mman.h>
 #include <errno.h>
 #include <unistd.h>
+#include <string.h>
+
+#include <algorithm>
 
 #if defined(QC_IO_BUFFER_POOL_TRACE_PUT)
 #include <execinfo.h>
@@ -253,6 +256,44 @@ private:
     Partition*   mNextPtr[1];
 };
 
+// Per thread free buffers cache. The cache mutex is acquired by the owner
+// thread on every get and put, and is normally uncontended. Other threads
+// acquire it only to reclaim the buffers, or to retrieve the counters, while
+// holding the pool mutex. The owner thread never acquires the pool mutex while
+// holding the cache mutex, in order to maintain this lock order.
+class QCIoBufferPool::ThreadCache
+{
+public:
+    typedef QCDLList<ThreadCache, 0> List;
+
+    ThreadCache(
+        QCIoBufferPool& inPool)
+        : mMutex(),
+          mPool(inPool),
+          mCount(0),
+          mCounters()
+        { List::Init(*this); }
+    int GetMaxCount() const
+        { return (2 * mPool.mThreadCacheBatchSize); }
+
+    QCMutex         mMutex;
+    QCIoBufferPool& mPool;
+    int             mCount;
+    Counters        mCounters;
+    char*           mBufPtr[2 * kThreadCacheMaxBatchSize];
+private:
+    ThreadCache*    mPrevPtr[1];
+    ThreadCache*    mNextPtr[1];
+
+    friend class QCDLListOp<ThreadCache, 0>;
+    friend class QCDLListOp<const ThreadCache, 0>;
+private:
+    ThreadCache(
+        const ThreadCache& inCache);
+    ThreadCache& operator=(
+        const ThreadCache& inCache);
+};
+
 typedef QCDLList<QCIoBufferPool::Client, 0> QCIoBufferPoolClientList;
 
 QCIoBufferPool::Client::Client()
@@ -269,12 +310,21 @@ QCIoBufferPool::Client::Unregister()
 
 QCIoBufferPool::QCIoBufferPool()
     : mMutex(),
+      mThreadCacheKey(),
       mBufferSize(0),
       mFreeCnt(0),
-      mTotalCnt(0)
+      mTotalCnt(0),
+      mThreadCacheBatchSize(0),
+      mCounters()
 {
     QCIoBufferPoolClientList::Init(mClientListPtr);
     Partition::List::Init(mPartitionListPtr);
+    ThreadCache::List::Init(mThreadCacheListPtr);
+    const int theErr = pthread_key_create(
+        &mThreadCacheKey, &QCIoBufferPool::DeleteThreadCache);
+    if (theErr) {
+        QCUtils::FatalError("pthread_key_create", theErr);
+    }
 }
 
 QCIoBufferPool::~QCIoBufferPool()
@@ -287,6 +337,14 @@ QCIoBufferPool::~QCIoBufferPool()
         QCASSERT(theClient.mPoolPtr == this);
         theClient.mPoolPtr = 0;
     }
+    const int theErr = pthread_key_delete(mThreadCacheKey);
+    if (theErr) {
+        QCUtils::FatalError("pthread_key_delete", theErr);
+    }
+    ThreadCache* theCachePtr;
+    while ((theCachePtr = ThreadCache::List::PopBack(mThreadCacheListPtr))) {
+        delete theCachePtr;
+    }
 }
 
 int
@@ -294,7 +352,8 @@ QCIoBufferPool::Create(
     int          inPartitionCount,
     int          inPartitionBufferCount,
     int          inBufferSize,
-    bool         inLockMemoryFlag)
+    bool         inLockMemoryFlag,
+    int          inThreadCacheBatchSize /* = 0 */)
 {
     QCStMutexLocker theLock(mMutex);
     Destroy();
@@ -312,6 +371,10 @@ QCIoBufferPool::Create(
         mFreeCnt  += thePart.GetFreeCount();
         mTotalCnt += thePart.GetTotalCount();
     }
+    if (! theErr) {
+        mThreadCacheBatchSize = std::min(std::max(0, inThreadCacheBatchSize),
+            int(kThreadCacheMaxBatchSize));
+    }
     return theErr;
 }
 
@@ -323,29 +386,60 @@ QCIoBufferPool::Destroy()
     while ((thePtr = Partition::List::PopBack(mPartitionListPtr))) {
         delete thePtr;
     }
-    mBufferSize = 0;
-    mFreeCnt    = 0;
+    // The cached buffers belong to the partitions deleted above.
+    ThreadCache::List::Iterator theIt(mThreadCacheListPtr);
+    ThreadCache* theCachePtr;
+    while ((theCachePtr = theIt.Next())) {
+        QCStMutexLocker theCacheLock(theCachePtr->mMutex);
+        theCachePtr->mCount = 0;
+    }
+    mBufferSize           = 0;
+    mFreeCnt              = 0;
+    mThreadCacheBatchSize = 0;
 }
 
 char*
 QCIoBufferPool::Get(
     QCIoBufferPool::RefillReqId inRefillReqId /* = kRefillReqIdUndefined */)
 {
-    QCStMutexLocker theLock(mMutex);
-    if (mFreeCnt <= 0 && ! TryToRefill(inRefillReqId, 1)) {
-        return 0;
+    ThreadCache* const theCachePtr = GetThreadCache();
+    if (! theCachePtr) {
+        QCStMutexLocker theLock(mMutex);
+        mCounters.mGetCount++;
+        mCounters.mLockCount++;
+        return (Reserve(inRefillReqId, 1) ? GetSelf() : 0);
     }
-    QCASSERT(mFreeCnt >= 1);
-    // Always start from the first partition, to try to keep next
-    // partitions full, and be able to reclaim these if needed.
-    Partition::List::Iterator theItr(mPartitionListPtr);
-    Partition* thePtr;
-    while ((thePtr = theItr.Next()) && thePtr->IsEmpty())
-        {}
-    char* const theBufPtr = thePtr ? thePtr->Get() : 0;
-    QCASSERT(theBufPtr && mFreeCnt > 0);
-    mFreeCnt--;
-    return theBufPtr;
+    ThreadCache&    theCache = *theCachePtr;
+    QCStMutexLocker theCacheLock(theCache.mMutex);
+    theCache.mCounters.mGetCount++;
+    if (0 < theCache.mCount) {
+        theCache.mCounters.mGetHitCount++;
+        return theCache.mBufPtr[--theCache.mCount];
+    }
+    theCache.mCounters.mLockCount++;
+    char* theBufPtr[kThreadCacheMaxBatchSize];
+    int   theCnt = 0;
+    {
+        QCStMutexUnlocker theCacheUnlock(theCache.mMutex);
+        QCStMutexLocker   theLock(mMutex);
+        if (! Reserve(inRefillReqId, 1)) {
+            return 0;
+        }
+        // Refill the cache, but leave the most of the free buffers to other
+        // threads when the pool is running low.
+        const int theBatchCnt = std::max(1, std::min(
+            mThreadCacheBatchSize, (mFreeCnt + 7) / 8));
+        while (theCnt < theBatchCnt) {
+            theBufPtr[theCnt++] = GetSelf();
+        }
+    }
+    // Only the owner thread adds buffers to the cache, therefore the cache
+    // can not have become non empty.
+    QCASSERT(theCache.mCount == 0 && theCnt <= theCache.GetMaxCount());
+    while (1 < theCnt) {
+        theCache.mBufPtr[theCache.mCount++] = theBufPtr[--theCnt];
+    }
+    return theBufPtr[0];
 }
 
 bool
@@ -357,8 +451,26 @@ QCIoBufferPool::Get(
     if (inBufCnt <= 0) {
         return true;
     }
+    ThreadCache* const theCachePtr = GetThreadCache();
+    if (theCachePtr) {
+        ThreadCache&    theCache = *theCachePtr;
+        QCStMutexLocker theCacheLock(theCache.mMutex);
+        theCache.mCounters.mGetCount += inBufCnt;
+        if (inBufCnt <= theCache.mCount) {
+            theCache.mCounters.mGetHitCount += inBufCnt;
+            for (int i = 0; i < inBufCnt; i++) {
+                inIt.Put(theCache.mBufPtr[--theCache.mCount]);
+            }
+            return true;
+        }
+        theCache.mCounters.mLockCount++;
+    }
     QCStMutexLocker theLock(mMutex);
-    if (mFreeCnt < inBufCnt && ! TryToRefill(inRefillReqId, inBufCnt)) {
+    if (! theCachePtr) {
+        mCounters.mGetCount += inBufCnt;
+        mCounters.mLockCount++;
+    }
+    if (! Reserve(inRefillReqId, inBufCnt)) {
         return false;
     }
     QCASSERT(mFreeCnt >= inBufCnt);
@@ -383,7 +495,37 @@ QCIoBufferPool::Put(
     if (! inBufPtr) {
         return;
     }
+    // Return buffers directly into the partitions if invoked with the pool
+    // mutex held, for example from Client::Release(), in order to make the
+    // buffers available to the pending refill request.
+    ThreadCache* const theCachePtr = mMutex.IsOwned() ? 0 : GetThreadCache();
+    if (! theCachePtr) {
+        QCStMutexLocker theLock(mMutex);
+        mCounters.mPutCount++;
+        mCounters.mLockCount++;
+        PutSelf(inBufPtr);
+        return;
+    }
+    ThreadCache&    theCache = *theCachePtr;
+    QCStMutexLocker theCacheLock(theCache.mMutex);
+    theCache.mCounters.mPutCount++;
+    if (theCache.mCount < theCache.GetMaxCount()) {
+        theCache.mCounters.mPutHitCount++;
+        theCache.mBufPtr[theCache.mCount++] = inBufPtr;
+        return;
+    }
+    theCache.mCounters.mLockCount++;
+    // Drain one batch, and keep the remaining half for subsequent gets.
+    char*     theBufPtr[kThreadCacheMaxBatchSize];
+    const int theCnt = std::min(mThreadCacheBatchSize, theCache.mCount);
+    theCache.mCount -= theCnt;
+    memcpy(theBufPtr, theCache.mBufPtr + theCache.mCount,
+        theCnt * sizeof(theBufPtr[0]));
+    theCacheLock.Unlock();
     QCStMutexLocker theLock(mMutex);
+    for (int i = 0; i < theCnt; i++) {
+        PutSelf(theBufPtr[i]);
+    }
     PutSelf(inBufPtr);
 }
 
@@ -395,13 +537,45 @@ QCIoBufferPool::Put(
     if (inBufCnt < 0) {
         return;
     }
+    ThreadCache* const theCachePtr = mMutex.IsOwned() ? 0 : GetThreadCache();
+    int                i           = 0;
+    if (theCachePtr) {
+        ThreadCache&    theCache = *theCachePtr;
+        QCStMutexLocker theCacheLock(theCache.mMutex);
+        const int       theMaxCnt = theCache.GetMaxCount();
+        for (; i < inBufCnt && theCache.mCount < theMaxCnt; i++) {
+            char* const theBufPtr = inIt.Get();
+            if (! theBufPtr) {
+                inBufCnt = i;
+                break;
+            }
+            theCache.mBufPtr[theCache.mCount++] = theBufPtr;
+        }
+        theCache.mCounters.mPutCount    += i;
+        theCache.mCounters.mPutHitCount += i;
+        if (inBufCnt <= i) {
+            return;
+        }
+        theCache.mCounters.mLockCount++;
+    }
     QCStMutexLocker theLock(mMutex);
-    for (int i = 0; i < inBufCnt; i++) {
+    if (! theCachePtr) {
+        mCounters.mLockCount++;
+    }
+    int theCnt = 0;
+    for (; i < inBufCnt; i++) {
         char* const theBufPtr = inIt.Get();
         if (! theBufPtr) {
             break;
         }
         PutSelf(theBufPtr);
+        theCnt++;
+    }
+    if (theCachePtr) {
+        // The counters are modified only by the owner thread.
+        theCachePtr->mCounters.mPutCount += theCnt;
+    } else {
+        mCounters.mPutCount += theCnt;
     }
 }
 
@@ -512,11 +686,152 @@ QCIoBufferPool::TryToRefill(
     return (mFreeCnt >= inBufCnt);
 }
 
+char*
+QCIoBufferPool::GetSelf()
+{
+    QCASSERT(mMutex.IsOwned() && mFreeCnt >= 1);
+    // Always start from the first partition, to try to keep next
+    // partitions full, and be able to reclaim these if needed.
+    Partition::List::Iterator theItr(mPartitionListPtr);
+    Partition* thePtr;
+    while ((thePtr = theItr.Next()) && thePtr->IsEmpty())
+        {}
+    char* const theBufPtr = thePtr ? thePtr->Get() : 0;
+    QCASSERT(theBufPtr && mFreeCnt > 0);
+    mFreeCnt--;
+    return theBufPtr;
+}
+
+bool
+QCIoBufferPool::Reserve(
+    QCIoBufferPool::RefillReqId inReqId,
+    int                         inBufCnt)
+{
+    QCASSERT(mMutex.IsOwned());
+    if (inBufCnt <= mFreeCnt) {
+        return true;
+    }
+    ReclaimThreadCaches();
+    return (inBufCnt <= mFreeCnt || TryToRefill(inReqId, inBufCnt));
+}
+
+void
+QCIoBufferPool::ReclaimThreadCaches()
+{
+    QCASSERT(mMutex.IsOwned());
+    ThreadCache::List::Iterator theIt(mThreadCacheListPtr);
+    ThreadCache* thePtr;
+    while ((thePtr = theIt.Next())) {
+        ThreadCache&    theCache = *thePtr;
+        QCStMutexLocker theCacheLock(theCache.mMutex);
+        theCache.mCounters.mReclaimCount += theCache.mCount;
+        while (0 < theCache.mCount) {
+            PutSelf(theCache.mBufPtr[--theCache.mCount]);
+        }
+    }
+}
+
+QCIoBufferPool::ThreadCache*
+QCIoBufferPool::GetThreadCache()
+{
+    if (mThreadCacheBatchSize <= 0) {
+        return 0;
+    }
+    ThreadCache* thePtr =
+        reinterpret_cast<ThreadCache*>(pthread_getspecific(mThreadCacheKey));
+    if (thePtr) {
+        return thePtr;
+    }
+    thePtr = new ThreadCache(*this);
+    QCStMutexLocker theLock(mMutex);
+    const int theErr = pthread_setspecific(mThreadCacheKey, thePtr);
+    if (theErr) {
+        QCUtils::FatalError("pthread_setspecific", theErr);
+    }
+    ThreadCache::List::PushBack(mThreadCacheListPtr, *thePtr);
+    return thePtr;
+}
+
+void
+QCIoBufferPool::RemoveThreadCache(
+    QCIoBufferPool::ThreadCache& inCache)
+{
+    QCStMutexLocker theLock(mMutex);
+    {
+        QCStMutexLocker theCacheLock(inCache.mMutex);
+        while (0 < inCache.mCount) {
+            PutSelf(inCache.mBufPtr[--inCache.mCount]);
+        }
+        mCounters.Add(inCache.mCounters);
+    }
+    ThreadCache::List::Remove(mThreadCacheListPtr, inCache);
+    delete &inCache;
+}
+
+/* static */ void
+QCIoBufferPool::DeleteThreadCache(
+    void* inCachePtr)
+{
+    ThreadCache& theCache = *reinterpret_cast<ThreadCache*>(inCachePtr);
+    theCache.mPool.RemoveThreadCache(theCache);
+}
+
+void
+QCIoBufferPool::GetCounters(
+    QCIoBufferPool::Counters& outCounters)
+{
+    QCStMutexLocker theLock(mMutex);
+    outCounters = mCounters;
+    ThreadCache::List::Iterator theIt(mThreadCacheListPtr);
+    ThreadCache* thePtr;
+    while ((thePtr = theIt.Next())) {
+        QCStMutexLocker theCacheLock(thePtr->mMutex);
+        outCounters.Add(thePtr->mCounters);
+        outCounters.mCachedCount += thePtr->mCount;
+    }
+}
+
+bool
+QCIoBufferPool::GetThreadCacheCounters(
+    int                       inIdx,
+    QCIoBufferPool::Counters& outCounters)
+{
+    QCStMutexLocker theLock(mMutex);
+    ThreadCache::List::Iterator theIt(mThreadCacheListPtr);
+    ThreadCache* thePtr;
+    for (int i = 0; (thePtr = theIt.Next()) && i < inIdx; i++)
+        {}
+    if (inIdx < 0 || ! thePtr) {
+        outCounters.Clear();
+        return false;
+    }
+    QCStMutexLocker theCacheLock(thePtr->mMutex);
+    outCounters = thePtr->mCounters;
+    outCounters.mCachedCount = thePtr->mCount;
+    return true;
+}
+
+int
+QCIoBufferPool::GetCachedCount()
+{
+    QCASSERT(mMutex.IsOwned());
+    // The count might change once the cache mutex is released, as the owner
+    // threads do not acquire the pool mutex on cache hit.
+    int                         theCnt = 0;
+    ThreadCache::List::Iterator theIt(mThreadCacheListPtr);
+    ThreadCache*                thePtr;
+    while ((thePtr = theIt.Next())) {
+        QCStMutexLocker theCacheLock(thePtr->mMutex);
+        theCnt += thePtr->mCount;
+    }
+    return theCnt;
+}
+
 int
 QCIoBufferPool::GetFreeBufferCount()
 {
     QCStMutexLocker theLock(mMutex);
-    return mFreeCnt;
+    return (mFreeCnt + GetCachedCount());
 }
 
 int
@@ -530,5 +845,5 @@ int
 QCIoBufferPool::GetUsedBufferCount()
 {
     QCStMutexLocker theLock(mMutex);
-    return (mTotalCnt - mFreeCnt);
+    return (mTotalCnt - mFreeCnt - GetCachedCount());
 }
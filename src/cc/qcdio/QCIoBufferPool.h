@@ -30,6 +30,14 @@
 // to satisfy request the "clients" are asked to release the specified number
 // of buffers before declaring allocation failure.
 // All buffer allocations are atomic -- all or nothing.
+// Optionally each thread can have its own bounded cache of free buffers
+// ("magazine"), in order to avoid acquiring the pool mutex on every get and
+// put. The thread caches are refilled from, and drained into the shared
+// partitions in batches. The buffers in the thread caches are accounted as
+// free, and are reclaimed by the pool when the partitions do not have enough
+// free buffers to satisfy a request. The pool validation, and pinned buffer
+// checks are performed when buffers are returned to the partitions, therefore
+// IsValid() reports buffers in the thread caches as used.
 //
 //----------------------------------------------------------------------------
 
@@ -38,6 +46,8 @@
 
 #include "QCMutex.h"
 
+#include <pthread.h>
+#include <stdint.h>
 
 class QCIoBufferPool
 {
@@ -82,6 +92,44 @@ public:
     template<typename, unsigned int> friend class QCDLListOp;
     };
 
+    struct Counters
+    {
+        typedef int64_t Counter;
+
+        Counter mGetCount;
+        Counter mGetHitCount;
+        Counter mPutCount;
+        Counter mPutHitCount;
+        Counter mLockCount;
+        Counter mReclaimCount;
+        Counter mCachedCount;
+
+        Counters()
+            { Counters::Clear(); }
+        void Clear()
+        {
+            mGetCount     = 0;
+            mGetHitCount  = 0;
+            mPutCount     = 0;
+            mPutHitCount  = 0;
+            mLockCount    = 0;
+            mReclaimCount = 0;
+            mCachedCount  = 0;
+        }
+        Counters& Add(
+            const Counters& inCounters)
+        {
+            mGetCount     += inCounters.mGetCount;
+            mGetHitCount  += inCounters.mGetHitCount;
+            mPutCount     += inCounters.mPutCount;
+            mPutHitCount  += inCounters.mPutHitCount;
+            mLockCount    += inCounters.mLockCount;
+            mReclaimCount += inCounters.mReclaimCount;
+            mCachedCount  += inCounters.mCachedCount;
+            return *this;
+        }
+    };
+
     class InputIterator
     {
     public:
@@ -107,11 +155,18 @@ public:
 
     QCIoBufferPool();
     ~QCIoBufferPool();
+    // With non 0 thread cache batch size every thread that gets or puts
+    // buffers has its own cache of up to 2 * batch size free buffers. The
+    // cache is deleted and its buffers are returned to the pool only when
+    // the thread exits, or by Destroy(). The buffers cached by an idle or
+    // one off thread that remains running are reclaimed only when the pool
+    // runs out of free buffers.
     int Create(
         int          inPartitionCount,
         int          inPartitionBufferCount,
         int          inBufferSize,
-        bool         inLockMemoryFlag);
+        bool         inLockMemoryFlag,
+        int          inThreadCacheBatchSize = 0);
     void Destroy();
     char* Get(
         RefillReqId inRefillReqId = kRefillReqIdUndefined);
@@ -133,6 +188,15 @@ public:
     int GetFreeBufferCount();
     int GetTotalBufferCount();
     int GetUsedBufferCount();
+    int GetThreadCacheBatchSize() const
+        { return mThreadCacheBatchSize; }
+    // Pool totals, including the counters of the exited threads.
+    void GetCounters(
+        Counters& outCounters);
+    // Per thread cache counters. Returns false if index is out of range.
+    bool GetThreadCacheCounters(
+        int       inIdx,
+        Counters& outCounters);
     bool IsValid(
         const char* inBufPtr,
         bool&       outFoundFlag);
@@ -147,19 +211,36 @@ public:
         PinnedBufferId inId,
         bool           inFlag);
 private:
+    enum { kThreadCacheMaxBatchSize = 256 };
     class Partition;
-    QCMutex    mMutex;
-    Client*    mClientListPtr[1];
-    Partition* mPartitionListPtr[1];
-    int        mBufferSize;
-    int        mFreeCnt;
-    int        mTotalCnt;
+    class ThreadCache;
+    QCMutex       mMutex;
+    Client*       mClientListPtr[1];
+    Partition*    mPartitionListPtr[1];
+    ThreadCache*  mThreadCacheListPtr[1];
+    pthread_key_t mThreadCacheKey;
+    int           mBufferSize;
+    int           mFreeCnt;
+    int           mTotalCnt;
+    int           mThreadCacheBatchSize;
+    Counters      mCounters;
 
     bool TryToRefill(
         RefillReqId inReqId,
         int         inBufCnt);
     void PutSelf(
         char* inBufPtr);
+    char* GetSelf();
+    bool Reserve(
+        RefillReqId inReqId,
+        int         inBufCnt);
+    void ReclaimThreadCaches();
+    int GetCachedCount();
+    ThreadCache* GetThreadCache();
+    void RemoveThreadCache(
+        ThreadCache& inCache);
+    static void DeleteThreadCache(
+        void* inCachePtr);
 
     // No copies.
     QCIoBufferPool( const QCIoBufferPool& inPool);
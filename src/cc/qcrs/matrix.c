@@ -0,0 +1,421 @@
+/*---------------------------------------------------------- -*- Mode: C -*-----
+ * $Id$
+ *
+ * Created 2026/10/19
+ *
+ * Copyright 2026 Quantcast Corp.
+ *
+ * This file is part of Kosmos File System (KFS).
+ *
+ * Licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ *
+ * \file matrix.c
+ * \brief Reed Solomon n+m encoder and decoder with arbitrary number of
+ * recovery blocks. Both encoding and decoding are matrix vector products
+ * over GF(2^8), computed with nibble table lookups.
+ *
+ *------------------------------------------------------------------------------
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "rs.h"
+#include "rs_table.h"
+#include "prim.h"
+
+#if defined(LIBRS_USE_AVX512) || defined(LIBRS_USE_AVX2)
+#include <immintrin.h>
+#endif
+
+#define RS_MAX_BLOCKS (RS_LIB_MAX_DATA_BLOCKS + RS_LIB_MAX_WIDE_RECOVERY_BLOCKS)
+#define RS_MAX_ROWS RS_LIB_MAX_WIDE_RECOVERY_BLOCKS
+/* Max. number of output blocks computed in one pass over the input. */
+#define RS_MAX_PASS_ROWS 4
+
+static uint8_t
+gfmul(uint8_t x, uint8_t y)
+{
+    if (x == 0 || y == 0)
+        return 0;
+    return rs_pow2[(rs_log2[x] + rs_log2[y]) % 255];
+}
+
+static uint8_t
+gfinv(uint8_t x)
+{
+    assert(x != 0);
+    return rs_pow2[(255 - rs_log2[x]) % 255];
+}
+
+/* Cauchy matrix 1 / (x[i] + y[j]) with x[i] = i, y[j] = m + j. */
+static uint8_t
+cauchy(int m, int i, int j)
+{
+    return gfinv((uint8_t)(i ^ (m + j)));
+}
+
+/* Coefficient of data block j in recovery block i. */
+static uint8_t
+coef(int m, int i, int j)
+{
+    if (m <= RS_LIB_MAX_RECOVERY_BLOCKS)
+        return rs_pow2[(i * j) % 255];
+    /*
+     * Scale Cauchy matrix rows and columns in order to make the first row and
+     * column all ones. Scaling does not change the matrix rank, therefore
+     * the code remains MDS, and the first recovery block is P syndrome.
+     */
+    return gfmul(gfmul(cauchy(m, i, j), cauchy(m, 0, 0)),
+        gfinv(gfmul(cauchy(m, 0, j), cauchy(m, i, 0))));
+}
+
+/* Invert n x n matrix a in place of b, a is destroyed. */
+static int
+invert(int n, uint8_t a[][RS_MAX_ROWS], uint8_t b[][RS_MAX_ROWS])
+{
+    int c, r, k;
+    uint8_t x, t;
+
+    for (r = 0; r < n; r++)
+        for (k = 0; k < n; k++)
+            b[r][k] = r == k ? 1 : 0;
+    for (c = 0; c < n; c++) {
+        for (r = c; r < n && a[r][c] == 0; r++)
+            ;
+        if (r >= n)
+            return -1;
+        if (r != c)
+            for (k = 0; k < n; k++) {
+                t = a[r][k]; a[r][k] = a[c][k]; a[c][k] = t;
+                t = b[r][k]; b[r][k] = b[c][k]; b[c][k] = t;
+            }
+        x = gfinv(a[c][c]);
+        for (k = 0; k < n; k++) {
+            a[c][k] = gfmul(x, a[c][k]);
+            b[c][k] = gfmul(x, b[c][k]);
+        }
+        for (r = 0; r < n; r++) {
+            if (r == c || (x = a[r][c]) == 0)
+                continue;
+            for (k = 0; k < n; k++) {
+                a[r][k] ^= gfmul(x, a[c][k]);
+                b[r][k] ^= gfmul(x, b[c][k]);
+            }
+        }
+    }
+    return 0;
+}
+
+#if defined(LIBRS_USE_AVX512)
+
+typedef __m512i vw;
+
+#define VW_LOAD(p)     _mm512_loadu_si512((const void*)(p))
+#define VW_STORE(p, v) _mm512_storeu_si512((void*)(p), (v))
+#define VW_XOR(x, y)   _mm512_xor_si512((x), (y))
+
+static inline vw
+vw_mulby(uint8_t x, vw v)
+{
+    const vw m  = _mm512_set1_epi8(0x0f);
+    const vw lo = _mm512_broadcast_i32x4(
+        _mm_loadu_si128((const __m128i*)&rs_nibmul[x].lo));
+    const vw hi = _mm512_broadcast_i32x4(
+        _mm_loadu_si128((const __m128i*)&rs_nibmul[x].hi));
+    return _mm512_xor_si512(
+        _mm512_shuffle_epi8(lo, _mm512_and_si512(v, m)),
+        _mm512_shuffle_epi8(hi, _mm512_and_si512(_mm512_srli_epi64(v, 4), m)));
+}
+
+#elif defined(LIBRS_USE_AVX2)
+
+typedef __m256i vw;
+
+#define VW_LOAD(p)     _mm256_loadu_si256((const __m256i*)(p))
+#define VW_STORE(p, v) _mm256_storeu_si256((__m256i*)(p), (v))
+#define VW_XOR(x, y)   _mm256_xor_si256((x), (y))
+
+static inline vw
+vw_mulby(uint8_t x, vw v)
+{
+    const vw m  = _mm256_set1_epi8(0x0f);
+    const vw lo = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)&rs_nibmul[x].lo));
+    const vw hi = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)&rs_nibmul[x].hi));
+    return _mm256_xor_si256(
+        _mm256_shuffle_epi8(lo, _mm256_and_si256(v, m)),
+        _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(v, 4), m)));
+}
+
+#else
+
+typedef v16 vw;
+
+#define VW_LOAD(p)     (*(const v16*)(p))
+#define VW_STORE(p, v) (*(v16*)(p) = (v))
+#define VW_XOR(x, y)   ((x) ^ (y))
+#define vw_mulby       mulby
+
+#endif
+
+/*
+ * Compute nout <= RS_MAX_PASS_ROWS output blocks in one pass over the
+ * inputs. Returns the position of the remaining tail that is less than the
+ * vector size.
+ */
+static inline int
+mul_rows_pass(int nin, int nout, int blocksize, const uint8_t *const *rows,
+    uint8_t *const *in, uint8_t *const *out)
+{
+    int pos, r, j;
+    uint8_t c;
+    vw x, acc[RS_MAX_PASS_ROWS];
+
+    for (pos = 0; pos + (int)sizeof(vw) <= blocksize; pos += sizeof(vw)) {
+        x = VW_LOAD(in[0] + pos);
+        for (r = 0; r < nout; r++)
+            acc[r] = rows[r][0] == 1 ? x : vw_mulby(rows[r][0], x);
+        for (j = 1; j < nin; j++) {
+            x = VW_LOAD(in[j] + pos);
+            for (r = 0; r < nout; r++) {
+                if ((c = rows[r][j]) == 1)
+                    acc[r] = VW_XOR(acc[r], x);
+                else if (c != 0)
+                    acc[r] = VW_XOR(acc[r], vw_mulby(c, x));
+            }
+        }
+        for (r = 0; r < nout; r++)
+            VW_STORE(out[r] + pos, acc[r]);
+    }
+    return pos;
+}
+
+static void
+mul_rows_tail(int nin, int nout, int pos, int blocksize,
+    const uint8_t *const *rows, uint8_t *const *in, uint8_t *const *out)
+{
+    int r, j;
+    v16 x, acc;
+
+    for (; pos < blocksize; pos += sizeof(v16))
+        for (r = 0; r < nout; r++) {
+            acc = VEC16(0);
+            for (j = 0; j < nin; j++) {
+                x = *(const v16*)(in[j] + pos);
+                acc ^= mulby(rows[r][j], x);
+            }
+            *(v16*)(out[r] + pos) = acc;
+        }
+}
+
+/* out[r] = sum(rows[r][j] * in[j]), r in [0, nout), j in [0, nin). */
+static void
+mul_rows(int nin, int nout, int blocksize, const uint8_t *const *rows,
+    uint8_t *const *in, uint8_t *const *out)
+{
+    int r, pos;
+
+    assert(blocksize % 16 == 0);
+    for (r = 0; r < nout; r += RS_MAX_PASS_ROWS) {
+        /* Specialize on the row count, to keep accumulators in registers. */
+        switch (nout - r) {
+            case 1:
+                pos = mul_rows_pass(nin, 1, blocksize, rows + r, in, out + r);
+                break;
+            case 2:
+                pos = mul_rows_pass(nin, 2, blocksize, rows + r, in, out + r);
+                break;
+            case 3:
+                pos = mul_rows_pass(nin, 3, blocksize, rows + r, in, out + r);
+                break;
+            default:
+                pos = mul_rows_pass(nin, RS_MAX_PASS_ROWS, blocksize,
+                    rows + r, in, out + r);
+                break;
+        }
+        mul_rows_tail(nin,
+            nout - r < RS_MAX_PASS_ROWS ? nout - r : RS_MAX_PASS_ROWS,
+            pos, blocksize, rows + r, in, out + r);
+    }
+}
+
+void
+rs_encode_n(int nblocks, int nrecovery, int blocksize, void **data)
+{
+    uint8_t matrix[RS_MAX_ROWS][RS_LIB_MAX_DATA_BLOCKS];
+    const uint8_t *rows[RS_MAX_ROWS];
+    const int n = nblocks - nrecovery;
+    int i, j;
+
+    assert(0 < n && n <= RS_LIB_MAX_DATA_BLOCKS &&
+        0 < nrecovery && nrecovery <= RS_LIB_MAX_WIDE_RECOVERY_BLOCKS);
+#if ! defined(LIBRS_USE_SSSE3) && ! defined(LIBRS_USE_NEON)
+    /* Without table lookup multiplication by 2 and 4 is faster. */
+    if (nrecovery == RS_LIB_MAX_RECOVERY_BLOCKS) {
+        rs_encode(nblocks, blocksize, data);
+        return;
+    }
+#endif
+    for (i = 0; i < nrecovery; i++) {
+        for (j = 0; j < n; j++)
+            matrix[i][j] = coef(nrecovery, i, j);
+        rows[i] = matrix[i];
+    }
+    mul_rows(n, nrecovery, blocksize, rows,
+        (uint8_t**)data, (uint8_t**)data + n);
+}
+
+int
+rs_decoder_init(rs_decoder *dec, int nblocks, int nrecovery,
+    const int *missing)
+{
+    uint8_t a[RS_MAX_ROWS][RS_MAX_ROWS], b[RS_MAX_ROWS][RS_MAX_ROWS];
+    char lost[RS_MAX_BLOCKS];
+    int ldata[RS_MAX_ROWS], rows[RS_MAX_ROWS];
+    const int n = nblocks - nrecovery;
+    const int m = nrecovery;
+    int i, j, k, r, t, ne, np, nin;
+    uint8_t c;
+
+    if (n <= 0 || RS_LIB_MAX_DATA_BLOCKS < n ||
+            m <= 0 || RS_LIB_MAX_WIDE_RECOVERY_BLOCKS < m)
+        return -1;
+    memset(lost, 0, sizeof(lost));
+    for (i = 0; missing[i] >= 0; i++) {
+        if (m <= i || nblocks <= missing[i] || lost[missing[i]])
+            return -1;
+        lost[missing[i]] = 1;
+    }
+    dec->nblocks   = nblocks;
+    dec->nrecovery = nrecovery;
+    dec->noutputs  = 0;
+    /*
+     * The inputs are the available data blocks, followed by the available
+     * recovery blocks, one per missing data block.
+     */
+    ne  = 0;
+    nin = 0;
+    for (j = 0; j < n; j++) {
+        if (lost[j])
+            ldata[ne++] = j;
+        else
+            dec->inputs[nin++] = j;
+    }
+    for (i = 0, np = 0; i < m && np < ne; i++)
+        if (! lost[n + i]) {
+            rows[np++] = i;
+            dec->inputs[nin++] = n + i;
+        }
+    if (np < ne)
+        return -1;
+    /*
+     * Syndromes of the selected recovery blocks with the missing data blocks
+     * set to 0 are: s = a * d, where d are the missing data blocks, and a is
+     * the matrix of their coefficients. Thus d = inv(a) * s.
+     */
+    for (r = 0; r < ne; r++)
+        for (k = 0; k < ne; k++)
+            a[r][k] = coef(m, rows[r], ldata[k]);
+    if (invert(ne, a, b) != 0)
+        return -1;
+    for (k = 0; k < ne; k++) {
+        for (t = 0; t < n - ne; t++) {
+            c = 0;
+            for (r = 0; r < ne; r++)
+                c ^= gfmul(b[k][r], coef(m, rows[r], dec->inputs[t]));
+            dec->matrix[k][t] = c;
+        }
+        for (r = 0; r < ne; r++)
+            dec->matrix[k][n - ne + r] = b[k][r];
+        dec->outputs[k] = ldata[k];
+    }
+    dec->noutputs = ne;
+    /* Express missing recovery blocks in terms of the inputs. */
+    for (i = 0; i < m; i++) {
+        if (! lost[n + i])
+            continue;
+        for (t = 0; t < n; t++) {
+            c = t < n - ne ? coef(m, i, dec->inputs[t]) : 0;
+            for (k = 0; k < ne; k++)
+                c ^= gfmul(coef(m, i, ldata[k]), dec->matrix[k][t]);
+            dec->matrix[dec->noutputs][t] = c;
+        }
+        dec->outputs[dec->noutputs++] = n + i;
+    }
+    return 0;
+}
+
+void
+rs_decode_n(const rs_decoder *dec, int blocksize, void **data)
+{
+    const uint8_t *rows[RS_MAX_ROWS];
+    uint8_t *in[RS_LIB_MAX_DATA_BLOCKS];
+    uint8_t *out[RS_MAX_ROWS];
+    const int n = dec->nblocks - dec->nrecovery;
+    int i, nout;
+
+    for (i = 0; i < n; i++)
+        in[i] = (uint8_t*)data[dec->inputs[i]];
+    for (i = 0, nout = 0; i < dec->noutputs; i++) {
+        if (! data[dec->outputs[i]]) {
+            assert(n <= dec->outputs[i]);
+            continue;
+        }
+        rows[nout] = dec->matrix[i];
+        out[nout++] = (uint8_t*)data[dec->outputs[i]];
+    }
+    mul_rows(n, nout, blocksize, rows, in, out);
+}
+
+uint8_t
+rs_gf_mul(uint8_t x, uint8_t y)
+{
+    return gfmul(x, y);
+}
+
+uint8_t
+rs_gf_inv(uint8_t x)
+{
+    return gfinv(x);
+}
+
+uint8_t
+rs_gf_pow2(int e)
+{
+    assert(0 <= e);
+    return rs_pow2[e % 255];
+}
+
+void
+rs_gf_muladd(uint8_t c, int len, const void *src, void *dst)
+{
+    const uint8_t *s = (const uint8_t*)src;
+    uint8_t *d = (uint8_t*)dst;
+    int pos = 0;
+
+    if (c == 0)
+        return;
+    if ((((uintptr_t)s | (uintptr_t)d) & (sizeof(v16) - 1)) == 0)
+        for (; pos + (int)sizeof(v16) <= len; pos += sizeof(v16))
+            *(v16*)(d + pos) ^= c == 1 ?
+                *(const v16*)(s + pos) : mulby(c, *(const v16*)(s + pos));
+    if (c == 1)
+        for (; pos < len; pos++)
+            d[pos] ^= s[pos];
+    else
+        for (; pos < len; pos++)
+            d[pos] ^= gfmul(c, s[pos]);
+}
@@ -36,6 +36,7 @@
 
 uint8_t pow2[256];
 uint8_t inv[256];
+uint8_t lg2[256];
 uint8_t mlo[256][16];
 uint8_t mhi[256][16];
 uint16_t r2map[RS_LIB_MAX_DATA_BLOCKS][RS_LIB_MAX_DATA_BLOCKS];
@@ -109,6 +110,28 @@ int main(int argc, char **argv)
         for (j = 0; j < 256; j++)
             assert(mul(i, j) == (mlo[i][j&0x0f] ^ mhi[i][j>>4]));
 
+    printf("const uint8_t rs_pow2[256] = {\n");
+    for (i = 0; i < 256; i += 16) {
+        printf("\t");
+        for (j = i; j < i + 16; j++)
+            printf("0x%02x,", pow2[j]);
+        printf("\n");
+    }
+    printf("};\n");
+
+    /* Logarithms, log(0) is not defined, and set to 0 */
+    memset(lg2, 0, sizeof(lg2));
+    for (i = 0; i < 255; i++)
+        lg2[pow2[i]] = i;
+    printf("const uint8_t rs_log2[256] = {\n");
+    for (i = 0; i < 256; i += 16) {
+        printf("\t");
+        for (j = i; j < i + 16; j++)
+            printf("0x%02x,", lg2[j]);
+        printf("\n");
+    }
+    printf("};\n");
+
     printf("const rs_nibtab rs_nibmul[256] = {\n");
     for (i = 0; i < 256; i++) {
         printf("\t{ { ");
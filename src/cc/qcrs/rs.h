@@ -33,14 +33,63 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+
 #define RS_LIB_MAX_DATA_BLOCKS 64
 #define RS_LIB_MAX_RECOVERY_BLOCKS 3
+#define RS_LIB_MAX_WIDE_RECOVERY_BLOCKS 32
 
 void rs_encode(int nblocks, int blocksize, void **data);
 void rs_decode1(int nblocks, int blocksize, int x, void **data);
 void rs_decode2(int nblocks, int blocksize, int x, int y, void **data);
 void rs_decode3(int nblocks, int blocksize, int x, int y, int z, void **data);
 
+/*
+ * Generic n+m encoder and decoder, 0 < m <= RS_LIB_MAX_WIDE_RECOVERY_BLOCKS.
+ * With m <= 3 recovery blocks are the first m of P, Q, and R syndromes
+ * computed by rs_encode(), and with m > 3 are computed with Cauchy matrix.
+ * nblocks is n data blocks plus m recovery blocks.
+ */
+void rs_encode_n(int nblocks, int nrecovery, int blocksize, void **data);
+
+/* Decoding matrix for a given set of missing blocks. */
+struct rs_decoder
+{
+    int     nblocks;
+    int     nrecovery;
+    int     noutputs;
+    int     inputs[RS_LIB_MAX_DATA_BLOCKS];
+    int     outputs[RS_LIB_MAX_WIDE_RECOVERY_BLOCKS];
+    uint8_t matrix[RS_LIB_MAX_WIDE_RECOVERY_BLOCKS][RS_LIB_MAX_DATA_BLOCKS];
+};
+typedef struct rs_decoder rs_decoder;
+
+/*
+ * Compute the decoding matrix. missing is -1 terminated list of the
+ * missing block indices. Returns 0 on success, or -1 if the number of
+ * missing blocks exceeds m, or the missing list is not valid.
+ */
+int rs_decoder_init(rs_decoder *dec, int nblocks, int nrecovery,
+    const int *missing);
+
+/*
+ * Recover missing blocks. Missing recovery blocks with null data pointers
+ * are not computed.
+ */
+void rs_decode_n(const rs_decoder *dec, int blocksize, void **data);
+
+/*
+ * GF(2^8) arithmetic in the field used by the coders above, with
+ * x^8 + x^4 + x^3 + x^2 + 1 polynomial and 2 as generator, intended for
+ * other codes built on top of this library.
+ */
+uint8_t rs_gf_mul(uint8_t x, uint8_t y);
+uint8_t rs_gf_inv(uint8_t x);
+/* 2^e, e >= 0 */
+uint8_t rs_gf_pow2(int e);
+/* dst ^= c * src; src and dst can have any alignment and length. */
+void rs_gf_muladd(uint8_t c, int len, const void *src, void *dst);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,224 @@
+/*---------------------------------------------------------- -*- Mode: C -*-----
+ * $Id$
+ *
+ * Created 2026/10/19
+ *
+ * Copyright 2026 Quantcast Corp.
+ *
+ * This file is part of Kosmos File System (KFS).
+ *
+ * Licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ *
+ * \file rs_bench_main.c
+ * \brief Reed Solomon n+m encoder and decoder test and benchmark.
+ *
+ *------------------------------------------------------------------------------
+ */
+
+#include "rs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_BLOCKS (RS_LIB_MAX_DATA_BLOCKS + RS_LIB_MAX_WIDE_RECOVERY_BLOCKS)
+
+static void *data[MAX_BLOCKS];
+static void *orig[MAX_BLOCKS];
+
+static void
+mkrand(void *buf, int size)
+{
+    char *p;
+    int i;
+
+    p = buf;
+    for (i = 0; i < size; i++)
+        p[i] = rand();
+}
+
+/* Choose cnt distinct random block indices in [0, nblocks). */
+static void
+mkmissing(int nblocks, int cnt, int *missing)
+{
+    int i, j, x;
+
+    for (i = 0; i < cnt; i++) {
+        do {
+            x = rand() % nblocks;
+            for (j = 0; j < i && missing[j] != x; j++)
+                ;
+        } while (j < i);
+        missing[i] = x;
+    }
+    missing[cnt] = -1;
+}
+
+static double
+rate(double bytes, clock_t clk)
+{
+    return (bytes * CLOCKS_PER_SEC /
+        ((double)clk > 0 ? (double)clk : 1e-10) / 1e9);
+}
+
+static int
+run(int n, int m, int blocksize, int iterations, int tests)
+{
+    int i, k, missing[RS_LIB_MAX_WIDE_RECOVERY_BLOCKS + 1];
+    const int nblocks = n + m;
+    rs_decoder dec;
+    clock_t clk;
+    double bytes;
+
+    for (i = 0; i < n; i++)
+        mkrand(data[i], blocksize);
+    rs_encode_n(nblocks, m, blocksize, data);
+    if (m == RS_LIB_MAX_RECOVERY_BLOCKS) {
+        /* Recovery blocks must match rs_encode() P, Q, and R. */
+        for (i = 0; i < nblocks; i++)
+            memcpy(orig[i], data[i], blocksize);
+        rs_encode(nblocks, blocksize, data);
+        for (i = n; i < nblocks; i++)
+            if (memcmp(orig[i], data[i], blocksize) != 0) {
+                printf("FAILED: %d+%d rs_encode mismatch: %d\n", n, m, i);
+                return 1;
+            }
+    }
+    for (i = 0; i < nblocks; i++)
+        memcpy(orig[i], data[i], blocksize);
+
+    /* Random erasures of 1 to m blocks. */
+    for (k = 0; k < tests; k++) {
+        mkmissing(nblocks, 1 + k % m, missing);
+        for (i = 0; missing[i] >= 0; i++)
+            memset(data[missing[i]], 0, blocksize);
+        if (rs_decoder_init(&dec, nblocks, m, missing) != 0) {
+            printf("FAILED: %d+%d decoder init\n", n, m);
+            return 1;
+        }
+        rs_decode_n(&dec, blocksize, data);
+        for (i = 0; i < nblocks; i++)
+            if (memcmp(orig[i], data[i], blocksize) != 0) {
+                printf("FAILED: %d+%d test: %d block: %d\n", n, m, k, i);
+                return 1;
+            }
+    }
+
+    if (iterations <= 0)
+        return 0;
+    bytes = (double)blocksize * n * iterations;
+    clk = clock();
+    for (i = 0; i < iterations; i++)
+        rs_encode_n(nblocks, m, blocksize, data);
+    clk = clock() - clk;
+    printf("%2d+%-2d encode:            %7.3f GB/s\n",
+        n, m, rate(bytes, clk));
+    if (m == RS_LIB_MAX_RECOVERY_BLOCKS) {
+        clk = clock();
+        for (i = 0; i < iterations; i++)
+            rs_encode(nblocks, blocksize, data);
+        clk = clock() - clk;
+        printf("%2d+%-2d encode rs_encode:  %7.3f GB/s\n",
+            n, m, rate(bytes, clk));
+    }
+    /* Worst case: m data blocks missing. */
+    for (i = 0; i < m && i < n; i++)
+        missing[i] = i;
+    missing[i] = -1;
+    clk = clock();
+    for (k = 0; k < iterations; k++) {
+        rs_decoder_init(&dec, nblocks, m, missing);
+        rs_decode_n(&dec, blocksize, data);
+    }
+    clk = clock() - clk;
+    printf("%2d+%-2d decode %2d missing: %7.3f GB/s\n",
+        n, m, i, rate(bytes, clk));
+    if (m == RS_LIB_MAX_RECOVERY_BLOCKS && 3 <= n) {
+        clk = clock();
+        for (k = 0; k < iterations; k++)
+            rs_decode3(nblocks, blocksize, 0, 1, 2, data);
+        clk = clock() - clk;
+        printf("%2d+%-2d decode rs_decode3: %7.3f GB/s\n",
+            n, m, rate(bytes, clk));
+    }
+    /* Single data block missing. */
+    missing[0] = n / 2;
+    missing[1] = -1;
+    clk = clock();
+    for (k = 0; k < iterations; k++) {
+        rs_decoder_init(&dec, nblocks, m, missing);
+        rs_decode_n(&dec, blocksize, data);
+    }
+    clk = clock() - clk;
+    printf("%2d+%-2d decode  1 missing: %7.3f GB/s\n",
+        n, m, rate(bytes, clk));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *const defaults[] = {
+        "6+3", "10+4", "12+4", "16+4", "20+4", "32+8", "48+12", 0
+    };
+    const char *const *configs = defaults;
+    int i, n, m, err, opt;
+    int blocksize = 64 << 10, iterations = 200, tests = 64;
+
+    while ((opt = getopt(argc, argv, "b:i:t:h")) != -1) {
+        switch (opt) {
+            case 'b': blocksize  = atoi(optarg); break;
+            case 'i': iterations = atoi(optarg); break;
+            case 't': tests      = atoi(optarg); break;
+            default:
+                printf("Usage: %s [-b block size] [-i perf iterations]"
+                    " [-t tests] [n+m ...]\n"
+                    "       This tests the Reed Solomon n+m encoder and"
+                    " decoder,\n"
+                    "       and reports the data encode and decode rates.\n"
+                    "       0 < n <= %d, 0 < m <= %d\n"
+                    "       Defaults: block size=%d, iterations=%d,"
+                    " tests=%d\n",
+                    argv[0], RS_LIB_MAX_DATA_BLOCKS,
+                    RS_LIB_MAX_WIDE_RECOVERY_BLOCKS,
+                    blocksize, iterations, tests);
+                return (opt == 'h' ? 0 : 1);
+        }
+    }
+    if (blocksize <= 0 || blocksize % 16 != 0) {
+        printf("block size must be positive multiple of 16\n");
+        return 1;
+    }
+    if (optind < argc)
+        configs = (const char *const *)argv + optind;
+    for (i = 0; i < MAX_BLOCKS; i++) {
+        if ((err = posix_memalign(data + i, 64, blocksize)) ||
+                (err = posix_memalign(orig + i, 64, blocksize))) {
+            printf("%s\n", strerror(err));
+            return 1;
+        }
+    }
+    for (i = 0; configs[i]; i++) {
+        if (sscanf(configs[i], "%d+%d", &n, &m) != 2 ||
+                n <= 0 || RS_LIB_MAX_DATA_BLOCKS < n ||
+                m <= 0 || RS_LIB_MAX_WIDE_RECOVERY_BLOCKS < m) {
+            printf("invalid n+m: %s\n", configs[i]);
+            return 1;
+        }
+        if (run(n, m, blocksize, iterations, tests) != 0)
+            return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
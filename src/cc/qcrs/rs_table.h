@@ -42,6 +42,10 @@ typedef struct rs_nibtab rs_nibtab;
 /* Nibble multiplication table */
 extern const rs_nibtab rs_nibmul[];
 
+/* Powers of 2, and logarithms base 2: rs_pow2[rs_log2[x]] == x, x != 0 */
+extern const uint8_t rs_pow2[];
+extern const uint8_t rs_log2[];
+
 /* Recovery coefficients for 1 missing data block
  * e.g., use rs_r1P[x] if x is missing and P is available.
  */
@@ -68,4 +72,50 @@ extern const uint8_t rs_r3[][9];
 extern const uint16_t rs_r3map[RS_LIB_MAX_DATA_BLOCKS][RS_LIB_MAX_DATA_BLOCKS][
     RS_LIB_MAX_DATA_BLOCKS];
 
+/* Multiply vector elements by x. */
+static inline v16
+mulby(uint8_t x, v16 v)
+{
+#ifdef LIBRS_USE_NEON
+
+#define uint8x16_to_8x8x2(v) ((uint8x8x2_t) { vget_low_u8(v), vget_high_u8(v) })
+
+    v16 lo, hi;
+
+    lo = v & VEC16(0x0f);
+    hi = vshrq_n_u8(v, 4);
+    lo = vcombine_u8(
+            vtbl2_u8(uint8x16_to_8x8x2(rs_nibmul[x].lo), vget_low_u8(lo)),
+            vtbl2_u8(uint8x16_to_8x8x2(rs_nibmul[x].lo), vget_high_u8(lo)));
+    hi = vcombine_u8(
+            vtbl2_u8(uint8x16_to_8x8x2(rs_nibmul[x].hi), vget_low_u8(hi)),
+            vtbl2_u8(uint8x16_to_8x8x2(rs_nibmul[x].hi), vget_high_u8(hi)));
+    return lo ^ hi;
+
+#elif defined(LIBRS_USE_SSSE3)
+
+    v16 lo, hi;
+
+    lo = v & VEC16(0x0f);
+    hi = __builtin_ia32_psrawi128(v, 4);
+    hi &= VEC16(0x0f);
+    lo = __builtin_ia32_pshufb128(rs_nibmul[x].lo, lo);
+    hi = __builtin_ia32_pshufb128(rs_nibmul[x].hi, hi);
+    return lo ^ hi;
+
+#else
+
+    v16 vv = VEC16(0);
+
+    while (x != 0) {
+        if (x & 1)
+            vv ^= v;
+        x >>= 1;
+        v = mul2(v);
+    }
+    return vv;
+
+#endif
+}
+
 #endif /* RS_TABLE_H */
@@ -62,15 +62,163 @@ mkrand(void *buf, int size)
 void *data[RS_LIB_MAX_DATA_BLOCKS+3];
 void *orig[RS_LIB_MAX_DATA_BLOCKS+3];
 
+#define WIDE_MAX_BLOCKS \
+    (RS_LIB_MAX_DATA_BLOCKS + RS_LIB_MAX_WIDE_RECOVERY_BLOCKS)
+#define WIDE_MAX_BLOCKSIZE (4 << 10)
+#define WIDE_PATTERNS 24
+#define WIDE_DATA_SETS 3
+
+/* Choose cnt distinct random block indices in [0, nblocks). */
+static void
+mkmissing(int nblocks, int cnt, int *missing)
+{
+    int i, j, x;
+
+    for (i = 0; i < cnt; i++) {
+        do {
+            x = rand() % nblocks;
+            for (j = 0; j < i && missing[j] != x; j++)
+                ;
+        } while (j < i);
+        missing[i] = x;
+    }
+    missing[cnt] = -1;
+}
+
+/*
+ * n+m coder test. For each recovery block count m verifies that:
+ * - with m <= 3 the recovery blocks are the same as rs_encode() ones,
+ * - random erasure patterns of up to m blocks are decoded, and missing
+ *   recovery blocks with null buffers are not computed,
+ * - the same decoder computed once for an erasure pattern decodes different
+ *   data, as the decoding matrices cached by the erasure pattern are used,
+ * - more than m missing blocks, or invalid missing block list are rejected.
+ * Return 0 on success, -1 otherwise.
+ */
+static int
+test_wide(int n, int blocksize)
+{
+    static void *wdata[WIDE_MAX_BLOCKS];
+    static void *worig[WIDE_MAX_BLOCKS];
+    static void *wref[RS_LIB_MAX_DATA_BLOCKS + 3];
+    static void *wptr[WIDE_MAX_BLOCKS];
+    int missing[RS_LIB_MAX_WIDE_RECOVERY_BLOCKS + 2];
+    int i, k, m, p, d, cnt, nblocks, err;
+    rs_decoder dec;
+
+    if (blocksize > WIDE_MAX_BLOCKSIZE)
+        blocksize = WIDE_MAX_BLOCKSIZE;
+    for (i = 0; i < n + RS_LIB_MAX_WIDE_RECOVERY_BLOCKS; i++) {
+        if ((err = posix_memalign(wdata + i, 16, blocksize)) ||
+                (err = posix_memalign(worig + i, 16, blocksize)) ||
+                (i < n + 3 &&
+                    (err = posix_memalign(wref + i, 16, blocksize)))) {
+            printf("%s\n", strerror(err));
+            return -1;
+        }
+    }
+    for (m = 1; m <= RS_LIB_MAX_WIDE_RECOVERY_BLOCKS; m++) {
+        nblocks = n + m;
+        if (m <= RS_LIB_MAX_RECOVERY_BLOCKS) {
+            for (i = 0; i < n; i++) {
+                mkrand(wdata[i], blocksize);
+                memmove(wref[i], wdata[i], blocksize);
+            }
+            rs_encode(n + 3, blocksize, wref);
+            rs_encode_n(nblocks, m, blocksize, wdata);
+            for (i = n; i < nblocks; i++)
+                if (memcmp(wdata[i], wref[i], blocksize) != 0) {
+                    printf("FAILED: %d+%d recovery block %d differs from"
+                        " rs_encode()\n", n, m, i);
+                    return -1;
+                }
+        }
+        for (p = 0; p < WIDE_PATTERNS; p++) {
+            cnt = p == 0 ? m : 1 + rand() % m;
+            mkmissing(nblocks, cnt, missing);
+            if (rs_decoder_init(&dec, nblocks, m, missing) != 0) {
+                printf("FAILED: %d+%d decoder init, missing: %d\n",
+                    n, m, cnt);
+                return -1;
+            }
+            for (d = 0; d < WIDE_DATA_SETS; d++) {
+                for (i = 0; i < n; i++)
+                    mkrand(wdata[i], blocksize);
+                rs_encode_n(nblocks, m, blocksize, wdata);
+                for (i = 0; i < nblocks; i++) {
+                    memmove(worig[i], wdata[i], blocksize);
+                    wptr[i] = wdata[i];
+                }
+                for (k = 0; k < cnt; k++) {
+                    memset(wdata[missing[k]], 0, blocksize);
+                    /* Do not rebuild every other missing recovery block. */
+                    if (n <= missing[k] && (k + d) % 2 == 0)
+                        wptr[missing[k]] = 0;
+                }
+                rs_decode_n(&dec, blocksize, wptr);
+                for (i = 0; i < nblocks; i++) {
+                    if (! wptr[i]) {
+                        if (memcmp(wdata[i], worig[i], blocksize) == 0) {
+                            printf("FAILED: %d+%d block %d with null buffer"
+                                " computed\n", n, m, i);
+                            return -1;
+                        }
+                        continue;
+                    }
+                    if (memcmp(wdata[i], worig[i], blocksize) != 0) {
+                        printf("FAILED: %d+%d pattern %d data set %d"
+                            " missing: %d block %d\n", n, m, p, d, cnt, i);
+                        return -1;
+                    }
+                }
+            }
+        }
+        if (nblocks > m + 1) {
+            mkmissing(nblocks, m + 1, missing);
+            if (rs_decoder_init(&dec, nblocks, m, missing) == 0) {
+                printf("FAILED: %d+%d decoder init with %d missing\n",
+                    n, m, m + 1);
+                return -1;
+            }
+        }
+        if (m > 1) {
+            missing[0] = 0;
+            missing[1] = 0;
+            missing[2] = -1;
+            if (rs_decoder_init(&dec, nblocks, m, missing) == 0) {
+                printf("FAILED: %d+%d decoder init with duplicate missing\n",
+                    n, m);
+                return -1;
+            }
+        }
+        missing[0] = nblocks;
+        missing[1] = -1;
+        if (rs_decoder_init(&dec, nblocks, m, missing) == 0) {
+            printf("FAILED: %d+%d decoder init with invalid index\n", n, m);
+            return -1;
+        }
+    }
+    for (i = 0; i < n + RS_LIB_MAX_WIDE_RECOVERY_BLOCKS; i++) {
+        free(wdata[i]);
+        free(worig[i]);
+        if (i < n + 3)
+            free(wref[i]);
+    }
+    printf("n+m PASS\n");
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     if (argc > 1 && (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help"))) {
         printf("Usage: %s [data blocks] [block size] [perf iterations]\n"
-               "       This tests the Reed Solomon encoder and decoder.\n"
+               "       This tests the Reed Solomon encoder and decoder, and\n"
+               "       n+m coder with up to %d recovery blocks.\n"
                "       0 < data blocks <= %d.\n"
                "       Use perf iterations for performance test.\n"
                "       Defaults: data blocks=%d, block size=%d\n", argv[0],
-               RS_LIB_MAX_DATA_BLOCKS, RS_LIB_MAX_DATA_BLOCKS, (64 << 10));
+               RS_LIB_MAX_WIDE_RECOVERY_BLOCKS, RS_LIB_MAX_DATA_BLOCKS,
+               RS_LIB_MAX_DATA_BLOCKS, (64 << 10));
         exit(0);
     }
 
@@ -146,6 +294,9 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    if (test_wide(N, BLOCKSIZE) != 0)
+        return 1;
+
     for (n = 0; n < 17; n++) {
         if (n > 0) {
             for (i = 0; i < N; i++)
@@ -269,7 +269,7 @@ CpToKfs::Run(int argc, char **argv)
             " [-x] -- delete destination files if exist\n"
             " [-u] -- stripe size\n"
             " [-y] -- data stripes count\n"
-            " [-z] -- recovery stripes count (0 or 3 with file type 2)\n"
+            " [-z] -- recovery stripes count (0 to 32 with file type 2)\n"
             " [-S] -- 6+3 RS 64KB stripes 1 replica\n"
             " [-R] -- op retry count, default -1 -- qfs client default\n"
             " [-D] -- op retry delay, default -1 -- qfs client default\n"
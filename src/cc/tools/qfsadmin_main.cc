@@ -73,6 +73,11 @@ using std::istringstream;
                                        " counters") \
     f(GET_REQUEST_COUNTERS,            "stats: get meta server request" \
                                        " counters") \
+    f(GET_REQUEST_HISTOGRAMS,          "stats: get meta server request" \
+                                       " latency and client threads queue" \
+                                       " depth histograms" \
+                                       " [-F Reset=1]" \
+    ) \
     f(PING,                            "stats: list current status counters") \
     f(STATS,                           "stats: list RPC counters") \
     f(FSCK,                            "debug: run fsck") \
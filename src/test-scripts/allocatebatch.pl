@@ -0,0 +1,157 @@
+eval 'exec perl -wS $0 ${1+"$@"}'
+  if 0;
+#
+# $Id$
+#
+# Created 2026/10/19
+#
+# Copyright 2026 Quantcast Corp.
+#
+# This file is part of Kosmos File System (KFS).
+#
+# Licensed under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License. You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+# implied. See the License for the specific language governing
+# permissions and limitations under the License.
+#
+# Meta server ALLOCATE_BATCH protocol test. Creates file in the root
+# directory and verifies that:
+# - ALLOCATE response has batch allocation support flag only if the request
+#   has it,
+# - ALLOCATE_BATCH with duplicate chunk offsets is rejected,
+# - ALLOCATE_BATCH response has all requested chunk allocations in the
+#   request order.
+#
+
+use Socket;
+use IO::Handle;
+
+my $remote = shift || '127.0.0.1';
+my $port   = shift || 20700;
+my $name   = shift || 'allocatebatch.' . $$;
+
+socket(SOCK, PF_INET, SOCK_STREAM, getprotobyname('tcp')) or die "socket: $!";
+my $iaddr = inet_aton($remote) || die "no host: $remote";
+my $paddr = sockaddr_in($port, $iaddr);
+connect(SOCK, $paddr) or die "connect: $!";
+binmode(SOCK);
+SOCK->autoflush(1);
+
+my $seq = 1000;
+my $uid = $<;
+my $gid = (split(/ /, $())[0];
+
+sub request($)
+{
+    my $req = shift;
+    $seq++;
+    print SOCK $req . "Cseq: $seq\r\n" .
+        "Version: KFS/1.0\r\n" .
+        "Client-Protocol-Version: 114\r\n" .
+        "UserId: $uid\r\n" .
+        "GroupId: $gid\r\n" .
+        "\r\n";
+    my %resp = ();
+    while (defined(my $line = <SOCK>)) {
+        last if ($line eq "\r\n");
+        if ($line =~ /^([^:]+): *(.*)\r\n$/) {
+            $resp{$1} = $2;
+        }
+    }
+    die "invalid response sequence" if (! defined($resp{'Cseq'}) ||
+        $resp{'Cseq'} != $seq);
+    my $len = $resp{'Content-length'} || 0;
+    my $content = '';
+    while (length($content) < $len) {
+        my $buf;
+        my $n = read(SOCK, $buf, $len - length($content));
+        die "read: $!" if (! $n);
+        $content .= $buf;
+    }
+    $resp{'content'} = $content;
+    return %resp;
+}
+
+my $status = 0;
+
+sub check($$)
+{
+    my ($ok, $msg) = @_;
+    if ($ok) {
+        print "$msg passed\n";
+    } else {
+        print "error: $msg failed\n";
+        $status = 1;
+    }
+}
+
+my %resp = request("CREATE\r\n" .
+    "Parent File-handle: 2\r\n" .
+    "Filename: $name\r\n" .
+    "Num-replicas: 1\r\n" .
+    "Exclusive: 1\r\n" .
+    "Owner: $uid\r\n" .
+    "Group: $gid\r\n" .
+    "Mode: 420\r\n");
+die "create failed: " . ($resp{'Status'} || '') . ' ' .
+    ($resp{'Status-message'} || '') if ($resp{'Status'} != 0);
+my $fid = $resp{'File-handle'};
+my $alloc = "ALLOCATE\r\n" .
+    "Client-host: allocatebatchtest\r\n" .
+    "Pathname: /$name\r\n" .
+    "File-handle: $fid\r\n";
+
+%resp = request($alloc . "Chunk-offset: 0\r\n");
+check($resp{'Status'} == 0 && ! defined($resp{'Allocate-batch'}),
+    "allocate without batch flag");
+%resp = request($alloc .
+    "Chunk-offset: 67108864\r\n" .
+    "Allocate-batch: 1\r\n");
+check($resp{'Status'} == 0 && defined($resp{'Allocate-batch'}) &&
+    $resp{'Allocate-batch'} == 1, "allocate with batch flag");
+
+my $batch = "ALLOCATE_BATCH\r\n" .
+    "Client-host: allocatebatchtest\r\n" .
+    "Pathname: /$name\r\n" .
+    "File-handle: $fid\r\n";
+%resp = request($batch . "Chunk-offsets: 134217728 201326592 134217728\r\n");
+check($resp{'Status'} == -22 && defined($resp{'Status-message'}) &&
+    $resp{'Status-message'} =~ /duplicate/, "duplicate offsets");
+%resp = request($batch . "Chunk-offsets: 134217728 134217729\r\n");
+check($resp{'Status'} == -22, "offsets in the same chunk");
+
+my @offsets = (201326592, 134217728, 268435456);
+%resp = request($batch . "Chunk-offsets: " . join(' ', @offsets) . "\r\n");
+my @allocs = grep { $_ ne '' } split(/\r\n\r\n/, $resp{'content'});
+my $okflag = $resp{'Status'} == 0 && $resp{'Num-chunks'} == @offsets &&
+    @allocs == @offsets;
+my %chunks = ();
+for (my $i = 0; $okflag && $i < @allocs; $i++) {
+    my %alloc = map { /^([^:]+): *(.*)$/ ? ($1, $2) : () }
+        split(/\r\n/, $allocs[$i]);
+    $okflag = defined($alloc{'Status'}) && $alloc{'Status'} == 0 &&
+        defined($alloc{'Chunk-handle'}) &&
+        ! defined($chunks{$alloc{'Chunk-handle'}}) &&
+        ! defined($alloc{'Allocate-batch'});
+    $chunks{$alloc{'Chunk-handle'}} = 1 if ($okflag);
+}
+check($okflag, "batch allocation");
+
+# Allocation of the same chunk offsets must return the same chunks.
+%resp = request($batch . "Chunk-offsets: " . join(' ', @offsets) . "\r\n");
+@allocs = grep { $_ ne '' } split(/\r\n\r\n/, $resp{'content'});
+$okflag = $resp{'Status'} == 0 && @allocs == @offsets;
+for (my $i = 0; $okflag && $i < @allocs; $i++) {
+    $okflag = $allocs[$i] =~ /Chunk-handle: *(\d+)/ && defined($chunks{$1});
+}
+check($okflag, "batch re-allocation");
+
+close(SOCK) || die "close: $!";
+exit($status);
@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# $Id$
+#
+# Created 2026/10/19
+#
+# Copyright 2026 Quantcast Corp.
+#
+# This file is part of Kosmos File System (KFS).
+#
+# Licensed under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License. You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+# implied. See the License for the specific language governing
+# permissions and limitations under the License.
+#
+# Batch chunk allocation test. Writes RS file with more than one chunk block,
+# verifies that the writer used batch allocation, and that the file content
+# read back is the same, then runs ALLOCATE_BATCH protocol test.
+#
+# Usage: allocbatchtest.sh <build directory>
+#
+
+builddir=${1-`pwd`}
+metaport=${metaport-20700}
+testdir=${testdir-"`pwd`/allocbatchtest"}
+scriptdir=`dirname "$0"`
+scriptdir=`cd "$scriptdir" && pwd`
+. "$scriptdir/minicluster.sh"
+
+mcstart
+
+status=0
+# RS 2+1 with 64MB chunks, 3 chunk blocks. The first chunk block is always
+# allocated without batching.
+dd if=/dev/urandom of=src.dat bs=1048576 count=320 2>/dev/null || exit
+cptoqfs -s 127.0.0.1 -p $metaport -d src.dat -k /rs.dat \
+    -u 65536 -y 2 -z 1 -r 1 > cptoqfs.out 2>&1 || status=1
+batches=`mcpingcounter 'Chunk Allocation Batches'`
+chunks=`mcpingcounter 'Chunk Allocation Batch Chunks'`
+if [ 0 -lt ${batches:-0} ] && [ 1 -lt ${chunks:-0} ]; then
+    echo "writer batch allocation passed: batches: $batches chunks: $chunks"
+else
+    echo "error: writer did not use batch allocation:" \
+        "batches: $batches chunks: $chunks"
+    status=1
+fi
+cpfromqfs -s 127.0.0.1 -p $metaport -k /rs.dat -d dst.dat \
+    > cpfromqfs.out 2>&1 || status=1
+if cmp src.dat dst.dat; then
+    echo "RS file read back passed"
+else
+    status=1
+fi
+rm -f src.dat dst.dat
+
+perl "$scriptdir/allocatebatch.pl" 127.0.0.1 $metaport || status=1
+
+mcfinish $status "allocate batch test"
@@ -0,0 +1,229 @@
+#!/bin/sh
+#
+# $Id$
+#
+# Created 2026/10/19
+#
+# Copyright 2026 Quantcast Corp.
+#
+# This file is part of Kosmos File System (KFS).
+#
+# Licensed under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License. You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+# implied. See the License for the specific language governing
+# permissions and limitations under the License.
+#
+# Meta server checkpoint restore round trip test. Runs meta server with
+# incremental checkpoint mode, and optionally with checkpoint compression,
+# modifies the name space, waits for the checkpoints written by the log
+# compactor, and then verifies that:
+# - the meta server restarted from the new checkpoint serves the same name
+#   space,
+# - the meta server does not write new checkpoints with no log records since
+#   the latest checkpoint,
+# - the name space restored from the initial empty checkpoint by replaying all
+#   log segments is the same.
+#
+# Usage: checkpointtest.sh <build directory> [compression level]
+#
+
+builddir=${1-`pwd`}
+complevel=${2--1}
+metaport=${metaport-20500}
+testdir=${testdir-"`pwd`/checkpointtest${complevel}"}
+maxwait=${maxwait-60}
+
+for dir in src/cc/meta src/cc/tools; do
+    if [ -d "$builddir/$dir" ]; then
+        PATH="`cd "$builddir/$dir" && pwd`:${PATH}"
+    fi
+done
+export PATH
+
+compactor=`which logcompactor` || exit
+for tool in metaserver qfs qfsadmin; do
+    which "$tool" > /dev/null || exit
+done
+
+metapid=''
+cleanup()
+{
+    if [ x"$metapid" != x ]; then
+        kill -KILL "$metapid" 2>/dev/null
+        metapid=''
+    fi
+}
+trap cleanup EXIT INT HUP TERM
+
+rm -rf "$testdir" || exit
+mkdir -p "$testdir/kfscp" "$testdir/kfslog" || exit
+cd "$testdir" || exit
+
+cat > meta.prp << EOF
+metaServer.clientIp = 127.0.0.1
+metaServer.chunkServerIp = 127.0.0.1
+metaServer.clientPort = $metaport
+metaServer.chunkServerPort = `expr $metaport + 1`
+metaServer.clusterKey = checkpointtest
+metaServer.cpDir = kfscp
+metaServer.logDir = kfslog
+metaServer.recoveryInterval = 0
+metaServer.minChunkservers = 0
+metaServer.rootDirUser = `id -u`
+metaServer.rootDirGroup = `id -g`
+metaServer.rootDirMode = 0777
+metaServer.msgLogWriter.logLevel = INFO
+metaServer.checkpoint.interval = 1
+metaServer.checkpoint.incremental = 1
+metaServer.checkpoint.logCompactor = $compactor
+metaServer.checkpoint.compressionLevel = $complevel
+metaServer.checkpoint.lockFileName = ckpt.lock
+EOF
+
+qfscmd()
+{
+    qfs -fs "qfs://127.0.0.1:$metaport" "$@"
+}
+
+pingcounter()
+{
+    qfsadmin -s 127.0.0.1 -p "$metaport" ping |
+        tr '\t' '\n' | sed -ne "s/^$1= *//p" | head -1
+}
+
+startmeta()
+{
+    metaserver meta.prp "$1" > "$1.out" 2>&1 &
+    metapid=$!
+    i=0
+    until qfscmd -ls / > /dev/null 2>&1; do
+        if [ $i -ge $maxwait ] || ! kill -0 "$metapid" 2>/dev/null; then
+            echo "meta server start failure"
+            cat "$1.out" "$1"
+            exit 1
+        fi
+        i=`expr $i + 1`
+        sleep 1
+    done
+}
+
+stopmeta()
+{
+    kill -TERM "$metapid" || exit
+    wait "$metapid"
+    metapid=''
+}
+
+latestcheckpoint()
+{
+    ls -i kfscp/latest 2>/dev/null | awk '{print $1}'
+}
+
+waitcheckpoint()
+{
+    prev=`latestcheckpoint`
+    i=0
+    until [ x"`latestcheckpoint`" != x"$prev" ]; do
+        if [ $i -ge $maxwait ]; then
+            echo "checkpoint wait timed out"
+            exit 1
+        fi
+        i=`expr $i + 1`
+        sleep 1
+    done
+    # Let the meta server register the checkpoint.
+    sleep 2
+}
+
+# Create empty file system, and save its checkpoint.
+metaserver -c meta.prp meta0.log > meta0.out 2>&1 || exit
+mkdir cp0 || exit
+cp -p kfscp/* cp0/ || exit
+ln -f cp0/`ls -1 cp0 | grep -v latest | head -1` cp0/latest || exit
+
+startmeta meta.log
+for i in 1 2 3 4 5 6 7 8; do
+    qfscmd -mkdir "/test/dir$i/sub" || exit
+    qfscmd -touchz "/test/dir$i/file$i" || exit
+done
+waitcheckpoint
+qfscmd -mv /test/dir1 /test/dir1renamed || exit
+qfscmd -rmr -skipTrash /test/dir2 || exit
+qfscmd -chmod 700 /test/dir3 || exit
+qfscmd -touchz /test/dir4/sub/file || exit
+waitcheckpoint
+qfscmd -lsr / > expected.ls || exit
+# The compression counters are passed back from the log compactor.
+cinbytes=`pingcounter 'Checkpoint Compress In Bytes'`
+coutbytes=`pingcounter 'Checkpoint Compress Out Bytes'`
+cratio=`pingcounter 'Checkpoint Last Compression Ratio'`
+stopmeta
+
+status=0
+if [ $complevel -ge 0 ]; then
+    if gzip -t kfscp/latest; then
+        echo "checkpoint is compressed"
+    else
+        echo "error: checkpoint is not compressed"
+        status=1
+    fi
+    echo "compress in: $cinbytes out: $coutbytes ratio: $cratio"
+    if [ ${cinbytes:-0} -le 0 ] || [ ${coutbytes:-0} -le 0 ]; then
+        echo "error: no checkpoint compression counters"
+        status=1
+    fi
+fi
+
+# Restore from the new checkpoint.
+startmeta meta1.log
+qfscmd -lsr / > restored.ls || status=1
+# No log records since the latest checkpoint, the meta server must not write
+# new checkpoints.
+ckpt=`latestcheckpoint`
+sleep 4
+if [ x"$ckpt" = x"`latestcheckpoint`" ] && \
+        qfscmd -lsr / > restored1.ls && cmp restored.ls restored1.ls; then
+    echo "no log records checkpoint passed"
+else
+    echo "error: no log records checkpoint failed"
+    status=1
+fi
+stopmeta
+if cmp expected.ls restored.ls; then
+    echo "meta server restore passed"
+else
+    echo "error: meta server restore failed"
+    status=1
+fi
+
+# Restore from the initial empty checkpoint by replaying all log segments.
+mkdir full || exit
+cp -p meta.prp full/ || exit
+cp -a kfslog full/ || exit
+cp -a cp0 full/kfscp || exit
+cd full || exit
+startmeta meta.log
+qfscmd -lsr / > ../full.ls || status=1
+stopmeta
+cd .. || exit
+if cmp expected.ls full.ls; then
+    echo "full log replay restore passed"
+else
+    echo "error: full log replay restore failed"
+    status=1
+fi
+
+if [ $status -eq 0 ]; then
+    echo "Passed checkpoint test"
+    cd .. && rm -rf "$testdir"
+else
+    echo "Checkpoint test failed"
+fi
+exit $status
@@ -0,0 +1,235 @@
+#!/bin/sh
+#
+# $Id$
+#
+# Created 2026/10/19
+#
+# Copyright 2026 Quantcast Corp.
+#
+# This file is part of Kosmos File System (KFS).
+#
+# Licensed under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License. You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+# implied. See the License for the specific language governing
+# permissions and limitations under the License.
+#
+# Meta data fetch test. Starts meta server with non empty file system, then
+# starts the second meta server node with empty checkpoint and log
+# directories, configured to fetch the meta data from the first node with
+# multiple connections and with the read rate limit, and verifies that:
+# - the fetched checkpoint and log segments are identical to the first node's
+#   checkpoint and log segments,
+# - the fetch rate does not exceed the configured limit,
+# - the second node serves the same name space.
+#
+# Usage: metadatasynctest.sh <build directory>
+#
+
+builddir=${1-`pwd`}
+metaport=${metaport-20600}
+testdir=${testdir-"`pwd`/metadatasynctest"}
+maxwait=${maxwait-60}
+# Set the fetch rate such that the fetch takes at least a few seconds.
+maxreadrate=${maxreadrate-8192}
+
+for dir in src/cc/meta src/cc/tools; do
+    if [ -d "$builddir/$dir" ]; then
+        PATH="`cd "$builddir/$dir" && pwd`:${PATH}"
+    fi
+done
+export PATH
+
+for tool in metaserver qfs; do
+    which "$tool" > /dev/null || exit
+done
+
+metapid=''
+metapid2=''
+cleanup()
+{
+    for pid in $metapid $metapid2; do
+        kill -KILL "$pid" 2>/dev/null
+    done
+    metapid=''
+    metapid2=''
+}
+trap cleanup EXIT INT HUP TERM
+
+rm -rf "$testdir" || exit
+mkdir -p "$testdir/meta1/kfscp" "$testdir/meta1/kfslog" \
+    "$testdir/meta2/kfscp" "$testdir/meta2/kfslog" || exit
+cd "$testdir" || exit
+
+metaprops()
+{
+    cat << EOF
+metaServer.clientIp = 127.0.0.1
+metaServer.chunkServerIp = 127.0.0.1
+metaServer.clientPort = $1
+metaServer.chunkServerPort = `expr $1 + 1`
+metaServer.clusterKey = metadatasynctest
+metaServer.cpDir = kfscp
+metaServer.logDir = kfslog
+metaServer.recoveryInterval = 0
+metaServer.minChunkservers = 0
+metaServer.rootDirUser = `id -u`
+metaServer.rootDirGroup = `id -g`
+metaServer.rootDirMode = 0777
+metaServer.msgLogWriter.logLevel = INFO
+metaServer.checkpoint.interval = 3600
+metaServer.log.rotateIntervalSec = 4
+EOF
+}
+
+qfscmd()
+{
+    port=$1
+    shift
+    qfs -fs "qfs://127.0.0.1:$port" "$@"
+}
+
+waitmeta()
+{
+    i=0
+    until qfscmd "$1" -ls / > /dev/null 2>&1; do
+        if [ $i -ge $maxwait ] || ! kill -0 "$2" 2>/dev/null; then
+            echo "meta server start failure"
+            cat meta.log.out meta.log
+            exit 1
+        fi
+        i=`expr $i + 1`
+        sleep 1
+    done
+}
+
+cd meta1 || exit
+metaprops $metaport > meta.prp
+metaserver -c meta.prp meta0.log > meta0.out 2>&1 || exit
+metaserver meta.prp meta.log > meta.log.out 2>&1 &
+metapid=$!
+waitmeta $metaport $metapid
+i=0
+while [ $i -lt 64 ]; do
+    qfscmd $metaport -mkdir "/test/dir$i/sub" || exit
+    qfscmd $metaport -touchz "/test/dir$i/file$i" || exit
+    i=`expr $i + 1`
+done
+# Let the log segment rotate, in order to fetch more than one log segment.
+sleep 5
+i=0
+while [ $i -lt 32 ]; do
+    qfscmd $metaport -mv "/test/dir$i" "/test/renamed$i" || exit
+    i=`expr $i + 1`
+done
+# Wait for the log segment with the last changes to be closed.
+sleep 6
+qfscmd $metaport -lsr / > ../expected.ls || exit
+fsid=`awk 'BEGIN{FS="/";}{ if ($1 == "filesysteminfo") { print $3; exit; }}' \
+    kfscp/latest`
+cd .. || exit
+if [ x"$fsid" = x ]; then
+    echo "failed to determine file system id"
+    exit 1
+fi
+
+cd meta2 || exit
+metaport2=`expr $metaport + 10`
+metaprops $metaport2 > meta.prp
+cat >> meta.prp << EOF
+metaServer.vr.id = 0
+metaServer.metaDataSync.fileSystemId = $fsid
+metaServer.metaDataSync.servers = 127.0.0.1 $metaport
+metaServer.metaDataSync.maxReadSize = 4096
+metaServer.metaDataSync.maxReadOpsCount = 4
+metaServer.metaDataSync.connectionsCount = 3
+metaServer.metaDataSync.maxReadRate = $maxreadrate
+EOF
+start=`date +%s`
+metaserver meta.prp meta.log > meta.log.out 2>&1 &
+metapid2=$!
+i=0
+until grep 'done fetching checkpoint and logs' meta.log > /dev/null 2>&1; do
+    if [ $i -ge $maxwait ] || ! kill -0 "$metapid2" 2>/dev/null; then
+        echo "meta data fetch failure"
+        cat meta.log.out meta.log
+        exit 1
+    fi
+    i=`expr $i + 1`
+    sleep 1
+done
+end=`date +%s`
+cd .. || exit
+
+status=0
+fetched=0
+for fn in `cd meta2/kfscp && ls -1 | grep -v latest` \
+        `cd meta2/kfslog && ls -1 | grep '^log\.'`; do
+    if [ -f "meta2/kfscp/$fn" ]; then
+        dir=kfscp
+    else
+        dir=kfslog
+    fi
+    if cmp "meta1/$dir/$fn" "meta2/$dir/$fn"; then
+        sz=`wc -c < "meta2/$dir/$fn"`
+        fetched=`expr $fetched + $sz`
+    else
+        status=1
+    fi
+done
+if [ $status -eq 0 ] && [ $fetched -gt 0 ]; then
+    echo "fetched $fetched bytes, identical to the source"
+else
+    echo "error: fetched meta data differs from the source"
+    status=1
+fi
+
+# Token bucket allows one second burst, and the time is measured with one
+# second resolution.
+mintime=`expr $fetched / $maxreadrate - 2`
+elapsed=`expr $end - $start`
+if [ $mintime -le $elapsed ]; then
+    echo "fetch rate limit passed: $fetched bytes in $elapsed sec"
+else
+    echo "error: $fetched bytes fetched in $elapsed sec, limit: $maxreadrate"
+    status=1
+fi
+
+if grep 'connections: 3' meta2/meta.log > /dev/null; then
+    echo "multiple connections passed"
+else
+    echo "error: meta data fetch did not use multiple connections"
+    status=1
+fi
+
+if [ $status -eq 0 ]; then
+    cd meta2 || exit
+    waitmeta $metaport2 $metapid2
+    cd .. || exit
+    if qfscmd $metaport2 -lsr / > fetched.ls && cmp expected.ls fetched.ls
+    then
+        echo "fetched name space passed"
+    else
+        echo "error: fetched name space differs from the source"
+        status=1
+    fi
+fi
+
+kill -TERM $metapid $metapid2
+wait
+metapid=''
+metapid2=''
+
+if [ $status -eq 0 ]; then
+    echo "Passed meta data sync test"
+    cd .. && rm -rf "$testdir"
+else
+    echo "Meta data sync test failed"
+fi
+exit $status
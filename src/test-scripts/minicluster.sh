@@ -0,0 +1,210 @@
+#!/bin/sh
+#
+# $Id$
+#
+# Created 2026/10/19
+#
+# Copyright 2026 Quantcast Corp.
+#
+# This file is part of Kosmos File System (KFS).
+#
+# Licensed under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License. You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+# implied. See the License for the specific language governing
+# permissions and limitations under the License.
+#
+# Single host test cluster functions: meta server and chunk servers running
+# on the local host in the test directory. Intended to be sourced by the
+# test scripts.
+#
+# Parameters, set prior to sourcing:
+# builddir       -- build directory, default current directory
+# testdir        -- test directory, deleted and created by mcinit
+# metaport       -- meta server client port, chunk server port is metaport + 1
+# numchunksrv    -- number of chunk servers
+# csport         -- first chunk server client port
+# maxwait        -- max wait time in seconds
+# metaextraprops -- additional meta server configuration lines
+# csextraprops   -- additional chunk server configuration lines, $csidx and
+#                   $csdir are expanded with the chunk server index and
+#                   directory
+#
+
+builddir=${builddir-`pwd`}
+metaport=${metaport-20700}
+numchunksrv=${numchunksrv-3}
+csport=${csport-`expr $metaport + 10`}
+maxwait=${maxwait-60}
+metaextraprops=${metaextraprops-}
+csextraprops=${csextraprops-}
+
+mcmetapid=''
+mccspids=''
+
+mcinit()
+{
+    for dir in src/cc/meta src/cc/chunk src/cc/tools src/cc/devtools; do
+        if [ -d "$builddir/$dir" ]; then
+            PATH="`cd "$builddir/$dir" && pwd`:${PATH}"
+        fi
+    done
+    export PATH
+    for tool in metaserver chunkserver qfs qfsadmin; do
+        which "$tool" > /dev/null || exit
+    done
+    rm -rf "$testdir" || exit
+    mkdir -p "$testdir" || exit
+    cd "$testdir" || exit
+    trap mccleanup EXIT INT HUP TERM
+}
+
+mccleanup()
+{
+    for pid in $mcmetapid $mccspids; do
+        kill -KILL "$pid" 2>/dev/null
+    done
+    mcmetapid=''
+    mccspids=''
+}
+
+qfscmd()
+{
+    qfs -fs "qfs://127.0.0.1:$metaport" "$@"
+}
+
+qfsadmincmd()
+{
+    qfsadmin -s 127.0.0.1 -p "$metaport" "$@"
+}
+
+# Print meta server ping counter value.
+mcpingcounter()
+{
+    qfsadmincmd ping | tr '\t' '\n' | sed -ne "s/^$1= *//p" | head -1
+}
+
+# Print the sum of the chunk servers counter values.
+mccscounter()
+{
+    qfsadmincmd get_chunk_servers_counters | awk -F, -v name="$1" '
+        NR == 1 {
+            for (i = 1; i <= NF; i++) {
+                if ($i == name) {
+                    col = i
+                }
+            }
+            next
+        }
+        col { sum += $col }
+        END { print sum + 0 }'
+}
+
+mcstartmeta()
+{
+    mkdir -p meta/kfscp meta/kfslog || exit
+    cat > meta/meta.prp << EOF
+metaServer.clientIp = 127.0.0.1
+metaServer.chunkServerIp = 127.0.0.1
+metaServer.clientPort = $metaport
+metaServer.chunkServerPort = `expr $metaport + 1`
+metaServer.clusterKey = minicluster
+metaServer.cpDir = kfscp
+metaServer.logDir = kfslog
+metaServer.recoveryInterval = 0
+metaServer.minChunkservers = 0
+metaServer.rootDirUser = `id -u`
+metaServer.rootDirGroup = `id -g`
+metaServer.rootDirMode = 0777
+metaServer.msgLogWriter.logLevel = INFO
+$metaextraprops
+EOF
+    (cd meta && metaserver -c meta.prp meta0.log > meta0.out 2>&1) || exit
+    (cd meta && exec metaserver meta.prp meta.log > meta.out 2>&1) &
+    mcmetapid=$!
+    i=0
+    until qfscmd -ls / > /dev/null 2>&1; do
+        if [ $i -ge $maxwait ] || ! kill -0 "$mcmetapid" 2>/dev/null; then
+            echo "meta server start failure"
+            cat meta/meta.out meta/meta.log
+            exit 1
+        fi
+        i=`expr $i + 1`
+        sleep 1
+    done
+}
+
+mcstartchunkservers()
+{
+    csidx=1
+    while [ $csidx -le $numchunksrv ]; do
+        csdir="`pwd`/cs$csidx"
+        mkdir -p "$csdir/chunks" || exit
+        eval "csextra=\"$csextraprops\""
+        cat > "$csdir/cs.prp" << EOF
+chunkServer.metaServer.hostname = 127.0.0.1
+chunkServer.metaServer.port = `expr $metaport + 1`
+chunkServer.clientIp = 127.0.0.1
+chunkServer.clientPort = `expr $csport + $csidx - 1`
+chunkServer.chunkDir = $csdir/chunks
+chunkServer.clusterKey = minicluster
+chunkServer.msgLogWriter.logLevel = INFO
+chunkServer.ioBufferPool.partitionBufferCount = 8192
+$csextra
+EOF
+        (cd "$csdir" && exec chunkserver cs.prp cs.log > cs.out 2>&1) &
+        mccspids="$mccspids $!"
+        csidx=`expr $csidx + 1`
+    done
+    mcwaitchunkservers $numchunksrv
+}
+
+mcwaitchunkservers()
+{
+    i=0
+    until [ `qfsadmincmd upservers 2>/dev/null | wc -l` -ge $1 ]; do
+        if [ $i -ge $maxwait ]; then
+            echo "chunk servers wait timed out"
+            exit 1
+        fi
+        i=`expr $i + 1`
+        sleep 1
+    done
+}
+
+mcstart()
+{
+    mcinit
+    mcstartmeta
+    mcstartchunkservers
+}
+
+mcstop()
+{
+    for pid in $mccspids $mcmetapid; do
+        kill -TERM "$pid" 2>/dev/null
+    done
+    for pid in $mccspids $mcmetapid; do
+        wait "$pid" 2>/dev/null
+    done
+    mcmetapid=''
+    mccspids=''
+}
+
+mcfinish()
+{
+    mcstop
+    if [ $1 -eq 0 ]; then
+        echo "Passed $2"
+        cd .. && rm -rf "$testdir"
+    else
+        echo "$2 failed"
+    fi
+    exit $1
+}
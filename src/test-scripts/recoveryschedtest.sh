@@ -0,0 +1,125 @@
+#!/bin/sh
+#
+# $Id$
+#
+# Created 2026/10/19
+#
+# Copyright 2026 Quantcast Corp.
+#
+# This file is part of Kosmos File System (KFS).
+#
+# Licensed under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License. You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+# implied. See the License for the specific language governing
+# permissions and limitations under the License.
+#
+# Chunk server RS recovery scheduler test. Writes RS 2+1 files, stops one
+# chunk server, and waits for the remaining chunk servers to recover the lost
+# chunks with a single concurrent recovery per chunk server, and the network
+# recovery budget small enough to throttle the recoveries. Then stops one
+# more chunk server, in order to force the reads to use the recovered chunks,
+# and verifies that the files content is the same.
+#
+# Usage: recoveryschedtest.sh <build directory>
+#
+
+builddir=${1-`pwd`}
+metaport=${metaport-20800}
+testdir=${testdir-"`pwd`/recoveryschedtest"}
+numchunksrv=4
+numfiles=${numfiles-6}
+maxwait=${maxwait-180}
+metaextraprops='
+metaServer.serverDownReplicationDelay = 1
+metaServer.replicationCheckInterval = 1
+metaServer.CSCountersUpdateInterval = 1
+metaServer.maxConcurrentWriteReplicationsPerNode = 8
+metaServer.rebalancingEnabled = 0
+'
+csextraprops='
+chunkServer.replicator.maxConcurrentRecoveries = 1
+chunkServer.replicator.recoveryNetBytesPerSec = 4194304
+'
+scriptdir=`dirname "$0"`
+scriptdir=`cd "$scriptdir" && pwd`
+. "$scriptdir/minicluster.sh"
+
+mcstart
+
+status=0
+dd if=/dev/urandom of=src.dat bs=1048576 count=8 2>/dev/null || exit
+i=0
+while [ $i -lt $numfiles ]; do
+    cptoqfs -s 127.0.0.1 -p $metaport -d src.dat -k /rs$i.dat \
+        -u 65536 -y 2 -z 1 -r 1 > cptoqfs$i.out 2>&1 || status=1
+    i=`expr $i + 1`
+done
+if [ $status -ne 0 ]; then
+    cat cptoqfs*.out
+    mcfinish $status "recovery scheduler test"
+fi
+
+# Stop the last chunk server, the meta server schedules recovery of the lost
+# chunks on the remaining chunk servers.
+expected=`ls cs4/chunks | grep -c '^[0-9]*\.[0-9]*\.[0-9]*$'`
+set -- $mccspids
+kill -KILL $4
+wait $4 2>/dev/null
+mccspids="$1 $2 $3"
+lastcs=$3
+
+i=0
+recoveries=0
+until [ $expected -le ${recoveries:-0} ] &&
+        [ 0 -eq "`mcpingcounter Replications`" ]; do
+    if [ $i -ge $maxwait ]; then
+        echo "error: recovery wait timed out: recoveries: $recoveries" \
+            "expected: $expected"
+        status=1
+        break
+    fi
+    sleep 1
+    i=`expr $i + 1`
+    recoveries=`mccscounter Recovery-count`
+done
+throttled=`mccscounter Recovery-throttled`
+rbytes=`mccscounter Recovery-bytes`
+errors=`mccscounter Recovery-errors`
+echo "lost chunks: $expected recoveries: $recoveries throttled: $throttled" \
+    "bytes: $rbytes errors: $errors time: $i"
+if [ ${throttled:-0} -le 0 ] || [ ${rbytes:-0} -le 0 ] ||
+        [ ${errors:-1} -ne 0 ]; then
+    echo "error: recovery was not throttled, or failed"
+    status=1
+fi
+
+# Stop one more chunk server, the reads must use the recovered chunks.
+kill -KILL $lastcs
+wait $lastcs 2>/dev/null
+mccspids="$1 $2"
+
+i=0
+while [ $i -lt $numfiles ]; do
+    rm -f dst.dat
+    if cpfromqfs -s 127.0.0.1 -p $metaport -k /rs$i.dat -d dst.dat \
+            > cpfromqfs$i.out 2>&1 && cmp src.dat dst.dat; then
+        :
+    else
+        echo "error: /rs$i.dat read back failed"
+        status=1
+    fi
+    i=`expr $i + 1`
+done
+if [ $status -eq 0 ]; then
+    echo "recovered chunks read back passed"
+fi
+rm -f src.dat dst.dat
+
+mcfinish $status "recovery scheduler test"
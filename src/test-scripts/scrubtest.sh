@@ -0,0 +1,170 @@
+#!/bin/sh
+#
+# $Id$
+#
+# Created 2026/10/19
+#
+# Copyright 2026 Quantcast Corp.
+#
+# This file is part of Kosmos File System (KFS).
+#
+# Licensed under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License. You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+# implied. See the License for the specific language governing
+# permissions and limitations under the License.
+#
+# Chunk server background scrubber test. Writes files with 2 replicas, waits
+# for the scrubbers to complete a pass with no errors, then corrupts one
+# chunk replica, waits for the scrubber to detect the corruption, and for the
+# meta server to re-replicate the chunk, and verifies the files content.
+#
+# Usage: scrubtest.sh <build directory>
+#
+
+builddir=${1-`pwd`}
+metaport=${metaport-21000}
+testdir=${testdir-"`pwd`/scrubtest"}
+numchunksrv=3
+numfiles=${numfiles-4}
+maxwait=${maxwait-120}
+metaextraprops='
+metaServer.replicationCheckInterval = 1
+metaServer.CSCountersUpdateInterval = 1
+metaServer.rebalancingEnabled = 0
+'
+csextraprops='
+chunkServer.scrubber.bytesPerSec = 33554432
+chunkServer.scrubber.checkpointIntervalSec = 1
+'
+scriptdir=`dirname "$0"`
+scriptdir=`cd "$scriptdir" && pwd`
+. "$scriptdir/minicluster.sh"
+
+chunkfiles()
+{
+    ls "$@" | grep '^[0-9]*\.[0-9]*\.[0-9]*$'
+}
+
+# Print the min. chunk server counter value.
+cscountermin()
+{
+    qfsadmincmd get_chunk_servers_counters | awk -F, -v name="$1" '
+        NR == 1 {
+            for (i = 1; i <= NF; i++) {
+                if ($i == name) {
+                    col = i
+                }
+            }
+            next
+        }
+        col && (NR == 2 || $col < min) { min = $col }
+        END { print min + 0 }'
+}
+
+# Wait for the chunk servers counter to reach the value, $3 is the counter
+# function.
+waitcscounter()
+{
+    i=0
+    val=0
+    until [ $2 -le ${val:-0} ]; do
+        if [ $i -ge $maxwait ]; then
+            echo "error: $1 wait timed out: $val expected: $2"
+            status=1
+            return 1
+        fi
+        sleep 1
+        i=`expr $i + 1`
+        val=`${3-mccscounter} $1`
+    done
+    return 0
+}
+
+mcstart
+
+status=0
+dd if=/dev/urandom of=src.dat bs=1048576 count=3 2>/dev/null || exit
+i=0
+while [ $i -lt $numfiles ]; do
+    cptoqfs -s 127.0.0.1 -p $metaport -d src.dat -k /scrub$i.dat -r 2 \
+        > cptoqfs$i.out 2>&1 || status=1
+    i=`expr $i + 1`
+done
+if [ $status -ne 0 ]; then
+    cat cptoqfs*.out
+    mcfinish $status "scrubber test"
+fi
+replicas=`chunkfiles cs1/chunks cs2/chunks cs3/chunks | wc -l`
+
+# Every directory completes a pass, all replicas are verified.
+waitcscounter Scrub-passes 1 cscountermin &&
+    waitcscounter Scrub-chunks $replicas
+errors=`mccscounter Scrub-errors`
+echo "replicas: $replicas scrubbed: `mccscounter Scrub-chunks`" \
+    "bytes: `mccscounter Scrub-bytes` errors: $errors"
+if [ ${errors:-1} -ne 0 ]; then
+    echo "error: scrub errors with no corruption"
+    status=1
+fi
+for dir in cs1/chunks cs2/chunks cs3/chunks; do
+    if [ ! -s $dir/scrub.progress ]; then
+        echo "error: no scrub progress file in $dir"
+        status=1
+    elif [ `wc -c < $dir/scrub.progress` -ge 64 ] ||
+            [ x"`tr -d '0-9 \n-' < $dir/scrub.progress`" != x ]; then
+        echo "error: invalid scrub progress file in $dir"
+        status=1
+    fi
+done
+
+# Corrupt the data of one replica past the chunk header.
+for dir in cs1/chunks cs2/chunks cs3/chunks; do
+    chunk=`chunkfiles $dir | head -1`
+    if [ x"$chunk" != x ]; then
+        break
+    fi
+done
+dd if=/dev/urandom of="$dir/$chunk" bs=16384 seek=2 count=1 conv=notrunc \
+    2>/dev/null || status=1
+echo "corrupted $dir/$chunk"
+
+# The scrubber reports the corrupted replica, the chunk server moves it into
+# lost+found, and the meta server restores the replication, possibly on the
+# same chunk server.
+waitcscounter Scrub-errors 1
+i=0
+until [ $replicas -le `chunkfiles cs1/chunks cs2/chunks cs3/chunks | wc -l` ] &&
+        [ -f "$dir/lost+found/$chunk" ]; do
+    if [ $i -ge $maxwait ]; then
+        echo "error: corrupted replica re-replication wait timed out"
+        status=1
+        break
+    fi
+    sleep 1
+    i=`expr $i + 1`
+done
+echo "scrub errors: `mccscounter Scrub-errors` replicas:" \
+    "`chunkfiles cs1/chunks cs2/chunks cs3/chunks | wc -l`"
+
+i=0
+while [ $i -lt $numfiles ]; do
+    rm -f dst.dat
+    if cpfromqfs -s 127.0.0.1 -p $metaport -k /scrub$i.dat -d dst.dat \
+            > cpfromqfs$i.out 2>&1 && cmp src.dat dst.dat; then
+        :
+    else
+        echo "error: /scrub$i.dat read back failed"
+        status=1
+    fi
+    i=`expr $i + 1`
+done
+rm -f src.dat dst.dat
+
+mcfinish $status "scrubber test"
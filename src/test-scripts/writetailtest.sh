@@ -0,0 +1,103 @@
+#!/bin/sh
+#
+# $Id$
+#
+# Created 2026/10/19
+#
+# Copyright 2026 Quantcast Corp.
+#
+# This file is part of Kosmos File System (KFS).
+#
+# Licensed under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License. You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+# implied. See the License for the specific language governing
+# permissions and limitations under the License.
+#
+# Chunk server write tail retention test. Writes a file with small
+# sequential writes, in order to make the chunk server use the retained last
+# partial checksum block instead of reading it from disk. Then rewrites the
+# file tail with writes that overlap the retained block, and extend the file,
+# and verifies that the file content is the same as the expected content.
+#
+# Usage: writetailtest.sh <build directory>
+#
+
+builddir=${1-`pwd`}
+metaport=${metaport-20900}
+testdir=${testdir-"`pwd`/writetailtest"}
+numchunksrv=1
+maxwait=${maxwait-60}
+metaextraprops='
+metaServer.CSCountersUpdateInterval = 1
+'
+scriptdir=`dirname "$0"`
+scriptdir=`cd "$scriptdir" && pwd`
+. "$scriptdir/minicluster.sh"
+
+mcstart
+
+status=0
+# Test rewrite mode syncs after writing each 4KB input buffer, then rewrites
+# the same 4KB, thus the chunk server receives small writes that end inside a
+# checksum block.
+smallwrite()
+{
+    cptoqfs -s 127.0.0.1 -p $metaport -r 1 -b 4096 -W 1 "$@" \
+        >> cptoqfs.out 2>&1
+}
+
+# File size is not checksum block aligned, and spans two chunks.
+dd if=/dev/urandom of=src.dat bs=1000 count=67200 2>/dev/null || exit
+smallwrite -d src.dat -k /tail.dat || status=1
+
+# Rewrite the last 96KB of the file, and extend it by 48KB.
+size=`wc -c < src.dat`
+dd if=/dev/urandom of=tail.dat bs=1024 count=144 2>/dev/null || exit
+smallwrite -d tail.dat -k /tail.dat -B `expr $size - 98304` || status=1
+head -c `expr $size - 98304` src.dat > expected.dat
+cat tail.dat >> expected.dat
+if [ $status -ne 0 ]; then
+    cat cptoqfs.out
+    mcfinish $status "write tail test"
+fi
+
+i=0
+hits=0
+until [ 0 -lt ${hits:-0} ]; do
+    if [ $i -ge $maxwait ]; then
+        echo "error: write tail hit wait timed out"
+        status=1
+        break
+    fi
+    sleep 1
+    i=`expr $i + 1`
+    hits=`mccscounter Write-tail-hit`
+done
+misses=`mccscounter Write-tail-miss`
+echo "write tail hits: $hits misses: $misses"
+# The block that ends at checksum block boundary isn't retained, thus the
+# rewrite that precedes the boundary misses once per checksum block, all
+# other partial block writes must hit.
+if [ ${hits:-0} -le ${misses:-0} ]; then
+    echo "error: write tail hit count is less than miss count"
+    status=1
+fi
+
+rm -f dst.dat
+if cpfromqfs -s 127.0.0.1 -p $metaport -k /tail.dat -d dst.dat \
+        > cpfromqfs.out 2>&1 && cmp expected.dat dst.dat; then
+    echo "write tail read back passed"
+else
+    echo "error: /tail.dat read back failed"
+    status=1
+fi
+rm -f src.dat tail.dat expected.dat dst.dat
+
+mcfinish $status "write tail test"
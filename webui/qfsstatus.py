@@ -46,6 +46,7 @@ REQUEST_GET_DIRS_COUNTERS = (
         "utf-8"
     )
 )
+REQUEST_GET_HISTOGRAMS = "GET_REQUEST_HISTOGRAMS\r\nVersion: KFS/1.0\r\nCseq: 1\r\nClient-Protocol-Version: 116\r\n%s\r\n"
 
 gHasCollections = True
 try:
@@ -112,6 +113,7 @@ kChunkDirs = 5
 cMeta = 6
 kConfig = 7
 kVrStatus = 8
+kLatency = 9
 
 kHtmlEscapeTable = {
     "&": "&amp;",
@@ -329,7 +331,8 @@ class Status:
             <A href="/chunk-it">Chunk Servers Status</A>&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;
             <A href="/meta-it">Meta Server Status</A>&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;
             <A href="/chunkdir-it">Chunk Directories Status</A>&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;
-            <A href="/meta-conf-html">Meta Server Configuration</A>&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;""",
+            <A href="/meta-conf-html">Meta Server Configuration</A>&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;
+            <A href="/meta-latency-html">Meta Server Request Latency</A>&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;""",
             file=buffer,
         )
         if 0 <= systemInfo.vrNodeId:
@@ -1857,6 +1860,103 @@ def ping(status, metaserver):
     sock.close()
 
 
+def getRequestHistograms(metaserver, reset):
+    """Returns request latency histograms CSV rows, and response headers."""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    sock.connect((metaserver.node, metaserver.port))
+    req = REQUEST_GET_HISTOGRAMS % ("Reset: 1\r\n" if reset else "")
+    sock.send(req.encode("utf-8"))
+    sockIn = sock.makefile("r")
+    headers = {}
+    for line in sockIn:
+        line = line.strip()
+        if line == "":
+            break
+        pos = line.find(":")
+        if 0 < pos:
+            headers[line[:pos].strip()] = line[pos + 1 :].strip()
+    rows = []
+    if headers.get("Status", "0") == "0":
+        length = int(headers.get("Content-length", "0"))
+        content = sockIn.read(length) if 0 < length else ""
+        rows = [row.split(",") for row in content.split("\n") if row != ""]
+    sock.close()
+    return (headers, rows)
+
+
+def latencyToHTML(buffer, metaserver, reset):
+    (headers, rows) = getRequestHistograms(metaserver, reset)
+    title = "Meta Server Request Latency"
+    printStyle(buffer, title)
+    print(
+        """
+        <body class="oneColLiqCtr">
+        <div id="container">
+        <div id="mainContent">
+            <h1>""",
+        title,
+        displayName,
+        """</h1>
+            <P> <A href="/">Back</A>&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;
+            <A href="/meta-latency-html">Refresh</A>
+            </P>
+            <form method="post" action="/meta-latency-reset-html">
+            <input type="submit" value="Reset">
+            </form>""",
+        file=buffer,
+    )
+    if headers.get("Status", "0") != "0":
+        print(
+            "<P>", htmlEscape(headers.get("Status-message", "error: " + headers.get("Status", ""))), "</P>", file=buffer
+        )
+    try:
+        interval = (int(headers.get("Time-usec", "0")) - int(headers.get("Start-time-usec", "0"))) / 1e6
+        print("<P> Interval: %.3f sec. Time in microseconds, depth in requests.</P>" % interval, file=buffer)
+    except ValueError:
+        pass
+    print(
+        """
+            <div class="floatleft">
+            <table class="sortable network-status-table" id="latencytable">
+            <caption> Request latency and client threads queue depth </caption>
+            <thead>
+            <tr>""",
+        file=buffer,
+    )
+    # Omit totals and the buckets columns.
+    columns = 0
+    if rows:
+        header = rows[0]
+        columns = len(header) - 1
+        for name in header[:columns]:
+            if name != "Total":
+                print("<th>", htmlEscape(name), "</th>", file=buffer)
+    print(
+        """
+            </tr>
+            </thead>
+            <tbody>""",
+        file=buffer,
+    )
+    for row in rows[1:]:
+        print("<tr>", file=buffer)
+        for i in range(min(columns, len(row))):
+            if rows[0][i] != "Total":
+                print("<td>", htmlEscape(row[i]), "</td>", file=buffer)
+        print("</tr>", file=buffer)
+    print(
+        """
+            </tbody>
+            </table>
+            </div>
+        </div>
+        </div>
+        </body>
+        </html>""",
+        file=buffer,
+    )
+
+
 def parse_fields(line, field_sep="\t", key_sep="="):
     if gHasCollections:
         res = OrderedDict()
@@ -2353,6 +2453,20 @@ class Pinger(SimpleHTTPRequestHandler):
         try:
             interval = 60  # todo
 
+            # Histograms reset modifies the meta server state, and is only
+            # allowed with POST.
+            if self.path.startswith("/meta-latency-reset-html"):
+                txtStream = StringIO()
+                metaserver = ServerLocation(node=metaserverHost, port=metaserverPort)
+                latencyToHTML(txtStream, metaserver, True)
+                self.send_response(200)
+                self.send_header("Content-type", "text/html; charset=utf-8")
+                bytes_array = txtStream.getvalue().encode("utf-8")
+                self.send_header("Content-length", len(bytes_array))
+                self.end_headers()
+                self.wfile.write(bytes_array)
+                return
+
             clen = int(self.headers.get("Content-Length").strip())
             if clen <= 0:
                 self.send_response(400)
@@ -2459,7 +2573,11 @@ class Pinger(SimpleHTTPRequestHandler):
             status = None
             reqType = None
             getVrStatusHtml = self.path.startswith("/meta-vr-status-html")
-            if getVrStatusHtml or self.path.startswith("/meta-conf-html"):
+            if self.path.startswith("/meta-latency-html"):
+                latencyToHTML(txtStream, metaserver, False)
+                self.path = "/"
+                reqType = kLatency
+            elif getVrStatusHtml or self.path.startswith("/meta-conf-html"):
                 status = Status()
                 ping(status, metaserver)
                 if getVrStatusHtml:
@@ -2565,7 +2683,7 @@ class Pinger(SimpleHTTPRequestHandler):
                 if gQfsBrowser.printToHTML(self.path, metaserverHost, metaserverPort, txtStream) == 0:
                     self.send_error(404, "Not found")
                     return
-            elif reqType != cMeta and reqType != kConfig and reqType != kVrStatus:
+            elif reqType != cMeta and reqType != kConfig and reqType != kVrStatus and reqType != kLatency:
                 status = Status()
                 ping(status, metaserver)
                 printStyle(txtStream, "QFS Status")